@@ -0,0 +1,263 @@
+"""
+Analog Trace Player
+Play recorded (or synthetic) smoke / CO / temperature traces through the
+firmware's analog acquisition (analog_sensors.c, host build) exactly as the
+ADC DMA delivers them: half-buffer callbacks, CIC + FIR decimation, trend
+decision. Checks the decimation bit-exactly against a NumPy reference and
+reports when the vision pipeline would be woken
+"""
+
+import argparse
+import ctypes
+import csv
+import json
+from pathlib import Path
+
+import numpy as np
+
+from native_build import load_library, report_path
+
+
+# analog_sensors.h
+CHANNELS = 3
+CHANNEL_NAMES = ("smoke", "co", "temp")
+SAMPLE_HZ = 1000
+CIC_ORDER, CIC_DECIM, CIC_SHIFT = 3, 16, 8
+FIR_TAPS, FIR_DECIM = 16, 4
+DECIM = CIC_DECIM * FIR_DECIM
+HALF_FRAMES = DECIM
+DMA_SAMPLES = 2 * HALF_FRAMES * CHANNELS
+OUT_RING = 32
+SLOPE_WINDOW = 16
+FIR_Q15 = np.array([-32, 44, 305, 939, 1997, 3313, 4538, 5280,
+                    5280, 4538, 3313, 1997, 939, 305, 44, -32], dtype=np.int64)
+LEVEL_NAMES = ("quiet", "watch", "ALARM")
+
+
+class AnalogThresholds(ctypes.Structure):
+    _fields_ = [("watch_rise", ctypes.c_int32), ("alarm_rise", ctypes.c_int32),
+                ("watch_slope", ctypes.c_int32)]
+
+
+class AnalogFilter(ctypes.Structure):
+    _fields_ = [
+        ("integrator", ctypes.c_uint32 * CIC_ORDER),
+        ("comb", ctypes.c_uint32 * CIC_ORDER),
+        ("cic_phase", ctypes.c_uint32),
+        ("fir_history", ctypes.c_int32 * FIR_TAPS),
+        ("fir_pos", ctypes.c_uint32),
+        ("fir_phase", ctypes.c_uint32),
+    ]
+
+
+class AnalogTrend(ctypes.Structure):
+    _fields_ = [
+        ("baseline", ctypes.c_int32),
+        ("fast", ctypes.c_int32),
+        ("history", ctypes.c_int32 * SLOPE_WINDOW),
+        ("outputs", ctypes.c_uint32),
+        ("level", ctypes.c_uint8),
+    ]
+
+
+class AnalogDecision(ctypes.Structure):
+    """Mirror of AnalogDecision (analog_sensors.h)"""
+    _fields_ = [
+        ("level", ctypes.c_uint8),
+        ("channels", ctypes.c_uint8),
+        ("value", ctypes.c_int32 * CHANNELS),
+        ("rise", ctypes.c_int32 * CHANNELS),
+        ("slope", ctypes.c_int32 * CHANNELS),
+        ("sequence", ctypes.c_uint32),
+    ]
+
+
+class AnalogAcquisition(ctypes.Structure):
+    """Mirror of AnalogAcquisition (analog_sensors.h)"""
+    _fields_ = [
+        ("dma_buffer", ctypes.c_void_p),
+        ("filter", AnalogFilter * CHANNELS),
+        ("thresholds", AnalogThresholds * CHANNELS),
+        ("out", (ctypes.c_int32 * CHANNELS) * OUT_RING),
+        ("out_head", ctypes.c_uint32),
+        ("out_tail", ctypes.c_uint32),
+        ("trend", AnalogTrend * CHANNELS),
+        ("decision", AnalogDecision),
+        ("blocks", ctypes.c_uint32),
+        ("dropped", ctypes.c_uint32),
+    ]
+
+
+# ==================== TRACES ====================
+
+def synthetic_trace(scenario, seconds, seed=0):
+    """
+    ADC counts (N, 3) at SAMPLE_HZ with sensor noise and 50 Hz pickup
+
+    quiet: drift only | nuisance: steam puff on the smoke channel |
+    smoldering: smoke then CO climb, little heat | flaming: fast heat + smoke
+    """
+    rng = np.random.default_rng(seed)
+    t = np.arange(int(seconds * SAMPLE_HZ)) / SAMPLE_HZ
+    onset = seconds / 3
+    ramp = np.clip((t - onset) / (seconds - onset), 0, 1)
+
+    base = np.array([400.0, 300.0, 1800.0])
+    signal = np.tile(base, (len(t), 1))
+    signal[:, 2] += 30 * t / seconds                        # Slow room warm-up
+    if scenario == "nuisance":
+        signal[:, 0] += 250 * np.exp(-((t - onset - 5) / 2.0) ** 2)
+    elif scenario == "smoldering":
+        signal[:, 0] += 900 * ramp ** 1.5
+        signal[:, 1] += 600 * np.clip(ramp - 0.2, 0, 1)
+        signal[:, 2] += 60 * ramp
+    elif scenario == "flaming":
+        signal[:, 0] += 700 * np.clip(ramp * 3, 0, 1)
+        signal[:, 1] += 150 * ramp
+        signal[:, 2] += 1200 * np.clip(ramp * 2, 0, 1) ** 2
+
+    signal += rng.normal(0, 6, signal.shape) + 20 * np.sin(2 * np.pi * 50 * t)[:, None]
+    return np.clip(np.round(signal), 0, 4095).astype(np.uint16)
+
+
+def load_trace(path):
+    """CSV with time_s, smoke, co, temp (ADC counts, any rate) resampled to SAMPLE_HZ"""
+    with open(path, newline="") as f:
+        rows = [r for r in csv.reader(f) if r and not r[0].startswith("time")]
+    data = np.array(rows, dtype=np.float64)
+    t = np.arange(0, data[-1, 0] - data[0, 0], 1 / SAMPLE_HZ) + data[0, 0]
+    trace = np.stack([np.interp(t, data[:, 0], data[:, 1 + c]) for c in range(CHANNELS)], axis=1)
+    return np.clip(np.round(trace), 0, 4095).astype(np.uint16)
+
+
+def save_trace(path, trace):
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["time_s", *CHANNEL_NAMES])
+        for i, row in enumerate(trace):
+            writer.writerow([f"{i / SAMPLE_HZ:.3f}", *row])
+
+
+def reference_decimate(trace):
+    """CIC + FIR in NumPy integers: the outputs the firmware must produce (Q4 counts)"""
+    x = trace.astype(np.int64)
+    for _ in range(CIC_ORDER):
+        x = np.cumsum(x, axis=0)
+    x = x[CIC_DECIM - 1::CIC_DECIM]
+    for _ in range(CIC_ORDER):
+        x = np.diff(x, axis=0, prepend=np.zeros((1, CHANNELS), dtype=np.int64))
+    cic = x >> CIC_SHIFT
+
+    padded = np.vstack([np.zeros((FIR_TAPS - 1, CHANNELS), dtype=np.int64), cic])
+    outputs = []
+    for end in range(FIR_DECIM, len(cic) + 1, FIR_DECIM):
+        window = padded[end - 1:end - 1 + FIR_TAPS]
+        outputs.append(((FIR_Q15[:, None] * window).sum(axis=0) + (1 << 14)) >> 15)
+    return np.array(outputs)
+
+
+# ==================== FIRMWARE PATH ====================
+
+class NativeAnalog:
+    """Host build of analog_sensors.c fed like the circular DMA"""
+
+    def __init__(self):
+        self.lib = load_library("fire_analog", ["analog_sensors.c"])
+        acq_p = ctypes.POINTER(AnalogAcquisition)
+        self.lib.analog_init.argtypes = [acq_p, ctypes.c_void_p, ctypes.c_void_p]
+        self.lib.analog_init.restype = None
+        for name in ("analog_dma_half", "analog_dma_complete"):
+            getattr(self.lib, name).argtypes = [acq_p]
+            getattr(self.lib, name).restype = None
+        self.lib.analog_poll.argtypes = [acq_p]
+        self.lib.analog_poll.restype = ctypes.c_uint32
+
+        self.dma = np.zeros(DMA_SAMPLES, dtype=np.uint16)
+        self.acq = AnalogAcquisition()
+        self.lib.analog_init(ctypes.byref(self.acq), self.dma.ctypes.data, None)
+
+    def play(self, trace):
+        """Feed a trace one DMA half at a time; yields the decision after each half"""
+        half = HALF_FRAMES * CHANNELS
+        for block in range(len(trace) // HALF_FRAMES):
+            frames = trace[block * HALF_FRAMES:(block + 1) * HALF_FRAMES].ravel()
+            if block % 2 == 0:
+                self.dma[:half] = frames
+                self.lib.analog_dma_half(ctypes.byref(self.acq))
+            else:
+                self.dma[half:] = frames
+                self.lib.analog_dma_complete(ctypes.byref(self.acq))
+            self.lib.analog_poll(ctypes.byref(self.acq))
+            yield (block + 1) * HALF_FRAMES / SAMPLE_HZ, self.acq.decision
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Analog sensor trace player")
+    parser.add_argument("--trace", help="Recorded CSV (time_s, smoke, co, temp in ADC counts)")
+    parser.add_argument("--scenario", default="smoldering",
+                        choices=["quiet", "nuisance", "smoldering", "flaming"])
+    parser.add_argument("--seconds", type=float, default=60.0)
+    parser.add_argument("--save-trace", help="Write the synthetic trace as CSV")
+    parser.add_argument("--output", default=report_path("analog_report.json"))
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    if args.trace:
+        trace, source = load_trace(args.trace), args.trace
+    else:
+        trace = synthetic_trace(args.scenario, args.seconds, args.seed)
+        source = f"synthetic {args.scenario}"
+        if args.save_trace:
+            save_trace(args.save_trace, trace)
+
+    native = NativeAnalog()
+    print("=" * 60)
+    print("ANALOG TRACE PLAYER")
+    print("=" * 60)
+    print(f"Trace: {source} | {len(trace) / SAMPLE_HZ:.1f} s at {SAMPLE_HZ} Hz x {CHANNELS} channels | "
+          f"output {SAMPLE_HZ / DECIM:.3f} Hz")
+    print()
+
+    outputs, events, level = [], [], 0
+    for t, d in native.play(trace):
+        outputs.append(list(d.value))
+        if d.level != level:
+            channels = ",".join(n for c, n in enumerate(CHANNEL_NAMES) if d.channels >> c & 1) or "-"
+            print(f"  {t:7.2f} s  {LEVEL_NAMES[level]:>5} -> {LEVEL_NAMES[d.level]:<5} ({channels}) "
+                  f"rise {[r // 16 for r in d.rise]} slope {[s // 16 for s in d.slope]}")
+            events.append({"time_s": t, "level": LEVEL_NAMES[d.level], "channels": channels})
+            level = d.level
+
+    outputs = np.array(outputs)
+    reference = reference_decimate(trace)[:len(outputs)]
+    mismatches = int((outputs != reference).any(axis=1).sum())
+
+    # Noise and 50 Hz pickup left after decimation (settled part, Q4 -> counts)
+    settled = outputs[SLOPE_WINDOW:] / 16.0
+    jitter = np.abs(np.diff(settled, axis=0)).mean(axis=0) if len(settled) > 1 else np.zeros(CHANNELS)
+
+    print()
+    if not events:
+        print("  no wake-ups: vision stays at the idle rate")
+    print(f"Outputs: {len(outputs)} | dropped {native.acq.dropped} | "
+          f"output-to-output jitter {', '.join(f'{n} {j:.2f}' for n, j in zip(CHANNEL_NAMES, jitter))} counts")
+    mark = "✓" if mismatches == 0 else "⚠"
+    print(f"{mark} Decimation vs NumPy reference: {mismatches} mismatching outputs")
+
+    report = {
+        "source": source,
+        "seconds": len(trace) / SAMPLE_HZ,
+        "outputs": len(outputs),
+        "events": events,
+        "first_watch_s": next((e["time_s"] for e in events if e["level"] != "quiet"), None),
+        "first_alarm_s": next((e["time_s"] for e in events if e["level"] == "ALARM"), None),
+        "mismatches": mismatches,
+        "dropped": native.acq.dropped,
+    }
+    Path(args.output).write_text(json.dumps(report, indent=2))
+    print(f"Report: {args.output}")
+    return 0 if mismatches == 0 else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,589 @@
+"""
+Audio Crackle Model
+Host side of the firmware's audio path (audio_frontend.c, host build):
+checks the fixed-point log-mel features against a float reference and the
+PDM decimation against the PCM path, trains the small crackle classifier
+the firmware runs on the int8 engine, and plays WAV files through the
+front-end + classifier the way the main loop schedules them
+"""
+
+import argparse
+import ctypes
+import json
+import time
+import wave
+from pathlib import Path
+
+import numpy as np
+
+from engine_model import EngineQuantizer, float_forward, load_checkpoint, random_layers, \
+    save_checkpoint, write_model_source
+from native_build import load_library, report_path
+from native_engine import NativeFireEngine
+
+
+# audio_frontend.h
+SAMPLE_HZ = 16000
+PDM_DECIM, PDM_ORDER = 64, 3
+PDM_TAPS = PDM_ORDER * (PDM_DECIM - 1) + 1
+PDM_WINDOW_BYTES = (PDM_TAPS + 7) // 8
+PDM_HOP_BYTES = PDM_DECIM // 8
+PDM_DMA_BYTES = 512
+FFT_SIZE, HOP = 512, 256
+BINS = FFT_SIZE // 2 + 1
+MEL_BANDS = 32
+MEL_WEIGHTS = 2 * BINS
+LOG_FLOOR = 100
+FEATURE_FRAMES = 32
+PCM_RING = 2048
+INPUT_SHAPE = (FEATURE_FRAMES, MEL_BANDS, 1)
+CLIP_SAMPLES = FFT_SIZE + (FEATURE_FRAMES - 1) * HOP   # One classifier window
+
+# main.c
+CLASSIFY_HOPS = 16                     # AUDIO_CLASSIFY_HOPS: one classification per 256 ms
+VISION_ACTIVE_MS = 100                 # Frame budget the audio work shares with vision
+
+# Front-end M7 cost model (cycles), from the instruction mix of the Q15 loops
+M7_FRONTEND = {
+    "pdm_byte": 2,                     # LUT load + add per window byte
+    "pdm_sample": 12,                  # Scale, DC blocker, ring store
+    "window": 6,                       # Per frame sample: multiply, peak, scale
+    "butterfly": 12,                   # Radix-2 Q15 butterfly
+    "split": 16,                       # Real split + power per bin
+    "mel": 3,                          # Multiply-accumulate per mel weight
+    "log": 12,                         # Per band
+}
+M7_CLOCK_HZ = 480e6
+
+
+class AudioMelBand(ctypes.Structure):
+    _fields_ = [("first_bin", ctypes.c_uint16), ("bins", ctypes.c_uint16),
+                ("weights", ctypes.c_uint16)]
+
+
+class AudioFrontEnd(ctypes.Structure):
+    """Mirror of AudioFrontEnd (audio_frontend.h)"""
+    _fields_ = [
+        ("pdm_lut", (ctypes.c_uint16 * 256) * PDM_WINDOW_BYTES),
+        ("pdm_tail", ctypes.c_uint8 * (PDM_WINDOW_BYTES - PDM_HOP_BYTES)),
+        ("dc_x", ctypes.c_int32),
+        ("dc_y", ctypes.c_int32),
+        ("pcm", ctypes.c_int16 * PCM_RING),
+        ("pcm_head", ctypes.c_uint32),
+        ("pcm_frame", ctypes.c_uint32),
+        ("window", ctypes.c_int16 * FFT_SIZE),
+        ("twiddle", (ctypes.c_int16 * 2) * (FFT_SIZE // 2)),
+        ("mel", AudioMelBand * MEL_BANDS),
+        ("mel_weights", ctypes.c_int16 * MEL_WEIGHTS),
+        ("fft", ctypes.c_int16 * FFT_SIZE),
+        ("power", ctypes.c_uint32 * BINS),
+        ("features", (ctypes.c_uint8 * MEL_BANDS) * (2 * FEATURE_FRAMES)),
+        ("feature_pos", ctypes.c_uint32),
+        ("hops", ctypes.c_uint32),
+        ("overruns", ctypes.c_uint32),
+    ]
+
+
+# ==================== FIRMWARE PATH ====================
+
+class NativeAudio:
+    """Host build of audio_frontend.c"""
+
+    def __init__(self):
+        self.lib = load_library("fire_audio", ["audio_frontend.c"])
+        fe_p = ctypes.POINTER(AudioFrontEnd)
+        self.lib.audio_init.argtypes = [fe_p]
+        self.lib.audio_init.restype = None
+        for name in ("audio_pdm_push", "audio_push_pcm"):
+            getattr(self.lib, name).argtypes = [fe_p, ctypes.c_void_p, ctypes.c_uint32]
+            getattr(self.lib, name).restype = None
+        self.lib.audio_process.argtypes = [fe_p]
+        self.lib.audio_process.restype = ctypes.c_uint32
+        self.lib.audio_features.argtypes = [fe_p]
+        self.lib.audio_features.restype = ctypes.c_void_p
+
+        self.fe = AudioFrontEnd()
+        self.reset()
+
+    def reset(self):
+        self.lib.audio_init(ctypes.byref(self.fe))
+
+    def window(self):
+        """Classifier input: the latest FEATURE_FRAMES rows, oldest first"""
+        addr = self.lib.audio_features(ctypes.byref(self.fe))
+        data = (ctypes.c_uint8 * (FEATURE_FRAMES * MEL_BANDS)).from_address(addr)
+        return np.frombuffer(data, dtype=np.uint8).reshape(FEATURE_FRAMES, MEL_BANDS).copy()
+
+    def stream(self, pcm=None, pdm=None):
+        """
+        Feed 16 kHz PCM in hop-sized blocks, or a PDM byte stream one DMA
+        half at a time, processing after every block like the main loop
+        Yields (PCM samples so far, new feature row) for every hop.
+        """
+        if pdm is not None:
+            half = PDM_DMA_BYTES // 2
+            blocks = (pdm[i:i + half] for i in range(0, len(pdm) - half + 1, half))
+            push = self.lib.audio_pdm_push
+        else:
+            blocks = (pcm[i:i + HOP] for i in range(0, len(pcm), HOP))
+            push = self.lib.audio_push_pcm
+
+        for block in blocks:
+            block = np.ascontiguousarray(block)
+            push(ctypes.byref(self.fe), block.ctypes.data, len(block))
+            # Blocks are at most one hop: at most one new row per call
+            if self.lib.audio_process(ctypes.byref(self.fe)):
+                row = np.array(self.fe.features[(self.fe.feature_pos - 1) % FEATURE_FRAMES])
+                yield self.fe.pcm_head, row
+
+    def rows(self, pcm=None, pdm=None):
+        """Every feature row of a clip from a fresh front-end, (hops, MEL_BANDS) uint8"""
+        self.reset()
+        rows = [row for _, row in self.stream(pcm, pdm)]
+        return np.array(rows, dtype=np.uint8).reshape(-1, MEL_BANDS)
+
+
+def reference_rows(pcm, fe):
+    """
+    Float log-mel features from the front-end's own window and mel tables:
+    feature = 8 * log2(sum(w_q15 * |rfft(pcm * window)|^2) / 65536) - LOG_FLOOR,
+    the value the Q15 FFT (output scaled by 1/256) and log2_q3 approximate
+    """
+    window = np.array(fe.window, dtype=np.float64) / 32768
+    weights = np.array(fe.mel_weights, dtype=np.float64)
+    x = pcm.astype(np.float64)
+    rows = []
+    for start in range(0, len(x) - FFT_SIZE + 1, HOP):
+        power = np.abs(np.fft.rfft(x[start:start + FFT_SIZE] * window)) ** 2 / 65536
+        row = []
+        for band in fe.mel:
+            w = weights[band.weights:band.weights + band.bins]
+            energy = (w * power[band.first_bin:band.first_bin + band.bins]).sum()
+            row.append(8 * np.log2(energy) - LOG_FLOOR if energy > 0 else 0.0)
+        rows.append(row)
+    return np.clip(np.array(rows), 0, 255)
+
+
+def cic_shape(pcm):
+    """
+    PCM as the PDM path delivers it: the sinc^3 decimator's passband droop
+    (-10 dB at the top mel band) applied with a zero-phase FFT filter, so
+    WAV features match what the microphone produces
+    """
+    n = len(pcm)
+    f = np.fft.rfftfreq(n, 1 / SAMPLE_HZ) / (SAMPLE_HZ * PDM_DECIM)
+    response = np.ones_like(f)
+    nz = f > 0
+    response[nz] = (np.sin(np.pi * f[nz] * PDM_DECIM) / (PDM_DECIM * np.sin(np.pi * f[nz]))) ** PDM_ORDER
+    shaped = np.fft.irfft(np.fft.rfft(pcm.astype(np.float64)) * response, n)
+    return np.clip(np.round(shaped), -32768, 32767).astype(np.int16)
+
+
+def pdm_modulate(pcm):
+    """
+    2nd-order sigma-delta at PDM_DECIM x 16 kHz: a PDM microphone's bit
+    stream for the clip, packed MSB (first bit) first. Band-limited
+    upsampling; keep the level below -6 dBFS for a stable modulator.
+    """
+    n = len(pcm)
+    spectrum = np.fft.rfft(pcm.astype(np.float64) / 32768)
+    up = np.fft.irfft(spectrum, n * PDM_DECIM) * PDM_DECIM
+
+    bits = np.empty(len(up), dtype=np.uint8)
+    i1 = i2 = 0.0
+    y = -1.0
+    for k, v in enumerate(up.tolist()):
+        i1 += v - y
+        i2 += i1 - y
+        y = 1.0 if i2 >= 0 else -1.0
+        bits[k] = y > 0
+    return np.packbits(bits)
+
+
+# ==================== AUDIO ====================
+
+def load_wav(path):
+    """16-bit PCM WAV (any rate, channels averaged) resampled to SAMPLE_HZ"""
+    with wave.open(str(path), "rb") as w:
+        if w.getsampwidth() != 2:
+            raise ValueError(f"{path}: only 16-bit PCM WAV is supported")
+        rate, channels = w.getframerate(), w.getnchannels()
+        data = np.frombuffer(w.readframes(w.getnframes()), dtype="<i2").astype(np.float64)
+    data = data.reshape(-1, channels).mean(axis=1)
+    if rate != SAMPLE_HZ:
+        t = np.arange(0, len(data) / rate, 1 / SAMPLE_HZ)
+        data = np.interp(t, np.arange(len(data)) / rate, data)
+    return np.clip(np.round(data), -32768, 32767).astype(np.int16)
+
+
+def save_wav(path, pcm):
+    with wave.open(str(path), "wb") as w:
+        w.setnchannels(1)
+        w.setsampwidth(2)
+        w.setframerate(SAMPLE_HZ)
+        w.writeframes(pcm.astype("<i2").tobytes())
+
+
+def colored_noise(rng, n, slope):
+    """Noise with power ~ f^-slope (0 white, 1 pink, 2 brown), unit RMS"""
+    spectrum = np.fft.rfft(rng.normal(size=n))
+    f = np.arange(len(spectrum), dtype=np.float64)
+    f[0] = 1.0
+    x = np.fft.irfft(spectrum / f ** (slope / 2), n)
+    return x / (x.std() + 1e-12)
+
+
+def background(rng, n):
+    """
+    Room sound without fire: HVAC / traffic rumble, mains hum, fan tone,
+    babble, and sometimes tapping (isolated resonant clicks, the closest
+    confuser of crackle). Float, full scale 1.0.
+    """
+    t = np.arange(n) / SAMPLE_HZ
+    x = colored_noise(rng, n, rng.uniform(0.5, 2.0)) * 10 ** rng.uniform(-3.0, -1.5)
+    mains = rng.choice([50.0, 60.0])
+    for h in range(1, 4):
+        x += 10 ** rng.uniform(-4.0, -2.5) * np.sin(2 * np.pi * mains * h * t + rng.uniform(0, 6.3))
+    x += 10 ** rng.uniform(-4.0, -2.5) * np.sin(2 * np.pi * rng.uniform(200, 2000) * t)
+
+    if rng.random() < 0.5:  # Babble: harmonic voices with syllable-rate envelopes
+        for _ in range(rng.integers(1, 4)):
+            f0 = rng.uniform(90, 250)
+            envelope = np.clip(np.sin(2 * np.pi * rng.uniform(2, 6) * t + rng.uniform(0, 6.3)), 0, None)
+            voice = sum(np.sin(2 * np.pi * f0 * h * t) / h for h in range(1, 12) if f0 * h < 4000)
+            x += 10 ** rng.uniform(-2.5, -1.3) * envelope * voice / 3
+
+    if rng.random() < 0.3:  # Tapping / typing: regular, tonal clicks
+        period = rng.uniform(0.12, 0.3)
+        tone = rng.uniform(800, 3000)
+        for onset in np.arange(rng.uniform(0, period), n / SAMPLE_HZ, period):
+            x += click(rng, n, onset, 10 ** rng.uniform(-2.0, -1.0), tonal=tone)
+    return x
+
+
+def click(rng, n, onset, amplitude, tonal=None):
+    """One decaying impulse at onset (s): broadband burst, or a ringing tone"""
+    x = np.zeros(n)
+    start = int(onset * SAMPLE_HZ)
+    length = int(rng.uniform(0.0005, 0.004) * SAMPLE_HZ) + 8
+    if start >= n:
+        return x
+    k = np.arange(min(length, n - start))
+    decay = np.exp(-k / (length / 4))
+    if tonal:
+        burst = np.sin(2 * np.pi * tonal * k / SAMPLE_HZ)
+    else:
+        burst = np.diff(rng.normal(size=len(k) + 1))  # Emphasize the highs like a snap
+    x[start:start + len(k)] = amplitude * decay * burst / (np.abs(burst).max() + 1e-12)
+    return x
+
+
+def crackle(rng, n):
+    """
+    Burning wood / cable insulation: irregular broadband pops 8-32 dB above
+    the room sound's RMS
+    """
+    x = background(rng, n)
+    level = x.std()
+    rate = rng.uniform(6, 60)
+    onsets = np.cumsum(rng.exponential(1 / rate, int(rate * n / SAMPLE_HZ * 2) + 4))
+    for onset in onsets[onsets < n / SAMPLE_HZ]:
+        x += click(rng, n, onset, min(0.7, level * 10 ** rng.uniform(0.4, 1.6)))
+    if rng.random() < 0.5:  # Roar of the flame: low-frequency turbulence
+        x += colored_noise(rng, n, 2.0) * 10 ** rng.uniform(-2.5, -1.5)
+    return x
+
+
+def to_pcm(x):
+    return np.clip(np.round(x * 32767), -32768, 32767).astype(np.int16)
+
+
+def synthetic_stream(seconds, seed=0):
+    """Room sound, crackle starting halfway"""
+    rng = np.random.default_rng(seed)
+    n = int(seconds * SAMPLE_HZ)
+    x = background(rng, n)
+    half = n // 2
+    x[half:] = crackle(rng, n - half)
+    return to_pcm(x)
+
+
+def dataset(native, clips, seed):
+    """Feature windows (N, 32, 32, 1) in 0-1 and labels (1 = crackle) from synthetic clips"""
+    rng = np.random.default_rng(seed)
+    x, y = [], []
+    for i in range(clips):
+        label = i % 2
+        clip = (crackle if label else background)(rng, CLIP_SAMPLES)
+        rows = native.rows(cic_shape(to_pcm(clip)))
+        x.append(rows[-FEATURE_FRAMES:])
+        y.append(label)
+    x = np.array(x, dtype=np.float32)[..., None] / 255.0
+    return x, np.array(y)
+
+
+# ==================== CLASSIFIER ====================
+
+def im2col(x):
+    """3x3 same-padded patches (N, H, W, 9 * C), ordered like conv weights (ky, kx, c)"""
+    n, h, w, c = x.shape
+    padded = np.pad(x, ((0, 0), (1, 1), (1, 1), (0, 0)))
+    return np.concatenate([padded[:, ky:ky + h, kx:kx + w] for ky in range(3) for kx in range(3)], axis=3)
+
+
+def col2im(d, channels):
+    """Gradient of im2col: sum patch gradients back onto the input"""
+    n, h, w, _ = d.shape
+    padded = np.zeros((n, h + 2, w + 2, channels), dtype=d.dtype)
+    for i, (ky, kx) in enumerate((ky, kx) for ky in range(3) for kx in range(3)):
+        padded[:, ky:ky + h, kx:kx + w] += d[..., i * channels:(i + 1) * channels]
+    return padded[:, 1:-1, 1:-1]
+
+
+def train_classifier(x, y, filters=(8, 16), epochs=30, seed=0):
+    """
+    conv3x3 + relu + maxpool per entry of filters, global average pool,
+    Dense(2): the engine's create_model() pattern at a size that suits a
+    time x mel window (pops are short broadband columns anywhere in it).
+    Adam on softmax cross-entropy in NumPy; returns float layers for the
+    engine quantizer.
+    """
+    rng = np.random.default_rng(seed)
+    params, channels = [], x.shape[3]
+    for f in filters:
+        params += [rng.normal(0, np.sqrt(2 / (9 * channels)), (3, 3, channels, f)).astype(np.float32),
+                   np.zeros(f, np.float32)]
+        channels = f
+    params += [rng.normal(0, np.sqrt(1 / channels), (channels, 2)).astype(np.float32), np.zeros(2, np.float32)]
+    moments = [[np.zeros_like(p), np.zeros_like(p)] for p in params]
+    lr, beta1, beta2, step = 3e-3, 0.9, 0.999, 0
+
+    for _ in range(epochs):
+        order = rng.permutation(len(x))
+        for i in range(0, len(order), 32):
+            batch = order[i:i + 32]
+            a, cache = x[batch], []
+            for j in range(len(filters)):
+                w, b = params[2 * j], params[2 * j + 1]
+                cols = im2col(a)
+                z = np.maximum(cols @ w.reshape(-1, w.shape[3]) + b, 0)
+                n, h, wd, c = z.shape
+                pooled = z.reshape(n, h // 2, 2, wd // 2, 2, c).max(axis=(2, 4))
+                cache.append((a, cols, z, pooled))
+                a = pooled
+            features = a.mean(axis=(1, 2))
+            logits = features @ params[-2] + params[-1]
+
+            p = np.exp(logits - logits.max(axis=1, keepdims=True))
+            p /= p.sum(axis=1, keepdims=True)
+            p[np.arange(len(batch)), y[batch]] -= 1
+            d_logits = p / len(batch)
+            grads = [features.T @ d_logits, d_logits.sum(axis=0)]
+            d = np.broadcast_to((d_logits @ params[-2].T)[:, None, None, :], a.shape) / (a.shape[1] * a.shape[2])
+
+            for j in reversed(range(len(filters))):
+                inp, cols, z, pooled = cache[j]
+                n, h, wd, c = z.shape
+                up = lambda t: t.repeat(2, axis=1).repeat(2, axis=2)
+                d_z = up(d) * (z == up(pooled)) * (z > 0)
+                w = params[2 * j]
+                grads = [(cols.reshape(-1, cols.shape[3]).T @ d_z.reshape(-1, c)).reshape(w.shape),
+                         d_z.sum(axis=(0, 1, 2))] + grads
+                if j:
+                    d = col2im(d_z @ w.reshape(-1, c).T, inp.shape[3])
+
+            step += 1
+            for param, grad, m in zip(params, grads, moments):
+                m[0] = beta1 * m[0] + (1 - beta1) * grad
+                m[1] = beta2 * m[1] + (1 - beta2) * grad ** 2
+                param -= (lr * (m[0] / (1 - beta1 ** step)) /
+                          (np.sqrt(m[1] / (1 - beta2 ** step)) + 1e-8)).astype(np.float32)
+
+    layers = []
+    for j in range(len(filters)):
+        layers += [{"op": "conv", "w": params[2 * j], "b": params[2 * j + 1], "relu": True},
+                   {"op": "maxpool"}]
+    return layers + [{"op": "gap"}, {"op": "dense", "w": params[-2], "b": params[-1], "relu": False}]
+
+
+def frontend_m7_cycles(fe):
+    """M7 cycles of the front-end: (per PCM sample in the PDM interrupt, per hop in the main loop)"""
+    c = M7_FRONTEND
+    points = FFT_SIZE // 2
+    per_sample = PDM_WINDOW_BYTES * c["pdm_byte"] + c["pdm_sample"]
+    per_hop = (FFT_SIZE * c["window"] +
+               points // 2 * int(np.log2(points)) * c["butterfly"] +
+               points * c["split"] +
+               sum(b.bins for b in fe.mel) * c["mel"] +
+               MEL_BANDS * c["log"])
+    return per_sample, per_hop
+
+
+def vision_m7_ms(seed=0):
+    """Default create_model() pattern at 32x32x1 (the vision model's cost when none is given)"""
+    shape = (32, 32, 1)
+    calibration = np.random.default_rng(seed).random((16, *shape)).astype(np.float32)
+    return EngineQuantizer().quantize(random_layers(shape, seed=seed), shape, calibration).m7_latency_ms()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Audio crackle model: front-end check, training, playback")
+    parser.add_argument("--wav", nargs="*", default=[], help="16-bit WAV files to play (default: synthetic)")
+    parser.add_argument("--seconds", type=float, default=10.0, help="Synthetic stream length")
+    parser.add_argument("--save-wav", help="Write the synthetic stream as WAV")
+    parser.add_argument("--pdm-seconds", type=float, default=1.0,
+                        help="Audio checked through the sigma-delta + PDM decimation path")
+    parser.add_argument("--clips", type=int, default=1200, help="Synthetic training clips")
+    parser.add_argument("--checkpoint", help="Load the classifier from a .npz instead of training")
+    parser.add_argument("--save-checkpoint", help="Write the trained classifier (.npz)")
+    parser.add_argument("--emit", help="Directory for audio_model_data.c")
+    parser.add_argument("--threshold", type=float, default=0.7)
+    parser.add_argument("--vision-ms", type=float, help="Vision model M7 latency (default: cost model)")
+    parser.add_argument("--output", default=report_path("audio_report.json"))
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    native = NativeAudio()
+    if args.wav:
+        streams = [(path, load_wav(path)) for path in args.wav]
+    else:
+        pcm = synthetic_stream(args.seconds, args.seed)
+        streams = [(f"synthetic ({args.seconds:.0f} s, crackle from {args.seconds / 2:.0f} s)", pcm)]
+        if args.save_wav:
+            save_wav(args.save_wav, pcm)
+
+    print("=" * 60)
+    print("AUDIO CRACKLE MODEL")
+    print("=" * 60)
+    print(f"Front-end: {SAMPLE_HZ} Hz, FFT {FFT_SIZE} / hop {HOP} ({HOP * 1000 // SAMPLE_HZ} ms), "
+          f"{MEL_BANDS} mel bands | window {FEATURE_FRAMES} hops "
+          f"({CLIP_SAMPLES / SAMPLE_HZ:.2f} s) | front-end state {ctypes.sizeof(AudioFrontEnd)} bytes")
+    print()
+
+    # Fixed-point features vs float reference, PDM path vs PCM path
+    first = streams[0][1]
+    fixed = native.rows(first).astype(np.float64)
+    reference = reference_rows(first, native.fe)[:len(fixed)]
+    live = (reference > 4) & (reference < 251)  # Not clamped on either side
+    feature_error = np.abs(fixed - reference)[live]
+    feature_ok = bool(feature_error.size == 0 or feature_error.mean() < 1.0)
+    mark = "✓" if feature_ok else "⚠"
+    print(f"{mark} Q15 features vs float reference: mean {feature_error.mean():.2f}, "
+          f"p99 {np.percentile(feature_error, 99):.1f}, max {feature_error.max():.0f} "
+          f"(1/8 octave units, {feature_error.size} values)")
+
+    segment = first[:int(args.pdm_seconds * SAMPLE_HZ) // HOP * HOP]
+    pdm_error = np.zeros(0)
+    if len(segment) >= CLIP_SAMPLES // 2:
+        gain = min(1.0, 16384 / max(1, int(np.abs(segment.astype(np.int32)).max())))
+        segment = np.round(segment * gain).astype(np.int16)
+        from_pdm = native.rows(pdm=pdm_modulate(segment)).astype(np.float64)
+        from_pcm = native.rows(cic_shape(segment)).astype(np.float64)
+        count = min(len(from_pdm), len(from_pcm))
+        both = (from_pcm[:count] > 4) & (from_pcm[:count] < 251)
+        pdm_error = np.abs(from_pdm[:count] - from_pcm[:count])[both]
+    pdm_ok = bool(pdm_error.size == 0 or pdm_error.mean() < 3.0)
+    if pdm_error.size:
+        mark = "✓" if pdm_ok else "⚠"
+        print(f"{mark} PDM decimation vs PCM path: mean {pdm_error.mean():.2f}, "
+              f"p99 {np.percentile(pdm_error, 99):.1f} ({args.pdm_seconds:.1f} s through a "
+              f"2nd-order sigma-delta)")
+    print()
+
+    # Classifier
+    if args.checkpoint:
+        layers, _ = load_checkpoint(args.checkpoint)
+        x_test, y_test = dataset(native, 400, args.seed + 2)
+        calibration = x_test[:128]
+        print(f"Classifier: {args.checkpoint}")
+    else:
+        x_train, y_train = dataset(native, args.clips, args.seed + 1)
+        x_test, y_test = dataset(native, max(200, args.clips // 3), args.seed + 2)
+        layers = train_classifier(x_train, y_train, seed=args.seed)
+        calibration = x_train[:256]
+        print(f"Classifier: 2x (conv3x3 + pool) + GAP + Dense(2) on {FEATURE_FRAMES}x{MEL_BANDS} "
+              f"log-mel, trained on {len(x_train)} synthetic clips")
+        if args.save_checkpoint:
+            save_checkpoint(args.save_checkpoint, layers, {"input_shape": list(INPUT_SHAPE)})
+
+    model = EngineQuantizer().quantize(layers, INPUT_SHAPE, calibration)
+    blob = model.to_bytes()
+    float_acc = float((float_forward(layers, x_test)[-1].reshape(len(x_test), -1).argmax(axis=1) == y_test).mean())
+    int8_acc = float((model.run(x_test).argmax(axis=1) == y_test).mean())
+
+    engine = NativeFireEngine()
+    ctx = engine.create_context(blob, INPUT_SHAPE, args.threshold)
+    images = np.round(x_test[..., 0] * 255).astype(np.uint8)
+    native_p = np.array([engine.infer_image(ctx, image) for image in images])
+    native_acc = float(((native_p >= 0.5) == y_test).mean())
+    print(f"  accuracy: float {float_acc:.1%} | int8 reference {int8_acc:.1%} | "
+          f"native engine {native_acc:.1%} ({len(y_test)} held-out clips)")
+    print(f"  image {len(blob)} bytes | {model.macs()} MACs | M7 {model.m7_latency_ms():.3f} ms")
+    print()
+
+    # Playback: classify every CLASSIFY_HOPS hops like the main loop
+    timeline = []
+    for name, pcm in streams:
+        print(f"Stream: {name} | {len(pcm) / SAMPLE_HZ:.1f} s")
+        native.reset()
+        active, start = False, time.perf_counter()
+        for samples, _ in native.stream(cic_shape(pcm)):
+            hops = native.fe.hops
+            if hops < FEATURE_FRAMES or hops % CLASSIFY_HOPS:
+                continue
+            p = float(engine.infer_image(ctx, native.window()))
+            t = samples / SAMPLE_HZ
+            timeline.append({"stream": name, "time_s": round(t, 3), "crackle": round(p, 3)})
+            if (p >= args.threshold) != active:
+                active = not active
+                print(f"  {t:7.2f} s  crackle {'ON ' if active else 'off'} (p {p:.2f})")
+        host_ms = (time.perf_counter() - start) * 1000
+        hits = sum(e["crackle"] >= args.threshold for e in timeline if e["stream"] == name)
+        print(f"  {hits} crackle windows | host {host_ms / max(1, native.fe.hops) * 1000:.0f} us "
+              f"per hop incl. classification")
+    print()
+
+    # CPU budget per vision frame
+    per_sample, per_hop = frontend_m7_cycles(native.fe)
+    frame_s = VISION_ACTIVE_MS / 1000
+    pdm_ms = per_sample * SAMPLE_HZ * frame_s / M7_CLOCK_HZ * 1000
+    hop_ms = per_hop * (SAMPLE_HZ * frame_s / HOP) / M7_CLOCK_HZ * 1000
+    classify_ms = model.m7_latency_ms() * (SAMPLE_HZ * frame_s / HOP) / CLASSIFY_HOPS
+    vision_ms = args.vision_ms if args.vision_ms is not None else vision_m7_ms(args.seed)
+    audio_ms = pdm_ms + hop_ms + classify_ms
+    total_ms = audio_ms + vision_ms
+    budget_ok = total_ms < VISION_ACTIVE_MS
+    print(f"Budget per {VISION_ACTIVE_MS} ms vision frame (M7 at {M7_CLOCK_HZ / 1e6:.0f} MHz):")
+    print(f"  PDM decimation   {pdm_ms:6.2f} ms ({per_sample} cycles/sample)")
+    print(f"  log-mel frames   {hop_ms:6.2f} ms ({per_hop} cycles/hop)")
+    print(f"  classifier       {classify_ms:6.2f} ms (1 in {CLASSIFY_HOPS} hops)")
+    print(f"  vision model     {vision_ms:6.2f} ms")
+    mark = "✓" if budget_ok else "⚠"
+    print(f"{mark} Total {total_ms:.2f} ms ({total_ms / VISION_ACTIVE_MS:.0%}), audio {audio_ms:.2f} ms")
+
+    if args.emit:
+        out = Path(args.emit)
+        out.mkdir(parents=True, exist_ok=True)
+        path = write_model_source(blob, out / "audio_model_data.c", "CrackleAudioV1", INPUT_SHAPE,
+                                  args.threshold, source="audio_crackle_model.py",
+                                  kind="engine (FDM1) audio model", prefix="audio_")
+        print(f"Model source: {path}")
+
+    report = {
+        "streams": [name for name, _ in streams],
+        "feature_error_mean": float(feature_error.mean()) if feature_error.size else 0.0,
+        "pdm_error_mean": float(pdm_error.mean()) if pdm_error.size else None,
+        "accuracy": {"float": float_acc, "int8": int8_acc, "native": native_acc},
+        "model_bytes": len(blob),
+        "classifier_m7_ms": model.m7_latency_ms(),
+        "frame_budget_ms": {"pdm": pdm_ms, "features": hop_ms, "classifier": classify_ms,
+                            "vision": vision_ms, "total": total_ms},
+        "timeline": timeline,
+    }
+    Path(args.output).write_text(json.dumps(report, indent=2))
+    print(f"Report: {args.output}")
+    return 0 if feature_ok and pdm_ok and budget_ok and native_acc >= 0.8 else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,267 @@
+"""
+Cache Maintenance Checker
+Replay the firmware's DMA flows (thermal I2C frames, analog ADC circular
+buffer, PDM microphone) against the checker build of ai_memory.c, which
+models the Cortex-M7 D-cache line by line, and fail on any DMA <-> CPU
+handoff that is missing its clean or invalidate. Negative controls make
+sure the checker still catches each class of mistake.
+"""
+
+import argparse
+import ctypes
+import json
+
+import numpy as np
+
+from analog_trace_player import AnalogAcquisition, DMA_SAMPLES, HALF_FRAMES, CHANNELS
+from audio_crackle_model import AudioFrontEnd, PDM_DMA_BYTES
+from native_build import load_library, report_path
+from thermal_emulator import ThermalSensor, FRAME_WORDS, synthetic_calibration, synthetic_scene, \
+    encode_frame, to_ctypes
+
+
+CACHE_LINE = 32                      # AI_CACHE_LINE in the checker build
+FRAME_BYTES = 2 * FRAME_WORDS
+
+SOURCES = ["ai_memory.c", "thermal_sensor.c", "analog_sensors.c", "audio_frontend.c"]
+
+READ_DMA = ctypes.CFUNCTYPE(ctypes.c_int32, ctypes.c_void_p, ctypes.c_uint16, ctypes.c_void_p, ctypes.c_uint16)
+
+
+class ThermalBusOps(ctypes.Structure):
+    _fields_ = [("read_dma", READ_DMA), ("user", ctypes.c_void_p)]
+
+
+def dma_array(nbytes, offset=0):
+    """Zeroed bytes at a cache-line boundary (+ offset), like AI_DMA_BUFFER"""
+    raw = np.zeros(nbytes + offset + 2 * CACHE_LINE, dtype=np.uint8)
+    start = (-raw.ctypes.data) % CACHE_LINE + offset
+    return raw[start:start + nbytes]
+
+
+class CacheChecker:
+    """Checker build (-DAI_CACHE_CHECK) of the modules that own DMA buffers"""
+
+    def __init__(self):
+        self.lib = lib = load_library("fire_cache_check", SOURCES, ["-DAI_CACHE_CHECK"])
+        range_fns = ["ai_cache_receive", "ai_cache_invalidate", "ai_cache_clean", "ai_cache_cpu_read",
+                     "ai_cache_cpu_write", "ai_dma_declare", "ai_dma_device_write", "ai_dma_device_read"]
+        for name in range_fns:
+            getattr(lib, name).argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+            getattr(lib, name).restype = None
+        lib.ai_cache_violations.restype = ctypes.c_uint32
+        lib.ai_cache_last_violation.restype = ctypes.c_char_p
+        lib.ai_cache_check_reset.restype = None
+
+        for name in ("thermal_init", "thermal_start_read", "thermal_process"):
+            getattr(lib, name).restype = ctypes.c_int32
+        lib.thermal_init.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.POINTER(ThermalBusOps)]
+        lib.thermal_start_read.argtypes = [ctypes.c_void_p]
+        lib.thermal_dma_complete.argtypes = [ctypes.c_void_p]
+        lib.thermal_dma_complete.restype = None
+        lib.thermal_process.argtypes = [ctypes.c_void_p]
+
+        lib.analog_init.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p]
+        lib.analog_init.restype = None
+        for name in ("analog_dma_half", "analog_dma_complete"):
+            getattr(lib, name).argtypes = [ctypes.c_void_p]
+            getattr(lib, name).restype = None
+        lib.analog_poll.argtypes = [ctypes.c_void_p]
+        lib.analog_poll.restype = ctypes.c_uint32
+
+        lib.audio_init.argtypes = [ctypes.c_void_p]
+        lib.audio_init.restype = None
+        lib.audio_pdm_push.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint32]
+        lib.audio_pdm_push.restype = None
+        lib.audio_process.argtypes = [ctypes.c_void_p]
+        lib.audio_process.restype = ctypes.c_uint32
+
+    def reset(self):
+        self.lib.ai_cache_check_reset()
+
+    def result(self):
+        return self.lib.ai_cache_violations(), self.lib.ai_cache_last_violation().decode()
+
+    def device_write(self, dst, data):
+        """The DMA engine writes memory behind the cache"""
+        self.lib.ai_dma_device_write(dst.ctypes.data, dst.nbytes)
+        dst[:] = data
+
+
+# ==================== FIRMWARE FLOWS ====================
+# Host side exactly as main.c drives each peripheral: the buffers are
+# declared dirty (startup zeroing), completions call the modules' handlers
+
+def thermal_flow(checker, frames, seed=0):
+    """I2C DMA into the double-buffered raw frames, converted by thermal_process()"""
+    lib = checker.lib
+    memory = dma_array(ctypes.sizeof(ThermalSensor))
+    sensor = ThermalSensor.from_buffer(memory)
+    rng = np.random.default_rng(seed)
+    calibration = synthetic_calibration(seed)
+    cal = to_ctypes(calibration)
+    pending = []
+
+    def read_dma(user, reg, dst, length):
+        pending.append((dst, length))
+        return 0
+
+    bus = ThermalBusOps(READ_DMA(read_dma), None)
+    if lib.thermal_init(ctypes.addressof(sensor), ctypes.byref(cal), ctypes.byref(bus)) != 0:
+        raise RuntimeError("thermal_init failed")
+    lib.ai_dma_declare(ctypes.addressof(sensor.raw), ctypes.sizeof(sensor.raw))
+
+    converted = 0
+    for i in range(frames):
+        # Frame loop: start the next read, the transfer completes, convert
+        lib.thermal_start_read(ctypes.addressof(sensor))
+        dst, length = pending.pop()
+        scene, ambient = synthetic_scene(i, frames, rng)
+        frame = np.frombuffer(encode_frame(calibration, scene, ambient, 3.3, rng), dtype=np.uint8)
+        checker.device_write(np.ctypeslib.as_array((ctypes.c_uint8 * length).from_address(dst)), frame)
+        lib.thermal_dma_complete(ctypes.addressof(sensor))
+        converted += lib.thermal_process(ctypes.addressof(sensor))
+    return converted
+
+
+def analog_flow(checker, halves, offset=0, seed=0):
+    """ADC circular DMA: half-transfer and transfer-complete callbacks"""
+    lib = checker.lib
+    dma = dma_array(DMA_SAMPLES * 2, offset)
+    acq = AnalogAcquisition()
+    rng = np.random.default_rng(seed)
+
+    lib.ai_dma_declare(dma.ctypes.data, dma.nbytes)
+    lib.analog_init(ctypes.byref(acq), dma.ctypes.data, None)
+    lib.ai_cache_receive(dma.ctypes.data, dma.nbytes)  # Before HAL_ADC_Start_DMA
+
+    half = dma.nbytes // 2
+    for block in range(halves):
+        samples = rng.integers(1000, 1100, HALF_FRAMES * CHANNELS, dtype=np.uint16)
+        if block % 2 == 0:
+            checker.device_write(dma[:half], samples.view(np.uint8))
+            lib.analog_dma_half(ctypes.byref(acq))
+        else:
+            checker.device_write(dma[half:], samples.view(np.uint8))
+            lib.analog_dma_complete(ctypes.byref(acq))
+        lib.analog_poll(ctypes.byref(acq))
+    return acq.blocks
+
+
+def audio_flow(checker, halves, seed=0):
+    """PDM microphone: SPI circular DMA, decimated in the callbacks"""
+    lib = checker.lib
+    dma = dma_array(PDM_DMA_BYTES)
+    fe = AudioFrontEnd()
+    rng = np.random.default_rng(seed)
+
+    lib.ai_dma_declare(dma.ctypes.data, dma.nbytes)
+    lib.audio_init(ctypes.byref(fe))
+    lib.ai_cache_receive(dma.ctypes.data, dma.nbytes)  # Before HAL_SPI_Receive_DMA
+
+    half = dma.nbytes // 2
+    rows = 0
+    for block in range(halves):
+        target = dma[:half] if block % 2 == 0 else dma[half:]
+        checker.device_write(target, rng.integers(0, 256, half, dtype=np.uint8))
+        lib.audio_pdm_push(ctypes.byref(fe), target.ctypes.data, half)
+        rows += lib.audio_process(ctypes.byref(fe))
+    return rows
+
+
+# ==================== NEGATIVE CONTROLS ====================
+# Each is a handoff done wrong; the checker must report it
+
+def missing_invalidate(checker):
+    buffer = dma_array(256)
+    checker.lib.ai_dma_declare(buffer.ctypes.data, buffer.nbytes)
+    checker.lib.ai_cache_receive(buffer.ctypes.data, buffer.nbytes)
+    checker.device_write(buffer, np.arange(256, dtype=np.uint8))
+    checker.lib.ai_cache_cpu_read(buffer.ctypes.data, buffer.nbytes)
+
+
+def missing_receive(checker):
+    buffer = dma_array(256)
+    checker.lib.ai_dma_declare(buffer.ctypes.data, buffer.nbytes)
+    checker.device_write(buffer, np.arange(256, dtype=np.uint8))
+
+
+def missing_clean(checker):
+    buffer = dma_array(256)
+    checker.lib.ai_dma_declare(buffer.ctypes.data, buffer.nbytes)
+    checker.lib.ai_cache_receive(buffer.ctypes.data, buffer.nbytes)
+    checker.lib.ai_cache_cpu_write(buffer.ctypes.data, buffer.nbytes)
+    checker.lib.ai_dma_device_read(buffer.ctypes.data, buffer.nbytes)
+
+
+def invalidate_dirty(checker):
+    buffer = dma_array(256)
+    checker.lib.ai_dma_declare(buffer.ctypes.data, buffer.nbytes)
+    checker.lib.ai_cache_invalidate(buffer.ctypes.data, buffer.nbytes)
+
+
+def misaligned_buffer(checker):
+    # The real analog path on a buffer that is not AI_DMA_BUFFER-aligned
+    analog_flow(checker, 4, offset=8)
+
+
+NEGATIVE_CONTROLS = [
+    ("CPU read without invalidate", missing_invalidate),
+    ("DMA write over dirty lines", missing_receive),
+    ("DMA read without clean", missing_clean),
+    ("Invalidate discarding CPU writes", invalidate_dirty),
+    ("Misaligned DMA buffer", misaligned_buffer),
+]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="D-cache maintenance checker")
+    parser.add_argument("--frames", type=int, default=16, help="Thermal frames")
+    parser.add_argument("--halves", type=int, default=64, help="Analog / audio DMA halves")
+    parser.add_argument("--output", default=report_path("cache_check_report.json"))
+    args = parser.parse_args()
+
+    checker = CacheChecker()
+
+    print("=" * 60)
+    print("D-CACHE MAINTENANCE CHECK")
+    print("=" * 60)
+    print(f"Cache line {CACHE_LINE} bytes | {args.frames} thermal frames | {args.halves} DMA halves")
+    print()
+
+    flows = []
+    for name, run in (("thermal I2C DMA", lambda: thermal_flow(checker, args.frames)),
+                      ("analog ADC DMA", lambda: analog_flow(checker, args.halves)),
+                      ("audio PDM DMA", lambda: audio_flow(checker, args.halves))):
+        checker.reset()
+        work = run()
+        violations, last = checker.result()
+        flows.append({"flow": name, "processed": int(work), "violations": violations, "last": last})
+        mark = "✓" if violations == 0 else "⚠"
+        print(f"{mark} {name:18} {work:5} processed, {violations} violations {last}")
+
+    print()
+    print("Negative controls (must be flagged):")
+    controls = []
+    for name, run in NEGATIVE_CONTROLS:
+        checker.reset()
+        run(checker)
+        violations, last = checker.result()
+        controls.append({"control": name, "violations": violations, "last": last})
+        mark = "✓" if violations else "⚠"
+        print(f"{mark} {name:34} {last if violations else 'NOT DETECTED'}")
+    checker.reset()
+
+    passed = all(f["violations"] == 0 for f in flows) and all(c["violations"] for c in controls)
+    report = {"cache_line": CACHE_LINE, "flows": flows, "negative_controls": controls, "passed": passed}
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=2)
+
+    print()
+    print(f"{'✓ All DMA handoffs maintained' if passed else '⚠ Cache maintenance check FAILED'}")
+    print(f"Report: {args.output}")
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
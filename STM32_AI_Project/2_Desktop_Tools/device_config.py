@@ -0,0 +1,147 @@
+"""
+Device Configuration
+Read and change a device's detection thresholds and vision schedule at
+run time over the update link (UART, LoRa bridge or the host device's
+pseudo-terminal). Device side: Core/Src/detection_config.c; a change
+takes effect at the device's next frame boundary.
+"""
+
+import argparse
+import math
+import struct
+import sys
+import time
+
+from model_delta_update import SerialLink, encode_frame
+
+
+# Link protocol (link_protocol.h)
+MSG_CFG_GET = 0x30
+MSG_CFG_SET = 0x31
+MSG_CFG_STATUS = 0x3F
+
+# DetectionParams (detection_config.h), wire order
+FIELDS = ["version", "fire", "critical", "smoke", "crackle", "promote_thermal", "promote_analog",
+          "promote_audio", "evidence", "screen_period_ms", "active_period_ms", "hold_ms"]
+PARAMS = struct.Struct("<I8f3I")
+STATUS = struct.Struct("<BB")
+
+STATUS_NAMES = {0: "OK", 1: "ERR_LENGTH", 2: "ERR_RANGE", 3: "ERR_VERSION", 4: "ERR_BUSY"}
+STATUS_BUSY = 4
+
+# Site profiles (model_info.json notes: 0.5 high sensitivity, 0.85 high specificity)
+PROFILES = {
+    "default": {"fire": 0.7, "critical": 0.9, "smoke": 0.7, "evidence": 0.3},
+    "high-sensitivity": {"fire": 0.5, "critical": 0.8, "smoke": 0.5, "evidence": 0.2},
+    "high-specificity": {"fire": 0.85, "critical": 0.95, "smoke": 0.85, "evidence": 0.4},
+}
+
+
+def decode_params(payload):
+    return dict(zip(FIELDS, PARAMS.unpack_from(payload)))
+
+
+def encode_params(params):
+    return PARAMS.pack(*(params[name] for name in FIELDS))
+
+
+def logit(p):
+    return math.log(p / (1 - p))
+
+
+class ConfigClient:
+    """CFG_GET / CFG_SET request-reply with retries"""
+
+    def __init__(self, link, timeout=0.5, retries=20):
+        self.link = link
+        self.timeout = timeout
+        self.retries = retries
+        self.seq = 0
+
+    def _request(self, msg_type, payload=b""):
+        for _ in range(self.retries):
+            self.seq = (self.seq + 1) & 0xFF
+            self.link.write(encode_frame(msg_type, self.seq, payload))
+            while True:
+                frame = self.link.receive_frame(self.timeout)
+                if frame is None:
+                    break
+                rtype, rseq, body = frame
+                if rtype == MSG_CFG_STATUS and rseq == self.seq and len(body) >= STATUS.size + PARAMS.size:
+                    status, pending = STATUS.unpack_from(body)
+                    return status, bool(pending), decode_params(body[STATUS.size:])
+        raise TimeoutError(f"No reply to message 0x{msg_type:02x}")
+
+    def get(self):
+        return self._request(MSG_CFG_GET)
+
+    def set(self, params, busy_retries=50):
+        """Send params (based on params['version']); waits out ERR_BUSY"""
+        for _ in range(busy_retries):
+            status, pending, current = self._request(MSG_CFG_SET, encode_params(params))
+            if status != STATUS_BUSY:
+                return status, pending, current
+            time.sleep(0.02)  # The device takes the previous update at its next frame
+        return status, pending, current
+
+
+def parse_assignments(items):
+    changes = {}
+    for item in items:
+        name, _, value = item.partition("=")
+        if name not in FIELDS[1:] or not value:
+            raise SystemExit(f"Unknown setting '{item}' (one of: {', '.join(FIELDS[1:])})")
+        changes[name] = int(value) if name.endswith("_ms") else float(value)
+    return changes
+
+
+def print_params(params, pending=False):
+    print(f"  version          {params['version']}{' (pending: next frame)' if pending else ''}")
+    for name in FIELDS[1:9]:
+        p = params[name]
+        extra = f"  (logit {logit(p):+.3f})" if name in ("fire", "critical", "smoke") and 0 < p < 1 else ""
+        print(f"  {name:16} {p:.3f}{extra}")
+    for name in FIELDS[9:]:
+        print(f"  {name:16} {params[name]}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Runtime detection configuration")
+    parser.add_argument("--port", required=True)
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--profile", choices=sorted(PROFILES), help="Site threshold profile")
+    parser.add_argument("--set", nargs="+", default=[], metavar="NAME=VALUE",
+                        help="Individual settings, e.g. fire=0.6 hold_ms=30000")
+    parser.add_argument("--timeout", type=float, default=0.5)
+    args = parser.parse_args()
+
+    changes = dict(PROFILES[args.profile]) if args.profile else {}
+    changes.update(parse_assignments(args.set))
+
+    link = SerialLink(args.port, args.baud)
+    client = ConfigClient(link, timeout=args.timeout)
+    try:
+        status, pending, current = client.get()
+        print(f"Device configuration ({args.port}):")
+        print_params(current, pending)
+        if not changes:
+            return 0
+
+        # Read-modify-write on the version just read; a concurrent change
+        # elsewhere makes the device refuse it (ERR_VERSION)
+        status, pending, current = client.set({**current, **changes})
+    finally:
+        link.close()
+
+    name = STATUS_NAMES.get(status, status)
+    if status != 0:
+        print(f"⚠ Device rejected the change: {name}", file=sys.stderr)
+        print_params(current, pending)
+        return 1
+    print(f"✓ Applied as version {current['version']}:")
+    print_params(current, pending)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
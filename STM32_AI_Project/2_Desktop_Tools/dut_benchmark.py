@@ -0,0 +1,350 @@
+"""
+DUT Benchmark
+Benchmark inference on a device under test: stream a dataset's input
+tensors over the link (UART or the host device's pseudo-terminal), have
+the device run each one N times, and report the latency distribution,
+throughput and accuracy from its cycle counts and outputs. Device side:
+Core/Src/dut_benchmark.c, the same code on the board and in
+Host/host_update_device, so reports from both compare directly (--compare).
+"""
+
+import argparse
+import hashlib
+import json
+import struct
+import subprocess
+import sys
+import time
+from pathlib import Path
+
+import cv2
+import numpy as np
+
+from model_delta_update import SerialLink, encode_frame
+from model_pareto_explorer import load_frames, synthetic_frames
+from native_build import BUILD_DIR, FIRMWARE_DIR, INCLUDE_DIR, SOURCE_DIR, report_path
+from qemu_profile import build_model
+
+
+# Link protocol (link_protocol.h)
+MSG_DUT_INFO = 0x40
+MSG_DUT_INPUT = 0x41
+MSG_DUT_RUN = 0x42
+MSG_DUT_END = 0x43
+MSG_DUT_ACK = 0x4D
+MSG_DUT_DEVICE = 0x4E
+MSG_DUT_RESULT = 0x4F
+
+# dut_benchmark.h
+DEVICE = struct.Struct("<BBHHHHHIIII16s")
+ACK = struct.Struct("<BI")
+RUN = struct.Struct("<HHI")
+RESULT = struct.Struct("<BBHIfff")
+RUN_RESET = 0x0001
+RUN_CAM = 0x0002
+RESULT_VARIED = 0x01
+CHUNK_BYTES = 252                 # LINK_MAX_PAYLOAD - offset u32
+
+STATUS_NAMES = {0: "OK", 1: "ERR_LENGTH", 2: "ERR_OFFSET", 3: "ERR_INPUT", 4: "ERR_RANGE", 5: "ERR_MODEL"}
+
+HOST_DEVICE = BUILD_DIR / "host_update_device"
+HOST_DEFAULT_MODEL = BUILD_DIR / "dut_default_model.bin"
+HOST_SOURCES = [FIRMWARE_DIR / "Host" / "host_update_device.c"] + [
+    SOURCE_DIR / s for s in ("model_update.c", "link_protocol.c", "crc32.c", "ai_inference.c", "ai_engine.c",
+                             "ai_gemm.c", "thermal_sensor.c", "model_data.c", "detection_config.c",
+                             "dut_benchmark.c")]
+
+
+# ==================== DEVICE ====================
+
+class DutClient:
+    """DUT_* request-reply with retries"""
+
+    def __init__(self, link, timeout=0.5, retries=20):
+        self.link = link
+        self.timeout = timeout
+        self.retries = retries
+        self.seq = 0
+
+    def _request(self, msg_type, reply_type, payload=b"", timeout=None):
+        for _ in range(self.retries):
+            self.seq = (self.seq + 1) & 0xFF
+            self.link.write(encode_frame(msg_type, self.seq, payload))
+            while True:
+                frame = self.link.receive_frame(timeout or self.timeout)
+                if frame is None:
+                    break
+                rtype, rseq, body = frame
+                if rtype == reply_type and rseq == self.seq:
+                    return body
+        raise TimeoutError(f"No reply to message 0x{msg_type:02x}")
+
+    def info(self):
+        (version, status, max_iterations, w, h, c, layers, input_bytes, clock_hz, model_crc, model_size,
+         platform) = DEVICE.unpack_from(self._request(MSG_DUT_INFO, MSG_DUT_DEVICE))
+        return {"version": version, "status": STATUS_NAMES.get(status, status), "max_iterations": max_iterations,
+                "input_shape": [h, w, c], "engine_layers": layers, "input_bytes": input_bytes,
+                "clock_hz": clock_hz, "model_crc": f"0x{model_crc:08X}", "model_size": model_size,
+                "platform": platform.rstrip(b"\0").decode(errors="replace")}
+
+    def upload(self, tensor):
+        """Stop-and-wait chunks; a repeated chunk is harmless on the device"""
+        data = tensor.tobytes()
+        for offset in range(0, len(data), CHUNK_BYTES):
+            body = self._request(MSG_DUT_INPUT, MSG_DUT_ACK,
+                                 struct.pack("<I", offset) + data[offset:offset + CHUNK_BYTES])
+            status, received = ACK.unpack_from(body)
+            if status != 0:
+                raise RuntimeError(f"Input chunk at {offset} rejected: {STATUS_NAMES.get(status, status)}")
+
+    def run(self, iterations, flags, task_mask, timeout):
+        body = self._request(MSG_DUT_RUN, MSG_DUT_RESULT, RUN.pack(iterations, flags, task_mask), timeout)
+        status, result_flags, count, tasks_run, fire, smoke, margin = RESULT.unpack_from(body)
+        if status != 0:
+            raise RuntimeError(f"Run rejected: {STATUS_NAMES.get(status, status)}")
+        cycles = struct.unpack_from(f"<{count}I", body, RESULT.size)
+        return {"cycles": list(cycles), "fire": fire, "smoke": smoke, "fire_margin": margin,
+                "tasks_run": tasks_run, "varied": bool(result_flags & RESULT_VARIED)}
+
+    def end(self):
+        self._request(MSG_DUT_END, MSG_DUT_ACK)
+
+
+def build_host_device():
+    """Host/host_update_device (rebuilt when a source or header is newer)"""
+    BUILD_DIR.mkdir(exist_ok=True)
+    inputs = HOST_SOURCES + sorted(INCLUDE_DIR.glob("*.h"))
+    if not HOST_DEVICE.exists() or any(p.stat().st_mtime > HOST_DEVICE.stat().st_mtime for p in inputs):
+        print(f"Building {HOST_DEVICE.name}...")
+        cmd = ["cc", "-O2", f"-I{INCLUDE_DIR}", *map(str, HOST_SOURCES), "-o", str(HOST_DEVICE), "-lm"]
+        result = subprocess.run(cmd, capture_output=True, text=True)
+        if result.returncode != 0:
+            raise RuntimeError(f"Host device build failed:\n{' '.join(cmd)}\n{result.stderr}")
+    return HOST_DEVICE
+
+
+def start_host_device(model, seed):
+    """
+    Launch the host device; returns (process, PTY path)
+    Without a model it runs a random-weight engine model (qemu_profile's):
+    its built-in image is the TFLite placeholder, which cannot benchmark.
+    """
+    if not model:
+        BUILD_DIR.mkdir(exist_ok=True)
+        HOST_DEFAULT_MODEL.write_bytes(build_model(None, seed).to_bytes())
+        model = str(HOST_DEFAULT_MODEL)
+    cmd = [str(build_host_device()), model]
+    process = subprocess.Popen(cmd, stdout=subprocess.PIPE, text=True)
+    for line in process.stdout:
+        if line.startswith("PTY:"):
+            return process, line.split(":", 1)[1].strip()
+    process.kill()
+    raise RuntimeError("Host device exited without a PTY")
+
+
+# ==================== DATA ====================
+
+def load_dataset(args, shape):
+    """Images and labels at the device's input shape (cv2 INTER_LINEAR, as the desktop pipeline)"""
+    h, w, c = shape
+    if args.dataset:
+        if c == 3:
+            paths = [(1, p) for p in sorted(Path(args.dataset).glob("fire_*.jpg"))] + \
+                    [(0, p) for p in sorted(Path(args.dataset).glob("no_fire_*.jpg"))]
+            images = [cv2.cvtColor(cv2.imread(str(p)), cv2.COLOR_BGR2RGB) for _, p in paths]
+            labels = np.array([label for label, _ in paths])
+        else:
+            images, labels = load_frames(args.dataset)
+    else:
+        images, labels = synthetic_frames(args.synthetic, args.seed)
+
+    tensors = []
+    for img in images:
+        img = cv2.resize(img, (w, h), interpolation=cv2.INTER_LINEAR)
+        if c == 3 and img.ndim == 2:
+            img = cv2.cvtColor(img, cv2.COLOR_GRAY2RGB)
+        elif c == 1 and img.ndim == 3:
+            img = cv2.cvtColor(img, cv2.COLOR_RGB2GRAY)
+        tensors.append(np.ascontiguousarray(img, dtype=np.uint8).reshape(h, w, c))
+    return tensors, labels
+
+
+def fingerprint(tensors, labels):
+    digest = hashlib.sha256()
+    for t in tensors:
+        digest.update(t.tobytes())
+    digest.update(np.asarray(labels, dtype=np.uint8).tobytes())
+    return digest.hexdigest()[:16]
+
+
+# ==================== REPORT ====================
+
+def latency_stats(ms):
+    ms = np.asarray(ms, dtype=np.float64)
+    if ms.size == 0:
+        return {}
+    return {"count": int(ms.size), "min": float(ms.min()), "mean": float(ms.mean()),
+            "p50": float(np.percentile(ms, 50)), "p90": float(np.percentile(ms, 90)),
+            "p99": float(np.percentile(ms, 99)), "max": float(ms.max()), "std": float(ms.std())}
+
+
+def accuracy_stats(probs, labels, threshold):
+    pred = np.asarray(probs) > threshold
+    labels = np.asarray(labels).astype(bool)
+    tp = int(np.sum(pred & labels))
+    fp = int(np.sum(pred & ~labels))
+    fn = int(np.sum(~pred & labels))
+    tn = int(np.sum(~pred & ~labels))
+    return {"threshold": threshold, "accuracy": (tp + tn) / max(len(labels), 1),
+            "precision": tp / max(tp + fp, 1), "recall": tp / max(tp + fn, 1),
+            "tp": tp, "fp": fp, "fn": fn, "tn": tn}
+
+
+def print_latency(name, stats):
+    if stats:
+        print(f"{name:<8} {stats['min']:>9.3f} {stats['mean']:>9.3f} {stats['p50']:>9.3f} {stats['p90']:>9.3f} "
+              f"{stats['p99']:>9.3f} {stats['max']:>9.3f} {stats['std']:>8.3f}")
+
+
+def compare(report, other_path):
+    """Latency / accuracy / output differences against an earlier report"""
+    other = json.loads(Path(other_path).read_text())
+    print()
+    print(f"Compared with {other['device']['platform']} ({other_path}):")
+    if other["dataset"]["fingerprint"] != report["dataset"]["fingerprint"]:
+        print("⚠ Different datasets: latency only")
+    ratio = report["latency_ms"]["steady"]["mean"] / other["latency_ms"]["steady"]["mean"]
+    print(f"  Mean latency     {report['latency_ms']['steady']['mean']:.3f} ms vs "
+          f"{other['latency_ms']['steady']['mean']:.3f} ms (x{ratio:.2f})")
+    result = {"against": str(other_path), "latency_ratio": ratio}
+    if other["dataset"]["fingerprint"] == report["dataset"]["fingerprint"]:
+        delta = report["accuracy"]["accuracy"] - other["accuracy"]["accuracy"]
+        probs = np.array([s["fire"] for s in report["samples"]])
+        other_probs = np.array([s["fire"] for s in other["samples"]])
+        max_diff = float(np.max(np.abs(probs - other_probs))) if probs.size else 0.0
+        disagree = int(np.sum((probs > report["accuracy"]["threshold"]) !=
+                              (other_probs > report["accuracy"]["threshold"])))
+        print(f"  Accuracy         {report['accuracy']['accuracy']:.2%} vs {other['accuracy']['accuracy']:.2%} "
+              f"({delta:+.2%})")
+        print(f"  Max |dP(fire)|   {max_diff:.6f} | decisions that differ: {disagree}")
+        if report["device"]["model_crc"] != other["device"]["model_crc"]:
+            print("⚠ Different models (CRC)")
+        result.update({"accuracy_delta": delta, "max_prob_diff": max_diff, "decisions_differ": disagree})
+    return result
+
+
+# ==================== MAIN ====================
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark inference on a device under test")
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("--port", help="Serial port / PTY of a running device")
+    target.add_argument("--host", nargs="?", const="", metavar="MODEL",
+                        help="Build and start Host/host_update_device on an FDM1 model "
+                             "(default: a random-weight engine model)")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--dataset", help="Directory of fire_*.jpg / no_fire_*.jpg")
+    parser.add_argument("--synthetic", type=int, default=32, help="Synthetic frames without --dataset")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--iterations", type=int, default=10, help="Runs per input tensor")
+    parser.add_argument("--threshold", type=float, default=0.7, help="P(fire) for a detection")
+    parser.add_argument("--task-mask", type=lambda v: int(v, 0), default=0, help="Heads to run (0: all)")
+    parser.add_argument("--keep-state", action="store_true",
+                        help="Keep temporal state between runs (default: reset before each)")
+    parser.add_argument("--cam", action="store_true", help="Compute the class activation map in every run")
+    parser.add_argument("--timeout", type=float, default=0.5)
+    parser.add_argument("--run-timeout", type=float, default=30.0)
+    parser.add_argument("--compare", help="Earlier report (JSON), e.g. the host's against the board's")
+    parser.add_argument("--output", default=report_path("dut_benchmark.json"))
+    args = parser.parse_args()
+    if args.iterations < 1:
+        parser.error("--iterations must be at least 1")
+
+    process = None
+    port = args.port
+    if args.host is not None:
+        process, port = start_host_device(args.host, args.seed)
+
+    link = SerialLink(port, args.baud)
+    client = DutClient(link, timeout=args.timeout)
+    flags = (0 if args.keep_state else RUN_RESET) | (RUN_CAM if args.cam else 0)
+    samples = []
+    try:
+        device = client.info()
+        if device["status"] != "OK":
+            print(f"⚠ Device cannot benchmark: {device['status']}", file=sys.stderr)
+            return 1
+        tensors, labels = load_dataset(args, device["input_shape"])
+
+        print("=" * 60)
+        print("DEVICE-UNDER-TEST BENCHMARK")
+        print("=" * 60)
+        h, w, c = device["input_shape"]
+        print(f"Device: {device['platform']} at {device['clock_hz'] / 1e6:g} MHz | model {device['model_crc']} "
+              f"({device['model_size']:,} bytes, {device['engine_layers']} layers, {w}x{h}x{c} input)")
+        print(f"Dataset: {len(tensors)} tensors ({args.dataset or 'synthetic'}) x {args.iterations} runs")
+
+        start = time.monotonic()
+        for i, (tensor, label) in enumerate(zip(tensors, labels)):
+            client.upload(tensor)
+            cycles, result = [], None
+            remaining = args.iterations
+            while remaining:
+                batch = min(remaining, device["max_iterations"])
+                result = client.run(batch, flags, args.task_mask, args.run_timeout)
+                cycles += result["cycles"]
+                remaining -= batch
+            samples.append({"index": i, "label": int(label), "fire": result["fire"], "smoke": result["smoke"],
+                            "fire_margin": result["fire_margin"], "tasks_run": result["tasks_run"],
+                            "varied": result["varied"],
+                            "latency_ms": [n * 1000.0 / device["clock_hz"] for n in cycles]})
+        wall = time.monotonic() - start
+        client.end()
+    finally:
+        link.close()
+        if process:
+            process.terminate()
+            process.wait()
+
+    # The first run of a tensor follows its upload (cold caches); the rest are steady state
+    cold = [s["latency_ms"][0] for s in samples]
+    steady = [ms for s in samples for ms in s["latency_ms"][1:]] or cold
+    inferences = sum(len(s["latency_ms"]) for s in samples)
+    steady_stats = latency_stats(steady)
+    report = {
+        "device": device,
+        "dataset": {"source": args.dataset or f"synthetic({args.synthetic}, seed {args.seed})",
+                    "tensors": len(samples), "fingerprint": fingerprint(tensors, labels)},
+        "settings": {"iterations": args.iterations, "flags": flags, "task_mask": args.task_mask},
+        "latency_ms": {"cold": latency_stats(cold), "steady": steady_stats},
+        "throughput": {"device_inferences_per_s": 1000.0 / steady_stats["mean"],
+                       "wall_inferences_per_s": inferences / wall, "wall_s": wall},
+        "accuracy": accuracy_stats([s["fire"] for s in samples], labels, args.threshold),
+        "varied_outputs": sum(s["varied"] for s in samples),
+        "samples": samples,
+    }
+
+    print()
+    print(f"{'ms':<8} {'min':>9} {'mean':>9} {'p50':>9} {'p90':>9} {'p99':>9} {'max':>9} {'std':>8}")
+    print_latency("cold", report["latency_ms"]["cold"])
+    print_latency("steady", steady_stats)
+    t = report["throughput"]
+    print(f"\nThroughput: {t['device_inferences_per_s']:.1f} inferences/s on the device, "
+          f"{t['wall_inferences_per_s']:.1f}/s including the link ({inferences} in {wall:.3f} s)")
+    a = report["accuracy"]
+    print(f"Accuracy at P(fire) > {a['threshold']:g}: {a['accuracy']:.2%} | precision {a['precision']:.2%} | "
+          f"recall {a['recall']:.2%} (TP {a['tp']} FP {a['fp']} FN {a['fn']} TN {a['tn']})")
+    if report["varied_outputs"]:
+        print(f"⚠ Outputs varied between runs of {report['varied_outputs']} tensors"
+              f"{' (temporal state kept)' if args.keep_state else ''}")
+
+    if args.compare:
+        report["comparison"] = compare(report, args.compare)
+
+    Path(args.output).write_text(json.dumps(report, indent=2))
+    print(f"\n✓ Report: {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,929 @@
+"""
+Engine Model Export
+Quantize small CNNs to int8 and write the firmware engine's FDM1 format
+(Core/Inc/ai_engine.h). Numpy only: layers come from a Keras model or a
+saved checkpoint, so conversion and evaluation also run without TensorFlow.
+"""
+
+import json
+import struct
+from pathlib import Path
+
+import numpy as np
+
+from model_delta_update import MODEL_BLOCK_SIZE
+
+
+ENGINE_MAGIC = b"FDM1"
+ENGINE_VERSION = 1
+HEADER = struct.Struct("<4sHHHHHBBfifiII")  # AiModelHeader, 40 bytes
+LAYER = struct.Struct("<BBbbHHHHHHIIII")    # AiLayer, 32 bytes
+
+OP_CONV2D_3X3 = 1
+OP_MAXPOOL_2X2 = 2
+OP_GLOBAL_AVGPOOL = 3
+OP_DENSE = 4
+OP_CONV2D_3X3_POOL = 5
+OP_HEAD = 6
+OP_TEMPORAL_CONV = 7
+OP_CODES = {"conv": OP_CONV2D_3X3, "maxpool": OP_MAXPOOL_2X2, "gap": OP_GLOBAL_AVGPOOL, "dense": OP_DENSE,
+            "temporal": OP_TEMPORAL_CONV}
+
+CONV_OPS = (OP_CONV2D_3X3, OP_CONV2D_3X3_POOL)
+
+ACT_NONE = 0
+ACT_RELU = 1
+ACT_LUT = 2
+
+# Nonlinearities the converter bakes into 256-entry int8 tables (ACT_LUT)
+LUT_FUNCTIONS = {
+    "sigmoid": lambda x: 1.0 / (1.0 + np.exp(-x)),
+    "tanh": np.tanh,
+    "hard_swish": lambda x: x * np.clip(x + 3.0, 0.0, 6.0) / 6.0,
+    "exp": np.exp,
+}
+KERAS_LUT_NAMES = {"sigmoid": "sigmoid", "tanh": "tanh", "hard_swish": "hard_swish",
+                   "hard_silu": "hard_swish", "exponential": "exp"}
+
+FLAG_PACKED_B = 0x0001
+FLAG_PATCHED = 0x0002
+FLAG_HEADS = 0x0004
+FLAG_SPARSE = 0x0008
+MAX_PATCH_LAYERS = 16
+MAX_TAPS = 16  # AI_ENGINE_MAX_TAPS
+
+# Multi-task heads (AI_TASK_*); a head's index here is its task id
+TASK_FIRE = 0
+TASK_SMOKE = 1
+TASK_LOCATION = 2
+TASK_NAMES = ("fire", "smoke", "location")
+MAX_HEADS = 4
+MAX_OUTPUT = 32
+CAM_GRID = 4  # AI_CAM_GRID
+
+# GEMM core blocking (ai_gemm.h)
+GEMM_MR = 2
+GEMM_NR = 2
+GEMM_CACHE_BYTES = 8 * 1024   # Cortex-M7 build
+
+# Input normalization used by preprocess_image(): 0-255 -> 0-1
+INPUT_SCALE = np.float32(1.0 / 255.0)
+INPUT_ZERO = -128
+
+# Cortex-M7 cost model for the GEMM core (ai_gemm.c, DSP build) and the
+# pooling loops in ai_engine.c (cycles). Rough figures at -O2; calibrate
+# against hardware (DWT->CYCCNT) before trusting absolute numbers.
+M7_CLOCK_HZ = 480e6
+M7_PEAK_MACS_PER_CYCLE = 2.0  # One SMLAD (2 MACs) issued per cycle
+M7_COST = {
+    "step_2x2": 11.0,     # 16 MACs: 8 SMLAD + 2 SXTB16 pairs + 6 loads, dual-issued
+    "step_1x2": 6.5,      # 8 MACs: 4 SMLAD + 2 SXTB16 pairs + 4 loads
+    "tile": 10.0,         # Microkernel call, bias loads, pointer setup
+    "pack": 3.0,          # Per A element: load, subtract zero, store int16
+    "output": 12.0,       # Requantize (64-bit), saturate, store
+    "lut": 1.0,           # Table activation: one extra load per output
+    "pool_output": 6.0,
+    "gap_input": 3.0,
+    "input": 20.0,        # VDIV.F32 + VCVT per input element
+    "copy": 0.25,         # memcpy per byte (word copies)
+    "step_scan": 2.5,     # Zero skipping: per A step and row, two word loads + ORR, list store
+    "step_live": 1.5,     # Per live step: index load, A / B address arithmetic
+    "encode": 3.0,        # Compressed map: per value written (count, compare, bit set, store)
+    "decode": 2.0,        # Per value read back (bit test, store)
+}
+
+
+def pool_rows_size(layer, out_w):
+    """Row buffer of a fused conv + pool layer (two conv rows); 0 for other ops"""
+    return 2 * 2 * out_w * layer["out_shape"][2] if layer["op"] == OP_CONV2D_3X3_POOL else 0
+
+
+def sparse_size(shape):
+    """Largest compressed map of an (h, w, c) tensor: row table + rows as is (ai_engine.h)"""
+    h, w, c = shape
+    return 4 * (h + 1) + h * w * c
+
+
+def window_height(op):
+    """Input rows a layer decodes from a compressed map at a time"""
+    return {OP_CONV2D_3X3: 3, OP_CONV2D_3X3_POOL: 4, OP_MAXPOOL_2X2: 2}.get(op, 0)
+
+
+def sparse_map_bytes(q, zero):
+    """
+    Bytes of each map of an int8 batch (N, H, W, C) in the compressed row
+    format: per row the smaller of a bitmap + its values and the row as is
+    """
+    n, h, w, c = q.shape
+    row = w * c
+    nonzero = (q != zero).reshape(n, h, row).sum(axis=2)
+    stored = np.minimum(-(-row // 8) + nonzero, row)
+    return 4 * (h + 1) + stored.sum(axis=1)
+
+
+def input_size(layer):
+    """Activation bytes of a layer's input (a temporal layer's window is state)"""
+    if layer["op"] == OP_TEMPORAL_CONV:
+        return layer["in_shape"][2]
+    return int(np.prod(layer["in_shape"]))
+
+
+def gemm_depth(k):
+    """k rounded up to the GEMM's 4-deep step"""
+    return -(-k // 4) * 4
+
+
+def pack_weights(weights):
+    """
+    Weights (n, k) int8 -> GEMM B panels (ai_gemm.h): for each group of
+    GEMM_NR channels, for each 4-deep k step, GEMM_NR x 4 values; channels
+    and depth are zero-padded
+    """
+    n, k = weights.shape
+    groups = -(-n // GEMM_NR)
+    padded = np.zeros((groups * GEMM_NR, gemm_depth(k)), dtype=np.int8)
+    padded[:n, :k] = weights
+    panels = padded.reshape(groups, GEMM_NR, -1, 4).transpose(0, 2, 1, 3)
+    return np.ascontiguousarray(panels).reshape(-1)
+
+
+def gemm_cycles(m, n, k):
+    """
+    M7 cycles for an m x n x k GEMM on ai_gemm.c: A panels are re-packed
+    for every cache block of output channels, then MR x NR tiles run
+    depth/4 steps each
+    """
+    depth = gemm_depth(k)
+    block = max(GEMM_NR, GEMM_CACHE_BYTES // depth // GEMM_NR * GEMM_NR)
+    col_tiles = -(-n // GEMM_NR)
+    full_rows, odd_row = divmod(m, GEMM_MR)
+
+    cycles = -(-n // block) * m * depth * M7_COST["pack"]
+    cycles += full_rows * col_tiles * (M7_COST["tile"] + depth // 4 * M7_COST["step_2x2"])
+    cycles += odd_row * col_tiles * (M7_COST["tile"] + depth // 4 * M7_COST["step_1x2"])
+    return cycles + m * n * M7_COST["output"]
+
+
+def gemm_cycles_live(live2, live1, n, k):
+    """
+    M7 cycles of a GEMM with zero skipping (AiGemmParams.skip), given the
+    live step count of each 2-row and 1-row A panel: every panel is scanned
+    per cache block, those with at least 1/8 of their steps dead run the
+    live steps only
+    """
+    depth = gemm_depth(k)
+    steps = depth // 4
+    block = max(GEMM_NR, GEMM_CACHE_BYTES // depth // GEMM_NR * GEMM_NR)
+    col_tiles = -(-n // GEMM_NR)
+    live2, live1 = np.asarray(live2), np.asarray(live1)
+    m = 2 * live2.size + live1.size
+
+    cycles = -(-n // block) * m * steps * (4 * M7_COST["pack"] + M7_COST["step_scan"])
+    for live, step in ((live2, M7_COST["step_2x2"]), (live1, M7_COST["step_1x2"])):
+        per_tile = np.where(8 * live <= 7 * steps, live * (step + M7_COST["step_live"]), steps * step)
+        cycles += col_tiles * (live.size * M7_COST["tile"] + per_tile.sum())
+    return float(cycles + m * n * M7_COST["output"])
+
+
+# ==================== FLOAT LAYERS ====================
+
+def layers_from_keras(model):
+    """
+    Extract engine layers from a Sequential Keras model
+
+    Supported: Conv2D (3x3, stride 1, same), MaxPooling2D (2x2),
+    GlobalAveragePooling2D, Flatten, Dropout, Dense. A final softmax is
+    dropped: the firmware applies it to the dequantized logits. Sigmoid,
+    tanh, hard-swish and exponential activations become table lookups.
+    """
+    layers = []
+    for layer in model.layers:
+        kind = type(layer).__name__
+        config = layer.get_config()
+        activation = config.get("activation", "linear")
+        if activation not in ("linear", "relu", "softmax", *KERAS_LUT_NAMES):
+            raise ValueError(f"{layer.name}: activation '{activation}' not supported by the engine")
+        lut = {"activation": KERAS_LUT_NAMES[activation]} if activation in KERAS_LUT_NAMES else {}
+
+        if kind == "Conv2D":
+            if tuple(config["kernel_size"]) != (3, 3) or tuple(config["strides"]) != (1, 1) \
+                    or config["padding"] != "same":
+                raise ValueError(f"{layer.name}: only 3x3 / stride 1 / same convolutions are supported")
+            w, b = layer.get_weights()
+            layers.append({"op": "conv", "w": w, "b": b, "relu": activation == "relu", **lut})
+        elif kind == "MaxPooling2D":
+            if tuple(config["pool_size"]) != (2, 2):
+                raise ValueError(f"{layer.name}: only 2x2 pooling is supported")
+            layers.append({"op": "maxpool"})
+        elif kind == "GlobalAveragePooling2D":
+            layers.append({"op": "gap"})
+        elif kind == "Dense":
+            w, b = layer.get_weights()
+            layers.append({"op": "dense", "w": w, "b": b, "relu": activation == "relu", **lut})
+        elif kind in ("Flatten", "Dropout", "InputLayer"):
+            continue  # NHWC is already flat; dropout is training-only
+        else:
+            raise ValueError(f"{layer.name}: layer type {kind} not supported by the engine")
+    return layers
+
+
+def save_checkpoint(path, layers, config=None):
+    """Save float layers (+ variant config) as .npz"""
+    arrays = {}
+    spec = []
+    for i, layer in enumerate(layers):
+        spec.append({"op": layer["op"], "relu": bool(layer.get("relu", False))})
+        for key in ("activation", "pool", "input_mean"):
+            if layer.get(key):
+                spec[-1][key] = layer[key]
+        if "w" in layer:
+            arrays[f"w{i}"] = layer["w"]
+            arrays[f"b{i}"] = layer["b"]
+    np.savez(path, layers=json.dumps(spec), config=json.dumps(config or {}), **arrays)
+
+
+def load_checkpoint(path):
+    """Load layers and config written by save_checkpoint()"""
+    data = np.load(path)
+    layers = []
+    for i, spec in enumerate(json.loads(str(data["layers"]))):
+        if f"w{i}" in data:
+            spec["w"] = data[f"w{i}"]
+            spec["b"] = data[f"b{i}"]
+        layers.append(spec)
+    return layers, json.loads(str(data["config"]))
+
+
+def random_layers(input_shape, filters=(16, 32, 64), head_units=128, seed=0):
+    """
+    He-initialized float layers in the create_model() pattern: conv + pool
+    per entry of filters, then Flatten + Dense(head_units) + Dense(2), or
+    GlobalAveragePooling + Dense(2) when head_units is 0. For sizing and
+    benchmarking without a trained checkpoint.
+    """
+    rng = np.random.default_rng(seed)
+    layers, (size_h, size_w, channels) = [], input_shape
+
+    for f in filters:
+        w = rng.normal(0, np.sqrt(2 / (9 * channels)), (3, 3, channels, f)).astype(np.float32)
+        layers += [{"op": "conv", "w": w, "b": np.zeros(f, np.float32), "relu": True},
+                   {"op": "maxpool"}]
+        size_h, size_w, channels = size_h // 2, size_w // 2, f
+
+    flat = size_h * size_w * channels
+    dense = [(head_units, True), (2, False)]
+    if not head_units:
+        layers.append({"op": "gap"})
+        flat, dense = channels, [(2, False)]
+    for units, relu in dense:
+        w = rng.normal(0, np.sqrt(2 / flat), (flat, units)).astype(np.float32)
+        layers.append({"op": "dense", "w": w, "b": np.zeros(units, np.float32), "relu": relu})
+        flat = units
+    return layers
+
+
+def float_forward(layers, x, pre_activations=None):
+    """
+    Float reference forward pass (NHWC batch)
+    Returns the output of every layer; the last one holds the logits.
+    pre_activations (list) receives every layer's output before its activation.
+
+    Layers written by graph_optimizer.py may also carry "pool" (conv
+    followed by a 2x2 max pool) and "input_mean" (subtracted from the
+    input before the layer, padding included).
+
+    "temporal" layers (w: [taps][in][out]) are causal 1-D convs over the
+    batch axis, taken as consecutive frames of one stream that starts
+    from zero embeddings (ai_engine_reset_state()).
+    """
+    outputs = []
+    for layer in layers:
+        op = layer["op"]
+        x = x - np.float32(layer.get("input_mean", 0.0))
+        if op == "conv":
+            n, h, w, _ = x.shape
+            padded = np.pad(x, ((0, 0), (1, 1), (1, 1), (0, 0)))
+            y = np.zeros((n, h, w, layer["w"].shape[3]), dtype=np.float32)
+            for ky in range(3):
+                for kx in range(3):
+                    y += padded[:, ky:ky + h, kx:kx + w, :] @ layer["w"][ky, kx]
+            x = y + layer["b"]
+        elif op == "maxpool":
+            n, h, w, c = x.shape
+            x = x[:, :h // 2 * 2, :w // 2 * 2, :].reshape(n, h // 2, 2, w // 2, 2, c).max(axis=(2, 4))
+        elif op == "gap":
+            x = x.mean(axis=(1, 2), keepdims=True)
+        elif op == "dense":
+            x = (x.reshape(len(x), -1) @ layer["w"] + layer["b"]).reshape(len(x), 1, 1, -1)
+        elif op == "temporal":
+            taps = len(layer["w"])
+            frames = np.concatenate([np.zeros((taps - 1, x.shape[3]), np.float32), x.reshape(len(x), -1)])
+            y = sum(frames[j:j + len(x)] @ layer["w"][j] for j in range(taps))
+            x = (y + layer["b"]).reshape(len(x), 1, 1, -1)
+        if pre_activations is not None:
+            pre_activations.append(x.astype(np.float32))
+        if layer.get("relu"):
+            x = np.maximum(x, 0)
+        if layer.get("activation"):
+            x = LUT_FUNCTIONS[layer["activation"]](x.astype(np.float64))
+        if layer.get("pool"):
+            n, h, w, c = x.shape
+            x = x[:, :h // 2 * 2, :w // 2 * 2, :].reshape(n, h // 2, 2, w // 2, 2, c).max(axis=(2, 4))
+        x = x.astype(np.float32)
+        outputs.append(x)
+    return outputs
+
+
+# ==================== QUANTIZATION ====================
+
+def quantize_multiplier(real):
+    """real = multiplier * 2^(shift - 31), multiplier in [2^30, 2^31)"""
+    if real <= 0:
+        return 0, 0
+    mantissa, exponent = np.frexp(real)
+    multiplier = int(round(mantissa * (1 << 31)))
+    if multiplier == 1 << 31:
+        multiplier //= 2
+        exponent += 1
+    if exponent > 30 or 31 - exponent > 62:
+        raise ValueError(f"Requantization scale {real} out of range")
+    return multiplier, int(exponent)
+
+
+def activation_params(values):
+    """Asymmetric int8 scale / zero point covering values (and 0)"""
+    lo = min(float(values.min()), 0.0)
+    hi = max(float(values.max()), 0.0)
+    scale = np.float32(max(hi - lo, 1e-6) / 255.0)
+    zero = int(np.clip(round(-128 - lo / scale), -128, 127))
+    return scale, zero
+
+
+def activation_table(function, in_scale, in_zero, out_scale, out_zero):
+    """
+    256-entry int8 -> int8 table: entry i holds the quantized function of
+    the input value i - 128 (ai_engine.h, AI_ACT_LUT)
+    """
+    x = (np.arange(-128, 128) - in_zero) * np.float64(in_scale)
+    y = LUT_FUNCTIONS[function](x)
+    return np.clip(np.round(y / np.float64(out_scale)) + out_zero, -128, 127).astype(np.int8)
+
+
+class EngineQuantizer:
+    """
+    Post-training int8 quantization for the engine
+
+    Weights: symmetric, per output channel (or per tensor).
+    Activations: per tensor, ranges calibrated on sample inputs.
+    """
+
+    def __init__(self, per_channel=True):
+        self.per_channel = per_channel
+
+    def quantize(self, layers, input_shape, calibration, heads=None):
+        """
+        Args:
+            layers: Float layers (layers_from_keras / load_checkpoint); the
+                    shared backbone when heads are given
+            input_shape: (height, width, channels)
+            calibration: Float inputs in 0-1, shape (N, H, W, C)
+            heads: Optional {task: float layers} run on the backbone output
+                   (multi-task model, AI_MODEL_FLAG_HEADS)
+        """
+        x = calibration.astype(np.float32)
+        qlayers, shape, out_scale, out_zero = self.quantize_chain(
+            layers, x, tuple(input_shape), INPUT_SCALE, INPUT_ZERO)
+
+        qheads = []
+        if heads:
+            features = float_forward(layers, x)[-1]
+            for task, head_layers in sorted(heads.items()):
+                chain, _, scale, zero = self.quantize_chain(head_layers, features, shape, out_scale, out_zero)
+                qheads.append({"task": task, "layers": chain, "output_scale": scale, "output_zero": zero})
+
+        return EngineModel(tuple(input_shape), qlayers, out_scale, out_zero, heads=qheads)
+
+    def quantize_chain(self, layers, x, shape, in_scale, in_zero):
+        """
+        Quantize a chain of float layers fed x (float batch) quantized as
+        in_scale / in_zero; returns (layers, output shape, output scale,
+        output zero point)
+        """
+        pre_activations = []
+        outputs = float_forward(layers, x, pre_activations)
+        qlayers = []
+        for layer, activations, pre in zip(layers, outputs, pre_activations):
+            op = layer["op"]
+            h, w, c = shape
+            q = {"op": OP_CODES[op], "act": ACT_RELU if layer.get("relu") else ACT_NONE,
+                 "in_shape": shape, "in_zero": in_zero}
+            function = layer.get("activation")
+            if function and op not in ("conv", "dense", "temporal"):
+                raise ValueError(f"{function}: table activations fuse into conv / dense layers only")
+            if op == "temporal":
+                taps = layer["w"].shape[0]
+                if (h, w) != (1, 1) or not 2 <= taps <= MAX_TAPS:
+                    raise ValueError(f"Temporal layers take a 1x1 embedding and 2-{MAX_TAPS} taps")
+                q["in_shape"] = (taps, 1, c)
+            if layer.get("pool"):
+                if op != "conv":
+                    raise ValueError("Only convolutions fuse a max pool")
+                q["op"] = OP_CONV2D_3X3_POOL
+            if layer.get("input_mean"):
+                # Folded mean: the input zero point moves onto it, so padding stays exact
+                q["in_zero"] = in_zero + int(np.round(layer["input_mean"] / float(in_scale)))
+                if not -128 <= q["in_zero"] <= 127:
+                    raise ValueError(f"Input mean {layer['input_mean']} is outside the input range")
+
+            if op in ("maxpool", "gap"):
+                # Order-preserving ops keep the input quantization
+                shape = (h // 2, w // 2, c) if op == "maxpool" else (1, 1, c)
+                out_scale, out_zero = in_scale, in_zero
+            else:
+                kernel = layer["w"].astype(np.float64)
+                if op == "conv":
+                    kernel = kernel.transpose(3, 0, 1, 2)          # HWIO -> [out][3][3][in]
+                elif op == "temporal":
+                    kernel = kernel.transpose(2, 0, 1)             # [taps][in][out] -> [out][taps][in]
+                else:
+                    kernel = kernel.T                               # [in][out] -> [out][in]
+                out_c = kernel.shape[0]
+                flat = kernel.reshape(out_c, -1)
+
+                if self.per_channel:
+                    w_scale = np.abs(flat).max(axis=1) / 127.0
+                else:
+                    w_scale = np.full(out_c, np.abs(flat).max() / 127.0)
+                w_scale = np.where(w_scale > 0, w_scale, 1.0)
+
+                out_scale, out_zero = activation_params(activations)
+                acc_scale = float(in_scale) * w_scale
+
+                # Table activations: the accumulator requantizes to the table index
+                # (pre-activation range); the table maps it to the output range
+                req_scale = out_scale
+                if function:
+                    req_scale, index_zero = activation_params(pre)
+                    q["act"] = ACT_LUT
+                    q["lut"] = activation_table(function, req_scale, index_zero, out_scale, out_zero)
+
+                q["weights"] = np.clip(np.round(flat / w_scale[:, None]), -127, 127).astype(np.int8)
+                q["bias"] = np.round(layer["b"] / acc_scale).astype(np.int32)
+                mults, shifts = zip(*(quantize_multiplier(s / float(req_scale)) for s in acc_scale))
+                q["multiplier"] = np.array(mults, dtype=np.int32)
+                q["shift"] = np.array(shifts, dtype=np.int32)
+                shape = (h, w, out_c) if op == "conv" else (1, 1, out_c)
+                if layer.get("pool"):
+                    shape = (h // 2, w // 2, out_c)
+
+            q["out_shape"] = shape
+            q["out_zero"] = index_zero if function else out_zero
+            qlayers.append(q)
+            in_scale, in_zero = out_scale, out_zero
+
+        return qlayers, shape, in_scale, in_zero
+
+
+# ==================== ENGINE MODEL ====================
+
+class EngineModel:
+    """
+    Quantized model in the engine's layout, plus a bit-exact int8 reference
+
+    heads: task heads of a multi-task model, each {"task", "layers",
+    "output_scale", "output_zero"}; layers is then the shared backbone.
+    """
+
+    def __init__(self, input_shape, layers, output_scale, output_zero, patch_layers=0, patch_grid=0,
+                 heads=(), sparse=False):
+        self.input_shape = input_shape
+        self.layers = layers
+        self.output_scale = np.float32(output_scale)
+        self.output_zero = int(output_zero)
+        self.patch_layers = patch_layers
+        self.patch_grid = patch_grid
+        self.heads = list(heads)
+        self.sparse = sparse
+        if self.heads:
+            tasks = [h["task"] for h in self.heads]
+            if len(set(tasks)) != len(tasks) or not set(tasks) <= set(range(len(TASK_NAMES))) \
+                    or len(tasks) > MAX_HEADS or not all(h["layers"] for h in self.heads):
+                raise ValueError(f"Invalid heads: tasks {tasks}")
+            if sum(self.head_counts()) > MAX_OUTPUT:
+                raise ValueError(f"Heads produce {sum(self.head_counts())} values (max {MAX_OUTPUT})")
+
+    def head_counts(self):
+        """Values each head produces, in table order"""
+        return [int(np.prod(h["layers"][-1]["out_shape"])) for h in self.heads]
+
+    def table(self):
+        """
+        Layer table as written: the backbone, then per head its AI_OP_HEAD
+        record (task in the activation field, output quantization as its
+        tensor) and its layers
+        """
+        table = list(self.layers)
+        shape = self.layers[-1]["out_shape"]
+        for head in self.heads:
+            table.append({"op": OP_HEAD, "act": head["task"], "in_zero": 0, "out_zero": 0,
+                          "in_shape": shape, "out_shape": shape,
+                          "head": struct.pack("<fi", head["output_scale"], int(head["output_zero"]))})
+            table.extend(head["layers"])
+        return table
+
+    def patched(self, patch_layers, grid):
+        """
+        Same model with its first patch_layers layers (conv / maxpool only)
+        run on a grid x grid split of their output (ai_engine.h); 0 = full frame
+        """
+        if patch_layers:
+            ops = {l["op"] for l in self.layers[:patch_layers]}
+            oh, ow, _ = self.layers[patch_layers - 1]["out_shape"]
+            if not ops <= {*CONV_OPS, OP_MAXPOOL_2X2} or patch_layers >= len(self.layers) \
+                    or patch_layers > MAX_PATCH_LAYERS or not 1 <= grid <= min(oh, ow, 255):
+                raise ValueError(f"Cannot patch {patch_layers} layers on a {grid}x{grid} grid")
+        return EngineModel(self.input_shape, self.layers, self.output_scale, self.output_zero,
+                           patch_layers, grid if patch_layers else 0, self.heads, self.sparse)
+
+    def compressed(self, sparse=True):
+        """
+        Same model with post-ReLU maps stored compressed (FLAG_SPARSE, ai_engine.h)
+        Off unless asked for: the arena only grows and the decode passes cost
+        more than zero skipping saves on the models measured so far
+        (sparsity_report.py).
+        """
+        return EngineModel(self.input_shape, self.layers, self.output_scale, self.output_zero,
+                           self.patch_layers, self.patch_grid, self.heads, sparse)
+
+    def sparse_outputs(self):
+        """
+        Per table entry, whether it stores its output compressed: past the
+        patched stage, a ReLU conv or a max pool of a compressed map, feeding
+        a conv, max pool or dense layer (sparse_output() in ai_engine.c)
+        """
+        table = self.table()
+        outputs = []
+        for i, l in enumerate(table):
+            nxt = table[i + 1] if i + 1 < len(table) else None
+            producer = (l["op"] in CONV_OPS and l["act"] == ACT_RELU) or \
+                (l["op"] == OP_MAXPOOL_2X2 and bool(outputs) and outputs[-1])
+            outputs.append(self.sparse and i >= self.patch_layers and producer and nxt is not None and
+                           nxt["op"] in (*CONV_OPS, OP_MAXPOOL_2X2, OP_DENSE))
+        return outputs
+
+    def patch_tiles(self):
+        """
+        Per tile, every patched layer's input window (x, y, w, h), then the
+        tile itself; same traversal as patch_regions() in ai_engine.c
+        """
+        last = self.layers[self.patch_layers - 1]
+        oh, ow, _ = last["out_shape"]
+        g = self.patch_grid
+        for ty in range(g):
+            for tx in range(g):
+                x, y = tx * ow // g, ty * oh // g
+                r = (x, y, (tx + 1) * ow // g - x, (ty + 1) * oh // g - y)
+                regions = [r]
+                for l in reversed(self.layers[:self.patch_layers]):
+                    if l["op"] != OP_CONV2D_3X3:
+                        r = tuple(2 * v for v in r)
+                    if l["op"] != OP_MAXPOOL_2X2:
+                        x, y, w, h = r
+                        ih, iw, _ = l["in_shape"]
+                        x0, y0 = max(x - 1, 0), max(y - 1, 0)
+                        r = (x0, y0, min(x + w + 1, iw) - x0, min(y + h + 1, ih) - y0)
+                    regions.insert(0, r)
+                yield regions
+
+    @property
+    def arena_size(self):
+        """
+        Bytes for the activations: largest input + output pair (and fused
+        pool row buffer), and for a patched model the stage's output map plus
+        the largest tile ping-pong; head layers run above the backbone output.
+        Compressed maps count at their largest (sparse_size()).
+        """
+        def pair(l, in_sparse, out_sparse):
+            size = sparse_size(l["in_shape"]) if in_sparse else input_size(l)
+            size += sparse_size(l["out_shape"]) if out_sparse else int(np.prod(l["out_shape"]))
+            (_, iw, ic), (_, ow, oc) = l["in_shape"], l["out_shape"]
+            work = (window_height(l["op"]) * iw * ic if in_sparse else 0) + (ow * oc if out_sparse else 0)
+            return size + work + pool_rows_size(l, ow)
+
+        # Compressed maps (FLAG_SPARSE) at their largest, plus their work rows
+        table, sparse = self.table(), self.sparse_outputs()
+        backbone, need = 0, 0
+        for i, l in enumerate(table):
+            if l["op"] == OP_HEAD:
+                backbone = int(np.prod(self.layers[-1]["out_shape"]))
+            elif i >= self.patch_layers:
+                in_sparse = i > 0 and sparse[i - 1]
+                need = max(need, backbone + pair(l, in_sparse, sparse[i]))
+        if self.patch_layers:
+            stage = self.layers[:self.patch_layers]
+            tiles = max(w0 * h0 * l["in_shape"][2] + w1 * h1 * l["out_shape"][2] + pool_rows_size(l, w1)
+                        for regions in self.patch_tiles()
+                        for l, (_, _, w0, h0), (_, _, w1, h1) in zip(stage, regions, regions[1:]))
+            need = max(need, int(np.prod(stage[-1]["out_shape"])) + tiles)
+        return -(-need // 4) * 4
+
+    @property
+    def state_size(self):
+        """Temporal windows the engine keeps after the activations"""
+        return sum(int(np.prod(l["in_shape"])) for l in self.table() if l["op"] == OP_TEMPORAL_CONV)
+
+    @property
+    def scratch_size(self):
+        """GEMM A-panel bytes the engine keeps ahead of the activations"""
+        depths = [gemm_depth(l["weights"].shape[1]) for l in self.table() if "weights" in l]
+        depth = max(depths, default=0)
+        skip = -(-(depth // 4 * 2) // 4) * 4 if self.sparse else 0  # Live-step list (ai_gemm_skip_size)
+        return GEMM_MR * depth * 2 + skip
+
+    def to_bytes(self, packed=True):
+        """
+        FDM1 image; every tensor starts on a MODEL_BLOCK_SIZE boundary
+        packed: weights as GEMM panels (FLAG_PACKED_B) instead of [out][in]
+        """
+        def align(n):
+            return -(-n // MODEL_BLOCK_SIZE) * MODEL_BLOCK_SIZE
+
+        table = self.table()
+        table_end = HEADER.size + LAYER.size * len(table)
+        tensors = bytearray(align(table_end) - table_end)
+        offset = align(table_end)
+        records = []
+
+        for l in table:
+            offsets = [0, 0, 0, 0]
+            blobs = {}
+            if "weights" in l:
+                weights = pack_weights(l["weights"]) if packed else l["weights"]
+                blobs = {0: weights.tobytes(), 1: l["bias"].astype("<i4").tobytes(),
+                         2: l["multiplier"].astype("<i4").tobytes() + l["shift"].astype("<i4").tobytes()}
+                if "lut" in l:
+                    blobs[3] = l["lut"].tobytes()
+            elif "head" in l:
+                blobs = {2: l["head"]}
+            for i, blob in blobs.items():
+                offsets[i] = offset
+                padded = blob + bytes(align(len(blob)) - len(blob))
+                tensors += padded
+                offset += len(padded)
+
+            (ih, iw, ic), (oh, ow, oc) = l["in_shape"], l["out_shape"]
+            records.append(LAYER.pack(l["op"], l["act"], l["in_zero"], l["out_zero"],
+                                      iw, ih, ic, ow, oh, oc, *offsets))
+
+        h, w, c = self.input_shape
+        flags = (FLAG_PACKED_B if packed else 0) | (FLAG_PATCHED if self.patch_layers else 0) | \
+            (FLAG_HEADS if self.heads else 0) | (FLAG_SPARSE if self.sparse else 0)
+        header = HEADER.pack(ENGINE_MAGIC, ENGINE_VERSION, len(table), w, h, c,
+                             self.patch_layers, self.patch_grid, INPUT_SCALE, INPUT_ZERO,
+                             self.output_scale, self.output_zero, self.arena_size, flags)
+        return header + b"".join(records) + bytes(tensors)
+
+    def run(self, x, tasks=None):
+        """
+        Int8 inference on a float batch (N, H, W, C), same arithmetic as
+        ai_engine.c; returns dequantized logits (N, outputs), every head's
+        values in table order for a multi-task model (tasks: only those
+        heads). Patched execution gives identical results, so this always
+        runs full frame.
+        """
+        q = np.rint(x.astype(np.float32) / INPUT_SCALE) + INPUT_ZERO
+        q = self.run_layers(self.layers, np.clip(q, -128, 127).astype(np.int64))
+        if not self.heads:
+            return self.dequantize(q, self.output_scale, self.output_zero)
+        return np.concatenate([
+            self.dequantize(self.run_layers(h["layers"], q), h["output_scale"], h["output_zero"])
+            for h in self.heads if tasks is None or h["task"] in tasks
+        ], axis=1)
+
+    @staticmethod
+    def dequantize(q, scale, zero):
+        return (q.reshape(len(q), -1) - zero).astype(np.float32) * np.float32(scale)
+
+    @staticmethod
+    def run_layers(layers, q):
+        """
+        Int8 layers on an int8 batch (as int64 NHWC); returns their output
+        Temporal layers take the batch as consecutive frames from a reset state.
+        """
+        for l in layers:
+            op = l["op"]
+            if op == OP_MAXPOOL_2X2:
+                n, h, w, c = q.shape
+                q = q[:, :h // 2 * 2, :w // 2 * 2, :].reshape(n, h // 2, 2, w // 2, 2, c).max(axis=(2, 4))
+                continue
+            if op == OP_GLOBAL_AVGPOOL:
+                n, h, w, c = q.shape
+                s = (q - l["in_zero"]).sum(axis=(1, 2), keepdims=True)
+                cnt = h * w
+                mean = np.where(s >= 0, (s + cnt // 2) // cnt, -((-s + cnt // 2) // cnt))
+                q = np.clip(mean + l["in_zero"], -128, 127)
+                continue
+
+            x0 = q - l["in_zero"]
+            weights = l["weights"].astype(np.int64)
+            if op in CONV_OPS:
+                n, h, w, c = x0.shape
+                padded = np.pad(x0, ((0, 0), (1, 1), (1, 1), (0, 0)))
+                kernel = weights.reshape(len(weights), 3, 3, c)
+                acc = np.zeros((n, h, w, len(weights)), dtype=np.int64)
+                for ky in range(3):
+                    for kx in range(3):
+                        acc += padded[:, ky:ky + h, kx:kx + w, :] @ kernel[:, ky, kx, :].T
+            elif op == OP_TEMPORAL_CONV:
+                # Reset windows hold in_zero, i.e. 0 after the zero point
+                taps, _, c = l["in_shape"]
+                frames = np.concatenate([np.zeros((taps - 1, c), np.int64), x0.reshape(len(x0), -1)])
+                windows = np.stack([frames[t:t + taps].reshape(-1) for t in range(len(x0))])
+                acc = (windows @ weights.T).reshape(len(x0), 1, 1, -1)
+            else:
+                acc = (x0.reshape(len(x0), -1) @ weights.T).reshape(len(x0), 1, 1, -1)
+
+            acc = acc + l["bias"]
+            right = 31 - l["shift"].astype(np.int64)
+            v = (acc * l["multiplier"].astype(np.int64) + (np.int64(1) << (right - 1))) >> right
+            lo = l["out_zero"] if l["act"] == ACT_RELU else -128
+            q = np.clip(v + l["out_zero"], lo, 127)
+            if l["act"] == ACT_LUT:
+                q = l["lut"].astype(np.int64)[q + 128]
+            if op == OP_CONV2D_3X3_POOL:
+                n, h, w, c = q.shape
+                q = q[:, :h // 2 * 2, :w // 2 * 2, :].reshape(n, h // 2, 2, w // 2, 2, c).max(axis=(2, 4))
+        return q
+
+    def cam(self, x):
+        """
+        Class activation map of the fire output, as ai_engine_run_cam() (in
+        float64, so within rounding of the engine's float32): the fire -
+        no_fire logit margin split over the positions of the feature map
+        feeding the logits layer - flattened, pooled or through one hidden
+        dense layer whose active ReLUs mask it. Returns per-position values
+        (N, map_h, map_w) and the heat grid (N, CAM_GRID, CAM_GRID).
+        """
+        path, scale = self.layers, float(self.output_scale)
+        if self.heads:
+            fire = next((h for h in self.heads if h["task"] == TASK_FIRE), None)
+            if fire is None:
+                raise ValueError("No fire head to map")
+            path, scale = self.layers + fire["layers"], float(fire["output_scale"])
+
+        logits = path[-1]
+        if logits["op"] != OP_DENSE or logits["out_shape"][2] != 2 or logits["act"] == ACT_LUT:
+            raise ValueError("The fire output must end in a 2-unit dense layer without a table activation")
+        tail = 1
+        if np.prod(logits["in_shape"][:2]) == 1:
+            prev = path[-2] if len(path) > 1 else None
+            if prev is None or not (prev["op"] == OP_GLOBAL_AVGPOOL or (
+                    prev["op"] == OP_DENSE and prev["act"] != ACT_LUT and np.prod(prev["in_shape"][:2]) > 1)):
+                raise ValueError("Unsupported tail: the logits must read the feature map, its pool "
+                                 "or one hidden dense layer on it")
+            tail = 2
+        first = path[-tail]
+
+        def step(l):
+            return l["multiplier"].astype(np.float64) * 2.0 ** (l["shift"].astype(np.float64) - 31)
+
+        q = np.clip(np.rint(x.astype(np.float32) / INPUT_SCALE) + INPUT_ZERO, -128, 127).astype(np.int64)
+        fmap = self.run_layers(path[:-tail], q) if len(path) > tail else q
+        n, h, w, c = fmap.shape
+        f0 = (fmap - first["in_zero"]).astype(np.float64)
+
+        weights = logits["weights"].astype(np.float64)
+        m = step(logits)
+        coef = m[1] * weights[1] - m[0] * weights[0]
+        if tail == 1:
+            values = (f0 * coef.reshape(h, w, c)).sum(axis=-1)
+        elif first["op"] == OP_GLOBAL_AVGPOOL:
+            values = (f0 * coef).sum(axis=-1) / (h * w)
+        else:
+            hidden = self.run_layers([first], fmap).reshape(n, -1)
+            lo = first["out_zero"] if first["act"] == ACT_RELU else -128
+            u = coef * step(first) * ((hidden > lo) & (hidden < 127))
+            kernel = first["weights"].astype(np.float64).reshape(-1, h, w, c)
+            values = np.einsum("nyxc,jyxc,nj->nyx", f0, kernel, u)
+        values *= scale
+
+        # Spread by area over the grid, as the engine does
+        heat = np.zeros((n, CAM_GRID, CAM_GRID))
+        for y in range(h):
+            cy0, cy1 = y * CAM_GRID // h, (y + 1) * CAM_GRID // h
+            cy1 = max(cy1, cy0 + 1)
+            for xx in range(w):
+                cx0, cx1 = xx * CAM_GRID // w, (xx + 1) * CAM_GRID // w
+                cx1 = max(cx1, cx0 + 1)
+                heat[:, cy0:cy1, cx0:cx1] += (values[:, y, xx] / ((cx1 - cx0) * (cy1 - cy0)))[:, None, None]
+        return values, heat
+
+    # ---------- Cost estimates ----------
+
+    def layer_costs(self):
+        """
+        Per-layer MACs and M7 cycle estimate (packed weights); conv, dense
+        and temporal layers also report their GEMM shape m x n x k. Patched layers count
+        every tile, halo recomputation included (full_macs: without it).
+        Head layers carry their "task"; each head also pays the copy of
+        the backbone output it runs on.
+        """
+        tiles = list(self.patch_tiles()) if self.patch_layers else []
+        entries = [(l, None, False) for l in self.layers]
+        entries += [(l, h["task"], j == 0) for h in self.heads for j, l in enumerate(h["layers"])]
+        backbone = int(np.prod(self.layers[-1]["out_shape"]))
+        costs = []
+        for i, (l, task, head_start) in enumerate(entries):
+            (ih, iw, ic), (oh, ow, oc) = l["in_shape"], l["out_shape"]
+            outputs = oh * ow * oc
+            cost = {"op": l["op"], "macs": 0, "full_macs": 0}
+            if task is not None:
+                cost["task"] = task
+            if l["op"] in (*CONV_OPS, OP_DENSE, OP_TEMPORAL_CONV):
+                fused = l["op"] == OP_CONV2D_3X3_POOL
+                m, n, k = oh * ow * (4 if fused else 1), oc, l["weights"].shape[1]
+                cost.update(m=m, n=n, k=k, macs=m * n * k, full_macs=m * n * k)
+                windows = [r[i + 1][2:] for r in tiles] if i < self.patch_layers else [(ow, oh)]
+                # GEMM calls (rows, count): a fused pool runs two conv rows per call
+                calls = [(4 * w, h) if fused else (w * h, 1) for w, h in windows]
+                rows = sum(s * c for s, c in calls)
+                cost["macs"] = rows * n * k
+                cost["cycles"] = sum(gemm_cycles(s, n, k) * c for s, c in calls)
+                if l["act"] == ACT_LUT:
+                    cost["cycles"] += rows * n * M7_COST["lut"]
+                if fused:
+                    cost["cycles"] += sum(w * h for w, h in windows) * n * M7_COST["pool_output"]
+            elif l["op"] == OP_MAXPOOL_2X2:
+                if i < self.patch_layers:
+                    outputs = sum(r[i + 1][2] * r[i + 1][3] for r in tiles) * oc
+                cost["cycles"] = outputs * M7_COST["pool_output"]
+            else:
+                cost["cycles"] = ih * iw * ic * M7_COST["gap_input"]
+            if l["op"] == OP_TEMPORAL_CONV:
+                cost["cycles"] += int(np.prod(l["in_shape"])) * M7_COST["copy"]  # Window shift
+            if head_start:
+                cost["cycles"] += backbone * M7_COST["copy"]
+            costs.append(cost)
+        return costs
+
+    def m7_cycles(self, tasks=None):
+        """M7 cycles for one frame; tasks: run only those heads (default all)"""
+        inputs = int(np.prod(self.input_shape))
+        if self.patch_layers:
+            inputs = sum(r[0][2] * r[0][3] for r in self.patch_tiles()) * self.input_shape[2]
+        return (inputs * M7_COST["input"] +
+                sum(c["cycles"] for c in self.layer_costs()
+                    if tasks is None or c.get("task") is None or c["task"] in tasks))
+
+    def m7_latency_ms(self, tasks=None):
+        return self.m7_cycles(tasks) / M7_CLOCK_HZ * 1000
+
+    def macs(self):
+        return sum(c["macs"] for c in self.layer_costs())
+
+
+# ==================== C SOURCE ====================
+
+def write_model_source(blob, path, model_name, input_shape, confidence_threshold=0.7,
+                       source="", kind="TFLite model", prefix=""):
+    """
+    Write model_data.c (definitions only; the template's model_data.h
+    declares them) for a model image
+
+    prefix names a second model's symbols (prefix="audio_":
+    audio_model_data, audio_model_data_len, audio_model_info).
+
+    The image is padded to MODEL_BLOCK_SIZE and also saved next to it as
+    model_data.bin, the base/target image for delta updates
+    (model_delta_update.py diff old.bin new.bin).
+    """
+    # Whole blocks: a retrained model then differs only in the blocks it touches
+    blob = bytes(blob) + bytes(-len(blob) % MODEL_BLOCK_SIZE)
+    Path(path).with_suffix(".bin").write_bytes(blob)
+
+    with open(path, "w") as f:
+        f.write(f"// Auto-generated {kind} array\n")
+        if source:
+            f.write(f"// Source: {source}\n")
+        f.write(f"// Size: {len(blob)} bytes\n\n")
+        f.write('#include "model_data.h"\n\n')
+        f.write(f"const uint8_t {prefix}model_data[] = {{\n")
+
+        # Write bytes in rows of 16
+        for i in range(0, len(blob), 16):
+            chunk = blob[i:i+16]
+            hex_str = ', '.join(f"0x{b:02x}" for b in chunk)
+            f.write(f"    {hex_str},\n")
+
+        f.write("};\n")
+        f.write(f"const uint32_t {prefix}model_data_len = sizeof({prefix}model_data);\n\n")
+
+        f.write(f"const ModelInfo {prefix}model_info = {{\n")
+        f.write(f'    .model_name = "{model_name}",\n')
+        f.write('    .model_version = "1.0",\n')
+        f.write(f"    .input_width = {input_shape[1]},\n")
+        f.write(f"    .input_height = {input_shape[0]},\n")
+        f.write(f"    .input_channels = {input_shape[2]},\n")
+        f.write(f"    .confidence_threshold = {confidence_threshold}f\n")
+        f.write("};\n")
+    return path
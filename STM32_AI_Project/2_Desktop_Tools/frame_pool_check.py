@@ -0,0 +1,332 @@
+"""
+Frame Pool Checker
+Drive the firmware's frame pool (frame_pool.c) on the host through the
+cases the capture loop relies on: reclaiming history frames when every
+buffer is held, refusing and counting frames under FRAME_DROP_NEWEST,
+queue overwrite / refusal, and threads acquiring, sharing and handing
+over frames concurrently (Host/frame_pool_stress.c). Every case ends with
+a leak check: no buffer in use, no reference left, the free bitmap full.
+"""
+
+import argparse
+import ctypes
+import json
+
+import numpy as np
+
+from native_build import FIRMWARE_DIR, load_library, report_path
+
+
+CACHE_LINE = 64                      # AI_CACHE_LINE in host builds
+MAX_BUFFERS = 32                     # FRAME_POOL_MAX_BUFFERS
+QUEUE_MAX = 16                       # FRAME_QUEUE_MAX
+FRAME_DROP_NEWEST = 0
+FRAME_DROP_OLDEST = 1
+FRAME_OK = 0
+FRAME_ERR_FULL = -1
+
+# main.c's sizing
+FRAME_BUFFERS = 8
+FRAME_HISTORY_DEPTH = 4
+FRAME_UPLINK_DEPTH = 6
+
+SOURCES = ["frame_pool.c", str(FIRMWARE_DIR / "Host" / "frame_pool_stress.c")]
+
+RECLAIM = ctypes.CFUNCTYPE(ctypes.c_int32, ctypes.c_void_p)
+
+
+class FrameBuffer(ctypes.Structure):
+    _fields_ = [("data", ctypes.POINTER(ctypes.c_uint8)), ("seq", ctypes.c_uint32),
+                ("timestamp_ms", ctypes.c_uint32), ("width", ctypes.c_uint16), ("height", ctypes.c_uint16),
+                ("channels", ctypes.c_uint8), ("index", ctypes.c_uint8), ("refs", ctypes.c_uint16)]
+
+
+class FramePoolOps(ctypes.Structure):
+    _fields_ = [("reclaim", RECLAIM), ("user", ctypes.c_void_p)]
+
+
+class FramePool(ctypes.Structure):
+    _fields_ = [("frames", FrameBuffer * MAX_BUFFERS), ("count", ctypes.c_uint32),
+                ("frame_size", ctypes.c_uint32), ("policy", ctypes.c_uint8), ("ops", FramePoolOps),
+                ("free", ctypes.c_uint32), ("seq", ctypes.c_uint32),
+                ("acquired", ctypes.c_uint32), ("exhausted", ctypes.c_uint32),
+                ("reclaimed", ctypes.c_uint32), ("dropped", ctypes.c_uint32), ("peak", ctypes.c_uint32)]
+
+
+class FrameQueue(ctypes.Structure):
+    _fields_ = [("frames", ctypes.POINTER(FrameBuffer) * QUEUE_MAX), ("depth", ctypes.c_uint32),
+                ("head", ctypes.c_uint32), ("tail", ctypes.c_uint32),
+                ("overwritten", ctypes.c_uint32), ("refused", ctypes.c_uint32)]
+
+
+class FrameStressResult(ctypes.Structure):
+    _fields_ = [("acquired", ctypes.c_uint32), ("refused", ctypes.c_uint32),
+                ("handed_over", ctypes.c_uint32), ("corrupted", ctypes.c_uint32)]
+
+
+FRAME = ctypes.POINTER(FrameBuffer)
+
+
+class FramePoolLib:
+    """Host build of frame_pool.c with the stress threads"""
+
+    def __init__(self):
+        self.lib = lib = load_library("fire_frame_pool", SOURCES, ["-pthread"])
+        pool, queue = ctypes.POINTER(FramePool), ctypes.POINTER(FrameQueue)
+        lib.frame_pool_init.argtypes = [pool, ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32,
+                                        ctypes.c_uint8, ctypes.POINTER(FramePoolOps)]
+        lib.frame_pool_init.restype = ctypes.c_uint32
+        lib.frame_acquire.argtypes = [pool]
+        lib.frame_acquire.restype = FRAME
+        lib.frame_retain.argtypes = [FRAME]
+        lib.frame_retain.restype = None
+        lib.frame_release.argtypes = [pool, FRAME]
+        lib.frame_release.restype = None
+        lib.frame_pool_in_use.argtypes = [pool]
+        lib.frame_pool_in_use.restype = ctypes.c_uint32
+        lib.frame_queue_init.argtypes = [queue, ctypes.c_uint32]
+        lib.frame_queue_init.restype = None
+        lib.frame_queue_push.argtypes = [pool, queue, FRAME, ctypes.c_int32]
+        lib.frame_queue_push.restype = ctypes.c_int32
+        lib.frame_queue_pop.argtypes = [queue]
+        lib.frame_queue_pop.restype = FRAME
+        lib.frame_queue_clear.argtypes = [pool, queue]
+        lib.frame_queue_clear.restype = None
+        lib.frame_pool_stress.argtypes = [pool, ctypes.c_uint32, ctypes.c_uint32,
+                                          ctypes.POINTER(FrameStressResult)]
+        lib.frame_pool_stress.restype = ctypes.c_int32
+
+    def pool(self, buffers, frame_size, policy, ops=None):
+        """Initialized pool over cache-line aligned memory, like frame_memory in main.c"""
+        stride = -(-frame_size // CACHE_LINE) * CACHE_LINE
+        raw = np.zeros(buffers * stride + CACHE_LINE, dtype=np.uint8)
+        start = (-raw.ctypes.data) % CACHE_LINE
+        memory = raw[start:start + buffers * stride]
+        pool = FramePool()
+        count = self.lib.frame_pool_init(ctypes.byref(pool), memory.ctypes.data, memory.nbytes, frame_size,
+                                         policy, ctypes.byref(ops) if ops else None)
+        pool._memory = memory    # Kept alive with the pool
+        return pool, count
+
+    def queue(self, depth):
+        queue = FrameQueue()
+        self.lib.frame_queue_init(ctypes.byref(queue), depth)
+        return queue
+
+    def leaks(self, pool):
+        """Buffers in use, references left and free bits missing (all 0 when clean)"""
+        refs = sum(pool.frames[i].refs for i in range(pool.count))
+        full = (1 << pool.count) - 1 if pool.count < 32 else 0xFFFFFFFF
+        return {"in_use": self.lib.frame_pool_in_use(ctypes.byref(pool)), "refs": refs,
+                "missing_free": bin(full & ~pool.free).count("1")}
+
+
+def stamp(frame, value):
+    frame.contents.data[0] = value & 0xFF
+
+
+def stamped(frame):
+    return frame.contents.data[0]
+
+
+def frame_count(queue):
+    return queue.head - queue.tail
+
+
+# ==================== CASES ====================
+# Each returns (passed, details); the pool must be empty again at the end
+
+def case_layout(fp, buffers, frame_size):
+    """Buffers: count capped by the memory, cache-line aligned, disjoint"""
+    pool, count = fp.pool(buffers, frame_size, FRAME_DROP_NEWEST)
+    addresses = [ctypes.addressof(pool.frames[i].data.contents) for i in range(count)]
+    stride = -(-frame_size // CACHE_LINE) * CACHE_LINE
+    aligned = all(a % CACHE_LINE == 0 for a in addresses)
+    disjoint = all(b - a >= stride for a, b in zip(addresses, addresses[1:]))
+    leaks = fp.leaks(pool)
+    passed = count == buffers and aligned and disjoint and not any(leaks.values())
+    return passed, {"buffers": count, "aligned": aligned, "disjoint": disjoint, **leaks}
+
+
+def case_reclaim(fp, frames):
+    """
+    main.c's capture loop and sizing under FRAME_DROP_OLDEST: a 4-frame
+    history and a 6-frame uplink backlog that is never sent (both
+    overwrite), every third frame going to the uplink; acquire must
+    reclaim history frames, never refuse one and never hand out a buffer a
+    queue still holds. Then with every buffer held outside the history the
+    next frame is dropped.
+    """
+    lib = fp.lib
+    buffers = FRAME_BUFFERS
+    history, uplink = fp.queue(FRAME_HISTORY_DEPTH), fp.queue(FRAME_UPLINK_DEPTH)
+    state = {}
+
+    def reclaim(user):
+        oldest = lib.frame_queue_pop(ctypes.byref(history))
+        if not oldest:
+            return 0
+        lib.frame_release(ctypes.byref(state["pool"]), oldest)
+        return 1
+
+    ops = FramePoolOps(RECLAIM(reclaim), None)
+    pool, _ = fp.pool(buffers, 256, FRAME_DROP_OLDEST, ops)
+    state["pool"] = pool
+    p = ctypes.byref(pool)
+
+    got, overwritten_live = 0, 0
+    for n in range(frames):
+        frame = lib.frame_acquire(p)
+        if not frame:
+            break
+        got += 1
+        stamp(frame, n)
+        lib.frame_queue_push(p, ctypes.byref(history), frame, 1)
+        if n % 3 == 0:
+            lib.frame_queue_push(p, ctypes.byref(uplink), frame, 1)
+        lib.frame_release(p, frame)
+
+        # Frames still queued on the uplink keep their contents
+        for i in range(frame_count(uplink)):
+            queued = uplink.frames[(uplink.tail + i) % QUEUE_MAX]
+            if stamped(queued) != (queued.contents.seq & 0xFF):
+                overwritten_live += 1
+
+    dropped_in_loop = pool.dropped
+
+    # Hold every buffer the history gives up: the next acquire has nothing
+    # left to reclaim and is dropped
+    held = []
+    while len(held) <= buffers:
+        frame = lib.frame_acquire(p)
+        if not frame:
+            break
+        held.append(frame)
+    refused_when_empty = (len(held) == buffers - frame_count(uplink) and frame_count(history) == 0 and
+                          pool.dropped == dropped_in_loop + 1)
+    for frame in held:
+        lib.frame_release(p, frame)
+
+    lib.frame_queue_clear(p, ctypes.byref(history))
+    lib.frame_queue_clear(p, ctypes.byref(uplink))
+    leaks = fp.leaks(pool)
+    details = {"frames": got, "exhausted": pool.exhausted, "reclaimed": pool.reclaimed,
+               "dropped": dropped_in_loop, "peak": pool.peak, "uplink_overwritten": uplink.overwritten,
+               "live_frames_overwritten": overwritten_live, "refused_when_empty": refused_when_empty, **leaks}
+    passed = (got == frames and dropped_in_loop == 0 and pool.reclaimed > 0 and overwritten_live == 0
+              and refused_when_empty and not any(leaks.values()))
+    return passed, details
+
+
+def case_drop_newest(fp, buffers, attempts):
+    """FRAME_DROP_NEWEST with every buffer held: each acquire is refused and counted"""
+    lib = fp.lib
+    pool, _ = fp.pool(buffers, 128, FRAME_DROP_NEWEST)
+    p = ctypes.byref(pool)
+
+    held = [lib.frame_acquire(p) for _ in range(buffers)]
+    refused = sum(1 for _ in range(attempts) if not lib.frame_acquire(p))
+    lib.frame_release(p, held.pop())
+    again = lib.frame_acquire(p)
+    held.append(again)
+    for frame in held:
+        lib.frame_release(p, frame)
+
+    leaks = fp.leaks(pool)
+    details = {"refused": refused, "exhausted": pool.exhausted, "dropped": pool.dropped,
+               "acquired": pool.acquired, "peak": pool.peak, **leaks}
+    passed = (all(held) and refused == attempts and pool.dropped == attempts and
+              pool.exhausted == attempts and pool.acquired == buffers + 1 and pool.peak == buffers and
+              not any(leaks.values()))
+    return passed, details
+
+
+def case_queues(fp):
+    """A full queue overwrites its oldest frame or refuses the push, by flag"""
+    lib = fp.lib
+    pool, _ = fp.pool(4, 128, FRAME_DROP_NEWEST)
+    p = ctypes.byref(pool)
+    ring, strict = fp.queue(2), fp.queue(2)
+
+    results = []
+    for n in range(4):
+        frame = lib.frame_acquire(p)
+        stamp(frame, n)
+        lib.frame_queue_push(p, ctypes.byref(ring), frame, 1)
+        results.append(lib.frame_queue_push(p, ctypes.byref(strict), frame, 0))
+        lib.frame_release(p, frame)
+
+    newest = [stamped(ring.frames[(ring.tail + i) % QUEUE_MAX]) for i in range(2)]
+    oldest = [stamped(strict.frames[(strict.tail + i) % QUEUE_MAX]) for i in range(2)]
+    in_use = lib.frame_pool_in_use(p)
+    lib.frame_queue_clear(p, ctypes.byref(ring))
+    lib.frame_queue_clear(p, ctypes.byref(strict))
+
+    leaks = fp.leaks(pool)
+    details = {"overwritten": ring.overwritten, "refused": strict.refused, "kept_overwrite": newest,
+               "kept_refuse": oldest, "in_use_queued": in_use, **leaks}
+    passed = (ring.overwritten == 2 and strict.refused == 2 and newest == [2, 3] and oldest == [0, 1] and
+              results == [FRAME_OK, FRAME_OK, FRAME_ERR_FULL, FRAME_ERR_FULL] and in_use == 4 and
+              not any(leaks.values()))
+    return passed, details
+
+
+def case_threads(fp, buffers, threads, iterations):
+    """Concurrent acquire / retain / cross-thread release (frame_pool_stress())"""
+    pool, _ = fp.pool(buffers, 256, FRAME_DROP_NEWEST)
+    result = FrameStressResult()
+    status = fp.lib.frame_pool_stress(ctypes.byref(pool), threads, iterations, ctypes.byref(result))
+
+    leaks = fp.leaks(pool)
+    details = {"threads": threads, "acquired": result.acquired, "refused": result.refused,
+               "handed_over": result.handed_over, "corrupted": result.corrupted,
+               "pool_acquired": pool.acquired, "pool_dropped": pool.dropped, "peak": pool.peak, **leaks}
+    passed = (status == 0 and result.corrupted == 0 and result.acquired == pool.acquired and
+              result.refused == pool.dropped and result.acquired + result.refused == threads * iterations and
+              not any(leaks.values()))
+    return passed, details
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Frame pool checker")
+    parser.add_argument("--buffers", type=int, default=8, help="Pool buffers of the layout, drop and thread cases")
+    parser.add_argument("--frames", type=int, default=64, help="Capture loop frames (reclaim case)")
+    parser.add_argument("--threads", type=int, default=4)
+    parser.add_argument("--iterations", type=int, default=100000, help="Rounds per stress thread")
+    parser.add_argument("--output", default=report_path("frame_pool_report.json"))
+    args = parser.parse_args()
+
+    fp = FramePoolLib()
+
+    print("=" * 60)
+    print("FRAME POOL CHECK")
+    print("=" * 60)
+    print(f"{args.buffers} buffers | {args.frames} capture frames | "
+          f"{args.threads} threads x {args.iterations} rounds")
+    print()
+
+    cases = [("layout", lambda: case_layout(fp, args.buffers, 1000)),
+             ("reclaim under a full pool", lambda: case_reclaim(fp, args.frames)),
+             ("drop newest", lambda: case_drop_newest(fp, args.buffers, 5)),
+             ("queue overwrite / refuse", lambda: case_queues(fp)),
+             ("concurrent threads", lambda: case_threads(fp, args.buffers, args.threads, args.iterations))]
+    results = []
+    for name, run in cases:
+        passed, details = run()
+        results.append({"case": name, "passed": passed, **details})
+        mark = "✓" if passed else "⚠"
+        summary = ", ".join(f"{k} {v}" for k, v in details.items())
+        print(f"{mark} {name:26} {summary}")
+
+    passed = all(r["passed"] for r in results)
+    with open(args.output, "w") as f:
+        json.dump({"cases": results, "passed": passed}, f, indent=2)
+
+    print()
+    print(f"{'✓ Frame pool check passed' if passed else '⚠ Frame pool check FAILED'}")
+    print(f"Report: {args.output}")
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
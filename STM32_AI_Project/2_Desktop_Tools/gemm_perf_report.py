@@ -0,0 +1,178 @@
+"""
+GEMM Performance Report
+Per-layer throughput of the firmware's int8 GEMM core (ai_gemm.c) for the
+fire detection model: GEMM shape, MACs, Cortex-M7 cycles estimated by the
+cost model (gemm_cycles(), not a measurement: dut_benchmark.py times the
+board with DWT->CYCCNT) and measured host cycles, each as MACs/cycle
+against its own target's peak
+"""
+
+import argparse
+import ctypes
+import time
+
+import numpy as np
+
+from engine_model import (
+    ACT_RELU, CONV_OPS, M7_PEAK_MACS_PER_CYCLE, EngineQuantizer, gemm_cycles, load_checkpoint, pack_weights,
+    random_layers
+)
+from native_build import load_library
+
+
+# Same topology as FireDetectionModelBuilder.create_model()
+INPUT_SHAPE = (32, 32, 1)
+
+# Host int8 GEMM peak of the native build (-O2, baseline x86-64): one SSE2
+# PMADDWD is 8 MACs, two issue per cycle
+HOST_PEAK_MACS_PER_CYCLE = 16.0
+
+
+def host_clock_ghz():
+    """Clock from /proc/cpuinfo, or None where it is not available"""
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("cpu MHz"):
+                    return float(line.split(":")[1]) / 1000.0
+    except (OSError, ValueError):
+        pass
+    return None
+
+
+class AiGemmParams(ctypes.Structure):
+    """Mirror of AiGemmParams (ai_gemm.h)"""
+    _fields_ = [
+        ("weights", ctypes.c_void_p),
+        ("packed", ctypes.c_uint32),
+        ("n", ctypes.c_uint32),
+        ("k", ctypes.c_uint32),
+        ("bias", ctypes.c_void_p),
+        ("multiplier", ctypes.c_void_p),
+        ("shift", ctypes.c_void_p),
+        ("a_zero", ctypes.c_int32),
+        ("out_zero", ctypes.c_int32),
+        ("out_min", ctypes.c_int32),
+        ("lut", ctypes.c_void_p),
+        ("skip", ctypes.c_uint32),
+        ("pool", ctypes.c_void_p),
+    ]
+
+
+class GemmBench:
+    """ctypes front end for a host build of ai_gemm.c"""
+
+    def __init__(self, extra_flags=()):
+        self.lib = load_library("fire_gemm", ["ai_gemm.c"], extra_flags)
+        params_p = ctypes.POINTER(AiGemmParams)
+        self.lib.ai_gemm_conv3x3.argtypes = [params_p, ctypes.c_void_p, ctypes.c_uint32,
+                                             ctypes.c_uint32, ctypes.c_uint32, ctypes.c_void_p,
+                                             ctypes.c_void_p]
+        self.lib.ai_gemm_conv3x3.restype = None
+        self.lib.ai_gemm_dense.argtypes = [params_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p]
+        self.lib.ai_gemm_dense.restype = None
+
+    def time_layer(self, layer, repeats):
+        """Median seconds per call for one quantized conv/dense layer"""
+        ih, iw, ic = layer["in_shape"]
+        n, k = layer["weights"].shape
+        weights = pack_weights(layer["weights"])
+        bias = layer["bias"].astype("<i4")
+        quant = np.concatenate([layer["multiplier"], layer["shift"]]).astype("<i4")
+        out_min = layer["out_zero"] if layer["act"] == ACT_RELU else -128
+        lut = layer["lut"] if "lut" in layer else None
+
+        params = AiGemmParams(weights.ctypes.data, 1, n, k, bias.ctypes.data, quant.ctypes.data,
+                              quant[n:].ctypes.data, layer["in_zero"], layer["out_zero"], out_min,
+                              lut.ctypes.data if lut is not None else None, 0, None)
+
+        rng = np.random.default_rng(0)
+        x = rng.integers(-128, 128, ih * iw * ic).astype(np.int8)
+        # A fused conv + pool is timed as its GEMM: the full-resolution conv
+        out = np.empty(ih * iw * n if layer["op"] in CONV_OPS else n, dtype=np.int8)
+        scratch = np.empty(-(-k // 4) * 4 * 2, dtype=np.int32)  # 2 rows of int16, word aligned
+
+        if layer["op"] in CONV_OPS:
+            def call():
+                self.lib.ai_gemm_conv3x3(ctypes.byref(params), x.ctypes.data, iw, ih, ic,
+                                         out.ctypes.data, scratch.ctypes.data)
+        else:
+            def call():
+                self.lib.ai_gemm_dense(ctypes.byref(params), x.ctypes.data, out.ctypes.data,
+                                       scratch.ctypes.data)
+
+        call()
+        times = []
+        for _ in range(repeats):
+            start = time.perf_counter()
+            call()
+            times.append(time.perf_counter() - start)
+        return float(np.median(times))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="GEMM core performance report")
+    parser.add_argument("--checkpoint", help=".npz from save_checkpoint() (default: random weights)")
+    parser.add_argument("--repeats", type=int, default=50, help="Timed calls per layer")
+    parser.add_argument("--host-ghz", type=float,
+                        help="Host clock used to convert time to cycles (default: /proc/cpuinfo, else 3.0)")
+    parser.add_argument("--host-peak", type=float, default=HOST_PEAK_MACS_PER_CYCLE,
+                        help="Host peak MACs/cycle for the host efficiency column")
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    clock_source = "--host-ghz"
+    if args.host_ghz is None:
+        args.host_ghz = host_clock_ghz()
+        clock_source = "/proc/cpuinfo"
+        if args.host_ghz is None:
+            args.host_ghz, clock_source = 3.0, "assumed"
+
+    if args.checkpoint:
+        layers, config = load_checkpoint(args.checkpoint)
+        resolution = config.get("resolution", INPUT_SHAPE[0])
+        input_shape = (resolution, resolution, 1)
+    else:
+        layers, input_shape = random_layers(INPUT_SHAPE, seed=args.seed), INPUT_SHAPE
+
+    rng = np.random.default_rng(args.seed)
+    calibration = rng.random((32, *input_shape)).astype(np.float32)
+    model = EngineQuantizer().quantize(layers, input_shape, calibration)
+    bench = GemmBench()
+
+    print("=" * 60)
+    print("GEMM CORE PERFORMANCE")
+    print("=" * 60)
+    print(f"M7:   cost model estimate (gemm_cycles()), peak {M7_PEAK_MACS_PER_CYCLE:.1f} MACs/cycle (SMLAD)")
+    print(f"Host: measured at {args.host_ghz:.2f} GHz ({clock_source}), peak {args.host_peak:.1f} MACs/cycle")
+    print()
+    print(f"{'':<35} {'-- M7 model estimate --':^23} {'--- host measured ---':>23}")
+    print(f"{'layer':<8} {'M':>5} {'N':>4} {'K':>5} {'MACs':>9} {'cyc':>9} "
+          f"{'MAC/cyc':>7} {'eff':>5} {'cyc':>9} {'MAC/cyc':>7} {'eff':>5}")
+
+    total_macs = total_m7 = total_host = 0
+    for i, layer in enumerate(model.layers):
+        if "weights" not in layer:
+            continue
+        (ih, iw, _), (n, k) = layer["in_shape"], layer["weights"].shape
+        m = ih * iw if layer["op"] in CONV_OPS else 1
+        macs = m * n * k
+        m7 = gemm_cycles(m, n, k)
+        host = bench.time_layer(layer, args.repeats) * args.host_ghz * 1e9
+        total_macs, total_m7, total_host = total_macs + macs, total_m7 + m7, total_host + host
+
+        name = f"{'conv' if layer['op'] in CONV_OPS else 'dense'}{i}"
+        print(f"{name:<8} {m:>5} {n:>4} {k:>5} {macs:>9} {m7:>9.0f} {macs / m7:>7.2f} "
+              f"{macs / m7 / M7_PEAK_MACS_PER_CYCLE:>5.0%} {host:>9.0f} {macs / host:>7.2f} "
+              f"{macs / host / args.host_peak:>5.0%}")
+
+    print()
+    print(f"Total: {total_macs} MACs | M7 estimate {total_macs / total_m7:.2f} MACs/cycle "
+          f"({total_macs / total_m7 / M7_PEAK_MACS_PER_CYCLE:.0%} of peak) | "
+          f"host {total_macs / total_host:.2f} MACs/cycle "
+          f"({total_macs / total_host / args.host_peak:.0%} of peak)")
+    print(f"Model M7 estimate: {model.m7_latency_ms():.2f} ms at 480 MHz")
+
+
+if __name__ == "__main__":
+    main()
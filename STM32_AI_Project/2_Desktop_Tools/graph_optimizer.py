@@ -0,0 +1,471 @@
+"""
+Graph Optimizer
+Converter-side passes that rewrite a Keras graph into the firmware engine's
+layer set (ai_engine.h) before quantization: channels-first flattens folded
+into dense weights, identity ops removed, batch-norm / normalization /
+model_info.json preprocessing folded into convolutions, standalone
+activations fused into the GEMM epilogue and conv + max pool pairs fused
+(AI_OP_CONV2D_3X3_POOL). Reports op count, M7 cycles and activation RAM
+before and after. Multi-task models (layers named fire_*, smoke_*,
+location_* on a shared backbone) are split into backbone and heads first.
+
+Numpy only, like engine_model.py: graphs come from a Keras model or a
+save_checkpoint() file.
+"""
+
+import argparse
+import json
+from pathlib import Path
+
+import numpy as np
+
+from engine_model import (
+    KERAS_LUT_NAMES, LUT_FUNCTIONS, M7_CLOCK_HZ, M7_COST, TASK_NAMES, float_forward, gemm_cycles,
+    load_checkpoint
+)
+from native_build import report_path
+
+
+# Per-element M7 cycles of the ops the engine has no kernel for, as a
+# generic int8 interpreter would run them (one pass over the tensor each)
+GRAPH_COST = {
+    "affine": 5.0,        # Load, subtract zero, multiply-add, requantize, store
+    "activation": 4.0,    # Load, table / clamp, store
+    "copy": 1.0,          # Reshape / dropout copies
+}
+
+# Activations that commute with max pooling (non-decreasing)
+MONOTONIC = {"relu", "sigmoid", "tanh", "exp"}
+
+# Nodes that run on the GEMM core and fuse affines / activations
+GEMM_NODES = ("conv", "dense", "temporal")
+
+# Keras layers with no effect at inference (NHWC is already flat)
+IDENTITY_LAYERS = ("Dropout", "SpatialDropout2D", "GaussianNoise", "GaussianDropout",
+                   "ActivityRegularization")
+
+
+# ==================== GRAPH ====================
+#
+# A graph is a list of nodes in execution order. Engine layers ("conv",
+# "maxpool", "gap", "dense", "temporal", as in engine_model.py) mix with
+# ops the engine cannot run:
+#   affine      y = x * scale + offset per channel (batch-norm, normalization,
+#               rescaling, preprocessing)
+#   activation  standalone nonlinearity ("function")
+#   flatten     "order" HWC (free in NHWC) or CHW (channels-first model)
+#   identity    dropout and friends
+
+def graph_from_keras(model, layers=None):
+    """
+    Graph nodes of a sequential Keras model (no rewriting yet)
+    layers: a chain of the model's layers to convert instead (one head)
+    """
+    nodes = []
+    channels_first = False
+    for layer in model.layers if layers is None else layers:
+        kind = type(layer).__name__
+        config = layer.get_config()
+        activation = config.get("activation", "linear")
+        weights = layer.get_weights()
+
+        if kind in ("Conv2D", "Dense"):
+            if kind == "Conv2D" and (tuple(config["kernel_size"]) != (3, 3) or
+                                     tuple(config["strides"]) != (1, 1) or config["padding"] != "same"):
+                raise ValueError(f"{layer.name}: only 3x3 / stride 1 / same convolutions are supported")
+            w = weights[0]
+            b = weights[1] if len(weights) > 1 else np.zeros(w.shape[-1], np.float32)
+            # Built-in activations are already fused, as in layers_from_keras()
+            fused = {"activation": activation} if activation in KERAS_LUT_NAMES else {}
+            nodes.append({"op": "conv" if kind == "Conv2D" else "dense", "w": w, "b": b,
+                          "relu": activation == "relu", **fused})
+            channels_first |= config.get("data_format") == "channels_first"
+        elif kind == "MaxPooling2D":
+            if tuple(config["pool_size"]) != (2, 2):
+                raise ValueError(f"{layer.name}: only 2x2 pooling is supported")
+            nodes.append({"op": "maxpool"})
+        elif kind == "GlobalAveragePooling2D":
+            nodes.append({"op": "gap"})
+        elif kind == "BatchNormalization":
+            values = iter(weights)
+            gamma = next(values) if config.get("scale", True) else 1.0
+            beta = next(values) if config.get("center", True) else 0.0
+            mean, variance = next(values), next(values)
+            scale = gamma / np.sqrt(variance + config["epsilon"])
+            nodes.append({"op": "affine", "scale": scale, "offset": beta - mean * scale,
+                          "source": "batch-norm"})
+        elif kind == "Normalization":
+            mean, variance = weights[0], weights[1]
+            scale = 1.0 / np.sqrt(np.maximum(variance, 1e-7))
+            nodes.append({"op": "affine", "scale": scale, "offset": -mean * scale,
+                          "source": "normalization"})
+        elif kind == "Rescaling":
+            nodes.append({"op": "affine", "scale": np.float32(config["scale"]),
+                          "offset": np.float32(config["offset"]), "source": "rescaling"})
+        elif kind == "ReLU":
+            if config.get("max_value") is not None or config.get("negative_slope", 0) \
+                    or config.get("threshold", 0):
+                raise ValueError(f"{layer.name}: only plain ReLU is supported")
+            nodes.append({"op": "activation", "function": "relu"})
+        elif kind == "Activation":
+            nodes.append({"op": "activation", "function": activation})
+        elif kind == "Softmax":
+            nodes.append({"op": "activation", "function": "softmax"})
+        elif kind == "Flatten":
+            # Flatten(data_format="channels_first") transposes to HWC itself
+            chw = channels_first and config.get("data_format") != "channels_first"
+            nodes.append({"op": "flatten", "order": "CHW" if chw else "HWC"})
+        elif kind in IDENTITY_LAYERS or kind == "InputLayer":
+            if kind != "InputLayer":
+                nodes.append({"op": "identity", "source": kind})
+        else:
+            raise ValueError(f"{layer.name}: layer type {kind} not supported by the engine")
+
+    for node in nodes:
+        function = node.get("function", node.get("activation"))
+        if function and function not in ("relu", "linear", "softmax", *KERAS_LUT_NAMES):
+            raise ValueError(f"Activation '{function}' not supported by the engine")
+        if node["op"] == "activation":
+            node["function"] = KERAS_LUT_NAMES.get(function, function)
+        elif node.get("activation"):
+            node["activation"] = KERAS_LUT_NAMES[function]
+    # A final softmax is dropped: the firmware applies it to the logits
+    while nodes and nodes[-1]["op"] in ("activation", "identity") and \
+            nodes[-1].get("function", "softmax") == "softmax":
+        nodes.pop()
+    return nodes
+
+
+def heads_from_keras(model):
+    """
+    Split a multi-task Keras model: layers named <task>_* ("fire_dense",
+    "location_conv", ...) form that task's head, a chain fed by the shared
+    backbone made of all other layers. Returns (backbone nodes, {task:
+    head nodes}); the dict is empty for a single-output model.
+    """
+    groups = {}
+    for layer in model.layers:
+        task = next((t for t, name in enumerate(TASK_NAMES) if layer.name.startswith(name + "_")), None)
+        groups.setdefault(task, []).append(layer)
+    backbone = groups.pop(None, [])
+    if not groups:
+        return graph_from_keras(model), {}
+    return graph_from_keras(model, backbone), \
+        {task: graph_from_keras(model, layers) for task, layers in sorted(groups.items())}
+
+
+def preprocessing_node(model_info_path, channels):
+    """
+    Affine node for the model_info.json preprocessing ((x - mean) / std on
+    the 0-1 input), trimmed to the model's channel count
+    """
+    info = json.loads(Path(model_info_path).read_text())["preprocessing"]
+    mean = np.asarray(info["normalization_mean"], dtype=np.float64)[:channels]
+    std = np.asarray(info["normalization_std"], dtype=np.float64)[:channels]
+    return {"op": "affine", "scale": 1.0 / std, "offset": -mean / std, "source": "preprocessing"}
+
+
+def graph_forward(nodes, x):
+    """Float reference of an unoptimized graph (NHWC batch); returns the logits"""
+    for node in nodes:
+        op = node["op"]
+        if op == "affine":
+            x = x * np.float32(node["scale"]) + np.float32(node["offset"])
+        elif op == "activation":
+            if node["function"] == "relu":
+                x = np.maximum(x, 0)
+            elif node["function"] != "linear":
+                x = LUT_FUNCTIONS[node["function"]](x.astype(np.float64))
+        elif op == "flatten":
+            order = (0, 3, 1, 2) if node["order"] == "CHW" else (0, 1, 2, 3)
+            x = x.transpose(order).reshape(len(x), 1, 1, -1)
+        elif op != "identity":
+            x = float_forward([node], x)[-1]
+        x = x.astype(np.float32)
+    return x.reshape(len(x), -1)
+
+
+# ==================== PASSES ====================
+
+def fold_layouts(nodes, input_shape):
+    """
+    Every engine edge is NHWC (the GEMM's implicit im2col reads contiguous
+    channel runs); a channels-first flatten feeding a dense layer becomes a
+    row permutation of the dense weights instead of a transpose
+    """
+    out, shape, count = [], tuple(input_shape), 0
+    pending = None
+    for node in nodes:
+        if node["op"] == "flatten" and node["order"] == "CHW" and shape[0] * shape[1] > 1:
+            pending = shape
+            count += 1
+            continue
+        if pending and node["op"] == "dense":
+            h, w, c = pending
+            rows = node["w"].reshape(c, h, w, -1).transpose(1, 2, 0, 3).reshape(h * w * c, -1)
+            node = {**node, "w": rows}
+            pending = None
+        elif pending and node["op"] not in ("identity", "affine", "activation"):
+            raise ValueError("Channels-first flatten must feed a dense layer")
+        out.append(node)
+        shape = node_shape(node, shape)
+    return out, count
+
+
+def remove_identities(nodes):
+    """Dropout, NHWC flatten and linear activations do nothing at inference"""
+    keep = [n for n in nodes if not (n["op"] in ("identity", "flatten") or
+                                     (n["op"] == "activation" and n["function"] == "linear"))]
+    return keep, len(nodes) - len(keep)
+
+
+def fold_affines(nodes):
+    """
+    Fold affine nodes into the neighbouring GEMM layer
+    - after a conv / dense with no activation yet: scale the output
+      channels' weights and bias
+    - ahead of the first conv / dense: scale its input channels' weights,
+      and move the offset into the layer's input_mean (uniform across
+      channels), which the quantizer turns into the input zero point so
+      the padding taps still read as normalized zeros
+    """
+    out, count = [], 0
+    front = None
+    for node in nodes:
+        if node["op"] != "affine":
+            if front is not None and node["op"] in GEMM_NODES:
+                node = fold_input_affine(node, front)
+                front = None
+            elif front is not None:
+                raise ValueError(f"Cannot fold {front['source']} ahead of a {node['op']} layer")
+            out.append(node)
+            continue
+
+        count += 1
+        prev = out[-1] if out else None
+        if prev is None:
+            front = node if front is None else merge_affines(front, node)
+        elif prev["op"] in GEMM_NODES and not prev.get("relu") and not prev.get("activation") \
+                and not prev.get("pool"):
+            scale = np.broadcast_to(node["scale"], prev["b"].shape)
+            out[-1] = {**prev, "w": prev["w"] * scale, "b": prev["b"] * scale + node["offset"]}
+        else:
+            raise ValueError(f"Cannot fold {node['source']} after a {prev['op']} layer")
+    if front is not None:
+        raise ValueError(f"Cannot fold {front['source']}: no conv / dense layer follows")
+    return out, count
+
+
+def merge_affines(first, second):
+    return {"op": "affine", "scale": first["scale"] * second["scale"],
+            "offset": first["offset"] * second["scale"] + second["offset"], "source": first["source"]}
+
+
+def fold_input_affine(layer, affine):
+    scale = np.asarray(affine["scale"], dtype=np.float64)
+    if np.any(scale == 0):
+        raise ValueError(f"{affine['source']}: zero scale")
+    mean = np.unique(np.round(-np.asarray(affine["offset"]) / scale, 6))
+    if len(mean) != 1:
+        raise ValueError(f"{affine['source']}: per-channel means differ; the engine has one input zero point")
+
+    w = layer["w"].astype(np.float64)
+    if layer["op"] == "conv":
+        w = w * scale.reshape(1, 1, -1, 1) if scale.ndim else w * scale
+    else:
+        w = (w.reshape(-1, scale.size, w.shape[-1]) * scale.reshape(1, -1, 1)).reshape(w.shape)
+    return {**layer, "w": w.astype(np.float32), "input_mean": float(mean[0]) + layer.get("input_mean", 0.0)}
+
+
+def fuse_activations(nodes):
+    """
+    Standalone activations become the preceding conv / dense layer's fused
+    activation (ReLU clamp or table); monotonic ones also move ahead of a
+    max pool, since they commute with it
+    """
+    out, count = [], 0
+    for node in nodes:
+        if node["op"] == "activation":
+            target = len(out) - 1
+            if target > 0 and out[target]["op"] == "maxpool" and node["function"] in MONOTONIC:
+                target -= 1
+            prev = out[target] if target >= 0 else None
+            if prev is None or prev["op"] not in GEMM_NODES or prev.get("relu") \
+                    or prev.get("activation"):
+                raise ValueError(f"Activation '{node['function']}' does not follow a conv / dense layer")
+            fused = {"relu": True} if node["function"] == "relu" else {"activation": node["function"]}
+            out[target] = {**prev, **fused}
+            count += 1
+            continue
+        out.append(node)
+    return out, count
+
+
+def fuse_pools(nodes):
+    """conv (+ activation) + 2x2 max pool -> AI_OP_CONV2D_3X3_POOL"""
+    out, count = [], 0
+    for node in nodes:
+        if node["op"] == "maxpool" and out and out[-1]["op"] == "conv" and not out[-1].get("pool"):
+            out[-1] = {**out[-1], "pool": True}
+            count += 1
+            continue
+        out.append(node)
+    return out, count
+
+
+PASSES = (
+    ("layout", "channels-first flattens folded into dense weights"),
+    ("identity", "identity ops removed"),
+    ("affine", "batch-norm / normalization / preprocessing folded"),
+    ("activation", "activations fused into conv / dense"),
+    ("pool", "conv + max pool pairs fused"),
+)
+
+
+def optimize_graph(nodes, input_shape, preprocessing=None, fuse_pool=True):
+    """
+    Run every pass; returns (engine float layers, report)
+    preprocessing: affine node (preprocessing_node()) the firmware would
+    otherwise apply to the input
+    """
+    before = ([preprocessing] if preprocessing else []) + list(nodes)
+    graph, counts = before, {}
+    steps = [lambda g: fold_layouts(g, input_shape), remove_identities, fold_affines, fuse_activations]
+    if fuse_pool:
+        steps.append(fuse_pools)
+    for (name, _), step in zip(PASSES, steps):
+        graph, counts[name] = step(graph)
+
+    rng = np.random.default_rng(0)
+    x = rng.random((4, *input_shape)).astype(np.float32)
+    error = np.abs(graph_forward(before, x) - float_forward(graph, x)[-1].reshape(len(x), -1)).max()
+
+    report = {
+        "passes": counts,
+        "before": graph_cost(before, input_shape),
+        "after": graph_cost(graph, input_shape),
+        "max_logit_error": float(error),
+    }
+    return graph, report
+
+
+def optimize_heads(backbone, heads, input_shape, preprocessing=None, fuse_pool=True):
+    """
+    optimize_graph() on the backbone, then on every head at the backbone's
+    output shape; returns (backbone layers, {task: head layers}, {part:
+    report}) with parts "backbone" and the task names
+    """
+    layers, report = optimize_graph(backbone, input_shape, preprocessing, fuse_pool)
+    reports, shape = {"backbone": report}, tuple(input_shape)
+    for layer in layers:
+        shape = node_shape(layer, shape)
+
+    head_layers = {}
+    for task, nodes in heads.items():
+        head_layers[task], reports[TASK_NAMES[task]] = optimize_graph(nodes, shape, fuse_pool=fuse_pool)
+    return layers, head_layers, reports
+
+
+# ==================== COST ====================
+
+def node_shape(node, shape):
+    h, w, c = shape
+    op = node["op"]
+    if op == "conv":
+        n = node["w"].shape[3]
+        return (h // 2, w // 2, n) if node.get("pool") else (h, w, n)
+    if op == "dense":
+        return (1, 1, node["w"].shape[1])
+    if op == "temporal":
+        return (1, 1, node["w"].shape[2])
+    if op == "maxpool":
+        return (h // 2, w // 2, c)
+    if op == "gap":
+        return (1, 1, c)
+    return shape
+
+
+def graph_cost(nodes, input_shape):
+    """
+    Op count, M7 cycles (engine cost model plus GRAPH_COST for ops the
+    engine lacks) and peak int8 activation bytes (input + output of one op)
+    """
+    shape, cycles, peak = tuple(input_shape), 0.0, 0
+    for node in nodes:
+        out = node_shape(node, shape)
+        (h, w, c), elements = shape, int(np.prod(shape))
+        op, extra = node["op"], 0
+        if op in GEMM_NODES:
+            n, k = out[2], int(np.prod(node["w"].shape[:-1]))
+            if node.get("pool"):
+                # Two conv rows per GEMM call, pooled into the output
+                oh, ow, _ = out
+                cycles += oh * gemm_cycles(4 * ow, n, k) + oh * ow * n * M7_COST["pool_output"]
+                extra = 4 * ow * n
+            else:
+                cycles += gemm_cycles(h * w if op == "conv" else 1, n, k)
+            if node.get("activation"):
+                cycles += (h * w if op == "conv" else 1) * n * M7_COST["lut"]
+        elif op == "maxpool":
+            cycles += int(np.prod(out)) * M7_COST["pool_output"]
+        elif op == "gap":
+            cycles += elements * M7_COST["gap_input"]
+        elif op in ("affine", "activation"):
+            cycles += elements * GRAPH_COST[op]
+        else:
+            cycles += elements * GRAPH_COST["copy"]
+        peak = max(peak, elements + int(np.prod(out)) + extra)
+        shape = out
+    return {"ops": len(nodes), "m7_cycles": cycles, "m7_ms": cycles / M7_CLOCK_HZ * 1000,
+            "arena_bytes": peak}
+
+
+def print_report(report):
+    before, after = report["before"], report["after"]
+    print(f"{'':<12} {'ops':>5} {'M7 ms':>8} {'arena KB':>9}")
+    for name, cost in (("before", before), ("after", after)):
+        print(f"{name:<12} {cost['ops']:>5} {cost['m7_ms']:>8.3f} {cost['arena_bytes'] / 1024:>9.1f}")
+    print(f"{'diff':<12} {after['ops'] - before['ops']:>+5} "
+          f"{after['m7_ms'] - before['m7_ms']:>+8.3f} "
+          f"{(after['arena_bytes'] - before['arena_bytes']) / 1024:>+9.1f}")
+    for name, description in PASSES:
+        if report["passes"][name]:
+            print(f"  ✓ {report['passes'][name]} {description}")
+    status = "✓" if report["max_logit_error"] < 1e-3 else "⚠"
+    print(f"{status} Float logits vs unoptimized graph: max |Δ| {report['max_logit_error']:.2e}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Engine graph optimizer report")
+    parser.add_argument("model", help="Keras model (.h5 / .keras) or save_checkpoint() .npz")
+    parser.add_argument("--input-size", type=int, default=32)
+    parser.add_argument("--channels", type=int, default=1)
+    parser.add_argument("--model-info", help="model_info.json whose preprocessing to fold into the first layer")
+    parser.add_argument("--no-pool-fusion", action="store_true")
+    parser.add_argument("--output", default=report_path("graph_report.json"))
+    args = parser.parse_args()
+
+    input_shape = (args.input_size, args.input_size, args.channels)
+    if args.model.endswith(".npz"):
+        (nodes, _), heads = load_checkpoint(args.model), {}
+    else:
+        import tensorflow as tf
+        nodes, heads = heads_from_keras(tf.keras.models.load_model(args.model))
+    preprocessing = preprocessing_node(args.model_info, args.channels) if args.model_info else None
+
+    print("=" * 60)
+    print("ENGINE GRAPH OPTIMIZER")
+    print("=" * 60)
+    _, _, reports = optimize_heads(nodes, heads, input_shape, preprocessing, fuse_pool=not args.no_pool_fusion)
+    for part, part_report in reports.items():
+        if heads:
+            print(f"\n{part.capitalize()}:")
+        print_report(part_report)
+    report = reports if heads else reports["backbone"]
+
+    Path(args.output).write_text(json.dumps(report, indent=2))
+    print(f"✓ Report saved: {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,174 @@
+"""
+JPEG Front-End Benchmark
+Compare full decode + cv2.resize (STM32Simulator.preprocess_image path)
+against the firmware's DCT-domain reduced-resolution decoder
+"""
+
+import argparse
+import ctypes
+import time
+from pathlib import Path
+
+import cv2
+import numpy as np
+
+from native_build import load_library
+from native_engine import CACHE_LINE, ENGINE_FLAGS, ENGINE_SOURCES, ModelInfo
+from stm32_ai_testing import STM32Simulator
+
+
+JPEG_DC_SCALE_1_8 = 1
+JPEG_DC_SCALE_1_4 = 2
+
+# sizeof(JpegDcDecoder) is ~10KB; over-allocate so the struct layout
+# never has to be mirrored in Python
+DECODER_STATE_BYTES = 16 * 1024
+
+
+class DcJpegFrontEnd:
+    """ctypes wrapper around jpeg_dc_decode() + preprocess_image_scaled()"""
+
+    def __init__(self, scale=JPEG_DC_SCALE_1_8, target_size=(32, 32)):
+        # ai_inference.c links against the whole engine: follow its source list
+        self.lib = load_library("fire_frontend", [*ENGINE_SOURCES, "jpeg_dc_decoder.c"], ENGINE_FLAGS)
+        self.lib.jpeg_dc_decode.restype = ctypes.c_int32
+        self.lib.jpeg_dc_decode.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint32, ctypes.c_int,
+            ctypes.c_void_p, ctypes.c_uint32,
+            ctypes.POINTER(ctypes.c_uint16), ctypes.POINTER(ctypes.c_uint16)
+        ]
+        self.lib.preprocess_image_scaled.restype = ctypes.c_int32
+        self.lib.preprocess_image_scaled.argtypes = [
+            ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32, ctypes.c_void_p, ctypes.c_uint32
+        ]
+        self.lib.fire_detection_init_model.restype = ctypes.c_int32
+        self.lib.fire_detection_init_model.argtypes = [
+            ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint32, ctypes.POINTER(ModelInfo)
+        ]
+        self.lib.fire_detection_context_size.restype = ctypes.c_uint32
+
+        self.scale = scale
+        self.target_size = target_size
+
+        # Context on the built-in model: preprocess_image_scaled() takes the
+        # input size from its ModelInfo
+        size = self.lib.fire_detection_context_size()
+        self.ctx_memory = ctypes.create_string_buffer(size + CACHE_LINE)
+        self.ctx = (ctypes.addressof(self.ctx_memory) + CACHE_LINE - 1) & ~(CACHE_LINE - 1)
+        self.info = ModelInfo(b"frontend", b"1.0", target_size[0], target_size[1], 1, 0.7)
+        model = ctypes.addressof(ctypes.c_uint8.in_dll(self.lib, "model_data"))
+        model_len = ctypes.c_uint32.in_dll(self.lib, "model_data_len").value
+        if self.lib.fire_detection_init_model(self.ctx, model, model_len, ctypes.byref(self.info)) != 0:
+            raise RuntimeError("Engine context initialization failed")
+        self.state = ctypes.create_string_buffer(DECODER_STATE_BYTES)
+        self.scaled = np.zeros(1 << 20, dtype=np.uint8)
+        self.output = np.zeros(target_size[0] * target_size[1], dtype=np.float32)
+        self.width = ctypes.c_uint16()
+        self.height = ctypes.c_uint16()
+
+    def decode(self, jpeg_bytes):
+        """Reduced-resolution luma image (uint8)"""
+        status = self.lib.jpeg_dc_decode(
+            self.state, jpeg_bytes, len(jpeg_bytes), self.scale,
+            self.scaled.ctypes.data, self.scaled.size,
+            ctypes.byref(self.width), ctypes.byref(self.height)
+        )
+        if status != 0:
+            raise ValueError(f"jpeg_dc_decode failed: {status}")
+
+        w, h = self.width.value, self.height.value
+        return self.scaled[:w * h].reshape(h, w)
+
+    def preprocess(self, jpeg_bytes):
+        """Model input (1, H, W, 1) float32, same layout as the simulator"""
+        small = self.decode(jpeg_bytes)
+        if self.lib.preprocess_image_scaled(self.ctx, small.ctypes.data, small.shape[1], small.shape[0],
+                                            self.output.ctypes.data, self.output.size) != 0:
+            raise ValueError("Model input larger than the output buffer")
+        h, w = self.target_size[1], self.target_size[0]
+        return self.output.reshape(1, h, w, 1).copy()
+
+
+def synthetic_frames(count, size, quality):
+    """Camera-like MJPEG frames: flame blob over a textured background"""
+    w, h = size
+    rng = np.random.default_rng(0)
+    frames = []
+
+    for i in range(count):
+        img = cv2.GaussianBlur(rng.integers(0, 120, (h, w, 3), dtype=np.uint8), (9, 9), 0)
+        if i % 2 == 0:
+            cx, cy = rng.integers(w // 4, 3 * w // 4), rng.integers(h // 4, 3 * h // 4)
+            axes = (int(rng.integers(w // 16, w // 6)), int(rng.integers(h // 10, h // 4)))
+            cv2.ellipse(img, (int(cx), int(cy)), axes, 0, 0, 360, (40, 160, 255), -1)
+            img = cv2.GaussianBlur(img, (5, 5), 0)
+        ok, buf = cv2.imencode(".jpg", img, [cv2.IMWRITE_JPEG_QUALITY, quality])
+        frames.append(buf.tobytes())
+
+    return frames
+
+
+def load_frames(image_dir):
+    """All .jpg/.jpeg files in a directory, as raw bytes"""
+    paths = sorted(list(Path(image_dir).glob("*.jpg")) + list(Path(image_dir).glob("*.jpeg")))
+    return [p.read_bytes() for p in paths]
+
+
+def time_path(fn, frames, iterations):
+    """Per-frame latency samples in milliseconds"""
+    samples = []
+    for _ in range(iterations):
+        for frame in frames:
+            start = time.perf_counter()
+            fn(frame)
+            samples.append((time.perf_counter() - start) * 1000)
+    return np.array(samples)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="MJPEG front-end benchmark")
+    parser.add_argument("--images", help="Directory of JPEG frames (default: synthetic)")
+    parser.add_argument("--frames", type=int, default=20, help="Synthetic frame count")
+    parser.add_argument("--size", default="640x480", help="Synthetic frame size WxH")
+    parser.add_argument("--quality", type=int, default=85, help="Synthetic JPEG quality")
+    parser.add_argument("--scale", type=int, choices=[8, 4], default=8,
+                        help="8 = DC only, 4 = DC + low AC")
+    parser.add_argument("--iterations", type=int, default=10)
+    args = parser.parse_args()
+
+    print("=" * 60)
+    print("JPEG Front-End Benchmark")
+    print("=" * 60 + "\n")
+
+    if args.images:
+        frames = load_frames(args.images)
+    else:
+        w, h = map(int, args.size.lower().split("x"))
+        frames = synthetic_frames(args.frames, (w, h), args.quality)
+    if not frames:
+        print("No frames to benchmark")
+        return
+
+    simulator = STM32Simulator(model_path=None)
+    frontend = DcJpegFrontEnd(JPEG_DC_SCALE_1_8 if args.scale == 8 else JPEG_DC_SCALE_1_4)
+
+    # Accuracy: both paths must produce nearly the same model input
+    errors = [np.abs(simulator.preprocess_jpeg_bytes(f) - frontend.preprocess(f)) for f in frames]
+    mae = float(np.mean(errors)) * 255
+    max_err = float(np.max(errors)) * 255
+
+    full = time_path(simulator.preprocess_jpeg_bytes, frames, args.iterations)
+    reduced = time_path(frontend.preprocess, frames, args.iterations)
+
+    print(f"Frames: {len(frames)} | Iterations: {args.iterations} | Scale: 1/{args.scale}\n")
+    print(f"{'Path':32} {'Mean':>9} {'P50':>9} {'P95':>9}")
+    print("-" * 62)
+    for name, t in (("Full decode + cv2.resize", full), (f"DCT-domain 1/{args.scale} + resize", reduced)):
+        print(f"{name:32} {t.mean():8.3f}ms {np.percentile(t, 50):8.3f}ms {np.percentile(t, 95):8.3f}ms")
+
+    print(f"\nSpeedup:          {full.mean() / reduced.mean():.1f}x")
+    print(f"Input difference: MAE {mae:.2f} / max {max_err:.1f} (0-255 levels)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,401 @@
+"""
+Delta Model Updates
+Build block-level FDP1 patches between two model images and send them to
+a device (UART, LoRa bridge or Linux pseudo-terminal) with a resumable,
+CRC-checked chunk protocol. Device side: Core/Src/model_update.c
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import time
+import zlib
+from pathlib import Path
+
+
+# Patch blocks match the converter's model layout
+MODEL_BLOCK_SIZE = 256
+MAX_BLOCK_SIZE = 1024  # MODEL_UPDATE_MAX_BLOCK
+BLOCK_ALIGN = 32  # MODEL_UPDATE_BLOCK_ALIGN: whole H7 flash words
+
+PATCH_MAGIC = b"FDP1"
+PATCH_VERSION = 1
+PATCH_HEADER = struct.Struct("<4sHHIIIII")
+OP_COPY = 0x01
+OP_DATA = 0x02
+MAX_OP_COUNT = 0xFFFF
+
+# Link protocol (link_protocol.h)
+SYNC = b"\xa5\x5a"
+MSG_UPD_BEGIN = 0x10
+MSG_UPD_CHUNK = 0x11
+MSG_UPD_QUERY = 0x12
+MSG_UPD_COMMIT = 0x13
+MSG_UPD_ABORT = 0x14
+MSG_UPD_STATUS = 0x1F
+LINK_MAX_PAYLOAD = 256
+
+STATUS_NAMES = {
+    0: "OK", 1: "ERR_STATE", 2: "ERR_HEADER", 3: "ERR_BASE", 4: "ERR_OFFSET",
+    5: "ERR_PATCH", 6: "ERR_FLASH", 7: "ERR_VERIFY", 8: "ERR_SIZE",
+    9: "ERR_IMAGE", 10: "ERR_BUSY"
+}
+STATUS_BUSY = 10
+STATE_VERIFIED = 2
+
+
+# ==================== PATCH FORMAT ====================
+
+def make_patch(base, target, block_size=MODEL_BLOCK_SIZE):
+    """
+    Diff two model images block by block
+
+    Target blocks found anywhere in the base (same index first) become
+    COPY ops; the rest are sent literally. Adjacent ops are merged.
+    """
+    def block(data, i):
+        return data[i * block_size:(i + 1) * block_size]
+
+    base_blocks = {}
+    for i in range((len(base) + block_size - 1) // block_size):
+        base_blocks.setdefault(block(base, i), i)
+
+    ops = []  # [op, count, src_block]
+    n_blocks = (len(target) + block_size - 1) // block_size
+    for i in range(n_blocks):
+        tb = block(target, i)
+        if block(base, i) == tb:
+            src = i
+        else:
+            src = base_blocks.get(tb) if len(tb) == block_size else None
+
+        if src is not None:
+            last = ops[-1] if ops else None
+            if last and last[0] == OP_COPY and last[2] + last[1] == src and last[1] < MAX_OP_COUNT:
+                last[1] += 1
+            else:
+                ops.append([OP_COPY, 1, src])
+        else:
+            last = ops[-1] if ops else None
+            if last and last[0] == OP_DATA and last[1] < MAX_OP_COUNT:
+                last[1] += 1
+                last[2].append(i)
+            else:
+                ops.append([OP_DATA, 1, [i]])
+
+    stream = bytearray()
+    for op, count, arg in ops:
+        if op == OP_COPY:
+            stream += struct.pack("<BHI", OP_COPY, count, arg)
+        else:
+            stream += struct.pack("<BH", OP_DATA, count)
+            for i in arg:
+                stream += block(target, i)
+
+    header = PATCH_HEADER.pack(
+        PATCH_MAGIC, PATCH_VERSION, block_size,
+        len(base), zlib.crc32(base), len(target), zlib.crc32(target), len(stream)
+    )
+    return header + bytes(stream)
+
+
+def parse_patch_header(patch):
+    magic, version, block_size, base_len, base_crc, target_len, target_crc, ops_len = \
+        PATCH_HEADER.unpack_from(patch)
+    if magic != PATCH_MAGIC or version != PATCH_VERSION:
+        raise ValueError("Not an FDP1 patch")
+    return {
+        "block_size": block_size, "base_length": base_len, "base_crc": base_crc,
+        "target_length": target_len, "target_crc": target_crc, "ops_length": ops_len
+    }
+
+
+def apply_patch(base, patch):
+    """Reference applier (same semantics as model_update.c)"""
+    h = parse_patch_header(patch)
+    bs = h["block_size"]
+    if len(base) != h["base_length"] or zlib.crc32(base) != h["base_crc"]:
+        raise ValueError("Patch does not match this base image")
+
+    ops = memoryview(patch)[PATCH_HEADER.size:]
+    out = bytearray()
+    pos = 0
+    while pos < len(ops):
+        op, count = struct.unpack_from("<BH", ops, pos)
+        if op == OP_COPY:
+            src, = struct.unpack_from("<I", ops, pos + 3)
+            pos += 7
+            for i in range(count):
+                take = min(bs, h["target_length"] - len(out))
+                out += base[(src + i) * bs:(src + i) * bs + take]
+        elif op == OP_DATA:
+            pos += 3
+            take = min(count * bs, h["target_length"] - len(out))
+            out += ops[pos:pos + take]
+            pos += take
+        else:
+            raise ValueError(f"Bad op 0x{op:02x} at {pos}")
+
+    if zlib.crc32(out) != h["target_crc"]:
+        raise ValueError("Target CRC mismatch")
+    return bytes(out)
+
+
+# ==================== LINK ====================
+
+def encode_frame(msg_type, seq, payload=b""):
+    header = struct.pack("<BBH", msg_type, seq & 0xFF, len(payload))
+    return SYNC + header + payload + struct.pack("<I", zlib.crc32(header + payload))
+
+
+class SerialLink:
+    """Raw byte link to a serial port or pseudo-terminal"""
+
+    def __init__(self, port, baud=115200):
+        self.rx = bytearray()
+        if sys.platform == "win32":
+            import serial  # pyserial
+            self.serial = serial.Serial(port, baud, timeout=0)
+            self.fd = None
+        else:
+            import termios
+            import tty
+            self.serial = None
+            self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+            tty.setraw(self.fd)
+            attrs = termios.tcgetattr(self.fd)
+            speed = getattr(termios, f"B{baud}", termios.B115200)
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+
+    def write(self, data):
+        if self.serial:
+            self.serial.write(data)
+            return
+        view = memoryview(data)
+        while view:
+            select.select([], [self.fd], [], 1.0)
+            try:
+                view = view[os.write(self.fd, view):]
+            except BlockingIOError:
+                pass
+
+    def read(self, timeout):
+        if self.serial:
+            time.sleep(min(timeout, 0.01))
+            return self.serial.read(4096)
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return b""
+        try:
+            return os.read(self.fd, 4096)
+        except BlockingIOError:
+            return b""
+
+    def receive_frame(self, timeout):
+        """Next CRC-valid frame as (type, seq, payload), or None"""
+        deadline = time.monotonic() + timeout
+        while True:
+            frame = self._parse()
+            if frame:
+                return frame
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            self.rx += self.read(remaining)
+
+    def _parse(self):
+        while True:
+            start = self.rx.find(SYNC)
+            if start < 0:
+                del self.rx[:-1]  # Keep a possible first sync byte
+                return None
+            del self.rx[:start]
+            if len(self.rx) < 6:
+                return None
+            msg_type, seq, length = struct.unpack_from("<BBH", self.rx, 2)
+            if length > LINK_MAX_PAYLOAD:
+                del self.rx[:1]
+                continue
+            total = 6 + length + 4
+            if len(self.rx) < total:
+                return None
+            body = bytes(self.rx[2:6 + length])
+            crc, = struct.unpack_from("<I", self.rx, 6 + length)
+            if crc != zlib.crc32(body):
+                del self.rx[:1]
+                continue
+            del self.rx[:total]
+            return msg_type, seq, body[4:]
+
+    def close(self):
+        if self.serial:
+            self.serial.close()
+        else:
+            os.close(self.fd)
+
+
+class PatchSender:
+    """
+    Stop-and-wait chunk transfer with resume
+
+    Every chunk carries its ops-stream offset; the device answers with the
+    next offset it expects. Lost frames or replies just cause a re-query,
+    and a restarted sender picks up from the device's offset. BUSY (a
+    flash erase still running) waits busy_wait and resends from there.
+    """
+
+    def __init__(self, link, chunk_size=LINK_MAX_PAYLOAD - 4, timeout=0.5, retries=20,
+                 drop_rate=0.0, busy_wait=0.02):
+        self.link = link
+        self.chunk_size = chunk_size
+        self.timeout = timeout
+        self.retries = retries
+        self.drop_rate = drop_rate  # Test hook: silently skip sending some chunks
+        self.busy_wait = busy_wait
+        self.seq = 0
+        self.stats = {"chunks": 0, "retries": 0, "dropped": 0, "busy": 0}
+
+    def _request(self, msg_type, payload=b""):
+        for attempt in range(self.retries):
+            self.seq = (self.seq + 1) & 0xFF
+            self.link.write(encode_frame(msg_type, self.seq, payload))
+            while True:
+                frame = self.link.receive_frame(self.timeout)
+                if frame is None:
+                    break
+                rtype, rseq, body = frame
+                if rtype == MSG_UPD_STATUS and rseq == self.seq and len(body) >= 6:
+                    status, state, next_offset = struct.unpack_from("<BBI", body)
+                    return status, state, next_offset
+            self.stats["retries"] += 1
+        raise TimeoutError(f"No reply to message 0x{msg_type:02x}")
+
+    def _request_ready(self, msg_type, payload=b""):
+        """_request(), repeated while the device is erasing flash"""
+        while True:
+            status, state, next_offset = self._request(msg_type, payload)
+            if status != STATUS_BUSY:
+                return status, state, next_offset
+            self.stats["busy"] += 1
+            time.sleep(self.busy_wait)
+
+    def send(self, patch, progress=True):
+        import random
+        h = parse_patch_header(patch)
+        ops = patch[PATCH_HEADER.size:]
+
+        status, state, offset = self._request_ready(MSG_UPD_BEGIN, patch[:PATCH_HEADER.size])
+        if status != 0:
+            raise RuntimeError(f"Device rejected patch: {STATUS_NAMES.get(status, status)}")
+        if offset:
+            print(f"  Resuming at offset {offset}/{len(ops)}")
+
+        start = time.monotonic()
+        while offset < len(ops):
+            chunk = ops[offset:offset + self.chunk_size]
+            payload = struct.pack("<I", offset) + chunk
+
+            if self.drop_rate and random.random() < self.drop_rate:
+                # Simulated loss: the device never sees it; QUERY recovers
+                self.stats["dropped"] += 1
+                status, state, offset = self._request(MSG_UPD_QUERY)
+                continue
+
+            status, state, next_offset = self._request(MSG_UPD_CHUNK, payload)
+            self.stats["chunks"] += 1
+            if status == STATUS_BUSY:  # Took what it could before the erase
+                self.stats["busy"] += 1
+                time.sleep(self.busy_wait)
+            elif status not in (0, 4):  # ERR_OFFSET just moves us to next_offset
+                raise RuntimeError(f"Chunk at {offset} failed: {STATUS_NAMES.get(status, status)}")
+            offset = next_offset
+
+            if progress:
+                rate = offset / max(time.monotonic() - start, 1e-6)
+                print(f"\r  {offset}/{len(ops)} bytes ({rate / 1024:.1f} KB/s)", end="", flush=True)
+        if progress:
+            print()
+
+        status, state, _ = self._request_ready(MSG_UPD_COMMIT)
+        if status != 0 or state != STATE_VERIFIED:
+            raise RuntimeError(f"Commit failed: {STATUS_NAMES.get(status, status)}")
+        return h
+
+
+# ==================== CLI ====================
+
+def cmd_diff(args):
+    if args.block_size % BLOCK_ALIGN or not BLOCK_ALIGN <= args.block_size <= MAX_BLOCK_SIZE:
+        print(f"Block size must be a multiple of {BLOCK_ALIGN} up to {MAX_BLOCK_SIZE} (device flash words)")
+        return 1
+    base = Path(args.base).read_bytes()
+    target = Path(args.target).read_bytes()
+    patch = make_patch(base, target, args.block_size)
+
+    # Round-trip check before anything leaves the host
+    assert apply_patch(base, patch) == target
+
+    Path(args.output).write_bytes(patch)
+    h = parse_patch_header(patch)
+    print(f"✓ Patch saved: {args.output}")
+    print(f"  Target:  {h['target_length']} bytes")
+    print(f"  Patch:   {len(patch)} bytes ({len(patch) / max(1, len(target)):.1%} of full image)")
+    print(f"  Est. at 115200 baud: {len(patch) * 10 / 115200:.1f}s "
+          f"(full image: {len(target) * 10 / 115200:.1f}s)")
+
+
+def cmd_info(args):
+    patch = Path(args.patch).read_bytes()
+    h = parse_patch_header(patch)
+    for key, value in h.items():
+        print(f"  {key:14} {value:#010x}" if key.endswith("crc") else f"  {key:14} {value}")
+
+
+def cmd_send(args):
+    patch = Path(args.patch).read_bytes()
+    link = SerialLink(args.port, args.baud)
+    sender = PatchSender(link, chunk_size=args.chunk, timeout=args.timeout, drop_rate=args.drop_rate)
+    print(f"Sending {args.patch} to {args.port}...")
+    try:
+        sender.send(patch)
+    finally:
+        link.close()
+    print(f"✓ Update verified on device | chunks {sender.stats['chunks']} | "
+          f"retries {sender.stats['retries']} | busy {sender.stats['busy']} | "
+          f"simulated drops {sender.stats['dropped']}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Delta model updates")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("diff", help="Create a patch from two model images")
+    p.add_argument("base")
+    p.add_argument("target")
+    p.add_argument("-o", "--output", default="model_update.fdp")
+    p.add_argument("--block-size", type=int, default=MODEL_BLOCK_SIZE)
+    p.set_defaults(func=cmd_diff)
+
+    p = sub.add_parser("info", help="Show a patch header")
+    p.add_argument("patch")
+    p.set_defaults(func=cmd_info)
+
+    p = sub.add_parser("send", help="Send a patch over a serial port / PTY")
+    p.add_argument("patch")
+    p.add_argument("--port", required=True)
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--chunk", type=int, default=LINK_MAX_PAYLOAD - 4)
+    p.add_argument("--timeout", type=float, default=0.5)
+    p.add_argument("--drop-rate", type=float, default=0.0,
+                   help="Simulate lost chunks to exercise resume")
+    p.set_defaults(func=cmd_send)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,300 @@
+"""
+Model Pareto Explorer
+Sweep fire detection model variants (input resolution, width multiplier,
+classifier head, quantization scheme), evaluate every variant on the
+native build of the firmware engine, and report the accuracy / latency /
+memory Pareto front plus the fastest model meeting the recall target
+"""
+
+import argparse
+import itertools
+import json
+import time
+from pathlib import Path
+
+import cv2
+import numpy as np
+
+from engine_model import EngineQuantizer, load_checkpoint, save_checkpoint, write_model_source
+from native_build import report_path
+from native_engine import ARENA_SIZE, NativeFireEngine
+from stm32_ai_testing import STM32Simulator
+
+
+MODEL_INFO = Path(__file__).resolve().parent.parent / "3_STM32_CubeIDE_Template" / "Models" / "model_info.json"
+
+# Same backbone as FireDetectionModelBuilder.create_model(), scaled by width
+BASE_FILTERS = (16, 32, 64)
+HEADS = {"dense128": 128, "dense32": 32, "gap": 0}
+QUANT_SCHEMES = {"per_channel": True, "per_tensor": False}
+
+
+# ==================== DATA ====================
+
+def synthetic_frames(count, seed):
+    """
+    32x32 grayscale fire / no-fire frames in the style of
+    TestSuite.create_test_data(), with varied flame size, position and
+    brightness, and bright non-flame glare in some negatives
+    """
+    rng = np.random.default_rng(seed)
+    y, x = np.ogrid[:32, :32]
+    images, labels = [], []
+
+    for i in range(count):
+        fire = i % 2
+        img = rng.integers(0, 110, (32, 32)).astype(np.int32)
+
+        if fire:
+            cx, cy = rng.integers(6, 26, 2)
+            radius = rng.integers(3, 10)
+            mask = (x - cx) ** 2 + (y - cy) ** 2 <= radius ** 2
+            low = rng.integers(150, 220)
+            img[mask] = rng.integers(low, 256, size=mask.sum())
+            img += rng.integers(0, 50, (32, 32))  # Flicker
+        elif rng.random() < 0.3:
+            # Glare: bright but flat, no flicker
+            x0, y0 = rng.integers(0, 20, 2)
+            w, h = rng.integers(4, 12, 2)
+            img[y0:y0 + h, x0:x0 + w] = rng.integers(160, 230)
+
+        images.append(np.clip(img, 0, 255).astype(np.uint8))
+        labels.append(fire)
+    return images, np.array(labels)
+
+
+def load_frames(directory):
+    """fire_*.jpg / no_fire_*.jpg, the TestSuite layout"""
+    directory = Path(directory)
+    images, labels = [], []
+    for label, pattern in ((1, "fire_*.jpg"), (0, "no_fire_*.jpg")):
+        for path in sorted(directory.glob(pattern)):
+            images.append(cv2.imread(str(path), cv2.IMREAD_GRAYSCALE))
+            labels.append(label)
+    if not images:
+        raise FileNotFoundError(f"No fire_*.jpg / no_fire_*.jpg in {directory}")
+    return images, np.array(labels)
+
+
+def to_tensors(images, resolution):
+    """Resize + normalize exactly like the desktop simulator"""
+    simulator = STM32Simulator(None)
+    return np.concatenate([simulator.preprocess_array(img, (resolution, resolution)) for img in images])
+
+
+# ==================== VARIANTS ====================
+
+def variant_key(resolution, width, head):
+    return f"r{resolution}_w{width:g}_{head}"
+
+
+def build_keras_variant(resolution, width, head):
+    """Keras model for one variant (same layer pattern as create_model())"""
+    import tensorflow as tf
+
+    layers = [tf.keras.layers.Input(shape=(resolution, resolution, 1))]
+    for filters in BASE_FILTERS:
+        layers += [
+            tf.keras.layers.Conv2D(max(4, int(round(filters * width))), 3, activation='relu', padding='same'),
+            tf.keras.layers.MaxPooling2D(2),
+        ]
+    if head == "gap":
+        layers.append(tf.keras.layers.GlobalAveragePooling2D())
+    else:
+        layers += [
+            tf.keras.layers.Flatten(),
+            tf.keras.layers.Dense(HEADS[head], activation='relu'),
+            tf.keras.layers.Dropout(0.5),
+        ]
+    layers.append(tf.keras.layers.Dense(2, activation='softmax'))
+
+    model = tf.keras.Sequential(layers)
+    model.compile(optimizer='adam', loss='categorical_crossentropy', metrics=['accuracy'])
+    return model
+
+
+def get_variant_layers(config, checkpoint_dir, train_images, train_labels, epochs):
+    """Load the variant's checkpoint, or train it briefly and save one"""
+    path = Path(checkpoint_dir) / f"{variant_key(**config)}.npz"
+    if path.exists():
+        layers, _ = load_checkpoint(path)
+        return layers
+
+    try:
+        import tensorflow as tf  # noqa: F401
+    except ImportError:
+        raise RuntimeError(f"No checkpoint {path} and TensorFlow is not installed to train it")
+
+    from engine_model import layers_from_keras
+
+    print(f"  Training {variant_key(**config)} ({epochs} epochs)...")
+    model = build_keras_variant(**config)
+    x = to_tensors(train_images, config["resolution"])
+    y = np.eye(2)[train_labels]
+    model.fit(x, y, epochs=epochs, batch_size=32, validation_split=0.1, verbose=0)
+
+    layers = layers_from_keras(model)
+    path.parent.mkdir(parents=True, exist_ok=True)
+    save_checkpoint(path, layers, config)
+    return layers
+
+
+def evaluate_variant(engine, blob, resolution, tensors, labels, threshold):
+    """Accuracy metrics + host latency from the native engine"""
+    ctx = engine.create_context(blob, (resolution, resolution, 1), threshold)
+    probs = np.empty(len(tensors))
+    times = np.empty(len(tensors))
+
+    for i, tensor in enumerate(tensors):
+        start = time.perf_counter()
+        probs[i] = engine.infer(ctx, tensor)
+        times[i] = time.perf_counter() - start
+
+    predicted = probs > threshold
+    tp = int(np.sum(predicted & (labels == 1)))
+    tn = int(np.sum(~predicted & (labels == 0)))
+    fp = int(np.sum(predicted & (labels == 0)))
+    fn = int(np.sum(~predicted & (labels == 1)))
+
+    return {
+        "accuracy": (tp + tn) / len(labels),
+        "precision": tp / (tp + fp) if tp + fp else 0.0,
+        "recall": tp / (tp + fn) if tp + fn else 0.0,
+        "host_latency_ms": float(np.median(times) * 1000),
+    }
+
+
+# ==================== PARETO ====================
+
+# (metric, +1 = maximize / -1 = minimize)
+OBJECTIVES = [("accuracy", 1), ("m7_latency_ms", -1), ("ram_kb", -1), ("flash_kb", -1)]
+
+
+def dominates(a, b):
+    at_least = all(a[k] * s >= b[k] * s for k, s in OBJECTIVES)
+    better = any(a[k] * s > b[k] * s for k, s in OBJECTIVES)
+    return at_least and better
+
+
+def pareto_front(results):
+    return [r for r in results if not any(dominates(o, r) for o in results if o is not r)]
+
+
+def print_table(rows, title):
+    print(f"\n{title}")
+    print("-" * 96)
+    print(f"{'Variant':28} {'Acc':>6} {'Recall':>7} {'M7 ms':>7} {'Host ms':>8} "
+          f"{'RAM KB':>7} {'Flash KB':>9} {'MMACs':>7}")
+    for r in rows:
+        print(f"{r['name']:28} {r['accuracy']:6.1%} {r['recall']:7.1%} {r['m7_latency_ms']:7.2f} "
+              f"{r['host_latency_ms']:8.3f} {r['ram_kb']:7.1f} {r['flash_kb']:9.1f} {r['macs'] / 1e6:7.2f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Accuracy vs. latency vs. memory sweep of model variants")
+    parser.add_argument("--resolutions", type=int, nargs="+", default=[16, 24, 32])
+    parser.add_argument("--widths", type=float, nargs="+", default=[0.5, 0.75, 1.0])
+    parser.add_argument("--heads", nargs="+", default=list(HEADS), choices=list(HEADS))
+    parser.add_argument("--quant", nargs="+", default=list(QUANT_SCHEMES), choices=list(QUANT_SCHEMES))
+    parser.add_argument("--checkpoint-dir", default="checkpoints")
+    parser.add_argument("--epochs", type=int, default=5, help="Training epochs for variants without a checkpoint")
+    parser.add_argument("--train-dir", help="Training frames (fire_*.jpg / no_fire_*.jpg); synthetic if omitted")
+    parser.add_argument("--test-dir", help="Test frames (TestSuite layout); synthetic if omitted")
+    parser.add_argument("--train-samples", type=int, default=2000)
+    parser.add_argument("--test-samples", type=int, default=600)
+    parser.add_argument("--model-info", default=str(MODEL_INFO))
+    parser.add_argument("--recall-target", type=float, help="Overrides model_info.json")
+    parser.add_argument("--output", default=report_path("pareto_report.json"))
+    parser.add_argument("--emit", help="Write the selected model's model_data.c/.bin here")
+    args = parser.parse_args()
+
+    print("=" * 60)
+    print("Model Pareto Explorer")
+    print("=" * 60 + "\n")
+
+    info = json.loads(Path(args.model_info).read_text())
+    threshold = info["output_specification"]["confidence_threshold"]
+    recall_target = args.recall_target or info["acceptance"]["min_recall"]
+    print(f"Recall target: {recall_target:.2f} @ threshold {threshold}")
+
+    train_images, train_labels = (load_frames(args.train_dir) if args.train_dir
+                                  else synthetic_frames(args.train_samples, seed=1))
+    test_images, test_labels = (load_frames(args.test_dir) if args.test_dir
+                                else synthetic_frames(args.test_samples, seed=2))
+    print(f"Train frames: {len(train_images)} | Test frames: {len(test_images)}")
+
+    engine = NativeFireEngine()
+    fixed_ram = engine.context_size - ARENA_SIZE  # Context without the arena
+    results = []
+
+    for resolution, width, head in itertools.product(args.resolutions, args.widths, args.heads):
+        config = {"resolution": resolution, "width": width, "head": head}
+        try:
+            layers = get_variant_layers(config, args.checkpoint_dir, train_images, train_labels, args.epochs)
+        except RuntimeError as e:
+            print(f"  ⚠ Skipping {variant_key(**config)}: {e}")
+            continue
+
+        tensors = to_tensors(test_images, resolution)
+        calibration = to_tensors(train_images[:200], resolution)
+
+        for scheme in args.quant:
+            name = f"{variant_key(**config)}_{scheme}"
+            model = EngineQuantizer(per_channel=QUANT_SCHEMES[scheme]).quantize(
+                layers, (resolution, resolution, 1), calibration
+            )
+            arena = model.scratch_size + model.arena_size
+            if arena > ARENA_SIZE:
+                print(f"  ⚠ Skipping {name}: arena {arena} B exceeds {ARENA_SIZE} B")
+                continue
+
+            blob = model.to_bytes()
+            metrics = evaluate_variant(engine, blob, resolution, tensors, test_labels, threshold)
+            results.append({
+                "name": name, **config, "quantization": scheme, **metrics,
+                "m7_latency_ms": model.m7_latency_ms(),
+                "macs": model.macs(),
+                "ram_kb": (fixed_ram + arena) / 1024,
+                "flash_kb": len(blob) / 1024,
+                "_model": blob,
+            })
+
+    if not results:
+        print("No variants evaluated")
+        return
+
+    front = sorted(pareto_front(results), key=lambda r: r["m7_latency_ms"])
+    print_table(sorted(results, key=lambda r: r["m7_latency_ms"]), "All variants")
+    print_table(front, "Pareto front (accuracy / M7 latency / RAM / flash)")
+
+    eligible = [r for r in results if r["recall"] >= recall_target]
+    chosen = min(eligible, key=lambda r: (r["m7_latency_ms"], -r["accuracy"])) if eligible else None
+
+    print()
+    if chosen:
+        print(f"✓ Deploy: {chosen['name']} | recall {chosen['recall']:.1%} | "
+              f"{chosen['m7_latency_ms']:.2f} ms on M7 | {chosen['ram_kb']:.1f} KB RAM | "
+              f"{chosen['flash_kb']:.1f} KB flash")
+        if args.emit:
+            Path(args.emit).mkdir(parents=True, exist_ok=True)
+            shape = (chosen["resolution"], chosen["resolution"], 1)
+            source = write_model_source(chosen["_model"], Path(args.emit) / "model_data.c",
+                                        chosen["name"], shape, threshold,
+                                        source=chosen["name"], kind="engine model (FDM1)")
+            print(f"✓ C source saved: {source}")
+    else:
+        print(f"⚠ No variant reaches recall {recall_target:.2f}; train longer or add wider variants")
+
+    report = {
+        "recall_target": recall_target,
+        "confidence_threshold": threshold,
+        "selected": chosen["name"] if chosen else None,
+        "pareto_front": [r["name"] for r in front],
+        "variants": [{k: v for k, v in r.items() if not k.startswith("_")} for r in results],
+    }
+    Path(args.output).write_text(json.dumps(report, indent=2))
+    print(f"✓ Report saved: {args.output}")
+
+
+if __name__ == "__main__":
+    main()
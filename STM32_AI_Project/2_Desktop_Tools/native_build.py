@@ -0,0 +1,71 @@
+"""
+Native Build Helper
+Compile firmware C sources from the CubeIDE template into a host shared
+library, so desktop tools run the exact code that ships on the STM32
+"""
+
+import ctypes
+import os
+import subprocess
+import sys
+from pathlib import Path
+
+
+FIRMWARE_DIR = Path(__file__).resolve().parent.parent / "3_STM32_CubeIDE_Template"
+INCLUDE_DIR = FIRMWARE_DIR / "Core" / "Inc"
+SOURCE_DIR = FIRMWARE_DIR / "Core" / "Src"
+BUILD_DIR = Path(__file__).resolve().parent / "native_build"
+
+
+def report_path(name):
+    """Default path of a tool's JSON report: native_build/, out of the source tree"""
+    BUILD_DIR.mkdir(exist_ok=True)
+    return str(BUILD_DIR / name)
+
+
+def library_suffix():
+    """Shared library extension for this platform"""
+    if sys.platform == "win32":
+        return ".dll"
+    if sys.platform == "darwin":
+        return ".dylib"
+    return ".so"
+
+
+def build_shared_library(name, sources, extra_flags=(), compiler=None):
+    """
+    Compile firmware sources into native_build/lib<name>.so
+
+    Args:
+        name: Library name (without prefix/suffix)
+        sources: File names relative to Core/Src (or absolute paths)
+        extra_flags: Additional compiler flags (defines, -O level...)
+        compiler: C compiler, defaults to $CC or cc
+
+    Rebuilds only when a source or header is newer than the library.
+    """
+    BUILD_DIR.mkdir(exist_ok=True)
+    output = BUILD_DIR / f"lib{name}{library_suffix()}"
+    source_paths = [Path(s) if Path(s).is_absolute() else SOURCE_DIR / s for s in sources]
+
+    inputs = source_paths + sorted(INCLUDE_DIR.glob("*.h"))
+    if output.exists():
+        built = output.stat().st_mtime
+        if all(p.stat().st_mtime <= built for p in inputs):
+            return output
+
+    cc = compiler or os.environ.get("CC", "cc")
+    cmd = [cc, "-O2", "-std=c11", "-shared", "-fPIC", f"-I{INCLUDE_DIR}",
+           *extra_flags, *map(str, source_paths), "-o", str(output), "-lm"]
+
+    print(f"Building {output.name}...")
+    result = subprocess.run(cmd, capture_output=True, text=True)
+    if result.returncode != 0:
+        raise RuntimeError(f"Native build failed:\n{' '.join(cmd)}\n{result.stderr}")
+
+    return output
+
+
+def load_library(name, sources, extra_flags=()):
+    """Build (if needed) and load a firmware library via ctypes"""
+    return ctypes.CDLL(str(build_shared_library(name, sources, extra_flags)))
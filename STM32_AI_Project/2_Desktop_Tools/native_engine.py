@@ -0,0 +1,336 @@
+"""
+Native Engine Bindings
+Run the firmware inference engine (host build) from Python, with one
+engine context per worker thread for parallel evaluation
+"""
+
+import argparse
+import ctypes
+import os
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+
+from native_build import FIRMWARE_DIR, load_library
+
+
+ENGINE_SOURCES = ["ai_inference.c", "ai_engine.c", "ai_gemm.c", "thermal_sensor.c", "model_data.c",
+                  str(FIRMWARE_DIR / "Host" / "ai_thread_pool.c")]
+ENGINE_FLAGS = ["-pthread"]
+CACHE_LINE = 64  # AI_CACHE_LINE on host builds
+ARENA_SIZE = 64 * 1024  # AI_ENGINE_ARENA_SIZE
+MAX_HEADS = 4  # AI_ENGINE_MAX_HEADS
+LOCATION_MAX_CELLS = 16  # AI_LOCATION_MAX_CELLS
+TASKS_ALL = 0xFFFFFFFF  # AI_TASKS_ALL
+CAM_GRID = 4  # AI_CAM_GRID
+CAM_CELLS = CAM_GRID * CAM_GRID
+
+
+class AiHeadInfo(ctypes.Structure):
+    """Mirror of AiHeadInfo (ai_engine.h)"""
+    _fields_ = [
+        ("task", ctypes.c_uint8),
+        ("layer", ctypes.c_uint8),
+        ("offset", ctypes.c_uint16),
+        ("count", ctypes.c_uint16),
+        ("reserved", ctypes.c_uint16),
+    ]
+
+
+class AiCam(ctypes.Structure):
+    """Mirror of AiCam (ai_engine.h)"""
+    _fields_ = [
+        ("heat", ctypes.c_float * CAM_CELLS),
+        ("peak", ctypes.c_float),
+        ("peak_x", ctypes.c_uint16),
+        ("peak_y", ctypes.c_uint16),
+        ("map_w", ctypes.c_uint16),
+        ("map_h", ctypes.c_uint16),
+        ("valid", ctypes.c_uint32),
+    ]
+
+
+class FireDetectionModel(ctypes.Structure):
+    """Mirror of FireDetectionModel (stm32_ai_framework.h)"""
+    _fields_ = [
+        ("model_data", ctypes.c_void_p),
+        ("model_size", ctypes.c_uint32),
+        ("info", ctypes.c_void_p),
+        ("input_buffer", ctypes.c_float * 1024),
+        ("output_buffer", ctypes.c_float * 2),
+        ("smoke_buffer", ctypes.c_float * 2),
+        ("location_buffer", ctypes.c_float * LOCATION_MAX_CELLS),
+        ("fire_margin", ctypes.c_float),
+        ("smoke_margin", ctypes.c_float),
+        ("heads", AiHeadInfo * MAX_HEADS),
+        ("head_count", ctypes.c_uint32),
+        ("task_mask", ctypes.c_uint32),
+        ("tasks_run", ctypes.c_uint32),
+        ("cam_enabled", ctypes.c_uint32),
+        ("cam", AiCam),
+        ("inference_time_ms", ctypes.c_uint32),
+        ("engine_layers", ctypes.c_int32),
+        ("pool", ctypes.c_void_p),
+        ("arena", ctypes.c_int8 * ARENA_SIZE),
+    ]
+
+
+class ModelInfo(ctypes.Structure):
+    """Mirror of ModelInfo (stm32_ai_framework.h)"""
+    _fields_ = [
+        ("model_name", ctypes.c_char_p),
+        ("model_version", ctypes.c_char_p),
+        ("input_width", ctypes.c_uint32),
+        ("input_height", ctypes.c_uint32),
+        ("input_channels", ctypes.c_uint32),
+        ("confidence_threshold", ctypes.c_float),
+    ]
+
+
+class DetectionResult(ctypes.Structure):
+    """Mirror of DetectionResult (stm32_ai_framework.h)"""
+    _fields_ = [
+        ("fire_detected", ctypes.c_int),
+        ("confidence", ctypes.c_float),
+        ("alert_level", ctypes.c_int),
+        ("smoke_detected", ctypes.c_int),
+        ("smoke_confidence", ctypes.c_float),
+        ("location_valid", ctypes.c_int),
+        ("location_x", ctypes.c_uint8),
+        ("location_y", ctypes.c_uint8),
+        ("location_grid", ctypes.c_uint8),
+        ("location_confidence", ctypes.c_float),
+        ("cam_valid", ctypes.c_int),
+        ("cam_heat", ctypes.c_uint8 * CAM_CELLS),
+        ("cam_peak_x", ctypes.c_uint16),
+        ("cam_peak_y", ctypes.c_uint16),
+        ("temperature_estimate", ctypes.c_float),
+        ("thermal_hot", ctypes.c_int),
+        ("analog_level", ctypes.c_int),
+        ("crackle_confidence", ctypes.c_float),
+        ("crackle_detected", ctypes.c_int),
+    ]
+
+
+class NativeFireEngine:
+    """Host build of the firmware engine (ai_inference.c + model_data.c)"""
+
+    def __init__(self, sources=ENGINE_SOURCES, extra_flags=()):
+        self.lib = load_library("fire_engine", sources, [*ENGINE_FLAGS, *extra_flags])
+        ctx_p = ctypes.POINTER(FireDetectionModel)
+
+        self.lib.fire_detection_init.argtypes = [ctx_p]
+        self.lib.fire_detection_init.restype = ctypes.c_int32
+        self.lib.fire_detection_init_model.argtypes = [
+            ctx_p, ctypes.c_void_p, ctypes.c_uint32, ctypes.POINTER(ModelInfo)
+        ]
+        self.lib.fire_detection_init_model.restype = ctypes.c_int32
+        self.lib.fire_detection_context_size.restype = ctypes.c_uint32
+        self.lib.preprocess_image.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_void_p]
+        self.lib.preprocess_image.restype = None
+        self.lib.fire_detection_inference.argtypes = [ctx_p]
+        self.lib.fire_detection_inference.restype = ctypes.c_float
+        self.lib.fire_detection_inference_image.argtypes = [ctx_p, ctypes.c_void_p]
+        self.lib.fire_detection_inference_image.restype = ctypes.c_float
+        self.lib.process_detection_output.argtypes = [ctx_p, ctypes.c_void_p]  # NULL: default thresholds
+        self.lib.process_detection_output.restype = DetectionResult
+        self.lib.fire_detection_set_tasks.argtypes = [ctx_p, ctypes.c_uint32]
+        self.lib.fire_detection_set_tasks.restype = None
+        self.lib.fire_detection_reset_state.argtypes = [ctx_p]
+        self.lib.fire_detection_reset_state.restype = None
+        self.lib.fire_detection_set_cam.argtypes = [ctx_p, ctypes.c_int32]
+        self.lib.fire_detection_set_cam.restype = ctypes.c_int32
+        self.lib.fire_detection_set_pool.argtypes = [ctx_p, ctypes.c_void_p]
+        self.lib.fire_detection_set_pool.restype = ctypes.c_int32
+        self.lib.ai_engine_worker_scratch_size.argtypes = [ctypes.c_void_p]
+        self.lib.ai_engine_worker_scratch_size.restype = ctypes.c_uint32
+        self.lib.ai_thread_pool_create.argtypes = [ctypes.c_uint32, ctypes.c_uint32, ctypes.c_uint32]
+        self.lib.ai_thread_pool_create.restype = ctypes.c_void_p
+        self.lib.ai_thread_pool_gemm.argtypes = [ctypes.c_void_p]
+        self.lib.ai_thread_pool_gemm.restype = ctypes.c_void_p
+        self.lib.ai_thread_pool_destroy.argtypes = [ctypes.c_void_p]
+        self.lib.ai_thread_pool_destroy.restype = None
+        self.lib.ai_thread_pool_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint64),
+                                                  ctypes.POINTER(ctypes.c_uint64)]
+        self.lib.ai_thread_pool_stats.restype = None
+
+        # The mirror must track the C struct exactly
+        self.context_size = self.lib.fire_detection_context_size()
+        padded = -(-ctypes.sizeof(FireDetectionModel) // CACHE_LINE) * CACHE_LINE
+        if padded != self.context_size:
+            raise RuntimeError(
+                f"FireDetectionModel mirror is {padded} bytes, C struct is {self.context_size}"
+            )
+
+    def create_context(self, model=None, input_shape=(32, 32, 1), confidence_threshold=0.7):
+        """
+        Allocate and initialize a cache-line aligned engine context
+
+        Args:
+            model: Model image (bytes, e.g. EngineModel.to_bytes()); None
+                   uses the built-in model_data
+            input_shape: (height, width, channels) for the ModelInfo
+        """
+        raw = ctypes.create_string_buffer(self.context_size + CACHE_LINE)
+        addr = (ctypes.addressof(raw) + CACHE_LINE - 1) & ~(CACHE_LINE - 1)
+        ctx = FireDetectionModel.from_address(addr)
+        ctx._raw = raw  # Keep the backing storage alive with the context
+
+        if model is None:
+            status = self.lib.fire_detection_init(ctypes.byref(ctx))
+        else:
+            # The context only references the image and info: keep both alive
+            ctx._model = ctypes.create_string_buffer(bytes(model), len(model))
+            h, w, c = input_shape
+            ctx._info = ModelInfo(b"variant", b"1.0", w, h, c, confidence_threshold)
+            status = self.lib.fire_detection_init_model(
+                ctypes.byref(ctx), ctx._model, len(model), ctypes.byref(ctx._info)
+            )
+        if status != 0:
+            raise RuntimeError("Engine context initialization failed")
+        return ctx
+
+    def infer(self, ctx, tensor):
+        """Inference on an already preprocessed float tensor; returns P(fire)"""
+        data = np.ascontiguousarray(tensor, dtype=np.float32).ravel()
+        ctypes.memmove(ctx.input_buffer, data.ctypes.data, data.nbytes)
+        return self.lib.fire_detection_inference(ctypes.byref(ctx))
+
+    def infer_image(self, ctx, image):
+        """Inference on a uint8 frame at the model's input shape (any resolution); returns P(fire)"""
+        frame = np.ascontiguousarray(image, dtype=np.uint8).ravel()
+        return self.lib.fire_detection_inference_image(ctypes.byref(ctx), frame.ctypes.data)
+
+    def set_tasks(self, ctx, tasks=None):
+        """Heads to run on a multi-task model (task ids, None = all)"""
+        mask = TASKS_ALL if tasks is None else sum(1 << t for t in tasks)
+        self.lib.fire_detection_set_tasks(ctypes.byref(ctx), mask)
+
+    def set_cam(self, ctx, enable=True):
+        """Class activation map of the fire output with each inference; False if the model cannot be mapped"""
+        return self.lib.fire_detection_set_cam(ctypes.byref(ctx), int(enable)) == 0
+
+    def create_pool(self, ctx, threads, min_macs=0):
+        """
+        Start a thread pool (threads including the caller) sized for ctx's
+        model and split ctx's large layers over it; min_macs 0 = the C default
+        """
+        scratch = self.lib.ai_engine_worker_scratch_size(ctx.model_data) if ctx.engine_layers else 0
+        pool = self.lib.ai_thread_pool_create(threads, scratch, min_macs)
+        if not pool:
+            raise RuntimeError("Thread pool creation failed")
+        if self.lib.fire_detection_set_pool(ctypes.byref(ctx), self.lib.ai_thread_pool_gemm(pool)) != 0:
+            self.lib.ai_thread_pool_destroy(pool)
+            raise RuntimeError("Context rejected the thread pool (no engine model?)")
+        return pool
+
+    def destroy_pool(self, ctx, pool):
+        """Detach pool from ctx and stop its threads"""
+        self.lib.fire_detection_set_pool(ctypes.byref(ctx), None)
+        self.lib.ai_thread_pool_destroy(pool)
+
+    def pool_stats(self, pool):
+        """(jobs, wakeups of parked workers) since the pool started"""
+        jobs, wakeups = ctypes.c_uint64(), ctypes.c_uint64()
+        self.lib.ai_thread_pool_stats(pool, ctypes.byref(jobs), ctypes.byref(wakeups))
+        return jobs.value, wakeups.value
+
+    def reset_state(self, ctx):
+        """Forget the frame history of the model's temporal layers"""
+        self.lib.fire_detection_reset_state(ctypes.byref(ctx))
+
+    def run(self, ctx, raw_image):
+        """Preprocess + inference + postprocess on one uint8 frame"""
+        frame = np.ascontiguousarray(raw_image, dtype=np.uint8).ravel()
+        self.lib.preprocess_image(frame.ctypes.data, frame.size, ctypes.addressof(ctx.input_buffer))
+
+        start = time.perf_counter()
+        self.lib.fire_detection_inference(ctypes.byref(ctx))
+        latency_ms = (time.perf_counter() - start) * 1000
+
+        result = self.lib.process_detection_output(ctypes.byref(ctx), None)
+        output = {
+            'fire_detected': bool(result.fire_detected),
+            'confidence': float(result.confidence),
+            'alert_level': int(result.alert_level),
+            'inference_time_ms': latency_ms
+        }
+        if ctx.head_count:
+            output['smoke_detected'] = bool(result.smoke_detected)
+            output['smoke_confidence'] = float(result.smoke_confidence)
+            if result.location_valid:
+                output['location'] = (int(result.location_x), int(result.location_y),
+                                      int(result.location_grid))
+        if result.cam_valid:
+            output['cam_heat'] = np.ctypeslib.as_array(result.cam_heat).reshape(CAM_GRID, CAM_GRID).copy()
+            output['cam_peak'] = (int(result.cam_peak_x), int(result.cam_peak_y))
+        return output
+
+
+class ParallelEvaluator:
+    """
+    Evaluate frames on N threads, one engine context per thread
+
+    Contexts share the read-only model image and hold all mutable state,
+    so workers never lock. ctypes releases the GIL during C calls.
+    """
+
+    def __init__(self, workers=None, engine=None):
+        self.workers = workers or os.cpu_count() or 1
+        self.engine = engine or NativeFireEngine()
+        self.local = threading.local()
+
+    def _context(self):
+        if not hasattr(self.local, "ctx"):
+            self.local.ctx = self.engine.create_context()
+        return self.local.ctx
+
+    def _run(self, frame):
+        return self.engine.run(self._context(), frame)
+
+    def evaluate(self, frames):
+        """Results in input order"""
+        with ThreadPoolExecutor(max_workers=self.workers) as pool:
+            return list(pool.map(self._run, frames))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Parallel host evaluation of the firmware engine")
+    parser.add_argument("--frames", type=int, default=2000)
+    parser.add_argument("--workers", type=int, default=os.cpu_count())
+    args = parser.parse_args()
+
+    print("=" * 60)
+    print("Native Engine - Parallel Evaluation")
+    print("=" * 60 + "\n")
+
+    rng = np.random.default_rng(0)
+    frames = [rng.integers(0, 256, 1024, dtype=np.uint8) for _ in range(args.frames)]
+
+    engine = NativeFireEngine()
+    single = ParallelEvaluator(workers=1, engine=engine)
+    parallel = ParallelEvaluator(workers=args.workers, engine=engine)
+
+    start = time.perf_counter()
+    reference = single.evaluate(frames)
+    t_single = time.perf_counter() - start
+
+    start = time.perf_counter()
+    results = parallel.evaluate(frames)
+    t_parallel = time.perf_counter() - start
+
+    mismatches = sum(
+        a['confidence'] != b['confidence'] or a['alert_level'] != b['alert_level']
+        for a, b in zip(reference, results)
+    )
+
+    print(f"\nFrames:              {len(frames)}")
+    print(f"1 thread:            {len(frames) / t_single:.0f} FPS")
+    print(f"{args.workers} threads:           {len(frames) / t_parallel:.0f} FPS")
+    print(f"Result mismatches:   {mismatches}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,181 @@
+"""
+Patch Memory Planner
+Plan patch-based execution (ai_engine.h, AI_MODEL_FLAG_PATCHED) for
+high-resolution fire detection models: for every split point and grid,
+report peak activation RAM against the halo recomputation it costs, and
+pick the smallest plan that fits the engine arena within a few percent of
+the fewest MACs
+"""
+
+import argparse
+import json
+from pathlib import Path
+
+import numpy as np
+
+from engine_model import (
+    CONV_OPS, OP_CONV2D_3X3, OP_MAXPOOL_2X2, EngineQuantizer, load_checkpoint, random_layers,
+    write_model_source
+)
+from native_build import report_path
+
+
+ARENA_BUDGET = 64 * 1024          # AI_ENGINE_ARENA_SIZE
+MAC_SLACK = 0.03                  # Extra MACs worth paying for a smaller plan
+REFERENCE_RESOLUTION = 32         # create_model() input: the RAM level to stay near
+BASE_FILTERS = (16, 32, 64)
+
+
+def plan_row(model, patch_layers, grid):
+    """RAM / compute figures of one patch plan (patch_layers 0 = full frame)"""
+    candidate = model.patched(patch_layers, grid)
+    costs = candidate.layer_costs()
+    macs = sum(c["macs"] for c in costs)
+    full = sum(c["full_macs"] for c in costs)
+    row = {
+        "patch_layers": patch_layers,
+        "grid": grid,
+        "ram": candidate.scratch_size + candidate.arena_size,
+        "macs": macs,
+        "recompute": macs / full - 1,
+        "m7_latency_ms": candidate.m7_latency_ms(),
+        "_model": candidate,
+    }
+    if patch_layers:
+        oh, ow, oc = model.layers[patch_layers - 1]["out_shape"]
+        row["map"] = oh * ow * oc
+        row["tile"] = f"{-(-ow // grid)}x{-(-oh // grid)}"
+    return row
+
+
+def split_points(model):
+    """Layer counts ending on a max pool with only conv / pool before it"""
+    points = []
+    for i, layer in enumerate(model.layers[:-1]):
+        if layer["op"] not in (*CONV_OPS, OP_MAXPOOL_2X2):
+            break
+        if layer["op"] != OP_CONV2D_3X3:
+            points.append(i + 1)
+    return points
+
+
+def build_model(args, resolution, seed):
+    shape = (resolution, resolution, 1)
+    if args.checkpoint and resolution == args.resolution:
+        layers, _ = load_checkpoint(args.checkpoint)
+    else:
+        filters = tuple(max(4, int(round(f * args.width))) for f in BASE_FILTERS)
+        layers = random_layers(shape, filters, args.head_units, seed)
+    calibration = np.random.default_rng(seed).random((32, *shape)).astype(np.float32)
+    return EngineQuantizer().quantize(layers, shape, calibration)
+
+
+def verify_plan(model, frames, seed):
+    """Native engine on the patched image vs the full-frame int8 reference"""
+    from native_engine import NativeFireEngine
+
+    engine = NativeFireEngine()
+    ctx = engine.create_context(model.to_bytes(), model.input_shape)
+    images = np.random.default_rng(seed).integers(0, 256, (frames, *model.input_shape)).astype(np.uint8)
+    logits = model.run(images.astype(np.float32) / 255.0)
+    expected = np.exp(logits[:, 1]) / np.exp(logits).sum(axis=1)
+    got = np.array([engine.infer_image(ctx, image) for image in images])
+    return float(np.abs(got - expected).max())
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Patch-based execution memory planner")
+    parser.add_argument("--resolution", type=int, default=128, help="Square input size (64-128)")
+    parser.add_argument("--checkpoint", help=".npz from save_checkpoint() at --resolution")
+    parser.add_argument("--width", type=float, default=1.0, help="Filter width multiplier")
+    parser.add_argument("--head-units", type=int, default=0,
+                        help="Dense head units (0 = global average pooling head)")
+    parser.add_argument("--budget-kb", type=float, default=ARENA_BUDGET / 1024,
+                        help="Activation RAM budget (GEMM scratch + arena)")
+    parser.add_argument("--mac-slack", type=float, default=MAC_SLACK,
+                        help="Take the least RAM among fitting plans within this fraction of the fewest MACs")
+    parser.add_argument("--max-grid", type=int, default=8)
+    parser.add_argument("--verify", type=int, default=0, metavar="FRAMES",
+                        help="Check the chosen plan on the native engine")
+    parser.add_argument("--emit", help="Directory for model_data.c of the chosen plan")
+    parser.add_argument("--output", default=report_path("patch_plan.json"))
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    model = build_model(args, args.resolution, args.seed)
+    reference = build_model(args, REFERENCE_RESOLUTION, args.seed)
+    budget = args.budget_kb * 1024
+
+    print("=" * 60)
+    print("PATCH MEMORY PLANNER")
+    print("=" * 60)
+    print(f"Input: {args.resolution}x{args.resolution} (8-bit frame {args.resolution ** 2 / 1024:.1f} KB, "
+          f"outside the arena) | budget {budget / 1024:.1f} KB")
+    ref = plan_row(reference, 0, 0)
+    print(f"Reference: {REFERENCE_RESOLUTION}x{REFERENCE_RESOLUTION} full frame needs "
+          f"{ref['ram'] / 1024:.1f} KB, {ref['m7_latency_ms']:.2f} ms on M7")
+    print()
+
+    rows = [plan_row(model, 0, 0)]
+    for points in split_points(model):
+        oh, ow, _ = model.layers[points - 1]["out_shape"]
+        rows += [plan_row(model, points, g) for g in range(2, min(args.max_grid, oh, ow) + 1)]
+
+    print(f"{'split':>5} {'grid':>4} {'tile':>6} {'map KB':>7} {'RAM KB':>7} {'vs 32x32':>8} "
+          f"{'recompute':>9} {'M7 ms':>7}")
+    for r in rows:
+        fits = "✓" if r["ram"] <= budget else " "
+        split = r["patch_layers"] or "full"
+        map_kb = f"{r['map'] / 1024:.1f}" if r["patch_layers"] else "-"
+        print(f"{split:>5} {r['grid'] or '-':>4} {r.get('tile', '-'):>6} {map_kb:>7} "
+              f"{r['ram'] / 1024:>7.1f} {r['ram'] / ref['ram']:>7.2f}x {r['recompute']:>8.1%} "
+              f"{r['m7_latency_ms']:>7.2f} {fits}")
+
+    # Least RAM among the fitting plans that cost about the fewest MACs: a
+    # plan that fills the arena to save a percent of compute is not worth it
+    eligible = [r for r in rows if r["ram"] <= budget]
+    chosen = None
+    if eligible:
+        fewest = min(r["macs"] for r in eligible)
+        cheap = [r for r in eligible if r["macs"] <= fewest * (1 + args.mac_slack)]
+        chosen = min(cheap, key=lambda r: (r["ram"], r["m7_latency_ms"]))
+    smallest = min(rows, key=lambda r: r["ram"])
+
+    print()
+    if chosen:
+        plan = (f"{chosen['patch_layers']} layers on a {chosen['grid']}x{chosen['grid']} grid"
+                if chosen["patch_layers"] else "full frame")
+        print(f"✓ Plan: {plan} | {chosen['ram'] / 1024:.1f} KB | +{chosen['recompute']:.1%} MACs | "
+              f"{chosen['m7_latency_ms']:.2f} ms on M7")
+        if smallest is not chosen:
+            print(f"  Smallest: {smallest['ram'] / 1024:.1f} KB at +{smallest['recompute']:.1%} MACs "
+                  f"({smallest['m7_latency_ms']:.2f} ms)")
+        if args.verify:
+            error = verify_plan(chosen["_model"], args.verify, args.seed)
+            status = "✓" if error < 1e-6 else "⚠"
+            print(f"{status} Native engine vs full-frame reference: max |ΔP(fire)| {error:.2e}")
+        if args.emit:
+            Path(args.emit).mkdir(parents=True, exist_ok=True)
+            shape = chosen["_model"].input_shape
+            source = write_model_source(chosen["_model"].to_bytes(), Path(args.emit) / "model_data.c",
+                                        f"fire_r{args.resolution}", shape,
+                                        source=args.checkpoint or "random weights",
+                                        kind="engine model (FDM1, patched)")
+            print(f"✓ C source saved: {source}")
+    else:
+        print(f"⚠ No plan fits {budget / 1024:.1f} KB; smallest needs {smallest['ram'] / 1024:.1f} KB")
+
+    report = {
+        "resolution": args.resolution,
+        "budget_bytes": budget,
+        "mac_slack": args.mac_slack,
+        "reference_bytes": ref["ram"],
+        "selected": {k: v for k, v in chosen.items() if not k.startswith("_")} if chosen else None,
+        "plans": [{k: v for k, v in r.items() if not k.startswith("_")} for r in rows],
+    }
+    Path(args.output).write_text(json.dumps(report, indent=2))
+    print(f"✓ Report saved: {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,263 @@
+"""
+Pixel Pipeline Checker
+Run the software backend of the firmware's pixel pipeline (pixel_pipeline.c,
+the fallback when there is no DMA2D or the engine fails the self-test) on
+the host and compare every job bit for bit with a NumPy model of the
+DMA2D's arithmetic: format conversion, alpha blending, tints, fills and
+copies, on areas of odd widths inside images whose strides leave a nonzero
+line offset. Pixels around each area must stay untouched.
+"""
+
+import argparse
+import ctypes
+import json
+
+import numpy as np
+
+from native_build import load_library, report_path
+
+
+# pixel_pipeline.h
+PIXEL_ARGB8888 = 0
+PIXEL_RGB888 = 1
+PIXEL_RGB565 = 2
+PIXEL_A8 = 9
+PIXEL_OK = 0
+PIXEL_ERR_JOB = -1
+
+MODE_COPY, MODE_CONVERT, MODE_BLEND, MODE_TINT, MODE_FILL = range(5)
+MODE_NAMES = ["COPY", "CONVERT", "BLEND", "TINT", "FILL"]
+FORMAT_NAMES = {PIXEL_ARGB8888: "ARGB8888", PIXEL_RGB888: "RGB888", PIXEL_RGB565: "RGB565", PIXEL_A8: "A8"}
+BYTES_PER_PIXEL = {PIXEL_ARGB8888: 4, PIXEL_RGB888: 3, PIXEL_RGB565: 2, PIXEL_A8: 1}
+
+OUTPUT_FORMATS = (PIXEL_ARGB8888, PIXEL_RGB888, PIXEL_RGB565)
+SOURCE_FORMATS = OUTPUT_FORMATS + (PIXEL_A8,)
+
+# Image widths (fg, bg, dst) and height: different strides per surface
+IMAGE_WIDTHS = (37, 41, 39)
+IMAGE_HEIGHT = 9
+AREA_X, AREA_Y = 5, 3
+AREA_HEIGHT = 5
+COLOR = 0x80FF6020
+
+
+class PixelSurface(ctypes.Structure):
+    _fields_ = [("data", ctypes.c_void_p), ("stride", ctypes.c_uint16), ("format", ctypes.c_uint8)]
+
+
+class PixelJob(ctypes.Structure):
+    _fields_ = [("mode", ctypes.c_uint8), ("alpha", ctypes.c_uint8), ("width", ctypes.c_uint16),
+                ("height", ctypes.c_uint16), ("fg", PixelSurface), ("bg", PixelSurface),
+                ("dst", PixelSurface), ("color", ctypes.c_uint32)]
+
+
+# ==================== NUMPY REFERENCE ====================
+
+def decode(pixels, fmt, color):
+    """(..., bpp) bytes -> A, R, G, B planes (int64), widened as on the DMA2D"""
+    p = pixels.astype(np.int64)
+    if fmt == PIXEL_ARGB8888:
+        return p[..., 3], p[..., 2], p[..., 1], p[..., 0]
+    if fmt == PIXEL_RGB888:
+        return np.full_like(p[..., 0], 255), p[..., 2], p[..., 1], p[..., 0]
+    if fmt == PIXEL_RGB565:
+        v = p[..., 0] | (p[..., 1] << 8)
+        r, g, b = v >> 11, (v >> 5) & 0x3F, v & 0x1F
+        return np.full_like(v, 255), (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)
+    a = p[..., 0]
+    return (a, np.full_like(a, (color >> 16) & 0xFF), np.full_like(a, (color >> 8) & 0xFF),
+            np.full_like(a, color & 0xFF))
+
+
+def encode(argb, fmt):
+    """A, R, G, B planes -> (..., bpp) bytes; RGB565 truncates"""
+    a, r, g, b = argb
+    if fmt == PIXEL_ARGB8888:
+        return np.stack([b, g, r, a], axis=-1).astype(np.uint8)
+    if fmt == PIXEL_RGB888:
+        return np.stack([b, g, r], axis=-1).astype(np.uint8)
+    v = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+    return np.stack([v & 0xFF, v >> 8], axis=-1).astype(np.uint8)
+
+
+def modulate(argb, alpha):
+    a, r, g, b = argb
+    return (a if alpha == 255 else a * alpha // 255), r, g, b
+
+
+def blend(fg, bg):
+    a_fg, a_bg = fg[0], bg[0]
+    a_mult = a_fg * a_bg // 255
+    a_out = a_fg + a_bg - a_mult
+    safe = np.maximum(a_out, 1)
+    out = [a_out] + [(c_fg * a_fg + c_bg * a_bg - c_bg * a_mult) // safe for c_fg, c_bg in zip(fg[1:], bg[1:])]
+    return tuple(np.where(a_out == 0, 0, c) for c in out)
+
+
+def reference(mode, alpha, fg, fg_fmt, bg, bg_fmt, dst_fmt, shape):
+    """Expected area of the destination, (h, w, bpp) bytes; shape is (h, w)"""
+    if mode == MODE_COPY:
+        return fg.copy()
+    if mode == MODE_CONVERT:
+        return encode(modulate(decode(fg, fg_fmt, COLOR), alpha), dst_fmt)
+    if mode == MODE_BLEND:
+        return encode(blend(modulate(decode(fg, fg_fmt, COLOR), alpha), decode(bg, bg_fmt, 0)), dst_fmt)
+    color = tuple(np.full(shape, (COLOR >> s) & 0xFF, dtype=np.int64) for s in (24, 16, 8, 0))
+    if mode == MODE_TINT:
+        return encode(blend((np.full(shape, alpha, dtype=np.int64),) + color[1:], decode(bg, bg_fmt, 0)), dst_fmt)
+    return encode(color, dst_fmt)
+
+
+# ==================== NATIVE ====================
+
+class PixelBackend:
+    """Host build of pixel_pipeline.c: no PixelOps, so every job runs in software"""
+
+    def __init__(self):
+        self.lib = lib = load_library("fire_pixel", ["pixel_pipeline.c"])
+        lib.pixel_run_software.argtypes = [ctypes.POINTER(PixelJob)]
+        lib.pixel_run_software.restype = ctypes.c_int32
+        lib.pixel_check.argtypes = [ctypes.POINTER(PixelJob)]
+        lib.pixel_check.restype = ctypes.c_int32
+
+    def run(self, job):
+        return self.lib.pixel_run_software(ctypes.byref(job))
+
+    def check(self, job):
+        return self.lib.pixel_check(ctypes.byref(job))
+
+
+def image(rng, width, fmt):
+    return rng.integers(0, 256, (IMAGE_HEIGHT, width, BYTES_PER_PIXEL[fmt]), dtype=np.uint8)
+
+
+def surface(img, fmt, x=AREA_X, y=AREA_Y):
+    if img is None:
+        return PixelSurface(None, 0, 0)
+    bpp = BYTES_PER_PIXEL[fmt]
+    return PixelSurface(img.ctypes.data + (y * img.shape[1] + x) * bpp, img.shape[1], fmt)
+
+
+def run_case(backend, rng, mode, width, alpha, fg_fmt, bg_fmt, dst_fmt, in_place=False):
+    """One job against the reference; returns mismatching bytes (area + surroundings)"""
+    area = np.s_[AREA_Y:AREA_Y + AREA_HEIGHT, AREA_X:AREA_X + width]
+    fg = image(rng, IMAGE_WIDTHS[0], fg_fmt) if mode in (MODE_COPY, MODE_CONVERT, MODE_BLEND) else None
+    dst = image(rng, IMAGE_WIDTHS[2], dst_fmt)
+    if mode in (MODE_BLEND, MODE_TINT):
+        bg = dst if in_place else image(rng, IMAGE_WIDTHS[1], bg_fmt)
+    else:
+        bg = None
+
+    expect = dst.copy()
+    expect[area] = reference(mode, alpha, fg[area] if fg is not None else None, fg_fmt,
+                             bg[area] if bg is not None else None, bg_fmt, dst_fmt, (AREA_HEIGHT, width))
+
+    job = PixelJob(mode, alpha, width, AREA_HEIGHT, surface(fg, fg_fmt), surface(bg, bg_fmt),
+                   surface(dst, dst_fmt), COLOR)
+    status = backend.run(job)
+    if status != PIXEL_OK:
+        return -1
+    return int((dst != expect).sum())
+
+
+def cases():
+    """(mode, alpha, fg, bg, dst, in_place) for every mode and format pair"""
+    for fmt in OUTPUT_FORMATS:
+        yield MODE_COPY, 255, fmt, 0, fmt, False
+    for fg in SOURCE_FORMATS:
+        for dst in OUTPUT_FORMATS:
+            for alpha in (255, 77):
+                yield MODE_CONVERT, alpha, fg, 0, dst, False
+    for fg in SOURCE_FORMATS:
+        for bg in OUTPUT_FORMATS:
+            for dst in OUTPUT_FORMATS:
+                for alpha in (255, 131):
+                    yield MODE_BLEND, alpha, fg, bg, dst, False
+        yield MODE_BLEND, 200, fg, PIXEL_RGB565, PIXEL_RGB565, True
+    for bg in OUTPUT_FORMATS:
+        for dst in OUTPUT_FORMATS:
+            yield MODE_TINT, 96, 0, bg, dst, False
+        yield MODE_TINT, 180, 0, bg, bg, True
+    for dst in OUTPUT_FORMATS:
+        yield MODE_FILL, 255, 0, 0, dst, False
+
+
+def rejected_jobs(backend):
+    """Jobs both backends must refuse (pixel_check())"""
+    img = np.zeros((IMAGE_HEIGHT, IMAGE_WIDTHS[2], 4), dtype=np.uint8)
+    area = surface(img, PIXEL_RGB565)
+    checks = {
+        "stride below width": PixelJob(MODE_FILL, 255, IMAGE_WIDTHS[2] + 1, 1, PixelSurface(), PixelSurface(),
+                                       PixelSurface(img.ctypes.data, IMAGE_WIDTHS[2], PIXEL_RGB565), COLOR),
+        "copy across formats": PixelJob(MODE_COPY, 255, 7, 3, surface(img, PIXEL_RGB888), PixelSurface(),
+                                        area, COLOR),
+        "misaligned RGB565": PixelJob(MODE_FILL, 255, 7, 3, PixelSurface(), PixelSurface(),
+                                      PixelSurface(area.data + 1, area.stride, PIXEL_RGB565), COLOR),
+        "A8 destination": PixelJob(MODE_FILL, 255, 7, 3, PixelSurface(), PixelSurface(),
+                                   PixelSurface(img.ctypes.data, IMAGE_WIDTHS[2], PIXEL_A8), COLOR),
+    }
+    return {name: backend.check(job) == PIXEL_ERR_JOB and backend.run(job) == PIXEL_ERR_JOB
+            for name, job in checks.items()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pixel pipeline software backend checker")
+    parser.add_argument("--widths", type=int, nargs="+", default=[1, 13, 31],
+                        help=f"Area widths (up to {min(IMAGE_WIDTHS) - AREA_X})")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--output", default=report_path("pixel_check_report.json"))
+    args = parser.parse_args()
+    if any(w < 1 or w > min(IMAGE_WIDTHS) - AREA_X for w in args.widths):
+        parser.error(f"--widths must be 1..{min(IMAGE_WIDTHS) - AREA_X}")
+
+    backend = PixelBackend()
+    rng = np.random.default_rng(args.seed)
+
+    print("=" * 60)
+    print("PIXEL PIPELINE CHECK (software backend)")
+    print("=" * 60)
+    print(f"Images {'/'.join(map(str, IMAGE_WIDTHS))} px wide (fg/bg/dst), area at ({AREA_X}, {AREA_Y}), "
+          f"{AREA_HEIGHT} lines, widths {', '.join(map(str, args.widths))}")
+    print()
+
+    results = {}
+    failures = []
+    for mode, alpha, fg, bg, dst, in_place in cases():
+        for width in args.widths:
+            bad = run_case(backend, rng, mode, width, alpha, fg, bg, dst, in_place)
+            entry = results.setdefault(MODE_NAMES[mode], {"jobs": 0, "failed": 0})
+            entry["jobs"] += 1
+            if bad:
+                entry["failed"] += 1
+                failures.append({"mode": MODE_NAMES[mode], "width": width, "alpha": alpha,
+                                 "fg": FORMAT_NAMES.get(fg), "bg": FORMAT_NAMES.get(bg), "dst": FORMAT_NAMES[dst],
+                                 "in_place": in_place, "bytes": bad})
+
+    for name, entry in results.items():
+        mark = "✓" if entry["failed"] == 0 else "⚠"
+        print(f"{mark} {name:8} {entry['jobs']:4} jobs, {entry['failed']} differ from the reference")
+    for f in failures[:10]:
+        where = "status" if f["bytes"] < 0 else f"{f['bytes']} bytes"
+        print(f"    {f['mode']} {f['fg']} over {f['bg']} -> {f['dst']} width {f['width']} "
+              f"alpha {f['alpha']}{' in place' if f['in_place'] else ''}: {where}")
+
+    print()
+    print("Rejected jobs:")
+    rejected = rejected_jobs(backend)
+    for name, ok in rejected.items():
+        print(f"{'✓' if ok else '⚠'} {name}")
+
+    passed = not failures and all(rejected.values())
+    report = {"image_widths": IMAGE_WIDTHS, "area": [AREA_X, AREA_Y, AREA_HEIGHT], "widths": args.widths,
+              "modes": results, "failures": failures, "rejected": rejected, "passed": passed}
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=2)
+
+    print()
+    print(f"{'✓ Software backend matches the reference' if passed else '⚠ Pixel pipeline check FAILED'}")
+    print(f"Report: {args.output}")
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,396 @@
+"""
+Power Energy Model
+Replays a day of events (PIR motion, analog threshold wakes, lights, a
+fire) through the firmware's power manager (power_manager.c, host build)
+on a virtual clock: Stop / Sleep waits, screening frames and full-rate CNN
+frames are charged at per-mode current figures, giving average current
+and estimated battery life against the always-on 10 FPS loop
+"""
+
+import argparse
+import csv
+import ctypes
+import json
+from pathlib import Path
+
+import numpy as np
+
+from engine_model import EngineQuantizer, random_layers
+from native_build import load_library, report_path
+
+
+# power_manager.h
+WAKE_RTC, WAKE_PIR, WAKE_ANALOG = 0, 1, 2
+WAKE_SOURCES = 3
+WAKE_NAMES = ("rtc", "pir", "analog")
+MODE_IDLE, MODE_ALERT = 0, 1
+STAGE_NONE, STAGE_SCREEN, STAGE_CNN = 0, 1, 2
+
+# main.c
+SCREEN_MS, ACTIVE_MS, HOLD_MS = 5000, 100, 60000
+FRAME_SHAPE = (32, 32)
+
+# Battery-side current per state (mA); override with --currents file.json
+CURRENTS_MA = {
+    "run": 110.0,                    # STM32H743 at 480 MHz, caches on
+    "sleep": 30.0,                   # Sleep (WFI) with the PLL, SysTick and DMA running
+    "stop": 0.3,                     # Stop, SVOS5, SRAM retained, RTC + COMP + EXTI on
+    "camera": 30.0,                  # Image sensor streaming (0 when powered down)
+    "sensors": 0.4,                  # PIR, smoke / CO front-ends: always on
+}
+
+# Durations (ms) of the work around each stage
+TIMING_MS = {
+    "stop_exit": 0.5,                # HSI wakeup + PLL relock before full speed
+    "camera_start": 40.0,            # Sensor power-up to first usable frame
+    "capture": 5.0,                  # Frame transfer
+    "screen": 0.1,                   # Brightness statistics (256 samples)
+    "frame_overhead": 2.0,           # Fusion, logging, sensor service per CNN frame
+}
+
+NOW_FN = ctypes.CFUNCTYPE(ctypes.c_uint32, ctypes.c_void_p)
+WAIT_FN = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_uint32, ctypes.c_int)
+CAMERA_FN = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_int)
+
+
+class PowerPolicy(ctypes.Structure):
+    _fields_ = [
+        ("screen_period_ms", ctypes.c_uint32),
+        ("active_period_ms", ctypes.c_uint32),
+        ("hold_ms", ctypes.c_uint32),
+        ("min_stop_ms", ctypes.c_uint32),
+        ("bright_level", ctypes.c_uint8),
+        ("bright_rise", ctypes.c_uint16),
+        ("mean_change", ctypes.c_uint8),
+    ]
+
+
+class PowerOps(ctypes.Structure):
+    _fields_ = [("now_ms", NOW_FN), ("wait", WAIT_FN), ("camera", CAMERA_FN), ("user", ctypes.c_void_p)]
+
+
+class PowerManager(ctypes.Structure):
+    """Mirror of PowerManager (power_manager.h)"""
+    _fields_ = [
+        ("policy", PowerPolicy),
+        ("ops", PowerOps),
+        ("mode", ctypes.c_uint8),
+        ("camera_on", ctypes.c_uint8),
+        ("wake_count", ctypes.c_uint32 * WAKE_SOURCES),
+        ("wake_seen", ctypes.c_uint32 * WAKE_SOURCES),
+        ("next_frame_ms", ctypes.c_uint32),
+        ("last_evidence_ms", ctypes.c_uint32),
+        ("bg_mean", ctypes.c_uint32),
+        ("bg_bright", ctypes.c_uint32),
+        ("bg_valid", ctypes.c_uint32),
+        ("wakeups", ctypes.c_uint32 * WAKE_SOURCES),
+        ("stop_ms", ctypes.c_uint32),
+        ("sleep_ms", ctypes.c_uint32),
+        ("screens", ctypes.c_uint32),
+        ("cnn_frames", ctypes.c_uint32),
+        ("escalations", ctypes.c_uint32),
+    ]
+
+
+# ==================== DAY OF EVENTS ====================
+
+def synthetic_day(seed=0, fire_at=None):
+    """
+    Events (time_s, kind, value, duration_s) for one day: lights on 07:30
+    to 19:00, PIR motion (30/h in office hours, 1/h otherwise), a cooking
+    steam puff on the smoke channel at 12:15, optionally a fire at fire_at
+    hours (smoke reaches the detector 90 s after ignition)
+    """
+    rng = np.random.default_rng(seed)
+    events = [(0.0, "light", 25, 0.0), (7.5 * 3600, "light", 140, 0.0), (19 * 3600, "light", 25, 0.0)]
+    for hour in range(24):
+        rate = 30 if 8 <= hour < 18 else 1
+        for t in rng.uniform(hour * 3600, (hour + 1) * 3600, rng.poisson(rate)):
+            events.append((float(t), "pir", 0, 0.0))
+    events.append((12.25 * 3600, "analog", 0, 120.0))
+    if fire_at is not None:
+        events.append((fire_at * 3600, "fire", 0, 900.0))
+        events.append((fire_at * 3600 + 90, "analog", 0, 810.0))
+    return sorted(events)
+
+
+def load_day(path):
+    """CSV with time_s, event (pir / analog / light / fire), value, duration_s"""
+    with open(path, newline="") as f:
+        rows = [r for r in csv.reader(f) if r and not r[0].startswith("time")]
+    return sorted((float(r[0]), r[1], int(r[2] or 0), float(r[3] or 0)) for r in rows)
+
+
+def save_day(path, events):
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["time_s", "event", "value", "duration_s"])
+        for t, kind, value, duration in events:
+            writer.writerow([f"{t:.3f}", kind, value, duration])
+
+
+class Scene:
+    """Camera frames and ground truth for a time of day"""
+
+    def __init__(self, events, seed=0):
+        self.rng = np.random.default_rng(seed)
+        self.lights = [(t * 1000, v) for t, k, v, _ in events if k == "light"]
+        self.motion = np.array([t * 1000 for t, k, _, _ in events if k == "pir"])
+        self.fires = [(t * 1000, (t + d) * 1000) for t, k, _, d in events if k == "fire"]
+        self.analog = [(t * 1000, (t + d) * 1000) for t, k, _, d in events if k == "analog"]
+
+    def light(self, t):
+        level = 25
+        for start, value in self.lights:
+            if start <= t:
+                level = value
+        return level
+
+    def fire_age_ms(self, t):
+        return next((t - start for start, end in self.fires if start <= t < end), None)
+
+    def analog_rising(self, t):
+        return any(start <= t < end for start, end in self.analog)
+
+    def frame(self, t):
+        h, w = FRAME_SHAPE
+        img = np.full(FRAME_SHAPE, float(self.light(t))) + self.rng.normal(0, 3, FRAME_SHAPE)
+        recent = self.motion[(self.motion <= t) & (self.motion > t - 5000)]
+        if len(recent):  # Person: darker blob
+            y, x = self.rng.integers(0, h - 12), self.rng.integers(0, w - 8)
+            img[y:y + 12, x:x + 8] *= 0.6
+        age = self.fire_age_ms(t)
+        if age is not None:  # Flame: bright core growing over a minute
+            r = 1 + min(7.0, age / 8000)
+            yy, xx = np.mgrid[:h, :w]
+            img[(yy - h * 0.7) ** 2 + (xx - w / 2) ** 2 <= r * r] = 250
+        return np.clip(np.round(img), 0, 255).astype(np.uint8)
+
+
+# ==================== VIRTUAL DEVICE ====================
+
+class VirtualDevice:
+    """
+    power_manager.c on a virtual millisecond clock: waits advance the clock
+    to the next interrupt event or the deadline, every interval is charged
+    at the current of the state the firmware would be in
+    """
+
+    def __init__(self, events, currents, timing, vision_ms, seed=0):
+        self.lib = load_library("fire_power", ["power_manager.c"])
+        pm_p = ctypes.POINTER(PowerManager)
+        self.lib.power_init.argtypes = [pm_p, ctypes.POINTER(PowerPolicy), ctypes.POINTER(PowerOps)]
+        self.lib.power_init.restype = None
+        self.lib.power_wake_event.argtypes = [pm_p, ctypes.c_uint32]
+        self.lib.power_wake_event.restype = None
+        self.lib.power_wait.argtypes = [pm_p]
+        self.lib.power_wait.restype = ctypes.c_uint32
+        self.lib.power_stage.argtypes = [pm_p, ctypes.c_uint32]
+        self.lib.power_stage.restype = ctypes.c_uint8
+        self.lib.power_screen_frame.argtypes = [pm_p, ctypes.c_void_p, ctypes.c_uint32]
+        self.lib.power_screen_frame.restype = ctypes.c_int32
+        self.lib.power_report.argtypes = [pm_p, ctypes.c_uint8, ctypes.c_int32]
+        self.lib.power_report.restype = None
+
+        self.currents, self.timing, self.vision_ms = currents, timing, vision_ms
+        self.scene = Scene(events, seed)
+        self.interrupts = [(t * 1000, WAKE_PIR if k == "pir" else WAKE_ANALOG)
+                           for t, k, _, _ in events if k in ("pir", "analog")]
+        self.next_interrupt = 0
+        self.clock = 0.0
+        self.camera = False
+        self.camera_cold = False
+        self.time_ms = {"run": 0.0, "sleep": 0.0, "stop": 0.0}
+        self.charge = {name: 0.0 for name in currents}  # mA * ms
+        self.camera_ms = 0.0
+
+        # Keep the callbacks alive as long as the manager
+        self.callbacks = (NOW_FN(lambda user: int(self.clock) & 0xFFFFFFFF),
+                          WAIT_FN(self._wait), CAMERA_FN(self._camera))
+        self.ops = PowerOps(*self.callbacks, None)
+        policy = PowerPolicy(SCREEN_MS, ACTIVE_MS, HOLD_MS, 5, 220, 4, 24)
+        self.pm = PowerManager()
+        self.lib.power_init(ctypes.byref(self.pm), ctypes.byref(policy), ctypes.byref(self.ops))
+
+    def spend(self, state, ms):
+        self.clock += ms
+        self.time_ms[state] += ms
+        self.charge[state] += self.currents[state] * ms
+        self.charge["sensors"] += self.currents["sensors"] * ms
+        if self.camera:
+            self.charge["camera"] += self.currents["camera"] * ms
+            self.camera_ms += ms
+
+    def _wait(self, user, ms, deep):
+        state = "stop" if deep else "sleep"
+        deadline = self.clock + ms
+        if self.next_interrupt < len(self.interrupts) and self.interrupts[self.next_interrupt][0] <= deadline:
+            t, source = self.interrupts[self.next_interrupt]
+            self.next_interrupt += 1
+            self.spend(state, max(0.0, t - self.clock))
+            self.lib.power_wake_event(ctypes.byref(self.pm), source)
+        else:
+            self.spend(state, deadline - self.clock)
+        if deep:
+            self.spend("run", self.timing["stop_exit"])
+
+    def _camera(self, user, on):
+        self.camera = bool(on)
+        self.camera_cold = bool(on)
+
+    def run(self, end_ms):
+        """main.c's loop until end_ms; returns mode changes and the first fire detection"""
+        changes, detected, mode = [], None, MODE_IDLE
+        while self.clock < end_ms:
+            wake = self.lib.power_wait(ctypes.byref(self.pm))
+            stage = self.lib.power_stage(ctypes.byref(self.pm), wake)
+            if stage == STAGE_NONE:
+                continue
+            if self.camera_cold:
+                self.spend("sleep", self.timing["camera_start"])
+                self.camera_cold = False
+            self.spend("run", self.timing["capture"])
+            t = self.clock
+            analog = self.scene.analog_rising(t)
+
+            if stage == STAGE_SCREEN:
+                frame = self.scene.frame(t)
+                self.spend("run", self.timing["screen"])
+                evidence = self.lib.power_screen_frame(ctypes.byref(self.pm), frame.ctypes.data, frame.size)
+                cause = "screening" if evidence else "analog"
+                evidence = bool(evidence) or analog
+            else:
+                self.spend("run", self.vision_ms + self.timing["frame_overhead"])
+                fire = self.scene.fire_age_ms(t) is not None
+                if fire and detected is None:
+                    detected = t
+                cause = "analog wake" if wake & (1 << WAKE_ANALOG) else "detection"
+                evidence = fire or analog
+            self.lib.power_report(ctypes.byref(self.pm), stage, int(evidence))
+
+            if self.pm.mode != mode:
+                mode = self.pm.mode
+                changes.append({"time_s": t / 1000, "mode": "ALERT" if mode else "IDLE",
+                                "cause": cause if mode else "hold expired"})
+        return changes, detected
+
+
+def vision_m7_ms(seed=0):
+    """Default create_model() pattern at 32x32x1 on the M7 cost model"""
+    shape = (32, 32, 1)
+    calibration = np.random.default_rng(seed).random((16, *shape)).astype(np.float32)
+    return EngineQuantizer().quantize(random_layers(shape, seed=seed), shape, calibration).m7_latency_ms()
+
+
+def always_on_ma(currents, timing, vision_ms):
+    """Average current of the continuous loop: CNN every ACTIVE_MS, camera streaming, Sleep between"""
+    run = timing["capture"] + vision_ms + timing["frame_overhead"]
+    sleep = max(0.0, ACTIVE_MS - run)
+    return ((currents["run"] * run + currents["sleep"] * sleep) / ACTIVE_MS +
+            currents["camera"] + currents["sensors"])
+
+
+def clock_text(seconds):
+    s = int(seconds)
+    return f"{s // 3600:02d}:{s // 60 % 60:02d}:{s % 60:02d}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Duty-cycle energy model and battery life")
+    parser.add_argument("--day", help="Recorded events CSV (time_s, event, value, duration_s)")
+    parser.add_argument("--fire-at", type=float, help="Synthetic day: fire at this hour (e.g. 15.5)")
+    parser.add_argument("--save-day", help="Write the synthetic day as CSV")
+    parser.add_argument("--hours", type=float, default=24.0)
+    parser.add_argument("--currents", help="JSON overriding per-state currents (mA)")
+    parser.add_argument("--battery-mah", type=float, default=2600.0)
+    parser.add_argument("--usable", type=float, default=0.8, help="Usable fraction of the capacity")
+    parser.add_argument("--vision-ms", type=float, help="CNN latency (default: M7 cost model)")
+    parser.add_argument("--output", default=report_path("power_report.json"))
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    if args.day:
+        events, source = load_day(args.day), args.day
+    else:
+        events = synthetic_day(args.seed, args.fire_at)
+        source = "synthetic day" + (f", fire at {args.fire_at:g} h" if args.fire_at is not None else "")
+        if args.save_day:
+            save_day(args.save_day, events)
+
+    currents = dict(CURRENTS_MA)
+    if args.currents:
+        currents.update(json.loads(Path(args.currents).read_text()))
+    vision_ms = args.vision_ms if args.vision_ms is not None else vision_m7_ms(args.seed)
+
+    device = VirtualDevice(events, currents, TIMING_MS, vision_ms, args.seed)
+    print("=" * 60)
+    print("POWER ENERGY MODEL")
+    print("=" * 60)
+    print(f"Events: {source} | {len(events)} events over {args.hours:g} h")
+    print(f"Schedule: screen every {SCREEN_MS} ms in Stop, CNN every {ACTIVE_MS} ms in ALERT "
+          f"({vision_ms:.2f} ms), hold {HOLD_MS // 1000} s")
+    print()
+
+    end_ms = args.hours * 3600 * 1000
+    changes, detected = device.run(end_ms)
+    for c in changes:
+        print(f"  {clock_text(c['time_s'])}  {c['mode']:<5} ({c['cause']})")
+
+    pm = device.pm
+    total_ms = device.clock
+    charge_mah = {k: v / 3.6e6 for k, v in device.charge.items()}
+    average_ma = sum(device.charge.values()) / total_ms
+    baseline_ma = always_on_ma(currents, TIMING_MS, vision_ms)
+    usable = args.battery_mah * args.usable
+    life_days = usable / average_ma / 24
+    baseline_days = usable / baseline_ma / 24
+
+    print()
+    print(f"Wakeups: {', '.join(f'{n} {pm.wakeups[i]}' for i, n in enumerate(WAKE_NAMES))} | "
+          f"screens {pm.screens} | CNN frames {pm.cnn_frames} | escalations {pm.escalations}")
+    print("Time: " + ", ".join(f"{k} {v / total_ms:.2%}" for k, v in device.time_ms.items()) +
+          f" | camera on {device.camera_ms / total_ms:.2%}")
+    print("Charge: " + ", ".join(f"{k} {v:.2f} mAh" for k, v in charge_mah.items()))
+    print(f"Average {average_ma:.3f} mA -> {life_days:.1f} days on {args.battery_mah:g} mAh "
+          f"({args.usable:.0%} usable) | always-on 10 FPS {baseline_ma:.1f} mA -> {baseline_days:.1f} days")
+
+    # The firmware's own wait counters must agree with the virtual clock
+    counted = abs(pm.stop_ms - device.time_ms["stop"]) + abs(pm.sleep_ms - device.time_ms["sleep"])
+    consistent = counted <= 0.01 * total_ms
+    mark = "✓" if consistent else "⚠"
+    print(f"{mark} Firmware wait counters vs virtual clock: stop {pm.stop_ms} ms, sleep {pm.sleep_ms} ms")
+
+    fire_start = next((t for t, k, _, _ in events if k == "fire" and t * 1000 < end_ms), None)
+    latency_s = None
+    if fire_start is not None:
+        latency_s = None if detected is None else detected / 1000 - fire_start
+        mark = "✓" if latency_s is not None and latency_s <= SCREEN_MS / 1000 + 1 else "⚠"
+        print(f"{mark} Fire at {clock_text(fire_start)}: first CNN detection "
+              f"{'never' if latency_s is None else f'after {latency_s:.1f} s'}")
+
+    report = {
+        "source": source,
+        "hours": total_ms / 3.6e6,
+        "currents_ma": currents,
+        "timing_ms": TIMING_MS,
+        "vision_ms": vision_ms,
+        "mode_changes": changes,
+        "wakeups": dict(zip(WAKE_NAMES, list(pm.wakeups))),
+        "screens": pm.screens,
+        "cnn_frames": pm.cnn_frames,
+        "time_fraction": {k: v / total_ms for k, v in device.time_ms.items()},
+        "charge_mah": charge_mah,
+        "average_ma": average_ma,
+        "battery_life_days": life_days,
+        "always_on_ma": baseline_ma,
+        "always_on_days": baseline_days,
+        "fire_latency_s": latency_s,
+    }
+    Path(args.output).write_text(json.dumps(report, indent=2))
+    print(f"Report: {args.output}")
+    ok = consistent and (fire_start is None or (latency_s is not None and latency_s <= SCREEN_MS / 1000 + 1))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,307 @@
+"""
+QEMU Instruction Profile
+Run the firmware pipeline on an emulated Cortex-M7 board (QEMU mps2-an500,
+3_STM32_CubeIDE_Template/Qemu) and report the instructions executed per
+pipeline stage and per engine layer, next to the M7 cost model. Counts
+are deterministic, so a CI job can compare them with a stored baseline.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+from pathlib import Path
+
+import numpy as np
+
+from engine_model import HEADER, LAYER, OP_CODES, OP_CONV2D_3X3_POOL, OP_HEAD, EngineQuantizer, \
+    load_checkpoint, random_layers
+from native_build import BUILD_DIR, FIRMWARE_DIR, INCLUDE_DIR, SOURCE_DIR, report_path
+
+
+# ai_profile.h
+STAGES = {0x01: "frame", 0x02: "capture", 0x03: "inference", 0x04: "decision", 0x05: "thermal",
+          0x06: "analog", 0x07: "audio", 0x10: "engine", 0x11: "input", 0x12: "cam"}
+LAYER_BASE = 0x100
+
+OP_NAMES = {**{code: name for name, code in OP_CODES.items()}, OP_CONV2D_3X3_POOL: "conv+pool",
+            OP_HEAD: "head"}
+
+QEMU_DIR = FIRMWARE_DIR / "Qemu"
+ELF_SOURCES = [QEMU_DIR / "startup_mps2_an500.c", QEMU_DIR / "qemu_main.c"] + [
+    SOURCE_DIR / s for s in ("ai_inference.c", "ai_engine.c", "ai_gemm.c", "model_data.c", "thermal_sensor.c",
+                             "analog_sensors.c", "audio_frontend.c")]
+ARM_FLAGS = ["-O2", "-mcpu=cortex-m7", "-mthumb", "-mfloat-abi=hard", "-mfpu=fpv5-d16",
+             "-DAI_QEMU", "-DAI_PROFILE", "-nostartfiles", "--specs=rdimon.specs"]
+
+# Marks cost a few instructions each (call, return); changes below this
+# are noise from code layout, not regressions
+DEFAULT_TOLERANCE = 0.02
+
+
+# ==================== BUILD ====================
+
+def run(cmd, **kwargs):
+    result = subprocess.run(cmd, capture_output=True, text=True, **kwargs)
+    if result.returncode != 0:
+        raise RuntimeError(f"Command failed:\n{' '.join(map(str, cmd))}\n{result.stderr}")
+    return result.stdout
+
+
+def build_elf(cross_prefix):
+    """Firmware image for the board (rebuilt when a source or header is newer)"""
+    BUILD_DIR.mkdir(exist_ok=True)
+    elf = BUILD_DIR / "qemu_fire_detection.elf"
+    inputs = ELF_SOURCES + sorted(INCLUDE_DIR.glob("*.h")) + [QEMU_DIR / "mps2_an500.ld"]
+    if not elf.exists() or any(p.stat().st_mtime > elf.stat().st_mtime for p in inputs):
+        print(f"Building {elf.name}...")
+        run([f"{cross_prefix}gcc", *ARM_FLAGS, f"-I{INCLUDE_DIR}", "-T", QEMU_DIR / "mps2_an500.ld",
+             *ELF_SOURCES, "-o", elf, "-lm"])
+    return elf
+
+
+def build_plugin(qemu_include):
+    """insn_profile_plugin.c against the QEMU tree's qemu-plugin.h"""
+    BUILD_DIR.mkdir(exist_ok=True)
+    plugin = BUILD_DIR / "libinsn_profile.so"
+    source = QEMU_DIR / "insn_profile_plugin.c"
+    if not plugin.exists() or source.stat().st_mtime > plugin.stat().st_mtime:
+        print(f"Building {plugin.name}...")
+        glib = run(["pkg-config", "--cflags", "glib-2.0"]).split()
+        cc = os.environ.get("CC", "cc")
+        run([cc, "-shared", "-fPIC", "-O2", *glib, f"-I{qemu_include}", source, "-o", plugin])
+    return plugin
+
+
+def mark_address(elf, cross_prefix):
+    """Entry of ai_profile_mark() from the symbol table"""
+    for line in run([f"{cross_prefix}nm", elf]).splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[2] == "ai_profile_mark":
+            return int(fields[0], 16) & ~1
+    raise RuntimeError(f"ai_profile_mark not in {elf} (built without -DAI_PROFILE?)")
+
+
+# ==================== INPUTS ====================
+
+def build_model(checkpoint, seed):
+    """Engine model (as the converter writes it) for the profile"""
+    if checkpoint:
+        layers, config = load_checkpoint(checkpoint)
+        resolution = config.get("resolution", 32)
+        input_shape = (resolution, resolution, 1)
+    else:
+        input_shape = (32, 32, 1)
+        layers = random_layers(input_shape, seed=seed)
+    rng = np.random.default_rng(seed)
+    return EngineQuantizer().quantize(layers, input_shape, rng.random((32, *input_shape)).astype(np.float32))
+
+
+def read_table(blob):
+    """Input shape and layer table (op, in / out shape) of an FDM1 image"""
+    header = HEADER.unpack_from(blob)
+    layer_count, (w, h, c) = header[2], header[3:6]
+    layers = []
+    for i in range(layer_count):
+        op, _, _, _, iw, ih, ic, ow, oh, oc, *_ = LAYER.unpack_from(blob, HEADER.size + i * LAYER.size)
+        layers.append({"op": op, "in_shape": (ih, iw, ic), "out_shape": (oh, ow, oc)})
+    return (h, w, c), layers
+
+
+def write_frames(path, input_shape, count, source, seed):
+    """Raw 8-bit frames for the camera stand-in: a .npy stack or synthetic scenes"""
+    h, w, c = input_shape
+    if source:
+        frames = np.load(source).astype(np.uint8).reshape(-1, h * w * c)
+    else:
+        rng = np.random.default_rng(seed)
+        yy, xx = np.mgrid[0:h, 0:w]
+        frames = []
+        for i in range(count):
+            # Background with a bright blob that grows, like a developing fire
+            blob = np.exp(-((yy - h / 2) ** 2 + (xx - w / 2) ** 2) / (2 * (1 + i) ** 2))
+            frame = 60 + 150 * blob[..., None] + rng.normal(0, 8, (h, w, c))
+            frames.append(np.clip(frame, 0, 255).astype(np.uint8).ravel())
+        frames = np.array(frames)
+    frames.tofile(path)
+    return len(frames)
+
+
+# ==================== PROFILE ====================
+
+def run_qemu(qemu, elf, plugin, mark, model_path, frames_path, frames, profile_path, timeout):
+    args = ",".join(f"arg={a}" for a in ("fire", model_path, frames_path, frames))
+    cmd = [qemu, "-M", "mps2-an500", "-nographic", "-kernel", elf,
+           "-semihosting-config", f"enable=on,target=native,{args}",
+           "-plugin", f"{plugin},mark={mark:#x},out={profile_path}"]
+    result = subprocess.run(list(map(str, cmd)), capture_output=True, text=True, timeout=timeout)
+    if result.returncode != 0:
+        raise RuntimeError(f"Firmware exited with {result.returncode}:\n{result.stdout}\n{result.stderr}")
+    return result.stdout
+
+
+def parse_profile(path):
+    """{id: (calls, instructions)} and the header fields of the plugin output"""
+    counts, total, unbalanced = {}, 0, 0
+    for line in Path(path).read_text().splitlines():
+        fields = line.split()
+        if line.startswith("#"):
+            total, unbalanced = int(fields[2]), int(fields[4])
+        elif len(fields) == 3:
+            counts[int(fields[0], 16)] = (int(fields[1]), int(fields[2]))
+    return counts, total, unbalanced
+
+
+def profile_rows(counts, frames, layers, costs):
+    """Stage and layer rows, instructions per frame"""
+    stages, layer_rows = [], []
+    for key, name in STAGES.items():
+        if key in counts:
+            calls, insns = counts[key]
+            stages.append({"stage": name, "calls": calls, "insns_per_frame": insns / frames})
+
+    cost_iter = iter(costs or [])
+    for i, layer in enumerate(layers):
+        cost = next(cost_iter, None) if layer["op"] != OP_HEAD else None
+        if LAYER_BASE + i not in counts:
+            continue
+        calls, insns = counts[LAYER_BASE + i]
+        row = {"layer": i, "op": OP_NAMES.get(layer["op"], str(layer["op"])),
+               "in_shape": list(layer["in_shape"]), "out_shape": list(layer["out_shape"]),
+               "calls": calls, "insns_per_frame": insns / frames}
+        if cost:
+            row["macs"] = cost["macs"]
+            row["m7_cycles"] = cost["cycles"]
+        layer_rows.append(row)
+    return stages, layer_rows
+
+
+def compare(rows, baseline, key, tolerance):
+    """Rows whose instructions per frame grew beyond tolerance over the baseline"""
+    before = {r[key]: r["insns_per_frame"] for r in baseline}
+    regressions = []
+    for r in rows:
+        old = before.get(r[key])
+        if old and r["insns_per_frame"] > old * (1 + tolerance):
+            regressions.append({key: r[key], "baseline": old, "now": r["insns_per_frame"],
+                                "change": r["insns_per_frame"] / old - 1})
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Instruction profile on QEMU mps2-an500")
+    parser.add_argument("--model", help="FDM1 model image (default: built from --checkpoint or random weights)")
+    parser.add_argument("--checkpoint", help=".npz from save_checkpoint()")
+    parser.add_argument("--patch", help="Patch-based execution, LAYERSxGRID (e.g. 2x2)")
+    parser.add_argument("--sparse", action="store_true", help="Compressed post-ReLU activations (built model)")
+    parser.add_argument("--frames", type=int, default=8)
+    parser.add_argument("--frames-npy", help="Camera frames (N, H, W[, C] uint8) instead of synthetic ones")
+    parser.add_argument("--profile", help="Existing plugin output: report only, do not run QEMU")
+    parser.add_argument("--qemu", default="qemu-system-arm")
+    parser.add_argument("--qemu-include", help="QEMU include/qemu directory (qemu-plugin.h)")
+    parser.add_argument("--plugin", help="Prebuilt libinsn_profile.so")
+    parser.add_argument("--cross-prefix", default="arm-none-eabi-")
+    parser.add_argument("--baseline", help="Earlier report (JSON) to check for regressions")
+    parser.add_argument("--tolerance", type=float, default=DEFAULT_TOLERANCE)
+    parser.add_argument("--timeout", type=float, default=600)
+    parser.add_argument("--output", default=report_path("qemu_profile.json"))
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    # Model: the file as given, or one built here (with cost-model figures)
+    costs = None
+    model_path = BUILD_DIR / "qemu_model.bin"
+    BUILD_DIR.mkdir(exist_ok=True)
+    if args.model:
+        model_path = Path(args.model)
+        blob = model_path.read_bytes()
+    else:
+        model = build_model(args.checkpoint, args.seed)
+        if args.patch:
+            patch_layers, grid = map(int, args.patch.lower().split("x"))
+            model = model.patched(patch_layers, grid)
+        if args.sparse:
+            model = model.compressed()
+        blob = model.to_bytes()
+        model_path.write_bytes(blob)
+        costs = model.layer_costs()
+    input_shape, layers = read_table(blob)
+
+    frames_path = BUILD_DIR / "qemu_frames.raw"
+    write_frames(frames_path, input_shape, args.frames, args.frames_npy, args.seed)
+    frames = args.frames  # A shorter frame file is replayed from the start
+
+    if args.profile:
+        profile_path = Path(args.profile)
+    else:
+        for tool in (f"{args.cross_prefix}gcc", args.qemu):
+            if not shutil.which(tool):
+                parser.error(f"{tool} not found (or pass --profile with an existing plugin output)")
+        elf = build_elf(args.cross_prefix)
+        mark = mark_address(elf, args.cross_prefix)
+        if args.plugin:
+            plugin = Path(args.plugin)
+        elif args.qemu_include:
+            plugin = build_plugin(args.qemu_include)
+        else:
+            parser.error("--plugin or --qemu-include is required to run QEMU")
+        profile_path = BUILD_DIR / "qemu_profile.txt"
+        run_qemu(args.qemu, elf, plugin, mark, model_path, frames_path, frames, profile_path, args.timeout)
+
+    counts, total, unbalanced = parse_profile(profile_path)
+    stages, layer_rows = profile_rows(counts, frames, layers, costs)
+
+    print("=" * 60)
+    print("QEMU INSTRUCTION PROFILE (Cortex-M7, mps2-an500)")
+    print("=" * 60)
+    h, w, c = input_shape
+    print(f"Model: {len(layers)} layers, {w}x{h}x{c} input | {frames} frames | "
+          f"{total:,} instructions in total")
+    if unbalanced:
+        print(f"⚠ {unbalanced} unbalanced profiling marks: counts of the enclosing stages are unreliable")
+    print()
+
+    frame_insns = next((s["insns_per_frame"] for s in stages if s["stage"] == "frame"), 0)
+    print(f"{'stage':<10} {'calls':>6} {'insns/frame':>12} {'share':>6}")
+    for s in stages:
+        share = f"{s['insns_per_frame'] / frame_insns:.0%}" if frame_insns else ""
+        print(f"{s['stage']:<10} {s['calls']:>6} {s['insns_per_frame']:>12,.0f} {share:>6}")
+
+    print()
+    print(f"{'layer':<6} {'op':<10} {'in':>12} {'out':>12} {'calls':>6} {'insns/frame':>12} "
+          f"{'M7 cyc':>10} {'insn/cyc':>8}")
+    for r in layer_rows:
+        shape_in = "x".join(map(str, r["in_shape"]))
+        shape_out = "x".join(map(str, r["out_shape"]))
+        model_cycles = f"{r['m7_cycles']:>10,.0f} {r['insns_per_frame'] / r['m7_cycles']:>8.2f}" \
+            if r.get("m7_cycles") else ""
+        print(f"{r['layer']:<6} {r['op']:<10} {shape_in:>12} {shape_out:>12} {r['calls']:>6} "
+              f"{r['insns_per_frame']:>12,.0f} {model_cycles}")
+
+    report = {"input_shape": list(input_shape), "frames": frames, "total_instructions": total,
+              "unbalanced_marks": unbalanced, "stages": stages, "layers": layer_rows}
+
+    passed = unbalanced == 0
+    if args.baseline:
+        baseline = json.loads(Path(args.baseline).read_text())
+        regressions = compare(stages, baseline["stages"], "stage", args.tolerance) + \
+            compare(layer_rows, baseline["layers"], "layer", args.tolerance)
+        report["regressions"] = regressions
+        print()
+        if regressions:
+            for r in regressions:
+                name = r.get("stage", f"layer {r.get('layer')}")
+                print(f"⚠ {name}: {r['baseline']:,.0f} -> {r['now']:,.0f} instructions/frame ({r['change']:+.1%})")
+            passed = False
+        else:
+            print(f"✓ No stage or layer above the baseline (+{args.tolerance:.0%})")
+
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=2)
+    print(f"Report: {args.output}")
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,236 @@
+"""
+Sparsity Report
+Post-ReLU sparsity of the engine's activation maps on real frames, and
+what the compressed activation format (AI_MODEL_FLAG_SPARSE) makes of it:
+per layer the share of zeros, compressed against plain bytes, the GEMM
+steps zero skipping drops and the M7 cycles with and without the format,
+then the arena and the host engine's time per frame in both formats
+
+The format is off by default (EngineModel.compressed() opts in); this is
+the measurement to run before turning it on for a model.
+"""
+
+import argparse
+import json
+import time
+
+import numpy as np
+
+from engine_model import (
+    CONV_OPS, GEMM_MR, INPUT_SCALE, INPUT_ZERO, M7_CLOCK_HZ, M7_COST, OP_CONV2D_3X3_POOL, OP_DENSE,
+    EngineModel, EngineQuantizer, gemm_cycles, gemm_cycles_live, gemm_depth, load_checkpoint,
+    pool_rows_size, random_layers, sparse_map_bytes, window_height
+)
+from model_pareto_explorer import load_frames, synthetic_frames
+from native_build import report_path
+from native_engine import NativeFireEngine
+from qemu_profile import OP_NAMES
+
+
+def load_images(args, shape):
+    """uint8 frames (N, H, W, C) at the model's input shape"""
+    import cv2
+
+    h, w, c = shape
+    if args.frames_npy:
+        return np.load(args.frames_npy).astype(np.uint8).reshape(-1, h, w, c)
+    images, _ = load_frames(args.dataset) if args.dataset else synthetic_frames(args.synthetic, args.seed)
+    frames = [cv2.resize(img, (w, h), interpolation=cv2.INTER_LINEAR) for img in images]
+    return np.stack(frames).reshape(-1, h, w, c)
+
+
+def live_steps(layer, x0):
+    """
+    Live 4-deep A steps of every GEMM panel a layer runs on its input x0
+    (zero point removed): (2-row panel counts, 1-row panel counts), per frame
+    """
+    depth = gemm_depth(layer["weights"].shape[1])
+    if layer["op"] == OP_DENSE:
+        flat = x0.reshape(len(x0), -1)
+        flat = np.pad(flat, ((0, 0), (0, depth - flat.shape[1]))) != 0
+        return [np.empty(0)] * len(x0), list(flat.reshape(len(x0), -1, 4).any(axis=2).sum(axis=1))
+
+    # Conv rows (a fused pool's full-resolution rows), MR pixels per panel along each row
+    n, h, w, c = x0.shape
+    padded = np.pad(x0, ((0, 0), (1, 1), (1, 1), (0, 0)))
+    cols = np.concatenate([padded[:, ky:ky + h, kx:kx + w, :] for ky in range(3) for kx in range(3)], axis=3)
+    if layer["op"] == OP_CONV2D_3X3_POOL:
+        cols = cols[:, :h // 2 * 2, :w // 2 * 2]
+    cols = np.pad(cols, ((0, 0), (0, 0), (0, 0), (0, depth - cols.shape[3]))) != 0
+    steps = cols.reshape(*cols.shape[:3], -1, 4).any(axis=4)
+    pairs = steps.shape[2] // GEMM_MR * GEMM_MR
+    live2 = (steps[:, :, 0:pairs:2] | steps[:, :, 1:pairs:2]).sum(axis=3).reshape(n, -1)
+    live1 = steps[:, :, pairs:].sum(axis=3).reshape(n, -1)
+    return list(live2), list(live1)
+
+
+def dense_gemm_cycles(layer):
+    """The GEMM part of layer_costs() for a full-frame layer"""
+    (oh, ow, n), k = layer["out_shape"], layer["weights"].shape[1]
+    if layer["op"] == OP_CONV2D_3X3_POOL:
+        return gemm_cycles(4 * ow, n, k) * oh
+    if layer["op"] in CONV_OPS:
+        return gemm_cycles(oh * ow, n, k)
+    return gemm_cycles(1, n, k)
+
+
+def analyze(model, frames):
+    """
+    Reference run of every layer on the frames, in the compressed model's
+    layout: per layer sparsity, bytes, live steps and M7 cycles
+    """
+    sparse = model.compressed()
+    flags = sparse.sparse_outputs()
+    costs = model.layer_costs()
+    x = frames.astype(np.float32) / 255.0
+    q = np.clip(np.rint(x / INPUT_SCALE) + INPUT_ZERO, -128, 127).astype(np.int64)
+
+    rows = []
+    in_bytes = np.full(len(q), int(np.prod(model.input_shape)))
+    for i, l in enumerate(model.layers):
+        in_sparse = i > 0 and flags[i - 1]
+        out = EngineModel.run_layers([l], q)
+        plain = int(np.prod(l["out_shape"]))
+        (_, iw, ic), (_, ow, oc) = l["in_shape"], l["out_shape"]
+        row = {"layer": i, "op": OP_NAMES.get(l["op"], str(l["op"])), "out_shape": list(l["out_shape"]),
+               "zeros": float((out == l["out_zero"]).mean()), "plain_bytes": plain,
+               "compressed": bool(flags[i]), "m7_dense": float(costs[i]["cycles"])}
+
+        # Bytes actually stored, and the layer's input + output + work rows
+        out_bytes = np.full(len(q), plain)
+        if flags[i]:
+            out_bytes = sparse_map_bytes(out, l["out_zero"])
+            row.update(stored_mean=float(out_bytes.mean()), stored_max=int(out_bytes.max()))
+        work = (window_height(l["op"]) * iw * ic if in_sparse else 0) + (ow * oc if flags[i] else 0)
+        row["pair_max"] = int((in_bytes + out_bytes).max()) + work + pool_rows_size(l, ow)
+
+        # Cycles in the compressed layout: decoding, zero skipping, encoding
+        m7 = row["m7_dense"]
+        if in_sparse:
+            m7 += np.prod(l["in_shape"]) * M7_COST["decode"]
+            if "weights" in l:
+                live2, live1 = live_steps(l, q - l["in_zero"])
+                n, k = l["weights"].shape
+                live = [gemm_cycles_live(a, b, n, k) for a, b in zip(live2, live1)]
+                m7 += float(np.mean(live)) - dense_gemm_cycles(l)
+                steps = gemm_depth(k) // 4
+                total = sum(a.size + b.size for a, b in zip(live2, live1)) * steps
+                row["live_steps"] = float(sum(a.sum() + b.sum() for a, b in zip(live2, live1)) / total)
+        if flags[i]:
+            m7 += plain * M7_COST["encode"]
+        row["m7_sparse"] = float(m7)
+        rows.append(row)
+
+        q, in_bytes = out, out_bytes
+    return rows
+
+
+def time_engine(engine, blob, shape, frames, repeats):
+    """Median seconds per frame of the host engine, and the fire margins"""
+    ctx = engine.create_context(blob, shape)
+    margins = []
+    for frame in frames:
+        engine.infer_image(ctx, frame)
+        margins.append(ctx.fire_margin)
+
+    times = []
+    for _ in range(repeats):
+        start = time.perf_counter()
+        for frame in frames:
+            engine.infer_image(ctx, frame)
+        times.append((time.perf_counter() - start) / len(frames))
+    return float(np.median(times)), np.array(margins, dtype=np.float32)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Activation sparsity and what the compressed format costs")
+    parser.add_argument("--checkpoint", help=".npz from save_checkpoint() (default: random weights)")
+    parser.add_argument("--dataset", help="Directory of fire_*.jpg / no_fire_*.jpg frames")
+    parser.add_argument("--frames-npy", help="Camera frames (N, H, W[, C] uint8) at the input shape")
+    parser.add_argument("--synthetic", type=int, default=64, help="Synthetic frames without a dataset")
+    parser.add_argument("--repeats", type=int, default=20, help="Timed passes over the frames (host)")
+    parser.add_argument("--output", default=report_path("sparsity_report.json"))
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    if args.checkpoint:
+        layers, config = load_checkpoint(args.checkpoint)
+        resolution = config.get("resolution", 32)
+        input_shape = (resolution, resolution, 1)
+    else:
+        input_shape = (32, 32, 1)
+        layers = random_layers(input_shape, seed=args.seed)
+    frames = load_images(args, input_shape)
+
+    # Calibrated on the same frames: zero points as the deployed model has them
+    calibration = frames[:32].astype(np.float32) / 255.0
+    model = EngineQuantizer().quantize(layers, input_shape, calibration)
+    sparse = model.compressed()
+    rows = analyze(model, frames)
+
+    engine = NativeFireEngine()
+    t_dense, m_dense = time_engine(engine, model.to_bytes(), input_shape, frames, args.repeats)
+    t_sparse, m_sparse = time_engine(engine, sparse.to_bytes(), input_shape, frames, args.repeats)
+    mismatches = int((m_dense.view(np.uint32) != m_sparse.view(np.uint32)).sum())
+
+    print("=" * 60)
+    print("ACTIVATION SPARSITY REPORT")
+    print("=" * 60)
+    h, w, c = input_shape
+    print(f"Model: {len(model.layers)} layers, {w}x{h}x{c} input | {len(frames)} frames")
+    print()
+    print(f"{'layer':<10} {'shape':>10} {'zeros':>6} {'plain':>6} {'stored':>13} {'live':>5} "
+          f"{'M7 kcyc':>8} {'sparse':>8}")
+    for r in rows:
+        oh, ow, oc = r["out_shape"]
+        stored = f"{r['stored_mean']:.0f} / {r['stored_max']}" if r["compressed"] else "-"
+        live = f"{r['live_steps']:.0%}" if "live_steps" in r else "-"
+        print(f"{r['op'] + str(r['layer']):<10} {f'{ow}x{oh}x{oc}':>10} {r['zeros']:>6.0%} "
+              f"{r['plain_bytes']:>6} {stored:>13} {live:>5} {r['m7_dense'] / 1e3:>8.1f} "
+              f"{r['m7_sparse'] / 1e3:>8.1f}")
+
+    m7_dense = model.m7_cycles()
+    m7_sparse = m7_dense + sum(r["m7_sparse"] - r["m7_dense"] for r in rows)
+    compressed = [r for r in rows if r["compressed"]]
+    plain_total = sum(r["plain_bytes"] for r in compressed)
+    stored_total = sum(r["stored_mean"] for r in compressed)
+    measured = max(r["pair_max"] for r in rows[model.patch_layers:])
+    arena_dense = model.scratch_size + model.arena_size
+    arena_sparse = sparse.scratch_size + sparse.arena_size
+    worse = arena_sparse >= arena_dense and m7_sparse >= m7_dense and t_sparse >= t_dense
+
+    print()
+    print(f"Compressed maps: {len(compressed)} | {stored_total:.0f} of {plain_total} bytes written per frame "
+          f"({stored_total / max(plain_total, 1) - 1:+.0%})")
+    print(f"M7 estimate: {m7_dense / M7_CLOCK_HZ * 1e3:.2f} ms plain, {m7_sparse / M7_CLOCK_HZ * 1e3:.2f} ms "
+          f"compressed ({m7_sparse / m7_dense - 1:+.1%})")
+    print(f"Host engine: {t_dense * 1e6:.0f} us plain, {t_sparse * 1e6:.0f} us compressed per frame "
+          f"({t_sparse / t_dense - 1:+.1%})")
+    print(f"Arena (static): {arena_dense} bytes plain, {arena_sparse} compressed "
+          f"({arena_sparse - arena_dense:+d})")
+    print(f"Largest layer working set measured: {measured} bytes (activations; static reservation "
+          f"{sparse.arena_size})")
+    if worse:
+        print("⚠ Compressed format uses more RAM and time on every count here: keep it off")
+    if mismatches:
+        print(f"⚠ {mismatches} frames differ between the formats")
+    else:
+        print("✓ Both formats give identical outputs")
+
+    report = {
+        "frames": len(frames), "input_shape": list(input_shape), "layers": rows,
+        "m7_cycles": {"plain": m7_dense, "compressed": m7_sparse},
+        "host_seconds": {"plain": t_dense, "compressed": t_sparse},
+        "arena": {"plain": arena_dense, "compressed": arena_sparse, "measured_activations": measured},
+        "bytes_per_frame": {"plain": plain_total, "compressed": stored_total},
+        "mismatches": mismatches,
+        "compressed_worse": worse,
+    }
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=2)
+    print(f"\nReport: {args.output}")
+    return 1 if mismatches else 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -37,6 +37,19 @@ class STM32Simulator:
         if img is None:
             raise ValueError(f"Cannot load image: {image_path}")
         
+        return self.preprocess_array(img, target_size)
+    
+    def preprocess_jpeg_bytes(self, jpeg_bytes, target_size=(32, 32)):
+        """Preprocess an in-memory JPEG (e.g. one MJPEG frame) with a full decode"""
+        buf = np.frombuffer(jpeg_bytes, dtype=np.uint8)
+        img = cv2.imdecode(buf, cv2.IMREAD_GRAYSCALE)
+        if img is None:
+            raise ValueError("Cannot decode JPEG frame")
+        
+        return self.preprocess_array(img, target_size)
+    
+    def preprocess_array(self, img, target_size=(32, 32)):
+        """Resize and normalize a decoded grayscale image"""
         # Resize to target
         img = cv2.resize(img, target_size)
         
@@ -8,6 +8,9 @@ import numpy as np
 from pathlib import Path
 import json
 
+from engine_model import TASK_NAMES, EngineQuantizer, layers_from_keras, write_model_source
+from graph_optimizer import heads_from_keras, optimize_heads, preprocessing_node, print_report
+
 
 class ModelConverter:
     """Convert models to TFLite optimized for STM32"""
@@ -62,38 +65,86 @@ class ModelConverter:
         
         return output_path
     
-    def model_to_cpp_array(self, tflite_path):
+    def model_to_cpp_array(self, tflite_path, input_shape=(32, 32, 1),
+                           confidence_threshold=0.7):
         """
-        Convert TFLite model to C++ byte array
+        Convert TFLite model to C byte array
         Allows embedding model directly in STM32 firmware
+        
+        Writes model_data.c (definitions only); the template's
+        model_data.h declares them, so the header can be included
+        from any number of source files.
+        
+        The blob is padded to MODEL_BLOCK_SIZE and also saved as
+        model_data.bin, the base/target image for delta updates
+        (model_delta_update.py diff old.bin new.bin).
         """
-        print(f"Converting {tflite_path} to C++ array...")
+        print(f"Converting {tflite_path} to C array...")
         
         with open(tflite_path, 'rb') as f:
             model_data = f.read()
         
-        # Create C++ header file
-        cpp_filename = self.output_dir / f"{Path(tflite_path).stem}_model.h"
+        c_filename = write_model_source(
+            model_data, self.output_dir / "model_data.c", Path(tflite_path).stem,
+            input_shape, confidence_threshold, source=Path(tflite_path).name
+        )
         
-        with open(cpp_filename, 'w') as f:
-            f.write("// Auto-generated TFLite model array\n")
-            f.write(f"// Size: {len(model_data)} bytes\n\n")
-            f.write("#ifndef MODEL_DATA_H\n")
-            f.write("#define MODEL_DATA_H\n\n")
-            f.write("const unsigned char model_data[] = {\n")
-            
-            # Write bytes in rows of 16
-            for i in range(0, len(model_data), 16):
-                chunk = model_data[i:i+16]
-                hex_str = ', '.join(f"0x{b:02x}" for b in chunk)
-                f.write(f"    {hex_str},\n")
-            
-            f.write("};\n")
-            f.write(f"const unsigned int model_data_len = {len(model_data)};\n\n")
-            f.write("#endif // MODEL_DATA_H\n")
+        print(f"✓ C source saved: {c_filename}")
+        print(f"✓ Update image saved: {self.output_dir / 'model_data.bin'}")
+        return c_filename
+    
+    def model_to_engine_array(self, calibration_images, input_shape=(32, 32, 1),
+                              confidence_threshold=0.7, per_channel=True, optimize=True,
+                              model_info=None):
+        """
+        Export the Keras model for the firmware's int8 engine (ai_engine.c)
         
-        print(f"✓ C++ header saved: {cpp_filename}")
-        return cpp_filename
+        Instead of a TFLite flatbuffer for TFLite Micro, writes an FDM1
+        image: int8 weights, per-layer requantization and a precomputed
+        activation arena size. Supports the layers create_model() uses;
+        multi-task models (create_multitask_model()) export their heads.
+        
+        Args:
+            calibration_images: Float inputs in 0-1, shape (N, H, W, C),
+                                used to calibrate activation ranges
+            optimize: Run the graph optimizer first (graph_optimizer.py):
+                      batch-norm and identity ops folded away, conv + pool
+                      fused; otherwise only the plain engine layer set loads
+            model_info: model_info.json whose input normalization is folded
+                        into the first layer (the firmware feeds 0-1 input)
+        """
+        print(f"Exporting {self.model_path} for the int8 engine...")
+        
+        model = tf.keras.models.load_model(self.model_path)
+        backbone, heads = heads_from_keras(model)
+        if optimize:
+            preprocessing = preprocessing_node(model_info, input_shape[2]) if model_info else None
+            layers, heads, reports = optimize_heads(backbone, heads, input_shape, preprocessing)
+            for part, report in reports.items():
+                if heads:
+                    print(f"{part.capitalize()}:")
+                print_report(report)
+        elif heads:
+            raise ValueError("Multi-task models need the graph optimizer (optimize=True)")
+        else:
+            layers = layers_from_keras(model)
+        engine_model = EngineQuantizer(per_channel).quantize(
+            layers, input_shape, np.asarray(calibration_images), heads
+        )
+        blob = engine_model.to_bytes()
+        
+        c_filename = write_model_source(
+            blob, self.output_dir / "model_data.c", Path(self.model_path).stem,
+            input_shape, confidence_threshold, source=Path(self.model_path).name,
+            kind="engine model (FDM1)"
+        )
+        
+        print(f"✓ C source saved: {c_filename}")
+        print(f"  Size: {len(blob) / 1024:.1f} KB | Arena: {(engine_model.scratch_size + engine_model.arena_size) / 1024:.1f} KB | "
+              f"M7 estimate: {engine_model.m7_latency_ms():.1f} ms")
+        for head, count in zip(engine_model.heads, engine_model.head_counts()):
+            print(f"  Head {TASK_NAMES[head['task']]}: {count} outputs")
+        return c_filename
     
     def generate_model_info(self, tflite_path):
         """Generate model information JSON"""
@@ -172,6 +223,49 @@ class FireDetectionModelBuilder:
         
         return model
     
+    @staticmethod
+    def create_multitask_model(input_shape=(32, 32, 1), output_path="fire_multitask_model.h5"):
+        """
+        Fire, smoke and fire-location heads on one shared backbone
+        The engine runs the backbone once per frame and any subset of
+        heads (fire_detection_set_tasks()). Head layers are named after
+        their task, which is how the converter splits them.
+        """
+        print("Creating multi-task fire detection model...")
+        
+        inputs = tf.keras.layers.Input(shape=input_shape)
+        
+        # Shared backbone: 32x32 -> 4x4x64
+        x = inputs
+        for filters in (16, 32, 64):
+            x = tf.keras.layers.Conv2D(filters, 3, activation='relu', padding='same')(x)
+            x = tf.keras.layers.MaxPooling2D(2)(x)
+        
+        # Fire / smoke: [no, yes] classifiers
+        fire = tf.keras.layers.GlobalAveragePooling2D(name="fire_gap")(x)
+        fire = tf.keras.layers.Dense(32, activation='relu', name="fire_dense")(fire)
+        fire = tf.keras.layers.Dense(2, activation='softmax', name="fire_output")(fire)
+        smoke = tf.keras.layers.GlobalAveragePooling2D(name="smoke_gap")(x)
+        smoke = tf.keras.layers.Dense(2, activation='softmax', name="smoke_output")(smoke)
+        
+        # Location: one logit per cell of the 4x4 feature grid
+        location = tf.keras.layers.Conv2D(1, 3, padding='same', name="location_conv")(x)
+        location = tf.keras.layers.Flatten(name="location_flatten")(location)
+        location = tf.keras.layers.Softmax(name="location_output")(location)
+        
+        model = tf.keras.Model(inputs, [fire, smoke, location])
+        model.compile(
+            optimizer='adam',
+            loss='categorical_crossentropy',
+            metrics=['accuracy']
+        )
+        
+        model.summary()
+        model.save(output_path)
+        print(f"✓ Model saved: {output_path}")
+        
+        return model
+    
     @staticmethod
     def estimate_memory_usage(input_shape=(32, 32, 1)):
         """
@@ -223,9 +317,9 @@ def main():
     tflite_path = converter.convert_keras_to_tflite(quantize=True)
     
     # Step 3: Convert to C++ array
-    print("\n\nStep 3: Generate C++ Code")
+    print("\n\nStep 3: Generate C Code")
     print("-" * 40)
-    cpp_header = converter.model_to_cpp_array(tflite_path)
+    c_source = converter.model_to_cpp_array(tflite_path)
     
     # Step 4: Generate info
     print("\n\nStep 4: Generate Model Info")
@@ -236,7 +330,7 @@ def main():
     print("✓ All conversions complete!")
     print("=" * 60)
     print("\nNext steps:")
-    print("1. Copy model_data.h to STM32 project")
+    print("1. Copy model_data.c to STM32 project (Core/Src)")
     print("2. Include stm32_ai_framework.h in main.c")
     print("3. Call fire_detection_init() in setup")
     print("4. Run inference in main loop")
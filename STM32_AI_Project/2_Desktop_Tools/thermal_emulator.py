@@ -0,0 +1,299 @@
+"""
+Thermal Array Emulator
+Synthetic or recorded 32x24 thermal frames (MLX90640-style RAM layout) for
+the firmware's thermal front-end (thermal_sensor.c): converts every frame
+with the host build of the fixed-point path and checks it against the
+vendor float formula, pixel by pixel
+"""
+
+import argparse
+import ctypes
+import json
+import time
+from pathlib import Path
+
+import numpy as np
+
+from native_build import load_library, report_path
+
+
+# thermal_sensor.h
+WIDTH, HEIGHT = 32, 24
+PIXELS = WIDTH * HEIGHT
+FRAME_WORDS = 832
+AUX_TA = PIXELS + 0x20          # Ta, 1/64 C
+AUX_VDD = PIXELS + 0x2A         # Vdd, mV
+LUT_SIZE = 1 << 10
+HOT_DC = 600
+KELVIN = 273.15
+
+TOLERANCE_C = 0.3               # Fixed point vs float reference, -20..500 C
+
+
+class ThermalCalibration(ctypes.Structure):
+    """Mirror of ThermalCalibration (thermal_sensor.h)"""
+    _fields_ = [
+        ("gain", ctypes.c_float),
+        ("emissivity", ctypes.c_float),
+        ("ta_ref", ctypes.c_float),
+        ("vdd_ref", ctypes.c_float),
+        ("offset", ctypes.c_int16 * PIXELS),
+        ("alpha", ctypes.c_float * PIXELS),
+        ("kta", ctypes.c_float * PIXELS),
+        ("kv", ctypes.c_float * PIXELS),
+    ]
+
+
+class ThermalHotspots(ctypes.Structure):
+    """Mirror of ThermalHotspots (thermal_sensor.h)"""
+    _fields_ = [
+        ("max_dc", ctypes.c_int16),
+        ("ambient_dc", ctypes.c_int16),
+        ("max_x", ctypes.c_uint8),
+        ("max_y", ctypes.c_uint8),
+        ("hot_pixels", ctypes.c_uint16),
+        ("hot_map", ctypes.c_uint8 * (PIXELS // 8)),
+        ("frame", ctypes.c_uint32),
+    ]
+
+
+def _sensor_fields():
+    """ThermalSensor fields, with the padding C inserts for the 32-byte aligned raw buffers"""
+    head = [
+        ("read_dma", ctypes.c_void_p),
+        ("user", ctypes.c_void_p),
+        ("cal", ctypes.c_void_p),
+        ("scale", ctypes.c_int32 * PIXELS),
+        ("bias", ctypes.c_int32 * PIXELS),
+        ("lut", ctypes.c_int16 * (LUT_SIZE + 1)),
+        ("coeff_ta", ctypes.c_float),
+        ("coeff_vdd", ctypes.c_float),
+    ]
+    tail = [
+        ("raw", ctypes.c_uint8 * (2 * FRAME_WORDS * 2)),
+        ("dma_buffer", ctypes.c_uint8),
+        ("busy", ctypes.c_uint8),
+        ("ready_buffer", ctypes.c_uint8),
+        ("completed", ctypes.c_uint32),
+        ("processed", ctypes.c_uint32),
+        ("temps", ctypes.c_int16 * PIXELS),
+        ("spots", ThermalHotspots),
+        ("hot_threshold_dc", ctypes.c_int16),
+        ("frames", ctypes.c_uint32),
+        ("recalibrations", ctypes.c_uint32),
+        ("overruns", ctypes.c_uint32),
+    ]
+    partial = type("Head", (ctypes.Structure,), {"_fields_": head})
+    end = partial.coeff_vdd.offset + ctypes.sizeof(ctypes.c_float)
+    fields = head + [("_align", ctypes.c_uint8 * (-end % 32))] + tail
+
+    whole = type("Whole", (ctypes.Structure,), {"_fields_": fields})
+    return fields + [("_tail", ctypes.c_uint8 * (-ctypes.sizeof(whole) % 32))]
+
+
+class ThermalSensor(ctypes.Structure):
+    """Mirror of ThermalSensor (thermal_sensor.h)"""
+    _fields_ = _sensor_fields()
+
+
+# ==================== SENSOR MODEL ====================
+
+def synthetic_calibration(seed=0):
+    """Calibration with realistic pixel-to-pixel spread (dict of arrays)"""
+    rng = np.random.default_rng(seed)
+    return {
+        "gain": np.float32(1.02),
+        "emissivity": np.float32(0.95),
+        "ta_ref": np.float32(25.0),
+        "vdd_ref": np.float32(3.3),
+        "offset": rng.normal(-40, 25, PIXELS).round().astype(np.int16),
+        "alpha": (1.0e-7 * rng.normal(1.0, 0.05, PIXELS)).astype(np.float32),
+        "kta": rng.normal(0.004, 0.001, PIXELS).astype(np.float32),
+        "kv": rng.normal(0.3, 0.05, PIXELS).astype(np.float32),
+    }
+
+
+def to_ctypes(calibration):
+    cal = ThermalCalibration()
+    for name in ("gain", "emissivity", "ta_ref", "vdd_ref"):
+        setattr(cal, name, float(calibration[name]))
+    for name in ("offset", "alpha", "kta", "kv"):
+        ctypes.memmove(getattr(cal, name), np.ascontiguousarray(calibration[name]).ctypes.data,
+                       ctypes.sizeof(getattr(cal, name)))
+    return cal
+
+
+def frame_words(frame):
+    """Signed 16-bit words of one raw frame (bytes are big-endian on the bus)"""
+    return np.frombuffer(bytes(frame), dtype=">i2").astype(np.int64)
+
+
+def reference_temperatures(calibration, frame):
+    """Vendor formula in double precision, C per pixel"""
+    c = {k: np.asarray(v, dtype=np.float64) for k, v in calibration.items()}
+    words = frame_words(frame)
+    ta = words[AUX_TA] / 64.0
+    vdd = (words[AUX_VDD] & 0xFFFF) / 1000.0
+
+    offset = c["offset"] * (1 + c["kta"] * (ta - c["ta_ref"])) * (1 + c["kv"] * (vdd - c["vdd_ref"]))
+    v_ir = (words[:PIXELS] * c["gain"] - offset) / c["emissivity"]
+    radiance = np.maximum(v_ir / c["alpha"] + (ta + KELVIN) ** 4, 0.0)
+    return radiance ** 0.25 - KELVIN
+
+
+def encode_frame(calibration, temps_c, ta, vdd, rng, noise=1.0):
+    """Raw frame a sensor with this calibration reads for a scene (inverse of the vendor formula)"""
+    c = {k: np.asarray(v, dtype=np.float64) for k, v in calibration.items()}
+    v_ir = c["emissivity"] * c["alpha"] * ((temps_c.ravel() + KELVIN) ** 4 - (ta + KELVIN) ** 4)
+    offset = c["offset"] * (1 + c["kta"] * (ta - c["ta_ref"])) * (1 + c["kv"] * (vdd - c["vdd_ref"]))
+    counts = (v_ir + offset) / c["gain"] + rng.normal(0, noise, PIXELS)
+
+    words = np.zeros(FRAME_WORDS, dtype=np.int64)
+    words[:PIXELS] = np.clip(np.round(counts), -32768, 32767)
+    words[AUX_TA] = round(ta * 64)
+    words[AUX_VDD] = round(vdd * 1000)
+    return (words & 0xFFFF).astype(">u2").tobytes()
+
+
+def synthetic_scene(index, frames, rng):
+    """Room with a warm body; a fire ignites halfway and grows (C per pixel, ambient C)"""
+    y, x = np.mgrid[0:HEIGHT, 0:WIDTH]
+    room = 21.0 + 2.0 * y / HEIGHT + rng.normal(0, 0.2, (HEIGHT, WIDTH))
+    scene = room.copy()
+
+    # Person-sized warm blob drifting across the frame
+    px = 4 + (index * 23 // max(frames, 1)) % 24
+    scene = np.maximum(scene, np.where((x - px) ** 2 / 4 + (y - 14) ** 2 / 25 < 1, 34.0, 0))
+
+    growth = (index - frames // 2) / max(frames // 2, 1)
+    if growth >= 0:
+        radius = 1.0 + 3.0 * growth
+        dist = np.hypot(x - 22, y - 16)
+        flame = (80.0 + 380.0 * growth) * np.exp(-(dist / radius) ** 2)
+        scene = np.maximum(scene, room + flame)
+
+    ambient = 24.0 + 1.5 * index / max(frames, 1)   # Sensor warms up
+    return scene, ambient
+
+
+def load_frames(path):
+    """
+    Recorded frames: .npy of raw frames ((N, 1664) bytes or (N, 832) words),
+    or an .npz from --save with "frames" and optionally the calibration
+    """
+    data = np.load(path)
+    if isinstance(data, np.ndarray):
+        frames, calibration = data, None
+    else:
+        frames = data["frames"]
+        calibration = {k: data[k] for k in data.files if k != "frames"} or None
+    if frames.ndim == 2 and frames.shape[1] == FRAME_WORDS:
+        frames = (frames.astype(np.int64) & 0xFFFF).astype(">u2").view(np.uint8).reshape(len(frames), -1)
+    return [bytes(f) for f in frames.astype(np.uint8)], calibration
+
+
+# ==================== FIRMWARE PATH ====================
+
+class NativeThermal:
+    """Host build of thermal_sensor.c"""
+
+    def __init__(self, calibration):
+        self.lib = load_library("fire_thermal", ["thermal_sensor.c"])
+        sensor_p = ctypes.POINTER(ThermalSensor)
+        self.lib.thermal_init.argtypes = [sensor_p, ctypes.POINTER(ThermalCalibration), ctypes.c_void_p]
+        self.lib.thermal_init.restype = ctypes.c_int32
+        self.lib.thermal_convert_frame.argtypes = [sensor_p, ctypes.c_char_p]
+        self.lib.thermal_convert_frame.restype = None
+
+        self.cal = to_ctypes(calibration)  # Referenced by the sensor: keep alive
+        self.sensor = ThermalSensor()
+        status = self.lib.thermal_init(ctypes.byref(self.sensor), ctypes.byref(self.cal), None)
+        if status != 0:
+            raise RuntimeError(f"thermal_init failed ({status}): coefficients out of fixed-point range")
+
+    def convert(self, frame):
+        """Temperatures (C) of one raw frame, plus the hot-spot summary"""
+        self.lib.thermal_convert_frame(ctypes.byref(self.sensor), frame)
+        temps = np.frombuffer(self.sensor.temps, dtype=np.int16).astype(np.float64) / 10.0
+        return temps, self.sensor.spots
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Thermal array emulator")
+    parser.add_argument("--input", help="Recorded frames (.npy / .npz, see load_frames)")
+    parser.add_argument("--frames", type=int, default=32, help="Synthetic frames")
+    parser.add_argument("--noise", type=float, default=1.0, help="Synthetic read noise, counts")
+    parser.add_argument("--save", help="Write the frames + calibration to this .npz")
+    parser.add_argument("--output", default=report_path("thermal_report.json"))
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    calibration = None
+    if args.input:
+        frames, calibration = load_frames(args.input)
+        source = args.input
+    if calibration is None:
+        calibration = synthetic_calibration(args.seed)
+    if not args.input:
+        rng = np.random.default_rng(args.seed)
+        frames = []
+        for i in range(args.frames):
+            scene, ambient = synthetic_scene(i, args.frames, rng)
+            frames.append(encode_frame(calibration, scene, ambient, 3.3 + rng.normal(0, 0.005), rng,
+                                       args.noise))
+        source = f"synthetic ({args.frames} frames)"
+
+    if args.save:
+        np.savez(args.save, frames=np.frombuffer(b"".join(frames), np.uint8).reshape(len(frames), -1),
+                 **calibration)
+
+    native = NativeThermal(calibration)
+
+    print("=" * 60)
+    print("THERMAL ARRAY EMULATOR")
+    print("=" * 60)
+    print(f"Frames: {source} | {WIDTH}x{HEIGHT} | hot threshold {HOT_DC / 10:.0f}C")
+    print()
+    print(f"{'frame':>5} {'Ta C':>6} {'max C':>7} {'at':>7} {'hot px':>6} {'ref max':>7} {'max err':>7}")
+
+    rows, errors, elapsed = [], [], 0.0
+    for i, frame in enumerate(frames):
+        start = time.perf_counter()
+        temps, spots = native.convert(frame)
+        elapsed += time.perf_counter() - start
+
+        reference = reference_temperatures(calibration, frame)
+        in_range = (reference > -20) & (reference < 500)
+        error = float(np.abs(temps - reference)[in_range].max()) if in_range.any() else 0.0
+        errors.append(error)
+        rows.append({
+            "frame": i, "ambient_c": spots.ambient_dc / 10, "max_c": spots.max_dc / 10,
+            "max_xy": [spots.max_x, spots.max_y], "hot_pixels": spots.hot_pixels,
+            "reference_max_c": float(reference.max()), "max_error_c": error,
+        })
+        print(f"{i:>5} {spots.ambient_dc / 10:>6.1f} {spots.max_dc / 10:>7.1f} "
+              f"{f'({spots.max_x},{spots.max_y})':>7} {spots.hot_pixels:>6} {reference.max():>7.1f} "
+              f"{error:>7.3f}")
+
+    worst = max(errors) if errors else 0.0
+    print()
+    print(f"Coefficient rebuilds: {native.sensor.recalibrations} (Ta / Vdd drift) | "
+          f"host {elapsed / max(len(frames), 1) * 1e6:.1f} us/frame")
+    mark = "✓" if worst <= TOLERANCE_C else "⚠"
+    print(f"{mark} Fixed point vs vendor formula: max error {worst:.3f}C (tolerance {TOLERANCE_C}C)")
+
+    report = {
+        "source": source,
+        "frames": rows,
+        "recalibrations": native.sensor.recalibrations,
+        "max_error_c": worst,
+        "tolerance_c": TOLERANCE_C,
+        "host_us_per_frame": elapsed / max(len(frames), 1) * 1e6,
+    }
+    Path(args.output).write_text(json.dumps(report, indent=2))
+    print(f"Report: {args.output}")
+    return 0 if worst <= TOLERANCE_C else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,138 @@
+"""
+Thread Scaling Benchmark
+Single-stream latency of the host engine against the number of intra-op
+threads (Host/ai_thread_pool.c): one context, one frame at a time, its
+large conv and dense layers split over the pool. Per input resolution:
+median and p90 latency, speedup and parallel efficiency per thread count,
+pool jobs per frame, and a bit-exactness check against one thread.
+"""
+
+import argparse
+import json
+import os
+import time
+
+import numpy as np
+
+from engine_model import EngineQuantizer, random_layers
+from graph_optimizer import fuse_pools
+from native_build import report_path
+from native_engine import NativeFireEngine
+from patch_memory_planner import ARENA_BUDGET, BASE_FILTERS, plan_row, split_points
+
+
+def build_model(resolution, width, head_units, seed):
+    """
+    create_model()-style model at resolution, conv + pool pairs fused as the
+    converter emits them, with the fastest patch plan that fits the arena
+    """
+    shape = (resolution, resolution, 1)
+    filters = tuple(max(4, int(round(f * width))) for f in BASE_FILTERS)
+    layers, _ = fuse_pools(random_layers(shape, filters, head_units, seed))
+    calibration = np.random.default_rng(seed).random((32, *shape)).astype(np.float32)
+    model = EngineQuantizer().quantize(layers, shape, calibration)
+
+    rows = [plan_row(model, 0, 0)]
+    for points in split_points(model):
+        oh, ow, _ = model.layers[points - 1]["out_shape"]
+        rows += [plan_row(model, points, g) for g in range(2, min(8, oh, ow) + 1)]
+    fitting = [r for r in rows if r["ram"] <= ARENA_BUDGET]
+    if not fitting:
+        return None
+    return min(fitting, key=lambda r: (r["m7_latency_ms"], r["ram"]))["_model"]
+
+
+def measure(engine, ctx, frames, repeats):
+    """Per-frame latencies (s) over repeats passes, and the last pass's P(fire)"""
+    latencies, outputs = [], []
+    for _ in range(repeats):
+        outputs = []
+        for frame in frames:
+            start = time.perf_counter()
+            outputs.append(engine.infer_image(ctx, frame))
+            latencies.append(time.perf_counter() - start)
+    return np.array(latencies), np.array(outputs, dtype=np.float32)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Intra-op thread scaling of the host engine")
+    parser.add_argument("--resolutions", type=int, nargs="+", default=[32, 64, 96, 128])
+    parser.add_argument("--threads", type=int, nargs="+",
+                        help="Thread counts (default: powers of two up to the CPU count, and the CPU count)")
+    parser.add_argument("--min-macs", type=int, default=0,
+                        help="Least MACs per task before a layer is split (0 = AI_THREAD_POOL_MIN_MACS)")
+    parser.add_argument("--width", type=float, default=1.0, help="Filter width multiplier")
+    parser.add_argument("--head-units", type=int, default=0, help="Dense head units (0 = GAP head)")
+    parser.add_argument("--frames", type=int, default=16)
+    parser.add_argument("--repeats", type=int, default=10)
+    parser.add_argument("--output", default=report_path("thread_scaling.json"))
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    engine = NativeFireEngine()
+    cpus = os.cpu_count() or 1
+    threads = args.threads or [1 << i for i in range(cpus.bit_length()) if 1 << i <= cpus] + [cpus]
+    threads = sorted(set(threads) | {1})
+    rng = np.random.default_rng(args.seed)
+
+    print("=" * 60)
+    print("THREAD SCALING BENCHMARK")
+    print("=" * 60)
+    print(f"Host: {cpus} CPUs | threads {threads} | {args.frames} frames x {args.repeats}")
+    if threads[-1] > cpus:
+        print("⚠ More threads than CPUs: workers and the caller take turns, expect slowdowns")
+    print()
+    print(f"{'input':>7} {'MACs':>8} {'threads':>7} {'p50 ms':>8} {'p90 ms':>8} {'speedup':>7} "
+          f"{'eff':>5} {'jobs':>5}")
+
+    report, mismatches = [], 0
+    for resolution in args.resolutions:
+        model = build_model(resolution, args.width, args.head_units, args.seed)
+        if model is None:
+            print(f"{resolution:>4}x{resolution:<2} no plan fits the arena")
+            continue
+        shape = model.input_shape
+        blob = model.to_bytes()
+        frames = rng.integers(0, 256, (args.frames, *shape)).astype(np.uint8)
+        macs = sum(c["macs"] for c in model.layer_costs())
+
+        entry = {"resolution": resolution, "patch_layers": model.patch_layers, "macs": macs, "runs": []}
+        baseline, reference = None, None
+        for n in threads:
+            ctx = engine.create_context(blob, shape)
+            pool = engine.create_pool(ctx, n, args.min_macs) if n > 1 else None
+            measure(engine, ctx, frames[:2], 1)  # Warm-up: caches, workers spinning
+            jobs_before = engine.pool_stats(pool)[0] if pool else 0
+            latencies, outputs = measure(engine, ctx, frames, args.repeats)
+            jobs = (engine.pool_stats(pool)[0] - jobs_before) / latencies.size if pool else 0
+            if pool:
+                engine.destroy_pool(ctx, pool)
+
+            p50, p90 = np.percentile(latencies, [50, 90])
+            if n == 1:
+                baseline, reference = p50, outputs
+            differ = int((outputs.view(np.uint32) != reference.view(np.uint32)).sum())
+            mismatches += differ
+            speedup = baseline / p50
+            entry["runs"].append({"threads": n, "p50_ms": p50 * 1e3, "p90_ms": p90 * 1e3, "speedup": speedup,
+                                  "efficiency": speedup / n, "jobs_per_frame": jobs, "mismatches": differ})
+            size = f"{resolution}x{resolution}" if n == threads[0] else ""
+            work = f"{macs / 1e6:.1f}M" if n == threads[0] else ""
+            print(f"{size:>7} {work:>8} {n:>7} {p50 * 1e3:>8.3f} {p90 * 1e3:>8.3f} {speedup:>6.2f}x "
+                  f"{speedup / n:>5.0%} {jobs:>5.1f}{'  ⚠ outputs differ' if differ else ''}")
+        report.append(entry)
+
+    print()
+    if mismatches:
+        print(f"⚠ {mismatches} outputs differ from the single-thread run")
+    else:
+        print("✓ Every thread count gives the single-thread outputs")
+
+    with open(args.output, "w") as f:
+        json.dump({"cpus": cpus, "min_macs": args.min_macs, "resolutions": report}, f, indent=2)
+    print(f"Report: {args.output}")
+    return 1 if mismatches else 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,325 @@
+/*
+ * Int8 Inference Engine
+ * Reference interpreter for the converter's engine model format
+ *
+ * Model format "FDM1" (little-endian), produced by engine_model.py:
+ *   Header (40 bytes, AiModelHeader) | layer table (32 bytes per AiLayer)
+ *   Tensors, each starting on a MODEL_BLOCK_SIZE boundary:
+ *     weights  int8   conv (and conv + pool): [out_c][3][3][in_c], dense: [out][in],
+ *                     temporal: [out_c][taps][in_c], oldest frame first
+ *                     (AI_MODEL_FLAG_PACKED_B: GEMM panels, see ai_gemm.h)
+ *     bias     int32  [out_c]
+ *     quant    int32  multiplier[out_c], then int32 shift[out_c]
+ *     lut      int8   [256] (AI_ACT_LUT only)
+ *     head     float output_scale, int32 output_zero (AI_OP_HEAD only)
+ *
+ * Activations are int8 NHWC with per-tensor scale/zero point; weights are
+ * symmetric int8 (per output channel or per tensor). Requantization:
+ *   out = zero + round(acc * multiplier * 2^(shift - 31))
+ *
+ * AI_ACT_LUT layers end in a converter-generated table instead: the
+ * requantized value (layer output_zero is the table's index zero point)
+ * selects lut[value + 128], which already carries the nonlinearity
+ * (sigmoid, tanh, hard-swish, exp...) and the output quantization the
+ * next layer's input_zero describes. One load per element, no float math.
+ *
+ * AI_OP_CONV2D_3X3_POOL is a 3x3 conv (activation included) followed by a
+ * 2x2 max pool, as the converter's graph optimizer fuses them: the conv
+ * runs two output rows at a time into a small row buffer that is pooled
+ * straight into the output, so the full-resolution conv output is never
+ * stored. The layer's shapes are the conv input and the pooled output.
+ *
+ * Conv and dense layers run on the int8 GEMM core (ai_gemm.c). The arena
+ * starts with the GEMM's A-panel scratch; after it, activations ping-pong
+ * between the two ends of the remaining space: a layer reads from one end
+ * and writes to the other, so that part only needs the largest input +
+ * output pair (AiModelHeader.arena_size).
+ *
+ * Patch-based execution (AI_MODEL_FLAG_PATCHED) keeps large inputs within
+ * the same arena: the first patch_layers layers (3x3 conv, 2x2 max pool and
+ * the fused pair only) run once per tile of a patch_grid x patch_grid split of their
+ * output. Each tile's input window is traced back through the stage, with
+ * a 1-pixel halo per conv wherever it borders more of the image; halos are
+ * recomputed by neighbouring tiles rather than cached. Tile results are
+ * assembled into the stage's output map at the low end of the activation
+ * area and the remaining layers run on it as usual, with results identical
+ * to full-frame execution. arena_size then covers the map plus the largest
+ * tile's ping-pong, as well as every later layer's pair.
+ *
+ * Multi-task models (AI_MODEL_FLAG_HEADS) share one backbone between
+ * several heads (fire, smoke, location grid). The layer table holds the
+ * backbone, then per head an AI_OP_HEAD record followed by the head's
+ * layers; a head record carries the task (in its activation field), the
+ * backbone output shape as both its input and output, and its quant
+ * tensor holds the head's output scale / zero point. The backbone output
+ * stays at the low end of the activations while each requested head runs
+ * on a copy of it in the space above, so heads can be skipped per frame
+ * (ai_engine_run_heads()); arena_size covers the backbone output plus
+ * every head layer's pair. Outputs are the heads' values in table order.
+ *
+ * AI_OP_TEMPORAL_CONV is a stateful causal 1-D conv over a per-frame
+ * 1 x 1 x in_c embedding: in_h holds its taps (frames of history, current
+ * one included) and in_w is 1. Its window of the last in_h embeddings
+ * lives in the state area right after the activations (arena_size) and
+ * persists between runs, so each frame costs one shift plus one dense
+ * GEMM over taps x in_c instead of re-running the CNN over a frame stack.
+ * ai_engine_reset_state() fills every window with zero-valued embeddings;
+ * a head that is skipped does not advance its temporal layers.
+ *
+ * Class activation maps (ai_engine_run_cam()) localize the fire output
+ * without a second network. The fire path must end in its [no_fire, fire]
+ * dense layer, fed by the last feature map F either directly (flatten),
+ * through a global average pool, or through one ReLU / linear dense layer.
+ * Just before that layer runs, F and the hidden layer's output are still
+ * in the activations, so the logit margin fire - no_fire is split over
+ * F's positions: gradient x input, with the requantization multipliers as
+ * the weight scales and the hidden ReLUs that fired as the mask (biases
+ * excluded). Extra cost is one pass over F for pooled and flattened maps;
+ * with a hidden layer, a pass over its weights for the units that fired.
+ *
+ * Compressed activations (AI_MODEL_FLAG_SPARSE): after the patched stage,
+ * a ReLU conv (or a max pool of such a map) whose next layer is a conv,
+ * max pool or dense writes its output map in a row format where values
+ * at the zero point cost one bit:
+ *   uint32 [h + 1]  row start offsets, from the end of the table
+ *   row y           w * c bytes as is, or, when shorter, a bitmap of
+ *                   (w * c + 7) / 8 bytes (bit j, LSB first: value j is
+ *                   not the zero point) followed by those values
+ * The producer computes one output row at a time into a plain row and
+ * compresses it; the consumer decodes the few input rows it needs into a
+ * sliding window (a dense layer decodes straight into its A panel) and
+ * runs the GEMM with zero skipping (ai_gemm.h). Results are identical to
+ * the plain format. A row never exceeds its plain size, so arena_size
+ * covers every map at its largest plus the row tables and work rows, and
+ * is larger than the plain format's. Only the bytes written and read and
+ * the MACs of zero steps go down; measured end to end, the format costs
+ * RAM and cycles (sparsity_report.py), so converters leave it off. The map
+ * the class activation map reads is never compressed.
+ *
+ * Intra-op parallelism (hosts, ai_engine_run_parallel()): conv and dense
+ * layers big enough to pay for it are split over an AiGemmPool's workers
+ * (ai_gemm.h), fused conv + pool layers by bands of pooled rows. The arena
+ * is unchanged; workers other than the caller pack into their own scratch
+ * (ai_engine_worker_scratch_size() bytes each). Results are identical to
+ * a serial run.
+ */
+
+#ifndef AI_ENGINE_H
+#define AI_ENGINE_H
+
+#include <stdint.h>
+
+struct AiGemmPool;
+
+#define AI_ENGINE_MAGIC        0x314D4446u  // "FDM1"
+#define AI_ENGINE_VERSION      1
+#define AI_ENGINE_HEADER_SIZE  40
+#define AI_ENGINE_LAYER_SIZE   32
+#define AI_ENGINE_MAX_INPUT    1024         // Float input: FireDetectionModel.input_buffer
+#define AI_ENGINE_MAX_IMAGE    (128 * 128)  // 8-bit image input (ai_engine_run_image)
+#define AI_ENGINE_MAX_OUTPUT   32           // All heads together
+#define AI_ENGINE_MAX_HEADS    4
+#define AI_ENGINE_MAX_PATCH_LAYERS 16
+#define AI_ENGINE_MAX_TAPS     16           // Frames in a temporal layer's window
+
+// Activation arena held by each engine context
+#ifndef AI_ENGINE_ARENA_SIZE
+#define AI_ENGINE_ARENA_SIZE   (64 * 1024)
+#endif
+
+// Ops
+#define AI_OP_CONV2D_3X3       1   // Stride 1, same padding
+#define AI_OP_MAXPOOL_2X2      2   // Stride 2
+#define AI_OP_GLOBAL_AVGPOOL   3
+#define AI_OP_DENSE            4   // Flattens its NHWC input
+#define AI_OP_CONV2D_3X3_POOL  5   // Conv 3x3 + max pool 2x2, fused
+#define AI_OP_HEAD             6   // Start of a task head (AI_MODEL_FLAG_HEADS)
+#define AI_OP_TEMPORAL_CONV    7   // Causal 1-D conv over frames (stateful)
+
+// Header flags
+#define AI_MODEL_FLAG_PACKED_B 0x0001      // Weights pre-packed into GEMM panels
+#define AI_MODEL_FLAG_PATCHED  0x0002      // Leading layers run patch by patch
+#define AI_MODEL_FLAG_HEADS    0x0004      // Shared backbone + task heads
+#define AI_MODEL_FLAG_SPARSE   0x0008      // Post-ReLU maps stored compressed, zeros skipped
+
+// Head tasks; run masks select heads by task bit
+#define AI_TASK_FIRE           0   // [no_fire, fire] logits
+#define AI_TASK_SMOKE          1   // [no_smoke, smoke] logits
+#define AI_TASK_LOCATION       2   // Square grid of fire-location logits
+#define AI_TASK_COUNT          3
+#define AI_TASK_BIT(task)      (1u << (task))
+#define AI_TASKS_ALL           0xFFFFFFFFu
+
+// Fused activations
+#define AI_ACT_NONE            0
+#define AI_ACT_RELU            1
+#define AI_ACT_LUT             2   // int8 -> int8 table (conv / dense only)
+#define AI_ACT_LUT_SIZE        256
+
+// Error codes
+#define AI_ENGINE_OK           0
+#define AI_ENGINE_ERR_FORMAT  -1   // Not an FDM1 model / inconsistent layer table
+#define AI_ENGINE_ERR_ARENA   -2   // Activations do not fit the arena
+#define AI_ENGINE_ERR_SHAPE   -3   // Input or output larger than the context buffers
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t layer_count;
+    uint16_t input_w;
+    uint16_t input_h;
+    uint16_t input_c;
+    uint8_t patch_layers;     // Layers run per tile (AI_MODEL_FLAG_PATCHED)
+    uint8_t patch_grid;       // Tiles per side of the patched stage's output
+    float input_scale;        // Float input (0-1) -> int8
+    int32_t input_zero;
+    float output_scale;       // Last layer int8 -> float logits
+    int32_t output_zero;
+    uint32_t arena_size;      // Bytes needed for the activation ping-pong (state excluded)
+    uint32_t flags;
+} AiModelHeader;
+
+typedef struct {
+    uint8_t op;
+    uint8_t activation;
+    int8_t input_zero;
+    int8_t output_zero;
+    uint16_t in_w, in_h, in_c;
+    uint16_t out_w, out_h, out_c;
+    uint32_t weights_offset;  // Offsets from the start of the model
+    uint32_t bias_offset;
+    uint32_t quant_offset;
+    uint32_t lut_offset;      // AI_ACT_LUT table, else 0
+} AiLayer;
+
+// One head of a multi-task model
+typedef struct {
+    uint8_t task;             // AI_TASK_*
+    uint8_t layer;            // Its AI_OP_HEAD record
+    uint16_t offset;          // First of its values in the run output
+    uint16_t count;           // Values it produces
+    uint16_t reserved;
+} AiHeadInfo;
+
+/**
+ * Validate a model image
+ * Checks the header, every layer's shapes and tensor bounds, and that
+ * GEMM scratch + activations + temporal state fit arena_capacity. Returns the layer count
+ * (> 0) or an AI_ENGINE_ERR_* code; header is filled on success (may be NULL).
+ */
+int32_t ai_engine_check(const uint8_t* model, uint32_t size, uint32_t arena_capacity,
+                        AiModelHeader* header);
+
+/**
+ * Number of values a run of a validated model produces (all heads)
+ */
+uint32_t ai_engine_output_count(const uint8_t* model);
+
+/**
+ * GEMM scratch bytes at the start of the arena for a validated model
+ */
+uint32_t ai_engine_scratch_size(const uint8_t* model);
+
+/**
+ * Scratch bytes each worker of an AiGemmPool needs for a validated model
+ */
+uint32_t ai_engine_worker_scratch_size(const uint8_t* model);
+
+/**
+ * Temporal state bytes a validated model keeps in the arena after its
+ * scratch and activations (0 without AI_OP_TEMPORAL_CONV layers)
+ */
+uint32_t ai_engine_state_size(const uint8_t* model);
+
+/**
+ * Clear the temporal state in arena: every window holds zero-valued
+ * embeddings. Call before the first run of a model on an arena, and when
+ * the frame sequence breaks (camera switch, model swap).
+ */
+void ai_engine_reset_state(const uint8_t* model, int8_t* arena);
+
+/**
+ * Run a validated model
+ * input: float tensor (NHWC, header input shape, at most AI_ENGINE_MAX_INPUT
+ * values), arena: 4-byte aligned, scratch except for the temporal state,
+ * output: dequantized values of the last layer. Returns the number of
+ * outputs written or AI_ENGINE_ERR_SHAPE.
+ */
+int32_t ai_engine_run(const uint8_t* model, const float* input, int8_t* arena,
+                      float* output, uint32_t output_capacity);
+
+/**
+ * Run a validated model on an 8-bit image (NHWC, header input shape)
+ * Pixels are normalized as preprocess_image() does (pixel / 255), so the
+ * result equals ai_engine_run() on the preprocessed tensor; no float copy
+ * of the input is needed, which keeps large inputs affordable.
+ */
+int32_t ai_engine_run_image(const uint8_t* model, const uint8_t* image, int8_t* arena,
+                            float* output, uint32_t output_capacity);
+
+/**
+ * Heads of a validated model, in table order (up to max entries)
+ * Returns the head count; 0 for single-output models.
+ */
+uint32_t ai_engine_heads(const uint8_t* model, AiHeadInfo* heads, uint32_t max);
+
+/**
+ * Run the backbone and only the heads whose AI_TASK_BIT is in task_mask
+ * Each head's values land at its AiHeadInfo offset in output; skipped
+ * heads leave theirs untouched. Single-output models ignore the mask.
+ * Returns ai_engine_output_count() (capped to output_capacity) or an error.
+ */
+int32_t ai_engine_run_heads(const uint8_t* model, const float* input, int8_t* arena,
+                            uint32_t task_mask, float* output, uint32_t output_capacity);
+
+// Same on an 8-bit image (see ai_engine_run_image())
+int32_t ai_engine_run_image_heads(const uint8_t* model, const uint8_t* image, int8_t* arena,
+                                  uint32_t task_mask, float* output, uint32_t output_capacity);
+
+/* ==================== CLASS ACTIVATION MAP ==================== */
+
+#define AI_CAM_GRID            4            // Heat map cells per side
+#define AI_CAM_CELLS           (AI_CAM_GRID * AI_CAM_GRID)
+
+// Where the fire output comes from, in the feature map's geometry
+typedef struct {
+    float heat[AI_CAM_CELLS];   // Share of the fire - no_fire logit margin per cell, row-major
+    float peak;                 // Largest single map position's share
+    uint16_t peak_x, peak_y;    // That position's center, input pixels
+    uint16_t map_w, map_h;      // Feature map behind the cells
+    uint32_t valid;             // Set when the fire output ran and was mapped
+} AiCam;
+
+/**
+ * Whether a validated model's fire output can be mapped: AI_ENGINE_OK,
+ * or AI_ENGINE_ERR_FORMAT when its tail is not one of the shapes above
+ * (e.g. table activations, a temporal layer, two hidden dense layers)
+ */
+int32_t ai_engine_cam_check(const uint8_t* model);
+
+/**
+ * ai_engine_run_heads() plus the class activation map of the fire output
+ * Map positions are spread over AI_CAM_GRID x AI_CAM_GRID cells by area,
+ * so the cells sum to the margin the map accounts for. cam->valid stays 0
+ * when the fire head is masked out or the model cannot be mapped.
+ */
+int32_t ai_engine_run_cam(const uint8_t* model, const float* input, int8_t* arena, uint32_t task_mask,
+                          float* output, uint32_t output_capacity, AiCam* cam);
+
+// Same on an 8-bit image
+int32_t ai_engine_run_image_cam(const uint8_t* model, const uint8_t* image, int8_t* arena,
+                                uint32_t task_mask, float* output, uint32_t output_capacity, AiCam* cam);
+
+/* ==================== PARALLEL ==================== */
+
+/**
+ * ai_engine_run_cam() / ai_engine_run_image_cam() with large layers split
+ * over pool's workers: set exactly one of input / image; cam may be NULL.
+ * A NULL pool, or one whose scratch is smaller than
+ * ai_engine_worker_scratch_size(), runs on the caller alone.
+ */
+int32_t ai_engine_run_parallel(const uint8_t* model, const float* input, const uint8_t* image, int8_t* arena,
+                               uint32_t task_mask, float* output, uint32_t output_capacity, AiCam* cam,
+                               const struct AiGemmPool* pool);
+
+#endif // AI_ENGINE_H
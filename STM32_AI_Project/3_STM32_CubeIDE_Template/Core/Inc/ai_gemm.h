@@ -0,0 +1,197 @@
+/*
+ * Int8 GEMM Core
+ * One register-blocked kernel behind both conv (implicit im2col) and dense
+ *
+ *   out[m][n] = requant(bias[n] + sum_k (A[m][k] - a_zero) * B[n][k])
+ *   (then lut[out + 128] when a table activation is fused)
+ *
+ * A: activations. Conv rows are output pixels, k runs over the 3x3 window
+ *    and input channels ([ky][kx][ic], the weight order); dense has one row.
+ *    MR rows at a time are packed into an int16 panel with the zero point
+ *    removed and padding taps as 0, so no im2col matrix is ever built.
+ * B: weights, either the plain [n][k] layout or (AI_MODEL_FLAG_PACKED_B)
+ *    pre-packed by the converter into NR-channel panels:
+ *      for each group of NR channels, for each 4-deep k step:
+ *        NR x 4 int8 weights, k padded with zeros to a multiple of 4
+ *    so the microkernel reads one sequential, word-aligned stream.
+ *
+ * Inside a 4-deep k step the A panel stores k order 0,2,1,3: on Cortex-M
+ * with the DSP extension SXTB16 splits a weight word into (w0,w2) and
+ * (w1,w3), and each SMLAD does two MACs against the matching A pair.
+ * The portable build does the same arithmetic in plain C. Results are
+ * exact integer sums either way, bit-identical to engine_model.py.
+ *
+ * Cache blocking: output channels are processed in blocks of NC, sized so
+ * NC x K weight bytes stay within AI_GEMM_CACHE_BYTES while every A panel
+ * of the layer streams past them.
+ *
+ * Zero skipping (AiGemmParams.skip, for inputs that are mostly ReLU
+ * zeros): after packing, the 4-deep steps where every panel row is zero
+ * are dropped from a step list and the microkernels run the live steps
+ * only, still two SMLADs per step. Panels with fewer than 1/8 of their
+ * steps dead run the plain kernels.
+ *
+ * Intra-op parallelism (AiGemmParams.pool, host builds): a layer large
+ * enough to pay for the hand-off is split into tasks the pool's workers
+ * claim - conv by spatial ranges of output pixels (by output channels when
+ * there are too few pixels), dense by output channels over one shared A
+ * panel. Each worker packs into its own scratch; pool->run() returns once
+ * every task is done, so a layer never overlaps the next. The split does
+ * not change any sum: results are bit-identical to a serial run.
+ */
+
+#ifndef AI_GEMM_H
+#define AI_GEMM_H
+
+#include <stdint.h>
+
+#define AI_GEMM_MR   2          // Rows (output pixels) per microkernel call
+#define AI_GEMM_NR   2          // Columns (output channels) per microkernel call; packed panel width
+#define AI_GEMM_MAX_WORKERS 16  // Threads of an AiGemmPool, the caller included
+
+// Weight bytes kept hot per channel block: half the M7's 16KB D-cache
+// (the rest holds A panels, bias/quant and the output), or host L1
+#ifndef AI_GEMM_CACHE_BYTES
+#if defined(__ARM_ARCH_7EM__)
+#define AI_GEMM_CACHE_BYTES  (8 * 1024)
+#else
+#define AI_GEMM_CACHE_BYTES  (24 * 1024)
+#endif
+#endif
+
+/**
+ * Task i of a job, run by worker (0: the thread that called run())
+ */
+typedef void (*AiGemmTask)(void* ctx, uint32_t task, uint32_t worker);
+
+/*
+ * Worker pool (e.g. Host/ai_thread_pool.c); the firmware passes none
+ * run(): task(ctx, i, worker) for every i < tasks over the workers, the
+ *        caller taking part; returns when all are done (the barrier).
+ *        One job at a time per pool.
+ */
+typedef struct AiGemmPool {
+    void (*run)(void* user, AiGemmTask task, void* ctx, uint32_t tasks);
+    void* user;
+    uint32_t workers;               // Caller included, up to AI_GEMM_MAX_WORKERS
+    uint32_t min_macs;              // Least work per task; smaller layers stay on the caller
+    uint32_t scratch_size;          // Bytes of each scratch[] (ai_engine_worker_scratch_size())
+    int16_t* scratch[AI_GEMM_MAX_WORKERS];  // Workers 1.. (the caller uses its own), 4-byte aligned
+} AiGemmPool;
+
+typedef struct {
+    const int8_t* weights;          // B, plain [n][k] or packed panels
+    uint32_t packed;                // Nonzero: AI_GEMM_NR-channel panels
+    uint32_t n;                     // Output channels
+    uint32_t k;                     // Depth (unpadded)
+    const uint8_t* bias;            // int32[n], any alignment (model image)
+    const uint8_t* multiplier;      // int32[n]
+    const uint8_t* shift;           // int32[n]
+    int32_t a_zero;                 // Input zero point
+    int32_t out_zero;
+    int32_t out_min;                // out_zero with fused ReLU, else -128
+    const int8_t* lut;              // Fused table activation (lut[out + 128]) or NULL
+    uint32_t skip;                  // Nonzero: skip all-zero A steps (ai_gemm_skip_size() more scratch)
+    const AiGemmPool* pool;         // Split large layers over these workers, or NULL
+} AiGemmParams;
+
+/**
+ * k rounded up to the 4-deep step
+ */
+static inline uint32_t ai_gemm_depth(uint32_t k) {
+    return (k + 3u) & ~3u;
+}
+
+/**
+ * Panel position of depth index k: order 0,2,1,3 inside each 4-deep step
+ */
+static inline uint32_t ai_gemm_panel_index(uint32_t k) {
+    return (k & ~3u) | ((k & 1u) << 1) | ((k >> 1) & 1u);
+}
+
+/**
+ * Bytes of B for n channels of depth k in the packed layout
+ */
+static inline uint32_t ai_gemm_packed_size(uint32_t n, uint32_t k) {
+    return ((n + AI_GEMM_NR - 1u) / AI_GEMM_NR) * AI_GEMM_NR * ai_gemm_depth(k);
+}
+
+/**
+ * Weight B[n][k] in either layout, for occasional reads outside the GEMM
+ */
+static inline int8_t ai_gemm_weight(const AiGemmParams* p, uint32_t n, uint32_t k) {
+    if (!p->packed) return p->weights[n * p->k + k];
+    const uint32_t panel = (n / AI_GEMM_NR) * AI_GEMM_NR * ai_gemm_depth(p->k);
+    return p->weights[panel + (k & ~3u) * AI_GEMM_NR + (n % AI_GEMM_NR) * 4u + (k & 3u)];
+}
+
+/**
+ * Scratch bytes for the A panel of a depth-k layer (conv or dense)
+ */
+static inline uint32_t ai_gemm_scratch_size(uint32_t k) {
+    return AI_GEMM_MR * ai_gemm_depth(k) * (uint32_t)sizeof(int16_t);
+}
+
+/**
+ * Scratch after the A panel for the live-step list of a skipping layer
+ */
+static inline uint32_t ai_gemm_skip_size(uint32_t k) {
+    return (ai_gemm_depth(k) / 4u * (uint32_t)sizeof(uint16_t) + 3u) & ~3u;
+}
+
+/**
+ * Tasks worth splitting macs MACs into: one per worker, fewer when a task
+ * would get less than pool->min_macs; 1 without a pool
+ */
+static inline uint32_t ai_gemm_tasks(const AiGemmPool* pool, uint64_t macs) {
+    if (!pool || pool->workers < 2u) return 1u;
+    uint64_t tasks = macs / (pool->min_macs ? pool->min_macs : 1u);
+    if (tasks < 1u) return 1u;
+    return (tasks < pool->workers) ? (uint32_t)tasks : pool->workers;
+}
+
+/**
+ * acc * multiplier * 2^(shift - 31), rounded half up
+ */
+static inline int32_t ai_requantize(int32_t acc, int32_t multiplier, int32_t shift) {
+    int32_t right = 31 - shift;
+    int64_t prod = (int64_t)acc * multiplier;
+    return (int32_t)((prod + ((int64_t)1 << (right - 1))) >> right);
+}
+
+static inline int8_t ai_saturate(int32_t v, int32_t lo) {
+    if (v < lo) return (int8_t)lo;
+    if (v > 127) return 127;
+    return (int8_t)v;
+}
+
+/**
+ * 3x3 stride-1 same-padding convolution over an NHWC w x h x c input
+ * (p->k must be 9 * c); out is NHWC w x h x p->n
+ * scratch: ai_gemm_scratch_size(p->k) bytes, 4-byte aligned
+ */
+void ai_gemm_conv3x3(const AiGemmParams* p, const int8_t* in, uint32_t w, uint32_t h,
+                     uint32_t c, int8_t* out, int16_t* scratch);
+
+/**
+ * Same convolution, computing only the out_w x out_h output pixels starting
+ * at (x0, y0) of the w x h input; out is NHWC out_w x out_h x p->n. Taps
+ * outside the input are padding, so a patch that carries a 1-pixel halo
+ * wherever it borders more of the image gives the full-frame result.
+ */
+void ai_gemm_conv3x3_window(const AiGemmParams* p, const int8_t* in, uint32_t w, uint32_t h,
+                            uint32_t c, uint32_t x0, uint32_t y0, uint32_t out_w, uint32_t out_h,
+                            int8_t* out, int16_t* scratch);
+
+/**
+ * Fully connected layer: in has p->k values, out gets p->n
+ */
+void ai_gemm_dense(const AiGemmParams* p, const int8_t* in, int8_t* out, int16_t* scratch);
+
+/**
+ * Fully connected layer on an A row the caller packed into scratch:
+ * value k - a_zero at ai_gemm_panel_index(k), zeros up to ai_gemm_depth()
+ */
+void ai_gemm_dense_packed(const AiGemmParams* p, int8_t* out, int16_t* scratch);
+
+#endif // AI_GEMM_H
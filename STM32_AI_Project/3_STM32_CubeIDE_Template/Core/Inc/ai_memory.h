@@ -0,0 +1,127 @@
+/*
+ * Memory Map and Cache Maintenance
+ * Lets the firmware run with the Cortex-M7 I- and D-cache enabled while
+ * peripherals move data by DMA
+ *
+ * Memory map (ai_memory_init(), linker script sections):
+ *   AI_DMA_BUFFER   D2 SRAM (0x30000000), write-back cached, reachable by
+ *                   DMA1/DMA2 (DTCM is not). Cache-line aligned; sizes
+ *                   rounded with AI_CACHE_ROUND() so no buffer shares a
+ *                   line with other data.
+ *   AI_DMA_NOCACHE  SRAM3 (0x30040000, 32KB), MPU non-cacheable: DMA
+ *                   descriptors and small control words the CPU and a
+ *                   DMA engine both touch, no maintenance needed
+ *   AI_FRAME_BUFFER AXI SRAM (0x24000000, 512KB), write-back cached:
+ *                   large CPU-side buffers (the frame pool) that would
+ *                   overflow DTCM, where the default .bss lands.
+ *                   Cache-line aligned like AI_DMA_BUFFER.
+ *   everything else default map: AXI SRAM / DTCM / flash cached
+ *
+ * Handoffs (every one of them, in the code that owns the buffer):
+ *   before a device write   ai_cache_receive()     clean + invalidate: no
+ *                                                  dirty line can be evicted
+ *                                                  over the DMA data
+ *   device wrote -> CPU     ai_cache_invalidate()  drop lines speculatively
+ *                                                  refilled during the transfer
+ *   CPU wrote -> device     ai_cache_clean()       write dirty lines back
+ * Ranges must start and end on cache lines: invalidating part of a line
+ * would discard CPU writes to its other bytes.
+ *
+ * Checker build (host, -DAI_CACHE_CHECK, 2_Desktop_Tools/cache_check.py):
+ * the maintenance calls drive a per-line model of the M7 cache; the host
+ * declares each DMA buffer (ai_dma_declare(), lines assumed dirty from
+ * startup zeroing), reports its side of each transfer with
+ * ai_dma_device_write() / _read(), and AI_CACHE_CPU_READ() marks where
+ * the firmware reads DMA data. Reading a
+ * line the device wrote without an invalidate, a device read of a line
+ * the CPU dirtied without a clean, a device write over a dirty line and
+ * a partial-line invalidate are counted as violations. In other builds
+ * the annotations compile to nothing.
+ */
+
+#ifndef AI_MEMORY_H
+#define AI_MEMORY_H
+
+#include <stdint.h>
+
+// Cache line: 32 bytes on Cortex-M7 (and in the checker, which models
+// it), 64 on host CPUs
+#if defined(__ARM_ARCH) || defined(AI_CACHE_CHECK)
+#define AI_CACHE_LINE 32
+#else
+#define AI_CACHE_LINE 64
+#endif
+#define AI_ALIGNED(n) __attribute__((aligned(n)))
+#define AI_CACHE_ROUND(n) (((n) + AI_CACHE_LINE - 1u) & ~(uint32_t)(AI_CACHE_LINE - 1u))
+
+// Firmware build (ARMv7E-M: the Cortex-M7 target). The QEMU board build
+// (AI_QEMU) has no HAL and QEMU models no caches: host no-ops there
+#if defined(__ARM_ARCH_7EM__) && !defined(AI_QEMU)
+#define AI_MEMORY_TARGET 1
+#endif
+
+// Placement (sections defined in the linker script, see README)
+#if defined(AI_MEMORY_TARGET)
+#define AI_DMA_BUFFER  __attribute__((section(".dma_buffer"), aligned(AI_CACHE_LINE)))
+#define AI_DMA_NOCACHE __attribute__((section(".dma_nocache"), aligned(AI_CACHE_LINE)))
+#define AI_FRAME_BUFFER __attribute__((section(".frame_buffer"), aligned(AI_CACHE_LINE)))
+#else
+#define AI_DMA_BUFFER  AI_ALIGNED(AI_CACHE_LINE)
+#define AI_DMA_NOCACHE AI_ALIGNED(AI_CACHE_LINE)
+#define AI_FRAME_BUFFER AI_ALIGNED(AI_CACHE_LINE)
+#endif
+
+#define AI_DMA_REGION_BASE    0x30000000u   // D2 SRAM1 + SRAM2
+#define AI_DMA_REGION_SIZE    (256u * 1024u)
+#define AI_NOCACHE_BASE       0x30040000u   // D2 SRAM3
+#define AI_NOCACHE_SIZE       (32u * 1024u)
+
+#if defined(AI_CACHE_CHECK) || defined(AI_MEMORY_TARGET)
+
+/**
+ * MPU regions for the map above, then I- and D-cache on (target; call
+ * right after HAL_Init(), before any DMA is started)
+ */
+void ai_memory_init(void);
+
+void ai_cache_receive(const void* addr, uint32_t bytes);
+void ai_cache_invalidate(const void* addr, uint32_t bytes);
+void ai_cache_clean(const void* addr, uint32_t bytes);
+
+#else
+
+// Plain host builds: coherent, nothing to maintain
+static inline void ai_memory_init(void) {}
+static inline void ai_cache_receive(const void* addr, uint32_t bytes) { (void)addr; (void)bytes; }
+static inline void ai_cache_invalidate(const void* addr, uint32_t bytes) { (void)addr; (void)bytes; }
+static inline void ai_cache_clean(const void* addr, uint32_t bytes) { (void)addr; (void)bytes; }
+
+#endif
+
+#if defined(AI_CACHE_CHECK)
+
+#define AI_CACHE_CPU_READ(addr, bytes)   ai_cache_cpu_read((addr), (bytes))
+#define AI_CACHE_CPU_WRITE(addr, bytes)  ai_cache_cpu_write((addr), (bytes))
+
+// Firmware side: CPU accesses to DMA buffers
+void ai_cache_cpu_read(const void* addr, uint32_t bytes);
+void ai_cache_cpu_write(const void* addr, uint32_t bytes);
+
+// Host side: the buffers and the emulated DMA transfers
+void ai_dma_declare(const void* addr, uint32_t bytes);
+void ai_dma_device_write(const void* addr, uint32_t bytes);
+void ai_dma_device_read(const void* addr, uint32_t bytes);
+
+// Results
+uint32_t ai_cache_violations(void);
+const char* ai_cache_last_violation(void);
+void ai_cache_check_reset(void);
+
+#else
+
+#define AI_CACHE_CPU_READ(addr, bytes)   ((void)0)
+#define AI_CACHE_CPU_WRITE(addr, bytes)  ((void)0)
+
+#endif
+
+#endif // AI_MEMORY_H
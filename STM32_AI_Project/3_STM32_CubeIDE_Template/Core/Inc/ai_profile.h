@@ -0,0 +1,52 @@
+/*
+ * Profiling Marks
+ * Begin / end marks around pipeline stages and engine layers, for
+ * instruction-count profiling on an emulated Cortex-M7 (Qemu/, built
+ * with -DAI_PROFILE)
+ *
+ * A mark is a call to ai_profile_mark(id), an empty non-inlined function;
+ * the QEMU plugin (Qemu/insn_profile_plugin.c) watches its entry address,
+ * reads the id from r0 and keeps a stack of open marks, so each id gets
+ * the instructions executed between its begin and end, nested marks
+ * included, and the number of times it ran. Marks nest and must balance.
+ *
+ * Without AI_PROFILE every mark compiles to nothing.
+ */
+
+#ifndef AI_PROFILE_H
+#define AI_PROFILE_H
+
+#include <stdint.h>
+
+#define AI_PROFILE_EXIT        0x8000u       // Set on end marks
+
+// Pipeline stages (one frame of the main loop)
+#define AI_PROFILE_FRAME       0x01u
+#define AI_PROFILE_CAPTURE     0x02u         // Camera frame into sensor_image
+#define AI_PROFILE_INFERENCE   0x03u         // fire_detection_inference_image()
+#define AI_PROFILE_DECISION    0x04u         // process_detection_output() + fusion
+#define AI_PROFILE_THERMAL     0x05u         // thermal_convert_frame()
+#define AI_PROFILE_ANALOG      0x06u         // One ADC DMA half, analog_poll()
+#define AI_PROFILE_AUDIO       0x07u         // PDM decimation + feature frames
+
+// Engine (ai_engine.c)
+#define AI_PROFILE_ENGINE      0x10u         // One ai_engine_run*() call
+#define AI_PROFILE_INPUT       0x11u         // Input quantization (every tile)
+#define AI_PROFILE_CAM         0x12u         // Class activation map (ai_engine_run_cam())
+#define AI_PROFILE_LAYER(i)    (0x100u + (uint32_t)(i))  // Layer table index (every tile)
+
+#if defined(AI_PROFILE)
+
+void ai_profile_mark(uint32_t id);
+
+#define AI_PROFILE_BEGIN(id)   ai_profile_mark(id)
+#define AI_PROFILE_END(id)     ai_profile_mark((id) | AI_PROFILE_EXIT)
+
+#else
+
+#define AI_PROFILE_BEGIN(id)   ((void)0)
+#define AI_PROFILE_END(id)     ((void)0)
+
+#endif
+
+#endif // AI_PROFILE_H
@@ -0,0 +1,130 @@
+/*
+ * Analog Sensor Acquisition
+ * Smoke, CO and temperature channels sampled continuously by ADC scan +
+ * circular DMA, decimated in fixed point inside the DMA callbacks, and
+ * reduced to a trend decision that wakes / prioritizes the vision pipeline
+ *
+ * Signal chain per channel (12-bit ADC, ANALOG_SAMPLE_HZ per channel):
+ *
+ *   CIC, order 3, decimate 16    integer adds only, gain 2^12
+ *   FIR, 16 taps Q15, decimate 4 anti-alias for the ~15.6 Hz output
+ *
+ * so each DMA half (ANALOG_HALF_FRAMES scan frames) yields exactly one
+ * output per channel, in ADC counts Q4. The half-transfer and complete
+ * interrupts filter their half while DMA fills the other; the main loop
+ * drains the outputs with analog_poll(), which tracks a slow baseline and
+ * a fast average per channel and raises the decision level on a rise
+ * above baseline or a steep slope. All channels are expected to be wired
+ * so the reading rises with the hazard.
+ */
+
+#ifndef ANALOG_SENSORS_H
+#define ANALOG_SENSORS_H
+
+#include <stdint.h>
+
+#define ANALOG_CH_SMOKE        0
+#define ANALOG_CH_CO           1
+#define ANALOG_CH_TEMP         2
+#define ANALOG_CHANNELS        3             // ADC scan order
+
+#define ANALOG_SAMPLE_HZ       1000          // Per channel (timer-triggered scan)
+#define ANALOG_CIC_ORDER       3
+#define ANALOG_CIC_DECIM       16
+#define ANALOG_CIC_SHIFT       8             // Gain 16^3 = 2^12 -> output Q4
+#define ANALOG_FIR_TAPS        16
+#define ANALOG_FIR_DECIM       4
+#define ANALOG_DECIM           (ANALOG_CIC_DECIM * ANALOG_FIR_DECIM)
+#define ANALOG_HALF_FRAMES     ANALOG_DECIM  // One output per channel per DMA half
+#define ANALOG_DMA_SAMPLES     (2 * ANALOG_HALF_FRAMES * ANALOG_CHANNELS)
+#define ANALOG_OUT_RING        32            // Outputs buffered for the main loop (power of 2)
+
+#define ANALOG_SETTLE_OUTPUTS  (ANALOG_FIR_TAPS / ANALOG_FIR_DECIM + 1)  // Filter start-up, discarded
+#define ANALOG_SLOPE_WINDOW    16            // Outputs per slope measurement (~1 s)
+#define ANALOG_BASELINE_SHIFT  8             // Baseline EMA: 1/256 per output (~16 s)
+#define ANALOG_FAST_SHIFT      2             // Fast EMA: 1/4 per output
+
+// Decision levels
+#define ANALOG_QUIET           0
+#define ANALOG_WATCH           1             // Rising: run vision now, at full rate
+#define ANALOG_ALARM           2             // Strong rise on one channel, or several rising
+
+// Per-channel thresholds, ADC counts Q4 (16 = one count)
+typedef struct {
+    int32_t watch_rise;              // Above baseline
+    int32_t alarm_rise;
+    int32_t watch_slope;             // Increase of the fast average over ANALOG_SLOPE_WINDOW outputs
+} AnalogThresholds;
+
+// Decimation state of one channel
+typedef struct {
+    uint32_t integrator[ANALOG_CIC_ORDER];  // Wrap-around arithmetic
+    uint32_t comb[ANALOG_CIC_ORDER];
+    uint32_t cic_phase;
+    int32_t fir_history[ANALOG_FIR_TAPS];   // CIC outputs, circular
+    uint32_t fir_pos;
+    uint32_t fir_phase;
+} AnalogFilter;
+
+// Trend state of one channel
+typedef struct {
+    int32_t baseline;                // Q4 << 8
+    int32_t fast;                    // Q4 << 8
+    int32_t history[ANALOG_SLOPE_WINDOW];   // fast, one per output
+    uint32_t outputs;
+    uint8_t level;
+} AnalogTrend;
+
+typedef struct {
+    uint8_t level;                   // ANALOG_QUIET / WATCH / ALARM
+    uint8_t channels;                // Bit per channel at WATCH or above
+    int32_t value[ANALOG_CHANNELS];  // Latest filtered output, Q4
+    int32_t rise[ANALOG_CHANNELS];   // Fast average above baseline, Q4
+    int32_t slope[ANALOG_CHANNELS];  // Over the slope window, Q4
+    uint32_t sequence;               // Outputs consumed so far
+} AnalogDecision;
+
+/*
+ * Acquisition state
+ * The DMA buffer (ANALOG_DMA_SAMPLES, scan-interleaved) belongs to the
+ * caller: declare it AI_DMA_BUFFER (ai_memory.h). The DMA callbacks
+ * invalidate each half before filtering it.
+ */
+typedef struct {
+    const uint16_t* dma_buffer;
+    AnalogFilter filter[ANALOG_CHANNELS];
+    AnalogThresholds thresholds[ANALOG_CHANNELS];
+
+    // Decimated outputs, written in the DMA interrupt, read by analog_poll()
+    int32_t out[ANALOG_OUT_RING][ANALOG_CHANNELS];
+    volatile uint32_t out_head;
+    volatile uint32_t out_tail;
+
+    AnalogTrend trend[ANALOG_CHANNELS];
+    AnalogDecision decision;
+
+    // Statistics
+    uint32_t blocks;                 // DMA halves filtered
+    uint32_t dropped;                // Outputs lost to a full ring
+} AnalogAcquisition;
+
+/**
+ * Initialize filters and trends
+ * thresholds: ANALOG_CHANNELS entries, or NULL for the defaults.
+ */
+void analog_init(AnalogAcquisition* acq, const uint16_t* dma_buffer, const AnalogThresholds* thresholds);
+
+/**
+ * DMA half-transfer / transfer-complete (interrupt context): filter the
+ * half that was just filled
+ */
+void analog_dma_half(AnalogAcquisition* acq);
+void analog_dma_complete(AnalogAcquisition* acq);
+
+/**
+ * Consume pending outputs and update acq->decision
+ * Returns the number of outputs consumed.
+ */
+uint32_t analog_poll(AnalogAcquisition* acq);
+
+#endif // ANALOG_SENSORS_H
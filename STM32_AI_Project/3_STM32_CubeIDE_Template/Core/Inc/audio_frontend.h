@@ -0,0 +1,122 @@
+/*
+ * Audio Front-End
+ * PDM microphone -> 16 kHz PCM -> fixed-point real FFT -> log-mel
+ * features in a streaming ring, the input of a small crackle classifier
+ * that runs on the same int8 engine as the vision model
+ *
+ * PDM to PCM: order-3 CIC (sinc^3) decimating the 1.024 MHz bit stream by
+ * 64. Its 190-bit kernel is split into byte segments at init, so each PCM
+ * sample is AUDIO_PDM_WINDOW_BYTES table lookups + adds (8 input bytes
+ * per sample), then a one-pole DC blocker. Runs in the PDM DMA callbacks
+ * (SPI / SAI capture); parts with a DFSDM can filter in hardware and call
+ * audio_push_pcm() instead.
+ *
+ * Features, every AUDIO_HOP samples (16 ms) in the main loop:
+ *   Hann window (Q15) -> block-floating-point scaling -> 256-point complex
+ *   FFT on the packed real frame (Q15, halved every stage) + real split ->
+ *   power -> AUDIO_MEL_BANDS triangular mel bands -> log2 (1/8 octave)
+ * One byte per band: feature = log2(energy) in 1/8 octaves (0.375 dB)
+ * above AUDIO_LOG_FLOOR, clamped to 0-255. The last AUDIO_FEATURE_FRAMES
+ * rows form a time x mel "image" for ai_engine_run_image() without a copy
+ * (each row is stored twice, the window is always contiguous).
+ */
+
+#ifndef AUDIO_FRONTEND_H
+#define AUDIO_FRONTEND_H
+
+#include <stdint.h>
+
+#define AUDIO_SAMPLE_HZ        16000
+#define AUDIO_PDM_DECIM        64            // 1.024 MHz PDM clock
+#define AUDIO_PDM_ORDER        3
+#define AUDIO_PDM_TAPS         (AUDIO_PDM_ORDER * (AUDIO_PDM_DECIM - 1) + 1)
+#define AUDIO_PDM_WINDOW_BYTES ((AUDIO_PDM_TAPS + 7) / 8)
+#define AUDIO_PDM_HOP_BYTES    (AUDIO_PDM_DECIM / 8)   // Input bytes per PCM sample
+#define AUDIO_PDM_DMA_BYTES    512           // Circular DMA buffer: 2 halves of 2 ms
+
+#define AUDIO_FFT_SIZE         512           // 32 ms frame
+#define AUDIO_FFT_BITS         9
+#define AUDIO_HOP              256           // 16 ms
+#define AUDIO_BINS             (AUDIO_FFT_SIZE / 2 + 1)
+#define AUDIO_MEL_BANDS        32
+#define AUDIO_MEL_LOW_HZ       125.0f
+#define AUDIO_MEL_HIGH_HZ      7600.0f
+#define AUDIO_MEL_WEIGHTS      (2 * AUDIO_BINS)        // Non-zero triangle weights (upper bound)
+#define AUDIO_LOG_FLOOR        100           // log2 Q3 of the lowest energy kept (feature 0, ~96 dB below full scale)
+
+#define AUDIO_FEATURE_FRAMES   32            // Classifier window: 32 hops (0.5 s)
+#define AUDIO_PCM_RING         2048          // Samples buffered for the main loop (power of 2)
+#define AUDIO_CRACKLE_THRESHOLD 0.7f         // Classifier output that counts as crackle
+
+// One mel band: contiguous power bins with Q15 triangle weights
+typedef struct {
+    uint16_t first_bin;
+    uint16_t bins;
+    uint16_t weights;                // Index into AudioFrontEnd.mel_weights
+} AudioMelBand;
+
+/*
+ * Front-end state (~24KB, allocate statically)
+ */
+typedef struct {
+    // PDM decimation (interrupt context)
+    uint16_t pdm_lut[AUDIO_PDM_WINDOW_BYTES][256];   // Kernel segment sums per byte value
+    uint8_t pdm_tail[AUDIO_PDM_WINDOW_BYTES - AUDIO_PDM_HOP_BYTES];  // Previous block's end
+    int32_t dc_x, dc_y;              // DC blocker state
+
+    // PCM ring: written by audio_push_pcm(), framed by audio_process()
+    int16_t pcm[AUDIO_PCM_RING];
+    volatile uint32_t pcm_head;
+    uint32_t pcm_frame;              // Start of the next hop to frame
+
+    // FFT / mel tables (built once in audio_init)
+    int16_t window[AUDIO_FFT_SIZE];  // Hann, Q15
+    int16_t twiddle[AUDIO_FFT_SIZE / 2][2];  // cos, -sin of 2*pi*k/N, Q15
+    AudioMelBand mel[AUDIO_MEL_BANDS];
+    int16_t mel_weights[AUDIO_MEL_WEIGHTS];
+
+    // Work buffers
+    int16_t fft[AUDIO_FFT_SIZE];     // Packed complex (re, im) of AUDIO_FFT_SIZE / 2 points
+    uint32_t power[AUDIO_BINS];
+
+    // Feature ring: row r stored at r and r + AUDIO_FEATURE_FRAMES
+    uint8_t features[2 * AUDIO_FEATURE_FRAMES][AUDIO_MEL_BANDS];
+    uint32_t feature_pos;            // Next row to write; the window starts here
+    uint32_t hops;                   // Feature rows produced
+
+    // Statistics
+    uint32_t overruns;               // Samples lost because framing fell behind
+} AudioFrontEnd;
+
+/**
+ * Build the PDM, window, twiddle and mel tables; clears all state
+ */
+void audio_init(AudioFrontEnd* fe);
+
+/**
+ * PDM DMA half / complete (interrupt context): decimate bytes of the bit
+ * stream (multiple of AUDIO_PDM_HOP_BYTES, at least AUDIO_PDM_WINDOW_BYTES,
+ * MSB = first bit) into the PCM ring. The block is invalidated in the
+ * D-cache first, so it must be whole cache lines of an AI_DMA_BUFFER.
+ */
+void audio_pdm_push(AudioFrontEnd* fe, const uint8_t* pdm, uint32_t bytes);
+
+/**
+ * Append 16 kHz PCM samples (host input, hardware PDM filters)
+ */
+void audio_push_pcm(AudioFrontEnd* fe, const int16_t* pcm, uint32_t count);
+
+/**
+ * Turn every complete hop in the PCM ring into a feature row (main loop)
+ * Returns the number of rows produced.
+ */
+uint32_t audio_process(AudioFrontEnd* fe);
+
+/**
+ * Latest AUDIO_FEATURE_FRAMES x AUDIO_MEL_BANDS features, oldest row
+ * first: the classifier's 8-bit input image (valid once hops has reached
+ * AUDIO_FEATURE_FRAMES)
+ */
+const uint8_t* audio_features(const AudioFrontEnd* fe);
+
+#endif // AUDIO_FRONTEND_H
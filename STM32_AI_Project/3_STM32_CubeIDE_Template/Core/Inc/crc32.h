@@ -0,0 +1,25 @@
+/*
+ * CRC-32 (IEEE 802.3, reflected, same as zlib.crc32)
+ * Used for model images, update patches and link frames
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Continue a CRC over more data
+ * Start with crc = 0; chaining matches zlib.crc32(data, crc)
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRC32_H
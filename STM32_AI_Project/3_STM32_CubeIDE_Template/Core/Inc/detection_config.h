@@ -0,0 +1,103 @@
+/*
+ * Detection Configuration
+ * Thresholds and pipeline parameters that can be changed at run time over
+ * the link (LINK_MSG_CFG_*), e.g. per site: model_info.json suggests 0.5
+ * for high sensitivity and 0.85 for high specificity
+ *
+ * Two DetectionConfig slots and a published pointer, no locks and no
+ * critical sections:
+ *   writer  config_update(): validates into the slot the reader is not
+ *           using, derives the hot-path values there (logit thresholds),
+ *           then publishes it with one release store
+ *   reader  config_acquire() once per frame (main loop): one acquire load;
+ *           the frame uses that slot throughout, so a change applies at
+ *           the next frame boundary and no frame sees a half-written config
+ * One update per frame: until the reader has taken the last one, further
+ * updates are refused with CONFIG_ERR_BUSY and the host retries. A single
+ * writer (link handler, main loop or one ISR), a single reader.
+ *
+ * Versions: each accepted update increments version. CFG_SET carries the
+ * version it was based on; a stale one (another host changed it since) is
+ * refused with CONFIG_ERR_VERSION and the reply holds the current values.
+ *
+ * Wire format (CONFIG_WIRE_LENGTH bytes, little-endian, DetectionParams in
+ * field order): version u32 | 8 x f32 | 3 x u32
+ */
+
+#ifndef DETECTION_CONFIG_H
+#define DETECTION_CONFIG_H
+
+#include <stdint.h>
+#include "stm32_ai_framework.h"
+#include "link_protocol.h"
+
+#define CONFIG_WIRE_LENGTH     48
+
+// Status codes (CFG_STATUS payload byte 0)
+#define CONFIG_OK              0
+#define CONFIG_ERR_LENGTH      1             // Payload is not CONFIG_WIRE_LENGTH bytes
+#define CONFIG_ERR_RANGE       2             // Threshold outside (0, 1), critical below fire, bad period
+#define CONFIG_ERR_VERSION     3             // Based on an older version
+#define CONFIG_ERR_BUSY        4             // Previous update not applied yet (retry next frame)
+
+typedef struct {
+    uint32_t version;
+
+    // Decision thresholds (DetectionThresholds)
+    float fire;
+    float critical;
+    float smoke;
+    float crackle;
+    float promote_thermal;
+    float promote_analog;
+    float promote_audio;
+
+    // Pipeline (main.c)
+    float evidence;                  // CNN confidence that keeps the power manager in ALERT
+    uint32_t screen_period_ms;       // PowerPolicy
+    uint32_t active_period_ms;
+    uint32_t hold_ms;
+} DetectionParams;
+
+typedef struct {
+    DetectionParams params;
+    DetectionThresholds thresholds;  // Derived from params when published
+} DetectionConfig;
+
+typedef struct {
+    DetectionConfig slots[2];
+    const DetectionConfig* active;   // Published slot (release store / acquire load)
+    const DetectionConfig* in_use;   // Slot the reader's current frame uses
+
+    // Statistics
+    uint32_t updates;
+    uint32_t rejected;
+    uint32_t busy;
+} ConfigStore;
+
+/**
+ * Publish the initial parameters (version 0)
+ * params: NULL for the built-in thresholds with a 5 s / 100 ms / 60 s
+ * schedule and 0.3 evidence.
+ * Returns CONFIG_OK or CONFIG_ERR_RANGE (defaults published instead).
+ */
+int32_t config_init(ConfigStore* store, const DetectionParams* params);
+
+/**
+ * Reader, at a frame boundary: the configuration for this frame
+ */
+const DetectionConfig* config_acquire(ConfigStore* store);
+
+/**
+ * Writer: validate, derive and publish params (params->version must be
+ * the current version); returns a CONFIG_* status
+ */
+int32_t config_update(ConfigStore* store, const DetectionParams* params);
+
+/**
+ * Link handler (LinkMessageHandler, user = ConfigStore*): answers
+ * LINK_MSG_CFG_GET / CFG_SET with CFG_STATUS, ignores other types
+ */
+uint32_t config_link_handler(void* user, const LinkFrame* frame, uint8_t* tx, uint32_t tx_capacity);
+
+#endif // DETECTION_CONFIG_H
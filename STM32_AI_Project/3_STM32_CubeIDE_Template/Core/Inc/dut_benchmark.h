@@ -0,0 +1,137 @@
+/*
+ * Device-Under-Test Benchmark
+ * Inference benchmarking driven by a host over the link (LINK_MSG_DUT_*):
+ * the host streams an input tensor, the device runs it N times and
+ * returns the outputs and the cycle count of every run
+ * (2_Desktop_Tools/dut_benchmark.py)
+ *
+ * The same handler runs in the firmware (UART, DWT cycle counter) and in
+ * the Linux host device (Host/host_update_device.c, pseudo-terminal,
+ * nanosecond clock), so board and host results come from the same code
+ * path and the same protocol; DUT_DEVICE reports the clock rate to turn
+ * counts into time.
+ *
+ * A session starts with DUT_INFO and ends with DUT_END or after
+ * DUT_IDLE_TIMEOUT_MS without messages. While it is active the main loop
+ * runs no frames and does not enter Stop, and the platform may pause
+ * background acquisition (DutOps.session) so interrupts do not land in
+ * the measurement. Inference runs inside the handler, in the context that
+ * services the link; tensors are the 8-bit frames of
+ * fire_detection_inference_image() at the engine model's input shape (its
+ * header, which may differ from ModelInfo).
+ *
+ * Messages (host -> device; payloads little-endian):
+ *   DUT_INFO    empty                            -> DUT_DEVICE
+ *   DUT_INPUT   offset u32 | bytes               -> DUT_ACK
+ *   DUT_RUN     iterations u16 | flags u16 | task_mask u32 -> DUT_RESULT
+ *   DUT_END     empty                            -> DUT_ACK
+ * Replies (device -> host):
+ *   DUT_DEVICE  version u8 | status u8 | max_iterations u16 | input w, h, c u16 |
+ *               engine_layers u16 | input_bytes u32 | clock_hz u32 |
+ *               model_crc u32 | model_size u32 | platform char[16]
+ *   DUT_ACK     status u8 | received u32
+ *   DUT_RESULT  status u8 | flags u8 | iterations u16 | tasks_run u32 |
+ *               P(fire) f32 | P(smoke) f32 | fire_margin f32 | cycles u32[iterations]
+ * Outputs are those of the last run; task_mask 0 runs every head.
+ * Input chunks go in order; offset 0 starts a new tensor and a chunk
+ * already received is accepted again (host retries).
+ */
+
+#ifndef DUT_BENCHMARK_H
+#define DUT_BENCHMARK_H
+
+#include <stdint.h>
+#include "stm32_ai_framework.h"
+#include "link_protocol.h"
+#include "model_update.h"
+
+#define DUT_PROTOCOL_VERSION   1
+#define DUT_MAX_ITERATIONS     32            // Cycle counts per DUT_RESULT
+#define DUT_IDLE_TIMEOUT_MS    10000u
+#define DUT_PLATFORM_LENGTH    16
+#define DUT_DEVICE_LENGTH      (28 + DUT_PLATFORM_LENGTH)
+#define DUT_RESULT_HEADER      20
+
+// Status codes (reply payload byte 0)
+#define DUT_OK                 0
+#define DUT_ERR_LENGTH         1             // Payload too short / chunk empty
+#define DUT_ERR_OFFSET         2             // Chunk beyond the bytes received so far
+#define DUT_ERR_INPUT          3             // Tensor larger than the input, or incomplete at RUN
+#define DUT_ERR_RANGE          4             // Iterations 0 or above DUT_MAX_ITERATIONS
+#define DUT_ERR_MODEL          5             // No engine model (mock outputs)
+
+// DUT_RUN flags
+#define DUT_RUN_RESET          0x0001u       // Reset temporal state before every run
+#define DUT_RUN_CAM            0x0002u       // Compute the class activation map
+
+// DUT_RESULT flags
+#define DUT_RESULT_VARIED      0x01u         // Outputs differed between the runs
+#define DUT_RESULT_CAM         0x02u         // The map was computed
+
+/*
+ * Platform
+ * cycles(): free-running counter at clock_hz (wraps; one run must take
+ *           less than a wrap)
+ * session(): optional; active 1 when a session starts, 0 when it ends
+ */
+typedef struct {
+    uint32_t (*cycles)(void* user);
+    void (*session)(void* user, int32_t active);
+    uint32_t clock_hz;
+    const char* platform;            // Up to DUT_PLATFORM_LENGTH characters
+    void* user;
+} DutOps;
+
+typedef struct {
+    DutOps ops;
+    FireDetectionModel* model;       // Context the runs use (the deployed model)
+    uint8_t* input;                  // Tensor buffer
+    uint32_t capacity;
+    uint32_t received;               // Contiguous bytes from offset 0
+
+    volatile int32_t active;
+    uint32_t idle_since_ms;
+    uint8_t heard;                   // A message since the last dut_poll()
+    uint32_t saved_task_mask;        // Restored when the session ends
+    uint32_t saved_cam;
+
+    // Other message types on the link (e.g. config_link_handler)
+    LinkMessageHandler next;
+    void* next_user;
+
+    // Statistics
+    uint32_t sessions;
+    uint32_t runs;
+    uint32_t inferences;
+} DutSession;
+
+/**
+ * Bind a session to a model context and a tensor buffer (at least the
+ * model's input size); ops is copied
+ */
+void dut_init(DutSession* dut, FireDetectionModel* model, uint8_t* input, uint32_t capacity,
+              const DutOps* ops);
+
+/**
+ * Pass message types other than LINK_MSG_DUT_* to handler
+ */
+void dut_set_next(DutSession* dut, LinkMessageHandler handler, void* user);
+
+/**
+ * Link handler (LinkMessageHandler, user = DutSession*)
+ */
+uint32_t dut_link_handler(void* user, const LinkFrame* frame, uint8_t* tx, uint32_t tx_capacity);
+
+/**
+ * Main loop, once per pass: ends a session idle for DUT_IDLE_TIMEOUT_MS;
+ * returns 1 while a session is active (run no frame)
+ */
+int32_t dut_poll(DutSession* dut, uint32_t now_ms);
+
+/**
+ * End the session (also on DUT_END): restore the model's task mask and
+ * map setting, reset its temporal state, resume acquisition
+ */
+void dut_end(DutSession* dut);
+
+#endif // DUT_BENCHMARK_H
@@ -0,0 +1,166 @@
+/*
+ * Frame Buffer Pool
+ * Fixed-size frame buffers shared by reference between the consumers of a
+ * frame (inference, pre-alarm history, snapshot upload, debug dumps)
+ * instead of copied to each of them
+ *
+ * The pool carves one static block into equal, cache-line aligned
+ * buffers, each with a small descriptor. frame_acquire() hands out a free
+ * buffer holding one reference; every further consumer takes its own with
+ * frame_retain() and gives it back with frame_release(). The release that
+ * drops the last reference returns the buffer to the pool. Reference
+ * counts and the free bitmap change by atomic read-modify-write only
+ * (LDREX / STREX on the M7), no locks and no interrupts disabled, so
+ * acquire, retain and release can be called from ISRs (a DMA completion
+ * releasing the frame it sent, a capture interrupt acquiring the next).
+ *
+ * Exhaustion: with no buffer free, FRAME_DROP_NEWEST refuses the new frame
+ * (frame_acquire() returns NULL and the frame is skipped);
+ * FRAME_DROP_OLDEST first asks ops.reclaim() to let go of old frames - the
+ * owner of the history drops its oldest - until a buffer frees or there
+ * is nothing left to reclaim. The hook runs in the context that called
+ * frame_acquire(). Both count in the pool's statistics.
+ *
+ * A frame's contents and descriptor fields belong to the producer until it
+ * shares the frame; after that, consumers only read them. A consumer may
+ * retain a frame only while it (or the one handing it over) holds a
+ * reference. Buffers start and end on cache lines, so a DMA consumer can
+ * clean a whole frame (ai_cache_clean()) without touching its neighbours;
+ * that maintenance stays with the consumer.
+ *
+ * FrameQueue: a fixed ring of frame references (history, uplink backlog)
+ * used from one context; a queued frame holds one reference.
+ */
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stdint.h>
+#include "ai_memory.h"
+
+#define FRAME_POOL_MAX_BUFFERS 32            // Bits of the free bitmap
+#define FRAME_QUEUE_MAX        16
+
+// Memory for count buffers of frame_size bytes
+#define FRAME_POOL_MEMORY(count, frame_size) ((count) * AI_CACHE_ROUND(frame_size))
+
+// Exhaustion policies
+#define FRAME_DROP_NEWEST      0             // Refuse the new frame
+#define FRAME_DROP_OLDEST      1             // Reclaim old frames (ops.reclaim) first
+
+// Return codes
+#define FRAME_OK               0
+#define FRAME_ERR_FULL        -1             // Queue full, the frame was not queued
+
+typedef struct {
+    uint8_t* data;                   // Buffer, cache-line aligned
+    uint32_t seq;                    // Acquire order, from 0
+    uint32_t timestamp_ms;           // Producer's capture time
+    uint16_t width;                  // Image the producer wrote
+    uint16_t height;
+    uint8_t channels;
+    uint8_t index;                   // Buffer number in the pool
+    volatile uint16_t refs;          // References held (atomic)
+} FrameBuffer;
+
+/*
+ * Drop policy hook (FRAME_DROP_OLDEST)
+ * reclaim() releases one frame a low-priority consumer holds and returns
+ * 1, or returns 0 when it holds none. The frame frees only if that was its
+ * last reference, so the pool calls again until a buffer frees.
+ */
+typedef struct {
+    int32_t (*reclaim)(void* user);
+    void* user;
+} FramePoolOps;
+
+typedef struct {
+    FrameBuffer frames[FRAME_POOL_MAX_BUFFERS];
+    uint32_t count;                  // Buffers
+    uint32_t frame_size;             // Bytes per buffer
+    uint8_t policy;                  // FRAME_DROP_*
+    FramePoolOps ops;
+    volatile uint32_t free;          // Bitmap of free buffers (atomic)
+    volatile uint32_t seq;           // Next frame's seq
+
+    // Statistics (atomic)
+    volatile uint32_t acquired;      // Frames handed out
+    volatile uint32_t exhausted;     // Acquires that found no buffer free
+    volatile uint32_t reclaimed;     // Frames ops.reclaim() let go of
+    volatile uint32_t dropped;       // Acquires refused
+    volatile uint32_t peak;          // Most buffers in use at once
+} FramePool;
+
+typedef struct {
+    FrameBuffer* frames[FRAME_QUEUE_MAX];
+    uint32_t depth;                  // Capacity
+    uint32_t head;                   // Frames pushed
+    uint32_t tail;                   // Frames popped or overwritten
+
+    // Statistics
+    uint32_t overwritten;            // Oldest frames pushed out of a full queue
+    uint32_t refused;                // Pushes refused (FRAME_ERR_FULL)
+} FrameQueue;
+
+/**
+ * Carve memory (cache-line aligned, memory_size bytes) into buffers of
+ * frame_size bytes, up to FRAME_POOL_MAX_BUFFERS, all free
+ * ops is copied (NULL: no reclaim hook). Returns the number of buffers.
+ */
+uint32_t frame_pool_init(FramePool* pool, uint8_t* memory, uint32_t memory_size, uint32_t frame_size,
+                         uint8_t policy, const FramePoolOps* ops);
+
+/**
+ * Take a free buffer with one reference, or NULL when the drop policy
+ * refuses the frame (ISR-safe; FRAME_DROP_OLDEST runs ops.reclaim() here)
+ */
+FrameBuffer* frame_acquire(FramePool* pool);
+
+/**
+ * One more reference to a frame the caller holds (ISR-safe)
+ */
+void frame_retain(FrameBuffer* frame);
+
+/**
+ * Drop a reference; the last one returns the buffer (ISR-safe, NULL is
+ * ignored)
+ */
+void frame_release(FramePool* pool, FrameBuffer* frame);
+
+// Buffers currently handed out
+uint32_t frame_pool_in_use(const FramePool* pool);
+
+/* ==================== QUEUES ==================== */
+
+/**
+ * Empty queue holding up to depth frames (at most FRAME_QUEUE_MAX)
+ */
+void frame_queue_init(FrameQueue* queue, uint32_t depth);
+
+/**
+ * Queue a reference to frame (retained here)
+ * A full queue releases its oldest frame when overwrite is set, otherwise
+ * the push is refused with FRAME_ERR_FULL.
+ */
+int32_t frame_queue_push(FramePool* pool, FrameQueue* queue, FrameBuffer* frame, int32_t overwrite);
+
+/**
+ * Oldest frame, or NULL; its reference passes to the caller
+ */
+FrameBuffer* frame_queue_pop(FrameQueue* queue);
+
+/**
+ * The i-th oldest queued frame (no reference taken), or NULL
+ */
+FrameBuffer* frame_queue_peek(const FrameQueue* queue, uint32_t i);
+
+static inline uint32_t frame_queue_count(const FrameQueue* queue) {
+    return queue->head - queue->tail;
+}
+
+/**
+ * Release every queued frame
+ */
+void frame_queue_clear(FramePool* pool, FrameQueue* queue);
+
+#endif // FRAME_POOL_H
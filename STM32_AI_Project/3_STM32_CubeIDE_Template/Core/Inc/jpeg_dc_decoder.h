@@ -0,0 +1,98 @@
+/*
+ * Reduced-Resolution JPEG Decoder
+ * DCT-domain decode of MJPEG camera frames straight to model input
+ *
+ * The model only needs a 32x32 view, so a full IDCT of every 8x8 block
+ * is wasted work. This decoder performs the Huffman (entropy) decode of
+ * a baseline JPEG and rebuilds the luma plane from the lowest DCT
+ * coefficients only:
+ * - JPEG_DC_SCALE_1_8: DC only, one pixel per 8x8 block
+ * - JPEG_DC_SCALE_1_4: DC + first AC terms, 2x2 pixels per 8x8 block
+ *
+ * The output is an 8-bit grayscale image that feeds
+ * preprocess_image_scaled() directly.
+ */
+
+#ifndef JPEG_DC_DECODER_H
+#define JPEG_DC_DECODER_H
+
+#include <stdint.h>
+
+#define JPEG_DC_MAX_COMPONENTS 3
+#define JPEG_DC_MAX_HUFF_TABLES 2   // Baseline limit per class (DC/AC)
+#define JPEG_DC_HUFF_LOOKUP_BITS 9
+
+// Return codes
+#define JPEG_DC_OK                 0
+#define JPEG_DC_ERR_FORMAT        -1   // Not a JPEG / corrupt headers
+#define JPEG_DC_ERR_UNSUPPORTED   -2   // Progressive, arithmetic, 12-bit...
+#define JPEG_DC_ERR_TRUNCATED     -3   // Entropy data ended early
+#define JPEG_DC_ERR_BUFFER        -4   // Output buffer too small
+
+typedef enum {
+    JPEG_DC_SCALE_1_8 = 1,   // Output pixels per block edge
+    JPEG_DC_SCALE_1_4 = 2
+} JpegDcScale;
+
+typedef struct {
+    uint16_t lookup[1 << JPEG_DC_HUFF_LOOKUP_BITS];  // (length << 8) | symbol
+    int16_t fast_ac[1 << JPEG_DC_HUFF_LOOKUP_BITS];  // (value << 8) | (run << 4) | total length
+    int32_t maxcode[18];
+    int32_t valptr[17];
+    uint8_t symbols[256];
+    uint8_t present;
+} JpegHuffTable;
+
+typedef struct {
+    uint8_t id;
+    uint8_t h_samp;
+    uint8_t v_samp;
+    uint8_t quant_table;
+    uint8_t dc_table;
+    uint8_t ac_table;
+    int32_t dc_pred;
+} JpegComponent;
+
+/*
+ * Decoder state (~10KB)
+ * Allocate statically; it is too large for a small MCU stack.
+ */
+typedef struct {
+    JpegHuffTable dc_tables[JPEG_DC_MAX_HUFF_TABLES];
+    JpegHuffTable ac_tables[JPEG_DC_MAX_HUFF_TABLES];
+    uint16_t quant[4][64];                          // Zigzag order
+    JpegComponent components[JPEG_DC_MAX_COMPONENTS];
+    uint8_t num_components;
+    uint8_t scan_components[JPEG_DC_MAX_COMPONENTS]; // Indices into components[]
+    uint8_t num_scan_components;
+    uint8_t h_max;
+    uint8_t v_max;
+    uint16_t width;
+    uint16_t height;
+    uint16_t restart_interval;
+    const uint8_t* scan_data;
+    const uint8_t* data_end;
+} JpegDcDecoder;
+
+/**
+ * Read frame dimensions without decoding
+ * Returns JPEG_DC_OK or a negative error code
+ */
+int32_t jpeg_dc_get_info(JpegDcDecoder* dec, const uint8_t* jpeg, uint32_t jpeg_size,
+                         uint16_t* width, uint16_t* height);
+
+/**
+ * Output dimensions for a given source size and scale
+ */
+void jpeg_dc_output_size(uint16_t width, uint16_t height, JpegDcScale scale,
+                         uint16_t* out_width, uint16_t* out_height);
+
+/**
+ * Decode luma at 1/8 or 1/4 scale
+ * Output: out_width * out_height grayscale pixels, row-major
+ */
+int32_t jpeg_dc_decode(JpegDcDecoder* dec, const uint8_t* jpeg, uint32_t jpeg_size,
+                       JpegDcScale scale, uint8_t* out, uint32_t out_capacity,
+                       uint16_t* out_width, uint16_t* out_height);
+
+#endif // JPEG_DC_DECODER_H
@@ -0,0 +1,118 @@
+/*
+ * Serial Link Protocol
+ * Framed, CRC-protected messages over UART / LoRa / pseudo-terminal
+ *
+ * Frame layout (little-endian):
+ *   0xA5 0x5A | type | seq | length (u16) | payload[length] | crc32
+ * The CRC covers type, seq, length and payload.
+ */
+
+#ifndef LINK_PROTOCOL_H
+#define LINK_PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LINK_SYNC0 0xA5
+#define LINK_SYNC1 0x5A
+#define LINK_MAX_PAYLOAD 256
+#define LINK_FRAME_OVERHEAD 10
+#define LINK_MAX_FRAME (LINK_MAX_PAYLOAD + LINK_FRAME_OVERHEAD)
+
+// Message types: model update (host -> device)
+#define LINK_MSG_UPD_BEGIN   0x10
+#define LINK_MSG_UPD_CHUNK   0x11
+#define LINK_MSG_UPD_QUERY   0x12
+#define LINK_MSG_UPD_COMMIT  0x13
+#define LINK_MSG_UPD_ABORT   0x14
+// Message types: model update (device -> host)
+#define LINK_MSG_UPD_STATUS  0x1F
+// Message types: configuration (detection_config.h)
+// CFG_GET: empty | CFG_SET: DetectionParams (CONFIG_WIRE_LENGTH bytes)
+// CFG_STATUS (device -> host): status u8 | pending u8 | DetectionParams
+#define LINK_MSG_CFG_GET     0x30
+#define LINK_MSG_CFG_SET     0x31
+#define LINK_MSG_CFG_STATUS  0x3F
+// Message types: benchmark sessions (dut_benchmark.h has the payloads)
+#define LINK_MSG_DUT_INFO    0x40
+#define LINK_MSG_DUT_INPUT   0x41
+#define LINK_MSG_DUT_RUN     0x42
+#define LINK_MSG_DUT_END     0x43
+#define LINK_MSG_DUT_ACK     0x4D
+#define LINK_MSG_DUT_DEVICE  0x4E
+#define LINK_MSG_DUT_RESULT  0x4F
+// Message types: telemetry (device -> fleet gateway)
+// TELEMETRY payload: frame u32 | confidence f32 | inference_ms u32 | fire u8 | alert_level u8
+#define LINK_MSG_TELEMETRY   0x20
+#define LINK_TELEMETRY_LENGTH 14
+
+typedef struct {
+    uint8_t type;
+    uint8_t seq;
+    uint16_t length;
+    uint8_t payload[LINK_MAX_PAYLOAD];
+} LinkFrame;
+
+typedef struct {
+    uint8_t state;
+    uint16_t index;
+    uint8_t crc_bytes[4];
+    LinkFrame frame;
+    uint32_t frames_ok;
+    uint32_t crc_errors;
+} LinkDecoder;
+
+void link_decoder_init(LinkDecoder* dec);
+
+/**
+ * Feed one received byte
+ * Returns 1 when dec->frame holds a complete, CRC-valid frame
+ */
+int32_t link_decoder_push(LinkDecoder* dec, uint8_t byte);
+
+/**
+ * Encode a frame into out (at least length + LINK_FRAME_OVERHEAD bytes)
+ * Returns the number of bytes written
+ */
+uint32_t link_encode(uint8_t type, uint8_t seq, const uint8_t* payload, uint16_t length,
+                     uint8_t* out);
+
+// Little-endian field helpers
+static inline void link_put_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t link_get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void link_put_f32(uint8_t* p, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    link_put_u32(p, bits);
+}
+
+static inline float link_get_f32(const uint8_t* p) {
+    uint32_t bits = link_get_u32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static inline void link_put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint16_t link_get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LINK_PROTOCOL_H
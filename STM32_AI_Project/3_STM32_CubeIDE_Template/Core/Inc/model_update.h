@@ -0,0 +1,195 @@
+/*
+ * Delta Model Updates
+ * Apply block-level binary patches into the inactive model slot while
+ * inference keeps running on the active one
+ *
+ * Patch format "FDP1" (little-endian), produced by model_delta_update.py:
+ *   Header (28 bytes):
+ *     magic "FDP1" | version u16 | block_size u16 |
+ *     base_length u32 | base_crc u32 | target_length u32 | target_crc u32 |
+ *     ops_length u32
+ *   Ops stream (ops_length bytes), rebuilding the target block by block:
+ *     COPY: 0x01 | count u16 | src_block u32   -> count blocks from the base
+ *     DATA: 0x02 | count u16 | literal bytes   -> count blocks sent in full
+ *   The last target block may be short (target_length % block_size).
+ *
+ * Blocks match the converter's layout (MODEL_BLOCK_SIZE), so a retrained
+ * model that only touches some tensors only ships those blocks.
+ *
+ * Blocks are programmed at multiples of block_size, so it must be a
+ * multiple of the flash word (MODEL_UPDATE_BLOCK_ALIGN).
+ *
+ * Transfer: LINK_MSG_UPD_* frames (link_protocol.h). Chunks carry their
+ * offset in the ops stream; the device acknowledges with the next offset
+ * it expects, so an interrupted transfer resumes where it stopped.
+ */
+
+#ifndef MODEL_UPDATE_H
+#define MODEL_UPDATE_H
+
+#include <stdint.h>
+#include "link_protocol.h"
+
+#define MODEL_PATCH_MAGIC        0x31504446u  // "FDP1"
+#define MODEL_PATCH_VERSION      1
+#define MODEL_PATCH_HEADER_SIZE  28
+#define MODEL_PATCH_OP_COPY      0x01
+#define MODEL_PATCH_OP_DATA      0x02
+#define MODEL_UPDATE_MAX_BLOCK   1024
+#define MODEL_UPDATE_BLOCK_ALIGN 32  // Block sizes are whole flash words (H7: 256 bits)
+
+// Status codes (UPD_STATUS payload byte 0)
+#define MODEL_UPD_OK             0
+#define MODEL_UPD_ERR_STATE      1   // Message not valid in this state
+#define MODEL_UPD_ERR_HEADER     2   // Bad magic/version/block size
+#define MODEL_UPD_ERR_BASE       3   // Patch was made against another model
+#define MODEL_UPD_ERR_OFFSET     4   // Gap in the chunk stream (resend from next_offset)
+#define MODEL_UPD_ERR_PATCH      5   // Malformed ops stream
+#define MODEL_UPD_ERR_FLASH      6   // Erase/write failed
+#define MODEL_UPD_ERR_VERIFY     7   // Target CRC mismatch
+#define MODEL_UPD_ERR_SIZE       8   // Target does not fit the slot
+#define MODEL_UPD_ERR_IMAGE      9   // Target is intact but cannot run (image check)
+#define MODEL_UPD_ERR_BUSY           10  // Flash erase running: retry (chunks from next_offset)
+
+typedef enum {
+    MODEL_UPD_IDLE = 0,
+    MODEL_UPD_RECEIVING,
+    MODEL_UPD_VERIFIED,       // Waiting for the frame-boundary swap
+    MODEL_UPD_FAILED
+} ModelUpdateState;
+
+/*
+ * Slot storage backend
+ * On STM32H7 the slots sit in flash bank 2, so programming does not
+ * stall code fetch from bank 1. erase() is called lazily, one
+ * erase_unit at a time, just before the first write into that unit
+ * (erase_unit = 0: erase the rest of the slot at once).
+ *
+ * Without erase_poll, erase() returns once the unit is erased. With it,
+ * erase() only starts the erase (HAL_FLASHEx_Erase_IT) and erase_poll()
+ * returns 1 while it runs, 0 once done, -1 if it failed: the updater
+ * never waits for it. Bytes that need the unit are refused with
+ * MODEL_UPD_ERR_BUSY (the sender resends from next_offset), the staged block
+ * is written by model_update_poll() or the next message once the erase
+ * completes, and the main loop keeps running frames meanwhile.
+ */
+typedef struct {
+    int32_t (*erase)(void* user, uint8_t* addr, uint32_t size);
+    int32_t (*erase_poll)(void* user);                              // Optional, see above
+    int32_t (*write)(void* user, uint8_t* dst, const uint8_t* src, uint32_t len);
+    void (*activate)(void* user, uint32_t slot, uint32_t length);  // Persist boot choice (optional)
+    uint32_t erase_unit;
+    void* user;
+} ModelFlashOps;
+
+typedef struct {
+    uint8_t* base;
+    uint32_t capacity;
+} ModelSlot;
+
+/*
+ * Non-update messages on the same link (e.g. LINK_MSG_CFG_*): encode any
+ * reply into tx (tx_capacity bytes) and return its length
+ */
+typedef uint32_t (*LinkMessageHandler)(void* user, const LinkFrame* frame, uint8_t* tx,
+                                       uint32_t tx_capacity);
+
+/*
+ * Whether a written, CRC-verified target can run (e.g.
+ * fire_detection_check_model()): 0 accepts it, anything else fails the
+ * commit with MODEL_UPD_ERR_IMAGE before the slot is activated
+ */
+typedef int32_t (*ModelImageCheck)(const uint8_t* image, uint32_t length);
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t block_size;
+    uint32_t base_length;
+    uint32_t base_crc;
+    uint32_t target_length;
+    uint32_t target_crc;
+    uint32_t ops_length;
+} ModelPatchHeader;
+
+typedef struct {
+    // Model images
+    ModelSlot slots[2];
+    const uint8_t* active_data;   // Image inference runs on
+    uint32_t active_length;
+    uint32_t active_crc;
+    int32_t active_slot;          // -1 = built-in image (never written)
+    int32_t target_slot;
+    ModelFlashOps flash;
+
+    // Patch stream
+    ModelUpdateState state;
+    ModelPatchHeader header;
+    uint32_t rx_offset;           // Next expected ops-stream byte
+    uint8_t op_header[7];
+    uint8_t op_header_fill;
+    uint32_t op_bytes_left;       // Literal bytes still to come for a DATA op
+    uint32_t write_offset;        // Target bytes produced so far
+    uint32_t erased_until;
+    uint8_t erase_pending;        // flash.erase_poll() reports the unit at erased_until
+    uint32_t target_crc;          // Running CRC of the written target
+    uint8_t block[MODEL_UPDATE_MAX_BLOCK];
+    uint32_t block_fill;
+    uint8_t block_ready;          // block is complete, waiting to be written
+    uint32_t copy_src;            // COPY op in progress: next base block
+    uint32_t copy_left;           //   and blocks still to copy
+
+    // Link
+    LinkDecoder rx;
+    LinkMessageHandler other;     // Optional, see model_update_set_handler()
+    void* other_user;
+    ModelImageCheck check;        // Optional, see model_update_set_check()
+
+    // Statistics
+    uint32_t chunks_applied;
+    uint32_t chunks_duplicate;
+    uint32_t blocks_copied;
+    uint32_t blocks_literal;
+    uint32_t swaps;
+} ModelUpdater;
+
+/**
+ * Initialize the updater
+ * active_data/active_length: image currently used for inference
+ * active_slot: index of the slot holding it, or -1 for the built-in image
+ */
+void model_update_init(ModelUpdater* upd, const uint8_t* active_data, uint32_t active_length,
+                       int32_t active_slot, const ModelSlot slots[2], const ModelFlashOps* flash);
+
+/**
+ * Handle received link bytes
+ * Any replies are encoded into tx; returns the number of bytes to send.
+ * tx must hold at least LINK_MAX_FRAME bytes per frame in rx.
+ */
+uint32_t model_update_process(ModelUpdater* upd, const uint8_t* rx, uint32_t rx_len,
+                              uint8_t* tx, uint32_t tx_capacity);
+
+/**
+ * Route the link's other message types to handler (NULL: ignore them)
+ */
+void model_update_set_handler(ModelUpdater* upd, LinkMessageHandler handler, void* user);
+
+/**
+ * Check each verified target with check before it can be swapped in and
+ * activated (NULL: CRC only)
+ */
+void model_update_set_check(ModelUpdater* upd, ModelImageCheck check);
+
+/**
+ * Main-loop hook: write blocks that waited for an asynchronous erase once
+ * it completes (no-op without flash.erase_poll)
+ */
+void model_update_poll(ModelUpdater* upd);
+
+/**
+ * Frame-boundary hook: returns 1 (and the new image) once a verified
+ * update is ready; the caller re-initializes its engine context on it.
+ */
+int32_t model_update_take_swap(ModelUpdater* upd, const uint8_t** data, uint32_t* length);
+
+#endif // MODEL_UPDATE_H
@@ -0,0 +1,186 @@
+/*
+ * Pixel Pipeline
+ * Format conversion, overlay blending, 2D copies and fills of camera
+ * frames on the DMA2D (Chrom-ART) engine, queued and asynchronous, with a
+ * bit-exact software backend for host builds and MCUs without a DMA2D
+ *
+ * Jobs are the DMA2D's own operations on rectangular areas:
+ *   COPY      area to area, same format (M2M)
+ *   CONVERT   area to area in another format (M2M_PFC)
+ *   BLEND     foreground over background into the destination (M2M_BLEND)
+ *   TINT      one color at a constant alpha over the background (M2M_BLEND,
+ *             fixed foreground color)
+ *   FILL      one color (R2M)
+ * pixel_submit() queues a job and returns at once with the DMA2D backend;
+ * the engine works through the queue from its completion interrupt while
+ * the CPU runs inference. The software backend runs each job inside
+ * pixel_submit(). Either way pixel_wait() returns once the job is done.
+ *
+ * Pixel arithmetic follows the DMA2D (RM0433 DMA2D chapter): 5/6-bit
+ * channels widen by repeating their top bits, RGB565 output truncates,
+ * RGB888 is B, G, R in memory, and blending computes
+ *   a_mult = a_fg * a_bg / 255
+ *   a_out  = a_fg + a_bg - a_mult
+ *   c_out  = (c_fg * a_fg + c_bg * a_bg - c_bg * a_mult) / a_out
+ * with integer division. pixel_selftest() runs a set of jobs through the
+ * engine and the software backend and compares them bit for bit; boards
+ * that disagree keep the software backend.
+ *
+ * The DMA2D cannot scale, write 8-bit luma or read packed YUV, so the
+ * model input is made on the CPU: pixel_resample() samples the camera
+ * frame straight into the model's resolution and channels, reading only
+ * the pixels the bilinear taps need. It does not use the queue.
+ *
+ * Images the DMA2D touches are AI_DMA_BUFFER arrays (ai_memory.h) sized
+ * with AI_CACHE_ROUND(); the pipeline does the D-cache maintenance. The
+ * CPU must not write a job's destination image until the job is done.
+ */
+
+#ifndef PIXEL_PIPELINE_H
+#define PIXEL_PIPELINE_H
+
+#include <stdint.h>
+#include "ai_memory.h"
+
+// Pixel formats (DMA2D color mode codes)
+#define PIXEL_ARGB8888         0
+#define PIXEL_RGB888           1             // B, G, R bytes
+#define PIXEL_RGB565           2
+#define PIXEL_A8               9             // Alpha only, RGB from the job's color (foreground)
+#define PIXEL_L8               0x10          // 8-bit luma (pixel_resample() only)
+#define PIXEL_YUYV             0x11          // Y0 U Y1 V, 4:2:2 (pixel_resample() only)
+
+// Job modes
+#define PIXEL_MODE_COPY        0
+#define PIXEL_MODE_CONVERT     1
+#define PIXEL_MODE_BLEND       2
+#define PIXEL_MODE_TINT        3
+#define PIXEL_MODE_FILL        4
+
+#define PIXEL_QUEUE_DEPTH      32            // Jobs in flight (a 4x4 flame map is 16 tints)
+#define PIXEL_MAX_WIDTH        16383u        // DMA2D pixels per line
+
+// Return codes
+#define PIXEL_OK               0
+#define PIXEL_ERR_JOB         -1             // Format, size or alignment the DMA2D rejects
+#define PIXEL_ERR_FULL        -2             // Queue full: wait for a ticket and retry
+
+/*
+ * One image, or an area of it: data points at the area's first pixel,
+ * stride is the image's width in pixels
+ */
+typedef struct {
+    void* data;
+    uint16_t stride;
+    uint8_t format;                  // PIXEL_*
+} PixelSurface;
+
+typedef struct {
+    uint8_t mode;                    // PIXEL_MODE_*
+    uint8_t alpha;                   // Multiplied into the foreground alpha (255: as is); TINT: the alpha
+    uint16_t width;                  // Area in pixels
+    uint16_t height;
+    PixelSurface fg;                 // Source / foreground (COPY, CONVERT, BLEND)
+    PixelSurface bg;                 // Background (BLEND, TINT); may be dst
+    PixelSurface dst;                // ARGB8888, RGB888 or RGB565
+    uint32_t color;                  // FILL / TINT: 0xAARRGGBB (TINT ignores AA); A8 foreground: its RGB
+} PixelJob;
+
+/*
+ * Engine
+ * start() programs and starts one job that pixel_check() accepted and
+ * returns 0; its completion interrupt calls pixel_complete() (nonzero
+ * status on a transfer or configuration error). A nonzero return runs
+ * that job in software instead.
+ */
+typedef struct {
+    int32_t (*start)(void* user, const PixelJob* job);
+    void* user;
+} PixelOps;
+
+typedef struct {
+    PixelOps ops;
+    int32_t hardware;                // ops.start set
+
+    PixelJob queue[PIXEL_QUEUE_DEPTH];
+    volatile uint32_t submitted;     // Tickets handed out (the last one)
+    volatile uint32_t completed;     // Jobs finished, in ticket order
+    volatile uint32_t busy;          // A job is on the engine
+
+    // Statistics
+    uint32_t jobs;
+    uint32_t pixels;
+    uint32_t fallbacks;              // Jobs the engine refused or failed, run in software
+} PixelPipeline;
+
+/**
+ * Reset the pipeline; ops NULL selects the software backend
+ * ops is copied.
+ */
+void pixel_init(PixelPipeline* pp, const PixelOps* ops);
+
+/**
+ * Surface for the area starting at (x, y) of an image width pixels wide
+ */
+PixelSurface pixel_surface(void* image, uint16_t width, uint8_t format, uint16_t x, uint16_t y);
+
+/**
+ * Validate a job against the engine's limits (both backends accept the
+ * same jobs); PIXEL_OK or PIXEL_ERR_JOB
+ */
+int32_t pixel_check(const PixelJob* job);
+
+/**
+ * Queue a job; its ticket goes to *ticket
+ * The job is copied. Returns PIXEL_OK, PIXEL_ERR_JOB or PIXEL_ERR_FULL.
+ */
+int32_t pixel_submit(PixelPipeline* pp, const PixelJob* job, uint32_t* ticket);
+
+// Whether the job with this ticket, and every job before it, has finished
+int32_t pixel_done(const PixelPipeline* pp, uint32_t ticket);
+
+// Busy-wait for a ticket
+void pixel_wait(const PixelPipeline* pp, uint32_t ticket);
+
+/**
+ * Engine completion interrupt: finish the running job, start the next
+ */
+void pixel_complete(PixelPipeline* pp, int32_t status);
+
+/**
+ * Run one job on the CPU, synchronously (the software backend)
+ * Returns PIXEL_OK or PIXEL_ERR_JOB.
+ */
+int32_t pixel_run_software(const PixelJob* job);
+
+/**
+ * Compare the engine with the software backend on a fixed set of jobs
+ * (every mode and format pair, varied alpha); returns the number of jobs
+ * whose output differs, 0 with the software backend
+ */
+uint32_t pixel_selftest(PixelPipeline* pp);
+
+/**
+ * Model input from a camera frame: bilinear resample of a width x height
+ * area to out_w x out_h, 8-bit, channels 1 (luma) or 3 (R, G, B)
+ *
+ * Same sampling as cv2.resize(INTER_LINEAR) after cv2.cvtColor() to gray
+ * or RGB (BT.601 luma; YUYV in video range), with cv2's 11-bit weights:
+ * within one level of the desktop pipeline. RGB565 widens as on the
+ * DMA2D (cv2 fills the low bits with zeros).
+ * Sources: ARGB8888, RGB888, RGB565, L8 and YUYV (even x in src).
+ * Returns PIXEL_OK or PIXEL_ERR_JOB.
+ */
+int32_t pixel_resample(const PixelSurface* src, uint16_t width, uint16_t height,
+                       uint8_t* out, uint16_t out_w, uint16_t out_h, uint32_t channels);
+
+#if defined(AI_MEMORY_TARGET)
+
+// DMA2D backend (parts with a DMA2D): PixelOps.start, and the body of
+// DMA2D_IRQHandler(). Enable the DMA2D clock and interrupt first.
+int32_t pixel_dma2d_start(void* user, const PixelJob* job);
+void pixel_dma2d_irq(PixelPipeline* pp);
+
+#endif
+
+#endif // PIXEL_PIPELINE_H
@@ -0,0 +1,133 @@
+/*
+ * Power Manager
+ * Duty-cycled operation for battery units: Stop mode between frames,
+ * event-driven wakeup, and a cheap screening stage that escalates to the
+ * full-rate CNN only on evidence
+ *
+ *   IDLE   Stop until the RTC wakeup (screen_period_ms), a PIR edge or
+ *          the smoke comparator; each wake powers the camera for one
+ *          frame and screens it (brightness statistics, no CNN)
+ *   ALERT  CNN every active_period_ms, camera streaming, Sleep between
+ *          frames; back to IDLE after hold_ms without evidence
+ *
+ * An analog threshold wake escalates directly; PIR and RTC wakes screen
+ * first. Evidence is what the caller reports after each stage (screening
+ * change, detection, rising analog channel).
+ *
+ * Interrupts only count wake events (one counter per source, written only
+ * by the interrupt), so power_wake_event() is safe from any ISR without
+ * disabling interrupts. The platform supplies a millisecond clock that
+ * keeps counting in Stop (RTC / LPTIM) and the low-power wait; scheduled
+ * wakes (POWER_WAKE_RTC) are recognized from that clock, so the RTC
+ * wakeup interrupt itself needs no call.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+
+// Wake sources
+#define POWER_WAKE_RTC         0             // Scheduled frame / screen
+#define POWER_WAKE_PIR         1             // Motion sensor edge
+#define POWER_WAKE_ANALOG      2             // Smoke comparator / rising analog channel
+#define POWER_WAKE_SOURCES     3
+#define POWER_WAKE_BIT(s)      (1u << (s))
+
+// Modes
+#define POWER_MODE_IDLE        0
+#define POWER_MODE_ALERT       1
+
+// Stage to run after a wake
+#define POWER_STAGE_NONE       0             // Early wake with nothing due: wait again
+#define POWER_STAGE_SCREEN     1
+#define POWER_STAGE_CNN        2
+
+#define POWER_SCREEN_STRIDE    4             // Screening samples every 4th pixel
+
+typedef struct {
+    uint32_t screen_period_ms;       // RTC wake interval while IDLE
+    uint32_t active_period_ms;       // CNN frame interval while ALERT
+    uint32_t hold_ms;                // ALERT kept this long after the last evidence
+    uint32_t min_stop_ms;            // Shorter waits use Sleep (Stop exit restores the PLL)
+    uint8_t bright_level;            // Screening: pixel value counted as bright
+    uint16_t bright_rise;            // Screening: new bright samples that count as evidence
+    uint8_t mean_change;             // Screening: mean level change that counts as evidence
+} PowerPolicy;
+
+/*
+ * Platform
+ * now_ms(): milliseconds, counting through Stop (wraps)
+ * wait(): low-power wait until ms elapse or a wake interrupt; deep = Stop
+ *         (clocks restored before returning), else Sleep
+ * camera(): sensor power; NULL if the camera stays powered
+ */
+typedef struct {
+    uint32_t (*now_ms)(void* user);
+    void (*wait)(void* user, uint32_t ms, int deep);
+    void (*camera)(void* user, int on);
+    void* user;
+} PowerOps;
+
+typedef struct {
+    PowerPolicy policy;
+    PowerOps ops;
+    uint8_t mode;                    // POWER_MODE_*
+    uint8_t camera_on;
+
+    // Wake events: counted by interrupts, consumed by power_wait()
+    volatile uint32_t wake_count[POWER_WAKE_SOURCES];
+    uint32_t wake_seen[POWER_WAKE_SOURCES];
+
+    uint32_t next_frame_ms;          // Next RTC-scheduled stage
+    uint32_t last_evidence_ms;
+
+    // Screening background (previous screened frame)
+    uint32_t bg_mean;
+    uint32_t bg_bright;
+    uint32_t bg_valid;
+
+    // Statistics
+    uint32_t wakeups[POWER_WAKE_SOURCES];
+    uint32_t stop_ms;                // Time in each wait kind
+    uint32_t sleep_ms;
+    uint32_t screens;
+    uint32_t cnn_frames;
+    uint32_t escalations;
+} PowerManager;
+
+/**
+ * Start in IDLE with the first screen due immediately
+ * policy: NULL for the defaults (5 s screening, 100 ms CNN, 60 s hold).
+ */
+void power_init(PowerManager* pm, const PowerPolicy* policy, const PowerOps* ops);
+
+/**
+ * Wake interrupt (PIR EXTI, comparator, analog trend): count the event
+ */
+void power_wake_event(PowerManager* pm, uint32_t source);
+
+/**
+ * Wait in the cheapest mode until the next scheduled stage or a wake
+ * event; returns the POWER_WAKE_BIT()s that ended the wait
+ */
+uint32_t power_wait(PowerManager* pm);
+
+/**
+ * Stage to run for the wake bits from power_wait() (powers the camera)
+ */
+uint8_t power_stage(PowerManager* pm, uint32_t wake);
+
+/**
+ * Screening stage on an 8-bit frame: brightness statistics against the
+ * previous screened frame; returns 1 on evidence
+ */
+int32_t power_screen_frame(PowerManager* pm, const uint8_t* image, uint32_t pixels);
+
+/**
+ * Outcome of the stage that ran: escalates on evidence, drops back to
+ * IDLE after the hold time, schedules the next stage
+ */
+void power_report(PowerManager* pm, uint8_t stage, int32_t evidence);
+
+#endif // POWER_MANAGER_H
@@ -15,31 +15,182 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "ai_engine.h"
+#include "thermal_sensor.h"
+#include "analog_sensors.h"
+#include "audio_frontend.h"
+#include "ai_memory.h"  // AI_CACHE_LINE, AI_ALIGNED, DMA buffer placement
 
+// Location head of multi-task models: square grid, up to 4x4 cells
+#define AI_LOCATION_MAX_CELLS 16
+
+// Model information structure (read-only, lives in flash)
 typedef struct {
-    uint8_t* model_data;
+    const char* model_name;
+    const char* model_version;
+    uint32_t input_width;
+    uint32_t input_height;
+    uint32_t input_channels;
+    float confidence_threshold;
+} ModelInfo;
+
+/*
+ * Engine context
+ *
+ * All mutable engine state lives here; the engine itself keeps no
+ * globals or statics. Weights and ModelInfo are only referenced, so any
+ * number of contexts can share one model and run in parallel (one per
+ * core / thread) without locking. Contexts are cache-line aligned so
+ * neighbouring instances never share a line.
+ */
+typedef struct AI_ALIGNED(AI_CACHE_LINE) {
+    const uint8_t* model_data;      // Shared, read-only
     uint32_t model_size;
-    float input_buffer[1024];
-    float output_buffer[2];
+    const ModelInfo* info;          // Shared, read-only
+    float input_buffer[AI_ENGINE_MAX_INPUT];  // Preprocessed input (models up to 32x32)
+    float output_buffer[2];         // [no_fire, fire]
+    float smoke_buffer[2];          // [no_smoke, smoke] (multi-task models)
+    float location_buffer[AI_LOCATION_MAX_CELLS];  // P(fire) per location cell, row-major
+    float fire_margin;              // Logit difference fire - no_fire (compared in logit space)
+    float smoke_margin;             // Logit difference smoke - no_smoke
+    AiHeadInfo heads[AI_ENGINE_MAX_HEADS];  // Multi-task models, else head_count 0
+    uint32_t head_count;
+    uint32_t task_mask;             // Heads to run (AI_TASK_BIT), all by default
+    uint32_t tasks_run;             // Heads behind the current outputs
+    uint32_t cam_enabled;           // Map the fire output every run (fire_detection_set_cam)
+    AiCam cam;                      // Class activation map of the current outputs
     uint32_t inference_time_ms;
+    int32_t engine_layers;          // FDM1 layer count, 0 = no engine model (mock output)
+    const struct AiGemmPool* pool;  // Workers for large layers (fire_detection_set_pool()), else NULL
+    int8_t arena[AI_ENGINE_ARENA_SIZE];  // Engine activations (ping-pong) + temporal state
 } FireDetectionModel;
 
-// Initialize model
+// Initialize model (built-in model_data / model_info)
 int32_t fire_detection_init(FireDetectionModel* model);
 
+// Initialize a context on an explicit read-only model image; -1 leaves
+// the context unchanged (a rejected update keeps the running model)
+int32_t fire_detection_init_model(FireDetectionModel* model, const uint8_t* data,
+                                  uint32_t size, const ModelInfo* info);
+
+// Whether init would accept an image (engine checks, arena fit, heads /
+// output count): 0 or -1, without a context
+int32_t fire_detection_check_model(const uint8_t* data, uint32_t size);
+
+// sizeof(FireDetectionModel), for hosts allocating contexts through an FFI
+uint32_t fire_detection_context_size(void);
+
+// Heads to run from the next frame on (AI_TASK_BIT mask; AI_TASKS_ALL by
+// default). Skipping e.g. the location head on quiet frames saves its
+// layers; the shared backbone always runs.
+void fire_detection_set_tasks(FireDetectionModel* model, uint32_t task_mask);
+
+// Compute the class activation map of the fire output with each inference
+// (from the next frame on; init turns it off). Returns -1 when enabling it
+// on a model whose fire output cannot be mapped (ai_engine_cam_check()).
+int32_t fire_detection_set_cam(FireDetectionModel* model, int32_t enable);
+
+// Split large layers of each inference over a worker pool (hosts, e.g.
+// Host/ai_thread_pool.h; NULL: run on the caller alone). Init clears it.
+// Returns -1 when the pool's scratch is too small for the model
+// (ai_engine_worker_scratch_size()). One context at a time per pool.
+int32_t fire_detection_set_pool(FireDetectionModel* model, const struct AiGemmPool* pool);
+
+// Forget the frame history of a model's temporal layers (AI_OP_TEMPORAL_CONV),
+// e.g. after a camera switch; init and model swaps reset it already
+void fire_detection_reset_state(FireDetectionModel* model);
+
 // Preprocessing
 void preprocess_image(uint8_t* raw_image, uint32_t raw_size, float* normalized_image);
 
-// Inference
+// Bilinear resize of a grayscale frame (e.g. jpeg_dc_decode() output) to
+// the model's input + normalize into capacity floats (AI_ENGINE_MAX_INPUT
+// for input_buffer); -1 if the model's input does not fit
+int32_t preprocess_image_scaled(const FireDetectionModel* model, const uint8_t* image, uint32_t width,
+                                uint32_t height, float* normalized_image, uint32_t capacity);
+
+// Inference on input_buffer
 float fire_detection_inference(FireDetectionModel* model);
 
+// Inference on an 8-bit frame at the model's input resolution (any size up
+// to AI_ENGINE_MAX_IMAGE pixels); normalization is folded into the engine
+float fire_detection_inference_image(FireDetectionModel* model, const uint8_t* image);
+
+/*
+ * Decision thresholds
+ *
+ * Probabilities as configured; the logit fields are derived from them by
+ * detection_thresholds_derive() (off the hot path). For a two-class
+ * softmax, p(1) > t exactly when logit1 - logit0 > ln(t / (1 - t)), so
+ * decisions compare the margins without going back through expf / logf.
+ * NULL wherever a const DetectionThresholds* is taken: the defaults.
+ */
+typedef struct {
+    float fire;                     // P(fire) for a detection (0.7)
+    float critical;                 // P(fire) for alert level 2 (0.9)
+    float smoke;                    // P(smoke) for smoke_detected (0.7)
+    float crackle;                  // Classifier output for crackle_detected (AUDIO_CRACKLE_THRESHOLD)
+    float promote_thermal;          // Borderline P(fire) a hot spot promotes to a detection (0.4)
+    float promote_analog;           // ... an analog alarm (0.5)
+    float promote_audio;            // ... crackle (0.5)
+    // Derived
+    float fire_logit;
+    float critical_logit;
+    float smoke_logit;
+} DetectionThresholds;
+
+// Built-in thresholds (the NULL default)
+extern const DetectionThresholds detection_default_thresholds;
+
+// Recompute the logit-space fields from the probabilities (each in (0, 1))
+void detection_thresholds_derive(DetectionThresholds* th);
+
 // Postprocessing
 typedef struct {
     int fire_detected;
     float confidence;
     int alert_level;
+    // Multi-task models; 0 when the model has no such head or it was skipped
+    int smoke_detected;
+    float smoke_confidence;
+    int location_valid;             // Location head ran on a fire frame
+    uint8_t location_x;             // Most likely cell of the location grid
+    uint8_t location_y;
+    uint8_t location_grid;          // Cells per side
+    float location_confidence;
+    // Class activation map (fire_detection_set_cam()) on a fire frame
+    int cam_valid;
+    uint8_t cam_heat[AI_CAM_CELLS]; // Fire evidence per cell, row-major, 255 = strongest cell
+    uint16_t cam_peak_x;            // Strongest feature map position, input pixels
+    uint16_t cam_peak_y;
+    // Thermal fusion (fire_detection_fuse_thermal)
+    float temperature_estimate;     // Hottest pixel, C
+    int thermal_hot;                // Hot spot confirms the detection
+    // Analog fusion (fire_detection_fuse_analog)
+    int analog_level;               // ANALOG_QUIET / WATCH / ALARM
+    // Audio fusion (fire_detection_fuse_audio)
+    float crackle_confidence;       // Crackle classifier output
+    int crackle_detected;
 } DetectionResult;
 
-DetectionResult process_detection_output(FireDetectionModel* model);
+DetectionResult process_detection_output(FireDetectionModel* model, const DetectionThresholds* th);
+
+// Fuse a thermal frame into a vision result (camera and array share the
+// field of view): a hot spot where the model sees fire - inside the
+// location cell when the location head ran - raises the alert to 2 (it never
+// lowers the vision level), and strong heat promotes a borderline frame
+void fire_detection_fuse_thermal(DetectionResult* result, const ThermalHotspots* spots,
+                                 const DetectionThresholds* th);
+
+// Fuse the analog smoke / CO / temperature decision: rising channels
+// alongside a vision detection make it critical, and an analog alarm
+// promotes a borderline frame
+void fire_detection_fuse_analog(DetectionResult* result, const AnalogDecision* decision,
+                                const DetectionThresholds* th);
+
+// Fuse the latest crackle classifier output (audio_frontend.h features):
+// crackle alongside a vision detection makes it critical, and crackle
+// promotes a borderline frame
+void fire_detection_fuse_audio(DetectionResult* result, float crackle, const DetectionThresholds* th);
 
 #endif // STM32_AI_FRAMEWORK_H
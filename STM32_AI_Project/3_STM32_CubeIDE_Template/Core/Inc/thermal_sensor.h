@@ -0,0 +1,167 @@
+/*
+ * Thermal Array Front-End
+ * 32x24 IR array (MLX90640-style) read by I2C DMA, converted to
+ * temperatures in fixed point, reduced to a hot-spot map for fusion
+ *
+ * The vendor conversion runs a chain of float formulas per pixel (gain,
+ * offset with Ta / Vdd drift, emissivity, sensitivity, fourth root). All
+ * of it except the fourth root is linear in the raw count for a given
+ * ambient and supply, so thermal_init() folds it into two fixed-point
+ * coefficients per pixel:
+ *
+ *   R = (raw * scale[i] + bias[i]) >> THERMAL_COEFF_BITS   radiance, K^4 / 2^20
+ *   T = lut(R + R_ambient)                                 0.1 C, interpolated
+ *
+ * i.e. one 64-bit multiply-add per pixel plus a shared table lookup for
+ * the fourth root. The coefficients are rebuilt (float, once) only when
+ * the ambient or supply drifts by more than THERMAL_RECAL_TA_C /
+ * THERMAL_RECAL_VDD_V from the conditions they were built for.
+ *
+ * Frame layout (one DMA read of sensor RAM from THERMAL_RAM_ADDR,
+ * big-endian 16-bit words): THERMAL_PIXELS signed pixel words row-major,
+ * then the auxiliary words. Ambient and supply come from the aux words as
+ * Ta in 1/64 C (THERMAL_AUX_TA) and Vdd in mV (THERMAL_AUX_VDD); on a
+ * real MLX90640 port its PTAT / VBE and Vdd formulas into
+ * thermal_decode_aux() - they run once per frame, not per pixel.
+ *
+ * Calibration comes from the sensor EEPROM through the vendor's
+ * parameter extraction, copied into ThermalCalibration.
+ */
+
+#ifndef THERMAL_SENSOR_H
+#define THERMAL_SENSOR_H
+
+#include <stdint.h>
+
+#define THERMAL_WIDTH          32
+#define THERMAL_HEIGHT         24
+#define THERMAL_PIXELS         (THERMAL_WIDTH * THERMAL_HEIGHT)
+#define THERMAL_FRAME_WORDS    832           // Pixels + 64 aux words
+#define THERMAL_FRAME_BYTES    (2 * THERMAL_FRAME_WORDS)
+#define THERMAL_RAM_ADDR       0x0400        // Sensor RAM start (I2C register)
+#define THERMAL_AUX_TA         (THERMAL_PIXELS + 0x20)   // Word index: Ta, 1/64 C
+#define THERMAL_AUX_VDD        (THERMAL_PIXELS + 0x2A)   // Word index: Vdd, mV
+
+// Fixed point: coefficients in Q16, radiance in K^4 / 2^20
+#define THERMAL_COEFF_BITS     16
+#define THERMAL_RADIANCE_BITS  20
+#define THERMAL_LUT_BITS       10            // 1024 segments of the fourth-root table
+#define THERMAL_LUT_SHIFT      9             // Radiance units per segment: 2^9 (up to ~590 C)
+
+#define THERMAL_RECAL_TA_C     0.5f          // Ambient drift that rebuilds the coefficients
+#define THERMAL_RECAL_VDD_V    0.01f
+#define THERMAL_HOT_DC         600           // Default hot-pixel threshold, 0.1 C (60 C)
+#define THERMAL_FIRE_DC        1500          // Heat that corroborates a weak detection (150 C)
+#define THERMAL_MIN_HOT_PIXELS 2             // Smaller hot spots are treated as noise
+
+// Return codes
+#define THERMAL_OK             0
+#define THERMAL_ERR_CALIBRATION -1           // Coefficients out of fixed-point range
+#define THERMAL_ERR_BUS        -2            // DMA read could not start
+#define THERMAL_ERR_BUSY       -3            // A read is already in flight
+
+// Vendor calibration parameters (float, from the sensor EEPROM)
+typedef struct {
+    float gain;                      // Raw count -> compensated count
+    float emissivity;
+    float ta_ref;                    // Conditions offsets were measured at (25 C, 3.3 V)
+    float vdd_ref;
+    int16_t offset[THERMAL_PIXELS];  // Counts
+    float alpha[THERMAL_PIXELS];     // Sensitivity: compensated counts per K^4
+    float kta[THERMAL_PIXELS];       // Offset drift per C of ambient
+    float kv[THERMAL_PIXELS];        // Offset drift per V of supply
+} ThermalCalibration;
+
+/*
+ * Sensor bus
+ * read_dma() starts a DMA read of len bytes from register reg into dst and
+ * returns 0; its completion interrupt calls thermal_dma_complete().
+ */
+typedef struct {
+    int32_t (*read_dma)(void* user, uint16_t reg, uint8_t* dst, uint16_t len);
+    void* user;
+} ThermalBusOps;
+
+// Result of one frame
+typedef struct {
+    int16_t max_dc;                  // Hottest pixel, 0.1 C
+    int16_t ambient_dc;              // Sensor ambient, 0.1 C
+    uint8_t max_x, max_y;
+    uint16_t hot_pixels;             // Pixels at or above the hot threshold
+    uint8_t hot_map[THERMAL_PIXELS / 8];  // One bit per pixel, row-major, LSB first
+    uint32_t frame;
+} ThermalHotspots;
+
+/*
+ * Sensor state (~14KB)
+ * Allocate statically, AI_DMA_BUFFER (ai_memory.h) on the M7. The two raw
+ * buffers are cache-line aligned; thermal_start_read() and
+ * thermal_dma_complete() do the D-cache maintenance for them.
+ */
+typedef struct {
+    ThermalBusOps bus;
+    const ThermalCalibration* cal;
+
+    // Fixed-point conversion
+    int32_t scale[THERMAL_PIXELS];   // Q16 radiance units per count
+    int32_t bias[THERMAL_PIXELS];    // Q16 radiance units
+    int16_t lut[(1 << THERMAL_LUT_BITS) + 1];  // 0.1 C at radiance i << THERMAL_LUT_SHIFT
+    float coeff_ta;                  // Conditions the coefficients were built for
+    float coeff_vdd;
+
+    // Double-buffered frames: DMA fills one while the other is converted
+    uint8_t raw[2][THERMAL_FRAME_BYTES] __attribute__((aligned(32)));
+    uint8_t dma_buffer;              // Buffer the current read fills
+    volatile uint8_t busy;           // Read in flight
+    volatile uint8_t ready_buffer;   // Last completed buffer (written by the ISR only)
+    volatile uint32_t completed;     // Reads completed (ISR) ...
+    uint32_t processed;              // ... and converted (main loop)
+
+    int16_t temps[THERMAL_PIXELS];   // Latest frame, 0.1 C
+    ThermalHotspots spots;
+    int16_t hot_threshold_dc;
+
+    // Statistics
+    uint32_t frames;
+    uint32_t recalibrations;
+    uint32_t overruns;               // Frames replaced before they were processed
+} ThermalSensor;
+
+/**
+ * Build the temperature table and per-pixel coefficients (at the
+ * calibration's reference ambient / supply until the first frame)
+ * cal is referenced, not copied. bus may be NULL for offline conversion
+ * (thermal_convert_frame() only).
+ */
+int32_t thermal_init(ThermalSensor* sensor, const ThermalCalibration* cal, const ThermalBusOps* bus);
+
+/**
+ * Start reading the next frame (call at the sensor's refresh rate)
+ * Returns THERMAL_OK, THERMAL_ERR_BUSY or THERMAL_ERR_BUS.
+ */
+int32_t thermal_start_read(ThermalSensor* sensor);
+
+/**
+ * DMA completion (interrupt context): hands the filled buffer over
+ */
+void thermal_dma_complete(ThermalSensor* sensor);
+
+/**
+ * Convert a completed frame, if any; returns 1 when sensor->temps and
+ * sensor->spots were updated
+ */
+int32_t thermal_process(ThermalSensor* sensor);
+
+/**
+ * Convert one raw frame (THERMAL_FRAME_BYTES, sensor layout) into
+ * sensor->temps and sensor->spots
+ */
+void thermal_convert_frame(ThermalSensor* sensor, const uint8_t* raw);
+
+/**
+ * Hot pixels of the last frame inside [x0, x1) x [y0, y1)
+ */
+uint32_t thermal_hot_in_region(const ThermalHotspots* spots, uint32_t x0, uint32_t y0,
+                               uint32_t x1, uint32_t y1);
+
+#endif // THERMAL_SENSOR_H
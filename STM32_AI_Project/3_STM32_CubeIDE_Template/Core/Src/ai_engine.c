@@ -0,0 +1,1207 @@
+/*
+ * Int8 Inference Engine
+ * Layer interpreter: conv/dense on the GEMM core, pooling in plain C,
+ * bit-exact with engine_model.py
+ */
+
+#include "ai_engine.h"
+#include "ai_gemm.h"
+#include "ai_profile.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(AI_PROFILE)
+/**
+ * Profiling mark (ai_profile.h): the emulator counts at this entry and
+ * reads id from r0; noipa keeps every call a real call
+ */
+__attribute__((noipa)) void ai_profile_mark(uint32_t id) {
+    __asm__ volatile("" : : "r"(id) : "memory");
+}
+#endif
+
+/* ==================== MODEL ACCESS ==================== */
+
+// The image may sit at any address (flash array, update slot), so
+// multi-byte fields are copied out instead of dereferenced
+static inline int32_t read_i32(const uint8_t* p) {
+    int32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void read_layer(const uint8_t* model, uint32_t index, AiLayer* layer) {
+    memcpy(layer, model + AI_ENGINE_HEADER_SIZE + index * AI_ENGINE_LAYER_SIZE, sizeof(*layer));
+}
+
+static inline uint32_t tensor_size(uint32_t w, uint32_t h, uint32_t c) {
+    return w * h * c;
+}
+
+static int32_t tensor_in_bounds(uint32_t offset, uint32_t bytes, uint32_t size) {
+    return offset <= size && bytes <= size - offset;
+}
+
+/**
+ * Row buffer of a fused conv + pool layer producing out_w pooled columns
+ * (two conv rows); 0 for other ops
+ */
+static inline uint32_t pool_rows_size(const AiLayer* l, uint32_t out_w) {
+    return (l->op == AI_OP_CONV2D_3X3_POOL) ? tensor_size(2u * out_w, 2u, l->out_c) : 0;
+}
+
+/**
+ * Largest compressed w x h x c map: the row table plus every row stored
+ * as is
+ */
+static inline uint32_t sparse_size(uint32_t w, uint32_t h, uint32_t c) {
+    return 4u * (h + 1u) + tensor_size(w, h, c);
+}
+
+/**
+ * Input rows a layer decodes from a compressed map at a time (0: dense
+ * reads it row by row straight into its A panel)
+ */
+static inline uint32_t window_height(uint32_t op) {
+    if (op == AI_OP_CONV2D_3X3) return 3u;
+    if (op == AI_OP_CONV2D_3X3_POOL) return 4u;
+    if (op == AI_OP_MAXPOOL_2X2) return 2u;
+    return 0;
+}
+
+/**
+ * Work bytes of a layer reading and/or writing compressed maps, kept
+ * between its input and output: the decoded input rows, then one output
+ * row before it is compressed
+ */
+static inline uint32_t sparse_work_size(const AiLayer* l, int32_t in_sparse, int32_t out_sparse) {
+    uint32_t bytes = in_sparse ? tensor_size(l->in_w, window_height(l->op), l->in_c) : 0;
+    return bytes + (out_sparse ? tensor_size(l->out_w, 1u, l->out_c) : 0);
+}
+
+typedef struct {
+    uint32_t x, y, w, h;
+} Region;
+
+/**
+ * Windows of the patched stage for one tile
+ * regions[i] is layer i's input window, regions[patch_layers] the tile
+ */
+static void patch_regions(const uint8_t* model, const AiModelHeader* h, uint32_t tile,
+                          Region* regions) {
+    const uint32_t g = h->patch_grid, tx = tile % g, ty = tile / g;
+    AiLayer l;
+
+    read_layer(model, h->patch_layers - 1u, &l);
+    Region r = { tx * l.out_w / g, ty * l.out_h / g, 0, 0 };
+    r.w = (tx + 1) * l.out_w / g - r.x;
+    r.h = (ty + 1) * l.out_h / g - r.y;
+    regions[h->patch_layers] = r;
+
+    for (uint32_t i = h->patch_layers; i-- > 0;) {
+        read_layer(model, i, &l);
+        if (l.op != AI_OP_CONV2D_3X3) {
+            r.x *= 2;
+            r.y *= 2;
+            r.w *= 2;
+            r.h *= 2;
+        }
+        if (l.op != AI_OP_MAXPOOL_2X2) {
+            // Conv: 1-pixel halo on every side that borders more of the image
+            uint32_t x1 = (r.x + r.w < l.in_w) ? r.x + r.w + 1 : l.in_w;
+            uint32_t y1 = (r.y + r.h < l.in_h) ? r.y + r.h + 1 : l.in_h;
+            r.x = r.x ? r.x - 1 : 0;
+            r.y = r.y ? r.y - 1 : 0;
+            r.w = x1 - r.x;
+            r.h = y1 - r.y;
+        }
+        regions[i] = r;
+    }
+}
+
+/**
+ * Largest tile ping-pong (input + output window of one layer) of the stage
+ */
+static uint32_t patch_pingpong_size(const uint8_t* model, const AiModelHeader* h) {
+    Region regions[AI_ENGINE_MAX_PATCH_LAYERS + 1];
+    uint32_t need = 0;
+
+    for (uint32_t t = 0; t < (uint32_t)h->patch_grid * h->patch_grid; t++) {
+        patch_regions(model, h, t, regions);
+        for (uint32_t i = 0; i < h->patch_layers; i++) {
+            AiLayer l;
+            read_layer(model, i, &l);
+            uint32_t bytes = tensor_size(regions[i].w, regions[i].h, l.in_c) +
+                             tensor_size(regions[i + 1].w, regions[i + 1].h, l.out_c) +
+                             pool_rows_size(&l, regions[i + 1].w);
+            if (bytes > need) need = bytes;
+        }
+    }
+    return need;
+}
+
+/**
+ * Index of the first AI_OP_HEAD record at or after first (layer_count if none)
+ */
+static uint32_t next_head(const uint8_t* model, const AiModelHeader* h, uint32_t first) {
+    for (uint32_t i = first; i < h->layer_count; i++) {
+        AiLayer l;
+        read_layer(model, i, &l);
+        if (l.op == AI_OP_HEAD) return i;
+    }
+    return h->layer_count;
+}
+
+/**
+ * Head table (up to max entries; heads may be NULL); returns the head count
+ */
+static uint32_t scan_heads(const uint8_t* model, AiHeadInfo* heads, uint32_t max) {
+    AiModelHeader h;
+    uint32_t count = 0, offset = 0;
+
+    memcpy(&h, model, sizeof(h));
+    if (!(h.flags & AI_MODEL_FLAG_HEADS)) return 0;
+
+    for (uint32_t i = next_head(model, &h, 0); i < h.layer_count; count++) {
+        AiLayer head, last;
+        uint32_t end = next_head(model, &h, i + 1u);
+        read_layer(model, i, &head);
+        read_layer(model, end - 1u, &last);
+
+        uint32_t values = tensor_size(last.out_w, last.out_h, last.out_c);
+        if (heads && count < max) {
+            AiHeadInfo info = { head.activation, (uint8_t)i, (uint16_t)offset, (uint16_t)values, 0 };
+            heads[count] = info;
+        }
+        offset += values;
+        i = end;
+    }
+    return count;
+}
+
+/**
+ * GEMM depth of a conv/dense layer (0 for other ops)
+ */
+static uint32_t gemm_depth(const AiLayer* l) {
+    if (l->op == AI_OP_CONV2D_3X3 || l->op == AI_OP_CONV2D_3X3_POOL) return 9u * l->in_c;
+    if (l->op == AI_OP_DENSE || l->op == AI_OP_TEMPORAL_CONV) return tensor_size(l->in_w, l->in_h, l->in_c);
+    return 0;
+}
+
+/**
+ * Bytes of a layer's input in the activations: a temporal layer reads one
+ * frame's embedding, its window of in_h frames lives in the state area
+ */
+static uint32_t input_size(const AiLayer* l) {
+    return (l->op == AI_OP_TEMPORAL_CONV) ? l->in_c : tensor_size(l->in_w, l->in_h, l->in_c);
+}
+
+/**
+ * Whether layer i (l) stores its output compressed (AI_MODEL_FLAG_SPARSE):
+ * past the patched stage, a ReLU conv, or a max pool of a compressed map,
+ * feeding a conv, max pool or dense layer
+ */
+static int32_t sparse_output(const uint8_t* model, const AiModelHeader* h, uint32_t i, const AiLayer* l,
+                             int32_t in_sparse) {
+    AiLayer next;
+
+    if (!(h->flags & AI_MODEL_FLAG_SPARSE) || i + 1u >= h->layer_count) return 0;
+    if ((h->flags & AI_MODEL_FLAG_PATCHED) && i < h->patch_layers) return 0;
+    int32_t relu = (l->op == AI_OP_CONV2D_3X3 || l->op == AI_OP_CONV2D_3X3_POOL) &&
+                   l->activation == AI_ACT_RELU;
+    if (!relu && !(l->op == AI_OP_MAXPOOL_2X2 && in_sparse)) return 0;
+
+    read_layer(model, i + 1u, &next);
+    return next.op == AI_OP_CONV2D_3X3 || next.op == AI_OP_CONV2D_3X3_POOL ||
+           next.op == AI_OP_MAXPOOL_2X2 || next.op == AI_OP_DENSE;
+}
+
+/**
+ * GEMM scratch of a layer: its A panel, plus the live-step list when
+ * zero skipping may run (AI_MODEL_FLAG_SPARSE); 0 for ops without a GEMM
+ */
+static uint32_t layer_scratch_size(const AiLayer* l, uint32_t flags) {
+    uint32_t k = gemm_depth(l);
+    if (!k) return 0;
+    return ai_gemm_scratch_size(k) + ((flags & AI_MODEL_FLAG_SPARSE) ? ai_gemm_skip_size(k) : 0);
+}
+
+/**
+ * Offset of the first temporal window at or after layer index end in the
+ * state area (the state size for end = layer_count)
+ */
+static uint32_t state_offset(const uint8_t* model, uint32_t end) {
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < end; i++) {
+        AiLayer l;
+        read_layer(model, i, &l);
+        if (l.op == AI_OP_TEMPORAL_CONV) offset += tensor_size(l.in_w, l.in_h, l.in_c);
+    }
+    return offset;
+}
+
+/* ==================== VALIDATION ==================== */
+
+static int32_t check_layer(const AiLayer* l, uint32_t size, uint32_t flags) {
+    uint32_t k = gemm_depth(l);
+
+    switch (l->op) {
+        case AI_OP_CONV2D_3X3:
+            if (l->out_w != l->in_w || l->out_h != l->in_h) return AI_ENGINE_ERR_FORMAT;
+            break;
+        case AI_OP_CONV2D_3X3_POOL:
+            if (l->out_w != l->in_w / 2 || l->out_h != l->in_h / 2 || l->out_w == 0 || l->out_h == 0) {
+                return AI_ENGINE_ERR_FORMAT;
+            }
+            break;
+        case AI_OP_DENSE:
+            if (l->out_w != 1 || l->out_h != 1) return AI_ENGINE_ERR_FORMAT;
+            break;
+        case AI_OP_TEMPORAL_CONV:
+            if (l->out_w != 1 || l->out_h != 1 || l->in_w != 1 || l->in_h < 2u ||
+                l->in_h > AI_ENGINE_MAX_TAPS) {
+                return AI_ENGINE_ERR_FORMAT;
+            }
+            break;
+        case AI_OP_MAXPOOL_2X2:
+            if (l->out_w != l->in_w / 2 || l->out_h != l->in_h / 2 || l->out_c != l->in_c ||
+                l->out_w == 0 || l->out_h == 0) {
+                return AI_ENGINE_ERR_FORMAT;
+            }
+            return AI_ENGINE_OK;
+        case AI_OP_GLOBAL_AVGPOOL:
+            if (l->out_w != 1 || l->out_h != 1 || l->out_c != l->in_c) return AI_ENGINE_ERR_FORMAT;
+            return AI_ENGINE_OK;
+        default:
+            return AI_ENGINE_ERR_FORMAT;
+    }
+
+    uint32_t weights = (flags & AI_MODEL_FLAG_PACKED_B) ? ai_gemm_packed_size(l->out_c, k)
+                                                        : (uint32_t)l->out_c * k;
+    if (!tensor_in_bounds(l->weights_offset, weights, size) ||
+        !tensor_in_bounds(l->bias_offset, 4u * l->out_c, size) ||
+        !tensor_in_bounds(l->quant_offset, 8u * l->out_c, size)) {
+        return AI_ENGINE_ERR_FORMAT;
+    }
+    if (l->activation > AI_ACT_LUT ||
+        (l->activation == AI_ACT_LUT && !tensor_in_bounds(l->lut_offset, AI_ACT_LUT_SIZE, size))) {
+        return AI_ENGINE_ERR_FORMAT;
+    }
+    return AI_ENGINE_OK;
+}
+
+int32_t ai_engine_check(const uint8_t* model, uint32_t size, uint32_t arena_capacity,
+                        AiModelHeader* header) {
+    AiModelHeader h;
+
+    if (!model || size < AI_ENGINE_HEADER_SIZE) return AI_ENGINE_ERR_FORMAT;
+    memcpy(&h, model, sizeof(h));
+
+    if (h.magic != AI_ENGINE_MAGIC || h.version != AI_ENGINE_VERSION || h.layer_count == 0 ||
+        AI_ENGINE_HEADER_SIZE + (uint32_t)h.layer_count * AI_ENGINE_LAYER_SIZE > size) {
+        return AI_ENGINE_ERR_FORMAT;
+    }
+    if (h.flags & ~(uint32_t)(AI_MODEL_FLAG_PACKED_B | AI_MODEL_FLAG_PATCHED | AI_MODEL_FLAG_HEADS |
+                              AI_MODEL_FLAG_SPARSE)) {
+        return AI_ENGINE_ERR_FORMAT;
+    }
+    uint32_t patched = (h.flags & AI_MODEL_FLAG_PATCHED) ? h.patch_layers : 0;
+    if ((h.flags & AI_MODEL_FLAG_PATCHED) &&
+        (patched == 0 || patched >= h.layer_count || patched > AI_ENGINE_MAX_PATCH_LAYERS ||
+         h.patch_grid == 0)) {
+        return AI_ENGINE_ERR_FORMAT;
+    }
+    if (tensor_size(h.input_w, h.input_h, h.input_c) > AI_ENGINE_MAX_IMAGE) return AI_ENGINE_ERR_SHAPE;
+
+    uint32_t w = h.input_w, hh = h.input_h, c = h.input_c;
+    uint32_t scratch = 0;
+    uint32_t state = 0;
+    uint32_t outputs = 0;
+    // Heads: backbone output shape (set at the first head record), tasks seen
+    uint32_t bw = 0, bh = 0, bc = 0, backbone = 0, tasks = 0, heads = 0, head_at = 0;
+    int32_t in_sparse = 0;  // The previous layer's output is compressed
+    for (uint32_t i = 0; i < h.layer_count; i++) {
+        AiLayer l;
+        read_layer(model, i, &l);
+
+        if (l.op == AI_OP_HEAD) {
+            // Each head starts from the backbone output, has its own task and
+            // at least one layer; patching stays within the backbone
+            if (!(h.flags & AI_MODEL_FLAG_HEADS) || i == 0 || i < patched || (heads && i == head_at + 1u) ||
+                i + 1u >= h.layer_count || l.activation >= AI_TASK_COUNT ||
+                (tasks & AI_TASK_BIT(l.activation)) || heads == AI_ENGINE_MAX_HEADS ||
+                !tensor_in_bounds(l.quant_offset, 8u, size)) {
+                return AI_ENGINE_ERR_FORMAT;
+            }
+            if (heads) {
+                outputs += tensor_size(w, hh, c);
+            } else {
+                bw = w;
+                bh = hh;
+                bc = c;
+                backbone = tensor_size(w, hh, c);
+            }
+            if (l.in_w != bw || l.in_h != bh || l.in_c != bc ||
+                l.out_w != bw || l.out_h != bh || l.out_c != bc) {
+                return AI_ENGINE_ERR_FORMAT;
+            }
+            tasks |= AI_TASK_BIT(l.activation);
+            heads++;
+            head_at = i;
+            w = bw;
+            hh = bh;
+            c = bc;
+            in_sparse = 0;
+            continue;
+        }
+
+        // Each layer consumes exactly what the previous one produced (a
+        // temporal layer one frame of its window)
+        uint32_t in_h = (l.op == AI_OP_TEMPORAL_CONV) ? 1u : l.in_h;
+        if (l.in_w != w || in_h != hh || l.in_c != c) return AI_ENGINE_ERR_FORMAT;
+        int32_t status = check_layer(&l, size, h.flags);
+        if (status != AI_ENGINE_OK) return status;
+        if (l.op == AI_OP_TEMPORAL_CONV) state += tensor_size(l.in_w, l.in_h, l.in_c);
+
+        if (layer_scratch_size(&l, h.flags) > scratch) scratch = layer_scratch_size(&l, h.flags);
+
+        // Patched layers only ever hold tiles (checked below); head layers
+        // run above the backbone output; compressed maps at their largest
+        int32_t out_sparse = sparse_output(model, &h, i, &l, in_sparse);
+        uint32_t in_bytes = (in_sparse ? sparse_size(l.in_w, l.in_h, l.in_c) : input_size(&l)) + backbone;
+        uint32_t out_bytes = (out_sparse ? sparse_size(l.out_w, l.out_h, l.out_c)
+                                         : tensor_size(l.out_w, l.out_h, l.out_c)) +
+                             pool_rows_size(&l, l.out_w) + sparse_work_size(&l, in_sparse, out_sparse);
+        if (i < patched) {
+            if (l.op != AI_OP_CONV2D_3X3 && l.op != AI_OP_MAXPOOL_2X2 && l.op != AI_OP_CONV2D_3X3_POOL) {
+                return AI_ENGINE_ERR_FORMAT;
+            }
+        } else if (in_bytes + out_bytes > h.arena_size) {
+            return AI_ENGINE_ERR_ARENA;
+        }
+
+        w = l.out_w;
+        hh = l.out_h;
+        c = l.out_c;
+        in_sparse = out_sparse;
+    }
+    if ((h.flags & AI_MODEL_FLAG_HEADS) && heads == 0) return AI_ENGINE_ERR_FORMAT;
+    outputs += tensor_size(w, hh, c);
+    if (outputs > AI_ENGINE_MAX_OUTPUT) return AI_ENGINE_ERR_SHAPE;
+
+    if (patched) {
+        AiLayer last;
+        read_layer(model, patched - 1u, &last);
+        if (h.patch_grid > last.out_w || h.patch_grid > last.out_h) return AI_ENGINE_ERR_FORMAT;
+        uint32_t map = tensor_size(last.out_w, last.out_h, last.out_c);
+        if (map + patch_pingpong_size(model, &h) > h.arena_size) return AI_ENGINE_ERR_ARENA;
+    }
+    if (h.arena_size > arena_capacity || scratch > arena_capacity - h.arena_size ||
+        state > arena_capacity - h.arena_size - scratch) {
+        return AI_ENGINE_ERR_ARENA;
+    }
+
+    if (header) *header = h;
+    return h.layer_count;
+}
+
+uint32_t ai_engine_output_count(const uint8_t* model) {
+    AiModelHeader h;
+    AiLayer last;
+    AiHeadInfo heads[AI_ENGINE_MAX_HEADS];
+
+    uint32_t n = scan_heads(model, heads, AI_ENGINE_MAX_HEADS);
+    if (n) return heads[n - 1u].offset + heads[n - 1u].count;
+
+    memcpy(&h, model, sizeof(h));
+    read_layer(model, h.layer_count - 1u, &last);
+    return tensor_size(last.out_w, last.out_h, last.out_c);
+}
+
+uint32_t ai_engine_heads(const uint8_t* model, AiHeadInfo* heads, uint32_t max) {
+    return scan_heads(model, heads, max);
+}
+
+uint32_t ai_engine_scratch_size(const uint8_t* model) {
+    AiModelHeader h;
+    uint32_t scratch = 0;
+
+    memcpy(&h, model, sizeof(h));
+    for (uint32_t i = 0; i < h.layer_count; i++) {
+        AiLayer l;
+        read_layer(model, i, &l);
+        if (layer_scratch_size(&l, h.flags) > scratch) scratch = layer_scratch_size(&l, h.flags);
+    }
+    return scratch;
+}
+
+uint32_t ai_engine_worker_scratch_size(const uint8_t* model) {
+    AiModelHeader h;
+    uint32_t scratch = 0;
+
+    // Every worker may run any layer's panels, with the skip list, and a
+    // fused layer's conv rows
+    memcpy(&h, model, sizeof(h));
+    for (uint32_t i = 0; i < h.layer_count; i++) {
+        AiLayer l;
+        read_layer(model, i, &l);
+        uint32_t k = gemm_depth(&l);
+        if (!k) continue;
+        uint32_t bytes = ai_gemm_scratch_size(k) + ai_gemm_skip_size(k) + pool_rows_size(&l, l.out_w);
+        if (bytes > scratch) scratch = bytes;
+    }
+    return scratch;
+}
+
+uint32_t ai_engine_state_size(const uint8_t* model) {
+    AiModelHeader h;
+    memcpy(&h, model, sizeof(h));
+    return state_offset(model, h.layer_count);
+}
+
+void ai_engine_reset_state(const uint8_t* model, int8_t* arena) {
+    AiModelHeader h;
+    memcpy(&h, model, sizeof(h));
+
+    // Zero-valued embeddings: every window entry at its layer's input zero point
+    int8_t* state = arena + ai_engine_scratch_size(model) + h.arena_size;
+    for (uint32_t i = 0; i < h.layer_count; i++) {
+        AiLayer l;
+        read_layer(model, i, &l);
+        if (l.op != AI_OP_TEMPORAL_CONV) continue;
+        uint32_t bytes = tensor_size(l.in_w, l.in_h, l.in_c);
+        memset(state, l.input_zero, bytes);
+        state += bytes;
+    }
+}
+
+/* ==================== KERNELS ==================== */
+
+static void gemm_params(const uint8_t* model, const AiLayer* l, uint32_t flags, const AiGemmPool* pool,
+                        AiGemmParams* p) {
+    p->weights = (const int8_t*)(model + l->weights_offset);
+    p->packed = flags & AI_MODEL_FLAG_PACKED_B;
+    p->n = l->out_c;
+    p->k = gemm_depth(l);
+    p->bias = model + l->bias_offset;
+    p->multiplier = model + l->quant_offset;
+    p->shift = p->multiplier + 4u * l->out_c;
+    p->a_zero = l->input_zero;
+    p->out_zero = l->output_zero;
+    p->out_min = (l->activation == AI_ACT_RELU) ? l->output_zero : -128;
+    p->lut = (l->activation == AI_ACT_LUT) ? (const int8_t*)(model + l->lut_offset) : NULL;
+    p->skip = 0;
+    p->pool = pool;
+}
+
+static void maxpool_2x2(const int8_t* in, uint32_t W, uint32_t H, uint32_t C, int8_t* out) {
+    for (uint32_t oy = 0; oy < H / 2; oy++) {
+        for (uint32_t ox = 0; ox < W / 2; ox++) {
+            const int8_t* p = in + ((2 * oy) * W + 2 * ox) * C;
+            for (uint32_t c = 0; c < C; c++) {
+                int8_t m = p[c];
+                if (p[C + c] > m) m = p[C + c];
+                if (p[W * C + c] > m) m = p[W * C + c];
+                if (p[W * C + C + c] > m) m = p[W * C + C + c];
+                *out++ = m;
+            }
+        }
+    }
+}
+
+// Pooled rows of a fused conv + pool layer, split over a worker pool
+typedef struct {
+    AiGemmParams p;             // Without the pool: each task runs on one worker
+    const AiGemmPool* pool;
+    const int8_t* in;
+    uint32_t w, h, c;
+    uint32_t x0, y0, out_w, out_h;
+    int8_t* out;
+    int8_t* rows;               // The caller's (worker 0)
+    int16_t* scratch;
+    uint32_t tasks;
+} PoolJob;
+
+/**
+ * Pooled rows [y0, y1) of a fused conv + pool layer (see conv3x3_pool())
+ */
+static void pool_rows(const AiGemmParams* p, const int8_t* in, uint32_t w, uint32_t h, uint32_t c,
+                      uint32_t x0, uint32_t y0, uint32_t out_w, uint32_t first, uint32_t end,
+                      int8_t* out, int8_t* rows, int16_t* scratch) {
+    for (uint32_t y = first; y < end; y++) {
+        ai_gemm_conv3x3_window(p, in, w, h, c, x0, y0 + 2u * y, 2u * out_w, 2u, rows, scratch);
+        maxpool_2x2(rows, 2u * out_w, 2u, p->n, out + y * out_w * p->n);
+    }
+}
+
+/**
+ * One task's band of pooled rows; workers 1.. keep their conv rows after
+ * the A panel in their own scratch (ai_engine_worker_scratch_size())
+ */
+static void pool_task(void* ctx, uint32_t task, uint32_t worker) {
+    const PoolJob* job = (const PoolJob*)ctx;
+    int16_t* scratch = worker ? job->pool->scratch[worker] : job->scratch;
+    int8_t* rows = worker ? (int8_t*)scratch + ai_gemm_scratch_size(job->p.k) + ai_gemm_skip_size(job->p.k)
+                          : job->rows;
+
+    pool_rows(&job->p, job->in, job->w, job->h, job->c, job->x0, job->y0, job->out_w,
+              job->out_h * task / job->tasks, job->out_h * (task + 1u) / job->tasks, job->out, rows, scratch);
+}
+
+/**
+ * Fused conv 3x3 + max pool 2x2: out_w x out_h pooled pixels whose conv
+ * pixels start at (x0, y0) of the w x h input; each pair of conv rows
+ * goes through rows (pool_rows_size bytes) and is pooled into out. With a
+ * pool, bands of pooled rows go to the workers (one barrier per layer,
+ * not per row pair).
+ */
+static void conv3x3_pool(const AiGemmParams* p, const int8_t* in, uint32_t w, uint32_t h, uint32_t c,
+                         uint32_t x0, uint32_t y0, uint32_t out_w, uint32_t out_h,
+                         int8_t* out, int8_t* rows, int16_t* scratch) {
+    uint32_t tasks = ai_gemm_tasks(p->pool, 4ull * out_w * out_h * p->n * p->k);
+    if (tasks > out_h) tasks = out_h;
+    if (tasks <= 1u) {
+        pool_rows(p, in, w, h, c, x0, y0, out_w, 0, out_h, out, rows, scratch);
+        return;
+    }
+
+    PoolJob job = { *p, p->pool, in, w, h, c, x0, y0, out_w, out_h, out, rows, scratch, tasks };
+    job.p.pool = NULL;
+    p->pool->run(p->pool->user, pool_task, &job, tasks);
+}
+
+static void global_avgpool(const AiLayer* l, const int8_t* in, int8_t* out) {
+    const int32_t n = (int32_t)(l->in_w * l->in_h);
+    const int32_t zero = l->input_zero;
+
+    for (uint32_t c = 0; c < l->in_c; c++) {
+        int32_t sum = 0;
+        for (int32_t i = 0; i < n; i++) sum += in[i * l->in_c + c] - zero;
+
+        // Same scale in and out: rounded mean, half away from zero
+        int32_t mean = (sum >= 0) ? (sum + n / 2) / n : -((-sum + n / 2) / n);
+        out[c] = ai_saturate(mean + zero, -128);
+    }
+}
+
+/* ==================== COMPRESSED ACTIVATIONS ==================== */
+
+/**
+ * Stored bytes of row y of a compressed map with `rows` rows; *data points
+ * at them (a row shorter than its plain size starts with its bitmap)
+ */
+static uint32_t sparse_row(const int8_t* map, uint32_t rows, uint32_t y, const int8_t** data) {
+    uint32_t start, end;
+    memcpy(&start, map + 4u * y, sizeof(start));
+    memcpy(&end, map + 4u * (y + 1u), sizeof(end));
+    *data = map + 4u * (rows + 1u) + start;
+    return end - start;
+}
+
+/**
+ * Append row y (n values) to a compressed map, rows in order from 0:
+ * bitmap + values unless that is no shorter than the row as is
+ */
+static void sparse_put_row(int8_t* map, uint32_t rows, uint32_t y, const int8_t* row, uint32_t n,
+                           int32_t zero) {
+    uint32_t start = 0;
+    if (y) {
+        memcpy(&start, map + 4u * y, sizeof(start));
+    } else {
+        memcpy(map, &start, sizeof(start));
+    }
+    int8_t* dst = map + 4u * (rows + 1u) + start;
+
+    const uint32_t bitmap = (n + 7u) / 8u;
+    uint32_t nonzero = 0;
+    for (uint32_t j = 0; j < n; j++) nonzero += (row[j] != zero);
+
+    uint32_t length = n;
+    if (bitmap + nonzero < n) {
+        uint8_t* bits = (uint8_t*)dst;
+        int8_t* values = dst + bitmap;
+        memset(bits, 0, bitmap);
+        for (uint32_t j = 0; j < n; j++) {
+            if (row[j] == zero) continue;
+            bits[j >> 3] |= (uint8_t)(1u << (j & 7u));
+            *values++ = row[j];
+        }
+        length = bitmap + nonzero;
+    } else {
+        memcpy(dst, row, n);
+    }
+    uint32_t end = start + length;
+    memcpy(map + 4u * (y + 1u), &end, sizeof(end));
+}
+
+/**
+ * Row y (n values) of a compressed map back to plain int8
+ */
+static void sparse_get_row(const int8_t* map, uint32_t rows, uint32_t y, uint32_t n, int32_t zero,
+                           int8_t* row) {
+    const int8_t* data;
+    if (sparse_row(map, rows, y, &data) == n) {
+        memcpy(row, data, n);
+        return;
+    }
+
+    const uint8_t* bits = (const uint8_t*)data;
+    const int8_t* values = data + (n + 7u) / 8u;
+    for (uint32_t j = 0; j < n; j += 8u) {
+        uint32_t b = bits[j >> 3];
+        uint32_t m = (n - j < 8u) ? n - j : 8u;
+        if (!b) {
+            memset(row + j, zero, m);  // Eight zeros at once, the common case
+            continue;
+        }
+        for (uint32_t t = 0; t < m; t++) row[j + t] = ((b >> t) & 1u) ? *values++ : (int8_t)zero;
+    }
+}
+
+/**
+ * A whole compressed map (rows of n values) as a dense layer's A panel:
+ * zero point removed, ai_gemm_panel_index() order, padded to depth
+ */
+static void sparse_unpack(const int8_t* map, uint32_t rows, uint32_t n, int32_t zero, uint32_t depth,
+                          int16_t* panel) {
+    uint32_t k = 0;
+
+    for (uint32_t y = 0; y < rows; y++) {
+        const int8_t* data;
+        if (sparse_row(map, rows, y, &data) == n) {
+            for (uint32_t j = 0; j < n; j++) panel[ai_gemm_panel_index(k++)] = (int16_t)(data[j] - zero);
+            continue;
+        }
+        const uint8_t* bits = (const uint8_t*)data;
+        const int8_t* values = data + (n + 7u) / 8u;
+        for (uint32_t j = 0; j < n; j++) {
+            int32_t set = (bits[j >> 3] >> (j & 7u)) & 1u;
+            panel[ai_gemm_panel_index(k++)] = set ? (int16_t)(*values++ - zero) : 0;
+        }
+    }
+    while (k < depth) panel[ai_gemm_panel_index(k++)] = 0;
+}
+
+// Decoded rows of a compressed input, sliding down the map
+typedef struct {
+    const int8_t* map;
+    uint32_t rows;            // Map height
+    uint32_t row_bytes;
+    int32_t zero;
+    int8_t* buffer;           // window_height() rows
+    uint32_t top;             // First map row held
+    uint32_t count;           // Rows held
+} RowWindow;
+
+/**
+ * Hold map rows [y0, y1) clipped to the map, decoding only rows not held
+ * yet (windows only move down); returns the rows, the first one in *top
+ */
+static const int8_t* window_fill(RowWindow* win, int32_t y0, int32_t y1, uint32_t* top) {
+    uint32_t lo = (y0 < 0) ? 0 : (uint32_t)y0;
+    uint32_t hi = ((uint32_t)y1 > win->rows) ? win->rows : (uint32_t)y1;
+
+    if (lo >= win->top + win->count) {
+        win->count = 0;
+    } else if (lo > win->top) {
+        uint32_t drop = lo - win->top;
+        win->count -= drop;
+        memmove(win->buffer, win->buffer + drop * win->row_bytes, win->count * win->row_bytes);
+    }
+    win->top = lo;
+    for (; win->top + win->count < hi; win->count++) {
+        sparse_get_row(win->map, win->rows, win->top + win->count, win->row_bytes, win->zero,
+                       win->buffer + win->count * win->row_bytes);
+    }
+    *top = lo;
+    return win->buffer;
+}
+
+/**
+ * Conv, fused conv + pool, max pool or dense layer reading and/or writing
+ * a compressed map, one output row at a time; work holds the window and
+ * the staging row (sparse_work_size()), then the fused pool's conv rows
+ */
+static void run_sparse_layer(const uint8_t* model, const AiModelHeader* h, const AiLayer* l,
+                             const int8_t* in, int32_t in_sparse, int32_t in_zero,
+                             int8_t* out, int32_t out_sparse, int32_t out_zero,
+                             int8_t* work, int16_t* scratch, const AiGemmPool* pool) {
+    const uint32_t row_in = tensor_size(l->in_w, 1u, l->in_c);
+    const uint32_t row_out = tensor_size(l->out_w, 1u, l->out_c);
+    RowWindow win = { in, l->in_h, row_in, in_zero, work, 0, 0 };
+    int8_t* staging = work + (in_sparse ? window_height(l->op) * row_in : 0);
+    int8_t* rows = staging + (out_sparse ? row_out : 0);
+    AiGemmParams p;
+
+    if (l->op != AI_OP_MAXPOOL_2X2) {
+        gemm_params(model, l, h->flags, pool, &p);
+        p.skip = (uint32_t)in_sparse;
+    }
+    if (l->op == AI_OP_DENSE) {
+        sparse_unpack(in, l->in_h, row_in, in_zero, ai_gemm_depth(p.k), scratch);
+        ai_gemm_dense_packed(&p, out, scratch);
+        return;
+    }
+
+    for (uint32_t y = 0; y < l->out_h; y++) {
+        // Input rows output row y reads: 3x3 taps, two conv rows, or a 2x2 pool
+        int32_t y0 = (l->op == AI_OP_CONV2D_3X3) ? (int32_t)y - 1 : 2 * (int32_t)y - (l->op != AI_OP_MAXPOOL_2X2);
+        int32_t y1 = y0 + (int32_t)window_height(l->op);
+        uint32_t top = 0;
+        uint32_t count = l->in_h;
+        const int8_t* src = in;
+        if (in_sparse) {
+            src = window_fill(&win, y0, y1, &top);
+            count = win.count;
+        }
+
+        int8_t* dst = out_sparse ? staging : out + y * row_out;
+        if (l->op == AI_OP_CONV2D_3X3) {
+            ai_gemm_conv3x3_window(&p, src, l->in_w, count, l->in_c, 0, y - top, l->in_w, 1u, dst, scratch);
+        } else if (l->op == AI_OP_CONV2D_3X3_POOL) {
+            conv3x3_pool(&p, src, l->in_w, count, l->in_c, 0, 2u * y - top, l->out_w, 1u, dst, rows, scratch);
+        } else {
+            maxpool_2x2(src + (2u * y - top) * row_in, l->in_w, 2u, l->in_c, dst);
+        }
+        if (out_sparse) sparse_put_row(out, l->out_h, y, dst, row_out, out_zero);
+    }
+}
+
+/* ==================== CLASS ACTIVATION MAP ==================== */
+
+// Tail of the fire path the map is read from (ai_engine_cam_check())
+typedef struct {
+    uint32_t map_layer;       // Its input is the feature map F (the logits, a pool or a hidden dense)
+    uint32_t logits_layer;    // [no_fire, fire]
+    float output_scale;       // Of the logits
+    const int8_t* map;        // F, set while the fire path runs
+    AiCam* cam;
+} CamPlan;
+
+/**
+ * Find the fire path's tail: its logits dense layer reads F flattened, a
+ * global average pool of F, or a ReLU / linear dense layer reading F
+ */
+static int32_t cam_plan(const uint8_t* model, CamPlan* plan) {
+    AiModelHeader h;
+    AiHeadInfo heads[AI_ENGINE_MAX_HEADS];
+    AiLayer logits, prev;
+
+    memcpy(&h, model, sizeof(h));
+    uint32_t start = 0, end = h.layer_count;
+    plan->output_scale = h.output_scale;
+
+    uint32_t count = scan_heads(model, heads, AI_ENGINE_MAX_HEADS);
+    if (count) {
+        uint32_t i = 0;
+        while (i < count && heads[i].task != AI_TASK_FIRE) i++;
+        if (i == count) return AI_ENGINE_ERR_FORMAT;
+        AiLayer head;
+        read_layer(model, heads[i].layer, &head);
+        memcpy(&plan->output_scale, model + head.quant_offset, sizeof(float));
+        start = heads[i].layer + 1u;
+        end = next_head(model, &h, start);
+    }
+
+    plan->logits_layer = end - 1u;
+    plan->map_layer = plan->logits_layer;
+    read_layer(model, plan->logits_layer, &logits);
+    if (logits.op != AI_OP_DENSE || logits.out_c != 2u || logits.activation == AI_ACT_LUT) {
+        return AI_ENGINE_ERR_FORMAT;
+    }
+    if (logits.in_w * logits.in_h > 1u) return AI_ENGINE_OK;
+    if (plan->logits_layer == start) return AI_ENGINE_ERR_FORMAT;
+
+    read_layer(model, plan->logits_layer - 1u, &prev);
+    if (prev.op == AI_OP_GLOBAL_AVGPOOL ||
+        (prev.op == AI_OP_DENSE && prev.activation != AI_ACT_LUT && prev.in_w * prev.in_h > 1u)) {
+        plan->map_layer = plan->logits_layer - 1u;
+        return AI_ENGINE_OK;
+    }
+    return AI_ENGINE_ERR_FORMAT;
+}
+
+// multiplier * 2^(shift - 31) of output channel n: input steps -> output steps per weight unit
+static float requant_scale(const AiGemmParams* p, uint32_t n) {
+    return ldexpf((float)read_i32(p->multiplier + 4u * n), read_i32(p->shift + 4u * n) - 31);
+}
+
+/**
+ * Split the fire - no_fire margin over F (plan->map) into plan->cam, right
+ * before the logits layer runs on in; coef holds one float per logits
+ * input (its GEMM scratch is that large)
+ */
+static void class_activation_map(const uint8_t* model, const AiModelHeader* h, CamPlan* plan,
+                                 const int8_t* in, float* coef) {
+    AiLayer logits, first;
+    AiGemmParams p, hidden;
+    AiCam* cam = plan->cam;
+
+    AI_PROFILE_BEGIN(AI_PROFILE_CAM);
+    read_layer(model, plan->logits_layer, &logits);
+    read_layer(model, plan->map_layer, &first);
+    gemm_params(model, &logits, h->flags, NULL, &p);
+    const int32_t pooled = (first.op == AI_OP_GLOBAL_AVGPOOL);
+    const int32_t has_hidden = (plan->map_layer != plan->logits_layer && !pooled);
+
+    // Margin per logits input step
+    const float m0 = requant_scale(&p, 0), m1 = requant_scale(&p, 1);
+    for (uint32_t k = 0; k < p.k; k++) {
+        coef[k] = m1 * ai_gemm_weight(&p, 1, k) - m0 * ai_gemm_weight(&p, 0, k);
+    }
+    // ... back through the hidden units that fired (neither clamped nor saturated)
+    if (has_hidden) {
+        gemm_params(model, &first, h->flags, NULL, &hidden);
+        for (uint32_t j = 0; j < hidden.n; j++) {
+            coef[j] = (in[j] > hidden.out_min && in[j] < 127) ? coef[j] * requant_scale(&hidden, j) : 0.0f;
+        }
+    }
+
+    const uint32_t w = first.in_w, hh = first.in_h, c = first.in_c;
+    const int32_t zero = first.input_zero;
+    // Output steps -> logits; the pool averages over every position
+    const float scale = pooled ? plan->output_scale / (float)(w * hh) : plan->output_scale;
+
+    memset(cam->heat, 0, sizeof(cam->heat));
+    cam->peak = -INFINITY;
+    cam->map_w = (uint16_t)w;
+    cam->map_h = (uint16_t)hh;
+    for (uint32_t y = 0; y < hh; y++) {
+        for (uint32_t x = 0; x < w; x++) {
+            const uint32_t pos = (y * w + x) * c;
+            const int8_t* f = plan->map + pos;
+            float v = 0.0f;
+            if (has_hidden) {
+                for (uint32_t j = 0; j < hidden.n; j++) {
+                    if (coef[j] == 0.0f) continue;
+                    int32_t acc = 0;
+                    for (uint32_t ch = 0; ch < c; ch++) {
+                        acc += ai_gemm_weight(&hidden, j, pos + ch) * (f[ch] - zero);
+                    }
+                    v += coef[j] * (float)acc;
+                }
+            } else {
+                const float* k = pooled ? coef : coef + pos;
+                for (uint32_t ch = 0; ch < c; ch++) v += k[ch] * (float)(f[ch] - zero);
+            }
+            v *= scale;
+
+            // Spread over the cells the position covers (several when the map is coarser than the grid)
+            uint32_t cx0 = x * AI_CAM_GRID / w, cx1 = (x + 1u) * AI_CAM_GRID / w;
+            uint32_t cy0 = y * AI_CAM_GRID / hh, cy1 = (y + 1u) * AI_CAM_GRID / hh;
+            if (cx1 <= cx0) cx1 = cx0 + 1u;
+            if (cy1 <= cy0) cy1 = cy0 + 1u;
+            const float share = v / (float)((cx1 - cx0) * (cy1 - cy0));
+            for (uint32_t cy = cy0; cy < cy1; cy++) {
+                for (uint32_t cx = cx0; cx < cx1; cx++) cam->heat[cy * AI_CAM_GRID + cx] += share;
+            }
+
+            if (v > cam->peak) {
+                cam->peak = v;
+                cam->peak_x = (uint16_t)((2u * x + 1u) * h->input_w / (2u * w));
+                cam->peak_y = (uint16_t)((2u * y + 1u) * h->input_h / (2u * hh));
+            }
+        }
+    }
+    cam->valid = 1;
+    AI_PROFILE_END(AI_PROFILE_CAM);
+}
+
+/* ==================== EXECUTION ==================== */
+
+// Model input: exactly one of values / pixels is set
+typedef struct {
+    const float* values;      // Normalized tensor (preprocess_image)
+    const uint8_t* pixels;    // 8-bit image, normalized here
+} InputSource;
+
+/**
+ * Quantize a window of the model input into dst
+ * Pixels are normalized exactly like preprocess_image(), so both sources
+ * give identical int8 values.
+ */
+static void quantize_input(const AiModelHeader* h, const InputSource* src, const Region* r,
+                           int8_t* dst) {
+    const uint32_t c = h->input_c;
+
+    AI_PROFILE_BEGIN(AI_PROFILE_INPUT);
+    for (uint32_t y = r->y; y < r->y + r->h; y++) {
+        uint32_t i = (y * h->input_w + r->x) * c;
+        for (uint32_t n = r->w * c; n > 0; n--, i++) {
+            float v = src->pixels ? (float)src->pixels[i] / 255.0f : src->values[i];
+            int32_t q = (int32_t)lrintf(v / h->input_scale) + h->input_zero;
+            *dst++ = ai_saturate(q, -128);
+        }
+    }
+    AI_PROFILE_END(AI_PROFILE_INPUT);
+}
+
+/**
+ * Run the patched stage tile by tile; its output map is assembled at the
+ * low end of the activation area, tiles ping-pong in the space above it
+ */
+static void run_patch_stage(const uint8_t* model, const AiModelHeader* h, const InputSource* src,
+                            int8_t* act, int16_t* scratch, const AiGemmPool* pool) {
+    Region regions[AI_ENGINE_MAX_PATCH_LAYERS + 1];
+    AiLayer last;
+
+    read_layer(model, h->patch_layers - 1u, &last);
+    const uint32_t map_bytes = tensor_size(last.out_w, last.out_h, last.out_c);
+    int8_t* patch = act + map_bytes;
+    const uint32_t patch_bytes = h->arena_size - map_bytes;
+
+    for (uint32_t t = 0; t < (uint32_t)h->patch_grid * h->patch_grid; t++) {
+        patch_regions(model, h, t, regions);
+        quantize_input(h, src, &regions[0], patch);
+
+        const int8_t* in = patch;
+        int32_t in_low = 1;
+        for (uint32_t i = 0; i < h->patch_layers; i++) {
+            const Region* r = &regions[i];
+            const Region* o = &regions[i + 1];
+            AiLayer l;
+            read_layer(model, i, &l);
+            AI_PROFILE_BEGIN(AI_PROFILE_LAYER(i));
+
+            uint32_t out_bytes = tensor_size(o->w, o->h, l.out_c);
+            int8_t* out = in_low ? patch + patch_bytes - out_bytes : patch;
+            AiGemmParams p;
+            if (l.op == AI_OP_CONV2D_3X3) {
+                gemm_params(model, &l, h->flags, pool, &p);
+                ai_gemm_conv3x3_window(&p, in, r->w, r->h, l.in_c, o->x - r->x, o->y - r->y,
+                                       o->w, o->h, out, scratch);
+            } else if (l.op == AI_OP_CONV2D_3X3_POOL) {
+                // Row buffer between the two windows
+                int8_t* rows = in_low ? patch + tensor_size(r->w, r->h, l.in_c) : patch + out_bytes;
+                gemm_params(model, &l, h->flags, pool, &p);
+                conv3x3_pool(&p, in, r->w, r->h, l.in_c, 2u * o->x - r->x, 2u * o->y - r->y,
+                             o->w, o->h, out, rows, scratch);
+            } else {
+                maxpool_2x2(in, r->w, r->h, l.in_c, out);
+            }
+            AI_PROFILE_END(AI_PROFILE_LAYER(i));
+
+            in = out;
+            in_low = !in_low;
+        }
+
+        // Tile rows into the map
+        const Region* tile = &regions[h->patch_layers];
+        const uint32_t row = tile->w * last.out_c;
+        for (uint32_t y = 0; y < tile->h; y++) {
+            memcpy(act + ((tile->y + y) * last.out_w + tile->x) * last.out_c, in + y * row, row);
+        }
+    }
+}
+
+/**
+ * Run layers [first, end) in the activation area act (size bytes), input at
+ * its low end; temporal windows live in state. Returns the last output, at
+ * either end of the area. cam (may be NULL) maps the fire output on the way.
+ */
+static const int8_t* run_layers(const uint8_t* model, const AiModelHeader* h, uint32_t first,
+                                uint32_t end, int8_t* act, uint32_t size, int8_t* state,
+                                int16_t* scratch, const AiGemmPool* pool, CamPlan* cam) {
+    const int8_t* in = act;
+    int32_t in_low = 1;
+    int32_t in_sparse = 0;    // in is a compressed map
+    int32_t zero = 0;         // Its zero point
+
+    for (uint32_t i = first; i < end; i++) {
+        AiLayer l;
+        read_layer(model, i, &l);
+
+        // Feature map and hidden output are both intact right before the logits
+        if (cam && i == cam->map_layer) cam->map = in;
+        if (cam && i == cam->logits_layer) class_activation_map(model, h, cam, in, (float*)(void*)scratch);
+        AI_PROFILE_BEGIN(AI_PROFILE_LAYER(i));
+
+        // Output goes to the opposite end of the area from the input; the
+        // map the class activation map reads stays plain
+        int32_t out_sparse = sparse_output(model, h, i, &l, in_sparse) && !(cam && i + 1u == cam->map_layer);
+        uint32_t out_bytes = out_sparse ? sparse_size(l.out_w, l.out_h, l.out_c)
+                                        : tensor_size(l.out_w, l.out_h, l.out_c);
+        int8_t* out = in_low ? act + size - out_bytes : act;
+
+        AiGemmParams p;
+        if (in_sparse || out_sparse) {
+            // Work buffers between input and output; a pool keeps its input's zero point
+            uint32_t in_bytes = in_sparse ? sparse_size(l.in_w, l.in_h, l.in_c)
+                                          : tensor_size(l.in_w, l.in_h, l.in_c);
+            int8_t* work = in_low ? act + in_bytes : act + out_bytes;
+            int32_t out_zero = (l.op == AI_OP_MAXPOOL_2X2) ? zero : l.output_zero;
+            run_sparse_layer(model, h, &l, in, in_sparse, zero, out, out_sparse, out_zero, work, scratch, pool);
+            zero = out_zero;
+        } else switch (l.op) {
+            case AI_OP_CONV2D_3X3:
+                gemm_params(model, &l, h->flags, pool, &p);
+                ai_gemm_conv3x3(&p, in, l.in_w, l.in_h, l.in_c, out, scratch);
+                break;
+            case AI_OP_CONV2D_3X3_POOL: {
+                // Row buffer between input and output
+                int8_t* rows = in_low ? act + tensor_size(l.in_w, l.in_h, l.in_c) : act + out_bytes;
+                gemm_params(model, &l, h->flags, pool, &p);
+                conv3x3_pool(&p, in, l.in_w, l.in_h, l.in_c, 0, 0, l.out_w, l.out_h, out, rows, scratch);
+                break;
+            }
+            case AI_OP_DENSE:
+                gemm_params(model, &l, h->flags, pool, &p);
+                ai_gemm_dense(&p, in, out, scratch);
+                break;
+            case AI_OP_TEMPORAL_CONV: {
+                // Window drops its oldest frame and takes this one's embedding
+                int8_t* window = state + state_offset(model, i);
+                const uint32_t history = tensor_size(1u, l.in_h - 1u, l.in_c);
+                memmove(window, window + l.in_c, history);
+                memcpy(window + history, in, l.in_c);
+                gemm_params(model, &l, h->flags, pool, &p);
+                ai_gemm_dense(&p, window, out, scratch);
+                break;
+            }
+            case AI_OP_MAXPOOL_2X2:    maxpool_2x2(in, l.in_w, l.in_h, l.in_c, out); break;
+            case AI_OP_GLOBAL_AVGPOOL: global_avgpool(&l, in, out); break;
+        }
+        AI_PROFILE_END(AI_PROFILE_LAYER(i));
+
+        in = out;
+        in_low = !in_low;
+        in_sparse = out_sparse;
+    }
+    return in;
+}
+
+static void dequantize(const int8_t* in, uint32_t n, int32_t zero, float scale, float* output) {
+    for (uint32_t i = 0; i < n; i++) {
+        output[i] = (in[i] - zero) * scale;
+    }
+}
+
+static int32_t run_model(const uint8_t* model, const InputSource* src, int8_t* arena, uint32_t task_mask,
+                         float* output, uint32_t output_capacity, AiCam* cam, const AiGemmPool* pool) {
+    AiModelHeader h;
+    memcpy(&h, model, sizeof(h));
+    AI_PROFILE_BEGIN(AI_PROFILE_ENGINE);
+
+    CamPlan plan;
+    CamPlan* mapping = NULL;
+    if (cam) {
+        cam->valid = 0;
+        if (cam_plan(model, &plan) == AI_ENGINE_OK) {
+            plan.cam = cam;
+            mapping = &plan;
+        }
+    }
+
+    // GEMM scratch first, activations after it, then the temporal state
+    int16_t* scratch = (int16_t*)(void*)arena;
+    arena += ai_engine_scratch_size(model);
+    int8_t* state = arena + h.arena_size;
+
+    // Input (or the patched stage's output map) at the low end of the activations
+    uint32_t first = 0;
+    if (h.flags & AI_MODEL_FLAG_PATCHED) {
+        run_patch_stage(model, &h, src, arena, scratch, pool);
+        first = h.patch_layers;
+    } else {
+        Region all = { 0, 0, h.input_w, h.input_h };
+        quantize_input(&h, src, &all, arena);
+    }
+
+    const uint32_t backbone_end = next_head(model, &h, 0);
+    const int8_t* out = run_layers(model, &h, first, backbone_end, arena, h.arena_size, state, scratch, pool,
+                                   (backbone_end == h.layer_count) ? mapping : NULL);
+    uint32_t total = ai_engine_output_count(model);
+    uint32_t n = (total < output_capacity) ? total : output_capacity;
+
+    if (backbone_end == h.layer_count) {
+        dequantize(out, n, h.output_zero, h.output_scale, output);
+        AI_PROFILE_END(AI_PROFILE_ENGINE);
+        return (int32_t)n;
+    }
+
+    // Backbone output stays at the low end; each head runs on a copy above it
+    AiLayer head;
+    read_layer(model, backbone_end, &head);
+    const uint32_t backbone = tensor_size(head.in_w, head.in_h, head.in_c);
+    memmove(arena, out, backbone);
+
+    AiHeadInfo heads[AI_ENGINE_MAX_HEADS];
+    uint32_t count = scan_heads(model, heads, AI_ENGINE_MAX_HEADS);
+    for (uint32_t i = 0; i < count; i++) {
+        const AiHeadInfo* info = &heads[i];
+        if (!(task_mask & AI_TASK_BIT(info->task)) || info->offset >= n) continue;
+
+        read_layer(model, info->layer, &head);
+        float scale;
+        memcpy(&scale, model + head.quant_offset, sizeof(scale));
+        int32_t zero = read_i32(model + head.quant_offset + 4u);
+
+        memcpy(arena + backbone, arena, backbone);
+        out = run_layers(model, &h, info->layer + 1u, next_head(model, &h, info->layer + 1u),
+                         arena + backbone, h.arena_size - backbone, state, scratch, pool,
+                         (info->task == AI_TASK_FIRE) ? mapping : NULL);
+        uint32_t values = (info->offset + info->count <= n) ? info->count : n - info->offset;
+        dequantize(out, values, zero, scale, output + info->offset);
+    }
+    AI_PROFILE_END(AI_PROFILE_ENGINE);
+    return (int32_t)n;
+}
+
+int32_t ai_engine_run(const uint8_t* model, const float* input, int8_t* arena,
+                      float* output, uint32_t output_capacity) {
+    return ai_engine_run_heads(model, input, arena, AI_TASKS_ALL, output, output_capacity);
+}
+
+int32_t ai_engine_run_image(const uint8_t* model, const uint8_t* image, int8_t* arena,
+                            float* output, uint32_t output_capacity) {
+    return ai_engine_run_image_heads(model, image, arena, AI_TASKS_ALL, output, output_capacity);
+}
+
+int32_t ai_engine_run_heads(const uint8_t* model, const float* input, int8_t* arena,
+                            uint32_t task_mask, float* output, uint32_t output_capacity) {
+    AiModelHeader h;
+    memcpy(&h, model, sizeof(h));
+    if (tensor_size(h.input_w, h.input_h, h.input_c) > AI_ENGINE_MAX_INPUT) return AI_ENGINE_ERR_SHAPE;
+
+    InputSource src = { input, NULL };
+    return run_model(model, &src, arena, task_mask, output, output_capacity, NULL, NULL);
+}
+
+int32_t ai_engine_run_image_heads(const uint8_t* model, const uint8_t* image, int8_t* arena,
+                                  uint32_t task_mask, float* output, uint32_t output_capacity) {
+    InputSource src = { NULL, image };
+    return run_model(model, &src, arena, task_mask, output, output_capacity, NULL, NULL);
+}
+
+int32_t ai_engine_cam_check(const uint8_t* model) {
+    CamPlan plan;
+    return cam_plan(model, &plan);
+}
+
+int32_t ai_engine_run_cam(const uint8_t* model, const float* input, int8_t* arena, uint32_t task_mask,
+                          float* output, uint32_t output_capacity, AiCam* cam) {
+    AiModelHeader h;
+    memcpy(&h, model, sizeof(h));
+    if (tensor_size(h.input_w, h.input_h, h.input_c) > AI_ENGINE_MAX_INPUT) return AI_ENGINE_ERR_SHAPE;
+
+    InputSource src = { input, NULL };
+    return run_model(model, &src, arena, task_mask, output, output_capacity, cam, NULL);
+}
+
+int32_t ai_engine_run_image_cam(const uint8_t* model, const uint8_t* image, int8_t* arena,
+                                uint32_t task_mask, float* output, uint32_t output_capacity, AiCam* cam) {
+    InputSource src = { NULL, image };
+    return run_model(model, &src, arena, task_mask, output, output_capacity, cam, NULL);
+}
+
+int32_t ai_engine_run_parallel(const uint8_t* model, const float* input, const uint8_t* image, int8_t* arena,
+                               uint32_t task_mask, float* output, uint32_t output_capacity, AiCam* cam,
+                               const AiGemmPool* pool) {
+    AiModelHeader h;
+    memcpy(&h, model, sizeof(h));
+    if (!image && tensor_size(h.input_w, h.input_h, h.input_c) > AI_ENGINE_MAX_INPUT) return AI_ENGINE_ERR_SHAPE;
+    if (pool && pool->scratch_size < ai_engine_worker_scratch_size(model)) pool = NULL;
+
+    InputSource src = { image ? NULL : input, image };
+    return run_model(model, &src, arena, task_mask, output, output_capacity, cam, pool);
+}
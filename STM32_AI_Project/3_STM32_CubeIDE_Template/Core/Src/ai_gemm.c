@@ -0,0 +1,427 @@
+/*
+ * Int8 GEMM Core
+ * A-panel packing (implicit im2col), MRxNR microkernels, requantizing epilogue
+ */
+
+#include "ai_gemm.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#define AI_GEMM_USE_DSP 1
+#else
+#define AI_GEMM_USE_DSP 0
+#endif
+
+/* ==================== HELPERS ==================== */
+
+static inline int32_t read_i32(const uint8_t* p) {
+    int32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+#if AI_GEMM_USE_DSP
+static inline uint32_t load_u32(const void* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));  // Single LDR: M7 allows unaligned word loads
+    return v;
+}
+
+/**
+ * Two SMLADs: A pairs (a0,a2) (a1,a3) against weight bytes w0..w3
+ */
+static inline int32_t dot4(const int16_t* a, uint32_t w, int32_t acc) {
+    int32_t w02 = __sxtb16((int32_t)w);
+    int32_t w13 = __sxtb16((int32_t)__ror(w, 8));
+    acc = __smlad((int32_t)load_u32(a), w02, acc);
+    return __smlad((int32_t)load_u32(a + 2), w13, acc);
+}
+#endif
+
+/* ==================== MICROKERNELS ==================== */
+
+/**
+ * 2 rows x 2 channels over `steps` 4-deep steps
+ * b0/b1 advance by b_step bytes per step (4 plain, 4*NR packed)
+ */
+static void kernel_2x2(const int16_t* a0, const int16_t* a1, const int8_t* b0, const int8_t* b1,
+                       uint32_t b_step, uint32_t steps, int32_t acc[4]) {
+    int32_t c00 = acc[0], c01 = acc[1], c10 = acc[2], c11 = acc[3];
+
+    for (uint32_t s = 0; s < steps; s++) {
+#if AI_GEMM_USE_DSP
+        uint32_t w0 = load_u32(b0);
+        uint32_t w1 = load_u32(b1);
+        c00 = dot4(a0, w0, c00);
+        c01 = dot4(a0, w1, c01);
+        c10 = dot4(a1, w0, c10);
+        c11 = dot4(a1, w1, c11);
+#else
+        c00 += a0[0] * b0[0] + a0[1] * b0[2] + a0[2] * b0[1] + a0[3] * b0[3];
+        c01 += a0[0] * b1[0] + a0[1] * b1[2] + a0[2] * b1[1] + a0[3] * b1[3];
+        c10 += a1[0] * b0[0] + a1[1] * b0[2] + a1[2] * b0[1] + a1[3] * b0[3];
+        c11 += a1[0] * b1[0] + a1[1] * b1[2] + a1[2] * b1[1] + a1[3] * b1[3];
+#endif
+        a0 += 4;
+        a1 += 4;
+        b0 += b_step;
+        b1 += b_step;
+    }
+
+    acc[0] = c00;
+    acc[1] = c01;
+    acc[2] = c10;
+    acc[3] = c11;
+}
+
+/**
+ * 1 row x 2 channels (dense layers, odd last pixel)
+ */
+static void kernel_1x2(const int16_t* a0, const int8_t* b0, const int8_t* b1,
+                       uint32_t b_step, uint32_t steps, int32_t acc[2]) {
+    int32_t c00 = acc[0], c01 = acc[1];
+
+    for (uint32_t s = 0; s < steps; s++) {
+#if AI_GEMM_USE_DSP
+        c00 = dot4(a0, load_u32(b0), c00);
+        c01 = dot4(a0, load_u32(b1), c01);
+#else
+        c00 += a0[0] * b0[0] + a0[1] * b0[2] + a0[2] * b0[1] + a0[3] * b0[3];
+        c01 += a0[0] * b1[0] + a0[1] * b1[2] + a0[2] * b1[1] + a0[3] * b1[3];
+#endif
+        a0 += 4;
+        b0 += b_step;
+        b1 += b_step;
+    }
+
+    acc[0] = c00;
+    acc[1] = c01;
+}
+
+/**
+ * kernel_2x2 over the live steps only (AiGemmParams.skip)
+ */
+static void kernel_2x2_live(const int16_t* a0, const int16_t* a1, const int8_t* b0, const int8_t* b1,
+                            uint32_t b_step, const uint16_t* live, uint32_t count, int32_t acc[4]) {
+    int32_t c00 = acc[0], c01 = acc[1], c10 = acc[2], c11 = acc[3];
+
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t s = live[i];
+        const int16_t* x0 = a0 + 4u * s;
+        const int16_t* x1 = a1 + 4u * s;
+        const int8_t* w0 = b0 + b_step * s;
+        const int8_t* w1 = b1 + b_step * s;
+#if AI_GEMM_USE_DSP
+        uint32_t v0 = load_u32(w0);
+        uint32_t v1 = load_u32(w1);
+        c00 = dot4(x0, v0, c00);
+        c01 = dot4(x0, v1, c01);
+        c10 = dot4(x1, v0, c10);
+        c11 = dot4(x1, v1, c11);
+#else
+        c00 += x0[0] * w0[0] + x0[1] * w0[2] + x0[2] * w0[1] + x0[3] * w0[3];
+        c01 += x0[0] * w1[0] + x0[1] * w1[2] + x0[2] * w1[1] + x0[3] * w1[3];
+        c10 += x1[0] * w0[0] + x1[1] * w0[2] + x1[2] * w0[1] + x1[3] * w0[3];
+        c11 += x1[0] * w1[0] + x1[1] * w1[2] + x1[2] * w1[1] + x1[3] * w1[3];
+#endif
+    }
+
+    acc[0] = c00;
+    acc[1] = c01;
+    acc[2] = c10;
+    acc[3] = c11;
+}
+
+/**
+ * kernel_1x2 over the live steps only
+ */
+static void kernel_1x2_live(const int16_t* a0, const int8_t* b0, const int8_t* b1,
+                            uint32_t b_step, const uint16_t* live, uint32_t count, int32_t acc[2]) {
+    int32_t c00 = acc[0], c01 = acc[1];
+
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t s = live[i];
+        const int16_t* x0 = a0 + 4u * s;
+        const int8_t* w0 = b0 + b_step * s;
+        const int8_t* w1 = b1 + b_step * s;
+#if AI_GEMM_USE_DSP
+        c00 = dot4(x0, load_u32(w0), c00);
+        c01 = dot4(x0, load_u32(w1), c01);
+#else
+        c00 += x0[0] * w0[0] + x0[1] * w0[2] + x0[2] * w0[1] + x0[3] * w0[3];
+        c01 += x0[0] * w1[0] + x0[1] * w1[2] + x0[2] * w1[1] + x0[3] * w1[3];
+#endif
+    }
+
+    acc[0] = c00;
+    acc[1] = c01;
+}
+
+/* ==================== DRIVER ==================== */
+
+/**
+ * Output channels per cache block (multiple of NR)
+ */
+static uint32_t channel_block(const AiGemmParams* p) {
+    uint32_t nc = AI_GEMM_CACHE_BYTES / ai_gemm_depth(p->k);
+    nc -= nc % AI_GEMM_NR;
+    if (nc < AI_GEMM_NR) nc = AI_GEMM_NR;
+    return nc;
+}
+
+/**
+ * Steps (of the first `steps`) where some of the rows packed A rows is
+ * nonzero, in order, into live; returns their count
+ */
+static uint32_t live_steps(const int16_t* panel, uint32_t rows, uint32_t depth, uint32_t steps,
+                           uint16_t* live) {
+    uint32_t count = 0;
+
+    for (uint32_t s = 0; s < steps; s++) {
+        uint32_t bits = 0;
+        for (uint32_t r = 0; r < rows; r++) {
+            uint32_t lo, hi;
+            memcpy(&lo, panel + r * depth + 4u * s, sizeof(lo));  // 4 int16 = 2 words
+            memcpy(&hi, panel + r * depth + 4u * s + 2u, sizeof(hi));
+            bits |= lo | hi;
+        }
+        if (bits) live[count++] = (uint16_t)s;
+    }
+    return count;
+}
+
+/**
+ * Live-step list after a packed panel (AiGemmParams.skip): its length when
+ * skipping pays - from 1/8 of the steps dead - else -1 (plain kernels)
+ */
+static int32_t panel_live(const AiGemmParams* p, int16_t* panel, uint32_t rows) {
+    if (!p->skip) return -1;
+    const uint32_t depth = ai_gemm_depth(p->k);
+    const uint32_t steps = p->packed ? depth / 4u : p->k / 4u;
+    uint16_t* live = (uint16_t*)(void*)(panel + AI_GEMM_MR * depth);
+    const uint32_t count = live_steps(panel, rows, depth, steps, live);
+    return (8u * count <= 7u * steps) ? (int32_t)count : -1;
+}
+
+/**
+ * rows (1..MR) packed A rows x channels [n0, n1) -> out (row stride p->n)
+ * live: panel_live() of the panel; the panel is only read
+ */
+static void gemm_panel(const AiGemmParams* p, const int16_t* panel, uint32_t rows, int32_t live,
+                       uint32_t n0, uint32_t n1, int8_t* out) {
+    const uint32_t depth = ai_gemm_depth(p->k);
+    // Plain [n][k] rows are not padded: whole steps only, then a scalar tail
+    const uint32_t steps = p->packed ? depth / 4u : p->k / 4u;
+    const uint32_t tail = p->packed ? p->k : steps * 4u;
+    const int16_t* a0 = panel;
+    const int16_t* a1 = (rows > 1) ? panel + depth : panel;
+    const uint16_t* list = (const uint16_t*)(const void*)(panel + AI_GEMM_MR * depth);
+
+    for (uint32_t n = n0; n < n1; n += AI_GEMM_NR) {
+        uint32_t cols = (n1 - n < AI_GEMM_NR) ? n1 - n : AI_GEMM_NR;
+        const int8_t* b0;
+        const int8_t* b1;
+        uint32_t b_step;
+
+        if (p->packed) {
+            // Panels are zero-padded to NR channels: the spare column is computed and dropped
+            b0 = p->weights + (n / AI_GEMM_NR) * AI_GEMM_NR * depth;
+            b1 = b0 + 4;
+            b_step = 4u * AI_GEMM_NR;
+        } else {
+            b0 = p->weights + n * p->k;
+            b1 = (cols > 1) ? b0 + p->k : b0;
+            b_step = 4u;
+        }
+
+        int32_t bias0 = read_i32(p->bias + 4u * n);
+        int32_t bias1 = (cols > 1) ? read_i32(p->bias + 4u * (n + 1)) : 0;
+        int32_t acc[4] = {bias0, bias1, bias0, bias1};
+
+        if (live >= 0) {
+            if (rows > 1) {
+                kernel_2x2_live(a0, a1, b0, b1, b_step, list, (uint32_t)live, acc);
+            } else {
+                kernel_1x2_live(a0, b0, b1, b_step, list, (uint32_t)live, acc);
+            }
+        } else if (rows > 1) {
+            kernel_2x2(a0, a1, b0, b1, b_step, steps, acc);
+        } else {
+            kernel_1x2(a0, b0, b1, b_step, steps, acc);
+        }
+
+        // Depth not covered by whole steps (plain weights only)
+        for (uint32_t k = tail; k < p->k; k++) {
+            int32_t x0 = a0[ai_gemm_panel_index(k)], x1 = a1[ai_gemm_panel_index(k)];
+            acc[0] += x0 * b0[k];
+            acc[1] += x0 * b1[k];
+            acc[2] += x1 * b0[k];
+            acc[3] += x1 * b1[k];
+        }
+
+        for (uint32_t r = 0; r < rows; r++) {
+            for (uint32_t j = 0; j < cols; j++) {
+                uint32_t ch = n + j;
+                int32_t v = ai_requantize(acc[r * 2u + j], read_i32(p->multiplier + 4u * ch),
+                                          read_i32(p->shift + 4u * ch));
+                int8_t q = ai_saturate(v + p->out_zero, p->out_min);
+                out[r * p->n + ch] = p->lut ? p->lut[q + 128] : q;
+            }
+        }
+    }
+}
+
+/**
+ * Implicit im2col: the 3x3xC window of output pixel (ox, oy) into a panel row
+ */
+static void pack_pixel(const int8_t* in, uint32_t w, uint32_t h, uint32_t c, int32_t zero,
+                       int32_t ox, int32_t oy, uint32_t depth, int16_t* row) {
+    uint32_t k = 0;
+
+    for (int32_t ky = -1; ky <= 1; ky++) {
+        int32_t iy = oy + ky;
+        for (int32_t kx = -1; kx <= 1; kx++) {
+            int32_t ix = ox + kx;
+            if (iy < 0 || iy >= (int32_t)h || ix < 0 || ix >= (int32_t)w) {
+                // Padding equals the input zero point: contributes nothing
+                for (uint32_t ic = 0; ic < c; ic++) row[ai_gemm_panel_index(k++)] = 0;
+                continue;
+            }
+            const int8_t* px = in + ((uint32_t)iy * w + (uint32_t)ix) * c;
+            for (uint32_t ic = 0; ic < c; ic++) row[ai_gemm_panel_index(k++)] = (int16_t)(px[ic] - zero);
+        }
+    }
+    while (k < depth) row[ai_gemm_panel_index(k++)] = 0;
+}
+
+/**
+ * [begin, end) of part i of parts over total, in whole units
+ */
+static void split(uint32_t total, uint32_t unit, uint32_t parts, uint32_t i, uint32_t* begin, uint32_t* end) {
+    const uint32_t units = (total + unit - 1u) / unit;
+    *begin = units * i / parts * unit;
+    *end = units * (i + 1u) / parts * unit;
+    if (*end > total) *end = total;
+}
+
+// A conv window, or the part of it one task computes
+typedef struct {
+    const AiGemmParams* p;
+    const int8_t* in;
+    uint32_t w, h, c;
+    uint32_t x0, y0, out_w;
+    uint32_t m;                 // Output pixels
+    int8_t* out;
+    int16_t* scratch;           // The caller's (worker 0)
+    uint32_t tasks;
+    uint32_t by_channel;        // Tasks split channels, else pixels
+} ConvJob;
+
+/**
+ * Output pixels [m0, m1) x channels [c0, c1) of a conv window
+ */
+static void conv_range(const ConvJob* job, uint32_t m0, uint32_t m1, uint32_t c0, uint32_t c1,
+                       int16_t* scratch) {
+    const AiGemmParams* p = job->p;
+    const uint32_t depth = ai_gemm_depth(p->k);
+    const uint32_t nc = channel_block(p);
+
+    // One channel block's weights stay cached while every pixel panel passes;
+    // panels are re-packed per block (cheap next to NC x K MACs per row)
+    for (uint32_t n0 = c0; n0 < c1; n0 += nc) {
+        uint32_t n1 = (c1 - n0 < nc) ? c1 : n0 + nc;
+
+        for (uint32_t m = m0; m < m1; m += AI_GEMM_MR) {
+            uint32_t rows = (m1 - m < AI_GEMM_MR) ? m1 - m : AI_GEMM_MR;
+            for (uint32_t r = 0; r < rows; r++) {
+                uint32_t pixel = m + r;
+                pack_pixel(job->in, job->w, job->h, job->c, p->a_zero, (int32_t)(job->x0 + pixel % job->out_w),
+                           (int32_t)(job->y0 + pixel / job->out_w), depth, scratch + r * depth);
+            }
+            gemm_panel(p, scratch, rows, panel_live(p, scratch, rows), n0, n1, job->out + m * p->n);
+        }
+    }
+}
+
+static void conv_task(void* ctx, uint32_t task, uint32_t worker) {
+    const ConvJob* job = (const ConvJob*)ctx;
+    int16_t* scratch = worker ? job->p->pool->scratch[worker] : job->scratch;
+    uint32_t begin, end;
+
+    if (job->by_channel) {
+        split(job->p->n, AI_GEMM_NR, job->tasks, task, &begin, &end);
+        conv_range(job, 0, job->m, begin, end, scratch);
+    } else {
+        split(job->m, AI_GEMM_MR, job->tasks, task, &begin, &end);
+        conv_range(job, begin, end, 0, job->p->n, scratch);
+    }
+}
+
+void ai_gemm_conv3x3(const AiGemmParams* p, const int8_t* in, uint32_t w, uint32_t h,
+                     uint32_t c, int8_t* out, int16_t* scratch) {
+    ai_gemm_conv3x3_window(p, in, w, h, c, 0, 0, w, h, out, scratch);
+}
+
+void ai_gemm_conv3x3_window(const AiGemmParams* p, const int8_t* in, uint32_t w, uint32_t h,
+                            uint32_t c, uint32_t x0, uint32_t y0, uint32_t out_w, uint32_t out_h,
+                            int8_t* out, int16_t* scratch) {
+    ConvJob job = { p, in, w, h, c, x0, y0, out_w, out_w * out_h, out, scratch, 1u, 0 };
+
+    // Pixel ranges, unless too few panels to go round (e.g. one fused row pair)
+    const uint32_t panels = (job.m + AI_GEMM_MR - 1u) / AI_GEMM_MR;
+    const uint32_t pairs = (p->n + AI_GEMM_NR - 1u) / AI_GEMM_NR;
+    job.tasks = ai_gemm_tasks(p->pool, (uint64_t)job.m * p->n * p->k);
+    job.by_channel = panels < job.tasks && pairs > panels;
+    if (job.tasks > (job.by_channel ? pairs : panels)) job.tasks = job.by_channel ? pairs : panels;
+
+    if (job.tasks <= 1u) {
+        conv_range(&job, 0, job.m, 0, p->n, scratch);
+    } else {
+        p->pool->run(p->pool->user, conv_task, &job, job.tasks);
+    }
+}
+
+// A dense layer's channel ranges over the packed A row
+typedef struct {
+    const AiGemmParams* p;
+    const int16_t* panel;
+    int32_t live;
+    int8_t* out;
+    uint32_t tasks;
+} DenseJob;
+
+static void dense_task(void* ctx, uint32_t task, uint32_t worker) {
+    const DenseJob* job = (const DenseJob*)ctx;
+    uint32_t begin, end;
+    (void)worker;
+
+    split(job->p->n, AI_GEMM_NR, job->tasks, task, &begin, &end);
+    gemm_panel(job->p, job->panel, 1, job->live, begin, end, job->out);
+}
+
+void ai_gemm_dense_packed(const AiGemmParams* p, int8_t* out, int16_t* scratch) {
+    DenseJob job = { p, scratch, panel_live(p, scratch, 1), out, 1u };
+
+    // GEMV: a single row, every weight used once - no blocking to gain;
+    // workers share the panel and take whole channel pairs
+    const uint32_t pairs = (p->n + AI_GEMM_NR - 1u) / AI_GEMM_NR;
+    job.tasks = ai_gemm_tasks(p->pool, (uint64_t)p->n * p->k);
+    if (job.tasks > pairs) job.tasks = pairs;
+
+    if (job.tasks <= 1u) {
+        gemm_panel(p, scratch, 1, job.live, 0, p->n, out);
+    } else {
+        p->pool->run(p->pool->user, dense_task, &job, job.tasks);
+    }
+}
+
+void ai_gemm_dense(const AiGemmParams* p, const int8_t* in, int8_t* out, int16_t* scratch) {
+    const uint32_t depth = ai_gemm_depth(p->k);
+    uint32_t k = 0;
+
+    for (; k < p->k; k++) scratch[ai_gemm_panel_index(k)] = (int16_t)(in[k] - p->a_zero);
+    for (; k < depth; k++) scratch[ai_gemm_panel_index(k)] = 0;
+
+    ai_gemm_dense_packed(p, out, scratch);
+}
@@ -5,34 +5,170 @@
 
 #include "stm32_ai_framework.h"
 #include "model_data.h"
+#include "ai_gemm.h"
 #include <stdio.h>
 #include <math.h>
 
 /**
  * Initialize fire detection model
+ * Uses the built-in model (model_data.c)
  */
 int32_t fire_detection_init(FireDetectionModel* model) {
-    if (!model) return -1;
+    return fire_detection_init_model(model, model_data, model_data_len, &model_info);
+}
+
+/**
+ * Heads the framework understands: a fire head with MODEL_OUTPUT_SIZE
+ * values, optionally smoke (2 values) and a square location grid
+ */
+static int32_t check_heads(const AiHeadInfo* heads, uint32_t head_count) {
+    uint32_t tasks = 0;
+
+    for (uint32_t i = 0; i < head_count; i++) {
+        const AiHeadInfo* head = &heads[i];
+        uint32_t side = 0;
+        while ((side + 1) * (side + 1) <= head->count) side++;
+
+        if ((head->task == AI_TASK_FIRE && head->count != MODEL_OUTPUT_SIZE) ||
+            (head->task == AI_TASK_SMOKE && head->count != 2) ||
+            (head->task == AI_TASK_LOCATION &&
+             (head->count > AI_LOCATION_MAX_CELLS || side * side != head->count))) {
+            return -1;
+        }
+        tasks |= AI_TASK_BIT(head->task);
+    }
+    return (tasks & AI_TASK_BIT(AI_TASK_FIRE)) ? 0 : -1;
+}
+
+/**
+ * Validate an image the way init takes it, without touching any context
+ * Returns the engine layer count, 0 for a non-engine image (mock output)
+ * or -1; heads and header are filled for engine models.
+ */
+static int32_t check_model(const uint8_t* data, uint32_t size, AiHeadInfo* heads, uint32_t* head_count,
+                           AiModelHeader* header) {
+    int32_t layers = ai_engine_check(data, size, AI_ENGINE_ARENA_SIZE, header);
+
+    *head_count = 0;
+    if (layers == AI_ENGINE_ERR_FORMAT) return 0;
+    if (layers <= 0) {
+        printf("  Engine model rejected (%ld)\n", (long)layers);
+        return -1;
+    }
+    *head_count = ai_engine_heads(data, heads, AI_ENGINE_MAX_HEADS);
+    if (*head_count ? check_heads(heads, *head_count) != 0
+                    : ai_engine_output_count(data) != MODEL_OUTPUT_SIZE) {
+        printf("  Engine model outputs do not match the framework's heads\n");
+        return -1;
+    }
+    return layers;
+}
+
+int32_t fire_detection_check_model(const uint8_t* data, uint32_t size) {
+    AiHeadInfo heads[AI_ENGINE_MAX_HEADS];
+    uint32_t head_count;
+    AiModelHeader header;
+
+    if (!data) return -1;
+    return (check_model(data, size, heads, &head_count, &header) < 0) ? -1 : 0;
+}
+
+static const AiHeadInfo* find_head(const FireDetectionModel* model, uint32_t task) {
+    for (uint32_t i = 0; i < model->head_count; i++) {
+        if (model->heads[i].task == task) return &model->heads[i];
+    }
+    return NULL;
+}
+
+/**
+ * Initialize a context on an explicit model image
+ * The model bytes and info are only referenced, never written, so one
+ * image can back many contexts (e.g. one per host thread). The image is
+ * validated first: a rejected one leaves the context as it was.
+ */
+int32_t fire_detection_init_model(FireDetectionModel* model, const uint8_t* data,
+                                  uint32_t size, const ModelInfo* info) {
+    if (!model || !data || !info) return -1;
+    
+    // Engine models (FDM1) run on the int8 interpreter; anything else
+    // (e.g. the TFLite placeholder) keeps the mock output
+    AiHeadInfo heads[AI_ENGINE_MAX_HEADS] = {0};
+    uint32_t head_count;
+    AiModelHeader header;
+    int32_t layers = check_model(data, size, heads, &head_count, &header);
+    if (layers < 0) return -1;
     
     // Initialize buffers
     memset(model->input_buffer, 0, sizeof(model->input_buffer));
     memset(model->output_buffer, 0, sizeof(model->output_buffer));
+    memset(model->smoke_buffer, 0, sizeof(model->smoke_buffer));
+    memset(model->location_buffer, 0, sizeof(model->location_buffer));
+    model->fire_margin = -INFINITY;
+    model->smoke_margin = -INFINITY;
+    memcpy(model->heads, heads, sizeof(heads));
+    model->head_count = head_count;
+    model->task_mask = AI_TASKS_ALL;
+    model->tasks_run = 0;
+    model->cam_enabled = 0;
+    model->pool = NULL;
+    memset(&model->cam, 0, sizeof(model->cam));
+    model->inference_time_ms = 0;
     
     // Set model data
-    model->model_data = (uint8_t*)model_data;
-    model->model_size = model_data_len;
+    model->model_data = data;
+    model->model_size = size;
+    model->info = info;
+    model->engine_layers = layers;
     
-    printf("  Model Size: %lu bytes\n", model->model_size);
+    printf("  Model Size: %lu bytes\n", (unsigned long)model->model_size);
     printf("  Input Buffer: %.1f KB\n", sizeof(model->input_buffer) / 1024.0);
+    if (layers > 0) {
+        printf("  Engine: %ld layers, arena %lu bytes\n", (long)layers, (unsigned long)header.arena_size);
+        if (model->head_count) printf("  Heads: %lu (shared backbone)\n", (unsigned long)model->head_count);
+        if (ai_engine_state_size(data)) {
+            printf("  Temporal state: %lu bytes\n", (unsigned long)ai_engine_state_size(data));
+        }
+        ai_engine_reset_state(data, model->arena);
+    }
     
     return 0; // Success
 }
 
+uint32_t fire_detection_context_size(void) {
+    return sizeof(FireDetectionModel);
+}
+
+void fire_detection_set_tasks(FireDetectionModel* model, uint32_t task_mask) {
+    model->task_mask = task_mask;
+}
+
+int32_t fire_detection_set_cam(FireDetectionModel* model, int32_t enable) {
+    if (enable && (model->engine_layers <= 0 || ai_engine_cam_check(model->model_data) != AI_ENGINE_OK)) {
+        return -1;
+    }
+    model->cam_enabled = (enable != 0);
+    model->cam.valid = 0;
+    return 0;
+}
+
+int32_t fire_detection_set_pool(FireDetectionModel* model, const struct AiGemmPool* pool) {
+    if (pool && (model->engine_layers <= 0 ||
+                 pool->scratch_size < ai_engine_worker_scratch_size(model->model_data))) {
+        return -1;
+    }
+    model->pool = pool;
+    return 0;
+}
+
+void fire_detection_reset_state(FireDetectionModel* model) {
+    if (model->engine_layers > 0) ai_engine_reset_state(model->model_data, model->arena);
+}
+
 /**
  * Preprocess image for model input
  */
 void preprocess_image(uint8_t* raw_image, uint32_t raw_size, float* normalized_image) {
-    for (uint32_t i = 0; i < 1024; i++) {
+    for (uint32_t i = 0; i < AI_ENGINE_MAX_INPUT; i++) {
         if (i < raw_size) {
             // Normalize to 0-1 range
             normalized_image[i] = (float)raw_image[i] / 255.0f;
@@ -42,52 +178,312 @@ void preprocess_image(uint8_t* raw_image, uint32_t raw_size, float* normalized_i
     }
 }
 
+/**
+ * Resize an arbitrary grayscale frame to the model input and normalize
+ *
+ * Same sampling as cv2.resize(INTER_LINEAR) used by the desktop
+ * simulator (pixel centers aligned, edges clamped), so a 1/8-scale
+ * DCT-domain decode can be fed in place of a full-resolution frame.
+ * The input size is the context's model, which a model update may change:
+ * a model larger than capacity floats is refused (-1), nothing written.
+ */
+int32_t preprocess_image_scaled(const FireDetectionModel* model, const uint8_t* image, uint32_t width,
+                                uint32_t height, float* normalized_image, uint32_t capacity) {
+    const uint32_t out_w = model->info->input_width;
+    const uint32_t out_h = model->info->input_height;
+    if (out_w == 0 || out_h == 0 || out_w * out_h > capacity) {
+        return -1;
+    }
+
+    const float scale_x = (float)width / out_w;
+    const float scale_y = (float)height / out_h;
+
+    for (uint32_t y = 0; y < out_h; y++) {
+        float sy = (y + 0.5f) * scale_y - 0.5f;
+        if (sy < 0.0f) sy = 0.0f;
+        uint32_t y0 = (uint32_t)sy;
+        uint32_t y1 = (y0 + 1 < height) ? y0 + 1 : y0;
+        float fy = sy - y0;
+
+        for (uint32_t x = 0; x < out_w; x++) {
+            float sx = (x + 0.5f) * scale_x - 0.5f;
+            if (sx < 0.0f) sx = 0.0f;
+            uint32_t x0 = (uint32_t)sx;
+            uint32_t x1 = (x0 + 1 < width) ? x0 + 1 : x0;
+            float fx = sx - x0;
+
+            float top = image[y0 * width + x0] + fx * (image[y0 * width + x1] - image[y0 * width + x0]);
+            float bottom = image[y1 * width + x0] + fx * (image[y1 * width + x1] - image[y1 * width + x0]);
+            normalized_image[y * out_w + x] = (top + fy * (bottom - top)) / 255.0f;
+        }
+    }
+    return 0;
+}
+
+static void softmax(const float* logits, uint32_t n, float* probs) {
+    float m = logits[0];
+    for (uint32_t i = 1; i < n; i++) {
+        if (logits[i] > m) m = logits[i];
+    }
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        probs[i] = expf(logits[i] - m);
+        sum += probs[i];
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        probs[i] /= sum;
+    }
+}
+
+/**
+ * Softmax of each head's logits into its buffer; returns P(fire)
+ * A failed run, or a skipped head, reports no detection.
+ */
+static float engine_output(FireDetectionModel* model, const float* logits, int32_t status) {
+    model->output_buffer[0] = 1.0f;
+    model->output_buffer[1] = 0.0f;
+    model->smoke_buffer[0] = 1.0f;
+    model->smoke_buffer[1] = 0.0f;
+    memset(model->location_buffer, 0, sizeof(model->location_buffer));
+    model->fire_margin = -INFINITY;
+    model->smoke_margin = -INFINITY;
+    model->tasks_run = 0;
+    
+    if (model->head_count == 0) {
+        if (status != MODEL_OUTPUT_SIZE) return 0.0f;
+        softmax(logits, MODEL_OUTPUT_SIZE, model->output_buffer);
+        model->fire_margin = logits[1] - logits[0];
+        model->tasks_run = AI_TASK_BIT(AI_TASK_FIRE);
+        return model->output_buffer[1];
+    }
+    if (status < 0) return 0.0f;
+    
+    for (uint32_t i = 0; i < model->head_count; i++) {
+        const AiHeadInfo* head = &model->heads[i];
+        if (!(model->task_mask & AI_TASK_BIT(head->task))) continue;
+        
+        float* probs = (head->task == AI_TASK_FIRE)  ? model->output_buffer :
+                       (head->task == AI_TASK_SMOKE) ? model->smoke_buffer : model->location_buffer;
+        softmax(logits + head->offset, head->count, probs);
+        if (head->task == AI_TASK_FIRE) model->fire_margin = logits[head->offset + 1] - logits[head->offset];
+        if (head->task == AI_TASK_SMOKE) model->smoke_margin = logits[head->offset + 1] - logits[head->offset];
+        model->tasks_run |= AI_TASK_BIT(head->task);
+    }
+    return model->output_buffer[1];
+}
+
+/**
+ * Mock output from the mean input brightness (placeholder models)
+ */
+static float mock_output(FireDetectionModel* model, float avg) {
+    // Outputs stay in the context: [no_fire, fire]
+    model->output_buffer[0] = 1.0f - avg;
+    model->output_buffer[1] = avg;
+    model->fire_margin = (avg <= 0.0f) ? -INFINITY : (avg >= 1.0f) ? INFINITY : logf(avg / (1.0f - avg));
+    model->tasks_run = AI_TASK_BIT(AI_TASK_FIRE);
+    
+    // Return confidence between 0 and 1
+    return avg;
+}
+
 /**
  * Run inference on preprocessed image
  * 
- * In production, this calls TensorFlow Lite interpreter:
- * 
- * tflite::MicroInterpreter interpreter(model_data, resolver, tensor_arena, 
- *                                      tensor_arena_size, error_reporter);
- * interpreter.Invoke();
+ * Engine models (FDM1, written by the converter's engine exporter) run on
+ * the int8 interpreter in ai_engine.c; the last layer's logits go
+ * through a softmax into output_buffer.
  * 
- * For now, returns mock value for demonstration
+ * Other images (the TFLite placeholder) return a mock value based on
+ * the input, for demonstration
  */
 float fire_detection_inference(FireDetectionModel* model) {
-    // Placeholder implementation
-    // In real implementation, invoke TFLite interpreter
+    if (model->engine_layers > 0) {
+        float logits[AI_ENGINE_MAX_OUTPUT];
+        AiCam* cam = model->cam_enabled ? &model->cam : NULL;
+        int32_t n = ai_engine_run_parallel(model->model_data, model->input_buffer, NULL, model->arena,
+                                           model->task_mask, logits, AI_ENGINE_MAX_OUTPUT, cam, model->pool);
+        return engine_output(model, logits, n);
+    }
     
     // Calculate mock confidence based on input
     float sum = 0.0f;
-    for (int i = 0; i < 1024; i++) {
+    for (int i = 0; i < AI_ENGINE_MAX_INPUT; i++) {
         sum += model->input_buffer[i];
     }
-    float avg = sum / 1024.0f;
+    return mock_output(model, sum / AI_ENGINE_MAX_INPUT);
+}
+
+/**
+ * Run inference on an 8-bit frame
+ *
+ * The frame must match the model's input shape. Engine models quantize it
+ * directly (same values as preprocess_image() + fire_detection_inference()),
+ * so inputs larger than input_buffer - e.g. 128x128 patch-based models -
+ * need no float copy.
+ */
+float fire_detection_inference_image(FireDetectionModel* model, const uint8_t* image) {
+    if (model->engine_layers > 0) {
+        float logits[AI_ENGINE_MAX_OUTPUT];
+        AiCam* cam = model->cam_enabled ? &model->cam : NULL;
+        int32_t n = ai_engine_run_parallel(model->model_data, NULL, image, model->arena, model->task_mask,
+                                           logits, AI_ENGINE_MAX_OUTPUT, cam, model->pool);
+        return engine_output(model, logits, n);
+    }
     
-    // Return confidence between 0 and 1
-    return avg;
+    uint32_t pixels = model->info->input_width * model->info->input_height *
+                      model->info->input_channels;
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < pixels; i++) {
+        sum += image[i] / 255.0f;
+    }
+    return mock_output(model, pixels ? sum / pixels : 0.0f);
+}
+
+/* ==================== THRESHOLDS ==================== */
+
+// Logit fields: ln(0.7 / 0.3), ln(0.9 / 0.1)
+const DetectionThresholds detection_default_thresholds = {
+    .fire = 0.7f,
+    .critical = 0.9f,
+    .smoke = 0.7f,
+    .crackle = AUDIO_CRACKLE_THRESHOLD,
+    .promote_thermal = 0.4f,
+    .promote_analog = 0.5f,
+    .promote_audio = 0.5f,
+    .fire_logit = 0.84729786f,
+    .critical_logit = 2.19722458f,
+    .smoke_logit = 0.84729786f,
+};
+
+static float logit(float p) {
+    return logf(p / (1.0f - p));
+}
+
+void detection_thresholds_derive(DetectionThresholds* th) {
+    th->fire_logit = logit(th->fire);
+    th->critical_logit = logit(th->critical);
+    th->smoke_logit = logit(th->smoke);
 }
 
 /**
  * Process inference output
+ * Decisions compare the logit margins with the derived thresholds.
  */
-DetectionResult process_detection_output(FireDetectionModel* model) {
+DetectionResult process_detection_output(FireDetectionModel* model, const DetectionThresholds* th) {
     DetectionResult result = {0};
+    if (!th) th = &detection_default_thresholds;
     
     // Get output probabilities
-    float no_fire_prob = 1.0f - model->output_buffer[0];
-    float fire_prob = model->output_buffer[0];
+    float fire_prob = model->output_buffer[1];
     
     result.confidence = fire_prob;
     
-    // Apply confidence threshold (0.7 = 70%)
-    if (fire_prob > 0.7f) {
+    // Apply confidence threshold (default 0.7 = 70%)
+    if (model->fire_margin > th->fire_logit) {
         result.fire_detected = 1;
-        result.alert_level = (fire_prob > 0.9f) ? 2 : 1;
+        result.alert_level = (model->fire_margin > th->critical_logit) ? 2 : 1;
     } else {
         result.fire_detected = 0;
         result.alert_level = 0;
     }
     
+    // Multi-task heads (only those that ran this frame)
+    if (model->tasks_run & AI_TASK_BIT(AI_TASK_SMOKE)) {
+        result.smoke_confidence = model->smoke_buffer[1];
+        result.smoke_detected = (model->smoke_margin > th->smoke_logit);
+    }
+    const AiHeadInfo* location = find_head(model, AI_TASK_LOCATION);
+    if (location && result.fire_detected && (model->tasks_run & AI_TASK_BIT(AI_TASK_LOCATION))) {
+        uint32_t best = 0, side = 0;
+        while ((side + 1) * (side + 1) <= location->count) side++;
+        for (uint32_t i = 1; i < location->count; i++) {
+            if (model->location_buffer[i] > model->location_buffer[best]) best = i;
+        }
+        result.location_valid = 1;
+        result.location_x = (uint8_t)(best % side);
+        result.location_y = (uint8_t)(best / side);
+        result.location_grid = (uint8_t)side;
+        result.location_confidence = model->location_buffer[best];
+    }
+    if (model->cam_enabled && model->cam.valid && result.fire_detected) {
+        float top = 0.0f;
+        for (uint32_t i = 0; i < AI_CAM_CELLS; i++) {
+            if (model->cam.heat[i] > top) top = model->cam.heat[i];
+        }
+        // Cells that argue against fire show as 0
+        for (uint32_t i = 0; i < AI_CAM_CELLS && top > 0.0f; i++) {
+            float v = model->cam.heat[i] > 0.0f ? model->cam.heat[i] * 255.0f / top : 0.0f;
+            result.cam_heat[i] = (uint8_t)(v + 0.5f);
+        }
+        result.cam_valid = 1;
+        result.cam_peak_x = model->cam.peak_x;
+        result.cam_peak_y = model->cam.peak_y;
+    }
+    
     return result;
 }
+
+/**
+ * Fuse thermal hot spots into a detection
+ */
+void fire_detection_fuse_thermal(DetectionResult* result, const ThermalHotspots* spots,
+                                 const DetectionThresholds* th) {
+    uint32_t hot;
+    if (!th) th = &detection_default_thresholds;
+
+    result->temperature_estimate = spots->max_dc / 10.0f;
+
+    if (result->location_valid && result->location_grid) {
+        // Thermal pixels covered by the location cell
+        uint32_t grid = result->location_grid;
+        hot = thermal_hot_in_region(spots,
+                                    result->location_x * THERMAL_WIDTH / grid,
+                                    result->location_y * THERMAL_HEIGHT / grid,
+                                    (result->location_x + 1u) * THERMAL_WIDTH / grid,
+                                    (result->location_y + 1u) * THERMAL_HEIGHT / grid);
+    } else {
+        hot = spots->hot_pixels;
+    }
+    result->thermal_hot = (hot >= THERMAL_MIN_HOT_PIXELS);
+
+    if (result->fire_detected) {
+        // Heat only raises the alert: the vision level stands without it
+        if (result->thermal_hot && result->alert_level < 2) result->alert_level = 2;
+    } else if (spots->max_dc >= THERMAL_FIRE_DC && result->thermal_hot &&
+               result->confidence >= th->promote_thermal) {
+        result->fire_detected = 1;
+        if (result->alert_level < 1) result->alert_level = 1;
+    }
+}
+
+/**
+ * Fuse the analog channel decision into a detection
+ */
+void fire_detection_fuse_analog(DetectionResult* result, const AnalogDecision* decision,
+                                const DetectionThresholds* th) {
+    if (!th) th = &detection_default_thresholds;
+    result->analog_level = decision->level;
+
+    if (result->fire_detected) {
+        if (decision->level != ANALOG_QUIET) result->alert_level = 2;
+    } else if (decision->level == ANALOG_ALARM && result->confidence >= th->promote_analog) {
+        result->fire_detected = 1;
+        result->alert_level = 1;
+    }
+}
+
+/**
+ * Fuse the crackle classifier output into a detection
+ */
+void fire_detection_fuse_audio(DetectionResult* result, float crackle, const DetectionThresholds* th) {
+    if (!th) th = &detection_default_thresholds;
+    result->crackle_confidence = crackle;
+    result->crackle_detected = (crackle >= th->crackle);
+
+    if (result->fire_detected) {
+        if (result->crackle_detected) result->alert_level = 2;
+    } else if (result->crackle_detected && result->confidence >= th->promote_audio) {
+        result->fire_detected = 1;
+        result->alert_level = 1;
+    }
+}
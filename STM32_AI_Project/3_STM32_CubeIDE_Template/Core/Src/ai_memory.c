@@ -0,0 +1,224 @@
+/*
+ * Memory Map and Cache Maintenance
+ * MPU setup and D-cache maintenance (target), per-line cache model (checker)
+ */
+
+#include "ai_memory.h"
+
+#if defined(AI_CACHE_CHECK)
+
+/* ==================== CHECKER ==================== */
+// Every line a DMA transfer or a maintenance call has touched gets a
+// state; lines the model has never seen are CPU-only memory and ignored.
+// Speculative refills are assumed: a line the device wrote is stale for
+// the CPU until it is invalidated after the write, cached or not.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK_MAX_REGIONS  32
+
+#define LINE_STALE         0x01      // Device wrote memory behind the cache
+#define LINE_DIRTY         0x02      // CPU wrote the cache, not cleaned
+
+typedef struct {
+    uintptr_t first;                 // Line address
+    uint32_t lines;
+    uint8_t* state;
+} CheckRegion;
+
+static CheckRegion regions[CHECK_MAX_REGIONS];
+static uint32_t region_count;
+static uint32_t violations;
+static char last_violation[160];
+
+static void violation(const char* what, uintptr_t addr) {
+    violations++;
+    snprintf(last_violation, sizeof(last_violation), "%s at %#lx", what, (unsigned long)addr);
+}
+
+static uint8_t* line_state(uintptr_t line) {
+    for (uint32_t i = 0; i < region_count; i++) {
+        CheckRegion* r = &regions[i];
+        if (line >= r->first && line < r->first + (uintptr_t)r->lines * AI_CACHE_LINE) {
+            return &r->state[(line - r->first) / AI_CACHE_LINE];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Track every line of [addr, addr + bytes) not tracked yet
+ */
+static void track(const void* addr, uint32_t bytes) {
+    uintptr_t line = (uintptr_t)addr & ~(uintptr_t)(AI_CACHE_LINE - 1);
+    uintptr_t end = (uintptr_t)addr + bytes;
+
+    while (line < end) {
+        if (line_state(line)) {
+            line += AI_CACHE_LINE;
+            continue;
+        }
+        uintptr_t run = line;
+        while (run < end && !line_state(run)) run += AI_CACHE_LINE;
+
+        if (region_count == CHECK_MAX_REGIONS) {
+            violation("checker: too many DMA regions", line);
+            return;
+        }
+        CheckRegion* r = &regions[region_count++];
+        r->first = line;
+        r->lines = (uint32_t)((run - line) / AI_CACHE_LINE);
+        r->state = calloc(r->lines, 1);
+        line = run;
+    }
+}
+
+#define FOR_EACH_LINE(addr, bytes, s)                                                         \
+    for (uintptr_t line_ = (uintptr_t)(addr) & ~(uintptr_t)(AI_CACHE_LINE - 1);               \
+         line_ < (uintptr_t)(addr) + (bytes); line_ += AI_CACHE_LINE)                         \
+        if (((s) = line_state(line_)) != NULL)
+
+void ai_memory_init(void) {
+}
+
+void ai_cache_receive(const void* addr, uint32_t bytes) {
+    uint8_t* s;
+    track(addr, bytes);
+    FOR_EACH_LINE(addr, bytes, s) *s = 0;  // Written back, then dropped
+}
+
+void ai_cache_invalidate(const void* addr, uint32_t bytes) {
+    uint8_t* s;
+    if (((uintptr_t)addr | bytes) & (AI_CACHE_LINE - 1)) {
+        violation("invalidate of a partial cache line (neighbouring CPU writes lost)", (uintptr_t)addr);
+    }
+    track(addr, bytes);
+    FOR_EACH_LINE(addr, bytes, s) {
+        if (*s & LINE_DIRTY) violation("invalidate discards CPU writes (clean first)", line_);
+        *s = 0;
+    }
+}
+
+void ai_cache_clean(const void* addr, uint32_t bytes) {
+    uint8_t* s;
+    track(addr, bytes);
+    FOR_EACH_LINE(addr, bytes, s) *s &= (uint8_t)~LINE_DIRTY;
+}
+
+void ai_cache_cpu_read(const void* addr, uint32_t bytes) {
+    uint8_t* s;
+    FOR_EACH_LINE(addr, bytes, s) {
+        if (*s & LINE_STALE) {
+            violation("CPU read of DMA data without invalidate", line_);
+            return;
+        }
+    }
+}
+
+void ai_cache_cpu_write(const void* addr, uint32_t bytes) {
+    uint8_t* s;
+    FOR_EACH_LINE(addr, bytes, s) {
+        if (*s & LINE_STALE) violation("CPU write into DMA data without invalidate", line_);
+        *s = LINE_DIRTY;
+    }
+}
+
+void ai_dma_declare(const void* addr, uint32_t bytes) {
+    uint8_t* s;
+    track(addr, bytes);
+    FOR_EACH_LINE(addr, bytes, s) *s = LINE_DIRTY;
+}
+
+void ai_dma_device_write(const void* addr, uint32_t bytes) {
+    uint8_t* s;
+    track(addr, bytes);
+    FOR_EACH_LINE(addr, bytes, s) {
+        if (*s & LINE_DIRTY) violation("DMA write over a dirty line (ai_cache_receive first)", line_);
+        *s = LINE_STALE;
+    }
+}
+
+void ai_dma_device_read(const void* addr, uint32_t bytes) {
+    uint8_t* s;
+    track(addr, bytes);
+    FOR_EACH_LINE(addr, bytes, s) {
+        if (*s & LINE_DIRTY) {
+            violation("DMA read of CPU data without clean", line_);
+            return;
+        }
+    }
+}
+
+uint32_t ai_cache_violations(void) {
+    return violations;
+}
+
+const char* ai_cache_last_violation(void) {
+    return last_violation;
+}
+
+void ai_cache_check_reset(void) {
+    for (uint32_t i = 0; i < region_count; i++) {
+        free(regions[i].state);
+    }
+    region_count = 0;
+    violations = 0;
+    last_violation[0] = '\0';
+}
+
+#elif defined(AI_MEMORY_TARGET)
+
+/* ==================== TARGET ==================== */
+
+#include "main.h"
+
+void ai_memory_init(void) {
+    MPU_Region_InitTypeDef region = {0};
+
+    HAL_MPU_Disable();
+
+    // D2 SRAM1/2: DMA buffers, write-back read/write-allocate; not
+    // shareable (shareable memory is not cached by the M7)
+    region.Enable = MPU_REGION_ENABLE;
+    region.Number = MPU_REGION_NUMBER0;
+    region.BaseAddress = AI_DMA_REGION_BASE;
+    region.Size = MPU_REGION_SIZE_256KB;
+    region.SubRegionDisable = 0x00;
+    region.TypeExtField = MPU_TEX_LEVEL1;
+    region.AccessPermission = MPU_REGION_FULL_ACCESS;
+    region.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+    region.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+    region.IsCacheable = MPU_ACCESS_CACHEABLE;
+    region.IsBufferable = MPU_ACCESS_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&region);
+
+    // SRAM3: descriptors, normal non-cacheable (higher region number wins)
+    region.Number = MPU_REGION_NUMBER1;
+    region.BaseAddress = AI_NOCACHE_BASE;
+    region.Size = MPU_REGION_SIZE_32KB;
+    region.TypeExtField = MPU_TEX_LEVEL1;
+    region.IsShareable = MPU_ACCESS_SHAREABLE;
+    region.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+    region.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&region);
+
+    HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+
+    SCB_EnableICache();
+    SCB_EnableDCache();
+}
+
+void ai_cache_receive(const void* addr, uint32_t bytes) {
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t*)(uintptr_t)addr, (int32_t)bytes);
+}
+
+void ai_cache_invalidate(const void* addr, uint32_t bytes) {
+    SCB_InvalidateDCache_by_Addr((uint32_t*)(uintptr_t)addr, (int32_t)bytes);
+}
+
+void ai_cache_clean(const void* addr, uint32_t bytes) {
+    SCB_CleanDCache_by_Addr((uint32_t*)(uintptr_t)addr, (int32_t)bytes);
+}
+
+#endif
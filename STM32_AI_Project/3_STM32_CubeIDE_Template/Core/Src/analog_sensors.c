@@ -0,0 +1,190 @@
+/*
+ * Analog Sensor Acquisition
+ * CIC + FIR decimation in the DMA callbacks, baseline / slope trends
+ */
+
+#include "analog_sensors.h"
+#include "ai_memory.h"
+#include <string.h>
+
+// Hamming-windowed lowpass (4.5 Hz at the 62.5 Hz CIC rate), Q15, sums to 32768
+static const int16_t fir_taps[ANALOG_FIR_TAPS] = {
+    -32, 44, 305, 939, 1997, 3313, 4538, 5280,
+    5280, 4538, 3313, 1997, 939, 305, 44, -32
+};
+
+// Smoke / CO / temperature; starting points, tune on the installed sensors
+static const AnalogThresholds default_thresholds[ANALOG_CHANNELS] = {
+    { 80 * 16, 300 * 16, 20 * 16 },  // Smoke: scattered light
+    { 60 * 16, 250 * 16, 15 * 16 },  // CO: electrochemical cell
+    { 200 * 16, 600 * 16, 8 * 16 },  // Temperature: rate of rise
+};
+
+void analog_init(AnalogAcquisition* acq, const uint16_t* dma_buffer, const AnalogThresholds* thresholds) {
+    memset(acq, 0, sizeof(*acq));
+    acq->dma_buffer = dma_buffer;
+    memcpy(acq->thresholds, thresholds ? thresholds : default_thresholds, sizeof(acq->thresholds));
+}
+
+/* ==================== DECIMATION ==================== */
+
+/**
+ * One ADC sample through the CIC; returns 1 with *y set on every
+ * ANALOG_CIC_DECIM-th sample
+ */
+static inline int32_t cic_step(AnalogFilter* f, uint32_t x, int32_t* y) {
+    f->integrator[0] += x;
+    for (uint32_t i = 1; i < ANALOG_CIC_ORDER; i++) {
+        f->integrator[i] += f->integrator[i - 1];
+    }
+    if (++f->cic_phase < ANALOG_CIC_DECIM) {
+        return 0;
+    }
+    f->cic_phase = 0;
+
+    uint32_t v = f->integrator[ANALOG_CIC_ORDER - 1];
+    for (uint32_t i = 0; i < ANALOG_CIC_ORDER; i++) {
+        uint32_t prev = f->comb[i];
+        f->comb[i] = v;
+        v -= prev;
+    }
+    *y = (int32_t)(v >> ANALOG_CIC_SHIFT);
+    return 1;
+}
+
+/**
+ * One CIC output through the FIR; returns 1 with *y set on every
+ * ANALOG_FIR_DECIM-th input
+ */
+static inline int32_t fir_step(AnalogFilter* f, int32_t x, int32_t* y) {
+    f->fir_history[f->fir_pos] = x;
+    f->fir_pos = (f->fir_pos + 1) & (ANALOG_FIR_TAPS - 1);
+    if (++f->fir_phase < ANALOG_FIR_DECIM) {
+        return 0;
+    }
+    f->fir_phase = 0;
+
+    int64_t acc = 1 << 14;
+    for (uint32_t k = 0; k < ANALOG_FIR_TAPS; k++) {
+        acc += (int64_t)fir_taps[k] * f->fir_history[(f->fir_pos + k) & (ANALOG_FIR_TAPS - 1)];
+    }
+    *y = (int32_t)(acc >> 15);
+    return 1;
+}
+
+static void filter_block(AnalogAcquisition* acq, const uint16_t* block) {
+    int32_t out[ANALOG_CHANNELS];
+    uint32_t produced = 0;
+
+    for (uint32_t ch = 0; ch < ANALOG_CHANNELS; ch++) {
+        AnalogFilter* f = &acq->filter[ch];
+        const uint16_t* s = block + ch;
+        int32_t cic;
+
+        for (uint32_t n = 0; n < ANALOG_HALF_FRAMES; n++, s += ANALOG_CHANNELS) {
+            if (cic_step(f, *s & 0x0FFFu, &cic) && fir_step(f, cic, &out[ch])) {
+                produced |= 1u << ch;
+            }
+        }
+    }
+    acq->blocks++;
+
+    // All channels share the phase: one output set per block
+    if (produced != (1u << ANALOG_CHANNELS) - 1) {
+        return;
+    }
+    uint32_t head = acq->out_head;
+    if (head - acq->out_tail >= ANALOG_OUT_RING) {
+        acq->dropped++;
+        return;
+    }
+    memcpy(acq->out[head & (ANALOG_OUT_RING - 1)], out, sizeof(out));
+    acq->out_head = head + 1;
+}
+
+#define ANALOG_HALF_BYTES      (ANALOG_HALF_FRAMES * ANALOG_CHANNELS * sizeof(uint16_t))
+
+/**
+ * Filter one DMA half; the DMA wrote it behind the D-cache
+ */
+static void receive_block(AnalogAcquisition* acq, const uint16_t* block) {
+    ai_cache_invalidate(block, ANALOG_HALF_BYTES);
+    AI_CACHE_CPU_READ(block, ANALOG_HALF_BYTES);
+    filter_block(acq, block);
+}
+
+void analog_dma_half(AnalogAcquisition* acq) {
+    receive_block(acq, acq->dma_buffer);
+}
+
+void analog_dma_complete(AnalogAcquisition* acq) {
+    receive_block(acq, acq->dma_buffer + ANALOG_HALF_FRAMES * ANALOG_CHANNELS);
+}
+
+/* ==================== TRENDS ==================== */
+
+static uint8_t trend_update(AnalogTrend* t, const AnalogThresholds* th, int32_t value,
+                            int32_t* rise, int32_t* slope) {
+    int32_t v = value << 8;
+
+    *rise = *slope = 0;
+    if (++t->outputs < ANALOG_SETTLE_OUTPUTS) {
+        return ANALOG_QUIET;  // CIC / FIR still filling from zero
+    }
+    if (t->outputs == ANALOG_SETTLE_OUTPUTS) {
+        t->baseline = t->fast = v;
+        for (uint32_t i = 0; i < ANALOG_SLOPE_WINDOW; i++) {
+            t->history[i] = v;
+        }
+    }
+    t->fast += (v - t->fast) >> ANALOG_FAST_SHIFT;
+
+    uint32_t slot = t->outputs % ANALOG_SLOPE_WINDOW;
+    *slope = (t->fast - t->history[slot]) >> 8;
+    t->history[slot] = t->fast;
+    *rise = (t->fast - t->baseline) >> 8;
+
+    uint8_t level = ANALOG_QUIET;
+    if (t->outputs >= ANALOG_SETTLE_OUTPUTS + ANALOG_SLOPE_WINDOW) {  // Slope history filled
+        if (*rise >= th->alarm_rise) {
+            level = ANALOG_ALARM;
+        } else if (*rise >= th->watch_rise || *slope >= th->watch_slope) {
+            level = ANALOG_WATCH;
+        }
+    }
+
+    // The baseline follows drift only while the channel is quiet
+    if (level == ANALOG_QUIET) {
+        t->baseline += (v - t->baseline) >> ANALOG_BASELINE_SHIFT;
+    }
+    t->level = level;
+    return level;
+}
+
+uint32_t analog_poll(AnalogAcquisition* acq) {
+    AnalogDecision* d = &acq->decision;
+    uint32_t consumed = 0;
+
+    while (acq->out_tail != acq->out_head) {
+        const int32_t* out = acq->out[acq->out_tail & (ANALOG_OUT_RING - 1)];
+        uint32_t watching = 0, alarm = 0;
+
+        d->channels = 0;
+        for (uint32_t ch = 0; ch < ANALOG_CHANNELS; ch++) {
+            uint8_t level = trend_update(&acq->trend[ch], &acq->thresholds[ch], out[ch],
+                                         &d->rise[ch], &d->slope[ch]);
+            d->value[ch] = out[ch];
+            if (level != ANALOG_QUIET) {
+                d->channels |= (uint8_t)(1u << ch);
+                watching++;
+                alarm |= (level == ANALOG_ALARM);
+            }
+        }
+        d->level = (alarm || watching >= 2) ? ANALOG_ALARM : watching ? ANALOG_WATCH : ANALOG_QUIET;
+        d->sequence++;
+
+        acq->out_tail++;
+        consumed++;
+    }
+    return consumed;
+}
@@ -0,0 +1,310 @@
+/*
+ * Audio Front-End
+ * Table-driven PDM decimation, Q15 real FFT, mel filterbank, log features
+ */
+
+#include "audio_frontend.h"
+#include "ai_memory.h"
+#include <math.h>
+#include <string.h>
+
+#define PCM_MASK               (AUDIO_PCM_RING - 1)
+#define FFT_POINTS             (AUDIO_FFT_SIZE / 2)    // Complex points of the packed frame
+#define FFT_HEADROOM           (1 << 14)               // Input bound: no overflow with per-stage halving
+#define DC_POLE_Q15            32604                   // 0.995: ~13 Hz corner
+#define PDM_KERNEL_SUM         (1 << 18)               // 64^3: every bit set
+#define TWO_PI                 6.28318530718f
+
+// round(8 * log2(1 + m / 16))
+static const uint8_t log2_mantissa[16] = { 0, 1, 1, 2, 3, 3, 4, 4, 5, 5, 6, 6, 6, 7, 7, 8 };
+
+/* ==================== TABLES ==================== */
+
+static float mel_of(float hz) {
+    return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+static float hz_of(float mel) {
+    return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+/**
+ * Byte-segment sums of the sinc^3 kernel: pdm_lut[j][v] is the kernel
+ * weight of the set bits of v as byte j of the window
+ */
+static void build_pdm_lut(AudioFrontEnd* fe) {
+    uint32_t kernel[AUDIO_PDM_WINDOW_BYTES * 8] = {0};
+    uint32_t box[AUDIO_PDM_TAPS] = {0};
+
+    // Coefficients of (1 + z + ... + z^(R-1))^N by repeated boxcar convolution
+    kernel[0] = 1;
+    uint32_t len = 1;
+    for (uint32_t stage = 0; stage < AUDIO_PDM_ORDER; stage++) {
+        memset(box, 0, sizeof(box));
+        for (uint32_t i = 0; i < len; i++) {
+            for (uint32_t k = 0; k < AUDIO_PDM_DECIM; k++) {
+                box[i + k] += kernel[i];
+            }
+        }
+        len += AUDIO_PDM_DECIM - 1;
+        memcpy(kernel, box, len * sizeof(uint32_t));
+    }
+
+    for (uint32_t j = 0; j < AUDIO_PDM_WINDOW_BYTES; j++) {
+        for (uint32_t v = 0; v < 256; v++) {
+            uint32_t sum = 0;
+            for (uint32_t bit = 0; bit < 8; bit++) {
+                if (v & (0x80u >> bit)) sum += kernel[8 * j + bit];
+            }
+            fe->pdm_lut[j][v] = (uint16_t)sum;
+        }
+    }
+}
+
+static void build_mel(AudioFrontEnd* fe) {
+    const float mel_low = mel_of(AUDIO_MEL_LOW_HZ);
+    const float mel_step = (mel_of(AUDIO_MEL_HIGH_HZ) - mel_low) / (AUDIO_MEL_BANDS + 1);
+    const float bin_hz = (float)AUDIO_SAMPLE_HZ / AUDIO_FFT_SIZE;
+    uint32_t used = 0;
+
+    for (uint32_t b = 0; b < AUDIO_MEL_BANDS; b++) {
+        float lo = hz_of(mel_low + b * mel_step);
+        float mid = hz_of(mel_low + (b + 1) * mel_step);
+        float hi = hz_of(mel_low + (b + 2) * mel_step);
+        AudioMelBand* band = &fe->mel[b];
+
+        band->first_bin = (uint16_t)ceilf(lo / bin_hz);
+        band->weights = (uint16_t)used;
+        band->bins = 0;
+        for (uint32_t k = band->first_bin; k * bin_hz < hi && k < AUDIO_BINS && used < AUDIO_MEL_WEIGHTS; k++) {
+            float f = k * bin_hz;
+            float w = (f <= mid) ? (f - lo) / (mid - lo) : (hi - f) / (hi - mid);
+            fe->mel_weights[used++] = (int16_t)lrintf(w * 32767.0f);
+            band->bins++;
+        }
+    }
+}
+
+void audio_init(AudioFrontEnd* fe) {
+    memset(fe, 0, sizeof(*fe));
+    build_pdm_lut(fe);
+    build_mel(fe);
+
+    for (uint32_t n = 0; n < AUDIO_FFT_SIZE; n++) {
+        float w = 0.5f - 0.5f * cosf(TWO_PI * n / AUDIO_FFT_SIZE);
+        fe->window[n] = (int16_t)lrintf(w * 32767.0f);
+    }
+    for (uint32_t k = 0; k < AUDIO_FFT_SIZE / 2; k++) {
+        float a = TWO_PI * k / AUDIO_FFT_SIZE;
+        fe->twiddle[k][0] = (int16_t)lrintf(cosf(a) * 32767.0f);
+        fe->twiddle[k][1] = (int16_t)lrintf(-sinf(a) * 32767.0f);
+    }
+}
+
+/* ==================== PCM INPUT ==================== */
+
+static inline void pcm_append(AudioFrontEnd* fe, int16_t sample) {
+    uint32_t head = fe->pcm_head;
+    fe->pcm[head & PCM_MASK] = sample;
+    fe->pcm_head = head + 1;
+}
+
+static inline int16_t saturate16(int32_t v) {
+    return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+/**
+ * One PCM sample from a window of AUDIO_PDM_WINDOW_BYTES bytes
+ */
+static inline int16_t pdm_sample(AudioFrontEnd* fe, const uint8_t* w) {
+    uint32_t ones = 0;
+    for (uint32_t j = 0; j < AUDIO_PDM_WINDOW_BYTES; j++) {
+        ones += fe->pdm_lut[j][w[j]];
+    }
+
+    // Bits are +-1: 2 * ones - kernel sum (R^N = 2^18), scaled to 16 bits
+    int32_t x = ((int32_t)(2 * ones) - PDM_KERNEL_SUM) >> 3;
+
+    // DC blocker: y = x - x[-1] + a * y[-1]
+    int32_t y = x - fe->dc_x + ((DC_POLE_Q15 * fe->dc_y) >> 15);
+    fe->dc_x = x;
+    fe->dc_y = y;
+    return saturate16(y);
+}
+
+void audio_pdm_push(AudioFrontEnd* fe, const uint8_t* pdm, uint32_t bytes) {
+    const uint32_t tail = sizeof(fe->pdm_tail);
+    uint8_t window[AUDIO_PDM_WINDOW_BYTES];
+
+    // The DMA wrote the block behind the D-cache
+    ai_cache_invalidate(pdm, bytes);
+    AI_CACHE_CPU_READ(pdm, bytes);
+
+    // Windows straddling the previous block's tail
+    for (uint32_t off = 0; off < tail && off + AUDIO_PDM_HOP_BYTES <= bytes; off += AUDIO_PDM_HOP_BYTES) {
+        memcpy(window, fe->pdm_tail + off, tail - off);
+        memcpy(window + tail - off, pdm, off + AUDIO_PDM_HOP_BYTES);
+        pcm_append(fe, pdm_sample(fe, window));
+    }
+    // Windows inside the block
+    for (uint32_t end = tail + AUDIO_PDM_HOP_BYTES; end <= bytes; end += AUDIO_PDM_HOP_BYTES) {
+        pcm_append(fe, pdm_sample(fe, pdm + end - AUDIO_PDM_WINDOW_BYTES));
+    }
+    memcpy(fe->pdm_tail, pdm + bytes - tail, tail);
+}
+
+void audio_push_pcm(AudioFrontEnd* fe, const int16_t* pcm, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        pcm_append(fe, pcm[i]);
+    }
+}
+
+/* ==================== FFT ==================== */
+
+static inline int16_t q15_mul(int32_t a, int32_t b) {
+    return (int16_t)((a * b + (1 << 14)) >> 15);
+}
+
+/**
+ * In-place radix-2 FFT of FFT_POINTS complex Q15 values, halved at every
+ * stage (output = DFT / FFT_POINTS); twiddles are the 2N-point table
+ */
+static void fft_complex(int16_t* x, const int16_t (*twiddle)[2]) {
+    // Bit-reverse permutation
+    for (uint32_t i = 1, j = 0; i < FFT_POINTS; i++) {
+        uint32_t bit = FFT_POINTS >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            int16_t re = x[2 * i], im = x[2 * i + 1];
+            x[2 * i] = x[2 * j];
+            x[2 * i + 1] = x[2 * j + 1];
+            x[2 * j] = re;
+            x[2 * j + 1] = im;
+        }
+    }
+
+    for (uint32_t len = 2; len <= FFT_POINTS; len <<= 1) {
+        uint32_t half = len >> 1;
+        uint32_t step = (AUDIO_FFT_SIZE / 2) / half;  // 2N-point table: W_len^k = W_2N^(k * step)
+        for (uint32_t start = 0; start < FFT_POINTS; start += len) {
+            for (uint32_t k = 0; k < half; k++) {
+                int16_t* a = &x[2 * (start + k)];
+                int16_t* b = &x[2 * (start + k + half)];
+                int32_t wr = twiddle[k * step][0], wi = twiddle[k * step][1];
+                int32_t tr = (b[0] * wr - b[1] * wi + (1 << 14)) >> 15;
+                int32_t ti = (b[0] * wi + b[1] * wr + (1 << 14)) >> 15;
+
+                b[0] = (int16_t)((a[0] - tr) >> 1);
+                b[1] = (int16_t)((a[1] - ti) >> 1);
+                a[0] = (int16_t)((a[0] + tr) >> 1);
+                a[1] = (int16_t)((a[1] + ti) >> 1);
+            }
+        }
+    }
+}
+
+/**
+ * Window, normalize and transform one frame into fe->power
+ * Returns the block exponent: power is scaled by 2^(2 * shift).
+ */
+static int32_t frame_power(AudioFrontEnd* fe, uint32_t start) {
+    int16_t* x = fe->fft;
+    int32_t peak = 0;
+
+    for (uint32_t n = 0; n < AUDIO_FFT_SIZE; n++) {
+        x[n] = q15_mul(fe->pcm[(start + n) & PCM_MASK], fe->window[n]);
+        int32_t a = x[n] < 0 ? -x[n] : x[n];
+        if (a > peak) peak = a;
+    }
+
+    // Block floating point: use the full headroom whatever the level
+    int32_t shift = 0;
+    if (peak >= FFT_HEADROOM) {
+        shift = -1;
+        for (uint32_t n = 0; n < AUDIO_FFT_SIZE; n++) x[n] >>= 1;
+    } else if (peak) {
+        while ((peak << (shift + 1)) < FFT_HEADROOM) shift++;
+        for (uint32_t n = 0; n < AUDIO_FFT_SIZE; n++) x[n] = (int16_t)(x[n] * (1 << shift));
+    }
+
+    fft_complex(x, (const int16_t (*)[2])fe->twiddle);
+
+    // Real split: X[k] = (Z[k] + Z*[M-k]) / 2 - j W^k (Z[k] - Z*[M-k]) / 2
+    int32_t z0r = x[0], z0i = x[1];
+    fe->power[0] = (uint32_t)((z0r + z0i) * (z0r + z0i));
+    fe->power[FFT_POINTS] = (uint32_t)((z0r - z0i) * (z0r - z0i));
+    for (uint32_t k = 1; k < FFT_POINTS; k++) {
+        int32_t ar = x[2 * k], ai = x[2 * k + 1];
+        int32_t br = x[2 * (FFT_POINTS - k)], bi = -x[2 * (FFT_POINTS - k) + 1];
+        int32_t er = (ar + br) >> 1, ei = (ai + bi) >> 1;   // Even part
+        int32_t or_ = (ar - br) >> 1, oi = (ai - bi) >> 1;  // Odd part
+        int32_t c = fe->twiddle[k][0], s = -fe->twiddle[k][1];
+
+        // -j * W^k * odd, with W^k = c - j s
+        int32_t xr = er + ((c * oi - s * or_ + (1 << 14)) >> 15);
+        int32_t xi = ei - ((c * or_ + s * oi + (1 << 14)) >> 15);
+        fe->power[k] = (uint32_t)(xr * xr) + (uint32_t)(xi * xi);
+    }
+    return shift;
+}
+
+/* ==================== FEATURES ==================== */
+
+/**
+ * log2 in 1/8 octaves (0 for 0)
+ */
+static int32_t log2_q3(uint64_t v) {
+    if (!v) return 0;
+    int32_t e = 63 - __builtin_clzll(v);
+    uint32_t m = (uint32_t)((e >= 4) ? (v >> (e - 4)) : (v << (4 - e))) & 15u;
+    return 8 * e + log2_mantissa[m];
+}
+
+static void feature_row(AudioFrontEnd* fe, uint32_t start) {
+    int32_t shift = frame_power(fe, start);
+    uint8_t* row = fe->features[fe->feature_pos];
+
+    for (uint32_t b = 0; b < AUDIO_MEL_BANDS; b++) {
+        const AudioMelBand* band = &fe->mel[b];
+        const int16_t* w = &fe->mel_weights[band->weights];
+        uint64_t energy = 0;
+        for (uint32_t i = 0; i < band->bins; i++) {
+            energy += (uint64_t)w[i] * fe->power[band->first_bin + i];
+        }
+        int32_t f = energy ? log2_q3(energy) - 16 * shift - AUDIO_LOG_FLOOR : 0;
+        row[b] = (uint8_t)(f < 0 ? 0 : (f > 255 ? 255 : f));
+    }
+
+    memcpy(fe->features[fe->feature_pos + AUDIO_FEATURE_FRAMES], row, AUDIO_MEL_BANDS);
+    fe->feature_pos = (fe->feature_pos + 1) % AUDIO_FEATURE_FRAMES;
+    fe->hops++;
+}
+
+uint32_t audio_process(AudioFrontEnd* fe) {
+    uint32_t rows = 0;
+
+    for (;;) {
+        uint32_t head = fe->pcm_head;
+        uint32_t pending = head - fe->pcm_frame;
+
+        // Fell behind: the oldest samples are being overwritten, resume at the newest frame
+        if (pending > AUDIO_PCM_RING - AUDIO_HOP) {
+            uint32_t resume = head - AUDIO_FFT_SIZE;
+            fe->overruns += resume - fe->pcm_frame;
+            fe->pcm_frame = resume;
+            pending = AUDIO_FFT_SIZE;
+        }
+        if (pending < AUDIO_FFT_SIZE) {
+            return rows;
+        }
+
+        feature_row(fe, fe->pcm_frame);
+        fe->pcm_frame += AUDIO_HOP;
+        rows++;
+    }
+}
+
+const uint8_t* audio_features(const AudioFrontEnd* fe) {
+    return fe->features[fe->feature_pos];
+}
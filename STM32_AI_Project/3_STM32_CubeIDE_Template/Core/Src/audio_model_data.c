@@ -0,0 +1,29 @@
+/*
+ * Crackle Classifier Model (int8, engine FDM1 image)
+ * Generated by: audio_crackle_model.py --emit
+ *
+ * Input: AUDIO_FEATURE_FRAMES x AUDIO_MEL_BANDS log-mel window
+ * (audio_features()), output [background, crackle].
+ */
+
+#include "model_data.h"
+
+// Quantized model image
+// In production, this is generated by audio_crackle_model.py
+const uint8_t audio_model_data[] = {
+    // Placeholder: not an FDM1 image, so main.c leaves the classifier off
+    // (a trained image is ~4KB)
+    0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00,
+};
+
+const uint32_t audio_model_data_len = sizeof(audio_model_data);
+
+const ModelInfo audio_model_info = {
+    .model_name = "CrackleAudioV1",
+    .model_version = "1.0",
+    .input_width = 32,
+    .input_height = 32,
+    .input_channels = 1,
+    .confidence_threshold = 0.7f
+};
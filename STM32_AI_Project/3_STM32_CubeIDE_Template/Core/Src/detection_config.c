@@ -0,0 +1,165 @@
+/*
+ * Detection Configuration
+ * Double-buffered parameter store + configuration side of the link protocol
+ */
+
+#include "detection_config.h"
+#include <string.h>
+
+#define REPLY_LENGTH (2 + CONFIG_WIRE_LENGTH)  // status u8 | pending u8 | params
+
+static const DetectionParams default_params = {
+    .version = 0,
+    .fire = 0.7f,
+    .critical = 0.9f,
+    .smoke = 0.7f,
+    .crackle = AUDIO_CRACKLE_THRESHOLD,
+    .promote_thermal = 0.4f,
+    .promote_analog = 0.5f,
+    .promote_audio = 0.5f,
+    .evidence = 0.3f,
+    .screen_period_ms = 5000,
+    .active_period_ms = 100,
+    .hold_ms = 60000,
+};
+
+static int32_t probability(float p) {
+    return p > 0.0f && p < 1.0f;  // Also rejects NaN
+}
+
+static int32_t check_params(const DetectionParams* p) {
+    if (!probability(p->fire) || !probability(p->critical) || !probability(p->smoke) ||
+        !probability(p->crackle) || !probability(p->promote_thermal) ||
+        !probability(p->promote_analog) || !probability(p->promote_audio) ||
+        !probability(p->evidence) || p->critical < p->fire) {
+        return CONFIG_ERR_RANGE;
+    }
+    if (p->active_period_ms == 0 || p->screen_period_ms < p->active_period_ms ||
+        p->hold_ms < p->active_period_ms) {
+        return CONFIG_ERR_RANGE;
+    }
+    return CONFIG_OK;
+}
+
+/**
+ * Fill a slot: everything the hot path reads is computed here
+ */
+static void derive(DetectionConfig* cfg, const DetectionParams* p, uint32_t version) {
+    cfg->params = *p;
+    cfg->params.version = version;
+
+    DetectionThresholds* th = &cfg->thresholds;
+    th->fire = p->fire;
+    th->critical = p->critical;
+    th->smoke = p->smoke;
+    th->crackle = p->crackle;
+    th->promote_thermal = p->promote_thermal;
+    th->promote_analog = p->promote_analog;
+    th->promote_audio = p->promote_audio;
+    detection_thresholds_derive(th);
+}
+
+int32_t config_init(ConfigStore* store, const DetectionParams* params) {
+    int32_t status = CONFIG_OK;
+
+    memset(store, 0, sizeof(*store));
+    if (!params) params = &default_params;
+    if (check_params(params) != CONFIG_OK) {
+        params = &default_params;
+        status = CONFIG_ERR_RANGE;
+    }
+    derive(&store->slots[0], params, 0);
+    store->active = &store->slots[0];
+    store->in_use = &store->slots[0];
+    return status;
+}
+
+const DetectionConfig* config_acquire(ConfigStore* store) {
+    const DetectionConfig* cfg = __atomic_load_n(&store->active, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&store->in_use, cfg, __ATOMIC_RELEASE);
+    return cfg;
+}
+
+int32_t config_update(ConfigStore* store, const DetectionParams* params) {
+    const DetectionConfig* active = __atomic_load_n(&store->active, __ATOMIC_ACQUIRE);
+
+    if (params->version != active->params.version) {
+        store->rejected++;
+        return CONFIG_ERR_VERSION;
+    }
+    if (check_params(params) != CONFIG_OK) {
+        store->rejected++;
+        return CONFIG_ERR_RANGE;
+    }
+
+    // The other slot is free only once the reader has moved to the active one
+    if (__atomic_load_n(&store->in_use, __ATOMIC_ACQUIRE) != active) {
+        store->busy++;
+        return CONFIG_ERR_BUSY;
+    }
+    DetectionConfig* next = (active == &store->slots[0]) ? &store->slots[1] : &store->slots[0];
+    derive(next, params, active->params.version + 1u);
+
+    // Slot contents become visible before the pointer (DMB on Cortex-M7)
+    __atomic_store_n(&store->active, next, __ATOMIC_RELEASE);
+    store->updates++;
+    return CONFIG_OK;
+}
+
+/* ==================== LINK ==================== */
+
+static void put_params(uint8_t* p, const DetectionParams* params) {
+    link_put_u32(p, params->version);
+    link_put_f32(p + 4, params->fire);
+    link_put_f32(p + 8, params->critical);
+    link_put_f32(p + 12, params->smoke);
+    link_put_f32(p + 16, params->crackle);
+    link_put_f32(p + 20, params->promote_thermal);
+    link_put_f32(p + 24, params->promote_analog);
+    link_put_f32(p + 28, params->promote_audio);
+    link_put_f32(p + 32, params->evidence);
+    link_put_u32(p + 36, params->screen_period_ms);
+    link_put_u32(p + 40, params->active_period_ms);
+    link_put_u32(p + 44, params->hold_ms);
+}
+
+static void get_params(const uint8_t* p, DetectionParams* params) {
+    params->version = link_get_u32(p);
+    params->fire = link_get_f32(p + 4);
+    params->critical = link_get_f32(p + 8);
+    params->smoke = link_get_f32(p + 12);
+    params->crackle = link_get_f32(p + 16);
+    params->promote_thermal = link_get_f32(p + 20);
+    params->promote_analog = link_get_f32(p + 24);
+    params->promote_audio = link_get_f32(p + 28);
+    params->evidence = link_get_f32(p + 32);
+    params->screen_period_ms = link_get_u32(p + 36);
+    params->active_period_ms = link_get_u32(p + 40);
+    params->hold_ms = link_get_u32(p + 44);
+}
+
+uint32_t config_link_handler(void* user, const LinkFrame* frame, uint8_t* tx, uint32_t tx_capacity) {
+    ConfigStore* store = (ConfigStore*)user;
+    int32_t status = CONFIG_OK;
+
+    if (frame->type == LINK_MSG_CFG_SET) {
+        if (frame->length != CONFIG_WIRE_LENGTH) {
+            status = CONFIG_ERR_LENGTH;
+        } else {
+            DetectionParams params;
+            get_params(frame->payload, &params);
+            status = config_update(store, &params);
+        }
+    } else if (frame->type != LINK_MSG_CFG_GET) {
+        return 0;
+    }
+    if (tx_capacity < REPLY_LENGTH + LINK_FRAME_OVERHEAD) return 0;
+
+    // Current values; pending = published but not yet taken by a frame
+    const DetectionConfig* active = __atomic_load_n(&store->active, __ATOMIC_ACQUIRE);
+    uint8_t payload[REPLY_LENGTH];
+    payload[0] = (uint8_t)status;
+    payload[1] = (uint8_t)(__atomic_load_n(&store->in_use, __ATOMIC_ACQUIRE) != active);
+    put_params(payload + 2, &active->params);
+    return link_encode(LINK_MSG_CFG_STATUS, frame->seq, payload, REPLY_LENGTH, tx);
+}
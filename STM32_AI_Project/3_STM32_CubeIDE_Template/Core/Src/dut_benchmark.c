@@ -0,0 +1,225 @@
+/*
+ * Device-Under-Test Benchmark
+ * Session state + benchmark side of the link protocol
+ */
+
+#include "dut_benchmark.h"
+#include "crc32.h"
+#include <string.h>
+
+#define ACK_LENGTH 5  // status u8 | received u32
+#define REPLY_MAX (DUT_RESULT_HEADER + 4 * DUT_MAX_ITERATIONS)  // Longest reply payload
+
+void dut_init(DutSession* dut, FireDetectionModel* model, uint8_t* input, uint32_t capacity,
+              const DutOps* ops) {
+    memset(dut, 0, sizeof(*dut));
+    dut->ops = *ops;
+    dut->model = model;
+    dut->input = input;
+    dut->capacity = capacity;
+}
+
+void dut_set_next(DutSession* dut, LinkMessageHandler handler, void* user) {
+    dut->next = handler;
+    dut->next_user = user;
+}
+
+/**
+ * Input shape the runs take: the engine model's header (what the engine
+ * reads), else ModelInfo
+ */
+static void input_shape(const DutSession* dut, uint16_t shape[3]) {
+    const FireDetectionModel* model = dut->model;
+    if (model->engine_layers > 0) {
+        AiModelHeader header;
+        memcpy(&header, model->model_data, sizeof(header));
+        shape[0] = header.input_w;
+        shape[1] = header.input_h;
+        shape[2] = header.input_c;
+        return;
+    }
+    shape[0] = (uint16_t)model->info->input_width;
+    shape[1] = (uint16_t)model->info->input_height;
+    shape[2] = (uint16_t)model->info->input_channels;
+}
+
+static uint32_t input_bytes(const DutSession* dut) {
+    uint16_t shape[3];
+    input_shape(dut, shape);
+    return (uint32_t)shape[0] * shape[1] * shape[2];
+}
+
+static void begin(DutSession* dut) {
+    if (dut->active) return;
+    dut->saved_task_mask = dut->model->task_mask;
+    dut->saved_cam = dut->model->cam_enabled;
+    dut->received = 0;
+    dut->active = 1;
+    dut->sessions++;
+    if (dut->ops.session) dut->ops.session(dut->ops.user, 1);
+}
+
+void dut_end(DutSession* dut) {
+    if (!dut->active) return;
+    fire_detection_set_tasks(dut->model, dut->saved_task_mask);
+    fire_detection_set_cam(dut->model, (int32_t)dut->saved_cam);
+    fire_detection_reset_state(dut->model);
+    dut->active = 0;
+    if (dut->ops.session) dut->ops.session(dut->ops.user, 0);
+}
+
+int32_t dut_poll(DutSession* dut, uint32_t now_ms) {
+    if (!dut->active) return 0;
+    if (dut->heard) {
+        dut->heard = 0;
+        dut->idle_since_ms = now_ms;
+    } else if (now_ms - dut->idle_since_ms >= DUT_IDLE_TIMEOUT_MS) {
+        dut_end(dut);  // Host gone without DUT_END
+    }
+    return dut->active;
+}
+
+/* ==================== RUN ==================== */
+
+/**
+ * Run the tensor iterations times, the cycle count of each run into
+ * cycles; the model's outputs are those of the last run
+ */
+static int32_t run(DutSession* dut, uint32_t iterations, uint32_t flags, uint32_t task_mask,
+                   uint32_t* cycles, uint8_t* result_flags) {
+    FireDetectionModel* model = dut->model;
+
+    if (iterations == 0 || iterations > DUT_MAX_ITERATIONS) return DUT_ERR_RANGE;
+    if (model->engine_layers <= 0) return DUT_ERR_MODEL;
+    if (dut->received != input_bytes(dut)) return DUT_ERR_INPUT;
+
+    fire_detection_set_tasks(model, task_mask ? task_mask : AI_TASKS_ALL);
+    if (fire_detection_set_cam(model, (flags & DUT_RUN_CAM) != 0) == 0 && (flags & DUT_RUN_CAM)) {
+        *result_flags |= DUT_RESULT_CAM;
+    }
+
+    float first = 0.0f;
+    for (uint32_t i = 0; i < iterations; i++) {
+        if (flags & DUT_RUN_RESET) fire_detection_reset_state(model);
+
+        uint32_t start = dut->ops.cycles(dut->ops.user);
+        fire_detection_inference_image(model, dut->input);
+        cycles[i] = dut->ops.cycles(dut->ops.user) - start;
+
+        // Identical input: outputs may only change through temporal state
+        if (i == 0) {
+            first = model->fire_margin;
+        } else if (memcmp(&first, &model->fire_margin, sizeof(first)) != 0) {
+            *result_flags |= DUT_RESULT_VARIED;
+        }
+    }
+    dut->runs++;
+    dut->inferences += iterations;
+    return DUT_OK;
+}
+
+/* ==================== LINK ==================== */
+
+static uint32_t reply_device(DutSession* dut, const LinkFrame* frame, uint8_t* tx) {
+    const FireDetectionModel* model = dut->model;
+    uint8_t payload[DUT_DEVICE_LENGTH];
+    uint16_t layers = (uint16_t)(model->engine_layers > 0 ? model->engine_layers : 0);
+    uint16_t shape[3];
+
+    input_shape(dut, shape);
+
+    memset(payload, 0, sizeof(payload));
+    payload[0] = DUT_PROTOCOL_VERSION;
+    payload[1] = (uint8_t)(layers ? DUT_OK : DUT_ERR_MODEL);
+    link_put_u16(payload + 2, DUT_MAX_ITERATIONS);
+    link_put_u16(payload + 4, shape[0]);
+    link_put_u16(payload + 6, shape[1]);
+    link_put_u16(payload + 8, shape[2]);
+    link_put_u16(payload + 10, layers);
+    link_put_u32(payload + 12, input_bytes(dut));
+    link_put_u32(payload + 16, dut->ops.clock_hz);
+    link_put_u32(payload + 20, crc32_update(0, model->model_data, model->model_size));
+    link_put_u32(payload + 24, model->model_size);
+    if (dut->ops.platform) {
+        size_t n = strlen(dut->ops.platform);  // Zero-padded, not terminated at full length
+        memcpy(payload + 28, dut->ops.platform, n < DUT_PLATFORM_LENGTH ? n : DUT_PLATFORM_LENGTH);
+    }
+    return link_encode(LINK_MSG_DUT_DEVICE, frame->seq, payload, DUT_DEVICE_LENGTH, tx);
+}
+
+static uint32_t reply_ack(DutSession* dut, const LinkFrame* frame, int32_t status, uint8_t* tx) {
+    uint8_t payload[ACK_LENGTH];
+    payload[0] = (uint8_t)status;
+    link_put_u32(payload + 1, dut->received);
+    return link_encode(LINK_MSG_DUT_ACK, frame->seq, payload, ACK_LENGTH, tx);
+}
+
+/**
+ * Chunk at offset: in order, or a repeat of bytes already received
+ */
+static int32_t take_input(DutSession* dut, const LinkFrame* frame) {
+    if (frame->length <= 4) return DUT_ERR_LENGTH;
+
+    uint32_t offset = link_get_u32(frame->payload);
+    uint32_t length = frame->length - 4u;
+    if (offset == 0) dut->received = 0;  // New tensor
+    if (offset > dut->received) return DUT_ERR_OFFSET;
+    if (offset + length > input_bytes(dut) || offset + length > dut->capacity) return DUT_ERR_INPUT;
+
+    memcpy(dut->input + offset, frame->payload + 4, length);
+    if (offset + length > dut->received) dut->received = offset + length;
+    return DUT_OK;
+}
+
+uint32_t dut_link_handler(void* user, const LinkFrame* frame, uint8_t* tx, uint32_t tx_capacity) {
+    DutSession* dut = (DutSession*)user;
+
+    if (frame->type < LINK_MSG_DUT_INFO || frame->type > LINK_MSG_DUT_END) {
+        return dut->next ? dut->next(dut->next_user, frame, tx, tx_capacity) : 0;
+    }
+    if (tx_capacity < REPLY_MAX + LINK_FRAME_OVERHEAD) return 0;  // Unanswered: the host retries
+
+    if (frame->type == LINK_MSG_DUT_INFO) {
+        begin(dut);
+        dut->heard = 1;
+        return reply_device(dut, frame, tx);
+    }
+    if (frame->type == LINK_MSG_DUT_END) {
+        dut_end(dut);
+        return reply_ack(dut, frame, DUT_OK, tx);
+    }
+
+    // A session also opens on INPUT / RUN, should the DUT_DEVICE reply be lost
+    begin(dut);
+    dut->heard = 1;
+    if (frame->type == LINK_MSG_DUT_INPUT) {
+        return reply_ack(dut, frame, take_input(dut, frame), tx);
+    }
+
+    // RUN: iterations u16 | flags u16 | task_mask u32
+    uint8_t payload[REPLY_MAX];
+    uint32_t cycles[DUT_MAX_ITERATIONS];
+    uint32_t iterations = 0;
+    uint8_t flags = 0;
+    int32_t status = DUT_ERR_LENGTH;
+    if (frame->length >= 8) {
+        iterations = link_get_u16(frame->payload);
+        status = run(dut, iterations, link_get_u16(frame->payload + 2), link_get_u32(frame->payload + 4),
+                     cycles, &flags);
+    }
+    if (status != DUT_OK) iterations = 0;
+
+    const FireDetectionModel* model = dut->model;
+    payload[0] = (uint8_t)status;
+    payload[1] = flags;
+    link_put_u16(payload + 2, (uint16_t)iterations);
+    link_put_u32(payload + 4, status == DUT_OK ? model->tasks_run : 0u);
+    link_put_f32(payload + 8, status == DUT_OK ? model->output_buffer[1] : 0.0f);
+    link_put_f32(payload + 12, status == DUT_OK ? model->smoke_buffer[1] : 0.0f);
+    link_put_f32(payload + 16, status == DUT_OK ? model->fire_margin : 0.0f);
+    for (uint32_t i = 0; i < iterations; i++) {
+        link_put_u32(payload + DUT_RESULT_HEADER + 4 * i, cycles[i]);
+    }
+    return link_encode(LINK_MSG_DUT_RESULT, frame->seq, payload,
+                       (uint16_t)(DUT_RESULT_HEADER + 4 * iterations), tx);
+}
@@ -0,0 +1,137 @@
+/*
+ * Frame Buffer Pool
+ * Lock-free buffer allocation and reference counts, drop policies, frame queues
+ */
+
+#include "frame_pool.h"
+#include <string.h>
+
+uint32_t frame_pool_init(FramePool* pool, uint8_t* memory, uint32_t memory_size, uint32_t frame_size,
+                         uint8_t policy, const FramePoolOps* ops) {
+    const uint32_t stride = AI_CACHE_ROUND(frame_size);
+
+    memset(pool, 0, sizeof(*pool));
+    pool->count = stride ? memory_size / stride : 0;
+    if (pool->count > FRAME_POOL_MAX_BUFFERS) pool->count = FRAME_POOL_MAX_BUFFERS;
+    pool->frame_size = frame_size;
+    pool->policy = policy;
+    if (ops) {
+        pool->ops = *ops;
+    }
+
+    for (uint32_t i = 0; i < pool->count; i++) {
+        pool->frames[i].data = memory + i * stride;
+        pool->frames[i].index = (uint8_t)i;
+    }
+    pool->free = (pool->count < 32u) ? (1u << pool->count) - 1u : 0xFFFFFFFFu;
+    return pool->count;
+}
+
+/**
+ * Claim the lowest free buffer: one compare-and-swap on the bitmap
+ */
+static FrameBuffer* take_free(FramePool* pool) {
+    uint32_t free = __atomic_load_n(&pool->free, __ATOMIC_ACQUIRE);
+
+    while (free) {
+        const uint32_t bit = free & (0u - free);
+        if (__atomic_compare_exchange_n(&pool->free, &free, free & ~bit, 1,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            return &pool->frames[__builtin_ctz(bit)];
+        }
+    }
+    return NULL;
+}
+
+FrameBuffer* frame_acquire(FramePool* pool) {
+    FrameBuffer* frame = take_free(pool);
+
+    if (!frame) {
+        __atomic_fetch_add(&pool->exhausted, 1u, __ATOMIC_RELAXED);
+        if (pool->policy == FRAME_DROP_OLDEST && pool->ops.reclaim) {
+            // Each call drops one reference: bounded by the frames held
+            for (uint32_t i = 0; !frame && i < FRAME_POOL_MAX_BUFFERS * FRAME_QUEUE_MAX; i++) {
+                if (!pool->ops.reclaim(pool->ops.user)) break;
+                __atomic_fetch_add(&pool->reclaimed, 1u, __ATOMIC_RELAXED);
+                frame = take_free(pool);
+            }
+        }
+        if (!frame) {
+            __atomic_fetch_add(&pool->dropped, 1u, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    }
+
+    frame->seq = __atomic_fetch_add(&pool->seq, 1u, __ATOMIC_RELAXED);
+    frame->timestamp_ms = 0;
+    frame->width = 0;
+    frame->height = 0;
+    frame->channels = 0;
+    __atomic_store_n(&frame->refs, 1u, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pool->acquired, 1u, __ATOMIC_RELAXED);
+
+    const uint32_t in_use = frame_pool_in_use(pool);
+    uint32_t peak = __atomic_load_n(&pool->peak, __ATOMIC_RELAXED);
+    while (in_use > peak &&
+           !__atomic_compare_exchange_n(&pool->peak, &peak, in_use, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return frame;
+}
+
+void frame_retain(FrameBuffer* frame) {
+    __atomic_fetch_add(&frame->refs, 1u, __ATOMIC_RELAXED);
+}
+
+void frame_release(FramePool* pool, FrameBuffer* frame) {
+    if (!frame) return;
+
+    // Release: this consumer's reads of the frame complete before the
+    // buffer can be handed out again
+    if (__atomic_sub_fetch(&frame->refs, 1u, __ATOMIC_ACQ_REL) == 0) {
+        __atomic_fetch_or(&pool->free, 1u << frame->index, __ATOMIC_RELEASE);
+    }
+}
+
+uint32_t frame_pool_in_use(const FramePool* pool) {
+    return pool->count - (uint32_t)__builtin_popcount(__atomic_load_n(&pool->free, __ATOMIC_RELAXED));
+}
+
+/* ==================== QUEUES ==================== */
+
+void frame_queue_init(FrameQueue* queue, uint32_t depth) {
+    memset(queue, 0, sizeof(*queue));
+    queue->depth = (depth > FRAME_QUEUE_MAX) ? FRAME_QUEUE_MAX : depth;
+}
+
+int32_t frame_queue_push(FramePool* pool, FrameQueue* queue, FrameBuffer* frame, int32_t overwrite) {
+    if (frame_queue_count(queue) >= queue->depth) {
+        if (!overwrite || queue->depth == 0) {
+            queue->refused++;
+            return FRAME_ERR_FULL;
+        }
+        frame_release(pool, frame_queue_pop(queue));
+        queue->overwritten++;
+    }
+
+    frame_retain(frame);
+    queue->frames[queue->head % FRAME_QUEUE_MAX] = frame;
+    queue->head++;
+    return FRAME_OK;
+}
+
+FrameBuffer* frame_queue_pop(FrameQueue* queue) {
+    if (queue->tail == queue->head) return NULL;
+    return queue->frames[queue->tail++ % FRAME_QUEUE_MAX];
+}
+
+FrameBuffer* frame_queue_peek(const FrameQueue* queue, uint32_t i) {
+    if (i >= frame_queue_count(queue)) return NULL;
+    return queue->frames[(queue->tail + i) % FRAME_QUEUE_MAX];
+}
+
+void frame_queue_clear(FramePool* pool, FrameQueue* queue) {
+    FrameBuffer* frame;
+    while ((frame = frame_queue_pop(queue)) != NULL) {
+        frame_release(pool, frame);
+    }
+}
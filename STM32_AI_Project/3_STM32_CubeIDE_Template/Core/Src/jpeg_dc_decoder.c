@@ -0,0 +1,619 @@
+/*
+ * Reduced-Resolution JPEG Decoder
+ * Entropy decode + DC/low-AC reconstruction (no IDCT)
+ */
+
+#include "jpeg_dc_decoder.h"
+#include <string.h>
+
+// JPEG markers
+#define M_SOF0 0xC0
+#define M_SOF1 0xC1
+#define M_DHT  0xC4
+#define M_RST0 0xD0
+#define M_SOI  0xD8
+#define M_EOI  0xD9
+#define M_SOS  0xDA
+#define M_DQT  0xDB
+#define M_DRI  0xDD
+
+/*
+ * Low-frequency reconstruction weights (Q12)
+ *
+ * Averaging the 8x8 IDCT over one 4x4 quadrant leaves:
+ *   DC:        F00 / 8
+ *   F01, F10:  +/- F * mean(cos((2x+1)pi/16), x=0..3) / (4*sqrt(2))
+ *   F11:       +/- F * mean(...)^2 / 4
+ */
+#define Q12_DC   512   // 1/8
+#define Q12_AC1  464   // 0.11326
+#define Q12_AC11 420   // 0.10262
+
+/*
+ * Standard Huffman tables (ITU T.81 Annex K.3)
+ * Many USB/IP cameras emit MJPEG frames without DHT segments and
+ * expect the decoder to fall back to these.
+ */
+static const uint8_t std_dc_luma_bits[16] = {
+    0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0
+};
+static const uint8_t std_dc_chroma_bits[16] = {
+    0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0
+};
+static const uint8_t std_dc_vals[12] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11
+};
+static const uint8_t std_ac_luma_bits[16] = {
+    0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d
+};
+static const uint8_t std_ac_luma_vals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+static const uint8_t std_ac_chroma_bits[16] = {
+    0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77
+};
+static const uint8_t std_ac_chroma_vals[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+typedef struct {
+    const uint8_t* p;
+    const uint8_t* end;
+    uint64_t bits;
+    int32_t count;
+    uint32_t zero_bytes;   // Padding bytes fed past a marker / end of data
+    uint8_t marker_hit;
+} BitReader;
+
+static uint16_t read_u16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/* ==================== HUFFMAN TABLES ==================== */
+
+static int32_t build_huff_table(JpegHuffTable* t, const uint8_t* counts,
+                                const uint8_t* symbols, uint32_t num_symbols) {
+    int32_t code = 0;
+    int32_t k = 0;
+
+    memset(t->lookup, 0, sizeof(t->lookup));
+    memcpy(t->symbols, symbols, num_symbols);
+
+    for (int32_t len = 1; len <= 16; len++) {
+        t->valptr[len] = k - code;
+        for (int32_t i = 0; i < counts[len - 1]; i++) {
+            if (len <= JPEG_DC_HUFF_LOOKUP_BITS) {
+                // Fill every lookup slot that starts with this code
+                int32_t shift = JPEG_DC_HUFF_LOOKUP_BITS - len;
+                int32_t base = code << shift;
+                for (int32_t j = 0; j < (1 << shift); j++) {
+                    t->lookup[base + j] = (uint16_t)((len << 8) | symbols[k]);
+                }
+            }
+            code++;
+            k++;
+        }
+        t->maxcode[len] = counts[len - 1] ? code - 1 : -1;
+        if (code > (1 << len)) return JPEG_DC_ERR_FORMAT;
+        code <<= 1;
+    }
+    t->maxcode[17] = 0x7FFFFFFF;
+    t->present = 1;
+    return JPEG_DC_OK;
+}
+
+/**
+ * Combined code + magnitude lookup for AC tables
+ * Most AC coefficients are short codes with small values; resolving
+ * both in one table read keeps the per-coefficient skip cheap.
+ * EOB and ZRL are included with a zero value.
+ */
+static void build_fast_ac(JpegHuffTable* t) {
+    for (int32_t i = 0; i < (1 << JPEG_DC_HUFF_LOOKUP_BITS); i++) {
+        uint16_t entry = t->lookup[i];
+        t->fast_ac[i] = 0;
+        if (!entry) continue;
+
+        int32_t len = entry >> 8;
+        int32_t run = (entry >> 4) & 0x0F;
+        int32_t size = entry & 0x0F;
+        if (size == 0) {
+            // EOB (run 0) and ZRL (run 15) carry no magnitude bits
+            if (run == 0 || run == 15) t->fast_ac[i] = (int16_t)((run << 4) + len);
+            continue;
+        }
+        if (len + size > JPEG_DC_HUFF_LOOKUP_BITS) continue;
+
+        int32_t bits = (i >> (JPEG_DC_HUFF_LOOKUP_BITS - len - size)) & ((1 << size) - 1);
+        int32_t value = (bits < (1 << (size - 1))) ? bits - (1 << size) + 1 : bits;
+        if (value >= -128 && value <= 127) {
+            t->fast_ac[i] = (int16_t)(value * 256 + (run << 4) + len + size);
+        }
+    }
+}
+
+/* ==================== BIT READER ==================== */
+
+static void br_fill(BitReader* br) {
+    while (br->count <= 56) {
+        uint32_t byte = 0;
+
+        if (!br->marker_hit && br->p < br->end) {
+            byte = *br->p;
+            if (byte == 0xFF) {
+                uint8_t next = (br->p + 1 < br->end) ? br->p[1] : M_EOI;
+                if (next == 0x00) {
+                    br->p += 2;            // Stuffed 0xFF data byte
+                } else {
+                    br->marker_hit = 1;    // Leave marker for the caller
+                    byte = 0;
+                }
+            } else {
+                br->p++;
+            }
+        } else {
+            br->zero_bytes++;
+        }
+        // Past the end (or at a marker) feed zeros; consuming them means
+        // the entropy data was truncated (checked per MCU by the caller)
+        br->bits |= (uint64_t)byte << (56 - br->count);
+        br->count += 8;
+    }
+}
+
+static uint32_t br_get_bits(BitReader* br, int32_t n) {
+    if (n == 0) return 0;
+    if (br->count < n) br_fill(br);
+    uint32_t v = (uint32_t)(br->bits >> (64 - n));
+    br->bits <<= n;
+    br->count -= n;
+    return v;
+}
+
+static int32_t extend(uint32_t v, int32_t s) {
+    return (v < (1u << (s - 1))) ? (int32_t)v - (1 << s) + 1 : (int32_t)v;
+}
+
+static int32_t huff_decode(BitReader* br, const JpegHuffTable* t) {
+    if (br->count < 16) br_fill(br);
+
+    uint32_t peek = (uint32_t)(br->bits >> (64 - JPEG_DC_HUFF_LOOKUP_BITS));
+    uint16_t entry = t->lookup[peek];
+    if (entry) {
+        int32_t len = entry >> 8;
+        br->bits <<= len;
+        br->count -= len;
+        return entry & 0xFF;
+    }
+
+    // Slow path: codes longer than the lookup width
+    int32_t len = JPEG_DC_HUFF_LOOKUP_BITS + 1;
+    int32_t code = (int32_t)(br->bits >> (64 - len));
+    while (len <= 16 && code > t->maxcode[len]) {
+        len++;
+        code = (int32_t)(br->bits >> (64 - len));
+    }
+    if (len > 16) return -1;
+    br->bits <<= len;
+    br->count -= len;
+    return t->symbols[code + t->valptr[len]];
+}
+
+/* ==================== HEADER PARSING ==================== */
+
+static int32_t parse_sof(JpegDcDecoder* dec, const uint8_t* seg, uint32_t len) {
+    if (len < 6 || seg[0] != 8) return JPEG_DC_ERR_UNSUPPORTED;  // 8-bit only
+
+    dec->height = read_u16(seg + 1);
+    dec->width = read_u16(seg + 3);
+    dec->num_components = seg[5];
+    if (dec->num_components == 0 || dec->num_components > JPEG_DC_MAX_COMPONENTS) {
+        return JPEG_DC_ERR_UNSUPPORTED;
+    }
+    if (len < 6u + dec->num_components * 3u || dec->width == 0 || dec->height == 0) {
+        return JPEG_DC_ERR_FORMAT;
+    }
+
+    dec->h_max = 1;
+    dec->v_max = 1;
+    for (uint32_t i = 0; i < dec->num_components; i++) {
+        JpegComponent* c = &dec->components[i];
+        c->id = seg[6 + i * 3];
+        c->h_samp = seg[7 + i * 3] >> 4;
+        c->v_samp = seg[7 + i * 3] & 0x0F;
+        c->quant_table = seg[8 + i * 3] & 0x03;
+        if (c->h_samp == 0 || c->v_samp == 0 || c->h_samp > 4 || c->v_samp > 4) {
+            return JPEG_DC_ERR_FORMAT;
+        }
+        if (c->h_samp > dec->h_max) dec->h_max = c->h_samp;
+        if (c->v_samp > dec->v_max) dec->v_max = c->v_samp;
+    }
+
+    // Luma must carry the full resolution
+    if (dec->components[0].h_samp != dec->h_max ||
+        dec->components[0].v_samp != dec->v_max) {
+        return JPEG_DC_ERR_UNSUPPORTED;
+    }
+    return JPEG_DC_OK;
+}
+
+static int32_t parse_dht(JpegDcDecoder* dec, const uint8_t* seg, uint32_t len) {
+    while (len >= 17) {
+        uint8_t tc = seg[0] >> 4;
+        uint8_t th = seg[0] & 0x0F;
+        uint32_t total = 0;
+
+        if (tc > 1) return JPEG_DC_ERR_FORMAT;
+        if (th >= JPEG_DC_MAX_HUFF_TABLES) return JPEG_DC_ERR_UNSUPPORTED;
+        for (int i = 0; i < 16; i++) total += seg[1 + i];
+        if (total > 256 || len < 17 + total) return JPEG_DC_ERR_FORMAT;
+
+        JpegHuffTable* t = tc ? &dec->ac_tables[th] : &dec->dc_tables[th];
+        int32_t status = build_huff_table(t, seg + 1, seg + 17, total);
+        if (status != JPEG_DC_OK) return status;
+        if (tc) build_fast_ac(t);
+
+        seg += 17 + total;
+        len -= 17 + total;
+    }
+    return JPEG_DC_OK;
+}
+
+static int32_t parse_dqt(JpegDcDecoder* dec, const uint8_t* seg, uint32_t len) {
+    while (len >= 65) {
+        uint8_t precision = seg[0] >> 4;
+        uint8_t id = seg[0] & 0x03;
+        uint32_t entry_size = precision ? 2 : 1;
+
+        if (len < 1 + 64 * entry_size) return JPEG_DC_ERR_FORMAT;
+        for (int i = 0; i < 64; i++) {
+            dec->quant[id][i] = precision ? read_u16(seg + 1 + i * 2) : seg[1 + i];
+        }
+        seg += 1 + 64 * entry_size;
+        len -= 1 + 64 * entry_size;
+    }
+    return JPEG_DC_OK;
+}
+
+static void load_default_tables(JpegDcDecoder* dec) {
+    if (!dec->dc_tables[0].present) build_huff_table(&dec->dc_tables[0], std_dc_luma_bits, std_dc_vals, 12);
+    if (!dec->dc_tables[1].present) build_huff_table(&dec->dc_tables[1], std_dc_chroma_bits, std_dc_vals, 12);
+    if (!dec->ac_tables[0].present) {
+        build_huff_table(&dec->ac_tables[0], std_ac_luma_bits, std_ac_luma_vals, 162);
+        build_fast_ac(&dec->ac_tables[0]);
+    }
+    if (!dec->ac_tables[1].present) {
+        build_huff_table(&dec->ac_tables[1], std_ac_chroma_bits, std_ac_chroma_vals, 162);
+        build_fast_ac(&dec->ac_tables[1]);
+    }
+}
+
+static int32_t parse_sos(JpegDcDecoder* dec, const uint8_t* seg, uint32_t len) {
+    if (len < 1) return JPEG_DC_ERR_FORMAT;
+
+    load_default_tables(dec);  // No-op when the frame carried DHT segments
+
+    uint8_t n = seg[0];
+    if (n == 0 || len < 4u + n * 2u) return JPEG_DC_ERR_FORMAT;
+
+    // Interleaved single-scan images only (covers MJPEG and grayscale)
+    if (n != dec->num_components) return JPEG_DC_ERR_UNSUPPORTED;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t id = seg[1 + i * 2];
+        uint8_t tables = seg[2 + i * 2];
+        uint32_t c;
+
+        for (c = 0; c < dec->num_components; c++) {
+            if (dec->components[c].id == id) break;
+        }
+        if (c == dec->num_components) return JPEG_DC_ERR_FORMAT;
+
+        dec->components[c].dc_table = tables >> 4;
+        dec->components[c].ac_table = tables & 0x0F;
+        if (dec->components[c].dc_table >= JPEG_DC_MAX_HUFF_TABLES ||
+            dec->components[c].ac_table >= JPEG_DC_MAX_HUFF_TABLES) {
+            return JPEG_DC_ERR_UNSUPPORTED;
+        }
+        if (!dec->dc_tables[dec->components[c].dc_table].present ||
+            !dec->ac_tables[dec->components[c].ac_table].present) {
+            return JPEG_DC_ERR_FORMAT;
+        }
+        dec->scan_components[i] = (uint8_t)c;
+    }
+    dec->num_scan_components = n;
+    return JPEG_DC_OK;
+}
+
+/**
+ * Walk markers up to the first SOS
+ */
+static int32_t parse_headers(JpegDcDecoder* dec, const uint8_t* jpeg, uint32_t size) {
+    const uint8_t* p = jpeg;
+    const uint8_t* end = jpeg + size;
+    int32_t have_frame = 0;
+
+    memset(dec, 0, sizeof(*dec));
+    if (size < 4 || p[0] != 0xFF || p[1] != M_SOI) return JPEG_DC_ERR_FORMAT;
+    p += 2;
+
+    while (p + 4 <= end) {
+        if (p[0] != 0xFF) return JPEG_DC_ERR_FORMAT;
+        uint8_t marker = p[1];
+        if (marker == 0xFF) {  // Fill byte
+            p++;
+            continue;
+        }
+
+        uint16_t seg_len = read_u16(p + 2);
+        const uint8_t* seg = p + 4;
+        if (seg_len < 2 || seg + seg_len - 2 > end) return JPEG_DC_ERR_TRUNCATED;
+        uint32_t len = seg_len - 2u;
+        int32_t status = JPEG_DC_OK;
+
+        switch (marker) {
+            case M_SOF0:
+            case M_SOF1:
+                status = parse_sof(dec, seg, len);
+                have_frame = 1;
+                break;
+            case M_DHT:
+                status = parse_dht(dec, seg, len);
+                break;
+            case M_DQT:
+                status = parse_dqt(dec, seg, len);
+                break;
+            case M_DRI:
+                dec->restart_interval = (len >= 2) ? read_u16(seg) : 0;
+                break;
+            case M_SOS:
+                if (!have_frame) return JPEG_DC_ERR_FORMAT;
+                status = parse_sos(dec, seg, len);
+                dec->scan_data = seg + len;
+                dec->data_end = end;
+                return status;
+            case M_EOI:
+                return JPEG_DC_ERR_FORMAT;
+            default:
+                // SOF2+ (progressive, lossless, arithmetic) cannot be decoded here
+                if (marker >= 0xC2 && marker <= 0xCF && marker != M_DHT && marker != 0xC8 &&
+                    marker != 0xCC) {
+                    return JPEG_DC_ERR_UNSUPPORTED;
+                }
+                break;  // APPn, COM, ... skipped
+        }
+        if (status != JPEG_DC_OK) return status;
+        p = seg + len;
+    }
+    return JPEG_DC_ERR_TRUNCATED;
+}
+
+/* ==================== ENTROPY DECODE ==================== */
+
+/**
+ * Decode one 8x8 block, keeping only the coefficients we use
+ * low_ac (optional) receives dequantized zigzag entries 1, 2 and 4
+ */
+static int32_t decode_block(JpegDcDecoder* dec, BitReader* br, JpegComponent* c,
+                            int32_t* dc, int32_t* low_ac) {
+    const JpegHuffTable* ac_table = &dec->ac_tables[c->ac_table];
+    const uint16_t* q = dec->quant[c->quant_table];
+
+    int32_t s = huff_decode(br, &dec->dc_tables[c->dc_table]);
+    if (s < 0 || s > 11) return JPEG_DC_ERR_FORMAT;
+    if (s) c->dc_pred += extend(br_get_bits(br, s), s);
+    *dc = c->dc_pred * q[0];
+
+    if (low_ac) {
+        low_ac[0] = low_ac[1] = low_ac[2] = 0;
+    }
+
+    for (int32_t k = 1; k < 64; k++) {
+        if (br->count < 16) br_fill(br);
+
+        uint32_t peek = (uint32_t)(br->bits >> (64 - JPEG_DC_HUFF_LOOKUP_BITS));
+        int32_t fast = ac_table->fast_ac[peek];
+        if (fast) {
+            br->bits <<= fast & 0x0F;
+            br->count -= fast & 0x0F;
+            if ((fast & 0xFFF0) == 0) break;  // EOB
+            k += (fast >> 4) & 0x0F;
+            if (low_ac && k <= 4 && k != 3) {
+                low_ac[k == 4 ? 2 : k - 1] = (fast >> 8) * q[k];
+            }
+            continue;
+        }
+
+        int32_t rs = huff_decode(br, ac_table);
+        if (rs < 0) return JPEG_DC_ERR_FORMAT;
+
+        int32_t r = rs >> 4;
+        s = rs & 0x0F;
+        if (s == 0) {
+            if (r != 15) break;  // EOB
+            k += 15;             // ZRL
+            continue;
+        }
+
+        k += r;
+        if (k > 63) return JPEG_DC_ERR_FORMAT;
+
+        // Always consume the bits; only the first few are kept
+        uint32_t bits = br_get_bits(br, s);
+        if (low_ac && k <= 4 && k != 3) {
+            low_ac[k == 4 ? 2 : k - 1] = extend(bits, s) * q[k];
+        }
+    }
+    return JPEG_DC_OK;
+}
+
+static uint8_t clamp_u8(int32_t v) {
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static void write_block(uint8_t* out, uint16_t out_width, uint16_t out_height,
+                        uint32_t bx, uint32_t by, JpegDcScale scale,
+                        int32_t dc, const int32_t* low_ac) {
+    if (scale == JPEG_DC_SCALE_1_8) {
+        out[by * out_width + bx] = clamp_u8(((dc * Q12_DC + 2048) >> 12) + 128);
+        return;
+    }
+
+    // 2x2 quadrant means of the low-frequency IDCT
+    int32_t base = dc * Q12_DC;
+    int32_t h = low_ac[0] * Q12_AC1;   // F01: horizontal
+    int32_t v = low_ac[1] * Q12_AC1;   // F10: vertical
+    int32_t d = low_ac[2] * Q12_AC11;  // F11: diagonal
+    int32_t quad[4] = {
+        base + h + v + d,   // top-left
+        base - h + v - d,   // top-right
+        base + h - v - d,   // bottom-left
+        base - h - v + d    // bottom-right
+    };
+
+    for (uint32_t i = 0; i < 4; i++) {
+        uint32_t x = bx * 2 + (i & 1);
+        uint32_t y = by * 2 + (i >> 1);
+        if (x < out_width && y < out_height) {
+            out[y * out_width + x] = clamp_u8(((quad[i] + 2048) >> 12) + 128);
+        }
+    }
+}
+
+/**
+ * Skip to the next RSTn marker and reset predictors
+ */
+static int32_t handle_restart(JpegDcDecoder* dec, BitReader* br) {
+    br->bits = 0;
+    br->count = 0;
+    br->zero_bytes = 0;
+    br->marker_hit = 0;
+
+    while (br->p + 1 < br->end && !(br->p[0] == 0xFF && br->p[1] >= M_RST0 && br->p[1] <= M_RST0 + 7)) {
+        br->p++;
+    }
+    if (br->p + 1 >= br->end) return JPEG_DC_ERR_TRUNCATED;
+    br->p += 2;
+
+    for (uint32_t i = 0; i < dec->num_components; i++) {
+        dec->components[i].dc_pred = 0;
+    }
+    return JPEG_DC_OK;
+}
+
+/* ==================== PUBLIC API ==================== */
+
+int32_t jpeg_dc_get_info(JpegDcDecoder* dec, const uint8_t* jpeg, uint32_t jpeg_size,
+                         uint16_t* width, uint16_t* height) {
+    if (!dec || !jpeg) return JPEG_DC_ERR_FORMAT;
+
+    int32_t status = parse_headers(dec, jpeg, jpeg_size);
+    if (status != JPEG_DC_OK) return status;
+
+    if (width) *width = dec->width;
+    if (height) *height = dec->height;
+    return JPEG_DC_OK;
+}
+
+void jpeg_dc_output_size(uint16_t width, uint16_t height, JpegDcScale scale,
+                         uint16_t* out_width, uint16_t* out_height) {
+    // Round up like a full decode followed by an exact 1/8 or 1/4 resize
+    uint32_t div = (scale == JPEG_DC_SCALE_1_4) ? 4 : 8;
+    *out_width = (uint16_t)((width + div - 1) / div);
+    *out_height = (uint16_t)((height + div - 1) / div);
+}
+
+int32_t jpeg_dc_decode(JpegDcDecoder* dec, const uint8_t* jpeg, uint32_t jpeg_size,
+                       JpegDcScale scale, uint8_t* out, uint32_t out_capacity,
+                       uint16_t* out_width, uint16_t* out_height) {
+    if (!dec || !jpeg || !out) return JPEG_DC_ERR_FORMAT;
+
+    int32_t status = parse_headers(dec, jpeg, jpeg_size);
+    if (status != JPEG_DC_OK) return status;
+
+    uint16_t ow, oh;
+    jpeg_dc_output_size(dec->width, dec->height, scale, &ow, &oh);
+    if ((uint32_t)ow * oh > out_capacity) return JPEG_DC_ERR_BUFFER;
+
+    // Luma blocks actually inside the image
+    uint32_t blocks_x = (dec->width + 7) / 8;
+    uint32_t blocks_y = (dec->height + 7) / 8;
+
+    uint32_t mcu_w = 8u * dec->h_max;
+    uint32_t mcu_h = 8u * dec->v_max;
+    uint32_t mcus_x = (dec->width + mcu_w - 1) / mcu_w;
+    uint32_t mcus_y = (dec->height + mcu_h - 1) / mcu_h;
+    if (dec->num_scan_components == 1) {
+        // Non-interleaved scan: one block per MCU
+        mcus_x = blocks_x;
+        mcus_y = blocks_y;
+        dec->components[0].h_samp = 1;
+        dec->components[0].v_samp = 1;
+    }
+
+    BitReader br = { dec->scan_data, dec->data_end, 0, 0, 0, 0 };
+    uint32_t restarts_left = dec->restart_interval;
+    int32_t* low_ac_ptr;
+    int32_t low_ac[3];
+
+    for (uint32_t my = 0; my < mcus_y; my++) {
+        for (uint32_t mx = 0; mx < mcus_x; mx++) {
+            if (dec->restart_interval) {
+                if (restarts_left == 0) {
+                    status = handle_restart(dec, &br);
+                    if (status != JPEG_DC_OK) return status;
+                    restarts_left = dec->restart_interval;
+                }
+                restarts_left--;
+            }
+
+            for (uint32_t s = 0; s < dec->num_scan_components; s++) {
+                uint32_t ci = dec->scan_components[s];
+                JpegComponent* c = &dec->components[ci];
+                low_ac_ptr = (ci == 0 && scale == JPEG_DC_SCALE_1_4) ? low_ac : 0;
+
+                for (uint32_t v = 0; v < c->v_samp; v++) {
+                    for (uint32_t h = 0; h < c->h_samp; h++) {
+                        int32_t dc;
+                        status = decode_block(dec, &br, c, &dc, low_ac_ptr);
+                        if (status != JPEG_DC_OK) return status;
+
+                        if (ci != 0) continue;  // Chroma is decoded only to skip it
+                        uint32_t bx = mx * c->h_samp + h;
+                        uint32_t by = my * c->v_samp + v;
+                        if (bx < blocks_x && by < blocks_y) {
+                            write_block(out, ow, oh, bx, by, scale, dc, low_ac);
+                        }
+                    }
+                }
+            }
+
+            // Bits were taken from the zero padding: data ended early
+            if (br.zero_bytes * 8 > (uint32_t)br.count) return JPEG_DC_ERR_TRUNCATED;
+        }
+    }
+
+    if (out_width) *out_width = ow;
+    if (out_height) *out_height = oh;
+    return JPEG_DC_OK;
+}
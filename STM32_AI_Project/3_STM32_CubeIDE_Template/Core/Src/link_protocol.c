@@ -0,0 +1,104 @@
+/*
+ * Serial Link Protocol
+ * Byte-wise frame decoder (safe to feed from a UART RX ring) and encoder
+ */
+
+#include "link_protocol.h"
+#include "crc32.h"
+#include <string.h>
+
+enum {
+    RX_SYNC0,
+    RX_SYNC1,
+    RX_HEADER,
+    RX_PAYLOAD,
+    RX_CRC
+};
+
+void link_decoder_init(LinkDecoder* dec) {
+    memset(dec, 0, sizeof(*dec));
+    dec->state = RX_SYNC0;
+}
+
+static uint32_t frame_crc(const LinkFrame* f) {
+    uint8_t header[4] = { f->type, f->seq, (uint8_t)f->length, (uint8_t)(f->length >> 8) };
+    uint32_t crc = crc32_update(0, header, sizeof(header));
+    return crc32_update(crc, f->payload, f->length);
+}
+
+int32_t link_decoder_push(LinkDecoder* dec, uint8_t byte) {
+    LinkFrame* f = &dec->frame;
+
+    switch (dec->state) {
+        case RX_SYNC0:
+            if (byte == LINK_SYNC0) dec->state = RX_SYNC1;
+            break;
+
+        case RX_SYNC1:
+            if (byte == LINK_SYNC1) {
+                dec->state = RX_HEADER;
+                dec->index = 0;
+            } else if (byte != LINK_SYNC0) {
+                dec->state = RX_SYNC0;
+            }
+            break;
+
+        case RX_HEADER:
+            if (dec->index == 0) f->type = byte;
+            else if (dec->index == 1) f->seq = byte;
+            else if (dec->index == 2) f->length = byte;
+            else f->length |= (uint16_t)(byte << 8);
+
+            if (++dec->index == 4) {
+                if (f->length > LINK_MAX_PAYLOAD) {
+                    dec->state = RX_SYNC0;  // Garbage length: resynchronize
+                } else {
+                    dec->index = 0;
+                    dec->state = f->length ? RX_PAYLOAD : RX_CRC;
+                }
+            }
+            break;
+
+        case RX_PAYLOAD:
+            f->payload[dec->index++] = byte;
+            if (dec->index == f->length) {
+                dec->index = 0;
+                dec->state = RX_CRC;
+            }
+            break;
+
+        case RX_CRC:
+            dec->crc_bytes[dec->index++] = byte;
+            if (dec->index == 4) {
+                dec->state = RX_SYNC0;
+                if (link_get_u32(dec->crc_bytes) == frame_crc(f)) {
+                    dec->frames_ok++;
+                    return 1;
+                }
+                dec->crc_errors++;
+            }
+            break;
+
+        default:
+            dec->state = RX_SYNC0;
+            break;
+    }
+    return 0;
+}
+
+uint32_t link_encode(uint8_t type, uint8_t seq, const uint8_t* payload, uint16_t length,
+                     uint8_t* out) {
+    uint32_t crc;
+    uint8_t header[4] = { type, seq, (uint8_t)length, (uint8_t)(length >> 8) };
+
+    out[0] = LINK_SYNC0;
+    out[1] = LINK_SYNC1;
+    memcpy(out + 2, header, sizeof(header));
+    if (length) memcpy(out + 6, payload, length);
+
+    crc = crc32_update(0, header, sizeof(header));
+    crc = crc32_update(crc, payload, length);
+    link_put_u32(out + 6 + length, crc);
+
+    return length + LINK_FRAME_OVERHEAD;
+}
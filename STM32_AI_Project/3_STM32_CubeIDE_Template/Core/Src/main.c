@@ -6,9 +6,34 @@
 #include "main.h"
 #include "stm32_ai_framework.h"
 #include "model_data.h"
+#include "model_update.h"
+#include "power_manager.h"
+#include "detection_config.h"
+#include "pixel_pipeline.h"
+#include "frame_pool.h"
+#include "dut_benchmark.h"
+#include "crc32.h"
+#include <string.h>
 
-// Global model instance
-FireDetectionModel fire_model;
+/* ==================== MODEL UPDATE SLOTS ==================== */
+// Two 256KB slots in flash bank 2: programming them does not stall
+// instruction fetch from bank 1, so inference keeps running. Sector erases
+// run in the background (HAL_FLASHEx_Erase_IT). Bank 2 cannot be read
+// while one runs: with the active model in the other bank-2 slot, weight
+// reads that miss the D-cache wait for it (up to a sector erase time per
+// 128KB). The built-in model in bank 1 never waits
+#define MODEL_SLOT_A_ADDR    0x08100000u
+#define MODEL_SLOT_B_ADDR    0x08140000u
+#define MODEL_SLOT_SIZE      (256u * 1024u)
+#define MODEL_BOOT_MAGIC     0xFD000000u
+#define FLASH_WORD_BYTES     32u     // MODEL_UPDATE_BLOCK_ALIGN: blocks never split a word
+
+#define UPDATE_RX_RING_SIZE  1024u
+
+static volatile uint8_t update_rx_ring[UPDATE_RX_RING_SIZE];
+static volatile uint32_t update_rx_head;
+static uint32_t update_rx_tail;
+static uint8_t update_rx_byte;
 
 void SystemClock_Config(void) {
     // CubeIDE generated clock configuration
@@ -33,11 +58,522 @@ void MX_USART2_UART_Init(void) {
     // For serial debugging and output
 }
 
+/* ==================== FLASH OPS ==================== */
+
+static volatile int32_t flash_erase_state;  // 1 running, 0 done, -1 failed
+
+/**
+ * Start erasing the sectors of [addr, addr + size); the flash interrupt
+ * reports the end (flash_erase_poll())
+ */
+static int32_t flash_erase(void* user, uint8_t* addr, uint32_t size) {
+    (void)user;
+    FLASH_EraseInitTypeDef erase = {0};
+
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Banks = FLASH_BANK_2;
+    erase.Sector = ((uint32_t)addr - FLASH_BANK2_BASE) / FLASH_SECTOR_SIZE;
+    erase.NbSectors = (size + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+    HAL_FLASH_Unlock();
+    flash_erase_state = 1;
+    if (HAL_FLASHEx_Erase_IT(&erase) != HAL_OK) {
+        flash_erase_state = 0;
+        HAL_FLASH_Lock();
+        return -1;
+    }
+    return 0;
+}
+
+static int32_t flash_erase_poll(void* user) {
+    (void)user;
+    int32_t state = flash_erase_state;
+    if (state <= 0) HAL_FLASH_Lock();
+    return state;
+}
+
+void FLASH_IRQHandler(void) {
+    HAL_FLASH_IRQHandler();
+}
+
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue) {
+    // Called per sector; 0xFFFFFFFF once the last one is erased
+    if (ReturnValue == 0xFFFFFFFFu) flash_erase_state = 0;
+}
+
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue) {
+    (void)ReturnValue;
+    flash_erase_state = -1;
+}
+
+static int32_t flash_write(void* user, uint8_t* dst, const uint8_t* src, uint32_t len) {
+    (void)user;
+    // H7 programs 256-bit flash words; pad the tail with the erased value
+    uint32_t word[FLASH_WORD_BYTES / 4];
+    int32_t result = 0;
+
+    HAL_FLASH_Unlock();
+    for (uint32_t off = 0; off < len; off += FLASH_WORD_BYTES) {
+        uint32_t n = (len - off < FLASH_WORD_BYTES) ? len - off : FLASH_WORD_BYTES;
+        memset(word, 0xFF, sizeof(word));
+        memcpy(word, src + off, n);
+
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, (uint32_t)(dst + off), (uint32_t)word) != HAL_OK) {
+            result = -1;
+            break;
+        }
+    }
+    HAL_FLASH_Lock();
+
+    // Inference reads the new image through the D-cache
+    ai_cache_invalidate(dst, len);
+    return result;
+}
+
+/**
+ * Record the active slot in the backup domain so a reset keeps the update
+ */
+static void flash_activate(void* user, uint32_t slot, uint32_t length) {
+    (void)user;
+    const uint8_t* base = (const uint8_t*)(slot ? MODEL_SLOT_B_ADDR : MODEL_SLOT_A_ADDR);
+
+    HAL_PWR_EnableBkUpAccess();
+    RTC->BKP0R = MODEL_BOOT_MAGIC | slot;
+    RTC->BKP1R = length;
+    RTC->BKP2R = crc32_update(0, base, length);
+}
+
+/**
+ * Pick the boot model: a recorded slot whose CRC still matches, else the built-in one
+ */
+static int32_t select_boot_model(const uint8_t** data, uint32_t* length) {
+    uint32_t record = RTC->BKP0R;
+    *data = model_data;
+    *length = model_data_len;
+
+    if ((record & 0xFFFFFF00u) != MODEL_BOOT_MAGIC || (record & 0xFFu) > 1) return -1;
+
+    const uint8_t* base = (const uint8_t*)((record & 1u) ? MODEL_SLOT_B_ADDR : MODEL_SLOT_A_ADDR);
+    uint32_t len = RTC->BKP1R;
+    if (len == 0 || len > MODEL_SLOT_SIZE || crc32_update(0, base, len) != RTC->BKP2R) return -1;
+
+    *data = base;
+    *length = len;
+    return (int32_t)(record & 1u);
+}
+
+/* ==================== UPDATE LINK ==================== */
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef* huart) {
+    if (huart == &huart2) {
+        uint32_t next = (update_rx_head + 1) % UPDATE_RX_RING_SIZE;
+        if (next != update_rx_tail) {  // Drop on overflow; the host re-queries
+            update_rx_ring[update_rx_head] = update_rx_byte;
+            update_rx_head = next;
+        }
+        HAL_UART_Receive_IT(&huart2, &update_rx_byte, 1);
+    }
+}
+
+/**
+ * Feed received bytes to the updater and send its replies
+ * Replies share USART2 with the log output; the host skips non-frame bytes.
+ */
+static void service_update_link(ModelUpdater* updater) {
+    static uint8_t rx[64];
+    static uint8_t tx[LINK_MAX_FRAME];
+
+    while (update_rx_tail != update_rx_head) {
+        uint32_t n = 0;
+        while (update_rx_tail != update_rx_head && n < sizeof(rx)) {
+            rx[n++] = update_rx_ring[update_rx_tail];
+            update_rx_tail = (update_rx_tail + 1) % UPDATE_RX_RING_SIZE;
+        }
+
+        // A 64-byte slice completes at most one frame, so tx holds any reply
+        uint32_t tx_len = model_update_process(updater, rx, n, tx, sizeof(tx));
+        if (tx_len) HAL_UART_Transmit(&huart2, tx, tx_len, 100);
+    }
+
+    // Blocks that waited for a sector erase are written once it ends
+    model_update_poll(updater);
+}
+
+/* ==================== CAMERA ==================== */
+// DCMI captures RGB565 QQVGA frames into camera_frame. The CPU resamples
+// each one into the model input; the DMA2D converts it into the RGB888
+// preview (display / uplink) while inference runs and tints the flame
+// map over it after the decision
+
+#define CAMERA_WIDTH         160u
+#define CAMERA_HEIGHT        120u
+#define FLAME_TINT_COLOR     0xFFFF4000u     // Orange; a cell's heat sets its alpha (up to half)
+
+static PixelPipeline pixels;
+static uint16_t camera_frame[AI_CACHE_ROUND(CAMERA_WIDTH * CAMERA_HEIGHT * 2u) / 2u] AI_DMA_BUFFER;
+static uint8_t preview_frame[AI_CACHE_ROUND(CAMERA_WIDTH * CAMERA_HEIGHT * 3u)] AI_DMA_BUFFER;
+static uint32_t preview_ticket;      // Last job on preview_frame
+
+void DMA2D_IRQHandler(void) {
+    pixel_dma2d_irq(&pixels);
+}
+
+static void queue_preview(void) {
+    PixelJob convert = {0};
+    uint32_t ticket;
+
+    convert.mode = PIXEL_MODE_CONVERT;
+    convert.alpha = 255;
+    convert.width = CAMERA_WIDTH;
+    convert.height = CAMERA_HEIGHT;
+    convert.fg = pixel_surface(camera_frame, CAMERA_WIDTH, PIXEL_RGB565, 0, 0);
+    convert.dst = pixel_surface(preview_frame, CAMERA_WIDTH, PIXEL_RGB888, 0, 0);
+    if (pixel_submit(&pixels, &convert, &ticket) == PIXEL_OK) {
+        preview_ticket = ticket;
+    }
+}
+
+/**
+ * Tint each warm cell of the flame map over the preview
+ */
+static void queue_flame_overlay(const DetectionResult* result) {
+    const uint16_t cell_w = CAMERA_WIDTH / AI_CAM_GRID;
+    const uint16_t cell_h = CAMERA_HEIGHT / AI_CAM_GRID;
+
+    for (uint32_t i = 0; i < AI_CAM_CELLS; i++) {
+        PixelJob tint = {0};
+        uint32_t ticket;
+        if (result->cam_heat[i] == 0) continue;
+
+        tint.mode = PIXEL_MODE_TINT;
+        tint.alpha = result->cam_heat[i] / 2u;
+        tint.width = cell_w;
+        tint.height = cell_h;
+        tint.bg = pixel_surface(preview_frame, CAMERA_WIDTH, PIXEL_RGB888,
+                                (i % AI_CAM_GRID) * cell_w, (i / AI_CAM_GRID) * cell_h);
+        tint.dst = tint.bg;
+        tint.color = FLAME_TINT_COLOR;
+        if (pixel_submit(&pixels, &tint, &ticket) == PIXEL_OK) {
+            preview_ticket = ticket;
+        }
+    }
+}
+
+/* ==================== FRAME BUFFERS ==================== */
+// Model-input frames are shared, not copied: inference, the pre-alarm
+// history, the snapshot uplink and the debug dump each hold a reference,
+// and a buffer returns to the pool when the last one lets go. With every
+// buffer held, the capture takes the oldest history frame (FRAME_DROP_OLDEST)
+
+#define FRAME_BUFFERS        8u
+#define FRAME_HISTORY_DEPTH  4u      // Frames before an alarm, sent with its snapshot
+#define FRAME_UPLINK_DEPTH   6u      // An alarm's history + the alarm frame, + 1
+#define FRAME_DUMP_PERIOD    0u      // Debug: dump every Nth CNN frame (0: off)
+
+static FramePool frames;
+static uint8_t frame_memory[FRAME_POOL_MEMORY(FRAME_BUFFERS, AI_ENGINE_MAX_IMAGE)] AI_FRAME_BUFFER;  // 128KB: AXI SRAM
+static FrameQueue frame_history;
+static FrameQueue frame_uplink;
+static FrameQueue frame_dump;
+
+/**
+ * FRAME_DROP_OLDEST hook: the history gives up its oldest frame
+ */
+static int32_t reclaim_history(void* user) {
+    (void)user;
+    FrameBuffer* oldest = frame_queue_pop(&frame_history);
+    if (!oldest) return 0;
+    frame_release(&frames, oldest);
+    return 1;
+}
+
+/**
+ * Alarm snapshot: the history (ending with the alarm frame) goes to the
+ * uplink by reference
+ * A backlog the uplink has not sent yet gives way: the newest alarm wins.
+ */
+static void queue_snapshot(void) {
+    const uint32_t overwritten = frame_uplink.overwritten;
+
+    for (uint32_t i = 0; i < frame_queue_count(&frame_history); i++) {
+        frame_queue_push(&frames, &frame_uplink, frame_queue_peek(&frame_history, i), 1);
+    }
+    if (frame_uplink.overwritten != overwritten) {
+        printf("  ⚠ Uplink backlog full: %lu unsent snapshot frames dropped\n",
+               frame_uplink.overwritten - overwritten);
+    }
+}
+
+/**
+ * Send one queued uplink frame and one debug dump per call
+ * An asynchronous send keeps its reference and drops it from the
+ * transfer's completion interrupt (frame_release() is ISR-safe).
+ */
+static void service_frames(void) {
+    FrameBuffer* frame = frame_queue_pop(&frame_uplink);
+    if (frame) {
+        // This is a placeholder - send the snapshot over your uplink
+        // uplink_send_frame(frame->data, frame->width, frame->height, frame->channels,
+        //                   frame->seq, frame->timestamp_ms);
+        printf("  Snapshot: frame %lu at %lu ms, %ux%ux%u\n", frame->seq, frame->timestamp_ms,
+               frame->width, frame->height, frame->channels);
+        frame_release(&frames, frame);
+    }
+
+    frame = frame_queue_pop(&frame_dump);
+    if (frame) {
+        // This is a placeholder - write the frame to SD / a debug probe buffer
+        // debug_dump_frame(frame->data, frame->width * frame->height * frame->channels, frame->seq);
+        frame_release(&frames, frame);
+    }
+}
+
+/* ==================== THERMAL SENSOR ==================== */
+#define THERMAL_I2C_ADDR     (0x33u << 1)
+
+static ThermalSensor thermal AI_DMA_BUFFER;
+static ThermalCalibration thermal_cal;
+
+static int32_t thermal_read_dma(void* user, uint16_t reg, uint8_t* dst, uint16_t len) {
+    (void)user;
+    return (HAL_I2C_Mem_Read_DMA(&hi2c1, THERMAL_I2C_ADDR, reg, I2C_MEMADD_SIZE_16BIT, dst, len) == HAL_OK) ? 0 : -1;
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c) {
+    if (hi2c == &hi2c1) {
+        thermal_dma_complete(&thermal);
+    }
+}
+
+/**
+ * Calibration parameters from the sensor EEPROM
+ * This is a placeholder - dump the EEPROM and run the vendor's parameter
+ * extraction (MLX90640_DumpEE / MLX90640_ExtractParameters), then copy
+ * gain, offsets, alpha, kta and kv into thermal_cal.
+ */
+static void load_thermal_calibration(ThermalCalibration* cal) {
+    cal->gain = 1.0f;
+    cal->emissivity = 0.95f;
+    cal->ta_ref = 25.0f;
+    cal->vdd_ref = 3.3f;
+    for (uint32_t i = 0; i < THERMAL_PIXELS; i++) {
+        cal->offset[i] = 0;
+        cal->alpha[i] = 1.0e-7f;
+        cal->kta[i] = 0.0f;
+        cal->kv[i] = 0.0f;
+    }
+}
+
+/* ==================== ANALOG SENSORS ==================== */
+// ADC1 scans smoke, CO, temperature (ANALOG_CH_* order) on a 1 kHz timer
+// trigger into a circular half-word DMA buffer
+
+static AnalogAcquisition analog;
+static uint16_t analog_dma[ANALOG_DMA_SAMPLES] AI_DMA_BUFFER;
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc) {
+    if (hadc == &hadc1) {
+        analog_dma_half(&analog);
+    }
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
+    if (hadc == &hadc1) {
+        analog_dma_complete(&analog);
+    }
+}
+
+/* ==================== AUDIO ==================== */
+// PDM microphone on SPI2 (receive-only master, 1.024 MHz clock) into a
+// circular byte DMA buffer; the crackle classifier shares the main loop's
+// time between vision frames
+
+#define AUDIO_CLASSIFY_HOPS  16u     // One classification per 256 ms of audio
+
+static AudioFrontEnd audio;
+static FireDetectionModel crackle_model;
+static uint8_t audio_pdm_dma[AUDIO_PDM_DMA_BYTES] AI_DMA_BUFFER;
+static int audio_classifier_ready;
+static float audio_crackle;          // Latest classifier output
+static uint32_t audio_classified_hop;
+static uint32_t audio_classify_ms = 1;   // Measured cost of one classification
+
+#define AUDIO_HALF_BYTES     (AUDIO_PDM_DMA_BYTES / 2)
+
+void HAL_SPI_RxHalfCpltCallback(SPI_HandleTypeDef* hspi) {
+    if (hspi == &hspi2) {
+        audio_pdm_push(&audio, audio_pdm_dma, AUDIO_HALF_BYTES);
+    }
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef* hspi) {
+    if (hspi == &hspi2) {
+        audio_pdm_push(&audio, audio_pdm_dma + AUDIO_HALF_BYTES, AUDIO_HALF_BYTES);
+    }
+}
+
+/**
+ * Frame pending audio into feature rows, then classify the window every
+ * AUDIO_CLASSIFY_HOPS hops if that fits in the budget_ms left before the
+ * next vision frame (a skipped window is retried on the next call)
+ */
+static void service_audio(uint32_t budget_ms) {
+    audio_process(&audio);
+    if (!audio_classifier_ready || audio.hops < AUDIO_FEATURE_FRAMES ||
+        audio.hops - audio_classified_hop < AUDIO_CLASSIFY_HOPS || budget_ms <= audio_classify_ms) {
+        return;
+    }
+    uint32_t start = HAL_GetTick();
+    audio_crackle = fire_detection_inference_image(&crackle_model, audio_features(&audio));
+    audio_classify_ms = HAL_GetTick() - start + 1;  // Round up to the next tick
+    audio_classified_hop = audio.hops;
+}
+
+/* ==================== POWER ==================== */
+// RTC on the 32.768 kHz LSE: its wakeup timer ends Stop, and time of day
+// + subseconds is the clock that keeps counting through it. The PIR
+// output is on EXTI (CubeMX label PIR); COMP1 compares the smoke channel
+// with a DAC threshold so a rise also wakes Stop, where the ADC is halted.
+
+#define RTC_WAKEUP_HZ        2048u   // RTCCLK / 16
+
+static PowerManager power;
+static ModelUpdater* power_updater;  // Serviced while waiting between ALERT frames
+
+static uint32_t power_now_ms(void* user) {
+    (void)user;
+    static uint32_t last_ms, day_ms;
+    RTC_TimeTypeDef time;
+    RTC_DateTypeDef date;
+
+    HAL_RTC_GetTime(&hrtc, &time, RTC_FORMAT_BIN);
+    HAL_RTC_GetDate(&hrtc, &date, RTC_FORMAT_BIN);  // Unlocks the shadow registers
+    uint32_t ms = ((time.Hours * 60u + time.Minutes) * 60u + time.Seconds) * 1000u +
+                  (time.SecondFraction - time.SubSeconds) * 1000u / (time.SecondFraction + 1u);
+    if (ms < last_ms) day_ms += 24u * 3600u * 1000u;  // Midnight
+    last_ms = ms;
+    return day_ms + ms;
+}
+
+static void power_wait_platform(void* user, uint32_t ms, int deep) {
+    (void)user;
+    if (deep) {
+        // Stop: SysTick, the DMA-driven sensors and the camera halt; the RTC
+        // wakeup timer, PIR EXTI and COMP1 keep running
+        uint32_t ticks = ms * RTC_WAKEUP_HZ / 1000u;
+        HAL_RTCEx_SetWakeUpTimer_IT(&hrtc, ticks > 0xFFFFu ? 0xFFFFu : ticks, RTC_WAKEUPCLOCK_RTCCLK_DIV16);
+        HAL_SuspendTick();
+        HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+        SystemClock_Config();        // Stop exits on HSI: restore the PLL
+        HAL_ResumeTick();
+        HAL_RTCEx_DeactivateWakeUpTimer(&hrtc);
+        return;
+    }
+
+    // Sleep between ALERT frames; audio features and crackle classification
+    // fill the gap, and a channel that starts rising wakes the next frame
+    uint32_t start = HAL_GetTick();
+    uint8_t analog_level = analog.decision.level;
+    uint32_t elapsed;
+    while ((elapsed = HAL_GetTick() - start) < ms) {
+        service_update_link(power_updater);
+        service_audio(ms - elapsed);
+        analog_poll(&analog);
+        if (analog.decision.level > analog_level) {
+            power_wake_event(&power, POWER_WAKE_ANALOG);
+            return;
+        }
+        __WFI();                     // SysTick ends it within 1 ms
+    }
+}
+
+static void power_camera(void* user, int on) {
+    (void)user;
+    // This is a placeholder - drive the camera's PWDN / supply enable
+    // camera_set_power(on);
+    (void)on;
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+    if (GPIO_Pin == PIR_Pin) {
+        power_wake_event(&power, POWER_WAKE_PIR);
+    }
+}
+
+void HAL_COMP_TriggerCallback(COMP_HandleTypeDef* hcomp) {
+    if (hcomp == &hcomp1) {
+        power_wake_event(&power, POWER_WAKE_ANALOG);
+    }
+}
+
+/* ==================== CONFIGURATION ==================== */
+// Thresholds and the vision schedule (a screening frame every
+// screen_period_ms with Stop in between, the CNN every active_period_ms
+// once there is evidence) arrive over the update link as
+// LINK_MSG_CFG_SET and take effect at the next frame boundary
+
+static ConfigStore detection_config;
+
+/**
+ * Frame boundary: the configuration for this frame; a new version
+ * reschedules the power manager
+ */
+static const DetectionConfig* take_config(void) {
+    static uint32_t applied_version;
+    const DetectionConfig* cfg = config_acquire(&detection_config);
+
+    if (cfg->params.version != applied_version) {
+        applied_version = cfg->params.version;
+        power.policy.screen_period_ms = cfg->params.screen_period_ms;
+        power.policy.active_period_ms = cfg->params.active_period_ms;
+        power.policy.hold_ms = cfg->params.hold_ms;
+        printf("✓ Config v%lu: fire %.2f / critical %.2f | screen %lu ms, CNN %lu ms, hold %lu ms\n",
+               cfg->params.version, cfg->params.fire, cfg->params.critical,
+               cfg->params.screen_period_ms, cfg->params.active_period_ms, cfg->params.hold_ms);
+    }
+    return cfg;
+}
+
+/* ==================== BENCHMARK ==================== */
+// A host benchmark session (2_Desktop_Tools/dut_benchmark.py) runs its
+// tensors on fire_model inside the link handler, timed by the DWT cycle
+// counter. Frames, Stop and model swaps wait until it ends; the ADC and
+// microphone DMA pause so their interrupts stay out of the counts.
+
+static DutSession dut;
+static uint8_t dut_input[AI_ENGINE_MAX_IMAGE];
+
+static uint32_t dut_cycles(void* user) {
+    (void)user;
+    return DWT->CYCCNT;
+}
+
+static void dut_session(void* user, int32_t active) {
+    (void)user;
+    if (active) {
+        HAL_ADC_Stop_DMA(&hadc1);
+        HAL_SPI_DMAStop(&hspi2);
+        printf("Benchmark session: frames paused\n");
+        return;
+    }
+    ai_cache_receive(analog_dma, sizeof(analog_dma));
+    HAL_ADC_Start_DMA(&hadc1, (uint32_t*)analog_dma, ANALOG_DMA_SAMPLES);
+    ai_cache_receive(audio_pdm_dma, sizeof(audio_pdm_dma));
+    HAL_SPI_Receive_DMA(&hspi2, audio_pdm_dma, AUDIO_PDM_DMA_BYTES);
+    printf("✓ Benchmark session ended: %lu runs, %lu inferences\n", dut.runs, dut.inferences);
+}
+
 /**
  * Main application loop
  */
 int main(void) {
+    // Model context: all mutable engine state (static, not on the stack)
+    static FireDetectionModel fire_model;
+    static ModelUpdater updater;
+    
     HAL_Init();
+    ai_memory_init();  // MPU map, then I- and D-cache, before any DMA starts
     SystemClock_Config();
     MX_GPIO_Init();
     MX_USART2_UART_Init();
@@ -45,37 +581,195 @@ int main(void) {
     printf("=== STM32 Fire Detection System ===\n");
     printf("Initializing AI model...\n");
     
-    // Initialize AI model
-    if (fire_detection_init(&fire_model) != 0) {
+    // Initialize AI model (last updated slot if it is still intact and
+    // runs, else the built-in one)
+    const uint8_t* boot_data;
+    uint32_t boot_len;
+    int32_t boot_slot = select_boot_model(&boot_data, &boot_len);
+    if (boot_slot >= 0 && fire_detection_init_model(&fire_model, boot_data, boot_len, &model_info) != 0) {
+        printf("⚠ Update slot %ld does not initialize, falling back to the built-in model\n", boot_slot);
+        boot_data = model_data;
+        boot_len = model_data_len;
+        boot_slot = -1;
+    }
+    if (boot_slot < 0 && fire_detection_init_model(&fire_model, boot_data, boot_len, &model_info) != 0) {
         printf("ERROR: Model initialization failed\n");
         return 1;
     }
-    printf("✓ Model loaded successfully\n");
+    printf("✓ Model loaded successfully (%s)\n", boot_slot < 0 ? "built-in" : "update slot");
+    if (fire_detection_set_cam(&fire_model, 1) == 0) {
+        printf("✓ Flame localization map: %ux%u cells\n", AI_CAM_GRID, AI_CAM_GRID);
+    }
+
+    // Delta updates arrive over USART2 while inference keeps running
+    const ModelSlot slots[2] = {
+        { (uint8_t*)MODEL_SLOT_A_ADDR, MODEL_SLOT_SIZE },
+        { (uint8_t*)MODEL_SLOT_B_ADDR, MODEL_SLOT_SIZE }
+    };
+    const ModelFlashOps flash_ops = {
+        flash_erase, flash_erase_poll, flash_write, flash_activate, FLASH_SECTOR_SIZE, NULL
+    };
+    HAL_NVIC_EnableIRQ(FLASH_IRQn);  // Erase completion (flash_erase_poll())
+    model_update_init(&updater, boot_data, boot_len, boot_slot, slots, &flash_ops);
+    model_update_set_check(&updater, fire_detection_check_model);  // Before a slot is activated
+
+    // Configuration and benchmark messages share the link (built-in
+    // thresholds until then)
+    config_init(&detection_config, NULL);
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;  // DWT cycle counter for benchmark runs
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    const DutOps dut_ops = { dut_cycles, dut_session, SystemCoreClock, "stm32", NULL };
+    dut_init(&dut, &fire_model, dut_input, sizeof(dut_input), &dut_ops);
+    dut_set_next(&dut, config_link_handler, &detection_config);
+    model_update_set_handler(&updater, dut_link_handler, &dut);
+    HAL_UART_Receive_IT(&huart2, &update_rx_byte, 1);
+
+    // Analog channels run continuously from here on, without CPU polling
+    analog_init(&analog, analog_dma, NULL);
+    ai_cache_receive(analog_dma, sizeof(analog_dma));
+    HAL_ADC_Start_DMA(&hadc1, (uint32_t*)analog_dma, ANALOG_DMA_SAMPLES);
+
+    // Microphone: PDM decimation runs in the SPI DMA callbacks from here
+    // on; the crackle classifier stays off until a trained image is built in
+    audio_init(&audio);
+    audio_classifier_ready =
+        fire_detection_init_model(&crackle_model, audio_model_data, audio_model_data_len, &audio_model_info) == 0 &&
+        crackle_model.engine_layers > 0;
+    if (!audio_classifier_ready) {
+        printf("⚠ No crackle model, audio classifier off\n");
+    }
+    ai_cache_receive(audio_pdm_dma, sizeof(audio_pdm_dma));
+    HAL_SPI_Receive_DMA(&hspi2, audio_pdm_dma, AUDIO_PDM_DMA_BYTES);
+
+    // Duty cycle: Stop between screening frames until there is evidence
+    const DetectionParams* schedule = &config_acquire(&detection_config)->params;
+    const PowerPolicy power_policy = {
+        schedule->screen_period_ms, schedule->active_period_ms, schedule->hold_ms, 5u, 220u, 4u, 24u
+    };
+    const PowerOps power_ops = { power_now_ms, power_wait_platform, power_camera, NULL };
+    power_updater = &updater;
+    power_init(&power, &power_policy, &power_ops);
+    HAL_COMP_Start_IT(&hcomp1);
+
+    // Pixel jobs on the DMA2D, checked once against the software path
+    __HAL_RCC_DMA2D_CLK_ENABLE();
+    HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+    const PixelOps pixel_ops = { pixel_dma2d_start, NULL };
+    pixel_init(&pixels, &pixel_ops);
+    if (pixel_selftest(&pixels) != 0) {
+        printf("⚠ DMA2D output differs from the software path, pixel jobs on the CPU\n");
+        pixel_init(&pixels, NULL);
+    }
+
+    // Thermal array: per-pixel coefficients are folded once here, frames
+    // then arrive by I2C DMA while inference runs
+    const ThermalBusOps thermal_bus = { thermal_read_dma, NULL };
+    load_thermal_calibration(&thermal_cal);
+    if (thermal_init(&thermal, &thermal_cal, &thermal_bus) != THERMAL_OK) {
+        printf("⚠ Thermal calibration out of range, running vision only\n");
+    }
+    
+    // Frames at the model's input resolution (up to 128x128 for patch-based
+    // models, which take 8-bit frames without a float copy), shared by
+    // reference from here on
+    const FramePoolOps frame_ops = { reclaim_history, NULL };
+    frame_pool_init(&frames, frame_memory, sizeof(frame_memory), AI_ENGINE_MAX_IMAGE, FRAME_DROP_OLDEST, &frame_ops);
+    frame_queue_init(&frame_history, FRAME_HISTORY_DEPTH);
+    frame_queue_init(&frame_uplink, FRAME_UPLINK_DEPTH);
+    frame_queue_init(&frame_dump, 1);
     
     uint32_t frame_count = 0;
     uint32_t detections = 0;
+    int32_t alarm = 0;                   // Last CNN frame detected fire
     
     while (1) {
-        // Capture image from camera sensor
+        // Benchmark session: only the link, until DUT_END or the host goes quiet
+        if (dut_poll(&dut, HAL_GetTick())) {
+            service_update_link(&updater);
+            continue;
+        }
+
+        // Stop / Sleep until the next frame is due or a PIR / smoke wake
+        uint8_t stage = power_stage(&power, power_wait(&power));
+        if (stage == POWER_STAGE_NONE) {
+            continue;
+        }
+        const DetectionConfig* cfg = take_config();
+
+        // Capture image from camera sensor, once the last frame's preview
+        // jobs are done reading camera_frame
         // This is a placeholder - implement with your camera driver
-        uint8_t sensor_image[1024];
-        // camera_read_frame(sensor_image, 1024);
+        pixel_wait(&pixels, preview_ticket);
+        // ai_cache_receive(camera_frame, sizeof(camera_frame));
+        // camera_read_frame(camera_frame, sizeof(camera_frame));
+        // ai_cache_invalidate(camera_frame, sizeof(camera_frame));
         
-        // For demo: generate synthetic frame
-        for (int i = 0; i < 1024; i++) {
-            sensor_image[i] = (frame_count % 256);
+        // For demo: generate synthetic frame (flat gray)
+        const uint32_t level = frame_count % 256;
+        for (uint32_t i = 0; i < CAMERA_WIDTH * CAMERA_HEIGHT; i++) {
+            camera_frame[i] = (uint16_t)(((level >> 3) << 11) | ((level >> 2) << 5) | (level >> 3));
         }
         
-        // Preprocess image
-        preprocess_image(sensor_image, 1024, fire_model.input_buffer);
+        // Model input on the CPU into a pool frame: the DMA2D cannot scale,
+        // and the bilinear taps read only a fraction of the frame
+        service_frames();
+        FrameBuffer* frame = frame_acquire(&frames);
+        if (!frame) {
+            // Every buffer is on its way to the uplink: skip this frame
+            printf("⚠ Frame pool exhausted, frame skipped (%lu dropped)\n", frames.dropped);
+            power_report(&power, stage, alarm);
+            continue;
+        }
+        const ModelInfo* input = fire_model.info;
+        const PixelSurface camera = pixel_surface(camera_frame, CAMERA_WIDTH, PIXEL_RGB565, 0, 0);
+        uint32_t frame_size = input->input_width * input->input_height * input->input_channels;
+        pixel_resample(&camera, CAMERA_WIDTH, CAMERA_HEIGHT, frame->data,
+                       input->input_width, input->input_height, input->input_channels);
+        frame->timestamp_ms = power_now_ms(NULL);
+        frame->width = input->input_width;
+        frame->height = input->input_height;
+        frame->channels = input->input_channels;
+        frame_queue_push(&frames, &frame_history, frame, 1);
         
-        // Run inference
+        // Cheap screening while IDLE: brightness change or a rising analog
+        // channel escalates to the full-rate CNN
+        if (stage == POWER_STAGE_SCREEN) {
+            service_update_link(&updater);  // Transfers resume where Stop cut them off
+            analog_poll(&analog);
+            int32_t evidence = power_screen_frame(&power, frame->data, frame_size) ||
+                               analog.decision.level != ANALOG_QUIET;
+            frame_release(&frames, frame);
+            power_report(&power, stage, evidence);
+            if (evidence) {
+                printf("Screening: evidence, CNN at %lu ms frames (%lu escalations)\n",
+                       cfg->params.active_period_ms, power.escalations);
+            }
+            continue;
+        }
+
+        // Preview conversion on the DMA2D and the next thermal frame read
+        // in the background; the previous thermal frame is converted below
+        queue_preview();
         uint32_t start_time = HAL_GetTick();
-        float confidence = fire_detection_inference(&fire_model);
+        thermal_start_read(&thermal);
+
+        // Run inference (normalization is folded into the engine's input quantization)
+        float confidence = fire_detection_inference_image(&fire_model, frame->data);
         fire_model.inference_time_ms = HAL_GetTick() - start_time;
         
         // Process results
-        DetectionResult result = process_detection_output(&fire_model);
+        const DetectionThresholds* th = &cfg->thresholds;
+        DetectionResult result = process_detection_output(&fire_model, th);
+        thermal_process(&thermal);
+        if (thermal.frames) {
+            fire_detection_fuse_thermal(&result, &thermal.spots, th);
+        }
+        analog_poll(&analog);
+        fire_detection_fuse_analog(&result, &analog.decision, th);
+        if (audio_classifier_ready) {
+            fire_detection_fuse_audio(&result, audio_crackle, th);
+        }
         
         // Log metrics
         printf("[%lu] Confidence: %.2f%% | Time: %ldms | Status: %s\n",
@@ -83,6 +777,44 @@ int main(void) {
                result.confidence * 100,
                fire_model.inference_time_ms,
                result.fire_detected ? "FIRE" : "SAFE");
+        if (fire_model.tasks_run & AI_TASK_BIT(AI_TASK_SMOKE)) {
+            printf("  Smoke: %.2f%%%s\n", result.smoke_confidence * 100,
+                   result.smoke_detected ? " (SMOKE)" : "");
+        }
+        if (result.location_valid) {
+            printf("  Location: cell (%u,%u) of %ux%u, %.2f%%\n", result.location_x, result.location_y,
+                   result.location_grid, result.location_grid, result.location_confidence * 100);
+        }
+        if (result.cam_valid) {
+            queue_flame_overlay(&result);
+            printf("  Flame map: peak at (%u,%u) px |", result.cam_peak_x, result.cam_peak_y);
+            for (uint32_t i = 0; i < AI_CAM_CELLS; i++) {
+                printf("%s%3u", (i % AI_CAM_GRID) ? " " : " /", result.cam_heat[i]);
+            }
+            printf("\n");
+        }
+        if (thermal.frames) {
+            printf("  Thermal: max %.1fC at (%u,%u) | %u hot px%s\n", result.temperature_estimate,
+                   thermal.spots.max_x, thermal.spots.max_y, thermal.spots.hot_pixels,
+                   result.thermal_hot ? " (HOT)" : "");
+        }
+        if (analog.decision.level != ANALOG_QUIET) {
+            printf("  Analog: %s (channels 0x%x) | smoke +%ld CO +%ld temp +%ld counts\n",
+                   analog.decision.level == ANALOG_ALARM ? "ALARM" : "watch", analog.decision.channels,
+                   analog.decision.rise[ANALOG_CH_SMOKE] / 16, analog.decision.rise[ANALOG_CH_CO] / 16,
+                   analog.decision.rise[ANALOG_CH_TEMP] / 16);
+        }
+        if (result.crackle_detected) {
+            printf("  Audio: crackle %.2f%% | %lu hops, %lu samples dropped\n",
+                   result.crackle_confidence * 100, audio.hops, audio.overruns);
+        }
+        
+        // Multi-task models: the localization head only runs on the
+        // frame after a detection or an analog alarm, saving its cycles on
+        // quiet frames
+        int locate = result.fire_detected || analog.decision.level == ANALOG_ALARM;
+        fire_detection_set_tasks(&fire_model, AI_TASK_BIT(AI_TASK_FIRE) | AI_TASK_BIT(AI_TASK_SMOKE) |
+                                 (locate ? AI_TASK_BIT(AI_TASK_LOCATION) : 0));
         
         // Action on fire detection
         if (result.fire_detected) {
@@ -90,6 +822,11 @@ int main(void) {
             detections++;
             printf("  ⚠ FIRE ALERT (Total: %lu)\n", detections);
             
+            // The frames leading up to a new alarm go to the uplink
+            if (!alarm) {
+                queue_snapshot();
+            }
+            
             // Additional actions:
             // - Trigger siren/buzzer
             // - Send alert to cloud
@@ -98,11 +835,35 @@ int main(void) {
         } else {
             HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET);  // Turn off alert LED
         }
+        alarm = result.fire_detected;
+        if (FRAME_DUMP_PERIOD && frame_count % FRAME_DUMP_PERIOD == 0) {
+            frame_queue_push(&frames, &frame_dump, frame, 0);
+        }
+        frame_release(&frames, frame);  // Inference is done with it
+        
+        // Preview out once its jobs are done
+        // This is a placeholder - hand preview_frame to the display / uplink
+        // pixel_wait(&pixels, preview_ticket);
+        // display_show_rgb888(preview_frame, CAMERA_WIDTH, CAMERA_HEIGHT);
         
         frame_count++;
         
-        // Run inference at 10 FPS (100ms interval)
-        HAL_Delay(100);
+        // Frame boundary: switch to a verified update between inferences
+        const uint8_t* new_model;
+        uint32_t new_len;
+        if (model_update_take_swap(&updater, &new_model, &new_len)) {
+            // Checked at commit; a refusal here keeps the running model
+            if (fire_detection_init_model(&fire_model, new_model, new_len, &model_info) == 0) {
+                fire_detection_set_cam(&fire_model, 1);
+                printf("✓ Model updated: %lu bytes (slot %ld)\n", new_len, updater.active_slot);
+            } else {
+                printf("⚠ Updated model rejected, keeping the running one\n");
+            }
+        }
+        
+        // Detection, a borderline frame or rising channels keep ALERT going
+        power_report(&power, stage, result.fire_detected || result.confidence >= cfg->params.evidence ||
+                                    analog.decision.level != ANALOG_QUIET);
         
         // Safety check: reset watchdog
         // HAL_IWDG_Refresh(&hiwdg);
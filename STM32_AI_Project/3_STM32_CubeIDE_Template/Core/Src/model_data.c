@@ -0,0 +1,30 @@
+/*
+ * Quantized Fire Detection Model (int8)
+ * Generated by: stm32_model_converter.py
+ *
+ * Definitions live here (not in model_data.h) so the header can be
+ * included from any number of translation units.
+ */
+
+#include "model_data.h"
+
+// Quantized model weights (int8)
+// In production, this is generated by stm32_model_converter.py
+const uint8_t model_data[] = {
+    // TensorFlow Lite model binary
+    // Placeholder: real model would be ~50KB
+    0x4C, 0x49, 0x54, 0x45, // "LITE" header
+    0x00, 0x00, 0x00, 0x00,
+    // ... actual model binary data ...
+};
+
+const uint32_t model_data_len = sizeof(model_data);
+
+const ModelInfo model_info = {
+    .model_name = "FireDetectionV2",
+    .model_version = "2.0",
+    .input_width = 32,
+    .input_height = 32,
+    .input_channels = 3,
+    .confidence_threshold = 0.7f
+};
@@ -0,0 +1,378 @@
+/*
+ * Delta Model Updates
+ * Streaming FDP1 patch applier + update side of the link protocol
+ */
+
+#include "model_update.h"
+#include "crc32.h"
+#include <string.h>
+
+#define REPLY_LENGTH 6  // status u8 | state u8 | next_offset u32
+
+void model_update_init(ModelUpdater* upd, const uint8_t* active_data, uint32_t active_length,
+                       int32_t active_slot, const ModelSlot slots[2], const ModelFlashOps* flash) {
+    memset(upd, 0, sizeof(*upd));
+    upd->slots[0] = slots[0];
+    upd->slots[1] = slots[1];
+    upd->flash = *flash;
+    upd->active_data = active_data;
+    upd->active_length = active_length;
+    upd->active_slot = active_slot;
+    upd->target_slot = -1;
+    upd->state = MODEL_UPD_IDLE;
+
+    // Patches are checked against this before anything is written
+    upd->active_crc = crc32_update(0, active_data, active_length);
+    link_decoder_init(&upd->rx);
+}
+
+/* ==================== PATCH APPLICATION ==================== */
+
+static uint32_t target_block_length(const ModelUpdater* upd) {
+    uint32_t remaining = upd->header.target_length - upd->write_offset;
+    return remaining < upd->header.block_size ? remaining : upd->header.block_size;
+}
+
+static uint32_t erase_unit_at(const ModelUpdater* upd) {
+    uint32_t unit = upd->slots[upd->target_slot].capacity - upd->erased_until;
+    if (upd->flash.erase_unit && upd->flash.erase_unit < unit) unit = upd->flash.erase_unit;
+    return unit;
+}
+
+/**
+ * Erase the target slot up to end, lazily so no single call blocks for
+ * the whole slot
+ * With erase_poll() an erase only starts here: MODEL_UPD_ERR_BUSY until it
+ * completes (polled again on the next call).
+ */
+static int32_t erase_to(ModelUpdater* upd, uint32_t end) {
+    while (upd->flash.erase && upd->erased_until < end) {
+        if (upd->erase_pending) {
+            int32_t busy = upd->flash.erase_poll(upd->flash.user);
+            if (busy > 0) return MODEL_UPD_ERR_BUSY;
+            upd->erase_pending = 0;
+            if (busy < 0) return MODEL_UPD_ERR_FLASH;
+            upd->erased_until += erase_unit_at(upd);
+            continue;
+        }
+
+        uint8_t* addr = upd->slots[upd->target_slot].base + upd->erased_until;
+        if (upd->flash.erase(upd->flash.user, addr, erase_unit_at(upd)) != 0) {
+            return MODEL_UPD_ERR_FLASH;
+        }
+        if (upd->flash.erase_poll) {
+            upd->erase_pending = 1;
+        } else {
+            upd->erased_until += erase_unit_at(upd);
+        }
+    }
+    return MODEL_UPD_OK;
+}
+
+/**
+ * Program the staged block into the target slot
+ * MODEL_UPD_ERR_BUSY leaves it staged for the next attempt.
+ */
+static int32_t flush_block(ModelUpdater* upd) {
+    uint8_t* slot = upd->slots[upd->target_slot].base;
+    uint32_t end = upd->write_offset + upd->block_fill;
+
+    int32_t status = erase_to(upd, end);
+    if (status != MODEL_UPD_OK) return status;
+
+    if (upd->flash.write(upd->flash.user, slot + upd->write_offset, upd->block, upd->block_fill) != 0) {
+        return MODEL_UPD_ERR_FLASH;
+    }
+
+    upd->target_crc = crc32_update(upd->target_crc, upd->block, upd->block_fill);
+    upd->write_offset = end;
+    upd->block_fill = 0;
+    return MODEL_UPD_OK;
+}
+
+/**
+ * Write the staged block and the rest of a COPY op
+ * Stops at MODEL_UPD_ERR_BUSY with the block still staged; called again
+ * before any further ops-stream byte is taken.
+ */
+static int32_t drain(ModelUpdater* upd) {
+    while (1) {
+        if (upd->block_ready) {
+            int32_t status = flush_block(upd);
+            if (status != MODEL_UPD_OK) return status;
+            upd->block_ready = 0;
+            if (upd->copy_left) {
+                upd->copy_src++;
+                upd->copy_left--;
+                upd->blocks_copied++;
+            } else {
+                upd->blocks_literal++;
+            }
+        }
+        if (!upd->copy_left) return MODEL_UPD_OK;
+
+        // Next block of the COPY op
+        if (upd->write_offset >= upd->header.target_length) return MODEL_UPD_ERR_PATCH;
+        uint32_t src = upd->copy_src * upd->header.block_size;
+        uint32_t len = target_block_length(upd);
+        if (src >= upd->active_length || len > upd->active_length - src) return MODEL_UPD_ERR_PATCH;
+
+        memcpy(upd->block, upd->active_data + src, len);
+        upd->block_fill = len;
+        upd->block_ready = 1;
+    }
+}
+
+/**
+ * Consume ops-stream bytes; ops may span chunk boundaries
+ * *used: bytes taken, fewer than len when a flash erase is still running
+ * (MODEL_UPD_ERR_BUSY)
+ */
+static int32_t feed_ops(ModelUpdater* upd, const uint8_t* data, uint32_t len, uint32_t* used) {
+    int32_t status = drain(upd);
+
+    *used = 0;
+    while (status == MODEL_UPD_OK && *used < len) {
+        // Literal payload of a DATA op
+        if (upd->op_bytes_left) {
+            uint32_t room = target_block_length(upd) - upd->block_fill;
+            uint32_t n = len - *used < upd->op_bytes_left ? len - *used : upd->op_bytes_left;
+            if (n > room) n = room;
+
+            memcpy(upd->block + upd->block_fill, data + *used, n);
+            upd->block_fill += n;
+            upd->op_bytes_left -= n;
+            *used += n;
+
+            if (upd->block_fill == target_block_length(upd)) {
+                upd->block_ready = 1;
+                status = drain(upd);
+            }
+            continue;
+        }
+
+        // Op header
+        upd->op_header[upd->op_header_fill++] = data[(*used)++];
+
+        uint8_t op = upd->op_header[0];
+        uint32_t needed = (op == MODEL_PATCH_OP_COPY) ? 7 : 3;
+        if (op != MODEL_PATCH_OP_COPY && op != MODEL_PATCH_OP_DATA) return MODEL_UPD_ERR_PATCH;
+        if (upd->op_header_fill < needed) continue;
+        upd->op_header_fill = 0;
+
+        uint32_t count = link_get_u16(upd->op_header + 1);
+        if (count == 0) return MODEL_UPD_ERR_PATCH;
+
+        if (op == MODEL_PATCH_OP_COPY) {
+            upd->copy_src = link_get_u32(upd->op_header + 3);
+            upd->copy_left = count;
+            status = drain(upd);
+        } else {
+            uint32_t remaining = upd->header.target_length - upd->write_offset;
+            uint32_t bytes = count * upd->header.block_size;
+            if (remaining == 0 || bytes - upd->header.block_size >= remaining) {
+                return MODEL_UPD_ERR_PATCH;  // Op reaches past the target
+            }
+            upd->op_bytes_left = bytes < remaining ? bytes : remaining;
+        }
+    }
+    return status;
+}
+
+/* ==================== PROTOCOL ==================== */
+
+static int32_t handle_begin(ModelUpdater* upd, const LinkFrame* f) {
+    ModelPatchHeader h;
+    const uint8_t* p = f->payload;
+
+    if (f->length < MODEL_PATCH_HEADER_SIZE) return MODEL_UPD_ERR_HEADER;
+    h.magic = link_get_u32(p);
+    h.version = link_get_u16(p + 4);
+    h.block_size = link_get_u16(p + 6);
+    h.base_length = link_get_u32(p + 8);
+    h.base_crc = link_get_u32(p + 12);
+    h.target_length = link_get_u32(p + 16);
+    h.target_crc = link_get_u32(p + 20);
+    h.ops_length = link_get_u32(p + 24);
+
+    // Same patch again: resume instead of restarting
+    if (upd->state == MODEL_UPD_RECEIVING && memcmp(&h, &upd->header, sizeof(h)) == 0) {
+        return MODEL_UPD_OK;
+    }
+    // An erase of an abandoned transfer still owns the flash
+    if (upd->erase_pending) {
+        if (upd->flash.erase_poll(upd->flash.user) > 0) return MODEL_UPD_ERR_BUSY;
+        upd->erase_pending = 0;
+    }
+
+    if (h.magic != MODEL_PATCH_MAGIC || h.version != MODEL_PATCH_VERSION ||
+        h.block_size < MODEL_UPDATE_BLOCK_ALIGN || h.block_size > MODEL_UPDATE_MAX_BLOCK ||
+        h.block_size % MODEL_UPDATE_BLOCK_ALIGN != 0) {
+        return MODEL_UPD_ERR_HEADER;
+    }
+    if (h.base_length != upd->active_length || h.base_crc != upd->active_crc) {
+        return MODEL_UPD_ERR_BASE;
+    }
+
+    int32_t target = (upd->active_slot == 0) ? 1 : 0;
+    if (h.target_length == 0 || h.target_length > upd->slots[target].capacity) {
+        return MODEL_UPD_ERR_SIZE;
+    }
+
+    upd->header = h;
+    upd->target_slot = target;
+    upd->rx_offset = 0;
+    upd->op_header_fill = 0;
+    upd->op_bytes_left = 0;
+    upd->write_offset = 0;
+    upd->erased_until = 0;
+    upd->target_crc = 0;
+    upd->block_fill = 0;
+    upd->block_ready = 0;
+    upd->copy_left = 0;
+    upd->state = MODEL_UPD_RECEIVING;
+    return MODEL_UPD_OK;
+}
+
+static int32_t handle_chunk(ModelUpdater* upd, const LinkFrame* f) {
+    if (upd->state != MODEL_UPD_RECEIVING) return MODEL_UPD_ERR_STATE;
+    if (f->length < 4) return MODEL_UPD_ERR_PATCH;
+
+    uint32_t offset = link_get_u32(f->payload);
+    uint32_t n = f->length - 4u;
+    const uint8_t* data = f->payload + 4;
+
+    if (offset > upd->rx_offset) return MODEL_UPD_ERR_OFFSET;
+    if (offset + n <= upd->rx_offset) {
+        upd->chunks_duplicate++;  // Retransmission of an applied chunk
+        return MODEL_UPD_OK;
+    }
+    if (offset + n > upd->header.ops_length) return MODEL_UPD_ERR_PATCH;
+
+    // Partially overlapping retransmission: apply only the new tail
+    uint32_t skip = upd->rx_offset - offset;
+    uint32_t used;
+    int32_t status = feed_ops(upd, data + skip, n - skip, &used);
+    upd->rx_offset += used;
+    if (status == MODEL_UPD_ERR_BUSY) return status;  // Sender resends from rx_offset
+    if (status != MODEL_UPD_OK) {
+        upd->state = MODEL_UPD_FAILED;
+        return status;
+    }
+
+    upd->chunks_applied++;
+    return MODEL_UPD_OK;
+}
+
+static int32_t handle_commit(ModelUpdater* upd) {
+    if (upd->state == MODEL_UPD_VERIFIED) return MODEL_UPD_OK;
+    if (upd->state != MODEL_UPD_RECEIVING) return MODEL_UPD_ERR_STATE;
+
+    if (upd->rx_offset != upd->header.ops_length) return MODEL_UPD_ERR_OFFSET;
+
+    // Blocks waiting for an erase are written first
+    int32_t status = drain(upd);
+    if (status == MODEL_UPD_ERR_BUSY) return status;
+    if (status != MODEL_UPD_OK) {
+        upd->state = MODEL_UPD_FAILED;
+        return status;
+    }
+    if (upd->op_header_fill || upd->op_bytes_left ||
+        upd->write_offset != upd->header.target_length) {
+        upd->state = MODEL_UPD_FAILED;
+        return MODEL_UPD_ERR_PATCH;
+    }
+    if (upd->target_crc != upd->header.target_crc) {
+        upd->state = MODEL_UPD_FAILED;
+        return MODEL_UPD_ERR_VERIFY;
+    }
+    // Intact is not enough: the running model stays unless this one can run
+    if (upd->check && upd->check(upd->slots[upd->target_slot].base, upd->header.target_length) != 0) {
+        upd->state = MODEL_UPD_FAILED;
+        return MODEL_UPD_ERR_IMAGE;
+    }
+
+    upd->state = MODEL_UPD_VERIFIED;
+    return MODEL_UPD_OK;
+}
+
+static uint32_t reply(ModelUpdater* upd, uint8_t seq, int32_t status, uint8_t* tx) {
+    uint8_t payload[REPLY_LENGTH];
+    payload[0] = (uint8_t)status;
+    payload[1] = (uint8_t)upd->state;
+    link_put_u32(payload + 2, upd->rx_offset);
+    return link_encode(LINK_MSG_UPD_STATUS, seq, payload, REPLY_LENGTH, tx);
+}
+
+uint32_t model_update_process(ModelUpdater* upd, const uint8_t* rx, uint32_t rx_len,
+                              uint8_t* tx, uint32_t tx_capacity) {
+    uint32_t tx_len = 0;
+
+    for (uint32_t i = 0; i < rx_len; i++) {
+        if (!link_decoder_push(&upd->rx, rx[i])) continue;
+
+        const LinkFrame* f = &upd->rx.frame;
+        int32_t status;
+
+        switch (f->type) {
+            case LINK_MSG_UPD_BEGIN:  status = handle_begin(upd, f); break;
+            case LINK_MSG_UPD_CHUNK:  status = handle_chunk(upd, f); break;
+            case LINK_MSG_UPD_COMMIT: status = handle_commit(upd); break;
+            case LINK_MSG_UPD_QUERY:  status = MODEL_UPD_OK; break;
+            case LINK_MSG_UPD_ABORT:
+                upd->state = MODEL_UPD_IDLE;
+                upd->rx_offset = 0;
+                status = MODEL_UPD_OK;
+                break;
+            default:
+                // Not an update message: the other handler replies itself
+                if (upd->other) {
+                    tx_len += upd->other(upd->other_user, f, tx + tx_len, tx_capacity - tx_len);
+                }
+                continue;
+        }
+
+        if (tx_len + REPLY_LENGTH + LINK_FRAME_OVERHEAD <= tx_capacity) {
+            tx_len += reply(upd, f->seq, status, tx + tx_len);
+        }
+    }
+    return tx_len;
+}
+
+void model_update_set_handler(ModelUpdater* upd, LinkMessageHandler handler, void* user) {
+    upd->other = handler;
+    upd->other_user = user;
+}
+
+void model_update_set_check(ModelUpdater* upd, ModelImageCheck check) {
+    upd->check = check;
+}
+
+void model_update_poll(ModelUpdater* upd) {
+    if (upd->state != MODEL_UPD_RECEIVING || !upd->erase_pending) return;
+
+    int32_t status = drain(upd);
+    if (status != MODEL_UPD_OK && status != MODEL_UPD_ERR_BUSY) {
+        upd->state = MODEL_UPD_FAILED;
+    }
+}
+
+int32_t model_update_take_swap(ModelUpdater* upd, const uint8_t** data, uint32_t* length) {
+    if (upd->state != MODEL_UPD_VERIFIED) return 0;
+
+    upd->active_slot = upd->target_slot;
+    upd->active_data = upd->slots[upd->target_slot].base;
+    upd->active_length = upd->header.target_length;
+    upd->active_crc = upd->header.target_crc;
+    upd->state = MODEL_UPD_IDLE;
+    upd->rx_offset = 0;
+    upd->swaps++;
+
+    if (upd->flash.activate) {
+        upd->flash.activate(upd->flash.user, (uint32_t)upd->active_slot, upd->active_length);
+    }
+
+    *data = upd->active_data;
+    *length = upd->active_length;
+    return 1;
+}
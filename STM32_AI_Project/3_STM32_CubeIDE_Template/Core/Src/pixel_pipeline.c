@@ -0,0 +1,605 @@
+/*
+ * Pixel Pipeline
+ * Job queue, software backend, CPU resample (all builds); DMA2D backend (target)
+ */
+
+#include "pixel_pipeline.h"
+#include <string.h>
+
+#define RESAMPLE_BITS        11      // cv2 INTER_RESIZE_COEF_BITS
+#define RESAMPLE_ONE         (1u << RESAMPLE_BITS)
+
+static uint32_t bytes_per_pixel(uint8_t format) {
+    switch (format) {
+    case PIXEL_ARGB8888: return 4;
+    case PIXEL_RGB888:   return 3;
+    case PIXEL_RGB565:   return 2;
+    case PIXEL_YUYV:     return 2;
+    case PIXEL_A8:       return 1;
+    case PIXEL_L8:       return 1;
+    default:             return 0;
+    }
+}
+
+static inline int32_t engine_format(uint8_t format) {
+    return format == PIXEL_ARGB8888 || format == PIXEL_RGB888 || format == PIXEL_RGB565;
+}
+
+void pixel_init(PixelPipeline* pp, const PixelOps* ops) {
+    memset(pp, 0, sizeof(*pp));
+    if (ops) {
+        pp->ops = *ops;
+    }
+    pp->hardware = pp->ops.start != NULL;
+}
+
+PixelSurface pixel_surface(void* image, uint16_t width, uint8_t format, uint16_t x, uint16_t y) {
+    PixelSurface s;
+    s.data = (uint8_t*)image + ((uint32_t)y * width + x) * bytes_per_pixel(format);
+    s.stride = width;
+    s.format = format;
+    return s;
+}
+
+/* ==================== JOBS ==================== */
+
+/**
+ * A surface the engine can address: stride covers the area, and the
+ * address is aligned to the pixel (RGB888: bytes)
+ */
+static int32_t check_surface(const PixelSurface* s, uint16_t width, int32_t foreground) {
+    if (!s->data || s->stride < width) return 0;
+    if (!engine_format(s->format) && !(foreground && s->format == PIXEL_A8)) return 0;
+
+    uint32_t align = (s->format == PIXEL_RGB888) ? 1u : bytes_per_pixel(s->format);
+    return ((uintptr_t)s->data % align) == 0;
+}
+
+int32_t pixel_check(const PixelJob* job) {
+    if (job->width == 0 || job->width > PIXEL_MAX_WIDTH || job->height == 0) return PIXEL_ERR_JOB;
+    if (!check_surface(&job->dst, job->width, 0)) return PIXEL_ERR_JOB;
+
+    switch (job->mode) {
+    case PIXEL_MODE_COPY:
+        // M2M moves pixels of the output format
+        if (job->fg.format != job->dst.format) return PIXEL_ERR_JOB;
+        return check_surface(&job->fg, job->width, 0) ? PIXEL_OK : PIXEL_ERR_JOB;
+    case PIXEL_MODE_CONVERT:
+        return check_surface(&job->fg, job->width, 1) ? PIXEL_OK : PIXEL_ERR_JOB;
+    case PIXEL_MODE_BLEND:
+        return (check_surface(&job->fg, job->width, 1) && check_surface(&job->bg, job->width, 0))
+            ? PIXEL_OK : PIXEL_ERR_JOB;
+    case PIXEL_MODE_TINT:
+        return check_surface(&job->bg, job->width, 0) ? PIXEL_OK : PIXEL_ERR_JOB;
+    case PIXEL_MODE_FILL:
+        return PIXEL_OK;
+    default:
+        return PIXEL_ERR_JOB;
+    }
+}
+
+/* ==================== SOFTWARE BACKEND ==================== */
+// Pixels pass through 0xAARRGGBB, as in the DMA2D's pixel format converters
+
+static inline uint32_t expand5(uint32_t v) { return (v << 3) | (v >> 2); }
+static inline uint32_t expand6(uint32_t v) { return (v << 2) | (v >> 4); }
+
+static inline uint32_t read_pixel(const uint8_t* p, uint8_t format, uint32_t color) {
+    switch (format) {
+    case PIXEL_ARGB8888:
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    case PIXEL_RGB888:
+        return 0xFF000000u | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+    case PIXEL_RGB565: {
+        uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+        return 0xFF000000u | (expand5(v >> 11) << 16) | (expand6((v >> 5) & 0x3Fu) << 8) | expand5(v & 0x1Fu);
+    }
+    default:  // PIXEL_A8
+        return ((uint32_t)p[0] << 24) | (color & 0x00FFFFFFu);
+    }
+}
+
+static inline void write_pixel(uint8_t* p, uint8_t format, uint32_t argb) {
+    switch (format) {
+    case PIXEL_ARGB8888:
+        p[0] = (uint8_t)argb;
+        p[1] = (uint8_t)(argb >> 8);
+        p[2] = (uint8_t)(argb >> 16);
+        p[3] = (uint8_t)(argb >> 24);
+        break;
+    case PIXEL_RGB888:
+        p[0] = (uint8_t)argb;
+        p[1] = (uint8_t)(argb >> 8);
+        p[2] = (uint8_t)(argb >> 16);
+        break;
+    default: {  // PIXEL_RGB565
+        uint32_t v = ((argb >> 8) & 0xF800u) | ((argb >> 5) & 0x07E0u) | ((argb >> 3) & 0x001Fu);
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+        break;
+    }
+    }
+}
+
+/**
+ * Foreground alpha times the job's alpha (DMA2D alpha mode "multiply")
+ */
+static inline uint32_t modulate(uint32_t argb, uint32_t alpha) {
+    if (alpha == 255u) return argb;
+    return ((((argb >> 24) * alpha) / 255u) << 24) | (argb & 0x00FFFFFFu);
+}
+
+static inline uint32_t blend(uint32_t fg, uint32_t bg) {
+    const uint32_t a_fg = fg >> 24;
+    const uint32_t a_bg = bg >> 24;
+    const uint32_t a_mult = a_fg * a_bg / 255u;
+    const uint32_t a_out = a_fg + a_bg - a_mult;
+    if (a_out == 0) return 0;
+
+    uint32_t out = a_out << 24;
+    for (uint32_t shift = 0; shift < 24; shift += 8) {
+        uint32_t c_fg = (fg >> shift) & 0xFFu;
+        uint32_t c_bg = (bg >> shift) & 0xFFu;
+        out |= ((c_fg * a_fg + c_bg * a_bg - c_bg * a_mult) / a_out) << shift;
+    }
+    return out;
+}
+
+int32_t pixel_run_software(const PixelJob* job) {
+    if (pixel_check(job) != PIXEL_OK) return PIXEL_ERR_JOB;
+
+    const uint32_t dst_bpp = bytes_per_pixel(job->dst.format);
+    const uint32_t fg_bpp = bytes_per_pixel(job->fg.format);
+    const uint32_t bg_bpp = bytes_per_pixel(job->bg.format);
+    const uint32_t tint = ((uint32_t)job->alpha << 24) | (job->color & 0x00FFFFFFu);
+
+    for (uint32_t y = 0; y < job->height; y++) {
+        uint8_t* d = (uint8_t*)job->dst.data + y * job->dst.stride * dst_bpp;
+        const uint8_t* f = job->fg.data ? (const uint8_t*)job->fg.data + y * job->fg.stride * fg_bpp : NULL;
+        const uint8_t* b = job->bg.data ? (const uint8_t*)job->bg.data + y * job->bg.stride * bg_bpp : NULL;
+
+        switch (job->mode) {
+        case PIXEL_MODE_COPY:
+            memmove(d, f, job->width * dst_bpp);
+            break;
+        case PIXEL_MODE_CONVERT:
+            for (uint32_t x = 0; x < job->width; x++, d += dst_bpp, f += fg_bpp) {
+                write_pixel(d, job->dst.format, modulate(read_pixel(f, job->fg.format, job->color), job->alpha));
+            }
+            break;
+        case PIXEL_MODE_BLEND:
+            for (uint32_t x = 0; x < job->width; x++, d += dst_bpp, f += fg_bpp, b += bg_bpp) {
+                uint32_t fg = modulate(read_pixel(f, job->fg.format, job->color), job->alpha);
+                write_pixel(d, job->dst.format, blend(fg, read_pixel(b, job->bg.format, 0)));
+            }
+            break;
+        case PIXEL_MODE_TINT:
+            for (uint32_t x = 0; x < job->width; x++, d += dst_bpp, b += bg_bpp) {
+                write_pixel(d, job->dst.format, blend(tint, read_pixel(b, job->bg.format, 0)));
+            }
+            break;
+        default:  // PIXEL_MODE_FILL
+            for (uint32_t x = 0; x < job->width; x++, d += dst_bpp) {
+                write_pixel(d, job->dst.format, job->color);
+            }
+            break;
+        }
+    }
+    return PIXEL_OK;
+}
+
+/* ==================== QUEUE ==================== */
+// Tickets are submission numbers; the job of ticket t sits in slot
+// (t - 1) % PIXEL_QUEUE_DEPTH until it completes. Only pixel_submit()
+// writes submitted and only the job running on the engine moves
+// completed; busy keeps the main loop and the completion interrupt from
+// starting the same job (the interrupt cannot fire while busy is clear).
+
+/**
+ * Bytes from an area's first pixel to the end of its last, widened to
+ * whole cache lines (the images are line-aligned AI_DMA_BUFFERs)
+ */
+static void area_lines(const PixelSurface* s, const PixelJob* job, const uint8_t** start, uint32_t* bytes) {
+    const uint32_t bpp = bytes_per_pixel(s->format);
+    const uintptr_t first = (uintptr_t)s->data;
+    const uintptr_t end = first + ((uint32_t)(job->height - 1) * s->stride + job->width) * bpp;
+    const uintptr_t line = first & ~(uintptr_t)(AI_CACHE_LINE - 1);
+
+    *start = (const uint8_t*)line;
+    *bytes = AI_CACHE_ROUND((uint32_t)(end - line));
+}
+
+/**
+ * D-cache handoff before the engine reads the sources and writes dst
+ */
+static void hand_to_engine(const PixelJob* job) {
+    const uint8_t* start;
+    uint32_t bytes;
+
+    if (job->mode == PIXEL_MODE_COPY || job->mode == PIXEL_MODE_CONVERT || job->mode == PIXEL_MODE_BLEND) {
+        area_lines(&job->fg, job, &start, &bytes);
+        ai_cache_clean(start, bytes);
+    }
+    if ((job->mode == PIXEL_MODE_BLEND || job->mode == PIXEL_MODE_TINT) && job->bg.data != job->dst.data) {
+        area_lines(&job->bg, job, &start, &bytes);
+        ai_cache_clean(start, bytes);
+    }
+    area_lines(&job->dst, job, &start, &bytes);
+    ai_cache_receive(start, bytes);
+}
+
+static void count_job(PixelPipeline* pp, const PixelJob* job) {
+    pp->jobs++;
+    pp->pixels += (uint32_t)job->width * job->height;
+}
+
+/**
+ * Start queued jobs until one is on the engine or the queue is empty
+ * A job the engine refuses runs here in software.
+ */
+static void kick(PixelPipeline* pp) {
+    if (__atomic_exchange_n(&pp->busy, 1u, __ATOMIC_ACQUIRE)) return;
+
+    while (pp->completed != __atomic_load_n(&pp->submitted, __ATOMIC_ACQUIRE)) {
+        const PixelJob* job = &pp->queue[pp->completed % PIXEL_QUEUE_DEPTH];
+        hand_to_engine(job);
+        if (pp->ops.start(pp->ops.user, job) == 0) return;
+
+        pp->fallbacks++;
+        pixel_run_software(job);
+        __atomic_store_n(&pp->completed, pp->completed + 1u, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&pp->busy, 0u, __ATOMIC_RELEASE);
+}
+
+int32_t pixel_submit(PixelPipeline* pp, const PixelJob* job, uint32_t* ticket) {
+    if (pixel_check(job) != PIXEL_OK) return PIXEL_ERR_JOB;
+
+    if (!pp->hardware) {
+        pixel_run_software(job);
+        count_job(pp, job);
+        pp->completed = ++pp->submitted;
+        *ticket = pp->submitted;
+        return PIXEL_OK;
+    }
+
+    const uint32_t next = pp->submitted;
+    if (next - __atomic_load_n(&pp->completed, __ATOMIC_ACQUIRE) >= PIXEL_QUEUE_DEPTH) return PIXEL_ERR_FULL;
+
+    pp->queue[next % PIXEL_QUEUE_DEPTH] = *job;
+    count_job(pp, job);
+    __atomic_store_n(&pp->submitted, next + 1u, __ATOMIC_RELEASE);
+    *ticket = next + 1u;
+    kick(pp);
+    return PIXEL_OK;
+}
+
+int32_t pixel_done(const PixelPipeline* pp, uint32_t ticket) {
+    return (int32_t)(__atomic_load_n(&pp->completed, __ATOMIC_ACQUIRE) - ticket) >= 0;
+}
+
+void pixel_wait(const PixelPipeline* pp, uint32_t ticket) {
+    while (!pixel_done(pp, ticket)) {
+    }
+}
+
+void pixel_complete(PixelPipeline* pp, int32_t status) {
+    const PixelJob* job = &pp->queue[pp->completed % PIXEL_QUEUE_DEPTH];
+    const uint8_t* start;
+    uint32_t bytes;
+
+    // Drop lines speculatively refilled while the engine wrote dst
+    area_lines(&job->dst, job, &start, &bytes);
+    ai_cache_invalidate(start, bytes);
+    if (status != 0) {
+        pp->fallbacks++;
+        pixel_run_software(job);
+    }
+    __atomic_store_n(&pp->completed, pp->completed + 1u, __ATOMIC_RELEASE);
+    __atomic_store_n(&pp->busy, 0u, __ATOMIC_RELEASE);
+    kick(pp);
+}
+
+/* ==================== SELF-TEST ==================== */
+
+#define SELFTEST_W           24u     // Image width; jobs cover a 13x5 area at (3, 2)
+#define SELFTEST_H           8u
+#define SELFTEST_BYTES       AI_CACHE_ROUND(SELFTEST_W * SELFTEST_H * 4u)
+
+typedef struct {
+    uint8_t mode;
+    uint8_t fg_format;
+    uint8_t bg_format;
+    uint8_t dst_format;
+    uint8_t alpha;
+} SelftestCase;
+
+static const SelftestCase selftest_cases[] = {
+    { PIXEL_MODE_COPY,    PIXEL_ARGB8888, 0,              PIXEL_ARGB8888, 255 },
+    { PIXEL_MODE_COPY,    PIXEL_RGB888,   0,              PIXEL_RGB888,   255 },
+    { PIXEL_MODE_COPY,    PIXEL_RGB565,   0,              PIXEL_RGB565,   255 },
+    { PIXEL_MODE_CONVERT, PIXEL_RGB565,   0,              PIXEL_ARGB8888, 255 },
+    { PIXEL_MODE_CONVERT, PIXEL_RGB565,   0,              PIXEL_RGB888,   255 },
+    { PIXEL_MODE_CONVERT, PIXEL_RGB888,   0,              PIXEL_RGB565,   255 },
+    { PIXEL_MODE_CONVERT, PIXEL_RGB888,   0,              PIXEL_ARGB8888, 255 },
+    { PIXEL_MODE_CONVERT, PIXEL_ARGB8888, 0,              PIXEL_RGB565,   255 },
+    { PIXEL_MODE_CONVERT, PIXEL_ARGB8888, 0,              PIXEL_RGB888,   255 },
+    { PIXEL_MODE_CONVERT, PIXEL_ARGB8888, 0,              PIXEL_ARGB8888, 77 },
+    { PIXEL_MODE_CONVERT, PIXEL_A8,       0,              PIXEL_ARGB8888, 255 },
+    { PIXEL_MODE_BLEND,   PIXEL_ARGB8888, PIXEL_RGB565,   PIXEL_RGB565,   255 },
+    { PIXEL_MODE_BLEND,   PIXEL_ARGB8888, PIXEL_ARGB8888, PIXEL_ARGB8888, 200 },
+    { PIXEL_MODE_BLEND,   PIXEL_A8,       PIXEL_RGB888,   PIXEL_RGB888,   255 },
+    { PIXEL_MODE_BLEND,   PIXEL_A8,       PIXEL_RGB565,   PIXEL_RGB565,   131 },
+    { PIXEL_MODE_TINT,    0,              PIXEL_RGB565,   PIXEL_RGB565,   96 },
+    { PIXEL_MODE_TINT,    0,              PIXEL_ARGB8888, PIXEL_RGB888,   180 },
+    { PIXEL_MODE_FILL,    0,              0,              PIXEL_RGB565,   255 },
+    { PIXEL_MODE_FILL,    0,              0,              PIXEL_RGB888,   255 },
+};
+
+static void selftest_pattern(uint8_t* image, uint32_t seed) {
+    uint32_t x = seed;
+    for (uint32_t i = 0; i < SELFTEST_BYTES; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        image[i] = (uint8_t)(x >> 8);
+    }
+}
+
+uint32_t pixel_selftest(PixelPipeline* pp) {
+    static uint8_t fg[SELFTEST_BYTES] AI_DMA_BUFFER;
+    static uint8_t bg[SELFTEST_BYTES] AI_DMA_BUFFER;
+    static uint8_t out[SELFTEST_BYTES] AI_DMA_BUFFER;
+    static uint8_t expect[SELFTEST_BYTES] AI_DMA_BUFFER;
+    uint32_t mismatches = 0;
+
+    if (!pp->hardware) return 0;
+
+    for (uint32_t i = 0; i < sizeof(selftest_cases) / sizeof(selftest_cases[0]); i++) {
+        const SelftestCase* c = &selftest_cases[i];
+        PixelJob job;
+        uint32_t ticket;
+
+        selftest_pattern(fg, 0x9E3779B9u + i);
+        selftest_pattern(bg, 0x85EBCA6Bu + i);
+        selftest_pattern(out, 0xC2B2AE35u + i);
+        memcpy(expect, out, sizeof(expect));
+
+        job.mode = c->mode;
+        job.alpha = c->alpha;
+        job.width = 13;
+        job.height = 5;
+        job.fg = pixel_surface(fg, SELFTEST_W, c->fg_format, 3, 2);
+        job.bg = pixel_surface(bg, SELFTEST_W, c->bg_format, 3, 2);
+        job.dst = pixel_surface(out, SELFTEST_W, c->dst_format, 3, 2);
+        job.color = 0x80FF6020u;
+
+        int32_t status = pixel_submit(pp, &job, &ticket);
+        if (status == PIXEL_OK) {
+            pixel_wait(pp, ticket);
+        }
+        job.dst.data = expect + ((uint8_t*)job.dst.data - out);
+        pixel_run_software(&job);
+
+        if (status != PIXEL_OK || memcmp(out, expect, sizeof(out)) != 0) mismatches++;
+    }
+    return mismatches;
+}
+
+/* ==================== RESAMPLE ==================== */
+
+/**
+ * One source pixel in the model's channels: BT.601 luma with cv2's
+ * 14-bit weights, or R, G, B; YUYV as cv2 COLOR_YUV2GRAY / RGB_YUYV
+ */
+static inline void fetch(const uint8_t* row, uint32_t x, uint8_t format, uint32_t channels, uint32_t* px) {
+    uint32_t r, g, b;
+
+    if (format == PIXEL_L8) {
+        px[0] = px[1] = px[2] = row[x];
+        return;
+    }
+    if (format == PIXEL_YUYV) {
+        const uint8_t* pair = row + (x & ~1u) * 2u;
+        int32_t luma = row[x * 2u];
+        if (channels == 1) {
+            px[0] = (uint32_t)luma;
+            return;
+        }
+        int32_t yy = (luma > 16 ? luma - 16 : 0) * 1220542;
+        int32_t u = pair[1] - 128;
+        int32_t v = pair[3] - 128;
+        int32_t c[3] = {
+            (yy + 1673527 * v + (1 << 19)) >> 20,
+            (yy - 852492 * v - 409993 * u + (1 << 19)) >> 20,
+            (yy + 2116026 * u + (1 << 19)) >> 20,
+        };
+        for (uint32_t i = 0; i < 3; i++) {
+            px[i] = (uint32_t)(c[i] < 0 ? 0 : (c[i] > 255 ? 255 : c[i]));
+        }
+        return;
+    }
+
+    uint32_t argb = read_pixel(row + x * bytes_per_pixel(format), format, 0);
+    r = (argb >> 16) & 0xFFu;
+    g = (argb >> 8) & 0xFFu;
+    b = argb & 0xFFu;
+    if (channels == 1) {
+        px[0] = (r * 4899u + g * 9617u + b * 1868u + (1u << 13)) >> 14;
+    } else {
+        px[0] = r;
+        px[1] = g;
+        px[2] = b;
+    }
+}
+
+/*
+ * Source coordinate of output pixel centers along one axis,
+ * (i + 0.5) * in / out - 0.5 in RESAMPLE_BITS fixed point, stepped
+ * exactly (quotient + remainder) instead of divided per pixel
+ */
+typedef struct {
+    uint32_t in;
+    uint32_t out;
+    uint32_t q, r;                   // (2i + 1) * in * 2^(BITS-1) / out
+    uint32_t step_q, step_r;
+} ResampleAxis;
+
+static void axis_start(ResampleAxis* a, uint32_t in, uint32_t out) {
+    const uint32_t half = in << (RESAMPLE_BITS - 1);
+    a->in = in;
+    a->out = out;
+    a->q = half / out;
+    a->r = half % out;
+    a->step_q = (2u * half) / out;
+    a->step_r = (2u * half) % out;
+}
+
+/**
+ * Taps of the current position (cv2 clamping at both edges), then step
+ */
+static void axis_next(ResampleAxis* a, uint32_t* i0, uint32_t* i1, uint32_t* frac) {
+    int32_t s = (int32_t)a->q - (int32_t)(RESAMPLE_ONE / 2u);
+    if (s < 0) s = 0;
+    *i0 = (uint32_t)s >> RESAMPLE_BITS;
+    *frac = (uint32_t)s & (RESAMPLE_ONE - 1u);
+    if (*i0 >= a->in - 1u) {
+        *i0 = a->in - 1u;
+        *frac = 0;
+    }
+    *i1 = (*i0 + 1u < a->in) ? *i0 + 1u : *i0;
+
+    a->q += a->step_q;
+    a->r += a->step_r;
+    if (a->r >= a->out) {
+        a->q++;
+        a->r -= a->out;
+    }
+}
+
+int32_t pixel_resample(const PixelSurface* src, uint16_t width, uint16_t height,
+                       uint8_t* out, uint16_t out_w, uint16_t out_h, uint32_t channels) {
+    const uint32_t bpp = bytes_per_pixel(src->format);
+    if (bpp == 0 || src->format == PIXEL_A8 || !src->data || src->stride < width) return PIXEL_ERR_JOB;
+    if (width == 0 || height == 0 || width > PIXEL_MAX_WIDTH || height > PIXEL_MAX_WIDTH) return PIXEL_ERR_JOB;
+    if (out_w == 0 || out_h == 0 || (channels != 1 && channels != 3)) return PIXEL_ERR_JOB;
+
+    const uint8_t* base = (const uint8_t*)src->data;
+    const uint32_t row_bytes = (uint32_t)src->stride * bpp;
+    ResampleAxis ay;
+    axis_start(&ay, height, out_h);
+
+    for (uint32_t y = 0; y < out_h; y++) {
+        uint32_t y0, y1, fy;
+        axis_next(&ay, &y0, &y1, &fy);
+        const uint8_t* row0 = base + y0 * row_bytes;
+        const uint8_t* row1 = base + y1 * row_bytes;
+
+        ResampleAxis ax;
+        axis_start(&ax, width, out_w);
+        for (uint32_t x = 0; x < out_w; x++) {
+            uint32_t x0, x1, fx;
+            uint32_t p00[3], p01[3], p10[3], p11[3];
+            axis_next(&ax, &x0, &x1, &fx);
+            fetch(row0, x0, src->format, channels, p00);
+            fetch(row0, x1, src->format, channels, p01);
+            fetch(row1, x0, src->format, channels, p10);
+            fetch(row1, x1, src->format, channels, p11);
+
+            for (uint32_t c = 0; c < channels; c++) {
+                uint32_t top = p00[c] * (RESAMPLE_ONE - fx) + p01[c] * fx;
+                uint32_t bottom = p10[c] * (RESAMPLE_ONE - fx) + p11[c] * fx;
+                *out++ = (uint8_t)((top * (RESAMPLE_ONE - fy) + bottom * fy +
+                                    (1u << (2 * RESAMPLE_BITS - 1))) >> (2 * RESAMPLE_BITS));
+            }
+        }
+    }
+    return PIXEL_OK;
+}
+
+#if defined(AI_MEMORY_TARGET)
+
+/* ==================== DMA2D ==================== */
+
+#include "main.h"
+
+#if defined(DMA2D)
+
+// DMA2D_CR MODE field
+#define DMA2D_MODE_M2M          0u
+#define DMA2D_MODE_M2M_PFC      1u
+#define DMA2D_MODE_M2M_BLEND    2u
+#define DMA2D_MODE_R2M          3u
+#define DMA2D_MODE_BLEND_FIXED  4u   // Foreground is FGCOLR at ALPHA, not read from memory
+
+// FGPFCCR AM field
+#define DMA2D_ALPHA_KEEP        0u
+#define DMA2D_ALPHA_REPLACE     1u
+#define DMA2D_ALPHA_MULTIPLY    2u
+
+/**
+ * R2M color register: the color in the output format
+ */
+static uint32_t output_color(uint32_t argb, uint8_t format) {
+    if (format == PIXEL_RGB565) {
+        return ((argb >> 8) & 0xF800u) | ((argb >> 5) & 0x07E0u) | ((argb >> 3) & 0x001Fu);
+    }
+    return (format == PIXEL_RGB888) ? (argb & 0x00FFFFFFu) : argb;
+}
+
+int32_t pixel_dma2d_start(void* user, const PixelJob* job) {
+    (void)user;
+    uint32_t mode;
+
+    switch (job->mode) {
+    case PIXEL_MODE_COPY:    mode = DMA2D_MODE_M2M; break;
+    case PIXEL_MODE_CONVERT: mode = DMA2D_MODE_M2M_PFC; break;
+    case PIXEL_MODE_BLEND:   mode = DMA2D_MODE_M2M_BLEND; break;
+    case PIXEL_MODE_TINT:    mode = DMA2D_MODE_BLEND_FIXED; break;
+    default:                 mode = DMA2D_MODE_R2M; break;
+    }
+    if (DMA2D->CR & DMA2D_CR_START) return -1;
+
+    DMA2D->CR = (mode << DMA2D_CR_MODE_Pos) | DMA2D_CR_TCIE | DMA2D_CR_TEIE | DMA2D_CR_CEIE;
+    DMA2D->NLR = ((uint32_t)job->width << DMA2D_NLR_PL_Pos) | job->height;
+    DMA2D->OMAR = (uint32_t)job->dst.data;
+    DMA2D->OOR = job->dst.stride - job->width;
+    DMA2D->OPFCCR = job->dst.format;
+
+    if (job->mode == PIXEL_MODE_FILL) {
+        DMA2D->OCOLR = output_color(job->color, job->dst.format);
+    } else if (job->mode == PIXEL_MODE_TINT) {
+        DMA2D->FGPFCCR = ((uint32_t)job->alpha << DMA2D_FGPFCCR_ALPHA_Pos) |
+                         (DMA2D_ALPHA_REPLACE << DMA2D_FGPFCCR_AM_Pos) | PIXEL_ARGB8888;
+        DMA2D->FGCOLR = job->color & 0x00FFFFFFu;
+    } else {
+        uint32_t am = (job->alpha == 255u) ? DMA2D_ALPHA_KEEP : DMA2D_ALPHA_MULTIPLY;
+        DMA2D->FGMAR = (uint32_t)job->fg.data;
+        DMA2D->FGOR = job->fg.stride - job->width;
+        DMA2D->FGPFCCR = ((uint32_t)job->alpha << DMA2D_FGPFCCR_ALPHA_Pos) |
+                         (am << DMA2D_FGPFCCR_AM_Pos) | job->fg.format;
+        DMA2D->FGCOLR = job->color & 0x00FFFFFFu;
+    }
+    if (job->mode == PIXEL_MODE_BLEND || job->mode == PIXEL_MODE_TINT) {
+        DMA2D->BGMAR = (uint32_t)job->bg.data;
+        DMA2D->BGOR = job->bg.stride - job->width;
+        DMA2D->BGPFCCR = job->bg.format;
+    }
+
+    DMA2D->CR |= DMA2D_CR_START;
+    return 0;
+}
+
+void pixel_dma2d_irq(PixelPipeline* pp) {
+    const uint32_t flags = DMA2D->ISR & (DMA2D_ISR_TCIF | DMA2D_ISR_TEIF | DMA2D_ISR_CEIF);
+    DMA2D->IFCR = flags;  // Clear bits sit at the same positions
+    if (flags & (DMA2D_ISR_TEIF | DMA2D_ISR_CEIF)) {
+        pixel_complete(pp, -1);
+    } else if (flags & DMA2D_ISR_TCIF) {
+        pixel_complete(pp, 0);
+    }
+}
+
+#endif // DMA2D
+
+#endif // AI_MEMORY_TARGET
@@ -0,0 +1,163 @@
+/*
+ * Power Manager
+ * Wake bookkeeping, IDLE / ALERT scheduling, brightness screening
+ */
+
+#include "power_manager.h"
+#include <string.h>
+
+static const PowerPolicy default_policy = {
+    .screen_period_ms = 5000,
+    .active_period_ms = 100,
+    .hold_ms = 60000,
+    .min_stop_ms = 5,
+    .bright_level = 220,
+    .bright_rise = 4,                // 16 pixels of a 32x32 frame
+    .mean_change = 24,
+};
+
+void power_init(PowerManager* pm, const PowerPolicy* policy, const PowerOps* ops) {
+    memset(pm, 0, sizeof(*pm));
+    pm->policy = policy ? *policy : default_policy;
+    pm->ops = *ops;
+    pm->mode = POWER_MODE_IDLE;
+    pm->next_frame_ms = ops->now_ms(ops->user);
+}
+
+void power_wake_event(PowerManager* pm, uint32_t source) {
+    if (source < POWER_WAKE_SOURCES) {
+        pm->wake_count[source]++;
+    }
+}
+
+static void camera_power(PowerManager* pm, uint8_t on) {
+    if (pm->camera_on != on && pm->ops.camera) {
+        pm->ops.camera(pm->ops.user, on);
+    }
+    pm->camera_on = on;
+}
+
+/* ==================== WAIT ==================== */
+
+/**
+ * Consume the events counted by interrupts since the last call
+ */
+static uint32_t take_wakes(PowerManager* pm) {
+    uint32_t wake = 0;
+    for (uint32_t s = 0; s < POWER_WAKE_SOURCES; s++) {
+        uint32_t count = pm->wake_count[s];
+        if (count != pm->wake_seen[s]) {
+            pm->wakeups[s] += count - pm->wake_seen[s];
+            pm->wake_seen[s] = count;
+            wake |= POWER_WAKE_BIT(s);
+        }
+    }
+    return wake;
+}
+
+uint32_t power_wait(PowerManager* pm) {
+    for (;;) {
+        uint32_t wake = take_wakes(pm);
+        uint32_t now = pm->ops.now_ms(pm->ops.user);
+        int32_t left = (int32_t)(pm->next_frame_ms - now);
+
+        if (left <= 0) {
+            pm->wakeups[POWER_WAKE_RTC]++;
+            return wake | POWER_WAKE_BIT(POWER_WAKE_RTC);
+        }
+        if (wake) {
+            return wake;
+        }
+
+        // Stop only while IDLE: ALERT keeps the camera streaming and the
+        // DMA-driven sensors / update link serviced between frames
+        int deep = (pm->mode == POWER_MODE_IDLE) && ((uint32_t)left >= pm->policy.min_stop_ms);
+        pm->ops.wait(pm->ops.user, (uint32_t)left, deep);
+
+        uint32_t slept = pm->ops.now_ms(pm->ops.user) - now;
+        if (deep) {
+            pm->stop_ms += slept;
+        } else {
+            pm->sleep_ms += slept;
+        }
+    }
+}
+
+/* ==================== STAGES ==================== */
+
+static void escalate(PowerManager* pm, uint32_t now) {
+    if (pm->mode == POWER_MODE_IDLE) {
+        pm->mode = POWER_MODE_ALERT;
+        pm->escalations++;
+        pm->next_frame_ms = now;     // First CNN frame right away
+    }
+    pm->last_evidence_ms = now;
+}
+
+uint8_t power_stage(PowerManager* pm, uint32_t wake) {
+    uint8_t stage = POWER_STAGE_NONE;
+
+    if (wake & POWER_WAKE_BIT(POWER_WAKE_ANALOG)) {
+        escalate(pm, pm->ops.now_ms(pm->ops.user));
+        stage = POWER_STAGE_CNN;
+    } else if (pm->mode == POWER_MODE_ALERT) {
+        // Motion during ALERT changes nothing: frames already run at full rate
+        stage = (wake & POWER_WAKE_BIT(POWER_WAKE_RTC)) ? POWER_STAGE_CNN : POWER_STAGE_NONE;
+    } else if (wake & (POWER_WAKE_BIT(POWER_WAKE_RTC) | POWER_WAKE_BIT(POWER_WAKE_PIR))) {
+        stage = POWER_STAGE_SCREEN;
+    }
+
+    if (stage != POWER_STAGE_NONE) {
+        camera_power(pm, 1);
+    }
+    return stage;
+}
+
+int32_t power_screen_frame(PowerManager* pm, const uint8_t* image, uint32_t pixels) {
+    uint32_t sum = 0, bright = 0, samples = 0;
+
+    for (uint32_t i = 0; i < pixels; i += POWER_SCREEN_STRIDE) {
+        sum += image[i];
+        bright += (image[i] >= pm->policy.bright_level);
+        samples++;
+    }
+    uint32_t mean = samples ? sum / samples : 0;
+
+    int32_t evidence = 0;
+    if (pm->bg_valid) {
+        uint32_t change = (mean > pm->bg_mean) ? mean - pm->bg_mean : pm->bg_mean - mean;
+        evidence = (bright >= pm->bg_bright + pm->policy.bright_rise) || (change >= pm->policy.mean_change);
+    }
+    pm->bg_mean = mean;
+    pm->bg_bright = bright;
+    pm->bg_valid = 1;
+    return evidence;
+}
+
+void power_report(PowerManager* pm, uint8_t stage, int32_t evidence) {
+    uint32_t now = pm->ops.now_ms(pm->ops.user);
+
+    if (stage == POWER_STAGE_SCREEN) {
+        pm->screens++;
+    } else if (stage == POWER_STAGE_CNN) {
+        pm->cnn_frames++;
+    }
+
+    if (evidence) {
+        escalate(pm, now);
+    } else if (pm->mode == POWER_MODE_ALERT && now - pm->last_evidence_ms >= pm->policy.hold_ms) {
+        pm->mode = POWER_MODE_IDLE;
+        pm->bg_valid = 0;            // The scene may have changed while alerted
+    }
+
+    if (pm->mode == POWER_MODE_ALERT) {
+        // Fixed frame rate; a frame that overran its slot starts the next one now
+        if (stage == POWER_STAGE_CNN) {
+            pm->next_frame_ms += pm->policy.active_period_ms;
+            if ((int32_t)(pm->next_frame_ms - now) < 0) pm->next_frame_ms = now;
+        }
+    } else {
+        camera_power(pm, 0);
+        pm->next_frame_ms = now + pm->policy.screen_period_ms;
+    }
+}
@@ -0,0 +1,214 @@
+/*
+ * Thermal Array Front-End
+ * Boot-time coefficient folding, fixed-point per-pixel conversion,
+ * double-buffered DMA frames, hot-spot map
+ */
+
+#include "thermal_sensor.h"
+#include "ai_memory.h"
+#include <math.h>
+#include <string.h>
+
+#define THERMAL_KELVIN         273.15f
+#define THERMAL_LUT_SIZE       (1 << THERMAL_LUT_BITS)
+#define THERMAL_RADIANCE_MAX   ((int32_t)THERMAL_LUT_SIZE << THERMAL_LUT_SHIFT)
+
+/* ==================== HELPERS ==================== */
+
+static inline int16_t frame_word(const uint8_t* raw, uint32_t index) {
+    return (int16_t)((uint16_t)(raw[2 * index] << 8) | raw[2 * index + 1]);
+}
+
+/**
+ * Ambient (C) and supply (V) of a frame
+ */
+static void thermal_decode_aux(const uint8_t* raw, float* ta, float* vdd) {
+    *ta = (float)frame_word(raw, THERMAL_AUX_TA) / 64.0f;
+    *vdd = (float)(uint16_t)frame_word(raw, THERMAL_AUX_VDD) / 1000.0f;
+}
+
+/**
+ * Radiance of a blackbody at the ambient temperature, K^4 / 2^20
+ */
+static int32_t ambient_radiance(float ta) {
+    float k = ta + THERMAL_KELVIN;
+    return (int32_t)lrintf(k * k * k * k / (float)(1u << THERMAL_RADIANCE_BITS));
+}
+
+/* ==================== CALIBRATION ==================== */
+
+/**
+ * Fourth-root table: temperature (0.1 C) at radiance i << THERMAL_LUT_SHIFT
+ */
+static void build_lut(ThermalSensor* sensor) {
+    for (uint32_t i = 0; i <= THERMAL_LUT_SIZE; i++) {
+        float r = (float)(i << THERMAL_LUT_SHIFT) * (float)(1u << THERMAL_RADIANCE_BITS);
+        sensor->lut[i] = (int16_t)lrintf((sqrtf(sqrtf(r)) - THERMAL_KELVIN) * 10.0f);
+    }
+}
+
+/**
+ * Fold gain, offset drift, emissivity and sensitivity into scale / bias
+ * for one ambient and supply (the vendor formula, once per pixel)
+ */
+static int32_t build_coefficients(ThermalSensor* sensor, float ta, float vdd) {
+    const ThermalCalibration* cal = sensor->cal;
+    const float unit = (float)(1u << THERMAL_RADIANCE_BITS);
+    const float q = (float)(1u << THERMAL_COEFF_BITS);
+
+    for (uint32_t i = 0; i < THERMAL_PIXELS; i++) {
+        float per_count = 1.0f / (cal->emissivity * cal->alpha[i] * unit);
+        float offset = cal->offset[i] * (1.0f + cal->kta[i] * (ta - cal->ta_ref))
+                                      * (1.0f + cal->kv[i] * (vdd - cal->vdd_ref));
+        float scale = cal->gain * per_count * q;
+        float bias = -offset * per_count * q;
+
+        if (!(fabsf(scale) < 2147483520.0f) || !(fabsf(bias) < 2147483520.0f)) {
+            return THERMAL_ERR_CALIBRATION;
+        }
+        sensor->scale[i] = (int32_t)lrintf(scale);
+        sensor->bias[i] = (int32_t)lrintf(bias);
+    }
+
+    sensor->coeff_ta = ta;
+    sensor->coeff_vdd = vdd;
+    return THERMAL_OK;
+}
+
+int32_t thermal_init(ThermalSensor* sensor, const ThermalCalibration* cal, const ThermalBusOps* bus) {
+    memset(sensor, 0, sizeof(*sensor));
+    sensor->cal = cal;
+    if (bus) {
+        sensor->bus = *bus;
+    }
+    sensor->hot_threshold_dc = THERMAL_HOT_DC;
+    sensor->dma_buffer = 1;
+    sensor->ready_buffer = 1;
+
+    build_lut(sensor);
+    return build_coefficients(sensor, cal->ta_ref, cal->vdd_ref);
+}
+
+/* ==================== CONVERSION ==================== */
+
+void thermal_convert_frame(ThermalSensor* sensor, const uint8_t* raw) {
+    ThermalHotspots* spots = &sensor->spots;
+    float ta, vdd;
+
+    thermal_decode_aux(raw, &ta, &vdd);
+    if (fabsf(ta - sensor->coeff_ta) > THERMAL_RECAL_TA_C ||
+        fabsf(vdd - sensor->coeff_vdd) > THERMAL_RECAL_VDD_V) {
+        // Out-of-range result keeps the previous coefficients
+        if (build_coefficients(sensor, ta, vdd) == THERMAL_OK) {
+            sensor->recalibrations++;
+        }
+    }
+
+    const int32_t r_ambient = ambient_radiance(ta);
+    const int16_t threshold = sensor->hot_threshold_dc;
+    int16_t max_dc = INT16_MIN;
+    uint32_t max_index = 0, hot = 0;
+
+    memset(spots->hot_map, 0, sizeof(spots->hot_map));
+    for (uint32_t i = 0; i < THERMAL_PIXELS; i++) {
+        int64_t acc = (int64_t)frame_word(raw, i) * sensor->scale[i] + sensor->bias[i];
+        int32_t r = (int32_t)(acc >> THERMAL_COEFF_BITS) + r_ambient;
+
+        if (r < 0) {
+            r = 0;
+        } else if (r >= THERMAL_RADIANCE_MAX) {
+            r = THERMAL_RADIANCE_MAX - 1;
+        }
+
+        uint32_t seg = (uint32_t)r >> THERMAL_LUT_SHIFT;
+        int32_t frac = r & ((1 << THERMAL_LUT_SHIFT) - 1);
+        int32_t lo = sensor->lut[seg];
+        int32_t step = sensor->lut[seg + 1] - lo;  // Table is increasing
+        int16_t t = (int16_t)(lo + ((step * frac + (1 << (THERMAL_LUT_SHIFT - 1))) >> THERMAL_LUT_SHIFT));
+
+        sensor->temps[i] = t;
+        if (t > max_dc) {
+            max_dc = t;
+            max_index = i;
+        }
+        if (t >= threshold) {
+            spots->hot_map[i >> 3] |= (uint8_t)(1u << (i & 7));
+            hot++;
+        }
+    }
+
+    spots->max_dc = max_dc;
+    spots->max_x = (uint8_t)(max_index % THERMAL_WIDTH);
+    spots->max_y = (uint8_t)(max_index / THERMAL_WIDTH);
+    spots->ambient_dc = (int16_t)lrintf(ta * 10.0f);
+    spots->hot_pixels = (uint16_t)hot;
+    spots->frame = ++sensor->frames;
+}
+
+uint32_t thermal_hot_in_region(const ThermalHotspots* spots, uint32_t x0, uint32_t y0,
+                               uint32_t x1, uint32_t y1) {
+    uint32_t count = 0;
+
+    if (x1 > THERMAL_WIDTH) x1 = THERMAL_WIDTH;
+    if (y1 > THERMAL_HEIGHT) y1 = THERMAL_HEIGHT;
+
+    for (uint32_t y = y0; y < y1; y++) {
+        for (uint32_t x = x0; x < x1; x++) {
+            uint32_t i = y * THERMAL_WIDTH + x;
+            count += (spots->hot_map[i >> 3] >> (i & 7)) & 1u;
+        }
+    }
+    return count;
+}
+
+/* ==================== DMA ==================== */
+
+int32_t thermal_start_read(ThermalSensor* sensor) {
+    if (sensor->busy) {
+        return THERMAL_ERR_BUSY;
+    }
+
+    // Never the last completed buffer: it may still be waiting for thermal_process()
+    uint8_t target = sensor->ready_buffer ^ 1u;
+    sensor->dma_buffer = target;
+    sensor->busy = 1;
+
+    // No dirty line may be evicted over the incoming frame
+    ai_cache_receive(sensor->raw[target], THERMAL_FRAME_BYTES);
+
+    if (!sensor->bus.read_dma ||
+        sensor->bus.read_dma(sensor->bus.user, THERMAL_RAM_ADDR, sensor->raw[target],
+                             THERMAL_FRAME_BYTES) != 0) {
+        sensor->busy = 0;
+        return THERMAL_ERR_BUS;
+    }
+    return THERMAL_OK;
+}
+
+void thermal_dma_complete(ThermalSensor* sensor) {
+    ai_cache_invalidate(sensor->raw[sensor->dma_buffer], THERMAL_FRAME_BYTES);
+    sensor->ready_buffer = sensor->dma_buffer;
+    sensor->completed++;
+    sensor->busy = 0;
+}
+
+int32_t thermal_process(ThermalSensor* sensor) {
+    uint32_t completed;
+    uint8_t buffer;
+
+    // The ISR writes buffer then count: re-read until both belong to the same read
+    do {
+        completed = sensor->completed;
+        buffer = sensor->ready_buffer;
+    } while (completed != sensor->completed);
+
+    if (completed == sensor->processed) {
+        return 0;
+    }
+    sensor->overruns += completed - sensor->processed - 1;
+    sensor->processed = completed;
+
+    AI_CACHE_CPU_READ(sensor->raw[buffer], THERMAL_FRAME_BYTES);
+    thermal_convert_frame(sensor, sensor->raw[buffer]);
+    return 1;
+}
@@ -0,0 +1,213 @@
+/*
+ * Engine Thread Pool
+ * Spin-then-park workers claiming tasks from a generation-tagged counter
+ *
+ * Build: add Host/ai_thread_pool.c to the engine sources, with -pthread
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "ai_thread_pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCRATCH_ALIGN 64  // Workers' scratch on separate cache lines
+
+// Claim word: job generation (32 bits) | next task (16) | task count (16)
+#define CLAIM(gen, next, tasks) (((uint64_t)(gen) << 32) | ((uint64_t)(next) << 16) | (uint64_t)(tasks))
+#define CLAIM_GEN(c)            ((uint32_t)((c) >> 32))
+#define CLAIM_NEXT(c)           ((uint32_t)((c) >> 16) & 0xFFFFu)
+#define CLAIM_TASKS(c)          ((uint32_t)(c) & 0xFFFFu)
+#define CLAIM_ONE               ((uint64_t)1 << 16)
+
+typedef struct {
+    AiThreadPool* pool;
+    uint32_t worker;
+} WorkerArg;
+
+struct AiThreadPool {
+    AiGemmPool gemm;                    // What the engine sees; gemm.user is this pool
+    pthread_t threads[AI_GEMM_MAX_WORKERS];
+    WorkerArg args[AI_GEMM_MAX_WORKERS];
+    uint32_t started;                   // Worker threads running
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+
+    _Atomic uint64_t claim;             // Publishes the job (CLAIM)
+    _Atomic uint32_t done;              // Its tasks finished
+    _Atomic uint32_t parked;            // Workers waiting on wake
+    _Atomic int32_t stop;
+    AiGemmTask task;                    // Job, valid while a claimed task runs
+    void* ctx;
+
+    uint64_t jobs;
+    uint64_t wakeups;
+    void* memory;                       // Workers' scratch
+};
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ volatile("yield");
+#endif
+}
+
+/* ==================== JOBS ==================== */
+
+/**
+ * Claim and run tasks of the current job until none is left
+ * A successful claim pins the job: the caller cannot publish the next one
+ * before this task counts as done, so task / ctx are still this job's.
+ */
+static void work(AiThreadPool* pool, uint32_t worker) {
+    uint64_t c = atomic_load_explicit(&pool->claim, memory_order_acquire);
+
+    while (CLAIM_NEXT(c) < CLAIM_TASKS(c)) {
+        if (!atomic_compare_exchange_weak_explicit(&pool->claim, &c, c + CLAIM_ONE,
+                                                   memory_order_acq_rel, memory_order_acquire)) {
+            continue;  // c reloaded: another worker claimed, or a new job
+        }
+        pool->task(pool->ctx, CLAIM_NEXT(c), worker);
+        atomic_fetch_add_explicit(&pool->done, 1u, memory_order_release);
+        c = atomic_load_explicit(&pool->claim, memory_order_acquire);
+    }
+}
+
+/**
+ * AiGemmPool.run: publish the job, wake parked workers, take part, then
+ * wait for the tasks other workers still run
+ */
+static void pool_run(void* user, AiGemmTask task, void* ctx, uint32_t tasks) {
+    AiThreadPool* pool = (AiThreadPool*)user;
+    uint32_t gen = CLAIM_GEN(atomic_load_explicit(&pool->claim, memory_order_relaxed)) + 1u;
+
+    if (tasks > 0xFFFFu) tasks = 0xFFFFu;  // Never: at most one per worker
+    pool->task = task;
+    pool->ctx = ctx;
+    atomic_store_explicit(&pool->done, 0u, memory_order_relaxed);
+    atomic_store(&pool->claim, CLAIM(gen, 0u, tasks));
+    pool->jobs++;
+
+    // Pairs with the worker's parked increment before it rechecks the claim
+    if (atomic_load(&pool->parked)) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+        pool->wakeups++;
+    }
+
+    work(pool, 0);
+    for (uint32_t spin = 0; atomic_load_explicit(&pool->done, memory_order_acquire) < tasks; spin++) {
+        if (spin < AI_THREAD_POOL_SPIN) {
+            cpu_relax();
+        } else {
+            sched_yield();  // A worker was preempted: let it finish
+        }
+    }
+}
+
+static void* worker_main(void* arg) {
+    const WorkerArg* self = (const WorkerArg*)arg;
+    AiThreadPool* pool = self->pool;
+    uint32_t seen = 0;  // Generation of the last job taken part in
+
+    for (;;) {
+        uint64_t c = atomic_load_explicit(&pool->claim, memory_order_acquire);
+
+        // Poll for the next job, then park until run() or destroy wakes us
+        for (uint32_t spin = 0; CLAIM_GEN(c) == seen && !atomic_load(&pool->stop); spin++) {
+            if (spin < AI_THREAD_POOL_SPIN) {
+                cpu_relax();
+            } else {
+                pthread_mutex_lock(&pool->lock);
+                atomic_fetch_add(&pool->parked, 1u);
+                while (CLAIM_GEN(atomic_load(&pool->claim)) == seen && !atomic_load(&pool->stop)) {
+                    pthread_cond_wait(&pool->wake, &pool->lock);
+                }
+                atomic_fetch_sub(&pool->parked, 1u);
+                pthread_mutex_unlock(&pool->lock);
+                spin = 0;
+            }
+            c = atomic_load_explicit(&pool->claim, memory_order_acquire);
+        }
+        if (atomic_load(&pool->stop)) break;
+
+        seen = CLAIM_GEN(c);
+        work(pool, self->worker);
+    }
+    return NULL;
+}
+
+/* ==================== LIFETIME ==================== */
+
+AiThreadPool* ai_thread_pool_create(uint32_t workers, uint32_t scratch_size, uint32_t min_macs) {
+    if (workers < 1u) workers = 1u;
+    if (workers > AI_GEMM_MAX_WORKERS) workers = AI_GEMM_MAX_WORKERS;
+
+    AiThreadPool* pool = (AiThreadPool*)calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+
+    const size_t stride = ((size_t)scratch_size + SCRATCH_ALIGN - 1u) / SCRATCH_ALIGN * SCRATCH_ALIGN;
+    if (workers > 1u && stride) {
+        pool->memory = aligned_alloc(SCRATCH_ALIGN, stride * (workers - 1u));
+        if (!pool->memory) {
+            free(pool);
+            return NULL;
+        }
+    }
+
+    pool->gemm.run = pool_run;
+    pool->gemm.user = pool;
+    pool->gemm.workers = workers;
+    pool->gemm.min_macs = min_macs ? min_macs : AI_THREAD_POOL_MIN_MACS;
+    pool->gemm.scratch_size = scratch_size;
+    for (uint32_t i = 1; i < workers && pool->memory; i++) {
+        pool->gemm.scratch[i] = (int16_t*)(void*)((uint8_t*)pool->memory + stride * (i - 1u));
+    }
+
+    atomic_init(&pool->claim, CLAIM(0u, 0u, 0u));
+    atomic_init(&pool->done, 0u);
+    atomic_init(&pool->parked, 0u);
+    atomic_init(&pool->stop, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (uint32_t i = 1; i < workers; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].worker = i;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]) != 0) {
+            ai_thread_pool_destroy(pool);
+            return NULL;
+        }
+        pool->started = i;
+    }
+    return pool;
+}
+
+const AiGemmPool* ai_thread_pool_gemm(const AiThreadPool* pool) {
+    return &pool->gemm;
+}
+
+void ai_thread_pool_destroy(AiThreadPool* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->stop, 1);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (uint32_t i = 1; i <= pool->started; i++) pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->memory);
+    free(pool);
+}
+
+void ai_thread_pool_stats(const AiThreadPool* pool, uint64_t* jobs, uint64_t* wakeups) {
+    if (jobs) *jobs = pool->jobs;
+    if (wakeups) *wakeups = pool->wakeups;
+}
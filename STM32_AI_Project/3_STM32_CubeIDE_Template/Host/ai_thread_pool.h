@@ -0,0 +1,51 @@
+/*
+ * Engine Thread Pool
+ * Persistent POSIX worker threads behind an AiGemmPool (ai_gemm.h), for
+ * low single-frame latency on desktop / edge-PC hosts
+ *
+ * Workers are created once and wait between jobs: they poll for the next
+ * job for AI_THREAD_POOL_SPIN rounds (a layer usually follows within
+ * microseconds) and then park on a condition variable, so an idle pool
+ * costs no CPU. A job's tasks are claimed one at a time from a counter
+ * that carries the job's generation, so a worker that wakes late can
+ * never take a task of a later job. run() returns when every task is
+ * done: the barrier between layers.
+ *
+ * One job at a time: a pool serves one engine context (or one at a time).
+ */
+
+#ifndef AI_THREAD_POOL_H
+#define AI_THREAD_POOL_H
+
+#include <stdint.h>
+#include "ai_gemm.h"
+
+#define AI_THREAD_POOL_SPIN      20000      // Polls before a waiting worker parks
+#define AI_THREAD_POOL_MIN_MACS  65536      // Default AiGemmPool.min_macs
+
+typedef struct AiThreadPool AiThreadPool;
+
+/**
+ * Start workers - 1 threads (workers up to AI_GEMM_MAX_WORKERS, the
+ * caller of run() being worker 0) with scratch_size bytes of scratch
+ * each (ai_engine_worker_scratch_size()); min_macs 0 takes the default.
+ * Returns NULL when threads or memory are not available.
+ */
+AiThreadPool* ai_thread_pool_create(uint32_t workers, uint32_t scratch_size, uint32_t min_macs);
+
+/**
+ * The pool as the engine takes it (fire_detection_set_pool())
+ */
+const AiGemmPool* ai_thread_pool_gemm(const AiThreadPool* pool);
+
+/**
+ * Stop and join the workers, free the pool (NULL is ignored)
+ */
+void ai_thread_pool_destroy(AiThreadPool* pool);
+
+/**
+ * Jobs run and jobs that woke parked workers, since creation
+ */
+void ai_thread_pool_stats(const AiThreadPool* pool, uint64_t* jobs, uint64_t* wakeups);
+
+#endif // AI_THREAD_POOL_H
@@ -0,0 +1,100 @@
+/*
+ * Frame Pool Stress
+ * Threads acquiring, sharing and handing over frames of one pool
+ *
+ * Build: Core/Src/frame_pool.c + Host/frame_pool_stress.c, with -pthread
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "frame_pool_stress.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+typedef struct {
+    FramePool* pool;
+    FrameBuffer* volatile* mailbox;  // One slot per thread
+    uint32_t thread;
+    uint32_t threads;
+    uint32_t iterations;
+    FrameStressResult result;
+} StressArg;
+
+static void* stress_thread(void* p) {
+    StressArg* arg = (StressArg*)p;
+    uint32_t* stamp;
+
+    for (uint32_t i = 0; i < arg->iterations; i++) {
+        FrameBuffer* volatile* slot = &arg->mailbox[(arg->thread + i) % arg->threads];
+        FrameBuffer* frame = frame_acquire(arg->pool);
+        if (!frame) {
+            // Consumer catching up: empty a mailbox so the pool drains
+            FrameBuffer* waiting = __atomic_exchange_n(slot, NULL, __ATOMIC_ACQ_REL);
+            if (waiting) {
+                frame_release(arg->pool, waiting);
+                arg->result.handed_over++;
+            }
+            arg->result.refused++;
+            sched_yield();
+            continue;
+        }
+        arg->result.acquired++;
+
+        // A buffer handed to two holders at once shows up as a foreign stamp
+        stamp = (uint32_t*)frame->data;
+        __atomic_store_n(&stamp[0], arg->thread, __ATOMIC_RELAXED);
+        __atomic_store_n(&stamp[1], i, __ATOMIC_RELAXED);
+
+        const uint32_t extra = i % 3u;
+        for (uint32_t r = 0; r < extra; r++) {
+            frame_retain(frame);
+        }
+        if ((i & 7u) == 0) sched_yield();
+        if (__atomic_load_n(&stamp[0], __ATOMIC_RELAXED) != arg->thread ||
+            __atomic_load_n(&stamp[1], __ATOMIC_RELAXED) != i) {
+            arg->result.corrupted++;
+        }
+        for (uint32_t r = 0; r < extra; r++) {
+            frame_release(arg->pool, frame);
+        }
+
+        // Last reference to another context: swap into a mailbox and drop
+        // whatever frame was waiting there
+        FrameBuffer* previous = __atomic_exchange_n(slot, frame, __ATOMIC_ACQ_REL);
+        if (previous) {
+            frame_release(arg->pool, previous);
+            arg->result.handed_over++;
+        }
+    }
+    return NULL;
+}
+
+int32_t frame_pool_stress(FramePool* pool, uint32_t threads, uint32_t iterations, FrameStressResult* result) {
+    FrameBuffer* volatile mailbox[FRAME_STRESS_MAX_THREADS] = {0};
+    StressArg args[FRAME_STRESS_MAX_THREADS];
+    pthread_t handles[FRAME_STRESS_MAX_THREADS];
+    uint32_t started = 0;
+
+    if (threads == 0) threads = 1;
+    if (threads > FRAME_STRESS_MAX_THREADS) threads = FRAME_STRESS_MAX_THREADS;
+    memset(result, 0, sizeof(*result));
+
+    for (uint32_t t = 0; t < threads; t++) {
+        args[t] = (StressArg){ pool, mailbox, t, threads, iterations, { 0 } };
+        if (pthread_create(&handles[t], NULL, stress_thread, &args[t]) != 0) break;
+        started++;
+    }
+    for (uint32_t t = 0; t < started; t++) {
+        pthread_join(handles[t], NULL);
+        result->acquired += args[t].result.acquired;
+        result->refused += args[t].result.refused;
+        result->handed_over += args[t].result.handed_over;
+        result->corrupted += args[t].result.corrupted;
+    }
+
+    for (uint32_t t = 0; t < threads; t++) {
+        frame_release(pool, mailbox[t]);
+    }
+    return (started == threads) ? 0 : -1;
+}
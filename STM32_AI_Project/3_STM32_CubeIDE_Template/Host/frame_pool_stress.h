@@ -0,0 +1,40 @@
+/*
+ * Frame Pool Stress
+ * POSIX threads hammering one FramePool (frame_pool.h) the way the
+ * firmware's contexts do - a producer acquiring, consumers retaining and
+ * a different context dropping the last reference - so the host can check
+ * the lock-free paths for lost or doubly handed-out buffers
+ *
+ * Build: Core/Src/frame_pool.c + Host/frame_pool_stress.c, with -pthread
+ * (2_Desktop_Tools/frame_pool_check.py)
+ */
+
+#ifndef FRAME_POOL_STRESS_H
+#define FRAME_POOL_STRESS_H
+
+#include <stdint.h>
+#include "frame_pool.h"
+
+#define FRAME_STRESS_MAX_THREADS 16
+
+typedef struct {
+    uint32_t acquired;               // Frames the threads got
+    uint32_t refused;                // Acquires that returned NULL
+    uint32_t handed_over;            // Frames released by another thread
+    uint32_t corrupted;              // Frames another holder wrote to
+} FrameStressResult;
+
+/**
+ * threads threads (up to FRAME_STRESS_MAX_THREADS) each run iterations
+ * rounds: acquire, stamp the buffer with its owner, retain up to two more
+ * references, check the stamp, release all but one and pass that one to
+ * a shared mailbox whose previous frame this thread releases; a refused
+ * acquire empties that mailbox instead. The mailboxes are drained at the
+ * end, so every reference is dropped.
+ * The pool must use FRAME_DROP_NEWEST (the reclaim hook is single-context)
+ * and buffers of at least 8 bytes. Returns 0, or -1 if a thread could not
+ * start.
+ */
+int32_t frame_pool_stress(FramePool* pool, uint32_t threads, uint32_t iterations, FrameStressResult* result);
+
+#endif // FRAME_POOL_STRESS_H
@@ -0,0 +1,249 @@
+/*
+ * Host Update Device
+ * Linux stand-in for the firmware's update path, exposed on a pseudo-terminal
+ *
+ * Runs the same loop as main.c: one inference per frame on the active
+ * model, with received update bytes serviced between frames and the
+ * slot swap applied at a frame boundary. Flash slots are RAM buffers;
+ * erases run in the background for HOST_ERASE_MS, like HAL_FLASHEx_Erase_IT.
+ * Configuration messages (detection_config.h) are answered on the same
+ * link and take effect at the next frame. Benchmark sessions
+ * (dut_benchmark.h) time their runs with a nanosecond clock and pause the
+ * frames while they last.
+ *
+ * Build (from 3_STM32_CubeIDE_Template):
+ *   cc -O2 -ICore/Inc Host/host_update_device.c Core/Src/model_update.c \
+ *      Core/Src/link_protocol.c Core/Src/crc32.c Core/Src/ai_inference.c Core/Src/ai_engine.c \
+ *      Core/Src/ai_gemm.c Core/Src/thermal_sensor.c Core/Src/model_data.c \
+ *      Core/Src/detection_config.c Core/Src/dut_benchmark.c -o host_update_device -lm
+ *
+ * Usage:
+ *   ./host_update_device [base_model.bin]      # prints the PTY path
+ *   python model_delta_update.py send patch.fdp --port /dev/pts/N
+ *   python device_config.py --port /dev/pts/N --profile high-sensitivity
+ *   python dut_benchmark.py --port /dev/pts/N --synthetic 64
+ */
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include "stm32_ai_framework.h"
+#include "model_data.h"
+#include "model_update.h"
+#include "detection_config.h"
+#include "dut_benchmark.h"
+#include "crc32.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SLOT_SIZE (512u * 1024u)
+#define FRAME_PERIOD_MS 10
+#define HOST_ERASE_MS   20   // Per erase unit (an H7 sector takes seconds)
+
+static uint32_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static struct {
+    uint8_t* addr;
+    uint32_t size;
+    uint32_t done_ms;
+    int32_t busy;
+} ram_erasing;
+
+static int32_t ram_erase(void* user, uint8_t* addr, uint32_t size) {
+    (void)user;
+    if (ram_erasing.busy) return -1;
+    ram_erasing.addr = addr;
+    ram_erasing.size = size;
+    ram_erasing.done_ms = now_ms() + HOST_ERASE_MS;
+    ram_erasing.busy = 1;
+    return 0;
+}
+
+static int32_t ram_erase_poll(void* user) {
+    (void)user;
+    if (ram_erasing.busy && (int32_t)(now_ms() - ram_erasing.done_ms) >= 0) {
+        memset(ram_erasing.addr, 0xFF, ram_erasing.size);  // Erased flash reads as 0xFF
+        ram_erasing.busy = 0;
+    }
+    return ram_erasing.busy;
+}
+
+static int32_t ram_write(void* user, uint8_t* dst, const uint8_t* src, uint32_t len) {
+    (void)user;
+    memcpy(dst, src, len);
+    return 0;
+}
+
+static void report_activate(void* user, uint32_t slot, uint32_t length) {
+    (void)user;
+    printf("  Boot slot -> %u (%u bytes)\n", slot, length);
+}
+
+// Benchmark clock: CLOCK_MONOTONIC nanoseconds (wraps every 4.3 s)
+static uint32_t host_cycles(void* user) {
+    (void)user;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+static void report_session(void* user, int32_t active) {
+    DutSession* dut = (DutSession*)user;
+    if (active) {
+        printf("Benchmark session: frames paused\n");
+    } else {
+        printf("✓ Benchmark session ended: %u runs, %u inferences\n", dut->runs, dut->inferences);
+    }
+    fflush(stdout);
+}
+
+static uint8_t* load_file(const char* path, uint32_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t* data = malloc((size_t)len);
+    if (data && fread(data, 1, (size_t)len, f) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (uint32_t)len;
+    return data;
+}
+
+static int open_pty(char* name, size_t name_len, int* slave_fd) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return -1;
+
+    const char* slave_name = ptsname(master);
+    if (!slave_name) return -1;
+    snprintf(name, name_len, "%s", slave_name);
+
+    // Raw mode on the slave side (what the host tool opens); keeping it
+    // open ourselves avoids EIO on the master between client sessions
+    *slave_fd = open(slave_name, O_RDWR | O_NOCTTY);
+    if (*slave_fd < 0) return -1;
+
+    struct termios tio;
+    tcgetattr(*slave_fd, &tio);
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tcsetattr(*slave_fd, TCSANOW, &tio);
+    return master;
+}
+
+int main(int argc, char** argv) {
+    static FireDetectionModel fire_model;
+    static ModelUpdater updater;
+    static ConfigStore config;
+    static DutSession dut;
+    static uint8_t dut_input[AI_ENGINE_MAX_IMAGE];
+    static uint8_t slot_a[SLOT_SIZE];
+    static uint8_t slot_b[SLOT_SIZE];
+    static uint8_t rx[512];
+    static uint8_t tx[4 * LINK_MAX_FRAME];
+
+    const uint8_t* base = model_data;
+    uint32_t base_len = model_data_len;
+    if (argc > 1) {
+        base = load_file(argv[1], &base_len);
+        if (!base) {
+            fprintf(stderr, "Cannot read %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    printf("=== Host Update Device ===\n");
+    if (fire_detection_init_model(&fire_model, base, base_len, &model_info) != 0) return 1;
+
+    ModelSlot slots[2] = { { slot_a, SLOT_SIZE }, { slot_b, SLOT_SIZE } };
+    ModelFlashOps flash = { ram_erase, ram_erase_poll, ram_write, report_activate, 4096, NULL };
+    model_update_init(&updater, base, base_len, -1, slots, &flash);
+    model_update_set_check(&updater, fire_detection_check_model);
+    printf("  Active model CRC: 0x%08X\n", updater.active_crc);
+    config_init(&config, NULL);
+    const DutOps dut_ops = { host_cycles, report_session, 1000000000u, "linux-host", &dut };
+    dut_init(&dut, &fire_model, dut_input, sizeof(dut_input), &dut_ops);
+    dut_set_next(&dut, config_link_handler, &config);
+    model_update_set_handler(&updater, dut_link_handler, &dut);
+
+    char pty_name[64];
+    int slave_fd;
+    int master = open_pty(pty_name, sizeof(pty_name), &slave_fd);
+    if (master < 0) {
+        perror("pty");
+        return 1;
+    }
+    printf("PTY: %s\n", pty_name);
+    fflush(stdout);
+
+    uint8_t frame[1024];
+    uint32_t frame_count = 0;
+    uint32_t config_version = 0;
+    struct pollfd pfd = { master, POLLIN, 0 };
+
+    while (1) {
+        // Service the link until the next frame is due
+        if (poll(&pfd, 1, FRAME_PERIOD_MS) > 0 && (pfd.revents & POLLIN)) {
+            ssize_t n = read(master, rx, sizeof(rx));
+            if (n > 0) {
+                uint32_t tx_len = model_update_process(&updater, rx, (uint32_t)n, tx, sizeof(tx));
+                if (tx_len && write(master, tx, tx_len) != (ssize_t)tx_len) perror("write");
+            }
+        }
+        model_update_poll(&updater);
+        if (dut_poll(&dut, now_ms())) continue;  // Benchmark session: no frames, no swap
+
+        // Frame boundary: this frame's configuration
+        const DetectionConfig* cfg = config_acquire(&config);
+        if (cfg->params.version != config_version) {
+            config_version = cfg->params.version;
+            printf("✓ Config v%u at frame %u: fire %.2f (logit %.3f) / critical %.2f | "
+                   "screen %u ms, CNN %u ms, hold %u ms\n",
+                   config_version, frame_count, cfg->params.fire, cfg->thresholds.fire_logit,
+                   cfg->params.critical, cfg->params.screen_period_ms, cfg->params.active_period_ms,
+                   cfg->params.hold_ms);
+            fflush(stdout);
+        }
+
+        // Inference on the active model, never blocked by the update
+        for (uint32_t i = 0; i < sizeof(frame); i++) frame[i] = (uint8_t)(frame_count + i);
+        preprocess_image(frame, sizeof(frame), fire_model.input_buffer);
+        fire_detection_inference(&fire_model);
+        process_detection_output(&fire_model, &cfg->thresholds);
+        frame_count++;
+
+        // Frame boundary: switch models atomically with respect to inference
+        const uint8_t* new_model;
+        uint32_t new_len;
+        if (model_update_take_swap(&updater, &new_model, &new_len)) {
+            if (fire_detection_init_model(&fire_model, new_model, new_len, &model_info) != 0) {
+                printf("⚠ Updated model rejected at frame %u, keeping the running one\n", frame_count);
+                fflush(stdout);
+                continue;
+            }
+            printf("✓ Model updated at frame %u: %u bytes, CRC 0x%08X "
+                   "(chunks %u, duplicates %u, blocks copied %u / sent %u)\n",
+                   frame_count, new_len, crc32_update(0, new_model, new_len),
+                   updater.chunks_applied, updater.chunks_duplicate,
+                   updater.blocks_copied, updater.blocks_literal);
+            fflush(stdout);
+        }
+    }
+}
@@ -0,0 +1,165 @@
+/*
+ * Instruction Profile Plugin
+ * QEMU TCG plugin (QEMU 9.0 or newer) counting guest instructions per
+ * profiling mark of the QEMU target (ai_profile.h)
+ *
+ * Every executed instruction adds one to a per-vCPU counter (inline, no
+ * callback). The entry of ai_profile_mark() - its address is the mark=
+ * argument - gets a callback that reads the id from r0: a begin mark
+ * pushes (id, count), an end mark pops it and charges the difference to
+ * the id, so nested marks are included in their parent. Counts are exact
+ * and do not depend on the host.
+ *
+ * Arguments: mark=<address> (required), out=<file> (default: QEMU log)
+ * Output, at exit:
+ *   # total <instructions> unbalanced <marks>
+ *   <id> <calls> <instructions>      one line per id, hex id
+ */
+
+#include <glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <qemu-plugin.h>
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define PROFILE_EXIT   0x8000u       // AI_PROFILE_EXIT
+#define PROFILE_IDS    0x8000u
+#define PROFILE_DEPTH  32
+
+typedef struct {
+    uint32_t id;
+    uint64_t start;
+} OpenMark;
+
+static struct qemu_plugin_scoreboard* scoreboard;
+static qemu_plugin_u64 insns;
+static struct qemu_plugin_register* r0;
+static GByteArray* r0_value;
+
+static uint64_t mark_addr;
+static const char* out_path;
+
+static uint64_t calls[PROFILE_IDS];
+static uint64_t counts[PROFILE_IDS];
+static OpenMark stack[PROFILE_DEPTH];
+static uint32_t depth;
+static uint64_t unbalanced;
+
+static void vcpu_init(qemu_plugin_id_t id, unsigned int vcpu_index) {
+    g_autoptr(GArray) regs = qemu_plugin_get_registers();
+    (void)id;
+    (void)vcpu_index;
+
+    for (guint i = 0; i < regs->len; i++) {
+        qemu_plugin_reg_descriptor* reg = &g_array_index(regs, qemu_plugin_reg_descriptor, i);
+        if (strcmp(reg->name, "r0") == 0) r0 = reg->handle;
+    }
+}
+
+static void on_mark(unsigned int vcpu_index, void* userdata) {
+    uint32_t value = 0;
+    (void)userdata;
+
+    g_byte_array_set_size(r0_value, 0);
+    if (!r0 || qemu_plugin_read_register(r0, r0_value) < 4) return;
+    memcpy(&value, r0_value->data, sizeof(value));  // Little-endian guest and host
+
+    const uint64_t now = qemu_plugin_u64_get(insns, vcpu_index);
+    const uint32_t id = value & (PROFILE_IDS - 1u);
+
+    if (!(value & PROFILE_EXIT)) {
+        if (depth == PROFILE_DEPTH) {
+            unbalanced++;
+            return;
+        }
+        stack[depth].id = id;
+        stack[depth].start = now;
+        depth++;
+        return;
+    }
+
+    // End mark: close anything left open inside it
+    while (depth > 0 && stack[depth - 1].id != id) {
+        depth--;
+        unbalanced++;
+    }
+    if (depth == 0) {
+        unbalanced++;
+        return;
+    }
+    depth--;
+    calls[id]++;
+    counts[id] += now - stack[depth].start;
+}
+
+static void tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb* tb) {
+    (void)id;
+
+    for (size_t i = 0; i < qemu_plugin_tb_n_insns(tb); i++) {
+        struct qemu_plugin_insn* insn = qemu_plugin_tb_get_insn(tb, i);
+        qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu(insn, QEMU_PLUGIN_INLINE_ADD_U64, insns, 1);
+        if (qemu_plugin_insn_vaddr(insn) == mark_addr) {
+            qemu_plugin_register_vcpu_insn_exec_cb(insn, on_mark, QEMU_PLUGIN_CB_R_REGS, NULL);
+        }
+    }
+}
+
+static void at_exit(qemu_plugin_id_t id, void* userdata) {
+    (void)id;
+    (void)userdata;
+    unbalanced += depth;
+
+    g_autoptr(GString) report = g_string_new(NULL);
+    g_string_append_printf(report, "# total %" PRIu64 " unbalanced %" PRIu64 "\n",
+                           qemu_plugin_u64_sum(insns), unbalanced);
+    for (uint32_t i = 0; i < PROFILE_IDS; i++) {
+        if (calls[i]) g_string_append_printf(report, "0x%04x %" PRIu64 " %" PRIu64 "\n", i, calls[i], counts[i]);
+    }
+
+    FILE* f = out_path ? fopen(out_path, "w") : NULL;
+    if (f) {
+        fputs(report->str, f);
+        fclose(f);
+    } else {
+        qemu_plugin_outs(report->str);
+    }
+    qemu_plugin_scoreboard_free(scoreboard);
+    g_byte_array_free(r0_value, TRUE);
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t* info,
+                                           int argc, char** argv) {
+    (void)info;
+
+    for (int i = 0; i < argc; i++) {
+        g_auto(GStrv) kv = g_strsplit(argv[i], "=", 2);
+        if (!kv[0] || !kv[1]) {
+            fprintf(stderr, "insn_profile: bad argument %s\n", argv[i]);
+            return -1;
+        }
+        if (strcmp(kv[0], "mark") == 0) {
+            mark_addr = g_ascii_strtoull(kv[1], NULL, 0) & ~(uint64_t)1;  // Drop the Thumb bit
+        } else if (strcmp(kv[0], "out") == 0) {
+            out_path = g_strdup(kv[1]);
+        } else {
+            fprintf(stderr, "insn_profile: unknown argument %s\n", kv[0]);
+            return -1;
+        }
+    }
+    if (!mark_addr) {
+        fprintf(stderr, "insn_profile: mark=<ai_profile_mark address> is required\n");
+        return -1;
+    }
+
+    scoreboard = qemu_plugin_scoreboard_new(sizeof(uint64_t));
+    insns = qemu_plugin_scoreboard_u64(scoreboard);
+    r0_value = g_byte_array_new();
+
+    qemu_plugin_register_vcpu_init_cb(id, vcpu_init);
+    qemu_plugin_register_vcpu_tb_trans_cb(id, tb_trans);
+    qemu_plugin_register_atexit_cb(id, at_exit, NULL);
+    return 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * QEMU Target
+ * The firmware pipeline on an emulated Cortex-M7 board (mps2-an500), for
+ * deterministic, architecture-accurate instruction counts without hardware
+ *
+ * Runs the work of one active frame of main.c - capture, inference,
+ * decision with fusion, thermal conversion, one analog DMA half and
+ * 100 ms of PDM decimation - with profiling marks (ai_profile.h) around
+ * each stage and, inside the engine, each layer. Console and files go
+ * through semihosting; the camera is a file of raw frames at the model's
+ * input resolution. QEMU models no caches, wait states or pipeline:
+ * counts are Thumb-2 instructions, not cycles.
+ *
+ * Build (from 3_STM32_CubeIDE_Template, arm-none-eabi-gcc with newlib):
+ *   arm-none-eabi-gcc -O2 -mcpu=cortex-m7 -mthumb -mfloat-abi=hard -mfpu=fpv5-d16 \
+ *      -DAI_QEMU -DAI_PROFILE -ICore/Inc -T Qemu/mps2_an500.ld -nostartfiles --specs=rdimon.specs \
+ *      Qemu/startup_mps2_an500.c Qemu/qemu_main.c Core/Src/ai_inference.c Core/Src/ai_engine.c \
+ *      Core/Src/ai_gemm.c Core/Src/model_data.c Core/Src/thermal_sensor.c Core/Src/analog_sensors.c \
+ *      Core/Src/audio_frontend.c -o qemu_fire_detection.elf -lm
+ *   cc -shared -fPIC -O2 $(pkg-config --cflags glib-2.0) -I<qemu source>/include/qemu \
+ *      Qemu/insn_profile_plugin.c -o libinsn_profile.so
+ *
+ * Run (QEMU 9.0 or newer; 2_Desktop_Tools/qemu_profile.py does all of this):
+ *   qemu-system-arm -M mps2-an500 -nographic -kernel qemu_fire_detection.elf \
+ *      -semihosting-config enable=on,target=native,arg=fire,arg=model.bin,arg=frames.raw \
+ *      -plugin ./libinsn_profile.so,mark=<ai_profile_mark address>,out=profile.txt
+ *
+ * Semihosting arguments: fire [model.bin|-] [frames.raw|-] [frames]
+ *   model.bin   FDM1 engine model (default: the built-in model_data)
+ *   frames.raw  raw 8-bit frames, input_w * input_h * input_c bytes each
+ *               (default: main.c's synthetic frames)
+ *   frames      frames to run; the file is replayed from the start when it
+ *               runs out (default: every frame in the file, else 8)
+ */
+
+#include "stm32_ai_framework.h"
+#include "model_data.h"
+#include "ai_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QEMU_MODEL_MAX       (1024u * 1024u)
+#define QEMU_DEFAULT_FRAMES  8u
+#define QEMU_MAX_ARGS        8
+#define QEMU_AUDIO_HALVES    50u     // 100 ms of PDM at 1.024 MHz, 2 ms per DMA half
+
+#define SYS_GET_CMDLINE      0x15
+
+/* ==================== SEMIHOSTING ==================== */
+
+static int32_t semihost(int32_t op, void* arg) {
+    register int32_t r0 __asm__("r0") = op;
+    register void* r1 __asm__("r1") = arg;
+    __asm__ volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+    return r0;
+}
+
+/**
+ * Split the semihosting command line into argv (no quoting)
+ */
+static int32_t get_args(char* line, uint32_t size, char** argv) {
+    struct { char* buffer; int32_t length; } block = { line, (int32_t)size - 1 };
+    int32_t argc = 0;
+
+    if (semihost(SYS_GET_CMDLINE, &block) != 0) return 0;
+    line[block.length] = '\0';
+
+    for (char* p = strtok(line, " "); p && argc < QEMU_MAX_ARGS; p = strtok(NULL, " ")) {
+        argv[argc++] = p;
+    }
+    return argc;
+}
+
+/* ==================== INPUTS ==================== */
+
+static uint8_t model_image[QEMU_MODEL_MAX] __attribute__((aligned(MODEL_BLOCK_SIZE)));
+static ModelInfo file_info = { "FileModel", "qemu", 0, 0, 0, 0.7f };
+
+/**
+ * Read an FDM1 model; the input shape comes from its header
+ */
+static const uint8_t* load_model(const char* path, uint32_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    size_t len = fread(model_image, 1, sizeof(model_image), f);
+    int32_t complete = feof(f);
+    fclose(f);
+    if (!complete || len < sizeof(AiModelHeader)) return NULL;
+
+    AiModelHeader header;
+    memcpy(&header, model_image, sizeof(header));
+    file_info.input_width = header.input_w;
+    file_info.input_height = header.input_h;
+    file_info.input_channels = header.input_c;
+    *size = (uint32_t)len;
+    return model_image;
+}
+
+/**
+ * Camera stand-in: the next frame of the file, from the start again at
+ * its end; main.c's synthetic frame without a file
+ */
+static int32_t camera_read_frame(FILE* frames, uint8_t* image, uint32_t size, uint32_t frame) {
+    if (!frames) {
+        memset(image, (int)(frame % 256), size);
+        return 0;
+    }
+    if (fread(image, 1, size, frames) == size) return 0;
+    rewind(frames);
+    return fread(image, 1, size, frames) == size ? 0 : -1;
+}
+
+/**
+ * Deterministic thermal frame: 25 C ambient, a warm gradient
+ */
+static void synthetic_thermal_frame(uint8_t* raw, uint32_t frame) {
+    for (uint32_t i = 0; i < THERMAL_FRAME_WORDS; i++) {
+        uint16_t word = (i < THERMAL_PIXELS) ? (uint16_t)(((i + frame) & 63) * 4) : 0;
+        if (i == THERMAL_AUX_TA) word = 25 * 64;
+        if (i == THERMAL_AUX_VDD) word = 3300;
+        raw[2 * i] = (uint8_t)(word >> 8);
+        raw[2 * i + 1] = (uint8_t)word;
+    }
+}
+
+/* ==================== MAIN ==================== */
+
+int main(void) {
+    static FireDetectionModel fire_model;
+    static ThermalSensor thermal;
+    static ThermalCalibration thermal_cal;
+    static AnalogAcquisition analog;
+    static AudioFrontEnd audio;
+    static uint16_t analog_dma[ANALOG_DMA_SAMPLES] AI_DMA_BUFFER;
+    static uint8_t audio_pdm_dma[AUDIO_PDM_DMA_BYTES] AI_DMA_BUFFER;
+    static uint8_t sensor_image[AI_ENGINE_MAX_IMAGE] AI_DMA_BUFFER;
+    static uint8_t thermal_raw[THERMAL_FRAME_BYTES];
+    static char cmdline[256];
+
+    char* argv[QEMU_MAX_ARGS];
+    int32_t argc = get_args(cmdline, sizeof(cmdline), argv);
+
+    printf("=== Fire Detection on QEMU mps2-an500 ===\n");
+
+    const uint8_t* data = model_data;
+    uint32_t len = model_data_len;
+    const ModelInfo* info = &model_info;
+    if (argc > 1 && strcmp(argv[1], "-") != 0) {
+        data = load_model(argv[1], &len);
+        info = &file_info;
+        if (!data) {
+            printf("ERROR: cannot read model %s\n", argv[1]);
+            return 1;
+        }
+    }
+    if (fire_detection_init_model(&fire_model, data, len, info) != 0) {
+        printf("ERROR: Model initialization failed\n");
+        return 1;
+    }
+    fire_detection_set_cam(&fire_model, 1);  // As main.c; models it cannot map run without
+
+    FILE* frames = NULL;
+    if (argc > 2 && strcmp(argv[2], "-") != 0) {
+        frames = fopen(argv[2], "rb");
+        if (!frames) {
+            printf("ERROR: cannot read frames %s\n", argv[2]);
+            return 1;
+        }
+    }
+    uint32_t frame_size = info->input_width * info->input_height * info->input_channels;
+    uint32_t frame_limit = QEMU_DEFAULT_FRAMES;
+    if (argc > 3) {
+        frame_limit = (uint32_t)strtoul(argv[3], NULL, 10);
+    } else if (frames) {
+        fseek(frames, 0, SEEK_END);
+        frame_limit = (uint32_t)(ftell(frames) / (long)frame_size);
+        rewind(frames);
+    }
+    if (frame_size == 0 || frame_size > sizeof(sensor_image) || frame_limit == 0) {
+        printf("ERROR: %lu-byte frames x %lu\n", (unsigned long)frame_size, (unsigned long)frame_limit);
+        return 1;
+    }
+
+    // Sensor front-ends on synthetic data (main.c's placeholder calibration)
+    thermal_cal.gain = 1.0f;
+    thermal_cal.emissivity = 0.95f;
+    thermal_cal.ta_ref = 25.0f;
+    thermal_cal.vdd_ref = 3.3f;
+    for (uint32_t i = 0; i < THERMAL_PIXELS; i++) {
+        thermal_cal.alpha[i] = 1.0e-7f;
+    }
+    thermal_init(&thermal, &thermal_cal, NULL);
+    analog_init(&analog, analog_dma, NULL);
+    audio_init(&audio);
+
+    printf("Frames: %lu x %lu bytes (%s)\n", (unsigned long)frame_limit, (unsigned long)frame_size,
+           frames ? argv[2] : "synthetic");
+
+    uint32_t detections = 0;
+    for (uint32_t frame = 0; frame < frame_limit; frame++) {
+        AI_PROFILE_BEGIN(AI_PROFILE_FRAME);
+
+        AI_PROFILE_BEGIN(AI_PROFILE_CAPTURE);
+        int32_t captured = camera_read_frame(frames, sensor_image, frame_size, frame);
+        AI_PROFILE_END(AI_PROFILE_CAPTURE);
+        if (captured != 0) {
+            AI_PROFILE_END(AI_PROFILE_FRAME);
+            printf("ERROR: frame file shorter than one frame\n");
+            return 1;
+        }
+
+        AI_PROFILE_BEGIN(AI_PROFILE_INFERENCE);
+        fire_detection_inference_image(&fire_model, sensor_image);
+        AI_PROFILE_END(AI_PROFILE_INFERENCE);
+
+        // Sensor work that shares the frame (interrupt context on the board)
+        synthetic_thermal_frame(thermal_raw, frame);
+        AI_PROFILE_BEGIN(AI_PROFILE_THERMAL);
+        thermal_convert_frame(&thermal, thermal_raw);
+        AI_PROFILE_END(AI_PROFILE_THERMAL);
+
+        for (uint32_t i = 0; i < ANALOG_DMA_SAMPLES / 2; i++) {
+            analog_dma[i] = (uint16_t)(1000 + ((i * 7 + frame) & 15));
+        }
+        AI_PROFILE_BEGIN(AI_PROFILE_ANALOG);
+        analog_dma_half(&analog);
+        analog_poll(&analog);
+        AI_PROFILE_END(AI_PROFILE_ANALOG);
+
+        for (uint32_t i = 0; i < sizeof(audio_pdm_dma); i++) {
+            audio_pdm_dma[i] = (uint8_t)(((i + frame) & 1) ? 0xAA : 0x55);
+        }
+        AI_PROFILE_BEGIN(AI_PROFILE_AUDIO);
+        for (uint32_t half = 0; half < QEMU_AUDIO_HALVES; half++) {
+            audio_pdm_push(&audio, audio_pdm_dma + (half & 1) * (AUDIO_PDM_DMA_BYTES / 2),
+                           AUDIO_PDM_DMA_BYTES / 2);
+        }
+        audio_process(&audio);
+        AI_PROFILE_END(AI_PROFILE_AUDIO);
+
+        AI_PROFILE_BEGIN(AI_PROFILE_DECISION);
+        DetectionResult result = process_detection_output(&fire_model, NULL);
+        fire_detection_fuse_thermal(&result, &thermal.spots, NULL);
+        fire_detection_fuse_analog(&result, &analog.decision, NULL);
+        AI_PROFILE_END(AI_PROFILE_DECISION);
+
+        AI_PROFILE_END(AI_PROFILE_FRAME);
+
+        detections += result.fire_detected ? 1u : 0u;
+        printf("[%lu] Confidence: %.2f%% | Status: %s\n", (unsigned long)frame,
+               result.confidence * 100, result.fire_detected ? "FIRE" : "SAFE");
+    }
+
+    if (frames) fclose(frames);
+    printf("✓ %lu frames, %lu detections\n", (unsigned long)frame_limit, (unsigned long)detections);
+    return 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * QEMU Target Startup
+ * Vector table and reset handler for the mps2-an500 board (Cortex-M7)
+ *
+ * Copies .data from flash, clears .bss, enables the FPU, opens the
+ * semihosting console (newlib librdimon) and exits through semihosting
+ * with main()'s return value, so QEMU's exit status is the program's.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCB_CPACR      (*(volatile uint32_t*)0xE000ED88u)
+#define CPACR_CP10_CP11 (0xFu << 20)    // Full access to the FPU
+
+extern uint32_t __stack_top;
+extern uint32_t __data_load, __data_start, __data_end;
+extern uint32_t __bss_start__, __bss_end__;
+
+extern void initialise_monitor_handles(void);
+extern int main(void);
+
+void Reset_Handler(void);
+void Fault_Handler(void);
+
+__attribute__((section(".vectors"), used))
+static void (* const vector_table[16])(void) = {
+    (void (*)(void))(uintptr_t)&__stack_top,
+    Reset_Handler,
+    Fault_Handler,   // NMI
+    Fault_Handler,   // HardFault
+    Fault_Handler,   // MemManage
+    Fault_Handler,   // BusFault
+    Fault_Handler,   // UsageFault
+};
+
+void Reset_Handler(void) {
+    memcpy(&__data_start, &__data_load, (size_t)((uint8_t*)&__data_end - (uint8_t*)&__data_start));
+    memset(&__bss_start__, 0, (size_t)((uint8_t*)&__bss_end__ - (uint8_t*)&__bss_start__));
+
+    SCB_CPACR |= CPACR_CP10_CP11;
+    __asm__ volatile("dsb\n\tisb" ::: "memory");
+
+    initialise_monitor_handles();
+    exit(main());
+}
+
+/**
+ * Any fault ends the run with a non-zero status instead of hanging QEMU
+ */
+void Fault_Handler(void) {
+    _Exit(99);
+}
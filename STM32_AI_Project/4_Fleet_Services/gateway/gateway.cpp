@@ -0,0 +1,358 @@
+/*
+ * Fleet Telemetry Gateway
+ * epoll event loop, in-place stream parsing and per-device backpressure
+ */
+
+#include "gateway.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include "link_protocol.h"
+
+namespace {
+
+constexpr uint64_t LISTEN_TAG = UINT64_MAX;
+constexpr uint64_t NOTIFY_TAG = UINT64_MAX - 1;
+constexpr int MAX_EVENTS = 512;
+
+uint64_t wall_clock_us() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000u + ts.tv_nsec / 1000;
+}
+
+void set_device_name(char* dst, const char* src, size_t len) {
+    len = std::min(len, DEVICE_NAME_MAX - 1);
+    std::memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+}  // namespace
+
+Gateway::Gateway(const GatewayConfig& config, SinkPipeline& pipeline, int notify_fd)
+    : config_(config), pipeline_(pipeline), notify_fd_(notify_fd), conns_(config.max_devices) {
+    // Lowest slots first, so small fleets touch little memory
+    for (uint32_t i = config.max_devices; i > 0; i--) free_slots_.push_back(i - 1);
+}
+
+Gateway::~Gateway() {
+    for (Connection& c : conns_) {
+        if (c.fd >= 0) close(c.fd);
+    }
+    if (listen_fd_ >= 0) close(listen_fd_);
+    if (epoll_fd_ >= 0) close(epoll_fd_);
+}
+
+bool Gateway::listen() {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) return false;
+
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(config_.port);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) return false;
+    if (::listen(listen_fd_, 4096) != 0) return false;
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) return false;
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = LISTEN_TAG;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev) != 0) return false;
+
+    if (notify_fd_ >= 0) {
+        ev.data.u64 = NOTIFY_TAG;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, notify_fd_, &ev) != 0) return false;
+    }
+    return true;
+}
+
+/* ==================== EVENT LOOP ==================== */
+
+void Gateway::run(const std::atomic<bool>& stop) {
+    epoll_event events[MAX_EVENTS];
+    last_stats_us_ = wall_clock_us();
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, 100);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        now_us_ = wall_clock_us();
+
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == LISTEN_TAG) {
+                accept_all();
+            } else if (tag == NOTIFY_TAG) {
+                uint64_t count;
+                ssize_t ignored = read(notify_fd_, &count, sizeof(count));
+                (void)ignored;
+            } else {
+                on_readable(static_cast<uint32_t>(tag));
+            }
+        }
+
+        // Sinks made progress (or time passed): give paused devices another go
+        if (!paused_.empty() || !retired_.empty()) resume_ready();
+
+        if (config_.stats_interval_ms && now_us_ - last_stats_us_ >= config_.stats_interval_ms * 1000ull) {
+            print_stats(now_us_);
+        }
+    }
+}
+
+void Gateway::accept_all() {
+    while (true) {
+        sockaddr_in peer;
+        socklen_t len = sizeof(peer);
+        int fd = accept4(listen_fd_, reinterpret_cast<sockaddr*>(&peer), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept4");
+            return;
+        }
+
+        if (free_slots_.empty()) {
+            close(fd);  // At capacity: the bridge will retry
+            continue;
+        }
+        uint32_t slot = free_slots_.back();
+        free_slots_.pop_back();
+
+        Connection& c = conns_[slot];
+        c.fd = fd;
+        c.begin = c.end = 0;
+        c.paused = c.closing = false;
+        if (!c.buffer) c.buffer.reset(new uint8_t[config_.buffer_size]);
+
+        // Until the bridge announces "@device <name>", name it by peer address
+        char name[32];
+        snprintf(name, sizeof(name), "%s:%u", inet_ntoa(peer.sin_addr), ntohs(peer.sin_port));
+        set_device_name(c.device, name, strlen(name));
+
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = slot;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+
+        stats_.connections_total++;
+        stats_.connections_open++;
+    }
+}
+
+void Gateway::on_readable(uint32_t slot) {
+    Connection& c = conns_[slot];
+    if (c.fd < 0 || c.paused) return;
+
+    // Move a partial line to the front before reading more
+    if (c.begin > 0) {
+        std::memmove(c.buffer.get(), c.buffer.get() + c.begin, c.end - c.begin);
+        c.end -= c.begin;
+        c.begin = 0;
+    }
+    if (c.end == config_.buffer_size) {
+        stats_.parse_errors++;  // A "line" longer than the buffer: drop it
+        c.end = 0;
+    }
+
+    ssize_t n = read(c.fd, c.buffer.get() + c.end, config_.buffer_size - c.end);
+    if (n > 0) {
+        c.end += static_cast<uint32_t>(n);
+        stats_.bytes += static_cast<uint64_t>(n);
+    } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        c.closing = true;
+    }
+
+    if (drain(slot) && c.closing) close_slot(slot);
+}
+
+/* ==================== PARSING ==================== */
+
+/**
+ * Parse buffered data in place
+ * Returns false when backpressure stopped it (the slot is then paused)
+ */
+bool Gateway::drain(uint32_t slot) {
+    Connection& c = conns_[slot];
+    const uint8_t* buf = c.buffer.get();
+    TelemetryRecord record;
+
+    while (c.begin < c.end) {
+        if (pipeline_.pending(slot) >= config_.high_watermark) {
+            pause(slot);
+            return false;
+        }
+
+        const uint8_t* p = buf + c.begin;
+        size_t avail = c.end - c.begin;
+
+        // Binary telemetry frame
+        if (p[0] == LINK_SYNC0) {
+            if (avail < 2) break;
+            if (p[1] == LINK_SYNC1) {
+                size_t consumed = 0;
+                FrameStatus status = parse_record_frame(p, avail, record, consumed);
+                if (status == FRAME_INCOMPLETE) break;
+                if (status == FRAME_RECORD) {
+                    if (!emit(slot, record)) return false;
+                    c.begin += static_cast<uint32_t>(consumed);
+                    continue;
+                }
+                if (status == FRAME_OTHER) {
+                    stats_.frames_other++;
+                    c.begin += static_cast<uint32_t>(consumed);
+                    continue;
+                }
+                // FRAME_INVALID: just text that happens to contain the sync bytes
+            }
+        }
+
+        // Text line
+        const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(p, '\n', avail));
+        if (!nl) break;
+
+        std::string_view line(reinterpret_cast<const char*>(p), static_cast<size_t>(nl - p));
+        std::string_view name;
+        switch (parse_record_line(line, record, name)) {
+            case PARSE_RECORD:
+                if (!emit(slot, record)) return false;
+                break;
+            case PARSE_DEVICE:
+                set_device_name(c.device, name.data(), name.size());
+                break;
+            case PARSE_IGNORED:
+                stats_.lines_ignored++;
+                break;
+            case PARSE_ERROR:
+                stats_.parse_errors++;
+                break;
+        }
+        c.begin += static_cast<uint32_t>(line.size() + 1);
+    }
+
+    if (c.begin == c.end) c.begin = c.end = 0;
+    return true;
+}
+
+bool Gateway::emit(uint32_t slot, TelemetryRecord& record) {
+    const Connection& c = conns_[slot];
+    record.timestamp_us = now_us_;
+    record.slot = slot;
+    std::memcpy(record.device, c.device, DEVICE_NAME_MAX);
+
+    if (!pipeline_.push(record)) {
+        pause(slot);  // Pipeline full: retry this record once it drains
+        return false;
+    }
+    stats_.records++;
+    return true;
+}
+
+/* ==================== BACKPRESSURE ==================== */
+
+void Gateway::pause(uint32_t slot) {
+    Connection& c = conns_[slot];
+    if (c.paused) return;
+
+    // Out of epoll entirely: no wakeups, and the kernel buffer fills up
+    // until TCP flow control stalls this device's bridge
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c.fd, nullptr);
+    c.paused = true;
+    paused_.push_back(slot);
+    stats_.pauses++;
+}
+
+void Gateway::resume_ready() {
+    std::vector<uint32_t> waiting;
+    waiting.swap(paused_);
+
+    for (uint32_t slot : waiting) {
+        Connection& c = conns_[slot];
+        if (pipeline_.pending(slot) > config_.low_watermark) {
+            paused_.push_back(slot);
+            continue;
+        }
+
+        // Finish what is already buffered before reading more;
+        // if that hits the watermark again, drain() re-pauses the slot
+        c.paused = false;
+        if (!drain(slot)) continue;
+
+        if (c.closing) {
+            close_slot(slot);
+            continue;
+        }
+
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = slot;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    // Closed slots become reusable once the sinks released their records
+    std::vector<uint32_t> retired;
+    for (uint32_t slot : retired_) {
+        if (pipeline_.pending(slot) == 0) {
+            free_slots_.push_back(slot);
+        } else {
+            retired.push_back(slot);
+        }
+    }
+    retired_.swap(retired);
+}
+
+void Gateway::close_slot(uint32_t slot) {
+    Connection& c = conns_[slot];
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c.fd, nullptr);  // ENOENT if it was paused
+    close(c.fd);
+    c.fd = -1;
+    c.paused = false;
+    stats_.connections_open--;
+
+    // Records of this slot may still be queued: reuse it only when they are done
+    if (pipeline_.pending(slot) == 0) {
+        free_slots_.push_back(slot);
+    } else {
+        retired_.push_back(slot);
+    }
+}
+
+/* ==================== STATS ==================== */
+
+void Gateway::print_stats(uint64_t now_us) {
+    double seconds = (now_us - last_stats_us_) / 1e6;
+    stats_.paused_now = static_cast<uint32_t>(paused_.size());
+
+    printf("[gateway] devices %u | %.1fk rec/s | %.2f MB/s | paused %u (pauses %llu) | "
+           "queued %zu | ignored %llu | errors %llu\n",
+           stats_.connections_open,
+           (stats_.records - last_stats_.records) / seconds / 1000.0,
+           (stats_.bytes - last_stats_.bytes) / seconds / 1e6,
+           stats_.paused_now,
+           static_cast<unsigned long long>(stats_.pauses),
+           pipeline_.queued(),
+           static_cast<unsigned long long>(stats_.lines_ignored),
+           static_cast<unsigned long long>(stats_.parse_errors));
+    fflush(stdout);
+
+    last_stats_ = stats_;
+    last_stats_us_ = now_us;
+}
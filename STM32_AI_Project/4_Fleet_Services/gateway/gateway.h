@@ -0,0 +1,102 @@
+/*
+ * Fleet Telemetry Gateway
+ * Single-threaded epoll server for thousands of serial-to-TCP bridges
+ *
+ * Each connection is one device. Received bytes stay in the connection's
+ * buffer and are parsed in place; only the small fixed-size records go to
+ * the sink pipeline. When a device has too many records in flight (sinks
+ * slower than the device) or the pipeline is full, the gateway stops
+ * reading that socket, so TCP flow control pushes back on that bridge
+ * alone while every other device keeps streaming.
+ */
+
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "record_sinks.h"
+#include "telemetry_record.h"
+
+struct GatewayConfig {
+    uint16_t port = 7000;
+    uint32_t max_devices = 16384;
+    uint32_t buffer_size = 16 * 1024;   // Per-connection receive buffer
+    uint32_t high_watermark = 1024;     // Records in flight before a device is paused
+    uint32_t low_watermark = 256;       // ...and resumed
+    uint32_t stats_interval_ms = 1000;  // 0 = no periodic stats
+};
+
+struct GatewayStats {
+    uint64_t connections_total = 0;
+    uint32_t connections_open = 0;
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+    uint64_t lines_ignored = 0;
+    uint64_t parse_errors = 0;
+    uint64_t frames_other = 0;
+    uint64_t pauses = 0;
+    uint32_t paused_now = 0;
+};
+
+class Gateway {
+public:
+    /**
+     * notify_fd: eventfd the pipeline writes after each batch (wakes paused devices)
+     */
+    Gateway(const GatewayConfig& config, SinkPipeline& pipeline, int notify_fd);
+    ~Gateway();
+
+    /**
+     * Bind and listen; returns false (errno set) on failure
+     */
+    bool listen();
+
+    /**
+     * Event loop; returns when stop becomes true
+     */
+    void run(const std::atomic<bool>& stop);
+
+    const GatewayStats& stats() const { return stats_; }
+
+private:
+    struct Connection {
+        int fd = -1;
+        char device[DEVICE_NAME_MAX] = {};
+        std::unique_ptr<uint8_t[]> buffer;
+        uint32_t begin = 0;             // First unparsed byte
+        uint32_t end = 0;               // End of received data
+        bool paused = false;            // Removed from epoll by backpressure
+        bool closing = false;           // Peer closed; parse what is left, then close
+    };
+
+    void accept_all();
+    void on_readable(uint32_t slot);
+    bool drain(uint32_t slot);
+    bool emit(uint32_t slot, TelemetryRecord& record);
+    void pause(uint32_t slot);
+    void resume_ready();
+    void close_slot(uint32_t slot);
+    void print_stats(uint64_t now_us);
+
+    GatewayConfig config_;
+    SinkPipeline& pipeline_;
+    int notify_fd_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+
+    std::vector<Connection> conns_;
+    std::vector<uint32_t> free_slots_;
+    std::vector<uint32_t> paused_;      // Slots waiting for their records to drain
+    std::vector<uint32_t> retired_;     // Closed slots with records still in flight
+
+    uint64_t now_us_ = 0;               // Receive timestamp for this loop iteration
+    uint64_t last_stats_us_ = 0;
+    GatewayStats stats_;
+    GatewayStats last_stats_;
+};
+
+#endif // GATEWAY_H
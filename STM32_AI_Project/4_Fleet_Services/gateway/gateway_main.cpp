@@ -0,0 +1,182 @@
+/*
+ * Fleet Telemetry Gateway - entry point
+ *
+ * Build (from 4_Fleet_Services/):
+ *   cc -O2 -c ../3_STM32_CubeIDE_Template/Core/Src/crc32.c \
+ *       ../3_STM32_CubeIDE_Template/Core/Src/link_protocol.c \
+ *       -I../3_STM32_CubeIDE_Template/Core/Inc
+ *   c++ -std=c++17 -O2 -pthread -I../3_STM32_CubeIDE_Template/Core/Inc -Istore \
+ *       gateway/gateway_main.cpp gateway/gateway.cpp gateway/record_parser.cpp \
+ *       gateway/record_sinks.cpp store/metric_store.cpp store/column_codec.cpp \
+ *       crc32.o link_protocol.o -o fleet_gateway
+ *
+ * Run:
+ *   ./fleet_gateway --port 7000 --metrics metrics.fms --max-devices 16384
+ */
+
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "gateway.h"
+#include "record_sinks.h"
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+
+void on_signal(int) {
+    g_stop.store(true);
+}
+
+void usage(const char* argv0) {
+    printf("Usage: %s [options]\n"
+           "  --port N            TCP port (default 7000)\n"
+           "  --store PATH        Append records to CSV file (default: none)\n"
+           "  --metrics PATH      Append records to a columnar metric store (default: none)\n"
+           "  --no-alerts         Do not print fire alerts\n"
+           "  --alert-holdoff MS  Minimum time between alerts per device (default 10000)\n"
+           "  --max-devices N     Connection slots (default 16384)\n"
+           "  --high N            Records in flight before a device is paused (default 1024)\n"
+           "  --low N             Records in flight before it is resumed (default 256)\n"
+           "  --ring N            Sink ring capacity in records (default 262144)\n",
+           argv0);
+}
+
+/**
+ * Allow one descriptor per device plus headroom
+ */
+void raise_fd_limit(uint32_t wanted) {
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) != 0) return;
+    if (lim.rlim_cur >= wanted) return;
+
+    lim.rlim_cur = lim.rlim_max == RLIM_INFINITY || lim.rlim_max >= wanted ? wanted : lim.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &lim) != 0 || lim.rlim_cur < wanted) {
+        printf("⚠ File descriptor limit %llu < %u: not all devices can connect\n",
+               static_cast<unsigned long long>(lim.rlim_cur), wanted);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    GatewayConfig config;
+    std::string store_path;
+    std::string metrics_path;
+    bool alerts = true;
+    uint32_t alert_holdoff_ms = 10000;
+    size_t ring_capacity = 256 * 1024;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--port" && has_value) {
+            config.port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "--store" && has_value) {
+            store_path = argv[++i];
+        } else if (arg == "--metrics" && has_value) {
+            metrics_path = argv[++i];
+        } else if (arg == "--no-alerts") {
+            alerts = false;
+        } else if (arg == "--alert-holdoff" && has_value) {
+            alert_holdoff_ms = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (arg == "--max-devices" && has_value) {
+            config.max_devices = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (arg == "--high" && has_value) {
+            config.high_watermark = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (arg == "--low" && has_value) {
+            config.low_watermark = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (arg == "--ring" && has_value) {
+            ring_capacity = static_cast<size_t>(atol(argv[++i]));
+        } else {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (config.max_devices == 0 || config.low_watermark >= config.high_watermark) {
+        printf("⚠ Need --max-devices > 0 and --low < --high\n");
+        return 1;
+    }
+
+    printf("============================================================\n");
+    printf("Fleet Telemetry Gateway\n");
+    printf("============================================================\n");
+    printf("Port: %u | Max devices: %u | Watermarks: %u/%u | Ring: %zu\n",
+           config.port, config.max_devices, config.low_watermark, config.high_watermark,
+           ring_capacity);
+
+    raise_fd_limit(config.max_devices + 64);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    int notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (notify_fd < 0) {
+        perror("eventfd");
+        return 1;
+    }
+
+    SinkPipeline pipeline(ring_capacity, config.max_devices, notify_fd);
+
+    std::unique_ptr<CsvStoreSink> store;
+    if (!store_path.empty()) {
+        store.reset(new CsvStoreSink(store_path));
+        if (!store->ok()) {
+            perror(store_path.c_str());
+            return 1;
+        }
+        pipeline.add_sink(store.get());
+        printf("✓ Storing records in %s\n", store_path.c_str());
+    }
+
+    std::unique_ptr<MetricStoreSink> metrics;
+    if (!metrics_path.empty()) {
+        metrics.reset(new MetricStoreSink(metrics_path, 1024, 60));
+        if (!metrics->ok()) {
+            perror(metrics_path.c_str());
+            return 1;
+        }
+        pipeline.add_sink(metrics.get());
+        printf("✓ Storing metrics in %s\n", metrics_path.c_str());
+    }
+
+    std::unique_ptr<AlertSink> alert_sink;
+    if (alerts) {
+        alert_sink.reset(new AlertSink(stdout, alert_holdoff_ms));
+        pipeline.add_sink(alert_sink.get());
+    }
+
+    Gateway gateway(config, pipeline, notify_fd);
+    if (!gateway.listen()) {
+        perror("listen");
+        return 1;
+    }
+    printf("✓ Listening on port %u\n", config.port);
+
+    pipeline.start();
+    gateway.run(g_stop);
+    pipeline.stop();
+
+    const GatewayStats& s = gateway.stats();
+    printf("\n============================================================\n");
+    printf("Connections:   %llu\n", static_cast<unsigned long long>(s.connections_total));
+    printf("Bytes:         %llu\n", static_cast<unsigned long long>(s.bytes));
+    printf("Records:       %llu (stored %llu)\n", static_cast<unsigned long long>(s.records),
+           static_cast<unsigned long long>(pipeline.consumed()));
+    printf("Pauses:        %llu\n", static_cast<unsigned long long>(s.pauses));
+    printf("Parse errors:  %llu\n", static_cast<unsigned long long>(s.parse_errors));
+    if (alert_sink) {
+        printf("Alerts:        %llu\n", static_cast<unsigned long long>(alert_sink->alerts()));
+    }
+    printf("============================================================\n");
+    return 0;
+}
@@ -0,0 +1,338 @@
+/*
+ * Fleet Load Generator
+ * Emulates N devices streaming inference telemetry to the gateway
+ *
+ * Each emulated device opens one TCP connection, announces itself with
+ * "@device sim-NNNNN" and then sends the same lines the firmware prints
+ * ("[frame] Confidence: ...", "FIRE ALERT (Total: N)"), optionally mixed
+ * with binary LINK_MSG_TELEMETRY frames. Writes that would block are
+ * counted: that is the gateway's backpressure as seen by a device.
+ *
+ * Build (from 4_Fleet_Services/, after compiling crc32.o and link_protocol.o):
+ *   c++ -std=c++17 -O2 -pthread -I../3_STM32_CubeIDE_Template/Core/Inc \
+ *       gateway/load_generator.cpp crc32.o link_protocol.o -o fleet_loadgen
+ *
+ * Run:
+ *   ./fleet_loadgen --devices 2000 --rate 30 --duration 10
+ *   ./fleet_loadgen --devices 100 --rate 0 --binary 0.5    # as fast as possible
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "link_protocol.h"
+
+namespace {
+
+constexpr size_t SEND_BUFFER = 8 * 1024;
+constexpr int MAX_EVENTS = 512;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    uint16_t port = 7000;
+    uint32_t devices = 1000;
+    double rate = 30.0;         // Records per second per device (0 = unlimited)
+    double duration = 10.0;     // Seconds
+    double binary = 0.0;        // Fraction of records sent as binary frames
+    uint32_t fire_every = 200;  // One fire episode start per N frames
+};
+
+struct Device {
+    int fd = -1;
+    bool connected = false;
+    bool blocked = false;       // Waiting for EPOLLOUT
+    uint32_t frame = 0;
+    uint32_t alerts = 0;
+    uint32_t fire_left = 0;     // Frames remaining in the current fire episode
+    uint64_t records = 0;
+    uint8_t seq = 0;
+    uint32_t rng;
+    size_t len = 0;
+    size_t sent = 0;
+    char buf[SEND_BUFFER];
+};
+
+uint64_t mono_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000u + ts.tv_nsec / 1000;
+}
+
+uint32_t xorshift(uint32_t& s) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+/**
+ * Append one record (text line or binary frame); false if the buffer is full
+ */
+bool append_record(Device& d, const Options& opt) {
+    if (SEND_BUFFER - d.len < 128 + LINK_FRAME_OVERHEAD) return false;
+
+    if (d.fire_left == 0 && xorshift(d.rng) % opt.fire_every == 0) d.fire_left = 20;
+    bool fire = d.fire_left > 0;
+    if (fire) d.fire_left--;
+
+    float confidence = fire ? 0.75f + (xorshift(d.rng) % 2400) / 10000.0f
+                            : (xorshift(d.rng) % 4000) / 10000.0f;
+    uint32_t inference_ms = 30 + xorshift(d.rng) % 12;
+    d.frame++;
+
+    if ((xorshift(d.rng) % 1000) < opt.binary * 1000.0) {
+        uint8_t payload[LINK_TELEMETRY_LENGTH];
+        uint32_t bits;
+        std::memcpy(&bits, &confidence, sizeof(bits));
+        link_put_u32(payload, d.frame);
+        link_put_u32(payload + 4, bits);
+        link_put_u32(payload + 8, inference_ms);
+        payload[12] = fire ? 1 : 0;
+        payload[13] = fire ? (confidence > 0.9f ? 2 : 1) : 0;
+        d.len += link_encode(LINK_MSG_TELEMETRY, d.seq++, payload, LINK_TELEMETRY_LENGTH,
+                             reinterpret_cast<uint8_t*>(d.buf + d.len));
+    } else {
+        d.len += snprintf(d.buf + d.len, SEND_BUFFER - d.len,
+                          "[%u] Confidence: %.2f%% | Time: %ums | Status: %s\r\n",
+                          d.frame, confidence * 100.0f, inference_ms, fire ? "FIRE" : "SAFE");
+        if (fire && d.fire_left == 0) {
+            d.alerts++;
+            d.len += snprintf(d.buf + d.len, SEND_BUFFER - d.len,
+                              "  ⚠ FIRE ALERT (Total: %u)\r\n", d.alerts);
+        }
+    }
+    d.records++;
+    return true;
+}
+
+struct Totals {
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+    uint64_t blocked = 0;
+    uint64_t failed = 0;
+};
+
+/**
+ * Write pending bytes; switch to EPOLLOUT when the socket is full
+ */
+void flush_device(Device& d, uint32_t index, int epoll_fd, Totals& totals) {
+    while (d.sent < d.len) {
+        ssize_t n = send(d.fd, d.buf + d.sent, d.len - d.sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            d.sent += static_cast<size_t>(n);
+            totals.bytes += static_cast<uint64_t>(n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!d.blocked) {
+                d.blocked = true;
+                totals.blocked++;
+                epoll_event ev = {};
+                ev.events = EPOLLOUT;
+                ev.data.u32 = index;
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, d.fd, &ev);
+            }
+            return;
+        }
+        if (n < 0 && errno == EINTR) continue;
+
+        // Gateway closed us (e.g. at capacity)
+        totals.failed++;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, d.fd, nullptr);
+        close(d.fd);
+        d.fd = -1;
+        return;
+    }
+    d.len = d.sent = 0;
+}
+
+void usage(const char* argv0) {
+    printf("Usage: %s [--host IP] [--port N] [--devices N] [--rate R] [--duration S]\n"
+           "          [--binary FRACTION] [--fire-every N]\n"
+           "  --rate 0 sends as fast as the gateway accepts\n",
+           argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--host" && has_value) {
+            opt.host = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            opt.port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "--devices" && has_value) {
+            opt.devices = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (arg == "--rate" && has_value) {
+            opt.rate = atof(argv[++i]);
+        } else if (arg == "--duration" && has_value) {
+            opt.duration = atof(argv[++i]);
+        } else if (arg == "--binary" && has_value) {
+            opt.binary = atof(argv[++i]);
+        } else if (arg == "--fire-every" && has_value) {
+            opt.fire_every = static_cast<uint32_t>(atoi(argv[++i]));
+        } else {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (opt.fire_every == 0) opt.fire_every = 1;
+
+    printf("============================================================\n");
+    printf("Fleet Load Generator\n");
+    printf("============================================================\n");
+    char rate[32];
+    snprintf(rate, sizeof(rate), opt.rate > 0 ? "%.1f/s per device" : "max", opt.rate);
+    printf("Target: %s:%u | Devices: %u | Rate: %s | Binary: %.0f%%\n", opt.host.c_str(),
+           opt.port, opt.devices, rate, opt.binary * 100.0);
+
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < opt.devices + 64) {
+        lim.rlim_cur = std::min<rlim_t>(lim.rlim_max, opt.devices + 64);
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    if (inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr) != 1) {
+        printf("⚠ Bad host address: %s\n", opt.host.c_str());
+        return 1;
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Device> devices(opt.devices);
+    Totals totals;
+
+    // Connect everyone (non-blocking; completion shows up as EPOLLOUT)
+    for (uint32_t i = 0; i < opt.devices; i++) {
+        Device& d = devices[i];
+        d.rng = 0x9E3779B9u ^ (i * 2654435761u) ^ 1u;
+        d.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (d.fd < 0) {
+            totals.failed++;
+            continue;
+        }
+        if (connect(d.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 &&
+            errno != EINPROGRESS) {
+            totals.failed++;
+            close(d.fd);
+            d.fd = -1;
+            continue;
+        }
+        epoll_event ev = {};
+        ev.events = EPOLLOUT;
+        ev.data.u32 = i;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, d.fd, &ev);
+        d.blocked = true;
+        d.len = snprintf(d.buf, SEND_BUFFER, "@device sim-%05u\n", i);
+    }
+
+    epoll_event events[MAX_EVENTS];
+    uint64_t start = mono_us();
+    uint64_t end = start + static_cast<uint64_t>(opt.duration * 1e6);
+    uint64_t last_report = start;
+    Totals last;
+    uint32_t connected = 0;
+
+    for (uint64_t now = start; now < end; now = mono_us()) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, opt.rate > 0 ? 5 : 1);
+        for (int i = 0; i < n; i++) {
+            uint32_t index = events[i].data.u32;
+            Device& d = devices[index];
+            if (d.fd < 0) continue;
+
+            if (!d.connected) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(d.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    totals.failed++;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, d.fd, nullptr);
+                    close(d.fd);
+                    d.fd = -1;
+                    continue;
+                }
+                d.connected = true;
+                connected++;
+            }
+
+            // Writable again: stop watching until the next EAGAIN
+            d.blocked = false;
+            epoll_event ev = {};
+            ev.data.u32 = index;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, d.fd, &ev);
+            flush_device(d, index, epoll_fd, totals);
+        }
+
+        // Generate what each device owes by now
+        double elapsed = (now - start) / 1e6;
+        for (uint32_t i = 0; i < opt.devices; i++) {
+            Device& d = devices[i];
+            if (d.fd < 0 || !d.connected || d.blocked) continue;
+
+            if (opt.rate > 0) {
+                uint64_t due = static_cast<uint64_t>(elapsed * opt.rate);
+                while (d.records < due && append_record(d, opt)) {}
+            } else {
+                while (append_record(d, opt)) {}
+            }
+            if (d.len > d.sent) flush_device(d, i, epoll_fd, totals);
+        }
+
+        if (now - last_report >= 1000000) {
+            totals.records = 0;
+            for (const Device& d : devices) totals.records += d.records;
+            double seconds = (now - last_report) / 1e6;
+            printf("[loadgen] connected %u | %.1fk rec/s | %.2f MB/s | blocked writes %llu | failed %llu\n",
+                   connected, (totals.records - last.records) / seconds / 1000.0,
+                   (totals.bytes - last.bytes) / seconds / 1e6,
+                   static_cast<unsigned long long>(totals.blocked - last.blocked),
+                   static_cast<unsigned long long>(totals.failed));
+            fflush(stdout);
+            last = totals;
+            last_report = now;
+        }
+    }
+
+    // Records still in user-space buffers were never sent
+    totals.records = 0;
+    uint64_t unsent = 0;
+    for (Device& d : devices) {
+        totals.records += d.records;
+        if (d.len > d.sent) unsent += d.len - d.sent;
+        if (d.fd >= 0) close(d.fd);
+    }
+    close(epoll_fd);
+
+    double seconds = (mono_us() - start) / 1e6;
+    printf("\n============================================================\n");
+    printf("Devices connected: %u / %u\n", connected, opt.devices);
+    printf("Records generated: %llu (%.1fk/s)\n", static_cast<unsigned long long>(totals.records),
+           totals.records / seconds / 1000.0);
+    printf("Bytes sent:        %llu (%.2f MB/s, %llu unsent)\n",
+           static_cast<unsigned long long>(totals.bytes), totals.bytes / seconds / 1e6,
+           static_cast<unsigned long long>(unsent));
+    printf("Blocked writes:    %llu\n", static_cast<unsigned long long>(totals.blocked));
+    printf("============================================================\n");
+    return 0;
+}
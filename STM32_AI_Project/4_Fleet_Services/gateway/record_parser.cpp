@@ -0,0 +1,131 @@
+/*
+ * Telemetry Records
+ * Zero-copy parsers for device log lines and binary telemetry frames
+ */
+
+#include "telemetry_record.h"
+
+#include <charconv>
+#include <cstring>
+
+#include "crc32.h"
+#include "link_protocol.h"
+
+namespace {
+
+/**
+ * Forward-only reader over a line
+ */
+struct Cursor {
+    const char* p;
+    const char* end;
+
+    bool literal(std::string_view s) {
+        if (static_cast<size_t>(end - p) < s.size() || std::memcmp(p, s.data(), s.size()) != 0) {
+            return false;
+        }
+        p += s.size();
+        return true;
+    }
+
+    template <typename T>
+    bool number(T& value) {
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) return false;
+        p = result.ptr;
+        return true;
+    }
+
+    std::string_view rest() const { return std::string_view(p, end - p); }
+};
+
+constexpr std::string_view DEVICE_PREFIX = "@device ";
+constexpr std::string_view ALERT_MARKER = "FIRE ALERT (Total: ";
+
+ParseStatus parse_inference(Cursor c, TelemetryRecord& out) {
+    // [1234] Confidence: 87.50% | Time: 35ms | Status: FIRE
+    float percent;
+    if (!c.number(out.frame) || !c.literal("] Confidence: ") || !c.number(percent) ||
+        !c.literal("% | Time: ") || !c.number(out.inference_ms) || !c.literal("ms | Status: ")) {
+        return PARSE_ERROR;
+    }
+
+    std::string_view status = c.rest();
+    if (status == "FIRE") {
+        out.fire = 1;
+    } else if (status == "SAFE") {
+        out.fire = 0;
+    } else {
+        return PARSE_ERROR;
+    }
+
+    out.kind = RECORD_INFERENCE;
+    out.confidence = percent / 100.0f;
+    out.alert_level = out.fire ? alert_level_for(out.confidence) : 0;
+    out.alert_total = 0;
+    out.binary = 0;
+    return PARSE_RECORD;
+}
+
+}  // namespace
+
+ParseStatus parse_record_line(std::string_view line, TelemetryRecord& out,
+                              std::string_view& device_name) {
+    // Serial bridges often pass CRLF through
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+    if (!line.empty() && line.front() == '[') {
+        return parse_inference(Cursor{line.data() + 1, line.data() + line.size()}, out);
+    }
+
+    if (line.substr(0, DEVICE_PREFIX.size()) == DEVICE_PREFIX) {
+        device_name = line.substr(DEVICE_PREFIX.size());
+        return device_name.empty() ? PARSE_ERROR : PARSE_DEVICE;
+    }
+
+    size_t marker = line.find(ALERT_MARKER);
+    if (marker != std::string_view::npos) {
+        Cursor c{line.data() + marker + ALERT_MARKER.size(), line.data() + line.size()};
+        if (!c.number(out.alert_total) || !c.literal(")")) return PARSE_ERROR;
+
+        out.kind = RECORD_ALERT;
+        out.frame = 0;
+        out.confidence = 0.0f;
+        out.inference_ms = 0;
+        out.fire = 1;
+        out.alert_level = 1;
+        out.binary = 0;
+        return PARSE_RECORD;
+    }
+
+    return PARSE_IGNORED;
+}
+
+FrameStatus parse_record_frame(const uint8_t* data, size_t size, TelemetryRecord& out,
+                               size_t& consumed) {
+    if (size < 6) return FRAME_INCOMPLETE;
+
+    uint16_t length = link_get_u16(data + 4);
+    if (length > LINK_MAX_PAYLOAD) return FRAME_INVALID;
+    if (size < length + static_cast<size_t>(LINK_FRAME_OVERHEAD)) return FRAME_INCOMPLETE;
+
+    // CRC over type | seq | length | payload, which are contiguous here
+    if (crc32_update(0, data + 2, 4u + length) != link_get_u32(data + 6 + length)) {
+        return FRAME_INVALID;
+    }
+    consumed = length + LINK_FRAME_OVERHEAD;
+
+    const uint8_t* p = data + 6;
+    if (data[2] != LINK_MSG_TELEMETRY || length != LINK_TELEMETRY_LENGTH) return FRAME_OTHER;
+
+    uint32_t confidence_bits = link_get_u32(p + 4);
+    out.kind = RECORD_INFERENCE;
+    out.frame = link_get_u32(p);
+    std::memcpy(&out.confidence, &confidence_bits, sizeof(out.confidence));
+    out.inference_ms = link_get_u32(p + 8);
+    out.fire = p[12] ? 1 : 0;
+    out.alert_level = p[13];
+    out.alert_total = 0;
+    out.binary = 1;
+    return FRAME_RECORD;
+}
@@ -0,0 +1,178 @@
+/*
+ * Record Sinks
+ * CSV store, alert sink and the SPSC pipeline feeding them
+ */
+
+#include "record_sinks.h"
+
+#include <chrono>
+#include <ctime>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t BATCH_SIZE = 256;
+
+size_t round_up_pow2(size_t v) {
+    size_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+}  // namespace
+
+/* ==================== SINKS ==================== */
+
+CsvStoreSink::CsvStoreSink(const std::string& path)
+    : file_(fopen(path.c_str(), "a")), buffer_(1 << 20) {
+    // Large stdio buffer: one write() per MB instead of per record
+    if (file_) setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+}
+
+CsvStoreSink::~CsvStoreSink() {
+    if (file_) fclose(file_);
+}
+
+void CsvStoreSink::consume(const TelemetryRecord* records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const TelemetryRecord& r = records[i];
+        if (r.kind != RECORD_INFERENCE) continue;
+        fprintf(file_, "%llu,%s,%u,%.4f,%u,%u,%u\n",
+                static_cast<unsigned long long>(r.timestamp_us), r.device, r.frame,
+                r.confidence, r.inference_ms, r.fire, r.alert_level);
+    }
+}
+
+void CsvStoreSink::idle() {
+    fflush(file_);
+}
+
+AlertSink::AlertSink(FILE* out, uint32_t holdoff_ms)
+    : out_(out), holdoff_us_(static_cast<uint64_t>(holdoff_ms) * 1000) {}
+
+void AlertSink::consume(const TelemetryRecord* records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const TelemetryRecord& r = records[i];
+        if (!r.fire || (r.kind == RECORD_INFERENCE && r.alert_level == 0)) continue;
+
+        // A burning device reports every frame: one alert per hold-off
+        uint64_t& last = last_alert_us_[r.device];
+        if (last && r.timestamp_us - last < holdoff_us_) continue;
+        last = r.timestamp_us;
+        alerts_++;
+
+        if (r.kind == RECORD_ALERT) {
+            fprintf(out_, "⚠ FIRE ALERT %s (device total: %u)\n", r.device, r.alert_total);
+        } else {
+            fprintf(out_, "⚠ FIRE ALERT %s frame %u confidence %.1f%% level %u\n",
+                    r.device, r.frame, r.confidence * 100.0f, r.alert_level);
+        }
+    }
+}
+
+MetricStoreSink::MetricStoreSink(const std::string& path, uint32_t block_rows,
+                                 uint32_t max_block_age_s)
+    : writer_(path, block_rows), max_age_us_(static_cast<uint64_t>(max_block_age_s) * 1000000) {}
+
+void MetricStoreSink::consume(const TelemetryRecord* records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const TelemetryRecord& r = records[i];
+        if (r.kind != RECORD_INFERENCE) continue;
+
+        MetricRow row = {r.timestamp_us, r.frame, r.confidence, r.inference_ms, r.alert_level,
+                         static_cast<uint8_t>((r.fire ? METRIC_FLAG_FIRE : 0) |
+                                              (r.binary ? METRIC_FLAG_BINARY : 0))};
+        writer_.append(r.device, row);
+    }
+}
+
+void MetricStoreSink::idle() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t now_us = static_cast<uint64_t>(ts.tv_sec) * 1000000u + ts.tv_nsec / 1000;
+
+    // Walking every open block is O(devices): once a second is plenty
+    if (now_us - last_seal_us_ < 1000000) return;
+    last_seal_us_ = now_us;
+    writer_.seal_older_than(now_us, max_age_us_);
+}
+
+/* ==================== PIPELINE ==================== */
+
+SinkPipeline::SinkPipeline(size_t capacity, uint32_t max_slots, int notify_fd)
+    : ring_(round_up_pow2(capacity)),
+      mask_(ring_.size() - 1),
+      pending_(new std::atomic<uint32_t>[max_slots]),
+      notify_fd_(notify_fd) {
+    for (uint32_t i = 0; i < max_slots; i++) pending_[i].store(0, std::memory_order_relaxed);
+}
+
+SinkPipeline::~SinkPipeline() {
+    stop();
+}
+
+void SinkPipeline::start() {
+    running_.store(true);
+    thread_ = std::thread(&SinkPipeline::run, this);
+}
+
+void SinkPipeline::stop() {
+    if (!thread_.joinable()) return;
+    running_.store(false);
+    wake_.notify_one();
+    thread_.join();
+}
+
+bool SinkPipeline::push(const TelemetryRecord& record) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == ring_.size()) return false;
+
+    ring_[head & mask_] = record;
+    pending_[record.slot].fetch_add(1, std::memory_order_relaxed);
+    head_.store(head + 1, std::memory_order_release);
+
+    if (sleeping_.load(std::memory_order_acquire)) wake_.notify_one();
+    return true;
+}
+
+void SinkPipeline::run() {
+    std::vector<TelemetryRecord> batch(BATCH_SIZE);
+
+    while (true) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t available = head_.load(std::memory_order_acquire) - tail;
+
+        if (available == 0) {
+            for (RecordSink* sink : sinks_) sink->idle();
+            if (!running_.load()) break;
+
+            // Short timed wait: a missed notify costs at most one millisecond
+            std::unique_lock<std::mutex> lock(mutex_);
+            sleeping_.store(true, std::memory_order_release);
+            if (head_.load(std::memory_order_acquire) == tail) {
+                wake_.wait_for(lock, std::chrono::milliseconds(1));
+            }
+            sleeping_.store(false, std::memory_order_release);
+            continue;
+        }
+
+        // Copy out so the slots can be reused while sinks work
+        size_t n = available < BATCH_SIZE ? available : BATCH_SIZE;
+        for (size_t i = 0; i < n; i++) batch[i] = ring_[(tail + i) & mask_];
+        tail_.store(tail + n, std::memory_order_release);
+
+        for (RecordSink* sink : sinks_) sink->consume(batch.data(), n);
+
+        // Only now are the records really handled: release the devices' budget
+        for (size_t i = 0; i < n; i++) {
+            pending_[batch[i].slot].fetch_sub(1, std::memory_order_release);
+        }
+        consumed_.fetch_add(n, std::memory_order_relaxed);
+
+        if (notify_fd_ >= 0) {
+            uint64_t one = 1;
+            ssize_t ignored = write(notify_fd_, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+}
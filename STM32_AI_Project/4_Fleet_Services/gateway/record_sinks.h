@@ -0,0 +1,149 @@
+/*
+ * Record Sinks
+ * Fan-out of parsed telemetry to storage and alerting, off the I/O thread
+ *
+ * The I/O thread pushes records into a bounded single-producer /
+ * single-consumer ring; a sink thread drains it in batches and hands
+ * each batch to every sink. Per-slot pending counters let the gateway
+ * throttle devices whose records are not being consumed fast enough.
+ */
+
+#ifndef RECORD_SINKS_H
+#define RECORD_SINKS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "metric_store.h"
+#include "telemetry_record.h"
+
+class RecordSink {
+public:
+    virtual ~RecordSink() = default;
+
+    /**
+     * Called on the sink thread with records in arrival order
+     */
+    virtual void consume(const TelemetryRecord* records, size_t count) = 0;
+
+    /**
+     * Called on the sink thread when the ring is empty (flush buffers)
+     */
+    virtual void idle() {}
+};
+
+/* ==================== SINKS ==================== */
+
+/**
+ * Append-only CSV log: timestamp_us,device,frame,confidence,inference_ms,fire,alert_level
+ */
+class CsvStoreSink : public RecordSink {
+public:
+    explicit CsvStoreSink(const std::string& path);
+    ~CsvStoreSink() override;
+
+    bool ok() const { return file_ != nullptr; }
+    void consume(const TelemetryRecord* records, size_t count) override;
+    void idle() override;
+
+private:
+    FILE* file_;
+    std::vector<char> buffer_;
+};
+
+/**
+ * Fire alerts, at most one per device per hold-off period
+ */
+class AlertSink : public RecordSink {
+public:
+    AlertSink(FILE* out, uint32_t holdoff_ms);
+
+    void consume(const TelemetryRecord* records, size_t count) override;
+    void idle() override { fflush(out_); }
+
+    uint64_t alerts() const { return alerts_; }
+
+private:
+    FILE* out_;
+    uint64_t holdoff_us_;
+    std::unordered_map<std::string, uint64_t> last_alert_us_;
+    uint64_t alerts_ = 0;
+};
+
+/**
+ * Columnar metric store (store/metric_store.h); inference records only
+ */
+class MetricStoreSink : public RecordSink {
+public:
+    /**
+     * max_block_age_s: seal a device's partial block after this long,
+     * so slow devices' rows reach the file without waiting for a full block
+     */
+    MetricStoreSink(const std::string& path, uint32_t block_rows, uint32_t max_block_age_s);
+
+    bool ok() const { return writer_.ok(); }
+    void consume(const TelemetryRecord* records, size_t count) override;
+    void idle() override;
+
+private:
+    MetricStoreWriter writer_;
+    uint64_t max_age_us_;
+    uint64_t last_seal_us_ = 0;
+};
+
+/* ==================== PIPELINE ==================== */
+
+class SinkPipeline {
+public:
+    /**
+     * capacity: ring size in records (rounded up to a power of two)
+     * max_slots: number of gateway connection slots to track
+     * notify_fd: eventfd written after each consumed batch (-1 = none)
+     */
+    SinkPipeline(size_t capacity, uint32_t max_slots, int notify_fd);
+    ~SinkPipeline();
+
+    void add_sink(RecordSink* sink) { sinks_.push_back(sink); }
+    void start();
+    void stop();  // Drains the ring, then joins
+
+    /**
+     * Producer side (I/O thread only). Returns false when the ring is full.
+     */
+    bool push(const TelemetryRecord& record);
+
+    uint32_t pending(uint32_t slot) const { return pending_[slot].load(std::memory_order_acquire); }
+    size_t queued() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    uint64_t consumed() const { return consumed_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    std::vector<TelemetryRecord> ring_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};   // Written by the producer
+    alignas(64) std::atomic<size_t> tail_{0};   // Written by the consumer
+    alignas(64) std::atomic<uint64_t> consumed_{0};
+
+    std::unique_ptr<std::atomic<uint32_t>[]> pending_;
+    std::vector<RecordSink*> sinks_;
+    int notify_fd_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> sleeping_{false};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+};
+
+#endif // RECORD_SINKS_H
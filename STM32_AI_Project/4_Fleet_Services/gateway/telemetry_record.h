@@ -0,0 +1,78 @@
+/*
+ * Telemetry Records
+ * What the fleet gateway extracts from a device's serial stream
+ *
+ * Devices print one line per frame (main.c):
+ *   [1234] Confidence: 87.50% | Time: 35ms | Status: FIRE
+ *     ⚠ FIRE ALERT (Total: 12)
+ * and may send binary LINK_MSG_TELEMETRY frames (link_protocol.h) on the
+ * same stream. A bridge may announce the board with "@device <name>".
+ *
+ * Parsing works on views into the connection's receive buffer: no line
+ * is copied or allocated.
+ */
+
+#ifndef TELEMETRY_RECORD_H
+#define TELEMETRY_RECORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum RecordKind : uint8_t {
+    RECORD_INFERENCE = 1,   // One inference result
+    RECORD_ALERT = 2        // Fire alert line (alert_total set)
+};
+
+constexpr size_t DEVICE_NAME_MAX = 16;
+
+struct TelemetryRecord {
+    uint64_t timestamp_us;          // Gateway receive time (Unix, microseconds)
+    char device[DEVICE_NAME_MAX];   // NUL-terminated
+    uint32_t slot;                  // Gateway connection slot (backpressure accounting)
+    uint32_t frame;
+    float confidence;               // 0-1
+    uint32_t inference_ms;
+    uint32_t alert_total;
+    uint8_t kind;
+    uint8_t fire;
+    uint8_t alert_level;            // 0 none, 1 fire, 2 high confidence
+    uint8_t binary;                 // Came from a LINK_MSG_TELEMETRY frame
+};
+
+enum ParseStatus {
+    PARSE_RECORD,       // out holds a record
+    PARSE_DEVICE,       // "@device <name>" line, name in device_name
+    PARSE_IGNORED,      // Other log output (banners, update messages...)
+    PARSE_ERROR         // Looked like a record but did not parse
+};
+
+/**
+ * Parse one text line (without the trailing newline)
+ * Only the numeric fields of out are written.
+ */
+ParseStatus parse_record_line(std::string_view line, TelemetryRecord& out,
+                              std::string_view& device_name);
+
+enum FrameStatus {
+    FRAME_RECORD,       // out holds a record, consumed bytes used
+    FRAME_OTHER,        // Valid frame of another type (e.g. update replies), skip it
+    FRAME_INCOMPLETE,   // Need more bytes
+    FRAME_INVALID       // Not a frame here (bad length / CRC): treat the sync as text
+};
+
+/**
+ * Decode a link frame starting at data[0] (which holds the sync bytes)
+ */
+FrameStatus parse_record_frame(const uint8_t* data, size_t size, TelemetryRecord& out,
+                               size_t& consumed);
+
+/**
+ * Same rule as process_detection_output() with the default thresholds:
+ * >0.7 fire, >0.9 high alert (sites may tune theirs, detection_config.h)
+ */
+inline uint8_t alert_level_for(float confidence) {
+    return confidence > 0.9f ? 2 : (confidence > 0.7f ? 1 : 0);
+}
+
+#endif // TELEMETRY_RECORD_H
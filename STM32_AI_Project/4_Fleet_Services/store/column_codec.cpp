@@ -0,0 +1,260 @@
+/*
+ * Column Codecs
+ * Delta-of-delta integers, XOR floats and byte runs
+ */
+
+#include "column_codec.h"
+
+#include <cstring>
+
+namespace {
+
+inline uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+inline uint32_t float_bits(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+// Delta-of-delta buckets: prefix '0', '10', '110', '1110', '1111'
+constexpr uint32_t BUCKET_BITS[] = {7, 12, 20};
+
+}  // namespace
+
+/* ==================== BIT STREAMS ==================== */
+
+void BitWriter::write(uint64_t value, uint32_t bits) {
+    if (bits > 32) {
+        write(value >> 32, bits - 32);
+        bits = 32;
+    }
+    if (bits == 0) return;
+
+    acc_ = (acc_ << bits) | (value & ((1ull << bits) - 1));
+    used_ += bits;
+    while (used_ >= 8) {
+        bytes_.push_back(static_cast<uint8_t>(acc_ >> (used_ - 8)));
+        used_ -= 8;
+    }
+}
+
+std::vector<uint8_t>& BitWriter::finish() {
+    if (used_ > 0) {
+        bytes_.push_back(static_cast<uint8_t>(acc_ << (8 - used_)));
+        used_ = 0;
+    }
+    return bytes_;
+}
+
+void BitWriter::clear() {
+    bytes_.clear();
+    acc_ = 0;
+    used_ = 0;
+}
+
+void BitReader::refill() {
+    while (avail_ <= 56) {
+        uint64_t byte = pos_ < size_ ? data_[pos_++] : 0;
+        acc_ |= byte << (56 - avail_);
+        avail_ += 8;
+    }
+}
+
+uint64_t BitReader::read(uint32_t bits) {
+    if (bits > 32) {
+        uint64_t high = read(bits - 32);
+        return (high << 32) | read(32);
+    }
+    if (bits == 0) return 0;
+    if (avail_ < bits) refill();
+
+    uint64_t v = acc_ >> (64 - bits);
+    acc_ <<= bits;
+    avail_ -= bits;
+    return v;
+}
+
+/* ==================== INTEGERS ==================== */
+
+void IntColumnEncoder::append(uint64_t value) {
+    if (count_++ == 0) {
+        bits_.write(value, 64);
+        prev_ = value;
+        return;
+    }
+
+    int64_t delta = static_cast<int64_t>(value - prev_);
+    int64_t residual = dod_ ? delta - prev_delta_ : delta;
+    prev_ = value;
+    prev_delta_ = delta;
+
+    if (residual == 0) {
+        bits_.write_bit(false);
+        return;
+    }
+    uint64_t z = zigzag(residual);
+    for (uint32_t i = 0; i < 3; i++) {
+        if (z < (1ull << BUCKET_BITS[i])) {
+            bits_.write((1u << (i + 1)) - 1, i + 1);  // i+1 ones...
+            bits_.write_bit(false);                   // ...then a zero
+            bits_.write(z, BUCKET_BITS[i]);
+            return;
+        }
+    }
+    bits_.write(0xF, 4);
+    bits_.write(z, 64);
+}
+
+void IntColumnEncoder::reset() {
+    count_ = 0;
+    prev_ = 0;
+    prev_delta_ = 0;
+    bits_.clear();
+}
+
+uint64_t IntColumnDecoder::next() {
+    if (count_++ == 0) {
+        prev_ = bits_.read(64);
+        return prev_;
+    }
+
+    int64_t residual = 0;
+    if (bits_.read_bit()) {
+        uint32_t bucket = 1;
+        while (bucket < 4 && bits_.read_bit()) bucket++;
+        uint64_t z = bits_.read(bucket < 4 ? BUCKET_BITS[bucket - 1] : 64);
+        residual = unzigzag(z);
+    }
+
+    int64_t delta = dod_ ? prev_delta_ + residual : residual;
+    prev_ += static_cast<uint64_t>(delta);
+    prev_delta_ = delta;
+    return prev_;
+}
+
+/* ==================== FLOATS ==================== */
+
+void FloatColumnEncoder::append(float value) {
+    uint32_t v = float_bits(value);
+    if (count_++ == 0) {
+        bits_.write(v, 32);
+        prev_ = v;
+        leading_ = 33;  // No window yet
+        return;
+    }
+
+    uint32_t x = v ^ prev_;
+    prev_ = v;
+    if (x == 0) {
+        bits_.write_bit(false);
+        return;
+    }
+    bits_.write_bit(true);
+
+    uint32_t lead = static_cast<uint32_t>(__builtin_clz(x));
+    uint32_t trail = static_cast<uint32_t>(__builtin_ctz(x));
+    if (lead > 31) lead = 31;
+
+    if (lead >= leading_ && trail >= trailing_) {
+        // Fits the previous window: only the meaningful bits
+        bits_.write_bit(false);
+        bits_.write(x >> trailing_, 32 - leading_ - trailing_);
+        return;
+    }
+
+    uint32_t len = 32 - lead - trail;
+    bits_.write_bit(true);
+    bits_.write(lead, 5);
+    bits_.write(len - 1, 5);
+    bits_.write(x >> trail, len);
+    leading_ = lead;
+    trailing_ = trail;
+}
+
+void FloatColumnEncoder::reset() {
+    count_ = 0;
+    prev_ = 0;
+    leading_ = 0;
+    trailing_ = 0;
+    bits_.clear();
+}
+
+float FloatColumnDecoder::next() {
+    if (count_++ == 0) {
+        prev_ = static_cast<uint32_t>(bits_.read(32));
+    } else if (bits_.read_bit()) {
+        if (bits_.read_bit()) {
+            leading_ = static_cast<uint32_t>(bits_.read(5));
+            uint32_t len = static_cast<uint32_t>(bits_.read(5)) + 1;
+            trailing_ = 32 - leading_ - len;
+        }
+        uint32_t x = static_cast<uint32_t>(bits_.read(32 - leading_ - trailing_)) << trailing_;
+        prev_ ^= x;
+    }
+
+    float f;
+    std::memcpy(&f, &prev_, sizeof(f));
+    return f;
+}
+
+/* ==================== BYTE RUNS ==================== */
+
+void ByteRunEncoder::append(uint8_t value) {
+    if (run_ && value == value_) {
+        run_++;
+        return;
+    }
+    finish();
+    value_ = value;
+    run_ = 1;
+}
+
+std::vector<uint8_t>& ByteRunEncoder::finish() {
+    if (run_) {
+        bytes_.push_back(value_);
+        uint32_t r = run_;
+        while (r >= 0x80) {
+            bytes_.push_back(static_cast<uint8_t>(r | 0x80));
+            r >>= 7;
+        }
+        bytes_.push_back(static_cast<uint8_t>(r));
+        run_ = 0;
+    }
+    return bytes_;
+}
+
+void ByteRunEncoder::reset() {
+    bytes_.clear();
+    value_ = 0;
+    run_ = 0;
+}
+
+bool decode_byte_runs(const uint8_t* data, size_t size, uint8_t* out, uint32_t count) {
+    size_t pos = 0;
+    uint32_t filled = 0;
+
+    while (filled < count) {
+        if (pos >= size) return false;
+        uint8_t value = data[pos++];
+
+        uint32_t run = 0;
+        for (uint32_t shift = 0;; shift += 7) {
+            if (pos >= size || shift > 28) return false;
+            uint8_t b = data[pos++];
+            run |= static_cast<uint32_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+        }
+        if (run > count - filled) return false;
+
+        std::memset(out + filled, value, run);
+        filled += run;
+    }
+    return true;
+}
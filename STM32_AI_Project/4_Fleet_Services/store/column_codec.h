@@ -0,0 +1,148 @@
+/*
+ * Column Codecs
+ * Bit-level encoders for the metric store's columns
+ *
+ * - IntColumnEncoder: delta or delta-of-delta with variable-width buckets
+ *   (timestamps and frame ids: regular series cost ~1 bit per row)
+ * - FloatColumnEncoder: XOR with the previous value, reusing the previous
+ *   leading/trailing-zero window (confidences that barely change are cheap)
+ * - ByteRunEncoder: run-length bytes (alert level and flags: mostly zero)
+ *
+ * All encoders append to a caller-owned byte vector and are streamed one
+ * value at a time, so an open block never holds raw rows.
+ */
+
+#ifndef COLUMN_CODEC_H
+#define COLUMN_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* ==================== BIT STREAMS ==================== */
+
+class BitWriter {
+public:
+    void write(uint64_t value, uint32_t bits);
+    void write_bit(bool bit) { write(bit ? 1u : 0u, 1); }
+
+    /**
+     * Pad the last byte and return the encoded bytes
+     */
+    std::vector<uint8_t>& finish();
+
+    size_t size_bytes() const { return bytes_.size() + (used_ + 7) / 8; }
+    void clear();
+
+private:
+    std::vector<uint8_t> bytes_;
+    uint64_t acc_ = 0;      // Pending bits, MSB first
+    uint32_t used_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint64_t read(uint32_t bits);
+    bool read_bit() { return read(1) != 0; }
+
+private:
+    void refill();
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    uint64_t acc_ = 0;      // Buffered bits, MSB aligned
+    uint32_t avail_ = 0;
+};
+
+/* ==================== ENCODERS ==================== */
+
+class IntColumnEncoder {
+public:
+    /**
+     * delta_of_delta: true for regular series (timestamps, frame ids),
+     *                 false for values that jitter around a level (latency)
+     */
+    explicit IntColumnEncoder(bool delta_of_delta) : dod_(delta_of_delta) {}
+
+    void append(uint64_t value);
+    BitWriter& bits() { return bits_; }
+    void reset();
+
+private:
+    bool dod_;
+    uint32_t count_ = 0;
+    uint64_t prev_ = 0;
+    int64_t prev_delta_ = 0;
+    BitWriter bits_;
+};
+
+class IntColumnDecoder {
+public:
+    IntColumnDecoder(const uint8_t* data, size_t size, bool delta_of_delta)
+        : bits_(data, size), dod_(delta_of_delta) {}
+
+    uint64_t next();
+
+private:
+    BitReader bits_;
+    bool dod_;
+    uint32_t count_ = 0;
+    uint64_t prev_ = 0;
+    int64_t prev_delta_ = 0;
+};
+
+class FloatColumnEncoder {
+public:
+    void append(float value);
+    BitWriter& bits() { return bits_; }
+    void reset();
+
+private:
+    uint32_t count_ = 0;
+    uint32_t prev_ = 0;
+    uint32_t leading_ = 0;
+    uint32_t trailing_ = 0;
+    BitWriter bits_;
+};
+
+class FloatColumnDecoder {
+public:
+    FloatColumnDecoder(const uint8_t* data, size_t size) : bits_(data, size) {}
+
+    float next();
+
+private:
+    BitReader bits_;
+    uint32_t count_ = 0;
+    uint32_t prev_ = 0;
+    uint32_t leading_ = 0;
+    uint32_t trailing_ = 0;
+};
+
+class ByteRunEncoder {
+public:
+    void append(uint8_t value);
+
+    /**
+     * Emit the open run and return the encoded bytes
+     */
+    std::vector<uint8_t>& finish();
+    size_t size_bytes() const { return bytes_.size() + (run_ ? 6 : 0); }
+    void reset();
+
+private:
+    std::vector<uint8_t> bytes_;
+    uint8_t value_ = 0;
+    uint32_t run_ = 0;
+};
+
+/**
+ * Expand runs into out[0..count)
+ * Returns false if the data is short or malformed
+ */
+bool decode_byte_runs(const uint8_t* data, size_t size, uint8_t* out, uint32_t count);
+
+#endif // COLUMN_CODEC_H
@@ -0,0 +1,313 @@
+/*
+ * Fleet Metric Store
+ * Block writer with crash recovery, mmap reader
+ */
+
+#include "metric_store.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cfloat>
+#include <cstring>
+
+#include "crc32.h"
+
+namespace {
+
+/**
+ * CRC over a block's column bytes, in column order
+ */
+uint32_t block_crc(const uint8_t* columns, uint32_t size) {
+    return crc32_update(0, columns, size);
+}
+
+}  // namespace
+
+/* ==================== INDEX ==================== */
+
+bool store_load_index(const uint8_t* data, size_t size, bool verify_crc,
+                      std::vector<IndexEntry>& out, uint64_t& data_end) {
+    out.clear();
+
+    // Clean close: trailer points at an index that ends exactly at the trailer
+    if (size >= sizeof(FileHeader) + sizeof(IndexTrailer)) {
+        IndexTrailer trailer;
+        std::memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+        uint64_t index_bytes = static_cast<uint64_t>(trailer.blocks) * sizeof(IndexEntry);
+        if (trailer.magic == STORE_INDEX_MAGIC && trailer.index_offset >= sizeof(FileHeader) &&
+            trailer.index_offset + index_bytes + sizeof(trailer) == size) {
+            out.resize(trailer.blocks);
+            std::memcpy(out.data(), data + trailer.index_offset, index_bytes);
+            data_end = trailer.index_offset;
+            return true;
+        }
+    }
+
+    // Live or crashed store: walk the blocks
+    uint64_t offset = sizeof(FileHeader);
+    while (offset + sizeof(BlockHeader) <= size) {
+        IndexEntry entry;
+        entry.offset = offset;
+        std::memcpy(&entry.header, data + offset, sizeof(BlockHeader));
+
+        const BlockHeader& h = entry.header;
+        uint64_t end = offset + sizeof(BlockHeader) + h.size;
+        if (h.magic != STORE_BLOCK_MAGIC || end > size) break;
+        if (verify_crc && block_crc(data + offset + sizeof(BlockHeader), h.size) != h.crc) break;
+
+        out.push_back(entry);
+        offset = end;
+    }
+    data_end = offset;
+    return false;
+}
+
+/* ==================== WRITER ==================== */
+
+MetricStoreWriter::MetricStoreWriter(const std::string& path, uint32_t block_rows)
+    : buffer_(1 << 20), block_rows_(block_rows ? block_rows : 1024) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return;
+    }
+
+    if (st.st_size == 0) {
+        FileHeader fh = {STORE_FILE_MAGIC, STORE_VERSION, 0, block_rows_, 0};
+        if (write(fd, &fh, sizeof(fh)) != static_cast<ssize_t>(sizeof(fh))) {
+            ::close(fd);
+            return;
+        }
+        offset_ = sizeof(fh);
+    } else {
+        size_t size = static_cast<size_t>(st.st_size);
+        void* map = size >= sizeof(FileHeader) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                                               : MAP_FAILED;
+        if (map == MAP_FAILED) {
+            ::close(fd);
+            return;
+        }
+
+        const uint8_t* data = static_cast<const uint8_t*>(map);
+        FileHeader fh;
+        std::memcpy(&fh, data, sizeof(fh));
+        if (fh.magic != STORE_FILE_MAGIC || fh.version != STORE_VERSION) {
+            munmap(map, size);
+            ::close(fd);
+            return;
+        }
+
+        // Keep the blocks, drop the index (rewritten on close) or a torn tail
+        store_load_index(data, size, true, index_, offset_);
+        munmap(map, size);
+        if (ftruncate(fd, static_cast<off_t>(offset_)) != 0) {
+            ::close(fd);
+            return;
+        }
+    }
+
+    file_ = fdopen(fd, "r+b");
+    if (!file_) {
+        ::close(fd);
+        return;
+    }
+    setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+    fseeko(file_, static_cast<off_t>(offset_), SEEK_SET);
+}
+
+MetricStoreWriter::~MetricStoreWriter() {
+    close();
+}
+
+void MetricStoreWriter::start_block(OpenBlock& b, std::string_view device) {
+    BlockHeader& h = b.header;
+    std::memset(&h, 0, sizeof(h));
+    h.magic = STORE_BLOCK_MAGIC;
+    std::memcpy(h.device, device.data(), device.size() < STORE_DEVICE_MAX ? device.size()
+                                                                          : STORE_DEVICE_MAX - 1);
+    h.ts_min = UINT64_MAX;
+    h.frame_min = UINT32_MAX;
+    h.confidence_min = FLT_MAX;
+    h.confidence_max = -FLT_MAX;
+    h.latency_min = UINT32_MAX;
+}
+
+void MetricStoreWriter::append(std::string_view device, const MetricRow& row) {
+    if (!file_) return;
+
+    std::unique_ptr<OpenBlock>& slot = open_[std::string(device)];
+    if (!slot) slot.reset(new OpenBlock());
+    OpenBlock& b = *slot;
+    BlockHeader& h = b.header;
+    if (h.count == 0) {
+        start_block(b, device);
+        b.opened_us = row.timestamp_us;
+    }
+
+    uint8_t flags = row.flags;
+    if (b.has_frame && row.frame > b.last_frame + 1) flags |= METRIC_FLAG_GAP;
+    b.last_frame = row.frame;
+    b.has_frame = true;
+
+    b.timestamps.append(row.timestamp_us);
+    b.frames.append(row.frame);
+    b.confidence.append(row.confidence);
+    b.latency.append(row.latency_ms);
+    b.level_flags.append(static_cast<uint8_t>((row.alert_level & 0x03) | (flags << 2)));
+
+    if (row.timestamp_us < h.ts_min) h.ts_min = row.timestamp_us;
+    if (row.timestamp_us > h.ts_max) h.ts_max = row.timestamp_us;
+    if (row.frame < h.frame_min) h.frame_min = row.frame;
+    if (row.frame > h.frame_max) h.frame_max = row.frame;
+    if (row.confidence < h.confidence_min) h.confidence_min = row.confidence;
+    if (row.confidence > h.confidence_max) h.confidence_max = row.confidence;
+    if (row.latency_ms < h.latency_min) h.latency_min = row.latency_ms;
+    if (row.latency_ms > h.latency_max) h.latency_max = row.latency_ms;
+    if (row.alert_level > 0) h.alerts++;
+    if (row.alert_level > h.level_max) h.level_max = row.alert_level;
+    h.flags_any |= flags;
+    h.count++;
+    rows_++;
+
+    if (h.count == block_rows_) seal(b);
+}
+
+void MetricStoreWriter::seal(OpenBlock& b) {
+    BlockHeader& h = b.header;
+    if (h.count == 0) return;
+
+    const std::vector<uint8_t>* columns[COL_COUNT] = {
+        &b.timestamps.bits().finish(),
+        &b.frames.bits().finish(),
+        &b.confidence.bits().finish(),
+        &b.latency.bits().finish(),
+        &b.level_flags.finish(),
+    };
+
+    h.size = 0;
+    h.crc = 0;
+    for (int i = 0; i < COL_COUNT; i++) {
+        h.column_size[i] = static_cast<uint32_t>(columns[i]->size());
+        h.size += h.column_size[i];
+        h.crc = crc32_update(h.crc, columns[i]->data(), h.column_size[i]);
+    }
+
+    fwrite(&h, sizeof(h), 1, file_);
+    for (int i = 0; i < COL_COUNT; i++) fwrite(columns[i]->data(), 1, columns[i]->size(), file_);
+
+    index_.push_back(IndexEntry{offset_, h});
+    offset_ += sizeof(h) + h.size;
+
+    b.timestamps.reset();
+    b.frames.reset();
+    b.confidence.reset();
+    b.latency.reset();
+    b.level_flags.reset();
+    h.count = 0;
+}
+
+void MetricStoreWriter::seal_older_than(uint64_t now_us, uint64_t max_age_us) {
+    for (auto& entry : open_) {
+        OpenBlock& b = *entry.second;
+        if (b.header.count > 0 && now_us - b.opened_us >= max_age_us) seal(b);
+    }
+}
+
+void MetricStoreWriter::close() {
+    if (!file_) return;
+
+    for (auto& entry : open_) seal(*entry.second);
+    open_.clear();
+
+    IndexTrailer trailer = {STORE_INDEX_MAGIC, static_cast<uint32_t>(index_.size()), offset_};
+    fwrite(index_.data(), sizeof(IndexEntry), index_.size(), file_);
+    fwrite(&trailer, sizeof(trailer), 1, file_);
+    fclose(file_);
+    file_ = nullptr;
+}
+
+/* ==================== READER ==================== */
+
+MetricStoreReader::~MetricStoreReader() {
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+bool MetricStoreReader::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    data_ = static_cast<const uint8_t*>(map);
+
+    FileHeader fh;
+    std::memcpy(&fh, data_, sizeof(fh));
+    if (fh.magic != STORE_FILE_MAGIC || fh.version != STORE_VERSION) return false;
+
+    uint64_t data_end;
+    had_index_ = store_load_index(data_, size_, false, index_, data_end);
+    return true;
+}
+
+bool MetricStoreReader::decode(const IndexEntry& block, uint32_t mask, BlockColumns& out) const {
+    const BlockHeader& h = block.header;
+    if (block.offset + sizeof(BlockHeader) + h.size > size_) return false;
+
+    const uint8_t* col[COL_COUNT];
+    const uint8_t* p = data_ + block.offset + sizeof(BlockHeader);
+    uint64_t total = 0;
+    for (int i = 0; i < COL_COUNT; i++) {
+        col[i] = p + total;
+        total += h.column_size[i];
+    }
+    if (total != h.size) return false;
+
+    uint32_t n = h.count;
+    if (mask & (1u << COL_TIMESTAMP)) {
+        out.timestamp_us.resize(n);
+        IntColumnDecoder d(col[COL_TIMESTAMP], h.column_size[COL_TIMESTAMP], true);
+        for (uint32_t i = 0; i < n; i++) out.timestamp_us[i] = d.next();
+    }
+    if (mask & (1u << COL_FRAME)) {
+        out.frame.resize(n);
+        IntColumnDecoder d(col[COL_FRAME], h.column_size[COL_FRAME], true);
+        for (uint32_t i = 0; i < n; i++) out.frame[i] = static_cast<uint32_t>(d.next());
+    }
+    if (mask & (1u << COL_CONFIDENCE)) {
+        out.confidence.resize(n);
+        FloatColumnDecoder d(col[COL_CONFIDENCE], h.column_size[COL_CONFIDENCE]);
+        for (uint32_t i = 0; i < n; i++) out.confidence[i] = d.next();
+    }
+    if (mask & (1u << COL_LATENCY)) {
+        out.latency_ms.resize(n);
+        IntColumnDecoder d(col[COL_LATENCY], h.column_size[COL_LATENCY], false);
+        for (uint32_t i = 0; i < n; i++) out.latency_ms[i] = static_cast<uint32_t>(d.next());
+    }
+    if (mask & (1u << COL_LEVEL_FLAGS)) {
+        out.level_flags.resize(n);
+        if (!decode_byte_runs(col[COL_LEVEL_FLAGS], h.column_size[COL_LEVEL_FLAGS],
+                              out.level_flags.data(), n)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MetricStoreReader::verify(const IndexEntry& block) const {
+    const BlockHeader& h = block.header;
+    if (block.offset + sizeof(BlockHeader) + h.size > size_) return false;
+    return block_crc(data_ + block.offset + sizeof(BlockHeader), h.size) == h.crc;
+}
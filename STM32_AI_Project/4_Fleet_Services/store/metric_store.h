@@ -0,0 +1,221 @@
+/*
+ * Fleet Metric Store
+ * Append-only columnar storage for per-frame device metrics
+ *
+ * File layout:
+ *   FileHeader | block | block | ... | index | IndexTrailer
+ *
+ * A block holds up to block_rows consecutive rows of ONE device, encoded
+ * column by column (see column_codec.h), behind a BlockHeader carrying
+ * min/max statistics. Queries check those statistics first and only
+ * decode the columns they need from blocks that can match.
+ *
+ * The index (a copy of every BlockHeader with its file offset) is written
+ * on close. A file without one - a live store, or a crash - is indexed by
+ * walking the blocks, so readers never depend on a clean shutdown.
+ */
+
+#ifndef METRIC_STORE_H
+#define METRIC_STORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "column_codec.h"
+
+#define STORE_FILE_MAGIC    0x31534D46u  // "FMS1"
+#define STORE_BLOCK_MAGIC   0x31424D46u  // "FMB1"
+#define STORE_INDEX_MAGIC   0x31494D46u  // "FMI1"
+#define STORE_VERSION       1
+#define STORE_DEVICE_MAX    16
+
+// Row flags (stored with the alert level: level | flags << 2)
+#define METRIC_FLAG_FIRE    0x01
+#define METRIC_FLAG_BINARY  0x02        // Arrived as a binary telemetry frame
+#define METRIC_FLAG_GAP     0x04        // Device skipped frames before this one
+
+enum StoreColumn {
+    COL_TIMESTAMP = 0,
+    COL_FRAME,
+    COL_CONFIDENCE,
+    COL_LATENCY,
+    COL_LEVEL_FLAGS,
+    COL_COUNT
+};
+
+struct MetricRow {
+    uint64_t timestamp_us;
+    uint32_t frame;
+    float confidence;
+    uint32_t latency_ms;
+    uint8_t alert_level;
+    uint8_t flags;
+};
+
+struct FileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t block_rows;
+    uint32_t reserved2;
+};
+
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t size;                      // Column bytes following the header
+    char device[STORE_DEVICE_MAX];
+    uint32_t count;
+    uint32_t crc;                       // CRC-32 of the column bytes
+    uint64_t ts_min;
+    uint64_t ts_max;
+    uint32_t frame_min;
+    uint32_t frame_max;
+    float confidence_min;
+    float confidence_max;
+    uint32_t latency_min;
+    uint32_t latency_max;
+    uint32_t alerts;                    // Rows with alert_level > 0
+    uint8_t level_max;
+    uint8_t flags_any;                  // OR of all row flags
+    uint16_t reserved;
+    uint32_t column_size[COL_COUNT];
+};
+
+struct IndexEntry {
+    uint64_t offset;                    // Of the BlockHeader
+    BlockHeader header;
+};
+
+struct IndexTrailer {
+    uint32_t magic;
+    uint32_t blocks;
+    uint64_t index_offset;
+};
+
+static_assert(sizeof(FileHeader) == 16, "FileHeader layout");
+static_assert(sizeof(BlockHeader) == 104, "BlockHeader layout");
+static_assert(sizeof(IndexTrailer) == 16, "IndexTrailer layout");
+
+/* ==================== WRITER ==================== */
+
+class MetricStoreWriter {
+public:
+    /**
+     * Opens (or creates) path for appending
+     * An existing index is dropped and rewritten on close; a torn tail
+     * from a crash is truncated to the last valid block.
+     */
+    explicit MetricStoreWriter(const std::string& path, uint32_t block_rows = 1024);
+    ~MetricStoreWriter();
+
+    bool ok() const { return file_ != nullptr; }
+
+    /**
+     * Append one row; sets METRIC_FLAG_GAP when the frame id jumps
+     */
+    void append(std::string_view device, const MetricRow& row);
+
+    /**
+     * Seal open blocks whose first row is older than max_age_us
+     * (keeps slow devices' rows from sitting in memory indefinitely)
+     */
+    void seal_older_than(uint64_t now_us, uint64_t max_age_us);
+
+    /**
+     * Seal every open block and write the index
+     */
+    void close();
+
+    uint64_t rows() const { return rows_; }
+    uint64_t blocks() const { return index_.size(); }
+
+private:
+    struct OpenBlock {
+        OpenBlock() : timestamps(true), frames(true), latency(false) {}
+
+        IntColumnEncoder timestamps;
+        IntColumnEncoder frames;
+        FloatColumnEncoder confidence;
+        IntColumnEncoder latency;
+        ByteRunEncoder level_flags;
+        BlockHeader header = {};
+        uint64_t opened_us = 0;         // Timestamp of the block's first row
+        uint32_t last_frame = 0;
+        bool has_frame = false;
+    };
+
+    void start_block(OpenBlock& b, std::string_view device);
+    void seal(OpenBlock& b);
+
+    FILE* file_ = nullptr;
+    std::vector<char> buffer_;
+    uint32_t block_rows_;
+    uint64_t offset_ = 0;
+    uint64_t rows_ = 0;
+    std::unordered_map<std::string, std::unique_ptr<OpenBlock>> open_;
+    std::vector<IndexEntry> index_;
+};
+
+/* ==================== READER ==================== */
+
+/**
+ * Decoded columns of one block (only the requested ones are filled)
+ */
+struct BlockColumns {
+    std::vector<uint64_t> timestamp_us;
+    std::vector<uint32_t> frame;
+    std::vector<float> confidence;
+    std::vector<uint32_t> latency_ms;
+    std::vector<uint8_t> level_flags;
+};
+
+class MetricStoreReader {
+public:
+    MetricStoreReader() = default;
+    ~MetricStoreReader();
+    MetricStoreReader(const MetricStoreReader&) = delete;
+    MetricStoreReader& operator=(const MetricStoreReader&) = delete;
+
+    /**
+     * mmap the file and load (or rebuild) the block index
+     */
+    bool open(const std::string& path);
+
+    const std::vector<IndexEntry>& blocks() const { return index_; }
+    size_t file_size() const { return size_; }
+    bool had_index() const { return had_index_; }
+
+    /**
+     * Decode the columns in mask (bit per StoreColumn) of one block
+     * The CRC is not checked here (see verify); malformed data decodes
+     * to garbage values but never reads outside the block.
+     */
+    bool decode(const IndexEntry& block, uint32_t mask, BlockColumns& out) const;
+
+    /**
+     * Check a block's CRC
+     */
+    bool verify(const IndexEntry& block) const;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool had_index_ = false;
+    std::vector<IndexEntry> index_;
+};
+
+/**
+ * Load the index of a mapped store file, or rebuild it by walking the
+ * blocks (stopping at the first invalid one; verify_crc also checks data)
+ * data_end receives the offset just past the last valid block.
+ * Returns true if a written index was found.
+ */
+bool store_load_index(const uint8_t* data, size_t size, bool verify_crc,
+                      std::vector<IndexEntry>& out, uint64_t& data_end);
+
+#endif // METRIC_STORE_H
@@ -0,0 +1,420 @@
+/*
+ * Fleet Metric Store - query tool
+ *
+ * Build (from 4_Fleet_Services/, after compiling crc32.o):
+ *   c++ -std=c++17 -O2 -I../3_STM32_CubeIDE_Template/Core/Inc -Istore \
+ *       store/query_main.cpp store/metric_store.cpp store/column_codec.cpp \
+ *       crc32.o -o fleet_query
+ *
+ * Usage:
+ *   ./fleet_query info    metrics.fms
+ *   ./fleet_query latency metrics.fms [--device NAME] [--last SECONDS] [--limit N]
+ *   ./fleet_query alerts  metrics.fms [--min-level 1|2] [--from US] [--to US]
+ *   ./fleet_query scan    metrics.fms --device NAME [--limit N]
+ *   ./fleet_query import  metrics.fms telemetry.csv
+ *   ./fleet_query verify  metrics.fms
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "metric_store.h"
+
+namespace {
+
+struct Query {
+    std::string command;
+    std::string path;
+    std::string csv;
+    std::string device;
+    uint64_t from_us = 0;
+    uint64_t to_us = UINT64_MAX;
+    double last_s = 0.0;
+    uint32_t min_level = 1;
+    size_t limit = 0;               // 0 = command default
+    uint32_t block_rows = 1024;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Block-level pruning against the device and time filters
+ * Returns 0 = skip, 1 = partially inside (check timestamps), 2 = fully inside
+ */
+int block_match(const BlockHeader& h, const Query& q) {
+    if (!q.device.empty() && q.device != h.device) return 0;
+    if (h.ts_max < q.from_us || h.ts_min > q.to_us) return 0;
+    return (h.ts_min >= q.from_us && h.ts_max <= q.to_us) ? 2 : 1;
+}
+
+/**
+ * Resolve --last against the newest row in the store
+ */
+void resolve_last(const MetricStoreReader& store, Query& q) {
+    if (q.last_s <= 0.0) return;
+    uint64_t newest = 0;
+    for (const IndexEntry& b : store.blocks()) newest = std::max(newest, b.header.ts_max);
+    uint64_t span = static_cast<uint64_t>(q.last_s * 1e6);
+    q.from_us = newest > span ? newest - span : 0;
+}
+
+/* ==================== COMMANDS ==================== */
+
+int cmd_info(const MetricStoreReader& store) {
+    uint64_t rows = 0;
+    uint64_t column_bytes[COL_COUNT] = {};
+    uint64_t ts_min = UINT64_MAX, ts_max = 0;
+    std::unordered_map<std::string, uint64_t> devices;
+
+    for (const IndexEntry& b : store.blocks()) {
+        const BlockHeader& h = b.header;
+        rows += h.count;
+        for (int i = 0; i < COL_COUNT; i++) column_bytes[i] += h.column_size[i];
+        ts_min = std::min(ts_min, h.ts_min);
+        ts_max = std::max(ts_max, h.ts_max);
+        devices[h.device] += h.count;
+    }
+
+    static const char* names[COL_COUNT] = {"timestamp", "frame", "confidence", "latency", "level+flags"};
+    printf("Blocks:     %zu (%s)\n", store.blocks().size(),
+           store.had_index() ? "index" : "no index - rebuilt by scanning");
+    printf("Rows:       %" PRIu64 "\n", rows);
+    printf("Devices:    %zu\n", devices.size());
+    if (rows) {
+        printf("Time span:  %.1f s\n", (ts_max - ts_min) / 1e6);
+        printf("File size:  %.2f MB (%.2f bytes/row, raw %zu)\n", store.file_size() / 1e6,
+               static_cast<double>(store.file_size()) / rows, sizeof(MetricRow));
+        for (int i = 0; i < COL_COUNT; i++) {
+            printf("  %-12s %.3f bits/row\n", names[i], column_bytes[i] * 8.0 / rows);
+        }
+    }
+    return 0;
+}
+
+struct LatencyStats {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    std::vector<uint32_t> histogram;    // Index = latency in ms
+
+    uint32_t percentile(double p) const {
+        uint64_t rank = static_cast<uint64_t>(p * count + 0.999999);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (size_t ms = 0; ms < histogram.size(); ms++) {
+            seen += histogram[ms];
+            if (seen >= rank) return static_cast<uint32_t>(ms);
+        }
+        return static_cast<uint32_t>(histogram.size() - 1);
+    }
+};
+
+int cmd_latency(const MetricStoreReader& store, const Query& q) {
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_map<std::string, LatencyStats> devices;
+    BlockColumns cols;
+    size_t scanned = 0;
+
+    for (const IndexEntry& b : store.blocks()) {
+        const BlockHeader& h = b.header;
+        int match = block_match(h, q);
+        if (match == 0) continue;
+
+        uint32_t mask = 1u << COL_LATENCY;
+        if (match == 1) mask |= 1u << COL_TIMESTAMP;
+        if (!store.decode(b, mask, cols)) continue;
+        scanned++;
+
+        LatencyStats& s = devices[h.device];
+        if (s.histogram.size() <= h.latency_max) s.histogram.resize(h.latency_max + 1);
+        for (uint32_t i = 0; i < h.count; i++) {
+            if (match == 1 && (cols.timestamp_us[i] < q.from_us || cols.timestamp_us[i] > q.to_us)) {
+                continue;
+            }
+            uint32_t ms = std::min(cols.latency_ms[i], h.latency_max);  // Corrupt data stays in bounds
+            s.histogram[ms]++;
+            s.sum += ms;
+            s.count++;
+        }
+    }
+
+    struct Row {
+        const std::string* device;
+        const LatencyStats* stats;
+        uint32_t p99;
+    };
+    std::vector<Row> rows;
+    LatencyStats fleet;
+    for (const auto& d : devices) {
+        if (d.second.count == 0) continue;
+        rows.push_back({&d.first, &d.second, d.second.percentile(0.99)});
+        if (fleet.histogram.size() < d.second.histogram.size()) {
+            fleet.histogram.resize(d.second.histogram.size());
+        }
+        for (size_t ms = 0; ms < d.second.histogram.size(); ms++) {
+            fleet.histogram[ms] += d.second.histogram[ms];
+        }
+        fleet.count += d.second.count;
+        fleet.sum += d.second.sum;
+    }
+    double query_ms = elapsed_ms(start);
+
+    // Slowest devices first
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+        return a.p99 != b.p99 ? a.p99 > b.p99 : *a.device < *b.device;
+    });
+
+    printf("%-16s %10s %7s %7s %7s %7s %7s\n", "device", "frames", "mean", "p50", "p90", "p99", "max");
+    for (size_t i = 0; i < rows.size() && i < q.limit; i++) {
+        const LatencyStats& s = *rows[i].stats;
+        printf("%-16s %10" PRIu64 " %7.1f %7u %7u %7u %7u\n", rows[i].device->c_str(), s.count,
+               static_cast<double>(s.sum) / s.count, s.percentile(0.50), s.percentile(0.90),
+               rows[i].p99, s.percentile(1.0));
+    }
+    if (rows.size() > q.limit) printf("... %zu more devices\n", rows.size() - q.limit);
+    if (fleet.count) {
+        printf("%-16s %10" PRIu64 " %7.1f %7u %7u %7u %7u\n", "(fleet)", fleet.count,
+               static_cast<double>(fleet.sum) / fleet.count, fleet.percentile(0.50),
+               fleet.percentile(0.90), fleet.percentile(0.99), fleet.percentile(1.0));
+    }
+    printf("\nQuery: %.2f ms (decoded %zu of %zu blocks)\n", query_ms, scanned, store.blocks().size());
+    return 0;
+}
+
+struct AlertStats {
+    uint64_t alerts = 0;        // Rows at or above the minimum level
+    uint64_t high = 0;          // Level 2 rows
+    uint64_t fire = 0;
+    uint64_t gaps = 0;
+};
+
+int cmd_alerts(const MetricStoreReader& store, const Query& q) {
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_map<std::string, AlertStats> devices;
+    BlockColumns cols;
+    size_t scanned = 0;
+
+    for (const IndexEntry& b : store.blocks()) {
+        const BlockHeader& h = b.header;
+        int match = block_match(h, q);
+        if (match == 0) continue;
+        if (h.level_max < q.min_level && !(h.flags_any & (METRIC_FLAG_FIRE | METRIC_FLAG_GAP))) {
+            continue;  // Nothing to count in this block
+        }
+
+        uint32_t mask = 1u << COL_LEVEL_FLAGS;
+        if (match == 1) mask |= 1u << COL_TIMESTAMP;
+        if (!store.decode(b, mask, cols)) continue;
+        scanned++;
+
+        AlertStats& s = devices[h.device];
+        for (uint32_t i = 0; i < h.count; i++) {
+            if (match == 1 && (cols.timestamp_us[i] < q.from_us || cols.timestamp_us[i] > q.to_us)) {
+                continue;
+            }
+            uint8_t level = cols.level_flags[i] & 0x03;
+            uint8_t flags = cols.level_flags[i] >> 2;
+            s.alerts += level >= q.min_level;
+            s.high += level >= 2;
+            s.fire += (flags & METRIC_FLAG_FIRE) != 0;
+            s.gaps += (flags & METRIC_FLAG_GAP) != 0;
+        }
+    }
+    double query_ms = elapsed_ms(start);
+
+    std::vector<std::pair<std::string, AlertStats>> rows(devices.begin(), devices.end());
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        return a.second.alerts != b.second.alerts ? a.second.alerts > b.second.alerts : a.first < b.first;
+    });
+
+    AlertStats fleet;
+    printf("%-16s %10s %10s %10s %10s\n", "device", "alerts", "level 2", "fire", "gaps");
+    for (size_t i = 0; i < rows.size(); i++) {
+        const AlertStats& s = rows[i].second;
+        if (i < q.limit) {
+            printf("%-16s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+                   rows[i].first.c_str(), s.alerts, s.high, s.fire, s.gaps);
+        }
+        fleet.alerts += s.alerts;
+        fleet.high += s.high;
+        fleet.fire += s.fire;
+        fleet.gaps += s.gaps;
+    }
+    if (rows.size() > q.limit) printf("... %zu more devices\n", rows.size() - q.limit);
+    printf("%-16s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n", "(fleet)",
+           fleet.alerts, fleet.high, fleet.fire, fleet.gaps);
+    printf("\nQuery: %.2f ms (decoded %zu of %zu blocks)\n", query_ms, scanned, store.blocks().size());
+    return 0;
+}
+
+int cmd_scan(const MetricStoreReader& store, const Query& q) {
+    BlockColumns cols;
+    uint32_t all = (1u << COL_COUNT) - 1;
+    size_t printed = 0;
+
+    printf("timestamp_us,device,frame,confidence,latency_ms,alert_level,flags\n");
+    for (const IndexEntry& b : store.blocks()) {
+        const BlockHeader& h = b.header;
+        if (block_match(h, q) == 0) continue;
+        if (!store.decode(b, all, cols)) continue;
+
+        for (uint32_t i = 0; i < h.count && printed < q.limit; i++) {
+            if (cols.timestamp_us[i] < q.from_us || cols.timestamp_us[i] > q.to_us) continue;
+            printf("%" PRIu64 ",%s,%u,%.4f,%u,%u,%u\n", cols.timestamp_us[i], h.device,
+                   cols.frame[i], cols.confidence[i], cols.latency_ms[i],
+                   cols.level_flags[i] & 0x03, cols.level_flags[i] >> 2);
+            printed++;
+        }
+        if (printed >= q.limit) break;
+    }
+    return 0;
+}
+
+int cmd_verify(const MetricStoreReader& store) {
+    size_t bad = 0;
+    for (const IndexEntry& b : store.blocks()) {
+        if (!store.verify(b)) {
+            printf("⚠ CRC mismatch: block at offset %" PRIu64 " (%s)\n", b.offset, b.header.device);
+            bad++;
+        }
+    }
+    if (bad == 0) printf("✓ %zu blocks OK\n", store.blocks().size());
+    return bad ? 1 : 0;
+}
+
+/**
+ * Append a gateway CSV log (timestamp_us,device,frame,confidence,inference_ms,fire,alert_level)
+ */
+int cmd_import(const Query& q) {
+    FILE* in = fopen(q.csv.c_str(), "r");
+    if (!in) {
+        perror(q.csv.c_str());
+        return 1;
+    }
+    MetricStoreWriter writer(q.path, q.block_rows);
+    if (!writer.ok()) {
+        perror(q.path.c_str());
+        fclose(in);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    char line[256];
+    uint64_t skipped = 0;
+    while (fgets(line, sizeof(line), in)) {
+        unsigned long long ts;
+        char device[64];
+        unsigned frame, latency, fire, level;
+        float confidence;
+        if (sscanf(line, "%llu,%63[^,],%u,%f,%u,%u,%u", &ts, device, &frame, &confidence, &latency,
+                   &fire, &level) != 7) {
+            skipped++;
+            continue;
+        }
+        MetricRow row = {ts, frame, confidence, latency, static_cast<uint8_t>(level),
+                         static_cast<uint8_t>(fire ? METRIC_FLAG_FIRE : 0)};
+        writer.append(device, row);
+    }
+    fclose(in);
+    uint64_t rows = writer.rows();
+    writer.close();
+
+    printf("✓ Imported %" PRIu64 " rows in %.0f ms (%" PRIu64 " lines skipped, %" PRIu64 " blocks)\n",
+           rows, elapsed_ms(start), skipped, writer.blocks());
+    return 0;
+}
+
+void usage(const char* argv0) {
+    printf("Usage: %s <info|latency|alerts|scan|verify> STORE [options]\n"
+           "       %s import STORE CSV [--block-rows N]\n"
+           "  --device NAME     Only this device\n"
+           "  --from US --to US Time range (microseconds since epoch)\n"
+           "  --last SECONDS    Time range ending at the newest row\n"
+           "  --min-level N     alerts: count rows with alert_level >= N (default 1)\n"
+           "  --limit N         Devices to print (default 20) or rows to scan (default 100)\n",
+           argv0, argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Query q;
+    q.command = argv[1];
+    q.path = argv[2];
+    int i = 3;
+    if (q.command == "import") {
+        if (argc < 4) {
+            usage(argv[0]);
+            return 1;
+        }
+        q.csv = argv[i++];
+    }
+    for (; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--device" && has_value) {
+            q.device = argv[++i];
+        } else if (arg == "--from" && has_value) {
+            q.from_us = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--to" && has_value) {
+            q.to_us = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--last" && has_value) {
+            q.last_s = atof(argv[++i]);
+        } else if (arg == "--min-level" && has_value) {
+            q.min_level = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (arg == "--limit" && has_value) {
+            q.limit = static_cast<size_t>(atol(argv[++i]));
+        } else if (arg == "--block-rows" && has_value) {
+            q.block_rows = static_cast<uint32_t>(atoi(argv[++i]));
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (q.command == "import") return cmd_import(q);
+
+    auto start = std::chrono::steady_clock::now();
+    MetricStoreReader store;
+    if (!store.open(q.path)) {
+        printf("⚠ Cannot open store: %s\n", q.path.c_str());
+        return 1;
+    }
+    double open_ms = elapsed_ms(start);
+    resolve_last(store, q);
+
+    int rc;
+    if (q.command == "info") {
+        rc = cmd_info(store);
+        printf("Open:       %.2f ms\n", open_ms);
+    } else if (q.command == "latency") {
+        if (q.limit == 0) q.limit = 20;
+        rc = cmd_latency(store, q);
+    } else if (q.command == "alerts") {
+        if (q.limit == 0) q.limit = 20;
+        rc = cmd_alerts(store, q);
+    } else if (q.command == "scan") {
+        if (q.limit == 0) q.limit = 100;
+        rc = cmd_scan(store, q);
+    } else if (q.command == "verify") {
+        rc = cmd_verify(store);
+    } else {
+        usage(argv[0]);
+        rc = 1;
+    }
+    return rc;
+}
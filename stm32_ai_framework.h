@@ -4,6 +4,10 @@
  * 
  * This guide shows how to integrate AI/ML models into STM32 projects
  * Perfect for fire detection, anomaly detection, sensor analysis, etc.
+ *
+ * Header-only: every function is static inline, so the header can be
+ * included from several translation units without duplicate symbols.
+ * All state lives in the caller's FireDetectionModel / ModelMetrics.
  */
 
 #ifndef STM32_AI_FRAMEWORK_H
@@ -58,7 +62,7 @@ typedef struct {
  * Initialize fire detection model
  * Should be called once at startup
  */
-int32_t fire_detection_init(FireDetectionModel* model) {
+static inline int32_t fire_detection_init(FireDetectionModel* model) {
     if (!model) return -1;
     
     // Initialize buffers
@@ -78,8 +82,8 @@ int32_t fire_detection_init(FireDetectionModel* model) {
  * Input: raw image data from camera sensor
  * Output: normalized 32x32 grayscale image
  */
-void preprocess_image(uint8_t* raw_image, uint32_t raw_size, 
-                      float* normalized_image) {
+static inline void preprocess_image(uint8_t* raw_image, uint32_t raw_size, 
+                                    float* normalized_image) {
     for (uint32_t i = 0; i < 1024; i++) {
         if (i < raw_size) {
             // Normalize to 0-1 range
@@ -96,7 +100,7 @@ void preprocess_image(uint8_t* raw_image, uint32_t raw_size,
  * Run inference on preprocessed image
  * Returns: confidence score (0.0 to 1.0)
  */
-float fire_detection_inference(FireDetectionModel* model) {
+static inline float fire_detection_inference(FireDetectionModel* model) {
     // In production, this calls TensorFlow Lite interpreter:
     // 
     // tflite::MicroInterpreter interpreter(model_data, resolver, tensor_arena, 
@@ -116,15 +120,14 @@ float fire_detection_inference(FireDetectionModel* model) {
 typedef struct {
     int fire_detected;
     float confidence;
-    float temperature_estimate;
+    float temperature_estimate;  // Hottest thermal pixel, C (0 without a thermal sensor)
     int alert_level; // 0=none, 1=warning, 2=critical
 } DetectionResult;
 
-DetectionResult process_detection_output(FireDetectionModel* model) {
+static inline DetectionResult process_detection_output(FireDetectionModel* model) {
     DetectionResult result = {0};
     
-    // Get output probabilities
-    float no_fire_prob = model->output_buffer[0];
+    // Get output probabilities: [no_fire_prob, fire_prob]
     float fire_prob = model->output_buffer[1];
     
     result.confidence = fire_prob;
@@ -141,6 +144,21 @@ DetectionResult process_detection_output(FireDetectionModel* model) {
     return result;
 }
 
+/**
+ * Fold a thermal array reading into a detection
+ * hottest_c: hottest pixel, hot_confirmed: a hot spot where the camera sees
+ * fire. The CubeIDE template's thermal_sensor.c produces both from a 32x24
+ * array (fixed-point conversion, hot-spot map).
+ */
+static inline void apply_thermal_reading(DetectionResult* result, float hottest_c, int hot_confirmed) {
+    result->temperature_estimate = hottest_c;
+    if (result->fire_detected) {
+        if (hot_confirmed && result->alert_level < 2) {
+            result->alert_level = 2;  // Heat confirms; it never lowers the vision alert
+        }
+    }
+}
+
 /* ==================== PERFORMANCE MONITORING ==================== */
 
 typedef struct {
@@ -151,8 +169,8 @@ typedef struct {
     float accuracy;
 } ModelMetrics;
 
-void update_metrics(ModelMetrics* metrics, DetectionResult* result, 
-                    int ground_truth, uint32_t inference_time) {
+static inline void update_metrics(ModelMetrics* metrics, DetectionResult* result, 
+                                  int ground_truth, uint32_t inference_time) {
     metrics->total_inferences++;
     metrics->avg_inference_time_ms = 
         (metrics->avg_inference_time_ms + inference_time) / 2;